@@ -0,0 +1,19 @@
+; callcc: captures and immediately invokes a continuation on every iteration, at growing depth
+
+(define count-to
+  (lambda (n acc)
+    (if (p/invoke = n 0)
+        acc
+        (count-to (p/invoke - n 1) (p/invoke + acc (call/cc (lambda (k) (k n))))))))
+
+(define deep
+  (lambda (n)
+    (if (p/invoke = n 0)
+        (call/cc (lambda (k) (k 0)))
+        (p/invoke + 1 (deep (p/invoke - n 1))))))
+
+(define deep-loop
+  (lambda (i acc)
+    (if (p/invoke = i 0) acc (deep-loop (p/invoke - i 1) (p/invoke + acc (deep 100))))))
+
+(p/invoke + (count-to 50000 0) (deep-loop 1000 0))
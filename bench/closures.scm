@@ -0,0 +1,12 @@
+; closures: allocates and applies short-lived closures with free variables
+
+(define make-adder (lambda (n) (lambda (x) (p/invoke + x n))))
+(define compose (lambda (f g) (lambda (x) (f (g x)))))
+
+(define loop
+  (lambda (i acc)
+    (if (p/invoke = i 0)
+        acc
+        (loop (p/invoke - i 1) ((compose (make-adder i) (make-adder 1)) acc)))))
+
+(loop 200000 0)
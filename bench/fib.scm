@@ -0,0 +1,9 @@
+; fib: deep non-tail recursion through a global, cf `sandbox/demo3.scm`
+
+(define fib 
+  (lambda (n) 
+    (if (p/invoke < n 2) 
+        n 
+        (p/invoke + (fib (p/invoke - n 1)) (fib (p/invoke - n 2))))))
+
+(fib 25)
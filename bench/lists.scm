@@ -0,0 +1,24 @@
+; lists: builds, maps, reverses, and folds lists of 1000 integers
+
+(define iota
+  (lambda (n acc)
+    (if (p/invoke = n 0) acc (iota (p/invoke - n 1) (p/invoke cons n acc)))))
+(define square-all
+  (lambda (l)
+    (if (p/invoke null? l)
+        '()
+        (p/invoke cons (p/invoke * (p/invoke car l) (p/invoke car l)) (square-all (p/invoke cdr l))))))
+(define rev
+  (lambda (l acc)
+    (if (p/invoke null? l) acc (rev (p/invoke cdr l) (p/invoke cons (p/invoke car l) acc)))))
+(define sum
+  (lambda (l acc)
+    (if (p/invoke null? l) acc (sum (p/invoke cdr l) (p/invoke + acc (p/invoke car l))))))
+
+(define repeat
+  (lambda (k acc)
+    (if (p/invoke = k 0)
+        acc
+        (repeat (p/invoke - k 1) (p/invoke + acc (sum (rev (square-all (iota 1000 '())) '()) 0))))))
+
+(repeat 100 0)
@@ -0,0 +1,28 @@
+; nqueens: counts the solutions to the 8-queens problem, backtracking over lists of placed rows
+
+(define safe?
+  (lambda (row dist placed)
+    (if (p/invoke null? placed)
+        #t
+        (if (p/invoke = (p/invoke car placed) row)
+            #f
+            (if (p/invoke = (p/invoke car placed) (p/invoke + row dist))
+                #f
+                (if (p/invoke = (p/invoke car placed) (p/invoke - row dist))
+                    #f
+                    (safe? row (p/invoke + dist 1) (p/invoke cdr placed))))))))
+
+; try-rows counts the solutions with the next queen in 'row' or higher, given those 'placed' so far.
+(define try-rows
+  (lambda (row n placed)
+    (if (p/invoke > row n)
+        0
+        (p/invoke + 
+          (if (safe? row 1 placed) 
+              (if (p/invoke = (p/invoke length placed) (p/invoke - n 1))
+                  1
+                  (try-rows 1 n (p/invoke cons row placed)))
+              0)
+          (try-rows (p/invoke + row 1) n placed)))))
+
+(try-rows 1 8 '())
@@ -0,0 +1,12 @@
+; tak: Takeuchi function, three-argument calls in and out of tail position
+
+(define tak
+  (lambda (x y z)
+    (if (p/invoke < y x)
+        (tak 
+          (tak (p/invoke - x 1) y z)
+          (tak (p/invoke - y 1) z x)
+          (tak (p/invoke - z 1) x y))
+        z)))
+
+(tak 18 12 6)
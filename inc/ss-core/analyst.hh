@@ -11,7 +11,7 @@ namespace ss {
         Analyst();
     public:
         IdCache const& id_cache() const { return g_id_cache(); }
-        void check_vars_list_else_throw(FLoc loc, OBJECT vars);
+        void check_vars_list_else_throw(FLocID loc, OBJECT vars);
     };
 
 }
\ No newline at end of file
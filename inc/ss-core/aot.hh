@@ -0,0 +1,145 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+
+#include "ss-core/common.hh"
+#include "ss-core/object.hh"
+#include "ss-core/vcode.hh"
+#include "ss-core/jit.hh"
+
+///
+// AOT: programs compiled ahead of time into native executables, cf `ssc`.
+// - `emit_aot_program` writes a C++ translation unit for a compiled subr: it embeds the subr's code as a VCode
+//   cache (cf `vcode-cache.hh`), so that running it neither parses, expands, nor compiles, and translates each
+//   closure body of the subr's unit into one function of native code.
+// - the executable links against ss-core as its run-time (objects, GC, platform procedures, and the bytecode
+//   engine): `aot_main` loads the embedded code into a VM, and installs every function as an entry, as the JIT
+//   would, cf `VJit::install`. Thus, native code uses the JIT's protocol: it is entered at the word of the
+//   body's first instruction or of a return point with the registers in a `JitFrame`, and exits to the
+//   interpreter at each instruction it does not translate (e.g. `call/cc`, closures, and platform procedures),
+//   or whose fast path fails.
+// - calls of known procedures, and returns to one of the body's own return points, stay in native code: a call
+//   of the body itself is a jump, and one of another body is a tail call, with `musttail` where the compiler
+//   guarantees it (i.e. Clang): elsewhere, it exits to the interpreter, which enters the callee.
+// - the code of a body refers to the run-time addresses of bytecode words, to global IDs, and to constants by
+//   index into a table of slots, each naming an expression of the unit: these are resolved once loaded.
+//
+
+#if defined(__clang__) && defined(__has_cpp_attribute)
+    #if __has_cpp_attribute(clang::musttail)
+        #define SS_AOT_MUSTTAIL (1)
+    #endif
+#endif
+#ifndef SS_AOT_MUSTTAIL
+    #define SS_AOT_MUSTTAIL (0)
+#endif
+
+namespace ss {
+
+    // AotSlotKind is what a slot is resolved to, from the expression it names in the loaded unit.
+    enum class AotSlotKind: uint32_t {
+        Pc,             // the address of its bytecode word
+        Global,         // the global it refers to, assigns, or calls
+        Constant        // the raw word of its constant
+    };
+    struct AotSlot {
+        uint32_t exp_index;     // cf `vmx_index`
+        AotSlotKind kind;
+    };
+    struct AotEntry {
+        uint32_t exp_index;
+        JitCode code;
+    };
+
+    // AotProgram describes the program an executable embeds: it is emitted by `emit_aot_program`.
+    struct AotProgram {
+        char const* name;
+        uint64_t key;
+        uint64_t const* vcode_words;
+        size_t vcode_word_count;
+        AotSlot const* slots;
+        uint64_t* slot_words;           // written once resolved
+        size_t slot_count;
+        AotEntry const* entries;
+        size_t entry_count;
+    };
+
+    // emit_aot_program writes the translation unit of an executable running `subr`, where `vcode_words` is its
+    // VCode cache, written with `key`: cf `write_vcode_cache`.
+    void emit_aot_program(
+        std::ostream& out, VCode& code, VSubr const& subr,
+        uint64_t key, std::vector<uint64_t> const& vcode_words
+    );
+
+    // aot_main runs `program` for the `main` of an executable.
+    // It accepts '-snail-root', '-heap-gib' like `ssi`, and '-interpret' to run it without native code.
+    int aot_main(int argc, char const* argv[], AotProgram const& program);
+
+    //
+    // Used by emitted code:
+    //
+
+    // fixnums are handled by their raw words, like the JIT's templates: building them field by field is slow.
+    inline uint64_t aot_raw(OBJECT obj) {
+        return std::bit_cast<uint64_t>(obj);
+    }
+    inline OBJECT aot_object(uint64_t raw) {
+        return std::bit_cast<OBJECT>(raw);
+    }
+    inline bool aot_is_fixnum(OBJECT obj) {
+        return (aot_raw(obj) & ((uint64_t{1} << OBJECT::FIXNUM_TAG_BITS) - 1)) == OBJECT::FIXNUM_TAG;
+    }
+    inline OBJECT aot_fixnum(ssize_t v) {
+        return aot_object((static_cast<uint64_t>(v) << OBJECT::FIXNUM_TAG_BITS) | OBJECT::FIXNUM_TAG);
+    }
+    inline ssize_t aot_fixnum_value(OBJECT obj) {
+        return static_cast<int64_t>(aot_raw(obj)) >> OBJECT::FIXNUM_TAG_BITS;
+    }
+    // results wrap around like `OBJECT::make_integer`:
+    inline OBJECT aot_add(OBJECT l, OBJECT r) {
+        return aot_object(aot_raw(l) + aot_raw(r) - OBJECT::FIXNUM_TAG);
+    }
+    inline OBJECT aot_sub(OBJECT l, OBJECT r) {
+        return aot_object(aot_raw(l) - aot_raw(r) + OBJECT::FIXNUM_TAG);
+    }
+    inline OBJECT aot_mul(OBJECT l, OBJECT r) {
+        return aot_object((aot_raw(l) - OBJECT::FIXNUM_TAG) * static_cast<uint64_t>(aot_fixnum_value(r)) + OBJECT::FIXNUM_TAG);
+    }
+    // fixnums compare like their raw words:
+    inline int64_t aot_cmp_word(OBJECT obj) {
+        return static_cast<int64_t>(aot_raw(obj));
+    }
+    inline constexpr OBJECT AOT_TRUE{true};
+    inline constexpr OBJECT AOT_FALSE{false};
+    inline OBJECT aot_boolean(bool v) {
+        return v ? AOT_TRUE : AOT_FALSE;
+    }
+    inline bool aot_is_false(OBJECT obj) {
+        return aot_raw(obj) == aot_raw(AOT_FALSE);
+    }
+
+}   // namespace ss
+
+// In emitted code, which keeps the registers in locals:
+#define SS_AOT_LEAVE() \
+    fr->a = a; \
+    fr->f = f; \
+    fr->c = c; \
+    fr->s = s
+#define SS_AOT_EXIT(pc_word) \
+    SS_AOT_LEAVE(); \
+    return reinterpret_cast<::ss::VmCodePtr>(pc_word)
+#if SS_AOT_MUSTTAIL
+    #define SS_AOT_TAIL_CALL(body_fn, pc_word) \
+        SS_AOT_LEAVE(); \
+        [[clang::musttail]] return body_fn(fr, 0)
+#else
+    #define SS_AOT_TAIL_CALL(body_fn, pc_word) \
+        SS_AOT_EXIT(pc_word)
+#endif
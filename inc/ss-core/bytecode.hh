@@ -0,0 +1,176 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <ostream>
+#include <cstdint>
+
+#include "ss-core/common.hh"
+#include "ss-core/object.hh"
+#include "ss-core/vcode.hh"
+
+///
+// VBytecode: a dense, variable-length lowering of VCode.
+// - VmExps form a graph: each one names its successor explicitly, and every record is as wide as the
+//   widest `VmExpArgs` arm. The interpreter pays for a bounds-checked lookup + a shared indirect branch
+//   per instruction.
+// - The lowering linearizes this graph: each instruction is an opcode word followed by only the operand
+//   words it needs, and the primary successor is placed (where possible) immediately after it, so
+//   the `x` operand disappears. Secondary successors (the 'else' arm of Test, the return point of Frame)
+//   become absolute addresses; a `Jump` is emitted when the primary successor was already placed.
+// - The VM may 'thread' the stream: opcode words are overwritten with handler addresses so dispatch is a
+//   single `goto *pc`. Opcodes are kept in a side table for printing.
+// - Lowering is lazy and incremental: VmExps created at run-time (e.g. continuations) are lowered on
+//   first entry.
+// - Each VCode unit is lowered into chunks of its own, which are never moved, so that the words of a unit 
+//   can be freed with it: cf `VCode::free_unit`. A `Jump` links an instruction to its successor when they
+//   are in different chunks.
+// - With registers (cf `VmEngine::Register`), each primitive whose arguments are locals or constants is 
+//   lowered with the VmExps loading them into one three-address instruction, e.g. 'prim-sub-rk' for 
+//   `(- n 1)`, which reads the frame's slots in place of 'constant-push -> refer-local -> prim-sub': cf
+//   `vmx_kind_is_register`. The VmExps it covers have no entry of their own unless lowered from elsewhere,
+//   so code that enters VCode at any VmExp (e.g. the JIT's exits) must not run on it.
+// - Instructions may be 'quickened' once they have run: rewritten in place into a faster instruction of the
+//   same width, which holds for the values they saw. Each rewrite is recorded, so that it can be undone
+//   once it no longer holds, cf `deoptimize_all`.
+//
+
+namespace ss {
+
+    using VmWord = uint64_t;
+    using VmCodePtr = VmWord const*;
+
+    class VBytecode {
+    private:
+        struct PendingPatch {
+            VmWord* operand;
+            VmExpID target;
+        };
+        struct Quickening {
+            VmWord* op;                 // rewritten to `kind` on deoptimization, with `operand`
+            VmExpKind kind;
+            size_t operand_index;
+            VmWord operand;
+        };
+        struct ChunkSpan {
+            VmCodePtr begin;
+            VmCodePtr end;
+            VCodeUnitID unit;
+        };
+        struct Unit {
+            VCodeUnitID id;
+            std::vector<std::unique_ptr<VmWord[]>> chunks;
+            VmWord* next;                                   // the free words of the last chunk
+            VmWord* end;
+            std::vector<VmCodePtr> entries;                 // indexed by `vmx_index`, null if not lowered
+            std::vector<std::pair<VmWord*, VmExpKind>> ops; // the opcode word of each instruction, in order
+            size_t threaded_op_count;
+            size_t word_count;                              // in every chunk
+            bool is_queued;                                 // cf `m_unthreaded_units`
+        };
+    private:
+        VCode* m_code;
+        bool m_uses_registers;
+        std::vector<std::unique_ptr<Unit>> m_units;         // indexed by VCodeUnitID, null if not lowered
+        std::vector<VCodeUnitID> m_unthreaded_units;        // those with ops that are not yet threaded
+        void* const* m_threaded_labels;
+        size_t m_word_count;                                // in every chunk
+        size_t m_op_count;
+        std::vector<Quickening> m_quickenings;
+        std::vector<size_t> m_quickened_global_counts;      // indexed by GDefID
+        mutable std::vector<ChunkSpan> m_chunk_spans;       // sorted by address, rebuilt once chunks change: cf `exp_at`
+
+    public:
+        explicit VBytecode(VCode* code, bool uses_registers = false);
+
+    // Lowering:
+    public:
+        // entry returns the address of the first word of `exp_id`, lowering it (and everything reachable
+        // from it) if required.
+        VmCodePtr entry(VmExpID exp_id) {
+            VCodeUnitID unit = vmx_unit(exp_id);
+            size_t index = vmx_index(exp_id);
+            if (unit < m_units.size() && m_units[unit] && index < m_units[unit]->entries.size()) {
+                if (VmCodePtr pc = m_units[unit]->entries[index]) {
+                    return pc;
+                }
+            }
+            return lower(exp_id);
+        }
+        // free_unit drops the words of `unit`, cf `VCode::free_unit`: nothing may refer to them any more.
+        void free_unit(VCodeUnitID unit);
+    private:
+        VmCodePtr lower(VmExpID exp_id);
+        VmExpID lower_register_op(Unit& u, VmExpID exp_id, bool falls_through);
+        Unit& lowered_unit(VCodeUnitID unit);
+        VmWord* emit_op(Unit& u, VmExpKind kind, bool falls_through);
+        VmWord* place_op(Unit& u, VmExpKind kind);
+        void emit_word(Unit& u, VmWord word) { *u.next++ = word; }
+        void emit_obj(Unit& u, OBJECT obj) { *u.next++ = obj.as_raw(); }
+        void emit_call_cache(Unit& u) { emit_word(u, UNCACHED_CALL); emit_word(u, 0); }
+        static VmWord addr_word(VmCodePtr pc) { return reinterpret_cast<VmWord>(pc); }
+
+    // Threading:
+    // `labels` maps each VmExpKind to the address of its handler.
+    // Threading with a different table (e.g. the profiling engine's) re-threads every unit.
+    public:
+        void thread(void* const* labels);
+        bool has_unthreaded_ops() const { return !m_unthreaded_units.empty(); }
+        void* const* threaded_labels() const { return m_threaded_labels; }
+        // thread_entry threads the opcode word at `pc` to `handler` instead of its own, e.g. to enter native 
+        // code there: cf `VJit`. This lasts until every unit is re-threaded with another table.
+        // The instruction is deoptimized first, since `handler` may fall back to that of its own kind.
+        void thread_entry(VmCodePtr pc, void* handler);
+
+    // Quickening: only the main VThread may quicken code, while no other runs, since others read it.
+    // - quicken_global rewrites the 'refer-global' at `pc` into a 'constant' of `value`: its sites are 
+    //   deoptimized once it is assigned, i.e. redefined, cf `deoptimize_global`.
+    // - quicken_call rewrites the call at `pc` (e.g. 'apply') into its cached kind (e.g. 'apply-cached'), 
+    //   which enters `body_pc` directly while it calls `closure` again. `uncache_call` rewrites it back 
+    //   once it calls another, leaving it `POLYMORPHIC_CALL`, so it is not quickened again.
+    // Each call has two cache words before its operands, so that every kind finds them alike: the first is 
+    // `closure`, `UNCACHED_CALL`, or `POLYMORPHIC_CALL`, cf `call_cache`.
+    // In each case, the instruction at `pc` is only rewritten if threaded to its own handler: e.g. not if 
+    // the JIT entered there, cf `thread_entry`.
+    public:
+        inline static constexpr VmWord UNCACHED_CALL = 0;
+        inline static constexpr VmWord POLYMORPHIC_CALL = 1;
+        void quicken_global(VmCodePtr pc, OBJECT value);
+        void quicken_call(VmCodePtr pc, OBJECT closure, VmCodePtr body_pc);
+        void uncache_call(VmCodePtr pc);
+        static VmCodePtr call_cache(VmCodePtr pc) { return pc + 1; }
+        bool has_quickened_global(size_t gn) const { return gn < m_quickened_global_counts.size() && m_quickened_global_counts[gn] > 0; }
+        // deoptimize_global undoes every quickening of global `gn`, e.g. once it is assigned.
+        void deoptimize_global(size_t gn);
+        // deoptimize_all undoes every quickening, e.g. once objects may have moved.
+        void deoptimize_all();
+        size_t count_quickenings() const { return m_quickenings.size(); }
+    private:
+        VmWord op_word(VmExpKind kind) const;
+        void deoptimize(Quickening const& q);
+
+    // Attribution:
+    public:
+        // exp_at returns the VmExp of the instruction at `pc`, or of the last one before it with an entry (e.g. 
+        // for a register instruction), and the instruction's kind: -1 if `pc` is in no unit. This is slow, e.g. for
+        // sampled allocations: cf `VmHeapProfile`.
+        VmExpID exp_at(VmCodePtr pc, VmExpKind* out_kind = nullptr) const;
+
+    // Properties:
+    public:
+        size_t size() const { return m_word_count; }
+        size_t count_instructions() const { return m_op_count; }
+        bool uses_registers() const { return m_uses_registers; }
+
+    // Dump:
+    public:
+        void print(std::ostream& out) const;
+        void print_one(VmCodePtr pc, std::ostream& out) const;
+        static size_t width(VmExpKind kind);
+    private:
+        static bool is_addr_operand(VmExpKind kind, size_t j);
+        static bool is_obj_operand(VmExpKind kind, size_t j);
+    };
+
+}   // namespace ss
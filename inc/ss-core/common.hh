@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include "ss-core/config.hh"
 #include "robin_hood.h"
 
@@ -11,8 +12,8 @@ namespace ss {
     template <typename T>
     using StableHashSet = robin_hood::unordered_set<T>;
 
-    template <typename K, typename V>
-    using UnstableHashMap = robin_hood::unordered_flat_map<K, V>;
+    template <typename K, typename V, typename Hash = robin_hood::hash<K>, typename KeyEqual = std::equal_to<K>>
+    using UnstableHashMap = robin_hood::unordered_flat_map<K, V, Hash, KeyEqual>;
     template <typename K, typename V>
     using StableHashMap = robin_hood::unordered_map<K, V>;
 
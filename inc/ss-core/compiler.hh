@@ -3,6 +3,7 @@
 #include <vector>
 #include <optional>
 #include <utility>
+#include <memory>
 
 #include "ss-core/common.hh"
 #include "ss-core/intern.hh"
@@ -19,9 +20,29 @@ namespace ss {
 
     class Compiler: public Analyst {
     private:
-        VCode* m_code;
+        // DefiningProc: a known procedure whose body is being compiled: calls to it from its own body are
+        // linked once the body is compiled.
+        struct DefiningProc {
+            GDefID gdef_id;
+            size_t arity;
+            size_t lambda_depth;    // of its body: calls at this depth are made from its own frame
+            std::vector<VmExpID> self_calls;
+        };
+        // LocalFrame: the slots of the lambda whose body is being compiled. Its arguments are below its frame 
+        // pointer, at indices from 0; the locals its body defines are pushed above it as the body is entered, 
+        // at indices from -1, cf `reserve_local_defines`.
+        struct LocalFrame {
+            size_t arity = 0;
+            std::vector<LDefID> defines;
+        };
+    private:
+        std::unique_ptr<VCode> m_code;
         GcThreadFrontEnd& m_gc_tfe;
-        OBJECT m_gdef_set;
+        LambdaLocTable m_lambda_locs;   // for the line being compiled
+        std::vector<DefiningProc> m_defining_procs;                     // for the line being compiled
+        size_t m_lambda_depth;                                          // of the expression being compiled
+        std::vector<std::pair<GDefID, KnownProc>> m_line_known_procs;   // known once the line is compiled
+        LocalFrame m_local_frame;                                       // of the expression being compiled
         
     public:
         explicit Compiler(GcThreadFrontEnd& gc_tfe);
@@ -29,16 +50,32 @@ namespace ss {
     public:
         VSubr compile_expr(std::string subr_name, OBJECT line_code_object);
         VSubr compile_subr(std::string subr_name, std::vector<OBJECT> line_code_objects);
+        // extend_subr compiles more lines onto the end of a subr, e.g. each chunk of a file parsed in parallel.
+        // Every line of a subr is compiled into its unit, cf `VCode::new_unit`.
+        void extend_subr(VSubr& subr, std::vector<OBJECT> line_code_objects);
         VmProgram compile_line(OBJECT line_code_obj);
         VmExpID compile_exp(OBJECT x, VmExpID next);
         VmExpID compile_list_exp(PairObject* x, VmExpID next);
         VmExpID refer_nonlocal(OBJECT x, VmExpID next);
         bool is_tail_vmx(VmExpID vmx_id);
 
+    // Known procedures: cf `VCode::known_proc`
+    private:
+        bool is_known_proc_defn(GDefID gdef_id, OBJECT init) const;
+        VmExpID compile_known_proc_defn(GDefID gdef_id, OBJECT lambda, VmExpID next);
+        bool lookup_known_callee(OBJECT head, GDefID* out_gdef_id, KnownProc* out_proc, DefiningProc** out_defining_proc);
+
     // Utility builders:
     private:
         VmExpID collect_free(OBJECT vars, VmExpID next);
         VmExpID make_boxes(OBJECT vars, VmExpID next);
+        bool is_boxed_local(OBJECT ldef_id_obj) const;
+
+    // Locals defined in a lambda's body: cf `LocalFrame`
+    private:
+        void find_local_defines(OBJECT x, std::vector<LDefID>& out) const;
+        VmExpID reserve_local_defines(VmExpID next);
+        ssize_t local_slot(ssize_t idx, OBJECT ldef_id_obj) const;
 
     // Globals:
     public:
@@ -57,29 +94,22 @@ namespace ss {
             std::string docstring, 
             bool is_variadic = false
         );
+        PlatformProcID define_platform_proc(
+            IntStr platform_proc_name, 
+            std::vector<std::string> arg_names, 
+            PlatformProcFn fn, 
+            std::string docstring
+        );
         PlatformProcID lookup_platform_proc(IntStr name);
 
-    // Scheme set functions:
-    private:
-        bool is_set_member(OBJECT x, OBJECT s);
-        OBJECT set_cons(OBJECT x, OBJECT s);
-        OBJECT set_union(OBJECT s1, OBJECT s2);
-        OBJECT set_minus(OBJECT s1, OBJECT s2);
-        OBJECT set_intersect(OBJECT s1, OBJECT s2);
-
-    // Find-free: finds all free variables in use
-    //   b => 'bound', the set of bound variable symbol objects, implemented using 'Scheme set'
-    private:
-        OBJECT find_free(OBJECT x, OBJECT b);
-
-    // Find-sets: finds all occurrences of `set!` that apply to free variables.
-    private:
-        OBJECT find_sets(OBJECT x, OBJECT v);
-
     // Code:
     public:
-        inline VCode* code() { return m_code; }
-        inline VCode const* code() const { return m_code; }
+        inline VCode* code() { return m_code.get(); }
+        inline VCode const* code() const { return m_code.get(); }
+
+    // GC roots: everything held by the compiler and its output, cf `VirtualMachine::collect`
+    public:
+        void mark(GcMarker& marker) const;
     };
 
 }
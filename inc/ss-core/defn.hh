@@ -18,10 +18,14 @@ namespace ss {
     std::string m_docstring;
     FLoc m_loc;
     bool m_is_mutated;
+    bool m_is_captured;
+    bool m_is_frame_capturable;
   public:
     explicit Definition(FLoc loc, IntStr name, OBJECT code, OBJECT init, std::string docstring = "");
   public:
     void mark_as_mutated();
+    void mark_as_captured();
+    void mark_as_frame_capturable();
   public:
     IntStr name() const { return m_name; }
     std::string docstring() const { return m_docstring; }
@@ -29,6 +33,15 @@ namespace ss {
     OBJECT init() const { return m_init; }
     FLoc loc() const { return m_loc; }
     bool is_mutated() const { return m_is_mutated; }
+    bool is_captured() const { return m_is_captured; }
+    // is_frame_capturable: whether a continuation may be captured while the local's frame is on the stack, 
+    // i.e. whether the body binding it may call call/cc or make a non-tail call.
+    bool is_frame_capturable() const { return m_is_frame_capturable; }
+    
+    // a local is boxed only if a closure or a re-entered continuation may see it change: a mutated local that 
+    // no closure captures, in a frame no continuation can capture, stays in its stack slot.
+    // - restoring a continuation copies the stack back, so would undo a 'set!' on a slot made since.
+    bool is_boxed() const { return m_is_mutated && (m_is_captured || m_is_frame_capturable); }
   };
 
   class DefTable {
@@ -39,6 +52,8 @@ namespace ss {
   public:
     void mark_global_defn_mutated(GDefID def_id);
     void mark_local_defn_mutated(LDefID def_id);
+    void mark_local_defn_captured(LDefID def_id);
+    void mark_local_defn_frame_capturable(LDefID def_id);
   public:
     GDefID define_global(FLoc loc, IntStr name, OBJECT code=OBJECT::null, OBJECT init=OBJECT::null, std::string docstring="");
     LDefID define_local(FLoc loc, IntStr name, OBJECT code=OBJECT::null, OBJECT init=OBJECT::null, std::string docstring="");
@@ -48,6 +63,9 @@ namespace ss {
     inline Definition const& local(LDefID ldef_id) const { return m_locals_vec[ldef_id]; }
   public:
     inline size_t count_globals() const { return m_globals_vec.size(); }
+    inline size_t count_locals() const { return m_locals_vec.size(); }
+  public:
+    void mark(GcMarker& marker) const;
   };
 
 }
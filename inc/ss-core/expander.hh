@@ -11,6 +11,11 @@ namespace ss {
   
   enum class RelVarScope { Local, Free, Global };
 
+  // macroexpand_syntax rewrites each top-level form in turn, resolving each name it refers to.
+  // - expanded forms are not cached by content hash: expanding a form defines its globals and locals in 
+  //   `def_tab`, and the IDs it allocates are baked into its output, so replaying a cached expansion into
+  //   another DefTable would refer to the wrong definitions. An unchanged file skips expansion altogether 
+  //   instead, by loading its compiled code from the `.ssc` cache, cf `vcode-cache.hh`.
   std::vector<OBJECT> macroexpand_syntax(
     GcThreadFrontEnd& gc_tfe,
     DefTable& def_tab,
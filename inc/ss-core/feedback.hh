@@ -6,10 +6,12 @@
 
 namespace ss {
 
+    void help_fb_print(char const* prefix, std::string msg);
+
     class SsiError: std::exception {
     public:
         inline SsiError() {
-            std::cout << "FATAL-ERROR: see above error messages." << std::endl;
+            help_fb_print("FATAL-ERROR: ", "see above error messages.");
         }
     };
 
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <cstdint>
 #include "ss-core/intern.hh"
 
 namespace ss {
@@ -25,3 +27,54 @@ namespace ss {
     FLoc(IntStr f, FLocSpan s): source(f), span(s) {}
   };
 }
+
+///
+// FLocTable: the locations of one top-level form, kept aside from its syntax objects, cf `SyntaxObject`.
+// - each syntax object refers to its span by an `FLocID`: the table's slot and the span's index in it.
+// - spans are delta-encoded against the span added before, as varints: most take 4 bytes, instead of an `FLoc`'s
+//   40. Every `FLOC_CHECKPOINT_INTERVAL`th span is encoded in full, so that decoding one reads at most that many.
+// - a form's table may be dropped (i.e. freed) once it is compiled, cf `Compiler::extend_subr`: its
+//   locations that are needed later, e.g. those of definitions and closures, are decoded by then.
+//   Decoding the ID of a dropped table gives an unknown location.
+//
+
+namespace ss {
+  // FLocID names a span in an `FLocTable`: 0 is no location.
+  using FLocID = uint64_t;
+  inline constexpr FLocID NO_FLOC = 0;
+
+  class FLocTable {
+  public:
+    static constexpr size_t FLOC_CHECKPOINT_INTERVAL = 16;
+
+  private:
+    IntStr m_source;
+    FLocID m_id_base;
+    std::vector<uint8_t> m_bytes;
+    std::vector<uint32_t> m_checkpoints;
+    FLocSpan m_last_span;
+    uint32_t m_count;
+
+  private:
+    FLocTable(IntStr source, FLocID id_base);
+
+  public:
+    // create returns a new table, which is kept until dropped.
+    static FLocTable* create(IntStr source);
+    // drop frees the table that `id` is a span of, if it has not already been.
+    static void drop(FLocID id);
+    // loc decodes the span `id` names.
+    static FLoc loc(FLocID id);
+    // count_live_tables returns the number of tables not yet dropped.
+    static size_t count_live_tables();
+
+  public:
+    // add records a span, returning its ID: spans are cheapest to encode in the order they are read.
+    FLocID add(FLocSpan span);
+    IntStr source() const { return m_source; }
+    size_t size_in_bytes() const { return m_bytes.size() + m_checkpoints.size() * sizeof(uint32_t); }
+
+  private:
+    FLocSpan span(uint32_t index) const;
+  };
+}
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <cstdint>
+
 namespace ss::gc {
-    class MarkedSet;
+    class PageMap;
     using SizeClassIndex = int8_t;
 }
 namespace ss {
     class Gc;
     class GcThreadFrontEnd;
+    using GcThreadFrontEndID = uint16_t;
 }
\ No newline at end of file
@@ -1,14 +1,17 @@
 #pragma once
 
-#define GC_SINGLE_THREADED_MODE (1)
+#define GC_SINGLE_THREADED_MODE (0)
 
 #include <vector>
-#include <queue>
-#include <forward_list>
 #include <functional>
 #include <algorithm>
 #include <optional>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <ostream>
 #include <cstdint>
+#include <cassert>
 
 #if !GC_SINGLE_THREADED_MODE
 #include <mutex>
@@ -44,8 +47,7 @@ namespace ss::gc {
     class ObjectAllocator;
     class CentralObjectAllocator;
 
-    class MarkedSet;
-    struct MarkedPtr;
+    class PageMap;
 
     ///
     //
@@ -82,6 +84,13 @@ namespace ss::gc {
 
     const int OVERSIZED_SCI = kSizeClassesCount;
 
+    // Number of objects actually moved between the front-end and the transfer-cache at a time.
+    // For some large size-classes, `num_to_move` objects do not fit in a single page-span.
+    inline size_t objects_per_move(SizeClassIndex sci) {
+        SizeClassInfo const& info = kSizeClasses[sci];
+        return std::min(info.num_to_move, info.pages * PAGE_SIZE_IN_BYTES / info.size);
+    }
+
     constexpr SizeClassIndex sci(size_t size_in_bytes) {
     #define USE_NAIVE_LOOKUP 0
     #if USE_NAIVE_LOOKUP
@@ -95,6 +104,8 @@ namespace ss::gc {
         if (size_in_bytes > kMaxSize) {
             return 0;
         }
+        // every allocation is ABlk-aligned, so smaller size-classes are never used.
+        size_in_bytes = std::max(size_in_bytes, sizeof(ABlk));
         // According to Wikipedia, using procedure to find the
         // left-most element: this performs 'rounding up'
         // https://en.wikipedia.org/wiki/Binary_search_algorithm#Procedure_for_finding_the_leftmost_element
@@ -114,46 +125,6 @@ namespace ss::gc {
     #undef USE_NAIVE_LOOKUP
     }
 
-    ///
-    //
-    // MarkedSet
-    //
-    //
-
-    template <typename T, size_t reserved_size=512>
-    struct reserved_vector: public std::vector<T> {
-        reserved_vector()
-        :   std::vector<T>() 
-        {
-            std::vector<T>::reserve(reserved_size);
-        }
-    };
-
-    struct MarkedPtr {
-        APtr ptr;
-        SizeClassIndex sci;
-    };
-    inline bool operator>(MarkedPtr const& lt, MarkedPtr const& rt) {
-        return lt.ptr > rt.ptr;
-    }
-
-    class MarkedSet {
-    private:
-        std::priority_queue< MarkedPtr, reserved_vector<MarkedPtr>, std::greater<MarkedPtr> > m_ptr_max_heap;
-    public:
-        void mark(SizeClassIndex sci, APtr ptr) {
-            m_ptr_max_heap.push(MarkedPtr{ptr, sci});
-        }
-        bool empty() {
-            return m_ptr_max_heap.empty();
-        }
-        MarkedPtr pop_max() {
-            MarkedPtr top = m_ptr_max_heap.top();
-            m_ptr_max_heap.pop();
-            return top;
-        }
-    };
-
     ///
     //
     // Span
@@ -167,6 +138,29 @@ namespace ss::gc {
     struct PageSpan: public GenericSpan {};
     struct ObjectSpan: public GenericSpan {};
 
+    // FreeSpanLink: a free-list's record of one of its spans: the span's size, and the next span in the list.
+    // It is kept in the free memory itself, or in a side table for memory that may not be accessible, cf 
+    // `GenericFreeList::link`.
+    struct FreeSpanLink {
+        APtr next;
+        size_t count;
+    };
+
+    // FreeObject: a free object, threaded onto an intrusive free-list through its own memory.
+    struct FreeObject {
+        FreeObject* next;
+    };
+    struct FreeObjectChain {
+        FreeObject* head;
+        size_t count;
+    };
+    // ObjectBatch: objects moved from the middle-end to a front-end at once: either a contiguous span to
+    // bump-allocate from, or a chain of objects returned by other front-ends.
+    struct ObjectBatch {
+        ObjectSpan span;
+        FreeObjectChain chain;
+    };
+
     ///
     //
     // FreeList
@@ -176,38 +170,59 @@ namespace ss::gc {
     class ObjectAllocator;
 
     // Each FreeList manages 'items' of fixed size.
+    // - spans are kept in address order, and coalesced as items are returned.
+    // - the list is intrusive, so that neither it nor a sweep rebuilding it allocates: each span's link is
+    //   kept in its first item, else, if `m_opt_link_table` is set, in the PageInfo of its first page.
     class GenericFreeList {
     public:
-        using Iterator = std::forward_list<GenericSpan>::iterator;
+        // Iterator visits each span in address order.
+        class Iterator {
+        private:
+            GenericFreeList const* m_list;
+            APtr m_ptr;
+        public:
+            Iterator(GenericFreeList const* list, APtr ptr): m_list(list), m_ptr(ptr) {}
+        public:
+            GenericSpan operator*() const { return {m_ptr, m_list->link(m_ptr).count}; }
+            Iterator& operator++() { m_ptr = m_list->link(m_ptr).next; return *this; }
+            bool operator==(Iterator const& other) const { return m_ptr == other.m_ptr; }
+            bool operator!=(Iterator const& other) const { return m_ptr != other.m_ptr; }
+        };
     protected:
-        std::forward_list<GenericSpan> m_free_span_list;
-        size_t m_item_stride_in_ablks;
+        APtr m_head = nullptr;
+        size_t m_item_stride_in_ablks = 0;
+        PageMap* m_opt_link_table = nullptr;
     protected:
         GenericFreeList() = default;
-        void init(size_t item_stride_in_bytes);
+        void init(size_t item_stride_in_bytes, PageMap* opt_link_table = nullptr);
     public:
         APtr try_allocate_items(size_t item_count);
-        std::pair<Iterator,Iterator> return_items_impl(APtr ptr, size_t item_count);
-    public:
-        void return_items(APtr ptr, size_t item_count) { return_items_impl(ptr, item_count); }
-    public:
-        void clear() { m_free_span_list.clear(); }
-        Iterator before_begin() { return m_free_span_list.before_begin(); }
-        Iterator begin() { return m_free_span_list.begin(); }
-        Iterator end() { return m_free_span_list.end(); }
-        void erase_after(GenericFreeList::Iterator it) {
-            m_free_span_list.erase_after(it);
-        }
-        void insert_after(GenericFreeList::Iterator it, GenericSpan span) {
-            m_free_span_list.insert_after(it, span);
-        }
+        // try_allocate_up_to_items allocates up to `max_item_count` contiguous items from the first span, 
+        // returning an empty span iff this list is empty.
+        GenericSpan try_allocate_up_to_items(size_t max_item_count);
+        void return_items(APtr ptr, size_t item_count);
+    public:
+        // link returns the link of the span starting at `span_ptr`.
+        FreeSpanLink& link(APtr span_ptr) const;
+        // take_head empties this list, returning its first span, e.g. to read the old list while rebuilding it.
+        APtr take_head() { APtr head = m_head; m_head = nullptr; return head; }
+        // head_link is where the first span is linked from: `append_items` links each next span after it.
+        APtr* head_link() { return &m_head; }
+        // append_items links a span after `tail_link`, which must be the end of the list, returning the new end:
+        // the span must lie past every span already in the list.
+        APtr* append_items(APtr* tail_link, APtr ptr, size_t item_count);
+    public:
+        void clear() { m_head = nullptr; }
+        Iterator begin() const { return {this, m_head}; }
+        Iterator end() const { return {this, nullptr}; }
     };
     class PageFreeList: public GenericFreeList {
     public:
         PageFreeList() = default;
     public:
-        void init() {
-            GenericFreeList::init(PAGE_SIZE_IN_BYTES);
+        // init keeps links in `page_map`, since free pages may be decommitted, cf `GcBackEnd::release_idle_pages`.
+        void init(PageMap* page_map) {
+            GenericFreeList::init(PAGE_SIZE_IN_BYTES, page_map);
         }
     };
     class ObjectFreeList: public GenericFreeList {
@@ -241,29 +256,56 @@ namespace ss::gc {
         ObjectFreeList& object_free_list() { return m_object_free_list; }
     };
 
-    class FrontEndObjectAllocator: public BaseObjectAllocator {
+    // FrontEndObjectAllocator: allocates from...
+    // - an intrusive free-list of the objects freed on this front-end (LIFO, so recently freed memory is 
+    //   reused while still cached), else
+    // - the current span, by bumping a pointer.
+    // Freed objects are not coalesced: free memory is only sorted into spans by the sweep.
+    class FrontEndObjectAllocator {
+    private:
+        APtr m_bump = nullptr;
+        APtr m_bump_end = nullptr;
+        FreeObject* m_free_head = nullptr;
+        size_t m_free_count = 0;
+        size_t m_stride_in_ablks = 0;
+    public:
+        FrontEndObjectAllocator() = default;
+        void init(SizeClassIndex sci);
     public:
         APtr try_allocate_object() {
-            return m_object_free_list.try_allocate_items(1);
-        }
-        void return_object(APtr ptr) { 
-            m_object_free_list.return_items(ptr, 1);
+            if (m_free_head) {
+                FreeObject* obj = m_free_head;
+                m_free_head = obj->next;
+                m_free_count--;
+                return reinterpret_cast<APtr>(obj);
+            }
+            if (m_bump < m_bump_end) {
+                APtr obj = m_bump;
+                m_bump += m_stride_in_ablks;
+                return obj;
+            }
+            return nullptr;
         }
-        std::pair<
-            ObjectFreeList::Iterator, 
-            ObjectFreeList::Iterator
-        > return_object_span(ObjectSpan span) {
-            return m_object_free_list.return_items_impl(span.ptr, span.count);
+        void return_object(APtr ptr) {
+            FreeObject* obj = reinterpret_cast<FreeObject*>(ptr);
+            obj->next = m_free_head;
+            m_free_head = obj;
+            m_free_count++;
         }
+        size_t free_count() const { return m_free_count; }
+    public:
+        // refill expects both the free-list and the bump span to be exhausted.
+        void refill(ObjectBatch batch);
+        // take_free_objects detaches up to `max_count` objects from the free-list.
+        FreeObjectChain take_free_objects(size_t max_count);
+        // take_bump_span detaches the rest of the bump span.
+        ObjectSpan take_bump_span();
     };
 
     class CentralObjectAllocator: public BaseObjectAllocator {
     protected:
-        size_t const MAX_PAGESPANS_PER_SIZE_CLASS = 8192;
-
-    protected:
-        std::vector<PageSpan> m_page_spans;
-        std::vector<size_t> m_page_span_refcounts;
+        std::vector<PageSpan> m_page_spans;     // sorted by address
+        FreeObjectChain m_returned_objects;     // returned by front-ends one at a time: unsorted
     #if !GC_SINGLE_THREADED_MODE
         std::mutex m_mutex;
     #endif
@@ -271,152 +313,367 @@ namespace ss::gc {
         CentralObjectAllocator() = default;
         void init(SizeClassIndex sci);
     public:
-        std::optional<ObjectSpan> try_allocate_object_span();
-        std::pair<GenericFreeList::Iterator, GenericFreeList::Iterator> return_object_span(ObjectSpan span);
+        // try_allocate_object_batch allocates up to `objects_per_move` objects: returned objects first, else
+        // contiguous objects.
+        std::optional<ObjectBatch> try_allocate_object_batch();
+        void return_object_span(ObjectSpan span);
+        void return_object_chain(FreeObjectChain chain);
+        // add_page_span_to_pool expects the caller to hold `mutex()`, cf `GcMiddleEnd::try_allocate_object_batch`
         void add_page_span_to_pool(PageSpan span);
     #if !GC_SINGLE_THREADED_MODE
     public:
         std::mutex& mutex() { return m_mutex; }
     #endif
-    private:
-        size_t page_span_index(APtr ptr);
-        void retain_single_page_span(APtr ptr);
-        void release_single_page_span(APtr ptr);
-        void retain_page_spans(APtr beg, APtr end);
-        void release_page_spans(APtr beg, APtr end);
-        void help_map_intersecting_page_spans(std::function<void(size_t)> cb, APtr beg, APtr end);
-    public:
-        void trim_unused_pages(GcMiddleEnd* middle_end);
-    private:
-        void extract_page_span_from_object_free_list(PageSpan extract_page_span, GcBackEnd* back_end);
+    public:
+        // sweep rebuilds the free-list as every object in this size-class's page-spans that is not marked 
+        // in the back-end's PageMap, finalizing each that was allocated, and clears the marks. Page-spans 
+        // left with no live objects are returned to the back-end.
+        // Every front-end must have returned its objects first, cf `Gc::sweep`.
+        // Returns the number of bytes still live.
+        size_t sweep(GcBackEnd* back_end);
+    public:
+        // telemetry, cf `Gc::stats`:
+        size_t page_span_count();
+        size_t free_object_count();
     };
 
     ///
     // PageMap
     // - maps pointers to page-index
-    // - maps page-index to...
-    //   - which front-end currently holds this page (0..N-1), else middle-end (-1) or back-end (-2)
-    //   - current size-class (else 0)
-    //   - index into a span [of pages], else -ve value
-    // - allows us to query the page => size-class, span, and owner (back-end, middle-end, front-end(i)) of any pointer
+    // - maps page-index to the size-class of the page-span it is in, else 0 while held by the back-end.
+    // - holds the mark bitmap: one bit per ABlk, i.e. per possible object address, so that each page's 
+    //   bits are contiguous and marking never allocates. cf `GcMarker`
+    // - both tables are zeroed memory that the OS only backs once used, so mapping a large reservation 
+    //   costs little until the heap grows into it.
     //
 
-    #if 0       // not in use
-    using PageIndex = int64_t;
+    using PageIndex = size_t;
 
     struct PageInfo {
-        int32_t owner;
-        int16_t size_class;
-        int16_t span_index;
+        SizeClassIndex sci;
+        bool committed;         // cf `GcBackEnd::commit`
+        uint32_t idle_since;    // the back-end's collection epoch when this page was last returned to it
+        FreeSpanLink free_link; // if a free page-span starts at this page, cf `PageFreeList`
     };
 
     class PageMap {
-    private:
-        size_t m_beg_aptr_address;
-        size_t m_end_aptr_address;
-        std::vector<PageInfo> m_page_table;
     public:
-        explicit PageMap();
-        void init(GcBackEnd* back_end);
+        inline static constexpr size_t MARK_WORDS_PER_PAGE = PAGE_SIZE_IN_ABLKS / 64;
     private:
-        PageIndex page_index(APtr ptr) {
-            size_t ptr_address = reinterpret_cast<size_t>(ptr);
-            assert(m_beg_aptr_address <= ptr_address && ptr_address <= m_end_aptr_address);
-            size_t ablk_offset = ptr_address - m_beg_aptr_address;
-            size_t byte_offset = ablk_offset * sizeof(ABlk);
-            assert(byte_offset % PAGE_SIZE_IN_BYTES == 0);
-            size_t page_offset = byte_offset >> CONFIG_TCMALLOC_PAGE_SHIFT;
-            return page_offset;
+        APtr m_beg;
+        APtr m_end;
+        PageInfo* m_page_table = nullptr;
+        uint64_t* m_mark_words = nullptr;
+        size_t m_page_table_byte_count = 0;
+        size_t m_mark_words_byte_count = 0;
+    public:
+        PageMap() = default;
+        ~PageMap();
+        PageMap(PageMap const&) = delete;
+        PageMap& operator=(PageMap const&) = delete;
+        void init(APtr beg, size_t page_count);
+    public:
+        bool contains(APtr ptr) const {
+            return m_beg <= ptr && ptr < m_end;
+        }
+        PageIndex page_index(APtr ptr) const {
+            assert(contains(ptr));
+            return static_cast<size_t>(ptr - m_beg) / PAGE_SIZE_IN_ABLKS;
         }
-    public:
         PageInfo& page_info(PageIndex index) {
             return m_page_table[index];
         }
         PageInfo& page_info(APtr ptr) {
             return page_info(page_index(ptr));
         }
+        // assign records the size-class that `span` is carved into, else 0 when it is returned.
+        void assign(PageSpan span, SizeClassIndex sci);
+    
+    // Marking:
+    public:
+        // try_mark sets the mark bit of `ptr`, returning false iff it was already set.
+        bool try_mark(APtr ptr) {
+            size_t bit = static_cast<size_t>(ptr - m_beg);
+            uint64_t mask = uint64_t(1) << (bit % 64);
+            uint64_t& word = m_mark_words[bit / 64];
+            bool was_marked = (word & mask);
+            word |= mask;
+            return !was_marked;
+        }
+        bool is_marked(APtr ptr) const {
+            size_t bit = static_cast<size_t>(ptr - m_beg);
+            return (m_mark_words[bit / 64] >> (bit % 64)) & 1;
+        }
+        bool any_marked(PageSpan span) const;
+        void clear_marks(PageSpan span);
+    private:
+        uint64_t* mark_words(PageSpan span) { return m_mark_words + page_index(span.ptr) * MARK_WORDS_PER_PAGE; }
+        uint64_t const* mark_words(PageSpan span) const { return m_mark_words + page_index(span.ptr) * MARK_WORDS_PER_PAGE; }
     };
-    #endif
 
     ///
     // GC Back-end: pageheap: free-list of page-spans
     // - Subdivides a single contiguous region into the required number of
     //   page-spans lazily.
-    //   Single contiguous region is of fixed-size.
+    //   The region is either reserved by the back-end, or provided (and committed) by the caller.
+    //   A reserved region only exposes its initial size at first, then grows into the rest of the 
+    //   reservation as allocations demand.
     //   Allocations in this manner are prone to fragmentation, but at this
     //   size (page-size), this is rarely an issue.
+    // - commits the pages of a reserved region as they are first allocated, and decommits pages that 
+    //   stay free for `CONFIG_GC_RELEASE_IDLE_COLLECTIONS` collections, cf `release_idle_pages`.
     // - maintains page-map
     //
 
+    // PageHeapShard: an equal, contiguous sub-range of the region with its own free-list and lock, so 
+    // that middle-ends refilling different size-classes from different threads rarely contend.
+    // Page-spans never straddle shards: each is returned to the shard that holds its address.
+    struct PageHeapShard {
+        PageFreeList free_list;
+        size_t exposed_page_count;  // from the start of the shard's range: the rest is not yet in use
+    #if !GC_SINGLE_THREADED_MODE
+        std::mutex mutex;
+    #endif
+    };
+
     class GcBackEnd {
+    public:
+        inline static constexpr size_t MAX_PAGE_HEAP_SHARD_COUNT = 8;
+        // each shard must fit several of the largest page-spans of any size-class:
+        inline static constexpr size_t MIN_PAGE_HEAP_SHARD_PAGE_CAPACITY = 128;
     private:
         // pointer to and page-capacity of single contiguous region
         APtr m_single_contiguous_region_beg;
         APtr m_single_contiguous_region_end;
         size_t m_single_contiguous_region_page_capacity;
-        PageFreeList m_page_free_list;
-    #if !GC_SINGLE_THREADED_MODE
-        std::mutex m_mutex;
-    #endif
-        // PageMap m_page_map;
+        // the reservation backing the region, if reserved by the back-end: it is released on destruction.
+        APtr m_reservation = nullptr;
+        size_t m_reservation_byte_count = 0;
+        bool m_commit_on_use;
+        std::atomic<size_t> m_committed_page_count;
+        std::atomic<uint64_t> m_released_page_count;
+        std::atomic<uint32_t> m_collection_epoch;
+        PageHeapShard m_shards[MAX_PAGE_HEAP_SHARD_COUNT];
+        size_t m_shard_count;
+        size_t m_shard_page_capacity;
+        PageMap m_page_map;
     public:
         GcBackEnd() = default;
+        ~GcBackEnd();
     public:
+        // init uses a region provided by the caller: all of it is used at once, and none of it is 
+        // committed nor decommitted.
         void init(size_t single_contiguous_region_page_capacity, APtr single_contiguous_region);
+        // init_reserved reserves address space for `reserved_page_count` pages, and uses 
+        // `initial_page_count` of them at first.
+        void init_reserved(size_t initial_page_count, size_t reserved_page_count);
     public:
         std::optional<PageSpan> try_allocate_page_span(size_t page_count);
         void return_page_span(PageSpan page_span);
+        // release_idle_pages is called once per collection: it decommits free pages that have stayed free 
+        // for `CONFIG_GC_RELEASE_IDLE_COLLECTIONS` collections, returning how many were.
+        size_t release_idle_pages();
+    private:
+        void init_impl(APtr region, size_t initial_page_count, size_t reserved_page_count);
+        size_t shard_index(APtr ptr) const;
+        size_t home_shard_index() const;
+        APtr shard_beg(size_t shard_index) const;
+        size_t shard_page_capacity(size_t shard_index) const;
+        // try_grow_shard and commit expect the caller to hold the shard's mutex.
+        bool try_grow_shard(size_t shard_index, size_t page_count);
+        bool commit(PageSpan page_span);
     public:
         size_t total_page_count() { return m_single_contiguous_region_page_capacity; }
-        // PageMap& page_map() { return m_page_map; }
+        size_t committed_page_count() const { return m_committed_page_count.load(std::memory_order_relaxed); }
+        uint64_t released_page_count() const { return m_released_page_count.load(std::memory_order_relaxed); }
+        size_t exposed_page_count();
+        size_t free_page_count();
+        PageMap& page_map() { return m_page_map; }
         APtr total_pages_beg_address() { return m_single_contiguous_region_beg; }
         APtr total_pages_end_address() { return m_single_contiguous_region_end; }
     };
 
+    ///
+    // TransferCache: a bounded, lock-free queue of full `objects_per_move` chains of one size-class.
+    // - front-ends hand full chains back and forth through it without taking the size-class's lock; only
+    //   spilling past its capacity, or running it dry, reaches the CentralObjectAllocator.
+    // - a multi-producer multi-consumer ring (after Vyukov): each cell's sequence number says whether it is
+    //   ready to be pushed into or popped from for the current lap, so the chains themselves are never 
+    //   touched by another thread until popped.
+    //
+
+    class TransferCache {
+    public:
+        inline static constexpr size_t CAPACITY = 64;
+        static_assert((CAPACITY & (CAPACITY - 1)) == 0, "TransferCache::CAPACITY must be a power of two");
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            FreeObject* head;
+        };
+    private:
+        Cell m_cells[CAPACITY];
+        alignas(64) std::atomic<size_t> m_push_pos;
+        alignas(64) std::atomic<size_t> m_pop_pos;
+    public:
+        TransferCache() = default;
+        void init();
+    public:
+        // try_push returns false iff the cache is full.
+        bool try_push(FreeObject* head);
+        // try_pop returns nullptr iff the cache is empty.
+        FreeObject* try_pop();
+    };
+
+    ///
+    // LargeObjectSpace: objects too large for any size-class, cf `OVERSIZED_SCI`.
+    // - each gets a page-span of its own straight from the back-end, bypassing the transfer-caches.
+    // - spans are tracked apart from every size-class: the sweep finalizes each object whose mark bit is 
+    //   clear, and returns its span to the back-end whole.
+    // - a large object must fit within one page-heap shard, cf `GcBackEnd`.
+    //
+
+    class LargeObjectSpace {
+    private:
+        GcBackEnd* m_back_end;
+        std::vector<PageSpan> m_page_spans;     // unsorted
+    #if !GC_SINGLE_THREADED_MODE
+        std::mutex m_mutex;
+    #endif
+    public:
+        LargeObjectSpace() = default;
+        void init(GcBackEnd* back_end);
+    public:
+        std::optional<PageSpan> try_allocate(size_t byte_count);
+        void deallocate(APtr ptr);
+    public:
+        // sweep returns the number of bytes still live.
+        size_t sweep();
+    public:
+        // telemetry, cf `Gc::stats`:
+        size_t object_count();
+        size_t byte_count();
+    };
+
     ///
     // GC Middle-end: transfer-cache at PageSpan-level granularity
     // - maintains a pool of objects with a pool of backing PageSpans
-    // - maintains one lock per-size-class
+    // - passes full batches between front-ends through a lock-free TransferCache per-size-class
+    // - maintains one lock per-size-class for everything else
+    // - counts the bytes handed out to front-ends since the last sweep: past a threshold, a collection is
+    //   requested, cf `Gc::collect_requested`.
     //
 
+    struct MiddleEndCounters {
+        std::atomic<uint64_t> refill_count = 0;
+        std::atomic<uint64_t> refill_from_transfer_cache_count = 0;
+        std::atomic<uint64_t> return_count = 0;
+        std::atomic<uint64_t> return_to_transfer_cache_count = 0;
+        std::atomic<size_t> live_bytes = 0;   // as of the last sweep
+    };
+
     class GcMiddleEnd {
     private:
         CentralObjectAllocator m_central_object_allocators[kSizeClassesCount];
+        TransferCache m_transfer_caches[kSizeClassesCount];
+        LargeObjectSpace m_large_object_space;
+        MiddleEndCounters m_counters[kSizeClassesCount];
         GcBackEnd* m_back_end;
+        std::atomic<size_t> m_allocated_bytes;
+        size_t m_collect_threshold_bytes;
+        std::atomic<bool> m_collect_requested;
     public:
         GcMiddleEnd() = default;
     public:
         void init(GcBackEnd* backend);
     public:
-        std::optional<ObjectSpan> try_allocate_object_span(SizeClassIndex sci);
+        std::optional<ObjectBatch> try_allocate_object_batch(SizeClassIndex sci);
         void return_object_span(SizeClassIndex sci, ObjectSpan span);
+        void return_object_chain(SizeClassIndex sci, FreeObjectChain chain);
+        APtr try_allocate_large_object(size_t byte_count);
+        void return_large_object(APtr ptr);
     public:
         GcBackEnd* back_end() { return m_back_end; }
-    public:
-        void trim_unused_pages();
+        CentralObjectAllocator& central_object_allocator(SizeClassIndex sci) { return m_central_object_allocators[sci]; }
+        LargeObjectSpace& large_object_space() { return m_large_object_space; }
+        MiddleEndCounters const& counters(SizeClassIndex sci) const { return m_counters[sci]; }
+    public:
+        bool collect_requested() const { return m_collect_requested.load(std::memory_order_relaxed); }
+        std::atomic<bool> const* collect_requested_flag() const { return &m_collect_requested; }
+        void sweep();
+        void count_allocated_bytes(size_t byte_count);
+    private:
+        std::optional<ObjectBatch> help_allocate_object_batch(SizeClassIndex sci);
+        void help_return_object_chain(SizeClassIndex sci, FreeObjectChain chain);
     };
 
     ///
     // GC Front-end: pool of objects acquired from transfer-cache.
     //
 
+    // count_owned increments a counter that only its owner thread writes, but that others read, cf 
+    // `Gc::stats`: it is never contended, so no read-modify-write is needed.
+    inline void count_owned(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    struct FrontEndCounters {
+        std::atomic<uint64_t> allocated_count = 0;
+        std::atomic<uint64_t> freed_count = 0;
+    };
+
     class GcFrontEnd {
     private:
         FrontEndObjectAllocator m_sub_allocators[kSizeClassesCount];
+        FrontEndCounters m_counters[kSizeClassesCount];
         GcMiddleEnd* m_middle_end;
     public:
         GcFrontEnd() = default;
         void init(GcMiddleEnd* middle_end);
     public:
-        APtr allocate(SizeClassIndex sci);
-        void deallocate(APtr memory, SizeClassIndex sci);
+        APtr allocate(SizeClassIndex sci) {
+            count_owned(m_counters[sci].allocated_count);
+            APtr res = m_sub_allocators[sci].try_allocate_object();
+            return res ? res : allocate_slow_path(sci);
+        }
+        void deallocate(APtr memory, SizeClassIndex sci) {
+            count_owned(m_counters[sci].freed_count);
+            m_sub_allocators[sci].return_object(memory);
+            if (m_sub_allocators[sci].free_count() >= 2 * objects_per_move(sci)) {
+                deallocate_slow_path(sci);
+            }
+        }
+    public:
+        // large objects are never cached by the front-end, cf `LargeObjectSpace`.
+        APtr allocate_large(size_t byte_count);
+        void deallocate_large(APtr memory) { m_middle_end->return_large_object(memory); }
     public:
-        void sweep(MarkedSet& marked_set);
+        void return_all_to_middle_end();
+        GcMiddleEnd* middle_end() const { return m_middle_end; }
+        FrontEndCounters const& counters(SizeClassIndex sci) const { return m_counters[sci]; }
     private:
-        void try_return_free_list_node_to_middle_end(
-            SizeClassIndex fl_sci,
-            ObjectFreeList::Iterator fl_node_pred, ObjectFreeList::Iterator fl_node
-        );
+        APtr allocate_slow_path(SizeClassIndex sci);
+        void deallocate_slow_path(SizeClassIndex sci);
+    };
+
+    ///
+    // Nursery: the young generation of a front-end.
+    // - young objects are bump-allocated from a single stack, one size-class at a time, so promoting one 
+    //   only needs its header, cf `GcEvacuator`.
+    // - a nursery is never freed object by object: it is reset once a minor collection has promoted 
+    //   every young object still reachable.
+    //
+
+    class Nursery {
+    private:
+        RootStackAllocator m_stack;
+    public:
+        Nursery(): m_stack(CONFIG_GC_NURSERY_SIZE_BYTES) {}
+    public:
+        APtr try_allocate(SizeClassIndex sci) { 
+            return m_stack.try_allocate_bytes(kSizeClasses[sci].size); 
+        }
+        bool empty() const { return m_stack.occupied_byte_count() == 0; }
+        void reset() { m_stack.reset(); }
     };
 
 }   // namespace ss::gc
@@ -429,29 +686,186 @@ namespace ss::gc {
 
 namespace ss {
 
+    ///
+    // GcStats: a snapshot of a heap's allocator counters, cf `Gc::stats`.
+    // - allocations and frees are summed over every front-end of the heap, live or destroyed. Objects 
+    //   freed by the sweep are not counted as freed: they are reflected in `live_bytes`.
+    // - front-ends only cache objects, never page-spans: what they hold is the difference between the
+    //   objects moved to and from them, cf `refill_count` and `return_count`.
+    // - pauses are the VM's stop-the-world collections, cf `Gc::record_minor_collection`.
+    //
+
+    struct GcPauseHistogram {
+        // bucket `i` counts the pauses shorter than 2^i microseconds that no smaller bucket counts; the 
+        // last bucket counts all longer ones.
+        inline static constexpr size_t BUCKET_COUNT = 24;
+        uint64_t bucket_counts[BUCKET_COUNT] = {};
+        uint64_t count = 0;
+        std::chrono::nanoseconds total{0};
+        std::chrono::nanoseconds max{0};
+        void record(std::chrono::nanoseconds pause);
+    };
+
+    struct GcStats {
+        struct SizeClass {
+            size_t object_size = 0;
+            uint64_t allocated_count = 0;       // old objects, by front-ends
+            uint64_t freed_count = 0;           // explicitly, by front-ends
+            uint64_t refill_count = 0;          // batches moved from the middle-end to front-ends...
+            uint64_t refill_from_transfer_cache_count = 0;  // ...of which through the transfer-cache
+            uint64_t return_count = 0;          // chains moved back from front-ends...
+            uint64_t return_to_transfer_cache_count = 0;    // ...of which through the transfer-cache
+            size_t live_bytes = 0;              // as of the last sweep
+            size_t page_span_count = 0;         // held by the middle-end
+            size_t central_free_object_count = 0;
+        };
+        std::vector<SizeClass> size_classes;    // by SizeClassIndex: 0 is unused
+        uint64_t young_allocated_count = 0;
+        uint64_t promoted_count = 0;
+        uint64_t promoted_list_link_count = 0;  // pairs promoted as the cdr of another, cf `GcEvacuator`...
+        uint64_t adjacent_list_link_count = 0;  // ...of which copied just after it
+        size_t large_object_count = 0;
+        size_t large_object_bytes = 0;
+        size_t reserved_page_count = 0;
+        size_t exposed_page_count = 0;
+        size_t free_page_count = 0;             // held by the back-end
+        size_t committed_page_count = 0;
+        uint64_t released_page_count = 0;       // to the OS, in total
+        GcPauseHistogram minor_pauses;
+        GcPauseHistogram full_pauses;
+    public:
+        void print(std::ostream& out) const;
+    };
+
     class Gc {
+    public:
+        using HeapSampleHook = void(*)(void* ctx, BaseBoxedObject* obj, size_t byte_count);
     private:
         gc::GcBackEnd m_gc_back_end;
         gc::GcMiddleEnd m_gc_middle_end;
-    public:
+        std::atomic<bool> m_minor_collect_requested;
+        std::mutex m_nurseries_mutex;
+        std::vector<std::unique_ptr<gc::Nursery>> m_free_nurseries;
+        std::vector<std::unique_ptr<gc::Nursery>> m_retired_nurseries;    // released while still holding young objects
+        // telemetry: counters of destroyed front-ends, and pauses
+        gc::FrontEndCounters m_retired_counters[gc::kSizeClassesCount];
+        std::atomic<uint64_t> m_retired_young_allocated_count;
+        std::mutex m_pauses_mutex;
+        GcPauseHistogram m_minor_pauses;
+        GcPauseHistogram m_full_pauses;
+        uint64_t m_promoted_count;
+        uint64_t m_promoted_list_link_count;
+        uint64_t m_adjacent_list_link_count;
+        bool m_linearizes_lists;
+        // heap sampling: cf `enable_heap_sampling`
+        size_t m_heap_sample_period;
+        HeapSampleHook m_heap_sample_hook;
+        void* m_heap_sample_ctx;
+    public:
+        // this heap uses a region committed by the caller, which it never grows nor releases.
         explicit Gc(APtr single_contiguous_region, size_t single_contiguous_region_size);
+        // this heap reserves its own address space: `initial_size` to start with, growing up to `max_size` 
+        // (else `CONFIG_GC_HEAP_RESERVE_FACTOR` times `initial_size`), cf `GcBackEnd::init_reserved`.
+        explicit Gc(size_t initial_size_in_bytes, size_t max_size_in_bytes = 0);
     public:
         gc::GcBackEnd& back_end_impl() { return m_gc_back_end; }
         gc::GcMiddleEnd& middle_end_impl() { return m_gc_middle_end; }
+    
+    // Collection:
+    // The mark phase is run by the VM, which knows the roots, cf `GcMarker` and `VirtualMachine::collect`.
+    // This is a stop-the-world collector: no front-end of this heap may be used between marking and 
+    // the end of `sweep`.
+    public:
+        gc::PageMap& page_map() { return m_gc_back_end.page_map(); }
+        // collect_requested is true once a nursery is full, or once enough has been allocated since the last 
+        // sweep that a full collection is due: the VM polls this at safe-points.
+        bool collect_requested() const { return minor_collect_requested() || sweep_requested(); }
+        bool minor_collect_requested() const { return m_minor_collect_requested.load(std::memory_order_relaxed); }
+        bool sweep_requested() const { return m_gc_middle_end.collect_requested(); }
+        // the flags behind `collect_requested`, for generated code that polls them itself: cf `VJit`
+        std::atomic<bool> const* minor_collect_requested_flag() const { return &m_minor_collect_requested; }
+        std::atomic<bool> const* sweep_requested_flag() const { return m_gc_middle_end.collect_requested_flag(); }
+        // sweep frees every object in this heap that is not marked in `page_map`, and clears every mark.
+        // Every nursery must be empty, cf `reset_nurseries`.
+        void sweep();
+        // count_external_bytes counts memory outside this heap that only a full collection frees, e.g. code 
+        // kept by closures, towards the next one.
+        void count_external_bytes(size_t byte_count) { m_gc_middle_end.count_allocated_bytes(byte_count); }
+
+    // Minor collections:
+    // The VM promotes every young object reachable from its roots or from the remembered set, cf 
+    // `GcEvacuator` and `VirtualMachine::collect`, then resets the nurseries.
+    public:
+        // take_remembered_set removes the old objects of this heap from the remembered set, forgetting each.
+        std::vector<BaseBoxedObject*> take_remembered_set();
+        // reset_nurseries empties every nursery of this heap, so that young objects left behind are reused.
+        void reset_nurseries();
+        // remember adds an old object to the remembered set: it is shared by every heap, like the front-end
+        // registry, since a write barrier only has the objects at hand. cf `gc_write_barrier`
+        static void remember(BaseBoxedObject* obj);
+        // linearizes_lists is whether minor collections promote each list's spine into adjacent pairs, cf 
+        // `GcEvacuator` and `CONFIG_DISABLE_GC_LIST_LINEARIZATION`: it may only be set between collections.
+        bool linearizes_lists() const { return m_linearizes_lists; }
+        void set_linearizes_lists(bool linearizes_lists) { m_linearizes_lists = linearizes_lists; }
+    private:
+        friend class GcThreadFrontEnd;
+        void request_minor_collection() { m_minor_collect_requested.store(true, std::memory_order_relaxed); }
+        std::unique_ptr<gc::Nursery> acquire_nursery();
+        void release_nursery(std::unique_ptr<gc::Nursery> nursery);
+
+    // Telemetry:
+    public:
+        // stats may be called from any thread, at any time.
+        GcStats stats();
+        // record_minor_collection and record_full_collection are called by the VM after each pause, cf 
+        // `VirtualMachine::collect`.
+        void record_minor_collection(
+            std::chrono::nanoseconds pause, size_t promoted_count, 
+            size_t list_link_count, size_t adjacent_link_count
+        );
+        void record_full_collection(std::chrono::nanoseconds pause);
+    private:
+        void retire_counters(GcThreadFrontEnd const& tfe);
+
+    // Heap sampling:
+    // Allocations are sampled once every `period` bytes on average, at exponentially distributed intervals, as 
+    // TCMalloc samples: thus, an allocation of `n` bytes is sampled with probability `1 - exp(-n / period)`.
+    // Each sampled object is passed to the hook on the thread that allocated it, once constructed, cf 
+    // `GcThreadFrontEnd::finish_allocation`.
+    public:
+        // enable_heap_sampling must be called while no front-end of this heap allocates, e.g. before the VM 
+        // runs: a `period` of 0 disables sampling.
+        void enable_heap_sampling(size_t period, HeapSampleHook hook, void* ctx);
+        size_t heap_sample_period() const { return m_heap_sample_period; }
     };
 
+    // GcThreadFrontEnd: a front-end owned by a single thread of execution.
+    // - each is registered under a small ID, reused once it is destroyed.
+    // - on destruction, cached free objects are returned to the middle-end for other front-ends to reuse.
+    // - while its nursery is open, short-lived object kinds are allocated young, cf `try_allocate_young`.
+    //   The VM only opens it while an engine runs: objects made by the parser and compiler are old, so 
+    //   that code never refers to a young object.
     class GcThreadFrontEnd {
-    private:
-        inline static uint8_t s_tfid_counter = 0;
-        inline static std::vector<GcThreadFrontEnd*> s_all_table{256, nullptr};
+        friend class Gc;
     private:
         gc::GcFrontEnd m_impl;
-        uint8_t m_tfid;
-    public:
-        GcThreadFrontEnd(Gc* gc);
-    public:
-        uint8_t tfid();
-        inline static GcThreadFrontEnd* get_by_tfid(uint8_t tfid) { return s_all_table[tfid]; }
+        GcThreadFrontEndID m_tfid;
+        Gc* m_gc;
+        std::unique_ptr<gc::Nursery> m_nursery;     // acquired on first use
+        bool m_nursery_open;
+        std::atomic<uint64_t> m_young_allocated_count;
+        // heap sampling: cf `Gc::enable_heap_sampling`
+        ssize_t m_bytes_until_sample;
+        uint64_t m_sample_rng_state;
+    public:
+        explicit GcThreadFrontEnd(Gc* gc);
+        ~GcThreadFrontEnd();
+        GcThreadFrontEnd(GcThreadFrontEnd const&) = delete;
+        GcThreadFrontEnd& operator=(GcThreadFrontEnd const&) = delete;
+    public:
+        GcThreadFrontEndID tfid() const { return m_tfid; }
+        Gc* gc() const { return m_gc; }
+        static GcThreadFrontEnd* get_by_tfid(GcThreadFrontEndID tfid);
     public:
         APtr allocate_size_class(gc::SizeClassIndex sci) {
             return m_impl.allocate(sci);
@@ -459,15 +873,59 @@ namespace ss {
         void deallocate_size_class(APtr ptr, gc::SizeClassIndex sci) {
             m_impl.deallocate(ptr, sci);
         }
+        // allocate_large_object is for allocations above `gc::kMaxSize`, whose size-class is `OVERSIZED_SCI`.
+        APtr allocate_large_object(size_t byte_count) {
+            return m_impl.allocate_large(byte_count);
+        }
+        void deallocate_large_object(APtr ptr) {
+            m_impl.deallocate_large(ptr);
+        }
+    public:
+        // try_allocate_young returns nullptr when the nursery is closed, or full: in that case a minor 
+        // collection is requested, and the object must be allocated in the old space instead.
+        APtr try_allocate_young(gc::SizeClassIndex sci) {
+            if (!m_nursery_open) {
+                return nullptr;
+            }
+            APtr res = m_nursery->try_allocate(sci);
+            if (res) {
+                gc::count_owned(m_young_allocated_count);
+            } else {
+                m_gc->request_minor_collection();
+            }
+            return res;
+        }
+        bool nursery_open() const { return m_nursery_open; }
+        // set_nursery_open returns whether the nursery was open, so that nested engines can restore it.
+        bool set_nursery_open(bool open);
     public:
         APtr allocate_bytes(size_t byte_count) { 
-            return allocate_size_class(gc::sci(byte_count)); 
+            gc::SizeClassIndex sci = gc::sci(byte_count);
+            return sci ? allocate_size_class(sci) : allocate_large_object(byte_count); 
         }
         void deallocate_bytes(APtr ptr, size_t byte_count) { 
-            deallocate_size_class(ptr, gc::sci(byte_count)); 
+            gc::SizeClassIndex sci = gc::sci(byte_count);
+            if (sci) {
+                deallocate_size_class(ptr, sci);
+            } else {
+                deallocate_large_object(ptr);
+            }
         }
-    public:
-        void sweep(gc::MarkedSet& marked_set);
+    
+    // Heap sampling: cf `Gc::enable_heap_sampling`
+    // Objects are counted once constructed, rather than as they are allocated, so that a sample is reported
+    // with its kind: raw allocations (e.g. of benchmarks) and copies made by promotion are never counted.
+    public:
+        // finish_allocation must be called on each object of `byte_count` once its GC header is filled in.
+        void finish_allocation(BaseBoxedObject* obj, size_t byte_count) {
+            m_bytes_until_sample -= static_cast<ssize_t>(byte_count);
+            if (m_bytes_until_sample < 0) {
+                take_sample(obj, byte_count);
+            }
+        }
+    private:
+        void take_sample(BaseBoxedObject* obj, size_t byte_count);
+        void reset_sample_countdown();
     };
 
 }   // namespace ss
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <ostream>
+#include <cstdint>
+
+#include "ss-core/common.hh"
+#include "ss-core/object.hh"
+#include "ss-core/gc.hh"
+#include "ss-core/vcode.hh"
+
+///
+// VmHeapProfile: allocations sampled by the heap, attributed to the Scheme code making them, cf
+// `vm_enable_heap_profiler` and `Gc::enable_heap_sampling`.
+// - each sample is attributed to its site: the allocating expression and the body of the closure running it
+//   (or the top-level of a line), with the object's kind and size-class. Samples are aggregated by site.
+//   Objects made outside any engine (e.g. by the parser) are attributed to the run-time.
+// - each sample is weighted by the inverse of its probability of being sampled, so that the totals estimate
+//   every allocation, as TCMalloc's heap profiles do.
+// - sampled objects are followed until collected: one survives if it outlives the next collection of its
+//   generation, i.e. the next minor collection if young, else the next full one. Those not yet collected are
+//   'in use'.
+// - the profile is written in pprof's format (cf 'profile.proto', uncompressed), e.g.
+//  go tool pprof -sample_index=survived_space -top heap.pb
+//   each site is a location whose address is the expression's VmExpID, in the function of its instruction's
+//   kind inlined in that of its body: the kind and size of objects are labels, cf '-tagfocus'.
+//
+
+namespace ss {
+
+    class VmHeapProfile {
+    public:
+        inline static constexpr size_t DEFAULT_SAMPLE_PERIOD = 512 * 1024;
+        inline static constexpr VmExpID RUNTIME_BODY = -2;
+
+    private:
+        struct Site {
+            VmExpID exp;                // -1 if unknown
+            VmExpID body;               // cf `VmProfile::TOP_LEVEL_BODY`, `RUNTIME_BODY`
+            VmExpKind exp_kind;         // kept, since the expression's unit may be freed
+            ObjectKind obj_kind;
+            gc::SizeClassIndex sci;
+        };
+        struct SiteHash {
+            size_t operator() (Site const& site) const;
+        };
+        struct SiteEqual {
+            bool operator() (Site const& l, Site const& r) const;
+        };
+        // estimates: samples weighted by their probability, cf `sample_weight`
+        struct SiteStats {
+            double alloc_count = 0;
+            double alloc_bytes = 0;
+            double survived_count = 0;
+            double survived_bytes = 0;
+        };
+        struct LiveSample {
+            BaseBoxedObject* obj;
+            size_t site_index;
+            double weight;
+            size_t byte_count;
+            bool is_young;              // kept, since old objects may be freed before they are swept
+            bool is_resolved;           // whether it outlived a collection of its generation
+        };
+
+    private:
+        size_t m_period;
+        std::mutex m_mutex;
+        std::vector<Site> m_sites;
+        std::vector<SiteStats> m_site_stats;
+        UnstableHashMap<Site, size_t, SiteHash, SiteEqual> m_site_index;
+        std::vector<LiveSample> m_live_samples;
+        uint64_t m_sample_count;
+
+    public:
+        explicit VmHeapProfile(size_t period);
+        size_t period() const { return m_period; }
+
+    // Sampling: may be called on any OS thread.
+    public:
+        void record(BaseBoxedObject* obj, size_t byte_count, VmExpID exp, VmExpID body, VmExpKind exp_kind);
+    private:
+        double sample_weight(size_t byte_count) const;
+
+    // Collections: called while every engine is stopped.
+    public:
+        // sweep_young follows young samples, before the nurseries are reset: promoted ones survive.
+        void sweep_young();
+        // sweep follows old samples once marked, before `Gc::sweep`: marked ones survive.
+        void sweep(gc::PageMap& page_map);
+
+    // Reporting:
+    public:
+        uint64_t count_samples() const { return m_sample_count; }
+        size_t count_live_samples() const { return m_live_samples.size(); }
+        void write_pprof(std::ostream& out, VCode& code);
+    };
+
+}   // namespace ss
@@ -2,13 +2,14 @@
 
 #include <cstddef>
 #include <string>
+#include <string_view>
 
 namespace ss {
 
     using IntStr = size_t;
 
-    IntStr intern(std::string s);
-    std::string const& interned_string(IntStr int_str);
+    IntStr intern(std::string_view s);
+    std::string_view interned_string(IntStr int_str);
 
     struct IdCache {
         IntStr const quote;
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "ss-core/config.hh"
+#include "ss-core/common.hh"
+#include "ss-core/allocator.hh"
+#include "ss-core/object.hh"
+#include "ss-core/vcode.hh"
+#include "ss-core/bytecode.hh"
+
+///
+// VJit: a baseline JIT for the bytecode engine.
+// - the engine counts the calls of each closure body by itself: once one reaches `CONFIG_JIT_CALL_THRESHOLD`,
+//   its VmExps are translated to machine code by stitching together a template per instruction.
+// - while native code runs, the registers a/f/c/s are pinned to machine registers, cf `JitFrame`.
+// - only bodies that seldom exit are compiled: their self-calls (loops and self-recursion) stay in native
+//   code, as do returns to the body's own return points.
+// - native code never calls into C++: it 'exits' to the interpreter at each instruction it does not
+//   translate (e.g. other calls, closures, continuations, and platform procedures), and at each whose 
+//   fast path fails (e.g. arithmetic on non-fixnums): the interpreter then runs that instruction. Thus, 
+//   only the interpreter allocates, raises errors, or stops for a collection.
+// - a body is entered at its first instruction, and at the return point of each call it makes: the opcode
+//   words there are threaded to the engine's 'enter' handler, which looks up the entry by address.
+// - native code is kept with the unit of its body, and freed with it, cf `VJit::free_unit`.
+// - code is only generated for x86-64: elsewhere, `is_supported()` is false and every body is interpreted.
+//
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define VJIT_X86_64 (1)
+#else
+    #define VJIT_X86_64 (0)
+#endif
+
+namespace ss {
+
+    // JitFrame: the registers (and roots) native code is entered with, and leaves its registers in on exit.
+    struct JitFrame {
+        OBJECT a;
+        ssize_t f;
+        OBJECT c;
+        ssize_t s;
+        OBJECT* stack_items;                    // cf `VmStack`: pushes that would cross either bound exit
+        ssize_t stack_captured_height;
+        ssize_t stack_limit;
+        OBJECT* globals;
+        std::atomic<bool> const* minor_collect_requested;   // polled by self tail calls, cf `Gc::collect_requested`
+        std::atomic<bool> const* sweep_requested;
+    };
+
+    // JitCode returns the address of the word at which the interpreter resumes.
+    using JitCode = VmCodePtr (*)(JitFrame* frame);
+
+    struct JitEntry {
+        JitCode code;
+        VmExpKind kind;     // the kind of the instruction at the entry, run by the interpreter if it exits at once
+    };
+
+    class VJit {
+    private:
+        struct Code {
+            APtr mem;
+            size_t byte_count;
+        };
+        struct Unit {
+            std::vector<uint32_t> call_counts;      // indexed by `vmx_index`
+            std::vector<VmCodePtr> entry_pcs;
+            std::vector<Code> code;
+        };
+    private:
+        VCode* m_code;
+        VBytecode* m_bytecode;
+        std::vector<std::unique_ptr<Unit>> m_units;         // indexed by VCodeUnitID, null until counted
+        robin_hood::unordered_flat_map<VmCodePtr, JitEntry> m_entries;
+        size_t m_code_byte_count;
+        size_t m_compiled_body_count;
+        bool m_has_unthreaded_entries;
+
+    public:
+        VJit(VCode* code, VBytecode* bytecode);
+        ~VJit();
+        VJit(VJit const&) = delete;
+
+    public:
+        static constexpr bool is_supported() { return VJIT_X86_64; }
+
+    // Counting:
+    public:
+        // count_call counts a call of `body` by itself, returning true once it is hot enough to compile.
+        bool count_call(VmExpID body) {
+            VCodeUnitID unit = vmx_unit(body);
+            size_t index = vmx_index(body);
+            if (unit < m_units.size() && m_units[unit] && index < m_units[unit]->call_counts.size()) {
+                return ++m_units[unit]->call_counts[index] == CONFIG_JIT_CALL_THRESHOLD;
+            }
+            return count_first_call(body);
+        }
+        // defer_call restarts the count of `body`, e.g. when it cannot be compiled yet.
+        void defer_call(VmExpID body);
+    private:
+        bool count_first_call(VmExpID body);
+        Unit& counted_unit(VCodeUnitID unit);
+
+    // Compilation:
+    public:
+        // compile translates `body` (which must be lowered), and registers an entry for its first instruction
+        // and each return point: with `enter_handler`, their opcode words are threaded to it.
+        // Returns false if it is not worth translating, e.g. it never calls itself, in which case `body` is 
+        // never counted again.
+        bool compile(VmExpID body, void* enter_handler);
+        // find_entry returns the entry at `pc`, or nullptr if there is none.
+        JitEntry const* find_entry(VmCodePtr pc) const {
+            auto it = m_entries.find(pc);
+            return (it != m_entries.end()) ? &it->second : nullptr;
+        }
+        // install registers `code`, built elsewhere (e.g. ahead of time, cf `aot.hh`), as the entry at the word
+        // of `x`: it is entered once the engine next threads the entries.
+        void install(VmExpID x, JitCode code);
+        // thread_entries threads every entry to `enter_handler` again, e.g. once the engine re-threaded its units.
+        void thread_entries(void* enter_handler);
+        bool has_unthreaded_entries() const { return m_has_unthreaded_entries; }
+        // free_unit drops the native code and entries of `unit`: cf `VBytecode::free_unit`
+        void free_unit(VCodeUnitID unit);
+
+    // Properties:
+    public:
+        size_t code_byte_count() const { return m_code_byte_count; }
+        size_t compiled_body_count() const { return m_compiled_body_count; }
+    };
+
+}   // namespace ss
@@ -13,10 +13,18 @@
 //     loader entry-point, named `init.scm`
 //   - Upon library pre-compilation, all libraries and sub-packages are compiled into byte-code.
 // - each library is a directory containing a `main.scm` file
+// - the installed libraries are listed in an index file in the snail-root, so that starting up does not walk
+//   the `lib` directory: cf `CentralLibraryRepository`.
+// - installing a library precompiles it and its sub-libraries, in parallel where their imports allow:
+//   cf `BaseLibraryContainer::install`.
+// - 'ssi -install <dir>' installs a library, and 'ssi -precompile-libs' precompiles every library installed that
+//   has no up-to-date '.ssc'.
 
 #pragma once
 
 #include <string>
+#include <vector>
+#include <memory>
 #include <optional>
 #include <filesystem>
 #include "ss-core/object.hh"
@@ -30,22 +38,44 @@
 namespace ss {
 
     class BaseLibrary;
+    class CentralLibraryRepository;
 
     class BaseLibraryContainer {
     protected:
-        UnstableHashMap<size_t, BaseLibrary*> m_index;
+        UnstableHashMap<size_t, std::unique_ptr<BaseLibrary>> m_index;
     public:
         BaseLibraryContainer() = default;
+        virtual ~BaseLibraryContainer();
     public:
+        // discover indexes the library in the directory at `dirent_path`, replacing any with its key, then stamps
+        // it and discovers each of its sub-libraries, recursively.
         virtual OBJECT discover(std::filesystem::path dirent_path) = 0;
-        void install(std::filesystem::path src_path, OBJECT dst_key);
+        // install copies the library at `src_path` here, then precompiles it, its sub-libraries, and any library
+        // they import that has no up-to-date '.ssc', cf `precompile_libraries`.
+        // Returns whether each of its libraries was precompiled.
+        bool install(std::filesystem::path src_path, OBJECT dst_key);
+        // precompile precompiles each library here, and each of their sub-libraries, cf `install`: those whose
+        // artifact is up to date with their `main.scm` are kept as they are.
+        bool precompile(size_t worker_count);
         void uninstall(OBJECT key);
-        BaseLibrary const* lookup(OBJECT key) const;
+        // lookup returns the library with `key`, validating it against its directory the first time, or nullptr
+        // if it is not installed.
+        BaseLibrary const* lookup(OBJECT key);
+        // child returns the library with `key` as last indexed, or nullptr: unlike `lookup`, it is not validated.
+        BaseLibrary* child(OBJECT key) const;
+        // adopt adds a library, e.g. one loaded from the index: it must be this container's child.
+        void adopt(std::unique_ptr<BaseLibrary> library);
+        std::vector<BaseLibrary*> children() const;
         void uninstall_self();
     public:
         static OBJECT extract_key_from_path(std::filesystem::path path);
     public:
+        // abspath is the directory containing this container's libraries.
         virtual std::string abspath() const = 0;
+        // repository is the repository this container is (in), if any.
+        virtual CentralLibraryRepository* repository() = 0;
+        // on_index_changed is called once a library is installed, uninstalled, or found to have changed.
+        virtual void on_index_changed() {}
     };
 
 }
@@ -58,7 +88,12 @@ namespace ss {
 
     /// The CentralLibraryRepository manages all foreign libraries in a
     /// flat structure.
-    /// It manages the `libs` subdirectory of the snail-root.
+    /// It manages the `lib` subdirectory of the snail-root.
+    /// The libraries it holds are listed in the snail-root's `lib.index` file rather than found by walking `lib`:
+    /// - 'install' and 'uninstall' rewrite the index, which maps each library's relpath to the mtime and hash of
+    ///   its `main.scm`, and to its precompiled `main.ssc` if it has one.
+    /// - each library is only checked against its directory on its first lookup, cf `BaseLibrary::validate`.
+    /// - the `lib` directory is only walked if the index is missing or unreadable, or if a rescan is requested.
     class CentralLibraryRepository: public BaseLibraryContainer {
     private:
         std::string m_abspath;
@@ -66,16 +101,30 @@ namespace ss {
     private:
         inline static CentralLibraryRepository* s_singleton = nullptr;
     public:
-        static bool ensure_init(std::string snail_scheme_root_path);
+        static bool ensure_init(std::string snail_scheme_root_path, bool rescan_index = false);
+        // instance is the repository set up by `ensure_init`, or nullptr before.
+        static CentralLibraryRepository* instance() { return s_singleton; }
+        // try_init_instance sets up this repository at a snail-root, e.g. for one other than the singleton's.
+        bool try_init_instance(std::string snail_scheme_root_path, bool rescan_index);
     private:
-        bool try_init_instance(std::string snail_scheme_root_path);
         bool try_init_env(std::string snail_scheme_root_path);
-        bool try_init_index();
+        bool try_init_index(bool rescan_index);
+        bool try_load_index();
+        bool save_index() const;
     public:
         OBJECT discover(std::filesystem::path path) override;
+        // rescan rebuilds the index from the `lib` directory's contents.
+        void rescan();
+        // find returns the library a library name refers to, e.g. '(foo bar)' for sub-library 'bar' of root
+        // library 'foo', or nullptr if it is not installed.
+        BaseLibrary* find(OBJECT library_name) const;
+        CentralLibraryRepository* repository() override { return this; }
+        void on_index_changed() override;
     public:
         void abspath(std::string v) { m_abspath = std::move(v); }
-        std::string abspath() const override { return m_abspath; }
+        std::string root_abspath() const { return m_abspath; }
+        std::string index_abspath() const;
+        std::string abspath() const override;
     };
 
 }
@@ -94,11 +143,25 @@ namespace ss {
     // E.g.
     // (scheme base v1.0.0) => /scheme/base/v1.0.0/main.scm
     class BaseLibrary: public BaseLibraryContainer {
+    public:
+        // Stamp: what the index records about a library's `main.scm`, to tell whether it changed.
+        // - `source_mtime` is `NO_SOURCE_MTIME` if there is no `main.scm`, in which case `source_hash` is 0.
+        // - `source_hash` is the `vcode_cache_key` of `main.scm`, i.e. the key its `.ssc` must match.
+        // - `artifact_path` is the precompiled `main.ssc`, or empty if there is none that is up to date.
+        struct Stamp {
+            static constexpr int64_t NO_SOURCE_MTIME = INT64_MIN;
+            int64_t source_mtime = NO_SOURCE_MTIME;
+            uint64_t source_hash = 0;
+            std::string artifact_path;
+        };
+        enum class Validation { Unchanged, Changed, Missing };
     protected:
         std::string m_relpath;
         OBJECT m_key;
         BaseLibrary* m_opt_parent;
         OBJECT m_wb_ast;
+        Stamp m_stamp;
+        bool m_is_validated;
     protected:
         BaseLibrary(std::string relpath, OBJECT key, BaseLibrary* opt_parent);
     public:
@@ -107,10 +170,42 @@ namespace ss {
         OBJECT wb_ast() const { return m_wb_ast; }
     public:
         std::string relpath() const { return m_relpath; };
+        OBJECT key() const { return m_key; }
+        Stamp const& stamp() const { return m_stamp; }
+        std::string source_abspath() const { return abspath() + "/main.scm"; }
+    public:
+        // stamp sets the recorded stamp, e.g. when loaded from the index: it is validated on first lookup.
+        void stamp(Stamp stamp);
+        // restamp records the current state of `main.scm`, and whether `main.ssc` is up to date with it.
+        void restamp();
+        // validate checks the recorded stamp against the library's directory, once: `main.scm` is only read
+        // again if its mtime differs, and then its precompiled artifact is kept only if it is still up to date.
+        Validation validate();
     public:
         OBJECT discover(std::filesystem::path path) override;
+        // discover_children discovers each sub-library in this library's directory.
+        void discover_children();
+        BaseLibrary* opt_parent() const { return m_opt_parent; }
+        void on_index_changed() override;
     };
 
+    // precompile_libraries compiles the `main.scm` of each library in `libraries` to a `main.ssc` beside it, and
+    // restamps each, whose artifact is then that file: cf `vcode-cache.hh`.
+    // - each library's imports are found first: each must be installed, and is compiled too unless it has an
+    //   up-to-date artifact. Names of libraries that are not installed, e.g. '(scheme base)', are skipped.
+    // - each library is compiled on a fresh VM once all the libraries it imports are, after loading their 
+    //   artifacts: libraries that do not depend on each other are compiled in parallel, on up to 
+    //   `worker_count` threads.
+    // - a library that fails to compile, or that imports one that does, or that is in an import cycle, is
+    //   reported, and left without an artifact.
+    // - `opt_build_order` lists each library compiled, in the order each finished.
+    // Returns whether every library was compiled.
+    bool precompile_libraries(
+        std::vector<BaseLibrary*> const& libraries, 
+        size_t worker_count, 
+        std::vector<BaseLibrary*>* opt_build_order = nullptr
+    );
+
     // RootLibrary is installed into a repository.
     // This string cannot be `scheme` or `srfi`
     class RootLibrary: public BaseLibrary {
@@ -123,6 +218,7 @@ namespace ss {
         {}
     public:
         std::string abspath() const override { return m_clr->abspath() + "/" + relpath(); }
+        CentralLibraryRepository* repository() override { return m_clr; }
     };
 
     // SubLibrary is a library contained within a RootLibrary.
@@ -133,6 +229,7 @@ namespace ss {
         {}
     public:
         std::string abspath() const override { return m_opt_parent->abspath() + "/" + relpath(); }
+        CentralLibraryRepository* repository() override { return m_opt_parent->repository(); }
     };
 
 }
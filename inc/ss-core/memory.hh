@@ -10,6 +10,31 @@
 
 namespace ss {
 
+    ///
+    // OS virtual memory: address space is reserved up front, then pages of it are committed as they are 
+    // used, and decommitted once idle, so that resident memory tracks what is in use.
+    // - addresses and sizes must be multiples of `os_page_size`.
+    //
+
+    size_t os_page_size();
+    // os_reserve_memory returns nullptr on failure: reserved memory may not be accessed until committed.
+    APtr os_reserve_memory(size_t byte_count);
+    bool os_commit_memory(APtr ptr, size_t byte_count);
+    // os_decommit_memory returns the pages to the OS: once committed again, they read as zero.
+    void os_decommit_memory(APtr ptr, size_t byte_count);
+    void os_release_memory(APtr ptr, size_t byte_count);
+    // os_allocate_zeroed_memory reserves and commits at once: the OS only backs pages with memory once 
+    // they are touched. Returns nullptr on failure, cf `os_release_memory`.
+    APtr os_allocate_zeroed_memory(size_t byte_count);
+    // os_map_file maps a whole file read-only, returning nullptr on failure, e.g. if it does not exist or is
+    // empty, cf `os_unmap_file`.
+    APtr os_map_file(char const* path, size_t* out_byte_count);
+    void os_unmap_file(APtr ptr, size_t byte_count);
+    // os_allocate_code_memory returns writable memory for machine code, or nullptr on failure: once written,
+    // os_seal_code_memory makes it executable (and read-only), cf `os_release_memory`.
+    APtr os_allocate_code_memory(size_t byte_count);
+    bool os_seal_code_memory(APtr ptr, size_t byte_count);
+
     ///
     // StackAllocator: root of Reactor allocators
     //
@@ -33,26 +58,34 @@ namespace ss {
         size_t remaining_byte_count() const {
             auto capacity = capacity_byte_count();
             auto occupied = occupied_byte_count();
-            assert(occupied < capacity);
+            assert(occupied <= capacity);
             return capacity - occupied;
         }
         APtr allocate_bytes(size_t byte_count) { 
+            APtr res = try_allocate_bytes(byte_count);
+            if (!res) {
+                throw std::runtime_error("Stack overflow");
+            }
+            return res;
+        }
+        // try_allocate_bytes returns nullptr rather than throwing once the stack is full.
+        APtr try_allocate_bytes(size_t byte_count) {
             // Rounding allocation up to the next aligned address:
             byte_count = (
-                (byte_count % sizeof(APtr)) == 0 ?
+                (byte_count % sizeof(ABlk)) == 0 ?
                 byte_count :
-                ((byte_count / sizeof(APtr)) + 1) * sizeof(APtr)
+                ((byte_count / sizeof(ABlk)) + 1) * sizeof(ABlk)
             );
 
             // Allocating: if we only perform aligned allocations, then all
             // returned pointers are aligned by default.
             if (byte_count <= remaining_byte_count()) {
                 auto offset = m_occupied_bytes;
-                auto res = m_mem + offset;
+                auto res = m_mem + offset / sizeof(ABlk);
                 m_occupied_bytes += byte_count;
                 return res;
             } else {
-                throw std::runtime_error("Stack overflow");
+                return nullptr;
             }
         }
 
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "ss-core/object.hh"
+
+///
+// Numeric vectors: the kernels behind the bulk procedures on `NumVectorObject`s, cf SRFI-4.
+// - kernels take raw element pointers, so that owning vectors and views share them.
+// - f64 and f32 kernels run 16 bytes at a time with SSE2 or NEON where available, cf config.hh; s64 and u8
+//   kernels are plain loops, left to the compiler to vectorize.
+// - integer arithmetic wraps around, and integer reductions accumulate in `int64_t`.
+// - SIMD reductions accumulate each lane separately, so floating-point sums may differ in their last bits
+//   from a left-to-right sum.
+//
+
+namespace ss {
+
+    class VirtualMachine;
+
+    // NumVectorAcc: the type `dot` and `sum` accumulate `T` in.
+    template <typename T>
+    using NumVectorAcc = std::conditional_t<std::is_floating_point_v<T>, T, int64_t>;
+
+    // NumVectorKernels: elementwise operations write `n` elements of `dst`, which may alias an operand.
+    template <typename T>
+    struct NumVectorKernels {
+        static void add(T* dst, T const* a, T const* b, size_t n);
+        static void mul(T* dst, T const* a, T const* b, size_t n);
+        static void scale(T* dst, T const* a, T k, size_t n);
+        static void fill(T* dst, T v, size_t n);
+        static NumVectorAcc<T> dot(T const* a, T const* b, size_t n);
+        static NumVectorAcc<T> sum(T const* a, size_t n);
+        // min and max require `n > 0`.
+        static T min(T const* a, size_t n);
+        static T max(T const* a, size_t n);
+    };
+    extern template struct NumVectorKernels<double>;
+    extern template struct NumVectorKernels<float>;
+    extern template struct NumVectorKernels<int64_t>;
+    extern template struct NumVectorKernels<uint8_t>;
+
+    // num_vector_item returns element `i` of `v` as a Scheme number, like 'f64vector-ref' (say): `proc_name` names
+    // the error raised if it does not fit in one.
+    OBJECT num_vector_item(GcThreadFrontEnd* gc_tfe, char const* proc_name, NumVectorObject* v, size_t i);
+
+    // bind_standard_num_vector_procedures binds, for each of 'f64', 'f32', 's64', and 'u8':
+    // - 'make-f64vector', 'f64vector', 'f64vector?', 'f64vector-length', 'f64vector-ref', 'f64vector-set!'
+    // and, for numeric vectors of any one element type:
+    // - 'numvec-add!', 'numvec-mul!', 'numvec-scale!', 'numvec-fill!', 'numvec-copy!'
+    // - 'numvec-dot', 'numvec-sum', 'numvec-min', 'numvec-max'
+    // - 'numvec-slice', which returns a view sharing the vector's elements.
+    void bind_standard_num_vector_procedures(VirtualMachine* vm);
+
+}   // namespace ss
@@ -18,11 +18,20 @@
 #include <cstddef>
 #include <cstdint>
 #include <vector>
+#include <algorithm>
 #include <ios>
+#include <atomic>
+#include <bit>
 #include <cassert>
 #include <cstdint>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <optional>
 
+#include "ss-core/config.hh"
 #include "ss-core/common.hh"
+#include "ss-core/smt.hh"
 #include "ss-core/file-loc.hh"
 #include "ss-core/intern.hh"
 #include "ss-core/feedback.hh"
@@ -46,20 +55,57 @@ namespace ss {
         String,
         Pair,
         Vector,
-        Syntax
+        NumVector,
+        InputPort,
+        HashTable,
+        Channel,
+        Syntax,
+        Closure,
+        StackSegment
+    };
+
+    // NumVectorType: the element type of a `NumVectorObject`
+    enum class NumVectorType: uint8_t {
+        F64, F32, S64, U8
+    };
+
+    // HashTableEquivalence: how a `HashTableObject` compares its keys, i.e. by 'eq?', 'eqv?', or 'equal?'
+    enum class HashTableEquivalence: uint8_t {
+        Eq, Eqv, Equal
+    };
+
+    // ChannelKind: whether a `ChannelObject` has a single sending VThread, or many
+    enum class ChannelKind: uint8_t {
+        Spsc, Mpsc
     };
 
     class BaseBoxedObject;
+    class StringObject;
     class PairObject;
     class VectorObject;
+    class NumVectorObject;
+    class InputPortObject;
+    class HashTableObject;
+    class ChannelObject;
     class SyntaxObject;
+    class ClosureObject;
+    class StackSegmentObject;
     class ArrayObject;
+    class VThread;
 
     class OBJECT {
         // NOTE: 'nullptr' <=> 'null' for interop with C++
     public:
         inline static size_t const PTR_TAG = 0b0;
         inline static size_t const FIXNUM_TAG = 0b1;
+    #if CONFIG_IMMEDIATE_FLOAT64
+        inline static size_t const FIXNUM_TAG_BITS = 2;
+        inline static size_t const FLONUM_TAG = 0b11;
+        inline static uint64_t const FLONUM_MIN_EXPONENT = 1023 - 256;   // exclusive, biased
+        inline static uint64_t const FLONUM_EXPONENT_OFFSET = FLONUM_MIN_EXPONENT << 53;
+    #else
+        inline static size_t const FIXNUM_TAG_BITS = 1;
+    #endif
         inline static size_t const INTSTR_TAG = 0b10;
         inline static size_t const HALFWORD_TAG = 0b100;
         inline static size_t const FL32_TAG  = (0b000 << 3) | HALFWORD_TAG;
@@ -77,8 +123,12 @@ namespace ss {
             BaseBoxedObject* ptr;
             struct { size_t tag: 3; size_t word_offset: 61; } ptr_unwrapped;
             
-            // signed fixnum: ends in '1 << 0 = 0b1'
-            struct { size_t tag: 1; int64_t val: 63; } signed_fixnum;
+            // signed fixnum: ends in '1 << 0 = 0b1', or in '0b01' if flonums are immediate
+            struct { size_t tag: FIXNUM_TAG_BITS; int64_t val: 64 - FIXNUM_TAG_BITS; } signed_fixnum;
+        #if CONFIG_IMMEDIATE_FLOAT64
+            // immediate flonum: ends in '0b11', cf `make_float64`
+            struct { size_t tag: 2; uint64_t bits: 62; } flonum;
+        #endif
             // interned symbol: ends in '1 << 1 = 0b10'
             struct { size_t tag: 2; int64_t val: 62; } interned_symbol;
             
@@ -160,18 +210,47 @@ namespace ss {
     public: // boxed objects
         // static OBJECT make_port(std::string file_path, std::ios_base::openmode mode);
         static OBJECT make_ptr(BaseBoxedObject* obj);
-        static OBJECT make_float64(GcThreadFrontEnd* gc_tfe, double f64);
+        // make_float64 stores `f64` in the OBJECT if it can, else boxes it, cf `CONFIG_IMMEDIATE_FLOAT64`.
+        inline static OBJECT make_float64(GcThreadFrontEnd* gc_tfe, double f64);
+    private:
+        static OBJECT make_boxed_float64(GcThreadFrontEnd* gc_tfe, double f64);
+    public:
         static OBJECT make_box(GcThreadFrontEnd* gc_tfe, OBJECT stored);
         static OBJECT make_pair(GcThreadFrontEnd* gc_tfe, OBJECT head, OBJECT tail);
+        // make_string copies `mv_bytes` into the new string, then frees them iff `collect_bytes`.
         static OBJECT make_string(GcThreadFrontEnd* gc_tfe, size_t byte_count, char* mv_bytes, bool collect_bytes);
-        static OBJECT make_vector(GcThreadFrontEnd* gc_tfe, std::vector<OBJECT> raw);
-        static OBJECT make_syntax(GcThreadFrontEnd* gc_tfe, OBJECT data, FLoc loc);
+        // make_string_slice returns a string referring to `byte_count` bytes at `bytes`, which `base` (a string, or
+        // an input port) keeps alive, cf `StringObject`.
+        static OBJECT make_string_slice(GcThreadFrontEnd* gc_tfe, OBJECT base, char const* bytes, size_t byte_count);
+        // make_string returns a string of `byte_count` NUL bytes.
+        static OBJECT make_string(GcThreadFrontEnd* gc_tfe, size_t byte_count);
+        static OBJECT make_vector(GcThreadFrontEnd* gc_tfe, std::vector<OBJECT> const& items);
+        static OBJECT make_vector(GcThreadFrontEnd* gc_tfe, size_t count, size_t capacity, OBJECT fill = OBJECT::null);
+        // make_num_vector returns a vector of `count` zeroes; make_num_vector_view one referring to `count` of 
+        // `base`'s elements from `start`.
+        static OBJECT make_num_vector(GcThreadFrontEnd* gc_tfe, NumVectorType type, size_t count);
+        static OBJECT make_num_vector_view(GcThreadFrontEnd* gc_tfe, OBJECT base, size_t start, size_t count);
+        // make_input_port returns a port reading a mapped file, or a file descriptor, cf `open_input_file`.
+        static OBJECT make_input_port(GcThreadFrontEnd* gc_tfe, IntStr path, char const* mapped_bytes, size_t mapped_count);
+        static OBJECT make_input_port(GcThreadFrontEnd* gc_tfe, IntStr path, int fd);
+        // make_hash_table returns an empty table with room for `capacity` entries before it grows.
+        static OBJECT make_hash_table(GcThreadFrontEnd* gc_tfe, HashTableEquivalence equivalence, size_t capacity = 0);
+        // make_channel returns an empty channel with room for `capacity` messages, rounded up to a power of 2.
+        static OBJECT make_channel(GcThreadFrontEnd* gc_tfe, ChannelKind channel_kind, size_t capacity);
+        static OBJECT make_syntax(GcThreadFrontEnd* gc_tfe, OBJECT data, FLocID loc, bool is_datum = false);
+        static OBJECT make_closure(GcThreadFrontEnd* gc_tfe, ssize_t body, size_t free_var_count);
+        static OBJECT make_stack_segment(GcThreadFrontEnd* gc_tfe, OBJECT below, size_t base, size_t count, OBJECT const* items);
     public:
         bool is_null() const { return m_data.raw == 0; }
         bool is_ptr() const { return m_data.ptr_unwrapped.tag == PTR_TAG && !is_null(); }
         bool is_integer() const { return m_data.signed_fixnum.tag == FIXNUM_TAG; }
         bool is_symbol() const { return m_data.interned_symbol.tag == INTSTR_TAG; }
         bool is_float32() const { return m_data.f32.tag == FL32_TAG; }
+    #if CONFIG_IMMEDIATE_FLOAT64
+        bool is_immediate_float64() const { return m_data.flonum.tag == FLONUM_TAG; }
+    #else
+        bool is_immediate_float64() const { return false; }
+    #endif
         bool is_uchar() const { return m_data.rune.tag == RUNE_TAG; }
         bool is_boolean() const { return m_data.boolean.tag == BOOL_TAG; }
         bool is_boolean(bool v) const { return is_boolean() && as_raw() == (v ? s_boolean_t.as_raw() : s_boolean_f.as_raw()); }
@@ -184,6 +263,10 @@ namespace ss {
         inline bool is_closure() const;
         inline bool is_string() const;
         inline bool is_vector() const;
+        inline bool is_num_vector() const;
+        inline bool is_input_port() const;
+        inline bool is_hash_table() const;
+        inline bool is_channel() const;
         inline bool is_syntax() const;
         inline bool is_box() const;     // beware: different than 'IsBoxedObject'
     public:
@@ -203,7 +286,14 @@ namespace ss {
     public:
         inline PairObject* as_pair_p() const;
         inline VectorObject* as_vector_p() const;
+        inline NumVectorObject* as_num_vector_p() const;
+        inline StringObject* as_string_p() const;
+        inline InputPortObject* as_input_port_p() const;
+        inline HashTableObject* as_hash_table_p() const;
+        inline ChannelObject* as_channel_p() const;
         inline SyntaxObject* as_syntax_p() const;
+        inline ClosureObject* as_closure_p() const;
+        inline StackSegmentObject* as_stack_segment_p() const;
     public:
         Data64LittleEndian raw_data() const { return m_data; }
     public:
@@ -213,10 +303,18 @@ namespace ss {
     class BaseBoxedObject {
         friend ObjectKind obj_kind(OBJECT obj);
 
+    private:
+        enum GcFlags: uint8_t {
+            GC_YOUNG = 0x1,         // in a nursery, cf `GcThreadFrontEnd::try_allocate_young`
+            GC_FORWARDED = 0x2,     // young, and already promoted: cf `gc_forwarded`
+            GC_REMEMBERED = 0x4     // old, and in the remembered set: cf `gc_write_barrier`
+        };
+
     private:
         gc::SizeClassIndex m_sci;
-        uint8_t m_gc_tfid;
+        GcThreadFrontEndID m_gc_tfid;
         ObjectKind m_kind;
+        uint8_t m_gc_flags;
         
     protected:
         explicit BaseBoxedObject(ObjectKind kind);
@@ -233,6 +331,48 @@ namespace ss {
 
     public:
         [[nodiscard]] ObjectKind kind();
+        // kind_offset is the byte offset of the kind within each object, for generated code: cf `VJit`
+        static size_t kind_offset();
+
+    // GC header: cf `GcMarker`, `GcEvacuator` and `Gc::sweep`
+    public:
+        // init_gc_header must be called on each object allocated with `new (gc_tfe, sci)` (or in a nursery), 
+        // once constructed: then `GcThreadFrontEnd::finish_allocation`, which samples it.
+        void init_gc_header(gc::SizeClassIndex sci, GcThreadFrontEndID gc_tfid, bool young = false) { 
+            m_sci = sci; 
+            m_gc_tfid = gc_tfid; 
+            m_gc_flags = young ? GC_YOUNG : 0;
+        }
+        [[nodiscard]] gc::SizeClassIndex gc_sci() const { return m_sci; }
+        [[nodiscard]] bool gc_young() const { return m_gc_flags & GC_YOUNG; }
+        // gc_finalize destroys an unreachable object in-place, before its memory is reused.
+        void gc_finalize() { this->~BaseBoxedObject(); }
+    
+    // Minor collections: cf `GcEvacuator`
+    public:
+        // a promoted young object stores the address of its copy in place of its first field: every 
+        // young object kind has at least one.
+        [[nodiscard]] BaseBoxedObject* gc_forwarded() const { 
+            return (m_gc_flags & GC_FORWARDED) ? *reinterpret_cast<BaseBoxedObject* const*>(this + 1) : nullptr; 
+        }
+        void gc_forward(BaseBoxedObject* copy) {
+            m_gc_flags |= GC_FORWARDED;
+            *reinterpret_cast<BaseBoxedObject**>(this + 1) = copy;
+        }
+        // gc_remember adds this old object to the remembered set, once per minor collection.
+        // Mutators may race to remember the same object, so the flag is set atomically.
+        void gc_remember() {
+            std::atomic_ref<uint8_t> flags{m_gc_flags};
+            if (!(flags.load(std::memory_order_relaxed) & GC_REMEMBERED)) {
+                if (!(flags.fetch_or(GC_REMEMBERED, std::memory_order_relaxed) & GC_REMEMBERED)) {
+                    remember_slow_path();
+                }
+            }
+        }
+        // gc_forget clears the flag once the remembered set has been scanned.
+        void gc_forget() { m_gc_flags &= ~GC_REMEMBERED; }
+    private:
+        void remember_slow_path();
     };
     static_assert(sizeof(OBJECT) == 8);
     static_assert(sizeof(OBJECT) == sizeof(void*));
@@ -249,6 +389,8 @@ namespace ss {
 
     public:
         OBJECT& boxed() { return m_boxed; }
+        inline void set_boxed(OBJECT o);
+        static size_t boxed_offset();
     };
 
     class Float64Object: public BaseBoxedObject {
@@ -263,30 +405,51 @@ namespace ss {
         double value() const { return m_value; }
     };
 
+    // StringObject: `count` bytes, either laid out inline and followed by a NUL terminator, or a slice.
+    // - a slice refers to bytes that its base keeps alive instead, e.g. a line of a file mapped by an input port,
+    //   so that strings read from a port are not copied. Slices are not NUL-terminated.
+    // - a slice's bytes are only copied (into a string of its own) once it is to be mutated, cf `make_writable`,
+    //   since they may be shared, or mapped read-only.
     class StringObject: public BaseBoxedObject {
+        template <typename F> friend void gc_for_each_child(BaseBoxedObject* obj, F&& f);
     private:
         size_t m_count;
         char* m_bytes;
-        bool m_bytes_gc_collectable;
+        OBJECT m_base;          // what keeps the bytes alive if this is a slice, else null
+        bool m_is_writable;
     public:
-        StringObject()
+        explicit StringObject(size_t count)
         :   BaseBoxedObject(ObjectKind::String),
-            m_count(),
-            m_bytes()
+            m_count(count),
+            m_bytes(reinterpret_cast<char*>(this + 1)),
+            m_base(OBJECT::null),
+            m_is_writable(true)
         {}
-        StringObject(size_t count, char* bytes, bool collect_bytes)
-        :   StringObject()
-        {
-            m_count = count;
-            m_bytes = bytes;
-            m_bytes_gc_collectable = collect_bytes;
+        StringObject(size_t count, OBJECT base, char const* bytes)
+        :   BaseBoxedObject(ObjectKind::String),
+            m_count(count),
+            m_bytes(const_cast<char*>(bytes)),
+            m_base(base),
+            m_is_writable(false)
+        {}
+    public:
+        static constexpr size_t size_in_bytes(size_t count) {
+            return sizeof(StringObject) + count + 1;
         }
     public:
         inline size_t count() const { return m_count; }
-        inline char* bytes() const { return m_bytes; }
+        inline OBJECT base() const { return m_base; }
+        inline bool is_slice() const { return !m_base.is_null(); }
+        // bytes may only be written once `make_writable` has been called.
+        inline char* bytes() { return m_bytes; }
+        inline char const* bytes() const { return m_bytes; }
+        // make_writable copies a slice's bytes into a string of its own, unless it already has.
+        void make_writable(GcThreadFrontEnd* gc_tfe);
     };
 
     class PairObject: public BaseBoxedObject {
+        template <typename F> friend void gc_for_each_child(BaseBoxedObject* obj, F&& f);
+        friend class GcEvacuator;
     private:
         OBJECT m_car;
         OBJECT m_cdr;
@@ -302,81 +465,411 @@ namespace ss {
     public:
         [[nodiscard]] inline OBJECT car() const { return m_car; }
         [[nodiscard]] inline OBJECT cdr() const { return m_cdr; }
-        inline void set_car(OBJECT o) { m_car = o; }
-        inline void set_cdr(OBJECT o) { m_cdr = o; }
+        inline void set_car(OBJECT o);
+        inline void set_cdr(OBJECT o);
+        static size_t car_offset();
+        static size_t cdr_offset();
     };
 
+    // VectorObject: `count` items laid out inline, with room for up to `capacity`.
+    // - a vector never moves, so it cannot grow past its capacity: `vector_push` reallocates a full 
+    //   vector through the GC instead, returning the copy.
     class VectorObject: public BaseBoxedObject {
+    private:
+        size_t m_count;
+        size_t m_capacity;
+
     public:
-        static const gc::SizeClassIndex sci;
+        VectorObject(size_t count, size_t capacity, OBJECT fill)
+        :   BaseBoxedObject(ObjectKind::Vector),
+            m_count(count),
+            m_capacity(capacity)
+        {
+            assert(count <= capacity);
+            std::fill(array(), array() + count, fill);
+        }
+
+    public:
+        static constexpr size_t size_in_bytes(size_t capacity) {
+            return sizeof(VectorObject) + capacity * sizeof(OBJECT);
+        }
+
+    public:
+        // try_push appends `object` iff there is room for it.
+        bool try_push(OBJECT object);
+
+    public:
+        // NOTE: writes must use `set`, cf `gc_write_barrier`
+        OBJECT& operator[] (size_t i) {
+            return array()[i];
+        }
+        inline void set(size_t i, OBJECT v);
+        ssize_t size() const {
+            return m_count;
+        }
+
+    public:
+        [[nodiscard]] inline size_t count() const { return m_count; }
+        [[nodiscard]] inline size_t capacity() const { return m_capacity; }
+        [[nodiscard]] inline OBJECT* array() { return reinterpret_cast<OBJECT*>(this + 1); }
+        [[nodiscard]] inline OBJECT const* array() const { return reinterpret_cast<OBJECT const*>(this + 1); }
+    };
+    static_assert(sizeof(VectorObject) % alignof(OBJECT) == 0);
 
+    // NumVectorObject: `count` unboxed numbers of one `NumVectorType`, laid out contiguously, cf SRFI-4.
+    // - an owning vector's elements follow its header, aligned to `ALIGNMENT` bytes for SIMD kernels.
+    // - a view refers to a range of its base vector's elements instead, and keeps the base alive.
+    // - like other sized objects, a numeric vector never moves, so its elements may be pointed to directly.
+    class NumVectorObject: public BaseBoxedObject {
+        template <typename F> friend void gc_for_each_child(BaseBoxedObject* obj, F&& f);
+    public:
+        static constexpr size_t ALIGNMENT = 32;
     private:
-        std::vector<OBJECT> m_impl;
+        NumVectorType m_type;
+        size_t m_count;
+        OBJECT m_base;          // the owning vector if this is a view, else null
+        uint8_t* m_bytes;
 
     public:
-        VectorObject()
-        :   BaseBoxedObject(ObjectKind::Vector),
-            m_impl()
-        {}
-        VectorObject(std::vector<OBJECT>&& items)
-        :   BaseBoxedObject(ObjectKind::Vector),
-            m_impl(std::move(items))
-        {}
+        NumVectorObject(NumVectorType type, size_t count);
+        NumVectorObject(NumVectorType type, size_t count, OBJECT base, uint8_t* bytes);
+
+    public:
+        static constexpr size_t element_size(NumVectorType type) {
+            switch (type) {
+                case NumVectorType::F64: return sizeof(double);
+                case NumVectorType::F32: return sizeof(float);
+                case NumVectorType::S64: return sizeof(int64_t);
+                case NumVectorType::U8: return sizeof(uint8_t);
+            }
+            return 0;
+        }
+        static constexpr size_t size_in_bytes(NumVectorType type, size_t count) {
+            return sizeof(NumVectorObject) + (ALIGNMENT - 1) + count * element_size(type);
+        }
+
+    public:
+        [[nodiscard]] inline NumVectorType type() const { return m_type; }
+        [[nodiscard]] inline size_t count() const { return m_count; }
+        [[nodiscard]] inline OBJECT base() const { return m_base; }
+        [[nodiscard]] inline uint8_t* bytes() const { return m_bytes; }
+        template <typename T> [[nodiscard]] T* data() const { return reinterpret_cast<T*>(m_bytes); }
+    };
 
+    // InputPortObject: a file being read, cf port.hh.
+    // - a regular file is mapped whole, and strings read from it are slices of the mapping, which is only unmapped 
+    //   once the port and every such slice are unreachable. 
+    // - other files, e.g. pipes, are read in chunks, each an owning string that slices read from it refer to.
+    // - the port owns its mapping or file descriptor: both are released when it is finalized.
+    class InputPortObject: public BaseBoxedObject {
+        template <typename F> friend void gc_for_each_child(BaseBoxedObject* obj, F&& f);
     private:
-        void push_many_without_reserve();
-        
-        template <typename... TArgs>
-        void push_many_without_reserve(OBJECT object, TArgs... args);
+        IntStr m_path;
+        char const* m_bytes;    // the mapping, or the current chunk's bytes
+        size_t m_count;         // the bytes available at `m_bytes`
+        size_t m_pos;
+        size_t m_mapped_count;  // 0 unless mapped
+        int m_fd;               // -1 if mapped, or once there is nothing left to read
+        OBJECT m_chunk;         // null if mapped
+        bool m_is_closed;
 
     public:
-        void reserve(size_t min_new_capacity);
+        InputPortObject(IntStr path, char const* mapped_bytes, size_t mapped_count);
+        InputPortObject(IntStr path, int fd);
+        ~InputPortObject() override;
 
-        void push(OBJECT object);
-        
-        template <typename... TArgs>
-        void push_many(TArgs... args);
+    public:
+        [[nodiscard]] IntStr path() const { return m_path; }
+        [[nodiscard]] bool is_closed() const { return m_is_closed; }
+        // available: the bytes read so far, but not yet consumed.
+        [[nodiscard]] std::string_view available() const { return {m_bytes + m_pos, m_count - m_pos}; }
+        // bytes_owner: what slices of `available` must refer to.
+        [[nodiscard]] OBJECT bytes_owner() { return m_chunk.is_null() ? OBJECT::make_ptr(this) : m_chunk; }
+        void consume(size_t count) { m_pos += count; }
 
     public:
-        OBJECT& operator[] (size_t i) {
-            return m_impl[i];
-        }
-        ssize_t size() {
-            return m_impl.size();
+        // fill reads more bytes into a new chunk after those available, returning false at EOF.
+        bool fill(GcThreadFrontEnd* gc_tfe);
+        void close();
+    };
+
+    // ObjectHash and ObjectKeyEqual hash and compare the keys of a `HashTableObject`: keys equal by its 
+    // equivalence hash alike, cf `hash_eq`, `hash_eqv`, and `hash_equal`.
+    struct ObjectHash {
+        HashTableEquivalence equivalence = HashTableEquivalence::Equal;
+        size_t operator()(OBJECT key) const;
+    };
+    struct ObjectKeyEqual {
+        HashTableEquivalence equivalence = HashTableEquivalence::Equal;
+        bool operator()(OBJECT k1, OBJECT k2) const;
+    };
+
+    // HashTableObject: a map from keys to values, compared by one `HashTableEquivalence`, cf SRFI-69.
+    // - entries are held in an `UnstableHashMap` outside the heap, which the table frees once finalized.
+    // - 'eq?' and 'eqv?' tables hash some keys by address, which a minor collection changes when it promotes 
+    //   a young key (or a young field of a pair key, for 'eqv?'). Such tables are remembered, so that the 
+    //   collection visits them, and rehash their entries when next used, cf `rehash_if_keys_moved`.
+    // - 'equal?' tables never hash by address: keys compared by identity hash by kind instead.
+    // - like vectors, tables are not synchronized: VThreads sharing one must not write it concurrently.
+    class HashTableObject: public BaseBoxedObject {
+        template <typename F> friend void gc_for_each_child(BaseBoxedObject* obj, F&& f);
+    public:
+        using Map = UnstableHashMap<OBJECT, OBJECT, ObjectHash, ObjectKeyEqual>;
+    private:
+        Map m_map;
+        HashTableEquivalence m_equivalence;
+        bool m_has_young_keys;  // since the last rehash, some key was hashed by a young object's address
+        bool m_keys_moved;      // a collection has visited the table since, so those keys may have moved
+
+    public:
+        HashTableObject(HashTableEquivalence equivalence, size_t capacity);
+
+    public:
+        [[nodiscard]] HashTableEquivalence equivalence() const { return m_equivalence; }
+        [[nodiscard]] size_t count() const { return m_map.size(); }
+        // find returns the value stored under `key`, or nullptr if there is none.
+        OBJECT const* find(OBJECT key);
+        void set(OBJECT key, OBJECT value);
+        // remove returns whether there was an entry to remove.
+        bool remove(OBJECT key);
+        void clear();
+        // for_each calls `f(key, value)` on each entry, in no particular order: `f` must not modify the table.
+        template <typename F> void for_each(F&& f) const {
+            for (auto const& entry: m_map) {
+                f(entry.first, entry.second);
+            }
         }
 
+    private:
+        bool hashes_by_young_address(OBJECT key) const;
+        void rehash_if_keys_moved();
+    };
+
+    // ChannelObject: a bounded FIFO of messages between VThreads, cf `vm_channel_send` and `vm_channel_receive`.
+    // - messages are queued in a lock-free ring outside the heap, which the channel frees once finalized: an
+    //   `Spsc` channel has one sending VThread, an `Mpsc` one any number. Either has one receiving VThread.
+    //   The first VThread to use an end owns it, cf `claim_sender` and `claim_receiver`.
+    // - a message is queued as it was sent, and only copied once received, cf `deep_copy`.
+    // - VThreads blocked on a full or empty channel wait on it, under a lock that is only taken to block or 
+    //   wake them: pushes and pops check `has_blocked` instead.
+    class ChannelObject: public BaseBoxedObject {
+        template <typename F> friend void gc_for_each_child(BaseBoxedObject* obj, F&& f);
+    private:
+        ChannelKind m_channel_kind;
+        std::unique_ptr<SmtSpscRing<OBJECT>> m_spsc_ring;   // iff `Spsc`
+        std::unique_ptr<SmtMpscRing<OBJECT>> m_mpsc_ring;   // iff `Mpsc`
+        std::atomic<ssize_t> m_sender_id;                   // of an `Spsc` channel, else -1
+        std::atomic<ssize_t> m_receiver_id;
+        std::mutex m_mutex;
+        std::atomic<size_t> m_blocked_count;
+        VThread* m_blocked_receiver;
+        std::vector<VThread*> m_blocked_senders;            // oldest first
+
+    public:
+        ChannelObject(ChannelKind channel_kind, size_t capacity);
+
+    public:
+        [[nodiscard]] ChannelKind channel_kind() const { return m_channel_kind; }
+        [[nodiscard]] size_t capacity() const;
+        // count is exact only while no VThread uses the channel.
+        [[nodiscard]] size_t count() const;
+        // claim_sender and claim_receiver return whether VThread `id` may use that end: i.e. if it is the first 
+        // to, or if it already has.
+        bool claim_sender(ssize_t id);
+        bool claim_receiver(ssize_t id);
+
+    public:
+        // pushing and popping: the callers must own the ends they use, or hold the lock while the owners are
+        // blocked.
+        bool try_push(OBJECT message) { return try_push_batch(&message, 1) == 1; }
+        size_t try_push_batch(OBJECT const* messages, size_t count);
+        std::optional<OBJECT> try_pop();
+        size_t try_pop_batch(OBJECT* out, size_t count);
+
     public:
-        [[nodiscard]] inline size_t count() const { return m_impl.size(); }
-        [[nodiscard]] inline OBJECT* array() { return m_impl.data(); }
-        inline std::vector<OBJECT>& as_cpp_vec() { return m_impl; }
+        // blocking: callers hold `mutex()`, except to check `has_blocked`.
+        std::mutex& mutex() { return m_mutex; }
+        [[nodiscard]] bool has_blocked() const { return m_blocked_count.load() > 0; }
+        [[nodiscard]] VThread* blocked_receiver() const { return m_blocked_receiver; }
+        [[nodiscard]] VThread* blocked_sender() const { return m_blocked_senders.empty() ? nullptr : m_blocked_senders.front(); }
+        void block_receiver(VThread* t);
+        void block_sender(VThread* t);
+        // unblock forgets `t`, returning whether it was blocked.
+        bool unblock(VThread* t);
     };
 
+    // LambdaLocTable maps each `expanded-lambda` datum produced by `SyntaxObject::to_datum` to the 
+    // location of its source lambda, cf `Compiler::compile_subr`
+    using LambdaLocTable = UnstableHashMap<PairObject const*, FLoc>;
+
+    // SyntaxObject: a datum of source code, and the location it was read from, cf `FLocTable`.
+    // - code is wrapped node by node, so that the expander can report where each is: data (e.g. quoted) is
+    //   wrapped once, as a whole, cf `is_datum`.
     class SyntaxObject: public BaseBoxedObject {
+        template <typename F> friend void gc_for_each_child(BaseBoxedObject* obj, F&& f);
     public:
         static const gc::SizeClassIndex sci;
+    private:
+        static constexpr FLocID DATUM_BIT = FLocID{1} << 63;
     
     private:
         OBJECT m_data;
-        FLoc m_loc;
+        FLocID m_loc;
         
     public:
-        inline SyntaxObject(OBJECT data, FLoc loc)
+        inline SyntaxObject(OBJECT data, FLocID loc, bool is_datum)
         :   BaseBoxedObject(ObjectKind::Syntax),
             m_data(data),
-            m_loc(loc)
+            m_loc(is_datum ? (loc | DATUM_BIT) : loc)
         {}
     
     public:
         [[nodiscard]] inline OBJECT data() const { return m_data; }
-        [[nodiscard]] inline FLoc loc() const { return m_loc; }
+        [[nodiscard]] inline FLocID loc_id() const { return m_loc & ~DATUM_BIT; }
+        [[nodiscard]] inline FLoc loc() const { return FLocTable::loc(loc_id()); }
+        // is_datum is true iff the data is a plain datum, i.e. holds no syntax objects.
+        [[nodiscard]] inline bool is_datum() const { return (m_loc & DATUM_BIT) != 0; }
 
     public:
-        OBJECT to_datum(GcThreadFrontEnd* gc_tfe) const;
+        OBJECT to_datum(GcThreadFrontEnd* gc_tfe, LambdaLocTable* lambda_locs = nullptr) const;
     
     private:
-        static OBJECT data_to_datum(GcThreadFrontEnd* gc_tfe, OBJECT data);
-        static OBJECT pair_data_to_datum(GcThreadFrontEnd* gc_tfe, OBJECT pair_data);
-        static OBJECT vector_data_to_datum(GcThreadFrontEnd* gc_tfe, OBJECT vec_data);
+        static OBJECT data_to_datum(GcThreadFrontEnd* gc_tfe, OBJECT data, LambdaLocTable* lambda_locs);
+        static OBJECT pair_data_to_datum(GcThreadFrontEnd* gc_tfe, OBJECT pair_data, LambdaLocTable* lambda_locs);
+        static OBJECT vector_data_to_datum(GcThreadFrontEnd* gc_tfe, OBJECT vec_data, LambdaLocTable* lambda_locs);
+    };
+
+    // ClosureObject: the body's VmExpID followed by its free variables, laid out inline.
+    // - each closure is a single allocation, size-classed by its free variable count.
+    // - free variables are uninitialized after `OBJECT::make_closure`: the caller must fill them.
+    class ClosureObject: public BaseBoxedObject {
+    private:
+        ssize_t m_body;
+        size_t m_count;
+
+    public:
+        ClosureObject(ssize_t body, size_t count)
+        :   BaseBoxedObject(ObjectKind::Closure),
+            m_body(body),
+            m_count(count)
+        {}
+
+    public:
+        static constexpr size_t size_in_bytes(size_t free_var_count) {
+            return sizeof(ClosureObject) + free_var_count * sizeof(OBJECT);
+        }
+
+    public:
+        [[nodiscard]] inline ssize_t body() const { return m_body; }
+        [[nodiscard]] inline size_t count() const { return m_count; }
+        [[nodiscard]] inline OBJECT* free_vars() { return reinterpret_cast<OBJECT*>(this + 1); }
+        OBJECT& operator[] (size_t i) { return free_vars()[i]; }
+    };
+    static_assert(sizeof(ClosureObject) % alignof(OBJECT) == 0);
+
+    // StackSegmentObject: an immutable copy of the VM stack items in [base, base+count), laid out inline.
+    // - a captured stack is a chain of segments linked by `below`, ending in null at the stack's bottom.
+    // - chains share their lower segments, so repeated captures of the same frames share storage.
+    class StackSegmentObject: public BaseBoxedObject {
+        template <typename F> friend void gc_for_each_child(BaseBoxedObject* obj, F&& f);
+    private:
+        OBJECT m_below;
+        size_t m_base;
+        size_t m_count;
+
+    public:
+        StackSegmentObject(OBJECT below, size_t base, size_t count)
+        :   BaseBoxedObject(ObjectKind::StackSegment),
+            m_below(below),
+            m_base(base),
+            m_count(count)
+        {}
+
+    public:
+        static constexpr size_t size_in_bytes(size_t count) {
+            return sizeof(StackSegmentObject) + count * sizeof(OBJECT);
+        }
+
+    public:
+        [[nodiscard]] inline OBJECT below() const { return m_below; }
+        [[nodiscard]] inline size_t base() const { return m_base; }
+        [[nodiscard]] inline size_t count() const { return m_count; }
+        [[nodiscard]] inline size_t end() const { return m_base + m_count; }
+        [[nodiscard]] inline OBJECT* items() { return reinterpret_cast<OBJECT*>(this + 1); }
+    };
+    static_assert(sizeof(StackSegmentObject) % alignof(OBJECT) == 0);
+
+    // gc_for_each_child calls `f` on each OBJECT field of `obj`, by reference, cf `GcMarker` and `GcEvacuator`.
+    template <typename F> void gc_for_each_child(BaseBoxedObject* obj, F&& f);
+
+    // gc_write_barrier must follow each store of `value` into a field of `obj` once constructed: old objects 
+    // that may refer to young ones are remembered, so that minor collections need not trace the old space.
+    inline void gc_write_barrier(BaseBoxedObject* obj, OBJECT value);
+
+    // GcMarker: the mark phase of a collection, cf `Gc::sweep`.
+    // - `mark` sets the mark bit of a root, and of every object reachable from it, in the heap's PageMap:
+    //   each is traced once.
+    // - objects outside this heap are not traced.
+    // - children are traced with an explicit work-list rather than by recursion, so long lists cannot
+    //   overflow the C++ stack.
+    // - the closure hook, if set, is called on each closure traced, e.g. to mark the code its body is in.
+    class GcMarker {
+    public:
+        using ClosureHook = void (*)(void* ctx, ClosureObject* closure);
+    private:
+        gc::PageMap& m_page_map;
+        std::vector<BaseBoxedObject*> m_work_list;
+        size_t m_marked_count;
+        ClosureHook m_closure_hook;
+        void* m_closure_hook_ctx;
+    public:
+        explicit GcMarker(gc::PageMap& page_map);
+    public:
+        void mark(OBJECT root);
+        void mark_all(OBJECT const* roots, size_t count);
+        void set_closure_hook(ClosureHook hook, void* ctx) { m_closure_hook = hook; m_closure_hook_ctx = ctx; }
+        size_t marked_count() const { return m_marked_count; }
+    private:
+        void push(OBJECT obj);
+        void trace(BaseBoxedObject* obj);
+    };
+
+    // GcEvacuator: a minor collection, cf `Gc::reset_nurseries`.
+    // - `evacuate` promotes the young object a root refers to (and every young object reachable from it) 
+    //   into the old space, updating the root to refer to the copy: each is promoted once, and leaves a 
+    //   forwarding address behind for other references to it.
+    // - old objects are not traced: only those in the remembered set, cf `evacuate_children`.
+    // - young object kinds (boxes, pairs, flonums, closures) hold no out-of-line memory, so promoting 
+    //   one is a copy of its size-class, and the nursery can be reset without finalizing what is left.
+    // - if `linearizes_lists`, tracing a pair first promotes the young pairs of the spine it begins, 
+    //   cdr-first, before any car of it: the spine is thus copied in a run of pairs that the front-end
+    //   allocates one after another (adjacent, unless a span or free-list runs out), rather than interleaved
+    //   with each car's own objects. cf `list_link_count` and `adjacent_link_count`
+    class GcEvacuator {
+    private:
+        GcThreadFrontEnd* m_promote_tfe;
+        std::vector<BaseBoxedObject*> m_work_list;
+        size_t m_promoted_count;
+        size_t m_list_link_count;
+        size_t m_adjacent_link_count;
+        bool m_linearizes_lists;
+    public:
+        explicit GcEvacuator(GcThreadFrontEnd* promote_tfe, bool linearizes_lists = !CONFIG_DISABLE_GC_LIST_LINEARIZATION);
+    public:
+        void evacuate(OBJECT& root);
+        void evacuate_all(OBJECT* roots, size_t count);
+        void evacuate_children(BaseBoxedObject* old_obj);
+        size_t promoted_count() const { return m_promoted_count; }
+        // list_link_count counts the promoted pairs that were the young cdr of another promoted pair, of 
+        // which adjacent_link_count counts those copied just after it.
+        size_t list_link_count() const { return m_list_link_count; }
+        size_t adjacent_link_count() const { return m_adjacent_link_count; }
+    private:
+        BaseBoxedObject* promote(BaseBoxedObject* obj);
+        void drain();
+        void trace(BaseBoxedObject* obj);
+        void linearize_spine(PairObject* copy);
+        void count_link(PairObject* copy, BaseBoxedObject* cdr_copy);
     };
 
     //
@@ -424,8 +917,21 @@ namespace ss {
     
     bool is_eqn(OBJECT e1, OBJECT e2);
     bool is_eq(OBJECT e1, OBJECT e2);
-    bool is_eqv(GcThreadFrontEnd* gc_tfe, OBJECT e1, OBJECT e2);
-    bool is_equal(GcThreadFrontEnd* gc_tfe, OBJECT e1, OBJECT e2);
+    bool is_eqv(OBJECT e1, OBJECT e2);
+    bool is_equal(OBJECT e1, OBJECT e2);
+    // hash_eq, hash_eqv, and hash_equal hash objects alike if they are 'eq?', 'eqv?', or 'equal?' respectively.
+    // - hash_equal only visits the first `HASH_EQUAL_VISIT_LIMIT` nodes of a pair or vector, so that it ends 
+    //   on cyclic data, and on long lists in bounded time.
+    inline constexpr size_t HASH_EQUAL_VISIT_LIMIT = 64;
+    size_t hash_eq(OBJECT o);
+    size_t hash_eqv(OBJECT o);
+    size_t hash_equal(OBJECT o);
+    // deep_copy returns a copy of `obj` that shares no storage `equal?` compares with it, keeping the copy's 
+    // shared and cyclic structure the same, e.g. for messages received from a channel.
+    // - pairs, vectors, numeric vectors, and strings are copied: string slices are copied as slices of the same
+    //   bytes, since they are only written once copied.
+    // - immediates, flonums, and objects compared by identity (e.g. boxes, closures, tables) are not.
+    OBJECT deep_copy(GcThreadFrontEnd* gc_tfe, OBJECT obj);
 
     inline ssize_t list_length(OBJECT pair_list);
     inline OBJECT list_member(OBJECT x, OBJECT lst);
@@ -435,6 +941,9 @@ namespace ss {
     inline OBJECT vector_length(OBJECT vec);
     inline OBJECT vector_ref(OBJECT vec, OBJECT index);
     inline void vector_set(OBJECT vec, OBJECT index, OBJECT v);
+    // vector_push appends `v` to `vec`: if it is full, the items are copied into a new vector with twice 
+    // its capacity, so the result must be used in place of `vec`.
+    OBJECT vector_push(GcThreadFrontEnd* gc_tfe, OBJECT vec, OBJECT v);
     std::vector<OBJECT> list_to_cpp_vector(OBJECT lst);
 
     //
@@ -501,7 +1010,9 @@ namespace ss {
     }
 
     inline BaseBoxedObject::BaseBoxedObject(ObjectKind kind)
-    :   m_kind(kind) {}
+    :   m_kind(kind),
+        m_gc_flags(0) 
+    {}
 
     inline OBJECT car(OBJECT object) {
     #if !CONFIG_DISABLE_RUNTIME_TYPE_CHECKS
@@ -560,7 +1071,7 @@ namespace ss {
             throw SsiError();
         }
     #endif
-        static_cast<BoxObject*>(box.as_ptr())->boxed() = new_stored;
+        static_cast<BoxObject*>(box.as_ptr())->set_boxed(new_stored);
     }
 
     inline OBJECT box(GcThreadFrontEnd* gc_tfe, OBJECT stored) {
@@ -638,7 +1149,7 @@ namespace ss {
             throw SsiError();
         }
     #endif
-        return OBJECT::make_integer(dynamic_cast<VectorObject*>(vec.as_ptr())->count());
+        return OBJECT::make_integer(vec.as_vector_p()->count());
     }
     inline OBJECT vector_ref(OBJECT vec, OBJECT index) {
     #if !CONFIG_DISABLE_RUNTIME_TYPE_CHECKS
@@ -655,7 +1166,7 @@ namespace ss {
             throw SsiError();
         }
     #endif
-        return dynamic_cast<VectorObject*>(vec.as_ptr())->operator[](index.as_integer());
+        return vec.as_vector_p()->operator[](index.as_integer());
     }
     inline void vector_set(OBJECT vec, OBJECT index, OBJECT v) {
     #if !CONFIG_DISABLE_RUNTIME_TYPE_CHECKS
@@ -672,7 +1183,7 @@ namespace ss {
             throw SsiError();
         }
     #endif
-        dynamic_cast<VectorObject*>(vec.as_ptr())->operator[](index.as_integer()) = v;
+        vec.as_vector_p()->set(index.as_integer(), v);
     }
 
 }   // namespace ss
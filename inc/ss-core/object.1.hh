@@ -10,6 +10,7 @@ namespace ss {
     inline ObjectKind OBJECT::kind() const {
         if (is_ptr()) { return m_data.ptr->kind(); }
         if (is_integer()) { return ObjectKind::Fixnum; }
+        if (is_immediate_float64()) { return ObjectKind::Float64; }
         if (is_symbol()) { return ObjectKind::InternedSymbol; }
         if (is_float32()) { return ObjectKind::Float32; }
         if (is_uchar()) { return ObjectKind::Rune; }
@@ -36,7 +37,13 @@ namespace ss {
             case ObjectKind::String: return "String";
             case ObjectKind::Pair: return "Pair";
             case ObjectKind::Vector: return "Vector";
+            case ObjectKind::NumVector: return "NumVector";
+            case ObjectKind::InputPort: return "InputPort";
+            case ObjectKind::HashTable: return "HashTable";
+            case ObjectKind::Channel: return "Channel";
             case ObjectKind::Syntax: return "Syntax";
+            case ObjectKind::Closure: return "Closure";
+            case ObjectKind::StackSegment: return "StackSegment";
         }
     }
 
@@ -46,14 +53,36 @@ namespace ss {
     inline OBJECT OBJECT::make_ptr(BaseBoxedObject* obj) {
         return OBJECT{obj};
     }
+    inline OBJECT OBJECT::make_float64(GcThreadFrontEnd* gc_tfe, double f64) {
+    #if CONFIG_IMMEDIATE_FLOAT64
+        // the double is rotated left by 1, so that the sign is the lowest bit and the exponent the top 11.
+        // The exponent is then rebased so that only its low 9 bits are set, and the top 2 are free for the 
+        // tag. Zeroes rotate to 0 or 1, which no rebased exponent can produce.
+        uint64_t rotated = std::rotl(std::bit_cast<uint64_t>(f64), 1);
+        if (rotated <= 1) {
+            OBJECT res;
+            res.m_data.flonum.tag = FLONUM_TAG;
+            res.m_data.flonum.bits = rotated;
+            return res;
+        }
+        uint64_t exponent = rotated >> 53;
+        if (exponent > FLONUM_MIN_EXPONENT && exponent <= FLONUM_MIN_EXPONENT + 511) {
+            OBJECT res;
+            res.m_data.flonum.tag = FLONUM_TAG;
+            res.m_data.flonum.bits = rotated - FLONUM_EXPONENT_OFFSET;
+            return res;
+        }
+    #endif
+        return make_boxed_float64(gc_tfe, f64);
+    }
     inline bool OBJECT::is_pair() const { 
         return is_ptr() && as_ptr()->kind() == ObjectKind::Pair; 
     }
     inline bool OBJECT::is_float64() const {
-        return is_ptr() && as_ptr()->kind() == ObjectKind::Float64;
+        return is_immediate_float64() || (is_ptr() && as_ptr()->kind() == ObjectKind::Float64);
     }
     inline bool OBJECT::is_closure() const {
-        return is_ptr() && as_ptr()->kind() == ObjectKind::Vector;
+        return is_ptr() && as_ptr()->kind() == ObjectKind::Closure;
     }
     inline bool OBJECT::is_string() const { 
         return is_ptr() && as_ptr()->kind() == ObjectKind::String;
@@ -61,6 +90,18 @@ namespace ss {
     inline bool OBJECT::is_vector() const {
         return is_ptr() && as_ptr()->kind() == ObjectKind::Vector;
     }
+    inline bool OBJECT::is_num_vector() const {
+        return is_ptr() && as_ptr()->kind() == ObjectKind::NumVector;
+    }
+    inline bool OBJECT::is_input_port() const {
+        return is_ptr() && as_ptr()->kind() == ObjectKind::InputPort;
+    }
+    inline bool OBJECT::is_hash_table() const {
+        return is_ptr() && as_ptr()->kind() == ObjectKind::HashTable;
+    }
+    inline bool OBJECT::is_channel() const {
+        return is_ptr() && as_ptr()->kind() == ObjectKind::Channel;
+    }
     inline bool OBJECT::is_syntax() const {
         return is_ptr() && as_ptr()->kind() == ObjectKind::Syntax;
     }
@@ -93,6 +134,15 @@ namespace ss {
     }
     inline double OBJECT::as_float64() const {
         assert(is_float64() && "expected float64 object");
+    #if CONFIG_IMMEDIATE_FLOAT64
+        if (is_immediate_float64()) {
+            uint64_t rotated = m_data.flonum.bits;
+            if (rotated > 1) {
+                rotated += FLONUM_EXPONENT_OFFSET;
+            }
+            return std::bit_cast<double>(std::rotr(rotated, 1));
+        }
+    #endif
         return static_cast<Float64Object*>(as_ptr())->value();
     }
     inline PairObject* OBJECT::as_pair_p() const { 
@@ -101,9 +151,30 @@ namespace ss {
     inline VectorObject* OBJECT::as_vector_p() const { 
         return static_cast<VectorObject*>(as_ptr()); 
     }
+    inline NumVectorObject* OBJECT::as_num_vector_p() const { 
+        return static_cast<NumVectorObject*>(as_ptr()); 
+    }
+    inline StringObject* OBJECT::as_string_p() const {
+        return static_cast<StringObject*>(as_ptr());
+    }
+    inline InputPortObject* OBJECT::as_input_port_p() const {
+        return static_cast<InputPortObject*>(as_ptr());
+    }
+    inline HashTableObject* OBJECT::as_hash_table_p() const {
+        return static_cast<HashTableObject*>(as_ptr());
+    }
+    inline ChannelObject* OBJECT::as_channel_p() const {
+        return static_cast<ChannelObject*>(as_ptr());
+    }
     inline SyntaxObject* OBJECT::as_syntax_p() const { 
         return static_cast<SyntaxObject*>(as_ptr()); 
     }
+    inline ClosureObject* OBJECT::as_closure_p() const { 
+        return static_cast<ClosureObject*>(as_ptr()); 
+    }
+    inline StackSegmentObject* OBJECT::as_stack_segment_p() const { 
+        return static_cast<StackSegmentObject*>(as_ptr()); 
+    }
 
     inline double OBJECT::to_double() const {
         OBJECT const& it = *this;
@@ -119,23 +190,101 @@ namespace ss {
         }
     };
 
-    inline void VectorObject::reserve(size_t min_new_capacity) {
-        m_impl.reserve(min_new_capacity);
+    inline void gc_write_barrier(BaseBoxedObject* obj, OBJECT value) {
+        if (value.is_ptr() && value.as_ptr()->gc_young() && !obj->gc_young()) {
+            obj->gc_remember();
+        }
+    }
+    template <typename F> 
+    void gc_for_each_child(BaseBoxedObject* obj, F&& f) {
+        switch (obj->kind()) {
+            case ObjectKind::Box: {
+                f(static_cast<BoxObject*>(obj)->boxed());
+            } break;
+            case ObjectKind::Pair: {
+                auto pair = static_cast<PairObject*>(obj);
+                f(pair->m_car);
+                f(pair->m_cdr);
+            } break;
+            case ObjectKind::Vector: {
+                auto vec = static_cast<VectorObject*>(obj);
+                for (size_t i = 0; i < vec->count(); i++) {
+                    f(vec->array()[i]);
+                }
+            } break;
+            case ObjectKind::String: {
+                f(static_cast<StringObject*>(obj)->m_base);
+            } break;
+            case ObjectKind::NumVector: {
+                f(static_cast<NumVectorObject*>(obj)->m_base);
+            } break;
+            case ObjectKind::InputPort: {
+                f(static_cast<InputPortObject*>(obj)->m_chunk);
+            } break;
+            case ObjectKind::HashTable: {
+                // keys are updated in place: a table hashing some by address rehashes them once next used.
+                auto table = static_cast<HashTableObject*>(obj);
+                for (auto& entry: table->m_map) {
+                    f(const_cast<OBJECT&>(entry.first));
+                    f(entry.second);
+                }
+                table->m_keys_moved |= table->m_has_young_keys;
+            } break;
+            case ObjectKind::Channel: {
+                // only called while every VThread is stopped, so no message is being pushed or popped:
+                auto channel = static_cast<ChannelObject*>(obj);
+                if (channel->m_spsc_ring) {
+                    channel->m_spsc_ring->for_each(f);
+                } else {
+                    channel->m_mpsc_ring->for_each(f);
+                }
+            } break;
+            case ObjectKind::Syntax: {
+                f(static_cast<SyntaxObject*>(obj)->m_data);
+            } break;
+            case ObjectKind::Closure: {
+                auto closure = static_cast<ClosureObject*>(obj);
+                for (size_t i = 0; i < closure->count(); i++) {
+                    f(closure->free_vars()[i]);
+                }
+            } break;
+            case ObjectKind::StackSegment: {
+                auto segment = static_cast<StackSegmentObject*>(obj);
+                f(segment->m_below);
+                for (size_t i = 0; i < segment->count(); i++) {
+                    f(segment->items()[i]);
+                }
+            } break;
+            default: {
+                // leaf objects: floats
+            } break;
+        }
+    }
+
+    inline void BoxObject::set_boxed(OBJECT o) {
+        m_boxed = o;
+        gc_write_barrier(this, o);
     }
-    inline void VectorObject::push(OBJECT object) {
-        m_impl.push_back(object);
+    inline void PairObject::set_car(OBJECT o) {
+        m_car = o;
+        gc_write_barrier(this, o);
     }
-    template <typename... TArgs>
-    void VectorObject::push_many(TArgs... args) {
-        size_t count = sizeof...(args);
-        m_impl.reserve(m_impl.size() + count);
-        push_many_without_reserve(args...);
+    inline void PairObject::set_cdr(OBJECT o) {
+        m_cdr = o;
+        gc_write_barrier(this, o);
     }
-    template <typename... TArgs>
-    void VectorObject::push_many_without_reserve(OBJECT arg, TArgs... args) {
-        m_impl.push_back(arg);
-        push_many_without_reserve(args...);
+
+    inline void VectorObject::set(size_t i, OBJECT v) {
+        array()[i] = v;
+        gc_write_barrier(this, v);
+    }
+    inline bool VectorObject::try_push(OBJECT object) {
+        if (m_count == m_capacity) {
+            return false;
+        }
+        array()[m_count++] = object;
+        gc_write_barrier(this, object);
+        return true;
     }
-    inline void VectorObject::push_many_without_reserve() {}
 
 }
\ No newline at end of file
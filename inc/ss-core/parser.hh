@@ -1,21 +1,26 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <istream>
 #include <optional>
+#include <functional>
 
 #include "ss-core/object.hh"
 #include "ss-core/gc.hh"
+#include "ss-core/file-loc.hh"
 
 // Core 'Parser' API: useful for parsing multiple files:
 namespace ss {
 
     class Parser;
 
-    // creates a parser using the provided input-stream reference.
-    // WARNING: if the `std::istream&` goes out of scope, we will segfault.
+    // creates a parser that reads the whole input-stream up front.
     Parser* create_parser(std::istream& input_stream, std::string input_desc, GcThreadFrontEnd* gc_tfe);
+    // creates a parser that reads `source` in place, e.g. a mapped file: cf `os_map_file`.
+    // WARNING: if the memory `source` views is freed before the parser is disposed, we will segfault.
+    Parser* create_parser(std::string_view source, std::string input_desc, GcThreadFrontEnd* gc_tfe);
     void dispose_parser(Parser* p);
 
     // (deprecated) extract one line datum from the stream:
@@ -32,6 +37,52 @@ namespace ss {
 
 }   // namespace ss
 
+// Parallel parsing: useful for large files
+namespace ss {
+
+    // a run of whole top-level forms in a source string, starting at `first_pos`.
+    struct SourceChunk {
+        size_t offset;
+        size_t size;
+        FLocPos first_pos;
+    };
+
+    // splits a source string into chunks of whole top-level forms, each at least `min_chunk_size` bytes long but 
+    // the last.
+    std::vector<SourceChunk> split_top_level_forms(std::string_view source, size_t min_chunk_size);
+
+    // parses each chunk of a source string on up to `worker_count` threads, each with its own GC front-end.
+    // - `on_lines` is called on this thread with each chunk's syntax objects in source order, as soon as they are
+    //   parsed, so that they can be expanded and compiled while later chunks are still being parsed.
+    // - small sources, or a `worker_count` of 1, are parsed on this thread using `gc_tfe`.
+    // - throws SsiError once the chunks before the first chunk that failed to parse have been handled.
+    void parse_all_lines_in_parallel(
+        std::string_view source, std::string const& input_desc, GcThreadFrontEnd* gc_tfe, size_t worker_count,
+        std::function<void(std::vector<OBJECT>)> const& on_lines
+    );
+
+}   // namespace ss
+
+// Streaming parsing: useful for unbounded inputs, e.g. pipes
+namespace ss {
+
+    // reads `input_stream` one top-level form at a time, calling `on_lines` with each form's syntax objects as soon
+    // as it has been read, so that it can be run before the next is read: cf `vm_stream_lines`.
+    // - only the form being read is buffered.
+    // - throws SsiError if a form fails to parse, once the forms before it have been handled.
+    void parse_each_line_from_stream(
+        std::istream& input_stream, std::string const& input_desc, GcThreadFrontEnd* gc_tfe,
+        std::function<void(std::vector<OBJECT>)> const& on_lines
+    );
+
+    // find_first_form_end returns the offset just past the first form in `source`, or nothing if `source` ends
+    // before its end is found, e.g. within a list, or an atom that more bytes might continue.
+    // - like `parse_each_line_from_stream`, only parentheses, string literals, and line-comments are scanned: the
+    //   parser reports any error in the form.
+    std::optional<size_t> find_first_form_end(std::string_view source);
+
+}   // namespace ss
+
 // Debug:
 namespace ss {
     void run_lexer_test_and_dispose_parser(Parser* p);
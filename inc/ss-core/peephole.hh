@@ -0,0 +1,24 @@
+#pragma once
+
+#include "ss-core/vcode.hh"
+
+///
+// Peephole optimization over VCode
+// - The compiler emits long chains of single-purpose VmExps (e.g. 'refer-local -> argument' for every
+//   argument, 'refer-global -> apply' for most calls). Each link costs one dispatch.
+// - `fuse_superinstructions` rewrites the head of such chains in-place into one fused VmExp that skips
+//   over the rest of the chain. The skipped VmExps are left untouched since other VmExps (e.g. both 
+//   arms of a 'test') may still jump to them.
+//
+// - 'frame ... apply' is not fused: the args are evaluated and pushed between the two, so they are never 
+//   adjacent unless the call takes no args. A non-tail call is instead cut down to 'frame', one fused push per 
+//   arg, and 'refer-global-apply'.
+//
+
+namespace ss {
+
+    // fuse_superinstructions rewrites every VmExp from `first_exp_id` to the end of its unit.
+    // Returns the number of fusions performed.
+    size_t fuse_superinstructions(VCode& code, VmExpID first_exp_id = 0);
+
+}   // namespace ss
@@ -33,6 +33,62 @@ namespace ss {
   using PlatformProcCb = std::function<OBJECT(ArgView const& args)>;
   using PlatformProcID = size_t;
 
+  // ArgSpan: an unchecked view of the arguments of a variadic platform procedure.
+  // Arguments are pushed last-to-first, so they are stored in reverse order below `top`.
+  class ArgSpan {
+  private:
+    OBJECT const* m_top;
+    ssize_t m_count;
+  public:
+    ArgSpan(OBJECT const* top, ssize_t count)
+    : m_top(top),
+      m_count(count) {}
+  public:
+    ssize_t size() const { return m_count; }
+    OBJECT operator[](ssize_t idx) const { return m_top[-idx]; }
+  };
+
+  // Plain function-pointer callbacks:
+  // - unlike `PlatformProcCb`, these are not type-erased, and fixed-arity procedures receive their
+  //   arguments directly rather than through an `ArgView`.
+  // - `ctx` is an opaque pointer supplied by the embedder when the procedure is defined.
+  using PlatformProcFn0 = OBJECT(*)(void* ctx);
+  using PlatformProcFn1 = OBJECT(*)(void* ctx, OBJECT a0);
+  using PlatformProcFn2 = OBJECT(*)(void* ctx, OBJECT a0, OBJECT a1);
+  using PlatformProcFn3 = OBJECT(*)(void* ctx, OBJECT a0, OBJECT a1, OBJECT a2);
+  using PlatformProcFn4 = OBJECT(*)(void* ctx, OBJECT a0, OBJECT a1, OBJECT a2, OBJECT a3);
+  using PlatformProcFnV = OBJECT(*)(void* ctx, ArgSpan args);
+
+  enum class PlatformProcFnKind: uint8_t {
+    Callback,       // no function-pointer: use the `PlatformProcCb`
+    Arity0, Arity1, Arity2, Arity3, Arity4,
+    Variadic
+  };
+
+  struct PlatformProcFn {
+    PlatformProcFnKind kind;
+    void* ctx;
+    union {
+      PlatformProcFn0 fn0;
+      PlatformProcFn1 fn1;
+      PlatformProcFn2 fn2;
+      PlatformProcFn3 fn3;
+      PlatformProcFn4 fn4;
+      PlatformProcFnV fnv;
+    };
+
+    PlatformProcFn(): kind(PlatformProcFnKind::Callback), ctx(nullptr), fn0(nullptr) {}
+    PlatformProcFn(PlatformProcFn0 fn, void* ctx): kind(PlatformProcFnKind::Arity0), ctx(ctx), fn0(fn) {}
+    PlatformProcFn(PlatformProcFn1 fn, void* ctx): kind(PlatformProcFnKind::Arity1), ctx(ctx), fn1(fn) {}
+    PlatformProcFn(PlatformProcFn2 fn, void* ctx): kind(PlatformProcFnKind::Arity2), ctx(ctx), fn2(fn) {}
+    PlatformProcFn(PlatformProcFn3 fn, void* ctx): kind(PlatformProcFnKind::Arity3), ctx(ctx), fn3(fn) {}
+    PlatformProcFn(PlatformProcFn4 fn, void* ctx): kind(PlatformProcFnKind::Arity4), ctx(ctx), fn4(fn) {}
+    PlatformProcFn(PlatformProcFnV fn, void* ctx): kind(PlatformProcFnKind::Variadic), ctx(ctx), fnv(fn) {}
+
+    // arity returns the number of arguments accepted, or -1 if variadic/unknown.
+    ssize_t arity() const;
+  };
+
   struct PlatformProcMetadata {
     IntStr name;
     ssize_t arity;
@@ -50,6 +106,7 @@ namespace ss {
     
   private:
     std::vector<PlatformProcCb> m_cb_table;
+    std::vector<PlatformProcFn> m_fn_table;
     std::vector<PlatformProcMetadata> m_metadata_table;
     UnstableHashMap<IntStr, PlatformProcID> m_id_symtab;
     
@@ -63,10 +120,34 @@ namespace ss {
       PlatformProcCb callable_cb,
       std::string docstring, bool is_variadic
     );
+    PlatformProcID define(
+      IntStr platform_proc_name, 
+      std::vector<IntStr> arg_names, 
+      PlatformProcFn fn,
+      std::string docstring
+    );
   public:
     std::optional<PlatformProcID> lookup(IntStr proc_name);
     PlatformProcCb const& cb(PlatformProcID proc_id) const { return m_cb_table[proc_id]; }
+    PlatformProcFn const& fn(PlatformProcID proc_id) const { return m_fn_table[proc_id]; }
     PlatformProcMetadata const& metadata(PlatformProcID proc_id) const { return m_metadata_table[proc_id]; }
+  public:
+    // call invokes a platform procedure whose `arg_count` args are on top of `stack` at `s`.
+    // Function-pointers are called directly; only `PlatformProcCb`s are passed an `ArgView`.
+    OBJECT call(PlatformProcID proc_id, VmStack& stack, ssize_t s, ssize_t arg_count) const {
+      PlatformProcFn const& fn = m_fn_table[proc_id];
+      OBJECT const* top = stack.data() + s - 1;
+      switch (fn.kind) {
+        case PlatformProcFnKind::Arity0: return fn.fn0(fn.ctx);
+        case PlatformProcFnKind::Arity1: return fn.fn1(fn.ctx, top[0]);
+        case PlatformProcFnKind::Arity2: return fn.fn2(fn.ctx, top[0], top[-1]);
+        case PlatformProcFnKind::Arity3: return fn.fn3(fn.ctx, top[0], top[-1], top[-2]);
+        case PlatformProcFnKind::Arity4: return fn.fn4(fn.ctx, top[0], top[-1], top[-2], top[-3]);
+        case PlatformProcFnKind::Variadic: return fn.fnv(fn.ctx, ArgSpan{top, arg_count});
+        case PlatformProcFnKind::Callback: break;
+      }
+      return m_cb_table[proc_id](ArgView{stack, s, arg_count});
+    }
   public:
     size_t size() const { return m_cb_table.size(); }
   };
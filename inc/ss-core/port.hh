@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "ss-core/config.hh"
+#include "ss-core/intern.hh"
+#include "ss-core/object.hh"
+
+///
+// Ports: output ports buffer what is written to them, and only write to their file (a C `FILE*`) when
+// flushed, so that a write does not cost a syscall.
+// - each port's buffer mode picks when it is flushed, other than when its buffer is full:
+//      - `Block`: only by 'flush-output-port', and at exit
+//      - `Line`: also at the end of each write containing a newline
+//      - `None`: also at the end of each write
+// - numbers and symbols are formatted straight into the buffer.
+// - a port may be written by several threads at once: each write holds its lock, cf `OutputPortWriter`.
+// - the standard output port is line-buffered if it is a terminal, and block-buffered otherwise, like C's
+//   `stdout`; the standard error port is unbuffered.
+// Input ports read files without copying them where they can: cf `InputPortObject`.
+// - strings read from a port are slices of the mapped file, or of the chunk the bytes were read into.
+// - each read returns `OBJECT::eof` once there is nothing left to read.
+//
+
+namespace ss {
+
+    enum class PortBufferMode: uint8_t {
+        Block,
+        Line,
+        None
+    };
+
+    // formatting numbers: each writes at most `MAX_FORMATTED_NUMBER_SIZE` bytes to `out`, returning the count.
+    // Floats are printed like `std::ostream`'s default, i.e. 6 significant digits as by '%g'.
+    constexpr size_t MAX_FORMATTED_NUMBER_SIZE = 32;
+    size_t format_integer(char* out, int64_t v);
+    size_t format_float64(char* out, double v);
+    size_t format_float32(char* out, float v);
+
+    class OutputPort {
+    private:
+        std::FILE* m_file;
+        std::unique_ptr<char[]> m_buf;
+        size_t m_capacity;
+        size_t m_count;
+        PortBufferMode m_mode;
+        bool m_wrote_newline;
+        std::mutex m_mutex;
+
+    public:
+        OutputPort(std::FILE* file, PortBufferMode mode, size_t capacity = CONFIG_OUTPUT_PORT_BUFFER_BYTES);
+        OutputPort(OutputPort const& other) = delete;
+        ~OutputPort();
+
+    public:
+        PortBufferMode mode() const { return m_mode; }
+        void set_mode(PortBufferMode mode);
+        std::mutex& mutex() { return m_mutex; }
+
+    public:
+        // writing: callers must hold `mutex()`.
+        inline void put(char c);
+        void write(char const* bytes, size_t count);
+        void write(std::string_view s) { write(s.data(), s.size()); }
+        void write_integer(int64_t v);
+        void write_float64(double v);
+        void write_float32(float v);
+        void write_symbol(IntStr sym) { write(interned_string(sym)); }
+
+        // end_write flushes the port if its buffer mode requires it after a write.
+        void end_write();
+        // flush writes the buffer to the port's file, and flushes that.
+        void flush();
+
+    private:
+        void drain();
+        char* reserve(size_t count);
+    };
+
+    // OutputPortWriter holds a port's lock for the duration of one write, e.g. one 'display'.
+    class OutputPortWriter {
+    private:
+        std::lock_guard<std::mutex> m_lock;
+        OutputPort& m_port;
+
+    public:
+        explicit OutputPortWriter(OutputPort& port): m_lock(port.mutex()), m_port(port) {}
+        ~OutputPortWriter() { m_port.end_write(); }
+
+    public:
+        OutputPort& port() const { return m_port; }
+    };
+
+    // output ports are referred to by ID, like VThreads:
+    using OutputPortID = int64_t;
+    constexpr OutputPortID STANDARD_OUTPUT_PORT_ID = 0;
+    constexpr OutputPortID STANDARD_ERROR_PORT_ID = 1;
+    OutputPort& standard_output_port();
+    OutputPort& standard_error_port();
+    // output_port returns the port with `id`, or nullptr if there is none.
+    OutputPort* output_port(OutputPortID id);
+    // flush_standard_ports flushes the standard output and error ports, e.g. before exiting, or writing to
+    // `std::cout` or `std::cerr` directly.
+    void flush_standard_ports();
+
+    // open_input_file returns a new input port reading `path`, or null if it cannot be opened.
+    OBJECT open_input_file(GcThreadFrontEnd* gc_tfe, std::string const& path);
+    // read_line returns the next line, without its line ending (LF or CRLF).
+    OBJECT read_line(GcThreadFrontEnd* gc_tfe, InputPortObject* port);
+    // read_char and peek_char return the next byte as an integer: chars are not yet supported.
+    OBJECT read_char(GcThreadFrontEnd* gc_tfe, InputPortObject* port);
+    OBJECT peek_char(GcThreadFrontEnd* gc_tfe, InputPortObject* port);
+    // read_string returns the next `count` bytes, or fewer if the port has fewer left.
+    OBJECT read_string(GcThreadFrontEnd* gc_tfe, InputPortObject* port, size_t count);
+    // read_datum parses the next datum, up to the end of its last token, cf `find_first_form_end`.
+    OBJECT read_datum(GcThreadFrontEnd* gc_tfe, InputPortObject* port);
+
+}   // namespace ss
+
+//
+// Inline definitions:
+//
+
+namespace ss {
+
+    inline void OutputPort::put(char c) {
+        if (m_count == m_capacity) {
+            drain();
+        }
+        m_buf[m_count++] = c;
+        m_wrote_newline |= (c == '\n');
+    }
+
+}   // namespace ss
@@ -3,9 +3,12 @@
 #include <ostream>
 
 #include "ss-core/object.hh"
+#include "ss-core/port.hh"
 
 namespace ss {
 
   void print_obj(OBJECT obj, std::ostream& out);
+  // print_obj to a port requires holding its lock, cf `OutputPortWriter`.
+  void print_obj(OBJECT obj, OutputPort& out);
 
 }   // namespace ss
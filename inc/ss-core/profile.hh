@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <cstdint>
+
+#include "ss-core/common.hh"
+#include "ss-core/vcode.hh"
+
+///
+// VmProfile: counters gathered by the engines in profiling mode, cf `vm_enable_profiler`.
+// - each VThread keeps its own, so that workers never contend: they are merged for the report.
+// - every instruction is counted by kind, every closure call by body, every PInvoke by PlatformProcID.
+// - time is sampled every `SAMPLE_PERIOD` instructions, and attributed to the body of the closure then
+//   running (or to the top-level of a line), so the cost of timing is amortized.
+//
+
+namespace ss {
+
+    class VmProfile {
+    public:
+        inline static constexpr uint32_t SAMPLE_PERIOD = 1024;
+        inline static constexpr VmExpID TOP_LEVEL_BODY = -1;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        struct ClosureStats {
+            uint64_t call_count = 0;
+            Clock::duration time{0};
+        };
+
+    private:
+        std::array<uint64_t, VMX_KIND_COUNT> m_op_counts;
+        UnstableHashMap<VmExpID, ClosureStats> m_closure_stats;
+        std::vector<uint64_t> m_pproc_counts;
+        Clock::time_point m_last_sample_time;
+        uint32_t m_sample_countdown;
+
+    public:
+        VmProfile();
+
+    // Counting: only called by the engines, on the VThread's own OS thread.
+    public:
+        // resume restarts the sampling clock: time spent suspended is not attributed.
+        void resume() {
+            m_last_sample_time = Clock::now();
+            m_sample_countdown = SAMPLE_PERIOD;
+        }
+        // count_op returns true when a time sample is due, cf `sample`
+        bool count_op(VmExpKind kind) {
+            m_op_counts[static_cast<size_t>(kind)]++;
+            return --m_sample_countdown == 0;
+        }
+        void sample(VmExpID running_body);
+        void count_call(VmExpID body) {
+            m_closure_stats[body].call_count++;
+        }
+        void count_pproc(PlatformProcID proc_id) {
+            if (proc_id >= m_pproc_counts.size()) {
+                m_pproc_counts.resize(proc_id + 1, 0);
+            }
+            m_pproc_counts[proc_id]++;
+        }
+
+    // Reporting:
+    public:
+        void merge(VmProfile const& other);
+        void print(std::ostream& out, VCode& code) const;
+    };
+
+    // closure_name names a closure body by its source location, e.g. in reports: cf `VCode::closure_loc`
+    std::string closure_name(VCode& code, VmExpID body);
+
+}   // namespace ss
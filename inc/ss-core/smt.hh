@@ -1,9 +1,15 @@
 #pragma once
 
 #include <queue>
+#include <deque>
 #include <optional>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <bit>
+#include <algorithm>
+#include <cstddef>
 
 namespace ss {
 
@@ -13,15 +19,265 @@ namespace ss {
     class SmtFifo {
     private:
         std::queue<T> m_queue;
-        std::mutex m_mutex;
+        mutable std::mutex m_mutex;
         std::condition_variable m_cv;
     public:
-        SmtFifo();
+        SmtFifo() = default;
     public:
-        bool empty() const;
-        void enqueue(T v);
-        std::optional<T> try_dequeue();
-        T wait_and_dequeue();
+        bool empty() const {
+            std::unique_lock lock{m_mutex};
+            return m_queue.empty();
+        }
+        void enqueue(T v) {
+            {
+                std::unique_lock lock{m_mutex};
+                m_queue.push(std::move(v));
+            }
+            // NOTE: notify AFTER releasing the lock
+            // NOTE: notify on each push => handle multiple consumers
+            m_cv.notify_one();
+        }
+        std::optional<T> try_dequeue() {
+            std::unique_lock lock{m_mutex};
+            if (m_queue.empty()) {
+                return {};
+            } else {
+                T popped = std::move(m_queue.front());
+                m_queue.pop();
+                return {std::move(popped)};
+            }
+        }
+        T wait_and_dequeue() {
+            std::unique_lock lock{m_mutex};
+            while (m_queue.empty()) {
+                m_cv.wait(lock);
+            }
+            T popped = std::move(m_queue.front());
+            m_queue.pop();
+            return popped;
+        }
     };
 
-}   // namespace ss
\ No newline at end of file
+    // SmtWorkDeque: a worker's queue of tasks for work-stealing.
+    // - the owner pushes and pops at the back (LIFO), to run the task it spawned most recently while it is
+    //   still hot in cache.
+    // - thieves steal from the front (FIFO), taking the oldest task: typically the root of the most work.
+    template <typename T>
+    class SmtWorkDeque {
+    private:
+        std::deque<T> m_deque;
+        mutable std::mutex m_mutex;
+    public:
+        SmtWorkDeque() = default;
+    public:
+        bool empty() const {
+            std::unique_lock lock{m_mutex};
+            return m_deque.empty();
+        }
+        void push(T v) {
+            std::unique_lock lock{m_mutex};
+            m_deque.push_back(std::move(v));
+        }
+        std::optional<T> try_pop() {
+            std::unique_lock lock{m_mutex};
+            if (m_deque.empty()) {
+                return {};
+            }
+            T popped = std::move(m_deque.back());
+            m_deque.pop_back();
+            return {std::move(popped)};
+        }
+        std::optional<T> try_steal() {
+            std::unique_lock lock{m_mutex};
+            if (m_deque.empty()) {
+                return {};
+            }
+            T stolen = std::move(m_deque.front());
+            m_deque.pop_front();
+            return {std::move(stolen)};
+        }
+    };
+
+    // SMT_CACHE_LINE_SIZE: what the ends of a ring are padded to, so that producers and consumers do not 
+    // write the same cache line.
+    inline constexpr size_t SMT_CACHE_LINE_SIZE = 64;
+
+    // SmtSpscRing: a bounded lock-free FIFO for one producer thread and one consumer thread.
+    // - the capacity is rounded up to a power of 2, so that positions wrap around with a mask.
+    // - each end caches the other's position, and only reloads it once the ring looks full (or empty), so 
+    //   that most pushes and pops touch no cache line the other end writes.
+    // - batches move many items for one release-store of a position.
+    template <typename T>
+    class SmtSpscRing {
+    private:
+        std::unique_ptr<T[]> m_items;
+        size_t m_mask;
+        alignas(SMT_CACHE_LINE_SIZE) std::atomic<size_t> m_head;    // the next position to pop
+        size_t m_cached_tail;                                       // the consumer's
+        alignas(SMT_CACHE_LINE_SIZE) std::atomic<size_t> m_tail;    // the next position to push
+        size_t m_cached_head;                                       // the producer's
+    public:
+        explicit SmtSpscRing(size_t capacity)
+        :   m_items(new T[std::bit_ceil(std::max<size_t>(capacity, 1))]),
+            m_mask(std::bit_ceil(std::max<size_t>(capacity, 1)) - 1),
+            m_head(0),
+            m_cached_tail(0),
+            m_tail(0),
+            m_cached_head(0)
+        {}
+    public:
+        size_t capacity() const { return m_mask + 1; }
+        // size is exact only if neither end is in use.
+        size_t size() const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+    public:
+        // producer:
+        bool try_push(T v) {
+            return try_push_batch(&v, 1) == 1;
+        }
+        // try_push_batch pushes as many of `items`' first `count` as there is room for, returning how many.
+        size_t try_push_batch(T const* items, size_t count) {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (capacity() - (tail - m_cached_head) < count) {
+                m_cached_head = m_head.load(std::memory_order_acquire);
+            }
+            count = std::min(count, capacity() - (tail - m_cached_head));
+            for (size_t i = 0; i < count; i++) {
+                m_items[(tail + i) & m_mask] = items[i];
+            }
+            m_tail.store(tail + count, std::memory_order_release);
+            return count;
+        }
+    public:
+        // consumer:
+        std::optional<T> try_pop() {
+            T popped;
+            if (try_pop_batch(&popped, 1) == 0) {
+                return {};
+            }
+            return {std::move(popped)};
+        }
+        // try_pop_batch pops up to `count` items into `out`, oldest first, returning how many.
+        size_t try_pop_batch(T* out, size_t count) {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            if (m_cached_tail - head < count) {
+                m_cached_tail = m_tail.load(std::memory_order_acquire);
+            }
+            count = std::min(count, m_cached_tail - head);
+            for (size_t i = 0; i < count; i++) {
+                out[i] = std::move(m_items[(head + i) & m_mask]);
+            }
+            m_head.store(head + count, std::memory_order_release);
+            return count;
+        }
+    public:
+        // for_each calls `f` on each queued item by reference, oldest first: neither end may be in use.
+        template <typename F> void for_each(F&& f) {
+            size_t tail = m_tail.load(std::memory_order_acquire);
+            for (size_t pos = m_head.load(std::memory_order_acquire); pos != tail; pos++) {
+                f(m_items[pos & m_mask]);
+            }
+        }
+    };
+
+    // SmtMpscRing: a bounded lock-free FIFO for any number of producer threads, and one consumer thread.
+    // - cf Dmitry Vyukov's bounded MPMC queue: each cell has a sequence number, which tells producers 
+    //   whether it is free at their position, and the consumer whether it has been written yet.
+    // - producers claim positions with a CAS of the tail, so a batch of pushes costs one CAS.
+    template <typename T>
+    class SmtMpscRing {
+    private:
+        struct Cell {
+            std::atomic<size_t> seq;    // `pos` if free for the push at `pos`, `pos + 1` once written
+            T value;
+        };
+        std::unique_ptr<Cell[]> m_cells;
+        size_t m_mask;
+        alignas(SMT_CACHE_LINE_SIZE) std::atomic<size_t> m_head;    // the next position to pop
+        alignas(SMT_CACHE_LINE_SIZE) std::atomic<size_t> m_tail;    // the next position to claim
+    public:
+        explicit SmtMpscRing(size_t capacity)
+        :   m_cells(new Cell[std::bit_ceil(std::max<size_t>(capacity, 1))]),
+            m_mask(std::bit_ceil(std::max<size_t>(capacity, 1)) - 1),
+            m_head(0),
+            m_tail(0)
+        {
+            for (size_t i = 0; i <= m_mask; i++) {
+                m_cells[i].seq.store(i, std::memory_order_relaxed);
+            }
+        }
+    public:
+        size_t capacity() const { return m_mask + 1; }
+        // size is exact only if no end is in use.
+        size_t size() const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+    public:
+        // producers:
+        bool try_push(T v) {
+            return try_push_batch(&v, 1) == 1;
+        }
+        // try_push_batch pushes as many of `items`' first `count` as there is room for, returning how many.
+        size_t try_push_batch(T const* items, size_t count) {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            for (;;) {
+                size_t used_count = tail - m_head.load(std::memory_order_acquire);
+                if (static_cast<std::ptrdiff_t>(used_count) < 0) {
+                    // the tail loaded is older than the head: other producers and the consumer have since moved on.
+                    tail = m_tail.load(std::memory_order_relaxed);
+                    continue;
+                }
+                // the consumer frees cells in order, so if the last cell of the batch is free, so are the others:
+                size_t n = std::min(count, capacity() - used_count);
+                if (n == 0) {
+                    return 0;
+                }
+                size_t last = tail + n - 1;
+                if (m_cells[last & m_mask].seq.load(std::memory_order_acquire) != last) {
+                    // another producer claimed these first, or the consumer has not freed them yet:
+                    tail = m_tail.load(std::memory_order_relaxed);
+                    continue;
+                }
+                if (m_tail.compare_exchange_weak(tail, tail + n, std::memory_order_relaxed)) {
+                    for (size_t i = 0; i < n; i++) {
+                        Cell& cell = m_cells[(tail + i) & m_mask];
+                        cell.value = items[i];
+                        cell.seq.store(tail + i + 1, std::memory_order_release);
+                    }
+                    return n;
+                }
+            }
+        }
+    public:
+        // consumer:
+        std::optional<T> try_pop() {
+            T popped;
+            if (try_pop_batch(&popped, 1) == 0) {
+                return {};
+            }
+            return {std::move(popped)};
+        }
+        // try_pop_batch pops up to `count` items into `out`, oldest first, returning how many: it stops at the 
+        // first position a producer has claimed but not written yet.
+        size_t try_pop_batch(T* out, size_t count) {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            size_t n = 0;
+            for (; n < count; n++) {
+                Cell& cell = m_cells[(head + n) & m_mask];
+                if (cell.seq.load(std::memory_order_acquire) != head + n + 1) {
+                    break;
+                }
+                out[n] = std::move(cell.value);
+                cell.seq.store(head + n + capacity(), std::memory_order_release);
+            }
+            m_head.store(head + n, std::memory_order_release);
+            return n;
+        }
+    public:
+        // for_each calls `f` on each queued item by reference, oldest first: no end may be in use.
+        template <typename F> void for_each(F&& f) {
+            size_t tail = m_tail.load(std::memory_order_acquire);
+            for (size_t pos = m_head.load(std::memory_order_acquire); pos != tail; pos++) {
+                f(m_cells[pos & m_mask].value);
+            }
+        }
+    };
+
+}   // namespace ss
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+///
+// Tracing: nested spans of each phase of running a program (e.g. parsing, expanding, compiling, running each
+// subr, loading libraries, and collecting), written as Chrome's trace-event JSON, cf `ssi -trace out.json`.
+// The trace can be opened in Perfetto (ui.perfetto.dev) or 'chrome://tracing'.
+// - tracing is always compiled, but only records once enabled: a span costs one relaxed load until then.
+// - each OS thread records into a buffer of its own, so that tracing threads do not contend: the buffers
+//   are kept once their thread exits, so that they are written with the rest.
+// - spans are written as complete events ('X'), which nest by time on each thread.
+// - spans are only the size of phases, not of instructions: cf `VmProfile` for those.
+//
+
+namespace ss {
+
+    namespace trace {
+        extern std::atomic<bool> g_enabled;
+    }
+
+    // enable_tracing starts (or stops) recording spans: those begun before are not recorded.
+    void enable_tracing(bool enabled = true);
+    inline bool is_tracing_enabled() {
+        return trace::g_enabled.load(std::memory_order_relaxed);
+    }
+
+    // write_trace writes every span recorded so far as a trace-event JSON object.
+    void write_trace(std::ostream& out);
+    // write_trace_file writes the trace to `file_path`, returning false if it cannot be written.
+    bool write_trace_file(std::string const& file_path);
+
+    // TraceSpan records a span from its construction to its destruction, e.g.
+    //  TraceSpan span{"compile", subr.name};
+    // `name` must outlive the trace, e.g. a literal: `detail` (e.g. a file path) is copied if recorded.
+    class TraceSpan {
+    private:
+        using Clock = std::chrono::steady_clock;
+
+    private:
+        char const* m_name;
+        std::string m_detail;
+        Clock::time_point m_start;
+        bool m_is_recording;
+
+    public:
+        explicit TraceSpan(char const* name, std::string_view detail = {})
+        :   m_name(name),
+            m_detail(),
+            m_start(),
+            m_is_recording(is_tracing_enabled())
+        {
+            if (m_is_recording) {
+                m_detail = detail;
+                m_start = Clock::now();
+            }
+        }
+        ~TraceSpan() {
+            if (m_is_recording) {
+                record();
+            }
+        }
+        TraceSpan(TraceSpan const&) = delete;
+        TraceSpan& operator=(TraceSpan const&) = delete;
+
+    private:
+        void record();
+    };
+
+}   // namespace ss
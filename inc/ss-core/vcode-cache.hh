@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <ostream>
+#include <string_view>
+#include <optional>
+#include <cstdint>
+
+#include "ss-core/vcode.hh"
+#include "ss-core/gc.hh"
+
+///
+// VCode cache: '.ssc' files hold the code compiled for one subr, so that unchanged scripts need not be
+// parsed, expanded, or compiled again.
+// - each file is keyed by a hash of the source and its path, and by the build configuration.
+// - the format is position-independent: expressions refer to each other relative to the first expression of
+//   the subr's unit, and everything else is referred to by index into the file's own tables, so loading is one
+//   pass of fix-ups over the mapped file:
+//      - a string table, by which each `IntStr` (symbols, names, and source paths) is re-interned
+//      - a global table, relinked by name: globals the subr defines are defined again, in order, and calls to
+//        known procedures are relinked to their bodies
+//      - a platform procedure table, relinked by name
+//      - a constant table, holding the objects the expressions refer to
+// - each line's source object is not kept, since it is only printed when debugging: a cached line's is null.
+// - a file that does not match, or refers to a platform procedure or global this VM lacks, is not loaded.
+//
+
+namespace ss {
+
+    // vcode_cache_key hashes the source that a cache file is valid for.
+    uint64_t vcode_cache_key(std::string_view source, std::string const& input_desc);
+
+    // save_vcode_cache writes `subr`, and the unit it was compiled into, to `ssc_path`, where `first_gdef_id` is 
+    // the number of globals in `code` before `subr` was compiled.
+    // Returns false if `subr` cannot be cached (e.g. a constant cannot be written), or on IO errors.
+    bool save_vcode_cache(
+        std::string const& ssc_path, uint64_t key, VCode& code, VSubr const& subr, GDefID first_gdef_id
+    );
+
+    // write_vcode_cache writes the cache of `subr` to `out`, as `save_vcode_cache` does to a file.
+    bool write_vcode_cache(
+        std::ostream& out, uint64_t key, VCode& code, VSubr const& subr, GDefID first_gdef_id
+    );
+
+    // vcode_cache_matches returns whether the file at `ssc_path` is a cache for `key` built by this build
+    // configuration, only reading its header: its contents are only checked once loaded.
+    bool vcode_cache_matches(std::string const& ssc_path, uint64_t key);
+
+    // load_vcode_cache loads the subr cached at `ssc_path` into a new unit of `code` if the file matches `key`, 
+    // else leaves `code` unchanged.
+    std::optional<VSubr> load_vcode_cache(
+        std::string const& ssc_path, uint64_t key, VCode& code, GcThreadFrontEnd* gc_tfe
+    );
+    // load_vcode_cache_words loads a cache held in memory, e.g. embedded in an executable: cf `load_vcode_cache`
+    std::optional<VSubr> load_vcode_cache_words(
+        uint64_t const* words, size_t word_count, uint64_t key, VCode& code, GcThreadFrontEnd* gc_tfe
+    );
+
+}   // namespace ss
@@ -3,6 +3,8 @@
 #include <vector>
 #include <string>
 #include <queue>
+#include <memory>
+#include <cstdint>
 
 #include "ss-core/object.hh"
 #include "ss-core/common.hh"
@@ -18,12 +20,26 @@ namespace ss {
     ///
     // VmExp: each expression is a VM instruction.
     // Term 'expression' rather than 'instruction' comes from CPS convention: 'x' for 'next expression' register in VM.
-    // All VmExps are are stored in a flat table in the 'VirtualMachine'.
-    //  - this ensures traversal during interpretation is of similar efficiency to bytecode with padding
-    //  - TODO: do we need to traverse this structure to perform GC? cf Ch4
+    // VmExps are stored in units, one per compilation (e.g. each subr), cf `VCode::new_unit`:
+    //  - each unit is a flat table, so traversal during interpretation is of similar efficiency to bytecode 
+    //    with padding.
+    //  - a VmExpID is its unit's ID in the high bits, then its index in the unit: the IDs of a unit's
+    //    expressions are consecutive.
     //
 
     using VmExpID = ssize_t;
+    using VCodeUnitID = size_t;
+
+    inline constexpr size_t VMX_UNIT_SHIFT = 32;
+    inline constexpr VmExpID vmx_id(VCodeUnitID unit, size_t index) {
+        return static_cast<VmExpID>((unit << VMX_UNIT_SHIFT) | index);
+    }
+    inline constexpr VCodeUnitID vmx_unit(VmExpID exp_id) {
+        return static_cast<size_t>(exp_id) >> VMX_UNIT_SHIFT;
+    }
+    inline constexpr size_t vmx_index(VmExpID exp_id) {
+        return static_cast<size_t>(exp_id) & ((size_t{1} << VMX_UNIT_SHIFT) - 1);
+    }
 
     enum class VmExpKind: VmExpID {
         Halt,
@@ -36,6 +52,7 @@ namespace ss {
         AssignLocal,
         AssignFree,
         AssignGlobal,
+        AssignLocalUnboxed, // a mutated local no closure captures, see `Definition::is_boxed`
         Conti,
         Nuate,
         Frame,
@@ -46,17 +63,97 @@ namespace ss {
         Indirect,
         Box,
         Shift,
-        PInvoke
+        PInvoke,
+        CallGlobal,         // only emitted for known procedures, see `VCode::known_proc`
+        ShiftCallGlobal,
+        SelfTailCall,       // a known procedure calling itself in tail position: reuses the frame
+
+        // superinstructions: only emitted by `fuse_superinstructions`, see peephole.hh
+        ReferLocalPush,
+        ReferFreePush,
+        ReferGlobalPush,
+        ConstantPush,
+        ReferGlobalApply,
+        ShiftApply,
+        ReferGlobalShiftApply,
+
+        // primitives: inlined platform procedures with a fast-path, see `VCode::set_platform_proc_prim`
+        // - binary primitives pop their second argument, and take their first in the accumulator.
+        // - unary primitives take their argument in the accumulator.
+        PrimAdd,
+        PrimSub,
+        PrimMul,
+        PrimDiv,
+        PrimRem,
+        PrimEq,
+        PrimLt,
+        PrimGt,
+        PrimLe,
+        PrimGe,
+        PrimCons,
+        PrimCar,
+        PrimCdr,
+        PrimIsNull,
+        PrimIsPair,
+
+        Jump,           // only emitted by bytecode lowering, see bytecode.hh
+
+
+        // register instructions: only emitted by register lowering, see bytecode.hh
+        // - each reads its arguments from the frame's slots (cf `VmStack::index`) and constants, rather than
+        //   from the accumulator and stack, then leaves its result in the accumulator.
+        // - 'RR' forms take both arguments from locals, 'RK' their first from a local and their second from a
+        //   constant, 'R' forms their only one from a local.
+        // - each group is in the order of the primitives.
+        PrimAddRR,
+        PrimSubRR,
+        PrimMulRR,
+        PrimDivRR,
+        PrimRemRR,
+        PrimEqRR,
+        PrimLtRR,
+        PrimGtRR,
+        PrimLeRR,
+        PrimGeRR,
+        PrimConsRR,
+        PrimAddRK,
+        PrimSubRK,
+        PrimMulRK,
+        PrimDivRK,
+        PrimRemRK,
+        PrimEqRK,
+        PrimLtRK,
+        PrimGtRK,
+        PrimLeRK,
+        PrimGeRK,
+        PrimConsRK,
+        PrimCarR,
+        PrimCdrR,
+        PrimIsNullR,
+        PrimIsPairR,
+
+        // quickened calls: only written in place of calls by quickening, see bytecode.hh
+        ApplyCached,
+        ReferGlobalApplyCached,
+        ShiftApplyCached,
+        ReferGlobalShiftApplyCached
     };
+    inline constexpr size_t VMX_KIND_COUNT = static_cast<size_t>(VmExpKind::ReferGlobalShiftApplyCached) + 1;
+    char const* vmx_kind_name(VmExpKind kind);
+    bool vmx_kind_is_fused(VmExpKind kind);
+    bool vmx_kind_is_prim(VmExpKind kind);
+    ssize_t vmx_prim_arity(VmExpKind kind);
+    bool vmx_kind_is_register(VmExpKind kind);
+
     union VmExpArgs {
         struct {} i_halt;
-        struct { size_t n; VmExpID x; } i_refer;
+        struct { size_t n; VmExpID x; } i_refer;                            // a local's 'n' may be negative
         struct { OBJECT obj; VmExpID x; } i_constant;
         struct { size_t vars_count; VmExpID body; VmExpID x; } i_close;
         struct { VmExpID next_if_t; VmExpID next_if_f; } i_test;
         struct { size_t n; VmExpID x; } i_assign;                           // see three-imp p.105
-        struct { VmExpID x; } i_conti;
-        struct { OBJECT stack; VmExpID x; } i_nuate;
+        struct { size_t n; VmExpID x; } i_conti;                            // captures all but the top 'n' items
+        struct { VmExpID x; } i_nuate;                                      // stack: free var 0 of 'c'
         struct { VmExpID fn_body_x; VmExpID post_ret_x; } i_frame;
         struct { VmExpID x; } i_argument;
         struct { OBJECT var; VmExpID next; } i_define;
@@ -66,6 +163,9 @@ namespace ss {
         struct { ssize_t n; VmExpID x; } i_box;                          // see three-imp p.105
         struct { ssize_t n; ssize_t m; VmExpID x; } i_shift;          // see three-imp p.111
         struct { ssize_t n; size_t proc_id; VmExpID x; } i_pinvoke;
+        struct { size_t gn; VmExpID body; int32_t n; int32_t m; } i_call_global;   // 'n', 'm' as in 'i_shift'
+        struct { size_t gn; ssize_t n; ssize_t m; } i_refer_global_shift;  // fused 'refer-global -> shift -> apply'
+        struct { size_t proc_id; VmExpID x; } i_prim;                       // 'proc_id' is the fallback
     };
     struct VmExp {
         VmExpKind kind;
@@ -87,24 +187,39 @@ namespace ss {
         VmExpID t;  // must be a 'halt' expression so we can read the accumulator
     };
 
+    ///
+    // KnownProc: a procedure whose body is known at compile time, cf `VCode::known_proc`.
     //
-    // VSubr: a collection of programs-- one per line, and the source code object (may be reused, e.g. 'quote')
+
+    struct KnownProc {
+        VmExpID body;
+        size_t arity;
+    };
+
+    //
+    // VSubr: a collection of programs-- one per line, and the datum it was compiled from (may be reused, e.g. 'quote')
+    // Its programs are compiled into one unit, cf `Compiler::extend_subr`.
     //
 
+    inline constexpr VCodeUnitID VCODE_NO_UNIT = SIZE_MAX;
+
     struct VSubr {
         std::vector<OBJECT> line_code_objs;
         std::vector<VmProgram> line_programs;
         std::string name;
+        VCodeUnitID unit;
 
-        VSubr(std::string name, std::vector<OBJECT> obj, std::vector<VmProgram> line_programs)
+        VSubr(std::string name, std::vector<OBJECT> obj, std::vector<VmProgram> line_programs, VCodeUnitID unit = VCODE_NO_UNIT)
         :   line_code_objs(obj),
             line_programs(line_programs),
-            name(name)
+            name(name),
+            unit(unit)
         {}
         explicit VSubr(VSubr&& other) noexcept
         :   line_code_objs(std::move(other.line_code_objs)),
             line_programs(std::move(other.line_programs)),
-            name(std::move(other.name))
+            name(std::move(other.name)),
+            unit(other.unit)
         {}
     };
 
@@ -126,10 +241,26 @@ namespace ss {
     public:
         inline static constexpr size_t DEFAULT_RESERVED_FILE_COUNT = 1024;
     private:
-        std::vector<VmExp> m_exps;
+        struct Unit {
+            std::vector<VmExp> exps;
+            bool is_pinned;
+            bool is_marked;
+        };
+    private:
+        std::vector<std::unique_ptr<Unit>> m_units;     // indexed by VCodeUnitID, null once freed
+        std::vector<VCodeUnitID> m_free_unit_ids;
+        VCodeUnitID m_current_unit;
+        size_t m_exp_count;                             // in every unit
         std::vector<VSubr> m_subrs;
         DefTable m_def_tab;
         PlatformProcTable m_pproc_tab;
+        std::vector<VmExpKind> m_pproc_prims;
+        VmExpID m_nuate_entry;
+        VmExpID m_spawn_entry;
+        VmExpID m_call_entry;
+        VmExpID m_halt_entry;
+        UnstableHashMap<VmExpID, FLoc> m_closure_locs;
+        UnstableHashMap<GDefID, KnownProc> m_known_procs;
 
     public:
         explicit VCode(size_t reserved_file_count = DEFAULT_RESERVED_FILE_COUNT);
@@ -141,15 +272,83 @@ namespace ss {
     
     // Core getters and setters:
     public:
-        std::vector<VmExp>& exps() { return m_exps; };
         std::vector<VSubr>& subrs() { return m_subrs; };
-        VmExp& operator[] (VmExpID exp_id) { return m_exps[exp_id]; }
+        VmExp& operator[] (VmExpID exp_id) { return m_units[vmx_unit(exp_id)]->exps[vmx_index(exp_id)]; }
+        VmExp const& operator[] (VmExpID exp_id) const { return m_units[vmx_unit(exp_id)]->exps[vmx_index(exp_id)]; }
         DefTable& def_tab() { return m_def_tab; }
         PlatformProcTable& pproc_tab() { return m_pproc_tab; }
 
+    // Units: new expressions are appended to the current unit, so that the code compiled for each subr can be
+    // freed once nothing refers to it, cf `VirtualMachine::collect`.
+    // - unit 0 is current until another is made, and holds the entries shared by all code: it is pinned.
+    // - pinned units are never freed, e.g. those of the main subrs, and those known procedures are in.
+    // - a freed unit's ID may be reused: nothing may refer to its expressions any more.
+    public:
+        VCodeUnitID new_unit();
+        VCodeUnitID new_unit(std::vector<VmExp> exps);
+        // next_unit_id is the ID the next new unit will have.
+        VCodeUnitID next_unit_id() const { return m_free_unit_ids.empty() ? m_units.size() : m_free_unit_ids.back(); }
+        void select_unit(VCodeUnitID unit);
+        void pin_unit(VCodeUnitID unit) { m_units[unit]->is_pinned = true; }
+        bool is_pinned(VCodeUnitID unit) const { return m_units[unit]->is_pinned; }
+        void free_unit(VCodeUnitID unit);
+        VCodeUnitID current_unit() const { return m_current_unit; }
+        // next_exp_id is the ID of the next expression appended to the current unit.
+        VmExpID next_exp_id() const { return end_exp_id(m_current_unit); }
+        // end_exp_id is one past the ID of the last expression in `unit`.
+        VmExpID end_exp_id(VCodeUnitID unit) const { return vmx_id(unit, m_units[unit]->exps.size()); }
+        bool has_unit(VCodeUnitID unit) const { return unit < m_units.size() && m_units[unit]; }
+        size_t count_units() const { return m_units.size() - m_free_unit_ids.size(); }
+        size_t count_exps() const { return m_exp_count; }
+
+    // Marking units: cf `VirtualMachine::collect`
+    // free_unmarked_units frees every unit neither pinned nor marked since `clear_unit_marks`, returning their IDs.
+    public:
+        void clear_unit_marks();
+        void mark_unit(VCodeUnitID unit) { m_units[unit]->is_marked = true; }
+        std::vector<VCodeUnitID> free_unmarked_units();
+
+    // nuate_entry is the body shared by all continuations, created on first use:
+    // continuations are closures whose free variable 0 is the captured stack, cf `VirtualMachine::continuation`.
+    public:
+        VmExpID nuate_entry();
+
+    // closure_loc maps the body of each compiled lambda to its source location, if known.
+    public:
+        void set_closure_loc(VmExpID body, FLoc loc) { m_closure_locs[body] = loc; }
+        FLoc const* closure_loc(VmExpID body) const {
+            auto it = m_closure_locs.find(body);
+            return (it == m_closure_locs.end()) ? nullptr : &it->second;
+        }
+
+    // known_proc maps each global bound once to a closure without free variables to the closure's body, so that
+    // calls to it may jump straight there: cf `Compiler::compile_list_exp`.
+    // - a global is only known once the line defining it has been compiled, so that it is always assigned
+    //   before a 'call-global' to it runs.
+    // - the unit holding a known procedure's body is pinned, since later code calls it directly.
+    public:
+        void set_known_proc(GDefID gdef_id, KnownProc proc) { m_known_procs[gdef_id] = proc; pin_unit(vmx_unit(proc.body)); }
+        KnownProc const* known_proc(GDefID gdef_id) const {
+            auto it = m_known_procs.find(gdef_id);
+            return (it == m_known_procs.end()) ? nullptr : &it->second;
+        }
+
+    // spawn_entry is where each spawned VThread starts: it applies the thunk in the accumulator in a
+    // new frame, then halts with its result.
+    public:
+        VmExpID spawn_entry();
+
+    // call_entry applies the procedure in the accumulator to the arguments atop the stack, and halt_entry
+    // halts: a VThread may be set up to call a procedure from the platform, with a frame returning to
+    // halt_entry pushed below its arguments, cf `VirtualMachine::prepare_bulk_call`.
+    public:
+        VmExpID call_entry();
+        VmExpID halt_entry();
+
     // creating VM expressions:
     private:
         std::pair<VmExpID, VmExp&> help_new_vmx(VmExpKind kind);
+        template <typename F> VmExpID new_shared_vmx(F&& make);
     public:
         VmExpID new_vmx_halt();
         VmExpID new_vmx_refer_local(size_t n, VmExpID x);
@@ -158,8 +357,8 @@ namespace ss {
         VmExpID new_vmx_constant(OBJECT constant, VmExpID next);
         VmExpID new_vmx_close(size_t vars_count, VmExpID body, VmExpID next);
         VmExpID new_vmx_test(VmExpID next_if_t, VmExpID next_if_f);
-        VmExpID new_vmx_conti(VmExpID x);
-        VmExpID new_vmx_nuate(OBJECT stack, VmExpID x);
+        VmExpID new_vmx_conti(size_t n, VmExpID x);
+        VmExpID new_vmx_nuate(VmExpID x);
         VmExpID new_vmx_frame(VmExpID fn_body_x, VmExpID post_ret_x);
         VmExpID new_vmx_argument(VmExpID x);
         VmExpID new_vmx_apply();
@@ -170,8 +369,13 @@ namespace ss {
         VmExpID new_vmx_assign_local(size_t n, VmExpID next);
         VmExpID new_vmx_assign_free(size_t n, VmExpID next);
         VmExpID new_vmx_assign_global(size_t gn, VmExpID next);
+        VmExpID new_vmx_assign_local_unboxed(size_t n, VmExpID next);
         VmExpID new_vmx_shift(ssize_t n, ssize_t m, VmExpID x);
         VmExpID new_vmx_pinvoke(ssize_t arg_count, size_t platform_proc_idx, VmExpID x);
+        VmExpID new_vmx_prim(VmExpKind prim_kind, size_t platform_proc_idx, VmExpID x);
+        VmExpID new_vmx_call_global(size_t gn, VmExpID body);
+        VmExpID new_vmx_shift_call_global(size_t gn, VmExpID body, ssize_t n, ssize_t m);
+        VmExpID new_vmx_self_tail_call(size_t gn, VmExpID body, ssize_t n);
 
     // Globals:
     public:
@@ -183,16 +387,29 @@ namespace ss {
     // Platform procedures:
     public:
         PlatformProcID define_platform_proc(IntStr platform_proc_name, std::vector<IntStr> arg_names, PlatformProcCb callable_cb, std::string docstring, bool is_variadic);
+        PlatformProcID define_platform_proc(IntStr platform_proc_name, std::vector<IntStr> arg_names, PlatformProcFn fn, std::string docstring);
         PlatformProcID lookup_platform_proc(IntStr platform_proc_name);
         PlatformProcCb platform_proc_cb(PlatformProcID id) { return m_pproc_tab.cb(id); }
         bool platform_proc_is_variadic(PlatformProcID id) { return m_pproc_tab.metadata(id).arity < 0; }
         ssize_t platform_proc_arity(PlatformProcID id) { return m_pproc_tab.metadata(id).arity; }
         size_t count_platform_procs() const { return m_pproc_tab.size(); }
 
+    // Primitives:
+    // A platform procedure may be bound to a primitive VmExpKind: the compiler then emits that kind in
+    // place of 'p/invoke'. The primitive's fast-path must agree with the procedure's callback, which it
+    // calls on a type mismatch.
+    public:
+        void set_platform_proc_prim(PlatformProcID id, VmExpKind prim_kind);
+        VmExpKind platform_proc_prim(PlatformProcID id) const;      // VmExpKind::PInvoke if not bound
+
+    // GC roots: the constants and subr source objects referenced by this code, cf `VirtualMachine::collect`
+    public:
+        void mark(GcMarker& marker) const;
+
     // dump:
     public:
         void dump(std::ostream& out) const;
-        void print_all_exps(std::ostream& out) const;
+        void print_all_exps(std::ostream& out, bool show_fusions = false) const;
         void print_one_exp(VmExpID exp_id, std::ostream& out) const;
         void print_all_files(std::ostream& out) const;
     };
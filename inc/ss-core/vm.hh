@@ -6,6 +6,9 @@
 #include "ss-core/compiler.hh"
 #include "ss-core/std.hh"
 #include "ss-core/vcode.hh"
+#include "ss-core/vthread.hh"
+#include "ss-core/jit.hh"
+#include "ss-core/heap-profile.hh"
 
 namespace ss {
 
@@ -15,6 +18,20 @@ namespace ss {
 
     class VirtualMachine;
 
+    // VmEngine selects how a VM executes VCode:
+    // - Graph walks VmExp records directly: simplest, used as a reference implementation.
+    // - Bytecode lowers VCode into a dense VBytecode stream and runs it with threaded dispatch.
+    // - Register runs the same way, but lowers primitives of locals and constants into three-address
+    //   instructions over the frame's slots (cf `VBytecode`), so that fewer instructions run: the stack, and
+    //   so continuations and VThreads, are unchanged. It is never JIT-compiled.
+    enum class VmEngine {
+        Graph,
+        Bytecode,
+        Register
+    };
+    // vm_engine_name is the name `ssi` selects `engine` by, e.g. 'bytecode'.
+    char const* vm_engine_name(VmEngine engine);
+
     //
     // Virtual machine:
     //
@@ -22,17 +39,75 @@ namespace ss {
     // create_vm instantiates a VM.
     VirtualMachine* create_vm(
         Gc* gc,
-        VirtualMachineStandardProcedureBinder binder = bind_standard_procedures
+        VirtualMachineStandardProcedureBinder binder = bind_standard_procedures,
+        VmEngine engine = VmEngine::Bytecode
     );
 
     // destroy_vm destroys a VM.
     // TODO: clean up after destroying VM.
     void destroy_vm(VirtualMachine* vm);
 
-    // getting GC front-end:
-    // since only single-threaded, just one thread front-end
-    static_assert(GC_SINGLE_THREADED_MODE);
+    // getting GC front-end and GC:
+    // each VThread has its own front-end: this returns that of the VThread running on the calling OS thread, 
+    // else that of the main VThread.
+    // vm_gc returns the GC shared by every VThread, e.g. for `Gc::stats`.
     GcThreadFrontEnd* vm_gc_tfe(VirtualMachine* vm);
+    Gc* vm_gc(VirtualMachine* vm);
+
+    // VThreads:
+    // A VM runs each line on its main VThread, and may spawn more to run on a pool of worker OS threads.
+    // These may only be called while the VM is running, i.e. from platform procedures:
+    // - vm_spawn_vthread queues `thunk` to run on a new VThread, returning its ID.
+    // - vm_yield_vthread suspends the running VThread, letting others run first.
+    // - vm_join_vthread suspends the running VThread until VThread `id` halts: the result of `join` is 
+    //   then the result of `id`. Each VThread may be joined once: its ID is then reused by later spawns.
+    // Each subr waits for every VThread it spawned before it returns.
+    OBJECT vm_spawn_vthread(VirtualMachine* vm, OBJECT thunk);
+    void vm_yield_vthread(VirtualMachine* vm);
+    void vm_join_vthread(VirtualMachine* vm, VThreadID id);
+    // vm_set_worker_count sets how many OS threads run VThreads, the VM's own included: by default, one per 
+    // hardware thread. This may only be called between lines, e.g. to compare results across worker counts.
+    void vm_set_worker_count(VirtualMachine* vm, size_t worker_count);
+    // vm_vthread_count counts the VThreads made so far, the main one included, less those reused: each 
+    // collection scans them all.
+    size_t vm_vthread_count(VirtualMachine* vm);
+
+    // Parallel bulk operations: cf `VmBulkTask`
+    // Each splits its items into chunks, each run by a VThread of its own (and so with a GC front-end of its 
+    // own), which idle workers steal. Like `vm_join_vthread`, these suspend the running VThread until every
+    // chunk is done, so may only be called from platform procedures: the result of the PInvoke is then the 
+    // operation's. Without any items, they return at once.
+    // - vm_parallel_vector_map applies `proc` to each item of `items`, a vector or numeric vector, returning a 
+    //   new vector of the results: each chunk stores into its own range of it, so none takes a lock.
+    // - vm_parallel_for_each applies `proc` to each index in [begin, end), for effect.
+    // - vm_parallel_fold folds `items` with `(combine acc item)`, from `init`: each chunk folds its own items 
+    //   from `init`, then chunks' results are combined pairwise in order, so `combine` must be associative, and
+    //   `init` its identity.
+    OBJECT vm_parallel_vector_map(VirtualMachine* vm, OBJECT proc, OBJECT items);
+    OBJECT vm_parallel_for_each(VirtualMachine* vm, OBJECT proc, ssize_t begin, ssize_t end);
+    OBJECT vm_parallel_fold(VirtualMachine* vm, OBJECT combine, OBJECT init, OBJECT items);
+
+    // Calling back into Scheme from a hash table: unlike the above, `proc` runs on the running VThread, nested in
+    // the platform procedure's call, so it may not join a VThread, nor use a channel.
+    // - vm_hash_table_walk applies `proc` to each key and value of `table`, in no particular order: the entries
+    //   are copied first, so `proc` may modify the table.
+    // - vm_hash_table_update stores `(proc value)` under `key` in `table`.
+    OBJECT vm_hash_table_walk(VirtualMachine* vm, OBJECT table, OBJECT proc);
+    OBJECT vm_hash_table_update(VirtualMachine* vm, OBJECT table, OBJECT key, OBJECT proc, OBJECT value);
+
+    // Channels: cf `ChannelObject`
+    // Like the above, these may only be called from platform procedures, on a channel:
+    // - vm_channel_send queues `message`, suspending the running VThread while the channel is full.
+    // - vm_channel_receive returns a copy of the oldest message, suspending the running VThread while the channel 
+    //   is empty: the result of the PInvoke is then the message, like the result of `join`.
+    // - the batch variants never suspend: they send (or receive) as many of `count` messages as they can at 
+    //   once, returning how many.
+    // On the main VThread, a send or receive fails instead of suspending once no other VThread is live to 
+    // complete it.
+    OBJECT vm_channel_send(VirtualMachine* vm, OBJECT channel, OBJECT message);
+    OBJECT vm_channel_receive(VirtualMachine* vm, OBJECT channel);
+    size_t vm_channel_try_send_batch(VirtualMachine* vm, OBJECT channel, OBJECT const* messages, size_t count);
+    size_t vm_channel_try_receive_batch(VirtualMachine* vm, OBJECT channel, OBJECT* out, size_t count);
 
     void vm_bind_platform_procedure(
         VirtualMachine* vm, 
@@ -43,13 +118,38 @@ namespace ss {
         bool is_variadic = false
     );
 
+    // Allocation-free platform procedures:
+    // - fixed-arity procedures (at most 4 args) receive their arguments directly, variadic ones an `ArgSpan`.
+    // - PInvoke calls these function-pointers directly, passing `ctx` through.
+    void vm_bind_platform_procedure(VirtualMachine* vm, std::string proc_name, PlatformProcFn0 fn, std::vector<std::string> arg_names, std::string docstring_more = "", void* ctx = nullptr);
+    void vm_bind_platform_procedure(VirtualMachine* vm, std::string proc_name, PlatformProcFn1 fn, std::vector<std::string> arg_names, std::string docstring_more = "", void* ctx = nullptr);
+    void vm_bind_platform_procedure(VirtualMachine* vm, std::string proc_name, PlatformProcFn2 fn, std::vector<std::string> arg_names, std::string docstring_more = "", void* ctx = nullptr);
+    void vm_bind_platform_procedure(VirtualMachine* vm, std::string proc_name, PlatformProcFn3 fn, std::vector<std::string> arg_names, std::string docstring_more = "", void* ctx = nullptr);
+    void vm_bind_platform_procedure(VirtualMachine* vm, std::string proc_name, PlatformProcFn4 fn, std::vector<std::string> arg_names, std::string docstring_more = "", void* ctx = nullptr);
+    void vm_bind_platform_procedure(VirtualMachine* vm, std::string proc_name, PlatformProcFnV fn, std::vector<std::string> arg_names, std::string docstring_more = "", void* ctx = nullptr);
+
+    // vm_bind_platform_procedure_prim lets the compiler inline calls to an already-bound platform 
+    // procedure as the primitive `prim_kind`, cf `VCode::set_platform_proc_prim`.
+    void vm_bind_platform_procedure_prim(
+        VirtualMachine* vm,
+        std::string const& proc_name,
+        VmExpKind prim_kind
+    );
+
     // Getting VM compiler:
     // Used to bind globals, compile source code.
     // Should only be directly used by the linker: each library has its own env, and
     // its own compiler; the linker splices libraries into the main program.
     Compiler* vm_compiler(VirtualMachine* vm);
 
-    // interp interface:
+    // Native code built ahead of time for the VM's code, cf `aot.hh`:
+    // - vm_code_entry returns the address of the bytecode word of `exp_id`, lowering it if required.
+    // - vm_install_native_entry makes the bytecode engine enter `code` at that word, as it enters JIT-compiled 
+    //   code: cf `VJit::install`. This must be called before the VM runs.
+    VmCodePtr vm_code_entry(VirtualMachine* vm, VmExpID exp_id);
+    void vm_install_native_entry(VirtualMachine* vm, VmExpID exp_id, JitCode code);
+
+    // interp interface: the code compiled for each call is freed once it cannot be entered again, cf `vm_stream_lines`.
     OBJECT vm_interp_expr(VirtualMachine* vm, OBJECT line_code_obj);
     OBJECT vm_interp_subr(VirtualMachine* vm, std::vector<OBJECT> line_code_objs, bool print_each_line);
 
@@ -57,7 +157,43 @@ namespace ss {
     // evaluating each subr in the order it was encountered.
     OBJECT sync_execute_vm(VirtualMachine* vm, bool print_each_line);
 
+    // Streaming execution: for unbounded inputs, e.g. commands fed over a pipe, cf `parse_each_line_from_stream`.
+    // - vm_begin_streaming initializes globals like `sync_execute_vm`, which it replaces.
+    // - vm_stream_lines expands, compiles, and runs lines' syntax objects before returning the last result: these 
+    //   may use and define globals like the lines of a subr. 
+    //   The lines are not kept once they have run, and neither is the code compiled for them: it is freed at
+    //   once, or by a collection once nothing may enter it again, e.g. closures it made, so that memory stays 
+    //   bounded however many lines are run.
+    // Each call waits for every VThread its lines spawned.
+    void vm_begin_streaming(VirtualMachine* vm);
+    OBJECT vm_stream_lines(VirtualMachine* vm, std::vector<OBJECT> line_code_objs, bool print_each_line);
+
+    // Snapshots: a VM set up once, e.g. with its prelude run, may serve each request from a copy of its own.
+    // - vm_fork forks the calling process, returning like `fork`: the child's process ID in the parent, 0 in the
+    //   child, or -1 if it could not, e.g. on Windows. The child's VM is a copy-on-write snapshot of the 
+    //   parent's code, globals, platform procedures, and heap, so it runs in isolation without their setup.
+    // - it must be called between runs, e.g. between streamed lines, by the OS thread that runs the VM: it 
+    //   collects first, stops the VM's worker OS threads (which a child does not inherit: each VM starts them 
+    //   again on its next spawn), and flushes the standard ports.
+    int64_t vm_fork(VirtualMachine* vm);
+
     // dump_vm prints the VM's state for debug information.
     void dump_vm(VirtualMachine* vm, std::ostream& out);
 
+    // Profiling:
+    // - vm_enable_profiler makes the VM count each instruction, closure call, and platform procedure
+    //   call it executes from now on, and sample the time spent in each closure.
+    //   This must be called before the VM runs.
+    // - vm_print_profile prints a report of these counts, summed over all VThreads, most frequent first.
+    void vm_enable_profiler(VirtualMachine* vm);
+    void vm_print_profile(VirtualMachine* vm, std::ostream& out);
+
+    // Heap profiling:
+    // - vm_enable_heap_profiler samples allocations once every `period` bytes on average, and attributes each to
+    //   the Scheme code making it: cf `VmHeapProfile`. This must be called before the VM runs.
+    // - vm_write_heap_profile writes the samples so far in pprof's format, e.g. for `go tool pprof`: it returns
+    //   false if heap profiling is not enabled, or if `out` fails.
+    void vm_enable_heap_profiler(VirtualMachine* vm, size_t period = VmHeapProfile::DEFAULT_SAMPLE_PERIOD);
+    bool vm_write_heap_profile(VirtualMachine* vm, std::ostream& out);
+
 }
\ No newline at end of file
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <vector>
+#include <optional>
+#include <mutex>
+#include <atomic>
+#include <memory>
 #include "ss-core/common.hh"
 #include "ss-core/object.hh"
 #include "ss-core/gc.hh"
@@ -20,17 +24,41 @@ namespace ss {
         void init();
     };
 
+    // VmStack: a contiguous stack of OBJECTs.
+    // - the whole capacity is reserved as virtual memory up-front, but only committed on demand: the
+    //   uncommitted remainder (and a trailing page) are inaccessible, so they act as a guard region.
+    // - pushing past the committed limit commits more, or raises a Scheme error once the capacity is 
+    //   exhausted.
+    // - `trim` decommits pages left behind after a deep recursion unwinds.
+    // - fresh pages are zero-filled, i.e. `OBJECT::null`.
     class VmStack {
+    public:
+        inline static constexpr size_t MIN_COMMITTED_BYTES = (64 << 10);
+
     private:
-        std::vector<OBJECT> m_items;
+        OBJECT* m_items;
+        size_t m_capacity;          // reserved item count
+        ssize_t m_limit;            // committed item count: items at or above this are guarded
+        size_t m_reserved_bytes;    // including the trailing guard page
+
+        // Items below `m_captured_height` are unchanged since they were captured into (or restored from) 
+        // `m_captured`, a chain of `StackSegmentObject`s. Captures reuse the segments below this mark.
+        // cf `VirtualMachine::save_stack`
+        OBJECT m_captured;
+        ssize_t m_captured_height;
 
     public:
-        explicit VmStack(size_t capacity)
-        :   m_items(capacity, OBJECT::null)
-        {}
+        explicit VmStack(size_t capacity);
+        ~VmStack();
+        VmStack(VmStack const&) = delete;
+        VmStack& operator=(VmStack const&) = delete;
 
     public:
         ssize_t push(OBJECT x, ssize_t s) {
+            // a single unsigned comparison detects both 's < m_captured_height' and 's >= m_limit'.
+            if (static_cast<size_t>(s - m_captured_height) >= static_cast<size_t>(m_limit - m_captured_height)) {
+                push_slow_path(s);
+            }
             m_items[s] = x;
             return s + 1;
         }
@@ -38,31 +66,203 @@ namespace ss {
             return m_items[s - i - 1];
         }
         void index_set(ssize_t s, ssize_t i, OBJECT v) {
-            m_items[s - i - 1] = v;
+            ssize_t j = s - i - 1;
+            m_items[j] = v;
+            if (j < m_captured_height) {
+                m_captured_height = j;
+            }
         }
+        // shift moves the top `n` items down by `m` items, over the items below them, returning the new top.
+        // cf three-imp p.111
+        ssize_t shift(ssize_t s, ssize_t n, ssize_t m) {
+            // usually only a few items: a plain loop beats a call to 'memmove'.
+            ssize_t j = s - n - m;
+            for (ssize_t i = s - n; i < s; i++) {
+                m_items[i - m] = m_items[i];
+            }
+            if (n > 0 && j < m_captured_height) {
+                m_captured_height = j;
+            }
+            return s - m;
+        }
+    private:
+        void push_slow_path(ssize_t s);
     
     public:
-        std::vector<OBJECT>::iterator begin() { return m_items.begin(); }
-        size_t capacity() { return m_items.size(); }
+        OBJECT captured() const { return m_captured; }
+        ssize_t captured_height() const { return m_captured_height; }
+        void set_captured(OBJECT segments, ssize_t height) {
+            m_captured = segments;
+            m_captured_height = height;
+        }
+    
+    // Committing memory:
+    public:
+        // commit ensures items [0, count) are accessible.
+        void commit(ssize_t count);
+        // trim decommits pages above 's' that are not required by the minimum committed size.
+        void trim(ssize_t s);
+
+    public:
+        OBJECT* data() { return m_items; }
+        OBJECT const* data() const { return m_items; }
+        size_t capacity() const { return m_capacity; }
+        size_t committed_count() const { return m_limit; }
+    };
+
+    using VThreadID = ssize_t;
+    class VmProfile;
+
+    // VThreadState: a VThread is...
+    // - Runnable while queued (or running) on a worker,
+    // - Blocked while it waits to join another VThread, or on a channel,
+    // - Done once it halts, after which only its result (the accumulator) is kept,
+    // - Free once its result is joined, until it is reused for another spawn, cf `VirtualMachine::reclaim_vthread`.
+    enum class VThreadState {
+        Runnable,
+        Blocked,
+        Done,
+        Free
+    };
+
+    // VThreadSuspend: why a VThread asked to be suspended, cf `VThread::request_suspend`
+    enum class VThreadSuspend {
+        None,
+        Yield,
+        Join,
+        Send,
+        Receive
+    };
+
+    // VmBulkKind: what each chunk of a parallel bulk operation does with its items, cf `vm_parallel_vector_map`
+    // - Map stores the result of applying the procedure to each item in the output vector,
+    // - ForEach applies the procedure to each index, for effect,
+    // - Fold applies the combiner to its accumulator and each item, then to its accumulator and each child's.
+    enum class VmBulkKind {
+        Map,
+        ForEach,
+        Fold
     };
 
-    class VThread {        
+    // VmBulkTask: one chunk of a parallel bulk operation, run by a VThread of its own.
+    // - the VThread halts after each call: between calls, the VM stores the last result, then sets up the 
+    //   next call, cf `VirtualMachine::step_bulk_task`.
+    // - once its own items are done, a chunk joins each of its children in index order: chunks form a tree,
+    //   so a fold combines its partial results pairwise, and the root halts with the operation's result.
+    // - the procedure, the items, and the result (the output vector, or a fold's accumulator) are held at the 
+    //   base of the VThread's stack, cf `BASE_COUNT`, so that collections find (and move) them.
+    struct VmBulkTask {
+        enum class Step {
+            Start,
+            Call,       // the procedure was applied to item `next - 1`
+            Join,       // a child was joined
+            Combine     // the combiner was applied to a child's result
+        };
+        inline static constexpr ssize_t PROC_SLOT = 0;
+        inline static constexpr ssize_t ITEMS_SLOT = 1;
+        inline static constexpr ssize_t RESULT_SLOT = 2;
+        inline static constexpr ssize_t BASE_COUNT = 3;
+        // chunks are at least `MIN_CHUNK_SIZE` items, and at most `CHUNKS_PER_WORKER` per worker OS thread:
+        inline static constexpr size_t MIN_CHUNK_SIZE = 256;
+        inline static constexpr size_t CHUNKS_PER_WORKER = 4;
+
+        VmBulkKind kind;
+        Step step;
+        ssize_t next;
+        ssize_t end;
+        std::vector<VThreadID> children;
+        size_t joined_count;
+    };
+
+    // VThread: a green thread of a VirtualMachine.
+    // - each owns its registers, stack, and GC front-end, so that many can run on a pool of OS threads.
+    // - platform procedures (e.g. `yield`) may ask the running VThread to suspend: the engine then saves
+    //   its registers and returns to the scheduler after the current PInvoke.
+    class VThread {
     private:
+        VThreadID m_id;
         VmRegs m_regs;
-        VmStack m_stack;
-        GcThreadFrontEnd m_gc_tfe;
+        size_t m_stack_capacity;
+        std::optional<VmStack> m_stack;
+        std::optional<GcThreadFrontEnd> m_gc_tfe;
+
+        // scheduling state: `m_state`, `m_failed`, and `m_joiners` are guarded by `m_mutex`.
+        std::mutex m_mutex;
+        std::atomic<VThreadState> m_state;
+        bool m_failed;
+        std::vector<VThread*> m_joiners;
+        VThreadSuspend m_suspend;
+        VThreadID m_suspend_arg;
+        OBJECT m_suspend_obj;       // what the VThread waits on, e.g. a channel: a GC root until resumed
+
+        // the instruction allocating, and its closure: only published by the bytecode engines' allocating 
+        // instructions, for sampled allocations, cf `VmHeapProfile`. Not a GC root: cleared by each collection.
+        VmExpID m_alloc_x;
+        OBJECT m_alloc_c;
+
+        // only set in profiling mode, and kept after `release`:
+        std::unique_ptr<VmProfile> m_profile;
+
+        // only set for the chunks of bulk operations:
+        std::unique_ptr<VmBulkTask> m_bulk_task;
+
     public:
-        VThread(Gc* gc, size_t stack_capacity = (4<<20))
-        :   m_regs(),
-            m_stack(stack_capacity),
-            m_gc_tfe(gc)
-        {}
+        explicit VThread(Gc* gc, VThreadID id = 0, size_t stack_capacity = (4<<20));
+        ~VThread();
     public:
         void init();
+        // release frees the stack and GC front-end of a VThread that is Done.
+        void release();
+        // recycle drops the result of a released VThread once it is joined, leaving it Free, and `reuse` readies
+        // a Free VThread to run again, with a new stack and GC front-end. Its profile is kept throughout.
+        void recycle();
+        void reuse(Gc* gc);
     public:
+        inline VThreadID id() const { return m_id; }
         inline VmRegs& regs() { return m_regs; }
-        inline VmStack& stack() { return m_stack; }
-        inline GcThreadFrontEnd* gc_tfe() { return &m_gc_tfe; }
+        inline VmStack& stack() { return *m_stack; }
+        inline bool has_stack() const { return m_stack.has_value(); }
+        inline GcThreadFrontEnd* gc_tfe() { return &*m_gc_tfe; }
+        inline VmProfile* profile() { return m_profile.get(); }
+        void enable_profile();
+        inline VmBulkTask* bulk_task() { return m_bulk_task.get(); }
+        void set_bulk_task(VmBulkTask task) { m_bulk_task = std::make_unique<VmBulkTask>(std::move(task)); }
+    
+    // Suspension:
+    public:
+        void request_suspend(VThreadSuspend suspend, VThreadID arg = -1) {
+            m_suspend = suspend;
+            m_suspend_arg = arg;
+        }
+        void request_suspend(VThreadSuspend suspend, OBJECT obj) {
+            m_suspend = suspend;
+            m_suspend_obj = obj;
+        }
+        bool suspend_requested() const { return m_suspend != VThreadSuspend::None; }
+        VThreadSuspend suspend() const { return m_suspend; }
+        VThreadID suspend_arg() const { return m_suspend_arg; }
+        OBJECT& suspend_obj() { return m_suspend_obj; }
+        void clear_suspend() { m_suspend = VThreadSuspend::None; }
+
+    // Allocation sites: `x` is a bytecode word's address, like `regs().x` in the bytecode engines.
+    public:
+        void publish_alloc_site(VmExpID x, OBJECT c) {
+            m_alloc_x = x;
+            m_alloc_c = c;
+        }
+        void clear_alloc_site() { m_alloc_x = 0; }
+        bool has_alloc_site() const { return m_alloc_x != 0; }
+        VmExpID alloc_x() const { return m_alloc_x; }
+        OBJECT alloc_c() const { return m_alloc_c; }
+
+    // Scheduling:
+    public:
+        std::mutex& mutex() { return m_mutex; }
+        VThreadState state() const { return m_state.load(std::memory_order_acquire); }
+        void set_state(VThreadState state) { m_state.store(state, std::memory_order_release); }
+        bool failed() const { return m_failed; }
+        void set_failed(bool failed = true) { m_failed = failed; }
+        std::vector<VThread*>& joiners() { return m_joiners; }
     };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,21 @@
+; VThreads: fibonacci on several workers
+
+(define fib 
+  (lambda (n) 
+    (if (p/invoke < n 2) 
+        n 
+        (p/invoke + (fib (p/invoke - n 1)) (fib (p/invoke - n 2))))))
+
+(define spawn-fib (lambda (n) (p/invoke spawn (lambda () (fib n)))))
+
+(define a (spawn-fib 25))
+(define b (spawn-fib 24))
+(define c (p/invoke spawn (lambda () (p/invoke + (p/invoke join a) (p/invoke join b)))))
+(p/invoke displayln (p/invoke join c))
+
+(define count-down 
+  (lambda (n) 
+    (if (p/invoke = n 0) 
+        'done 
+        (begin (p/invoke yield) (count-down (p/invoke - n 1))))))
+(p/invoke displayln (p/invoke join (p/invoke spawn (lambda () (count-down 100)))))
@@ -0,0 +1,15 @@
+; Parallel bulk operations: chunks of a vector on several workers
+
+(define square (lambda (x) (p/invoke * x x)))
+(define add (lambda (a b) (p/invoke + a b)))
+
+(define xs (p/invoke parallel-vector-map (lambda (x) (p/invoke + x 1)) (p/invoke make-s64vector 100000 2)))
+(p/invoke displayln (p/invoke parallel-fold add 0 (p/invoke parallel-vector-map square xs)))
+
+(define ys (p/invoke parallel-vector-map (lambda (x) 0) xs))
+(p/invoke parallel-for-each (lambda (i) (p/invoke vector-set! ys i i)) 0 100000)
+(p/invoke displayln (p/invoke parallel-fold add 0 ys))
+
+; `combine` need only be associative: chunks' results are combined in order.
+(define concat (lambda (a b) (if (p/invoke null? a) b (p/invoke cons (p/invoke car a) (concat (p/invoke cdr a) b)))))
+(p/invoke displayln (p/invoke parallel-fold concat '() (p/invoke parallel-vector-map (lambda (x) (p/invoke list x)) (p/invoke f64vector 1 2 3 4))))
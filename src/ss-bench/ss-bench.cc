@@ -0,0 +1,340 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <filesystem>
+
+#include "ss-core/feedback.hh"
+#include "ss-core/gc.hh"
+#include "ss-core/cli.hh"
+#include "ss-core/parser.hh"
+#include "ss-core/printing.hh"
+#include "ss-core/vm.hh"
+#include "ss-core/compiler.hh"
+#include "ss-core/expander.hh"
+#include "ss-core/library.hh"
+
+///
+// ss-bench: times each phase of running each program in a corpus, plus GC allocation, and prints JSON.
+// E.g.
+//  ss-bench bench/*.scm -engine bytecode -reps 10 -warmup 2 -out bench.json
+// - each repetition runs on a fresh VM: 'parse', 'expand', 'compile', and 'execute' are timed separately.
+// - warm-up repetitions are run first, and not recorded.
+// - the result of each program (its last line) is recorded too, so runs can be checked against each other.
+//
+
+namespace ss {
+
+    using BenchClock = std::chrono::steady_clock;
+
+    struct BenchArgs {
+        std::vector<std::string> program_paths;
+        std::string snail_root;
+        std::string out_path;
+        VmEngine engine;
+        size_t rep_count;
+        size_t warmup_count;
+    };
+
+    // BenchSamples: the time taken by each repetition of one phase, in milliseconds
+    struct BenchSamples {
+        std::string name;
+        std::vector<double> ms;
+    };
+
+    struct BenchProgramReport {
+        std::string name;
+        std::string path;
+        std::string result;
+        bool ok;
+        std::vector<BenchSamples> phases;
+    };
+
+    BenchArgs parse_cli_args(int argc, char const* argv[]) {
+        CliArgsParser parser;
+        parser.add_ar1_option_rule("snail-root");
+        parser.add_ar1_option_rule("engine");
+        parser.add_ar1_option_rule("reps");
+        parser.add_ar1_option_rule("warmup");
+        parser.add_ar1_option_rule("out");
+        CliArgs raw = parser.parse(argc, argv);
+
+        BenchArgs res; {
+            if (raw.pos.empty()) {
+                error("Expected at least 1 positional argument, denoting a program to benchmark: got 0");
+                throw SsiError();
+            }
+            res.program_paths = raw.pos;
+
+            auto snail_root_it = raw.ar1.find("snail-root");
+            res.snail_root = (snail_root_it == raw.ar1.end() ? std::string{"./snail-venv"} : snail_root_it->second);
+
+            auto out_it = raw.ar1.find("out");
+            res.out_path = (out_it == raw.ar1.end() ? std::string{} : out_it->second);
+
+            auto engine_it = raw.ar1.find("engine");
+            if (engine_it == raw.ar1.end() || engine_it->second == "bytecode") {
+                res.engine = VmEngine::Bytecode;
+            } else if (engine_it->second == "graph") {
+                res.engine = VmEngine::Graph;
+            } else if (engine_it->second == "register") {
+                res.engine = VmEngine::Register;
+            } else {
+                std::stringstream ss;
+                ss << "Unknown engine '" << engine_it->second << "': expected 'bytecode', 'register', or 'graph'";
+                error(ss.str());
+                throw SsiError();
+            }
+
+            auto reps_it = raw.ar1.find("reps");
+            res.rep_count = (reps_it == raw.ar1.end() ? 5 : strtoull(reps_it->second.c_str(), nullptr, 10));
+            auto warmup_it = raw.ar1.find("warmup");
+            res.warmup_count = (warmup_it == raw.ar1.end() ? 1 : strtoull(warmup_it->second.c_str(), nullptr, 10));
+            if (res.rep_count == 0) {
+                error("Expected '-reps' to be at least 1");
+                throw SsiError();
+            }
+        }
+        return res;
+    }
+
+    static double elapsed_ms(BenchClock::time_point start, BenchClock::time_point end) {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    ///
+    // Programs:
+    //
+
+    // run_program_once runs `source` on a fresh VM, adding the time taken by each phase to `phases`.
+    // Returns false iff an error was reported.
+    static bool run_program_once(
+        Gc* gc, BenchArgs const& args, std::string const& path, std::string const& source,
+        std::vector<BenchSamples>* phases, std::string* result
+    ) {
+        VirtualMachine* vm = create_vm(gc, bind_standard_procedures, args.engine);
+        bool ok = true;
+        try {
+            auto t0 = BenchClock::now();
+            Parser* p = create_parser(std::string_view{source}, path, vm_gc_tfe(vm));
+            std::vector<OBJECT> line_code_obj_array = parse_all_subsequent_lines(p);
+            dispose_parser(p);
+
+            auto t1 = BenchClock::now();
+            Compiler& compiler = *vm_compiler(vm);
+            VCode* code = compiler.code();
+            auto expanded_line_code_obj_array = macroexpand_syntax(
+                *vm_gc_tfe(vm),
+                code->def_tab(),
+                code->pproc_tab(),
+                std::move(line_code_obj_array)
+            );
+
+            auto t2 = BenchClock::now();
+            VSubr subr = compiler.compile_subr(path, std::move(expanded_line_code_obj_array));
+            code->enqueue_main_subr(path, std::move(subr));
+
+            auto t3 = BenchClock::now();
+            OBJECT res = sync_execute_vm(vm, false);
+            auto t4 = BenchClock::now();
+
+            if (phases) {
+                (*phases)[0].ms.push_back(elapsed_ms(t0, t1));
+                (*phases)[1].ms.push_back(elapsed_ms(t1, t2));
+                (*phases)[2].ms.push_back(elapsed_ms(t2, t3));
+                (*phases)[3].ms.push_back(elapsed_ms(t3, t4));
+            }
+            if (result) {
+                std::stringstream ss;
+                ss << res;
+                *result = ss.str();
+            }
+        } catch (SsiError const&) {
+            ok = false;
+        }
+        destroy_vm(vm);
+        return ok;
+    }
+
+    static BenchProgramReport bench_program(Gc* gc, BenchArgs const& args, std::string const& path) {
+        BenchProgramReport report;
+        report.name = std::filesystem::path{path}.stem().string();
+        report.path = path;
+        report.ok = true;
+        report.phases = {{"parse", {}}, {"expand", {}}, {"compile", {}}, {"execute", {}}};
+
+        std::ifstream f{path};
+        if (!f.is_open()) {
+            std::stringstream ss;
+            ss << "Failed to load file \"" << path << "\" to benchmark.";
+            error(ss.str());
+            report.ok = false;
+            return report;
+        }
+        std::stringstream source_ss;
+        source_ss << f.rdbuf();
+        std::string source = source_ss.str();
+
+        for (size_t i = 0; i < args.warmup_count && report.ok; i++) {
+            report.ok = run_program_once(gc, args, path, source, nullptr, nullptr);
+        }
+        for (size_t i = 0; i < args.rep_count && report.ok; i++) {
+            report.ok = run_program_once(gc, args, path, source, &report.phases, &report.result);
+        }
+        return report;
+    }
+
+    ///
+    // GC microbenchmarks:
+    // Each allocates objects of one size in batches, freeing each batch before the next, so that the
+    // front-end's fast path is measured rather than heap growth.
+    //
+
+    static BenchSamples bench_gc_alloc_free(Gc* gc, BenchArgs const& args, size_t object_size) {
+        size_t constexpr batch_size = 4096;
+        size_t constexpr batch_count = 256;
+
+        std::stringstream name_ss;
+        name_ss << "alloc-free-" << object_size;
+        BenchSamples samples{name_ss.str(), {}};
+
+        gc::SizeClassIndex sci = gc::sci(object_size);
+        std::vector<APtr> batch(batch_size);
+        GcThreadFrontEnd gc_tfe{gc};
+        for (size_t rep = 0; rep < args.warmup_count + args.rep_count; rep++) {
+            auto start = BenchClock::now();
+            for (size_t i = 0; i < batch_count; i++) {
+                for (size_t j = 0; j < batch_size; j++) {
+                    batch[j] = gc_tfe.allocate_size_class(sci);
+                }
+                for (size_t j = 0; j < batch_size; j++) {
+                    gc_tfe.deallocate_size_class(batch[j], sci);
+                }
+            }
+            auto end = BenchClock::now();
+            if (rep >= args.warmup_count) {
+                samples.ms.push_back(elapsed_ms(start, end));
+            }
+        }
+        return samples;
+    }
+
+    ///
+    // JSON:
+    //
+
+    static void print_json_string(std::ostream& out, std::string const& s) {
+        out << '"';
+        for (char c: s) {
+            switch (c) {
+                case '"': out << "\\\""; break;
+                case '\\': out << "\\\\"; break;
+                case '\n': out << "\\n"; break;
+                case '\t': out << "\\t"; break;
+                default: out << c; break;
+            }
+        }
+        out << '"';
+    }
+    static void print_json_samples(std::ostream& out, BenchSamples const& samples) {
+        std::vector<double> sorted = samples.ms;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double ms: sorted) {
+            sum += ms;
+        }
+        bool empty = sorted.empty();
+        out << "{\"min_ms\": " << (empty ? 0 : sorted.front())
+            << ", \"median_ms\": " << (empty ? 0 : sorted[sorted.size() / 2])
+            << ", \"mean_ms\": " << (empty ? 0 : sum / sorted.size())
+            << ", \"max_ms\": " << (empty ? 0 : sorted.back())
+            << ", \"samples_ms\": [";
+        for (size_t i = 0; i < samples.ms.size(); i++) {
+            out << (i ? ", " : "") << samples.ms[i];
+        }
+        out << "]}";
+    }
+    static void print_json_report(
+        std::ostream& out, BenchArgs const& args,
+        std::vector<BenchProgramReport> const& programs, std::vector<BenchSamples> const& gc_benches
+    ) {
+        out << "{" << std::endl;
+        out << "  \"engine\": \"" << vm_engine_name(args.engine) << "\"," << std::endl;
+        out << "  \"reps\": " << args.rep_count << "," << std::endl;
+        out << "  \"warmup\": " << args.warmup_count << "," << std::endl;
+        out << "  \"programs\": [" << std::endl;
+        for (size_t i = 0; i < programs.size(); i++) {
+            BenchProgramReport const& program = programs[i];
+            out << "    {\"name\": ";
+            print_json_string(out, program.name);
+            out << ", \"path\": ";
+            print_json_string(out, program.path);
+            out << ", \"ok\": " << (program.ok ? "true" : "false");
+            out << ", \"result\": ";
+            print_json_string(out, program.result);
+            out << "," << std::endl << "     \"phases\": {" << std::endl;
+            for (size_t j = 0; j < program.phases.size(); j++) {
+                out << "       \"" << program.phases[j].name << "\": ";
+                print_json_samples(out, program.phases[j]);
+                out << (j+1 < program.phases.size() ? "," : "") << std::endl;
+            }
+            out << "     }}" << (i+1 < programs.size() ? "," : "") << std::endl;
+        }
+        out << "  ]," << std::endl;
+        out << "  \"gc\": {" << std::endl;
+        for (size_t i = 0; i < gc_benches.size(); i++) {
+            out << "    \"" << gc_benches[i].name << "\": ";
+            print_json_samples(out, gc_benches[i]);
+            out << (i+1 < gc_benches.size() ? "," : "") << std::endl;
+        }
+        out << "  }" << std::endl;
+        out << "}" << std::endl;
+    }
+
+}   // namespace ss
+
+int main(int argc, char const* argv[]) {
+    ss::BenchArgs args;
+    try {
+        args = ss::parse_cli_args(argc, argv);
+    } catch (ss::SsiError const&) {
+        return 1;
+    }
+
+    // Initializing the GC, shared by every VM:
+    ss::Gc gc{ss::GIBIBYTES(4)};
+    if (!ss::CentralLibraryRepository::ensure_init(args.snail_root)) {
+        ss::error("Failed to initialize the Central Library Repository (CLR)");
+        return 2;
+    }
+
+    // Running:
+    std::vector<ss::BenchProgramReport> programs;
+    bool all_ok = true;
+    for (std::string const& path: args.program_paths) {
+        programs.push_back(ss::bench_program(&gc, args, path));
+        all_ok = all_ok && programs.back().ok;
+    }
+    std::vector<ss::BenchSamples> gc_benches;
+    for (size_t object_size: {16, 32, 64, 256}) {
+        gc_benches.push_back(ss::bench_gc_alloc_free(&gc, args, object_size));
+    }
+
+    // Reporting:
+    if (args.out_path.empty()) {
+        ss::print_json_report(std::cout, args, programs, gc_benches);
+    } else {
+        std::ofstream out{args.out_path};
+        if (!out.is_open()) {
+            std::stringstream ss;
+            ss << "Failed to open \"" << args.out_path << "\" to write the report.";
+            ss::error(ss.str());
+            return 2;
+        }
+        ss::print_json_report(out, args, programs, gc_benches);
+    }
+    return all_ok ? 0 : 3;
+}
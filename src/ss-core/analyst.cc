@@ -7,7 +7,7 @@ namespace ss {
     Analyst::Analyst()
     {}
 
-    void Analyst::check_vars_list_else_throw(FLoc loc, OBJECT vars) {
+    void Analyst::check_vars_list_else_throw(FLocID loc, OBJECT vars) {
         OBJECT rem_vars = vars;
         while (!rem_vars.is_null()) {
             OBJECT head = car(rem_vars);
@@ -16,7 +16,7 @@ namespace ss {
             if (!head.is_symbol()) {
                 std::stringstream ss;
                 ss << "Invalid variable list for lambda: expected symbol, got: " << head << std::endl;
-                ss << "see: " << loc.as_text();
+                ss << "see: " << FLocTable::loc(loc).as_text();
                 error(ss.str());
                 throw SsiError();
             }
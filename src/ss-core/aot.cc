@@ -0,0 +1,742 @@
+#include "ss-core/aot.hh"
+
+#include <sstream>
+#include <iomanip>
+#include <optional>
+#include <algorithm>
+#include <memory>
+
+#include "ss-core/allocator.hh"
+#include "ss-core/feedback.hh"
+#include "ss-core/cli.hh"
+#include "ss-core/gc.hh"
+#include "ss-core/port.hh"
+#include "ss-core/vm.hh"
+#include "ss-core/library.hh"
+#include "ss-core/vcode-cache.hh"
+
+namespace ss {
+
+    ///
+    // Emitting:
+    //
+
+    namespace {
+
+        constexpr size_t MIN_TRANSLATED_COUNT_PER_EXIT = 8;     // cf `JitTranslator::is_worth_it`
+
+        // AotUnitTranslator holds what the functions of a unit share: its bodies, and the table of slots.
+        class AotUnitTranslator {
+        private:
+            VCode& m_code;
+            VCodeUnitID m_unit;
+            std::vector<VmExpID> m_bodies;                                  // in order
+            robin_hood::unordered_flat_set<VmExpID> m_body_set;
+            std::vector<AotSlot> m_slots;
+            robin_hood::unordered_flat_map<uint64_t, size_t> m_slot_ids;   // by index and kind
+
+        public:
+            AotUnitTranslator(VCode& code, VCodeUnitID unit)
+            :   m_code(code),
+                m_unit(unit)
+            {
+                // every closure the unit makes, or known procedure it calls, has a body:
+                for (VmExpID x = vmx_id(unit, 0); x < code.end_exp_id(unit); x++) {
+                    VmExp const& exp = code[x];
+                    VmExpID body = -1;
+                    if (exp.kind == VmExpKind::Close) {
+                        body = exp.args.i_close.body;
+                    } else if (exp.kind == VmExpKind::CallGlobal || exp.kind == VmExpKind::ShiftCallGlobal) {
+                        body = exp.args.i_call_global.body;
+                    }
+                    if (body >= 0 && vmx_unit(body) == unit && m_body_set.insert(body).second) {
+                        m_bodies.push_back(body);
+                    }
+                }
+                std::sort(m_bodies.begin(), m_bodies.end());
+            }
+
+        public:
+            VCode& code() { return m_code; }
+            std::vector<VmExpID> const& bodies() const { return m_bodies; }
+            std::vector<AotSlot> const& slots() const { return m_slots; }
+            bool is_body(VmExpID x) const { return m_body_set.find(x) != m_body_set.end(); }
+            // drop_body leaves `body` to the interpreter.
+            void drop_body(VmExpID body) {
+                m_body_set.erase(body);
+                m_bodies.erase(std::find(m_bodies.begin(), m_bodies.end(), body));
+            }
+            void clear_slots() {
+                m_slots.clear();
+                m_slot_ids.clear();
+            }
+
+            // slot returns the index of the slot resolving `x` to `kind`.
+            size_t slot(VmExpID x, AotSlotKind kind) {
+                uint64_t key = (static_cast<uint64_t>(vmx_index(x)) << 2) | static_cast<uint64_t>(kind);
+                auto it = m_slot_ids.find(key);
+                if (it != m_slot_ids.end()) {
+                    return it->second;
+                }
+                m_slots.push_back({static_cast<uint32_t>(vmx_index(x)), kind});
+                m_slot_ids.insert({key, m_slots.size() - 1});
+                return m_slots.size() - 1;
+            }
+            static std::string fn_name(VmExpID body) {
+                return "b" + std::to_string(vmx_index(body));
+            }
+        };
+
+        // AotBodyTranslator emits the function of one body: like `JitTranslator`, each chain of instructions is
+        // translated once, and entered at the body's first instruction or at one of its return points.
+        class AotBodyTranslator {
+        private:
+            struct Line {
+                VmExpID label;          // -1 for none: else, only printed if referenced
+                std::string text;
+            };
+        private:
+            AotUnitTranslator& m_unit;
+            VCode& m_code;
+            VmExpID m_body;
+            std::vector<Line> m_lines;
+            robin_hood::unordered_flat_set<VmExpID> m_queued;
+            robin_hood::unordered_flat_set<VmExpID> m_bound;
+            robin_hood::unordered_flat_set<VmExpID> m_referenced;
+            std::vector<VmExpID> m_chain_heads;
+            std::vector<VmExpID> m_exits;                                    // in order
+            robin_hood::unordered_flat_set<VmExpID> m_exit_set;
+            std::vector<VmExpID> m_entries;                                  // the body, then return points
+            bool m_has_return;
+            bool m_has_native_call;
+            size_t m_translated_count;
+            size_t m_untranslated_count;                                     // reached, i.e. exits
+
+        public:
+            AotBodyTranslator(AotUnitTranslator& unit, VmExpID body)
+            :   m_unit(unit),
+                m_code(unit.code()),
+                m_body(body),
+                m_lines(),
+                m_queued(),
+                m_bound(),
+                m_referenced(),
+                m_chain_heads(),
+                m_exits(),
+                m_exit_set(),
+                m_entries{body},
+                m_has_return(false),
+                m_has_native_call(false),
+                m_translated_count(0),
+                m_untranslated_count(0)
+            {}
+
+        public:
+            VmExpID body() const { return m_body; }
+            std::vector<VmExpID> const& entries() const { return m_entries; }
+
+            // translates(x) is true iff `x` has a template here (cf `JitTranslator::translates`): else, it is an
+            // exit.
+            bool translates(VmExpID x) const {
+                if (x < 0 || vmx_unit(x) != vmx_unit(m_body)) {
+                    return false;
+                }
+                VmExp const& exp = m_code[x];
+                switch (exp.kind) {
+                    case VmExpKind::ReferLocal:
+                    case VmExpKind::ReferFree:
+                    case VmExpKind::ReferGlobal:
+                    case VmExpKind::Indirect:
+                    case VmExpKind::Constant:
+                    case VmExpKind::Test:
+                    case VmExpKind::AssignGlobal:
+                    case VmExpKind::AssignLocalUnboxed:
+                    case VmExpKind::Frame:
+                    case VmExpKind::Argument:
+                    case VmExpKind::Return:
+                    case VmExpKind::ReferLocalPush:
+                    case VmExpKind::ReferFreePush:
+                    case VmExpKind::ReferGlobalPush:
+                    case VmExpKind::ConstantPush:
+                    case VmExpKind::PrimAdd:
+                    case VmExpKind::PrimSub:
+                    case VmExpKind::PrimMul:
+                    case VmExpKind::PrimEq:
+                    case VmExpKind::PrimLt:
+                    case VmExpKind::PrimGt:
+                    case VmExpKind::PrimLe:
+                    case VmExpKind::PrimGe:
+                    case VmExpKind::PrimCar:
+                    case VmExpKind::PrimCdr:
+                    case VmExpKind::PrimIsNull:
+                    case VmExpKind::PrimIsPair:
+                        return true;
+                    case VmExpKind::CallGlobal:
+                    case VmExpKind::ShiftCallGlobal:
+                        // calls of other bodies of the unit are tail calls of their functions:
+                        return exp.args.i_call_global.body == m_body || m_unit.is_body(exp.args.i_call_global.body);
+                    case VmExpKind::SelfTailCall:
+                        return exp.args.i_call_global.body == m_body;
+                    default:
+                        return false;
+                }
+            }
+
+            // translate translates every instruction reachable from the body, returning whether its function is 
+            // worth entering: as in `JitTranslator::is_worth_it`, it must call a body in native code without
+            // leaving it too often, since each exit and re-entry costs about as much as interpreting a few 
+            // instructions.
+            bool translate() {
+                queue(m_body);
+                m_referenced.insert(m_body);
+                while (!m_chain_heads.empty()) {
+                    VmExpID x = m_chain_heads.back();
+                    m_chain_heads.pop_back();
+                    if (!is_bound(x)) {
+                        translate_chain(x);
+                    }
+                }
+                return m_has_native_call && m_untranslated_count * MIN_TRANSLATED_COUNT_PER_EXIT <= m_translated_count;
+            }
+            // print writes the function, once translated.
+            void print(std::ostream& out) {
+                std::string name = AotUnitTranslator::fn_name(m_body);
+                out << "    VmCodePtr " << name << "(JitFrame* fr, uint32_t entry) {" << std::endl;
+                out << "        OBJECT a = fr->a;" << std::endl;
+                out << "        ssize_t f = fr->f;" << std::endl;
+                out << "        OBJECT c = fr->c;" << std::endl;
+                out << "        ssize_t s = fr->s;" << std::endl;
+                out << "        OBJECT* const items = fr->stack_items;" << std::endl;
+                out << "        (void) items;" << std::endl;
+                if (m_has_return) {
+                    out << "        uint64_t ret;" << std::endl;
+                }
+                out << "        switch (entry) {" << std::endl;
+                for (size_t i = 1; i < m_entries.size(); i++) {
+                    out << "            case " << i << ": goto " << label(m_entries[i]) << ";" << std::endl;
+                }
+                out << "            default: goto " << label(m_body) << ";" << std::endl;
+                out << "        }" << std::endl;
+                for (Line const& line: m_lines) {
+                    if (line.label >= 0) {
+                        if (m_referenced.find(line.label) != m_referenced.end()) {
+                            out << "    " << label(line.label) << ":" << std::endl;
+                        }
+                    } else {
+                        out << "        " << line.text << std::endl;
+                    }
+                }
+                if (m_has_return) {
+                    // the return address may be a return point of this body, as it is when the body returns
+                    // from a call of itself: else, the interpreter resumes there.
+                    out << "    ret_dispatch:" << std::endl;
+                    for (size_t i = 1; i < m_entries.size(); i++) {
+                        out << "        if (ret == slots[" << m_unit.slot(m_entries[i], AotSlotKind::Pc) << "]) goto " << label(m_entries[i]) << ";" << std::endl;
+                    }
+                    out << "        SS_AOT_EXIT(ret);" << std::endl;
+                }
+                // exits may not be added while they are printed: they are only added by translating.
+                for (VmExpID x: m_exits) {
+                    out << "    " << exit_label(x) << ":" << std::endl;
+                    out << "        SS_AOT_EXIT(slots[" << m_unit.slot(x, AotSlotKind::Pc) << "]);" << std::endl;
+                }
+                out << "    }" << std::endl;
+            }
+
+        private:
+            static std::string label(VmExpID x) { return "x" + std::to_string(vmx_index(x)); }
+            static std::string exit_label(VmExpID x) { return "exit" + std::to_string(vmx_index(x)); }
+            bool is_bound(VmExpID x) const { return m_bound.find(x) != m_bound.end(); }
+            void queue(VmExpID x) {
+                if (m_queued.insert(x).second) {
+                    m_chain_heads.push_back(x);
+                }
+            }
+            void emit(std::string text) {
+                m_lines.push_back({-1, std::move(text)});
+            }
+
+            // goto_target returns a branch to `x`, or to its exit if it has no template.
+            std::string goto_target(VmExpID x) {
+                if (translates(x)) {
+                    queue(x);
+                    m_referenced.insert(x);
+                    return "goto " + label(x) + ";";
+                }
+                return goto_untranslated(x);
+            }
+            std::string goto_untranslated(VmExpID x) {
+                if (m_exit_set.find(x) == m_exit_set.end()) {
+                    m_untranslated_count++;
+                }
+                return goto_exit(x);
+            }
+            // goto_exit returns a branch to the exit at `x`, where the interpreter runs it.
+            std::string goto_exit(VmExpID x) {
+                if (m_exit_set.insert(x).second) {
+                    m_exits.push_back(x);
+                }
+                return "goto " + exit_label(x) + ";";
+            }
+            std::string slot(VmExpID x, AotSlotKind kind) {
+                return "slots[" + std::to_string(m_unit.slot(x, kind)) + "]";
+            }
+
+            void translate_chain(VmExpID x) {
+                for (;;) {
+                    if (is_bound(x)) {
+                        emit(goto_target(x));
+                        return;
+                    }
+                    m_bound.insert(x);
+                    m_translated_count++;
+                    m_lines.push_back({x, {}});
+                    VmExpID next = translate_one(x);
+                    if (next < 0) {
+                        return;
+                    }
+                    if (!translates(next)) {
+                        emit(goto_untranslated(next));
+                        return;
+                    }
+                    x = next;
+                }
+            }
+
+            // translate_one emits the code of `x`, returning its primary successor, or -1 if it has none.
+            VmExpID translate_one(VmExpID x) {
+                VmExp const& exp = m_code[x];
+                switch (exp.kind) {
+                    case VmExpKind::ReferLocal: {
+                        emit("a = " + refer_local(exp.args.i_refer.n) + ";");
+                        return exp.args.i_refer.x;
+                    }
+                    case VmExpKind::ReferFree: {
+                        emit("a = " + refer_free(exp.args.i_refer.n) + ";");
+                        return exp.args.i_refer.x;
+                    }
+                    case VmExpKind::ReferGlobal: {
+                        emit("a = fr->globals[" + slot(x, AotSlotKind::Global) + "];");
+                        return exp.args.i_refer.x;
+                    }
+                    case VmExpKind::Constant: {
+                        emit("a = aot_object(" + slot(x, AotSlotKind::Constant) + ");");
+                        return exp.args.i_constant.x;
+                    }
+                    case VmExpKind::ReferLocalPush: {
+                        emit_check_push(1, x);
+                        emit("a = " + refer_local(exp.args.i_refer.n) + ";");
+                        emit("items[s++] = a;");
+                        return exp.args.i_refer.x;
+                    }
+                    case VmExpKind::ReferFreePush: {
+                        emit_check_push(1, x);
+                        emit("a = " + refer_free(exp.args.i_refer.n) + ";");
+                        emit("items[s++] = a;");
+                        return exp.args.i_refer.x;
+                    }
+                    case VmExpKind::ReferGlobalPush: {
+                        emit_check_push(1, x);
+                        emit("a = fr->globals[" + slot(x, AotSlotKind::Global) + "];");
+                        emit("items[s++] = a;");
+                        return exp.args.i_refer.x;
+                    }
+                    case VmExpKind::ConstantPush: {
+                        emit_check_push(1, x);
+                        emit("a = aot_object(" + slot(x, AotSlotKind::Constant) + ");");
+                        emit("items[s++] = a;");
+                        return exp.args.i_constant.x;
+                    }
+                    case VmExpKind::Argument: {
+                        emit_check_push(1, x);
+                        emit("items[s++] = a;");
+                        return exp.args.i_argument.x;
+                    }
+                    case VmExpKind::Indirect: {
+                        emit("if (!a.is_box()) " + goto_exit(x));
+                        emit("a = static_cast<BoxObject*>(a.as_ptr())->boxed();");
+                        return exp.args.i_indirect.x;
+                    }
+                    case VmExpKind::Test: {
+                        emit("if (aot_is_false(a)) " + goto_target(exp.args.i_test.next_if_f));
+                        return exp.args.i_test.next_if_t;
+                    }
+                    case VmExpKind::AssignGlobal: {
+                        emit("fr->globals[" + slot(x, AotSlotKind::Global) + "] = a;");
+                        return exp.args.i_assign.x;
+                    }
+                    case VmExpKind::AssignLocalUnboxed: {
+                        // cf `VmStack::index_set`: stores below the captured height must lower it, so they exit.
+                        std::string n1 = std::to_string(static_cast<ssize_t>(exp.args.i_assign.n) + 1);
+                        emit("if (f - " + n1 + " < fr->stack_captured_height) " + goto_exit(x));
+                        emit("items[f - " + n1 + "] = a;");
+                        return exp.args.i_assign.x;
+                    }
+                    case VmExpKind::Frame: {
+                        // first (c, f, ret) last: cf `JitTranslator`
+                        VmExpID ret_x = exp.args.i_frame.post_ret_x;
+                        if (translates(ret_x) && std::find(m_entries.begin(), m_entries.end(), ret_x) == m_entries.end()) {
+                            m_entries.push_back(ret_x);
+                            queue(ret_x);
+                            m_referenced.insert(ret_x);
+                        }
+                        emit_check_push(3, x);
+                        emit("items[s] = c;");
+                        emit("items[s + 1] = aot_fixnum(f);");
+                        emit("items[s + 2] = aot_fixnum(static_cast<ssize_t>(" + slot(ret_x, AotSlotKind::Pc) + "));");
+                        emit("s += 3;");
+                        return exp.args.i_frame.fn_body_x;
+                    }
+                    case VmExpKind::Return: {
+                        m_has_return = true;
+                        if (exp.args.i_return.n > 0) {
+                            emit("s -= " + std::to_string(exp.args.i_return.n) + ";");
+                        }
+                        emit("ret = static_cast<uint64_t>(aot_fixnum_value(items[s - 1]));");
+                        emit("f = aot_fixnum_value(items[s - 2]);");
+                        emit("c = items[s - 3];");
+                        emit("s -= 3;");
+                        emit("goto ret_dispatch;");
+                        return -1;
+                    }
+                    case VmExpKind::CallGlobal:
+                    case VmExpKind::ShiftCallGlobal:
+                    case VmExpKind::SelfTailCall: {
+                        // the collection flags are polled first, like the interpreter's safe-point: nothing has
+                        // changed yet if it exits.
+                        auto const& args = exp.args.i_call_global;
+                        emit(
+                            "if (fr->minor_collect_requested->load(std::memory_order_relaxed) || "
+                            "fr->sweep_requested->load(std::memory_order_relaxed)) " + goto_exit(x)
+                        );
+                        if (exp.kind == VmExpKind::SelfTailCall) {
+                            emit_shift(args.n, args.n, x);
+                        } else {
+                            if (exp.kind == VmExpKind::ShiftCallGlobal) {
+                                emit_shift(args.n, args.m, x);
+                            }
+                            // cf 'do_call_known'
+                            emit("c = fr->globals[" + slot(x, AotSlotKind::Global) + "];");
+                            emit("f = s;");
+                        }
+                        m_has_native_call = true;
+                        if (args.body == m_body) {
+                            emit(goto_target(m_body));
+                        } else {
+                            emit("SS_AOT_TAIL_CALL(" + AotUnitTranslator::fn_name(args.body) + ", " + slot(args.body, AotSlotKind::Pc) + ");");
+                        }
+                        return -1;
+                    }
+                    case VmExpKind::PrimAdd:
+                    case VmExpKind::PrimSub:
+                    case VmExpKind::PrimMul:
+                    case VmExpKind::PrimEq:
+                    case VmExpKind::PrimLt:
+                    case VmExpKind::PrimGt:
+                    case VmExpKind::PrimLe:
+                    case VmExpKind::PrimGe: {
+                        // cf `VirtualMachine::prim_binary`: only fixnums are handled here.
+                        emit("if (!aot_is_fixnum(a) || !aot_is_fixnum(items[s - 1])) " + goto_exit(x));
+                        std::string l = "aot_cmp_word(a)";
+                        std::string r = "aot_cmp_word(items[s - 1])";
+                        switch (exp.kind) {
+                            case VmExpKind::PrimAdd: emit("a = aot_add(a, items[s - 1]);"); break;
+                            case VmExpKind::PrimSub: emit("a = aot_sub(a, items[s - 1]);"); break;
+                            case VmExpKind::PrimMul: emit("a = aot_mul(a, items[s - 1]);"); break;
+                            case VmExpKind::PrimEq: emit("a = aot_boolean(" + l + " == " + r + ");"); break;
+                            case VmExpKind::PrimLt: emit("a = aot_boolean(" + l + " < " + r + ");"); break;
+                            case VmExpKind::PrimGt: emit("a = aot_boolean(" + l + " > " + r + ");"); break;
+                            case VmExpKind::PrimLe: emit("a = aot_boolean(" + l + " <= " + r + ");"); break;
+                            default: emit("a = aot_boolean(" + l + " >= " + r + ");"); break;
+                        }
+                        emit("s -= 1;");
+                        return exp.args.i_prim.x;
+                    }
+                    case VmExpKind::PrimCar:
+                    case VmExpKind::PrimCdr: {
+                        emit("if (!a.is_pair()) " + goto_exit(x));
+                        emit(exp.kind == VmExpKind::PrimCar ? "a = a.as_pair_p()->car();" : "a = a.as_pair_p()->cdr();");
+                        return exp.args.i_prim.x;
+                    }
+                    case VmExpKind::PrimIsNull: {
+                        emit("a = aot_boolean(a.is_null());");
+                        return exp.args.i_prim.x;
+                    }
+                    case VmExpKind::PrimIsPair: {
+                        emit("a = aot_boolean(a.is_pair());");
+                        return exp.args.i_prim.x;
+                    }
+                    default: {
+                        // cf `translates`: only reached for a call that is not translated.
+                        emit(goto_exit(x));
+                        return -1;
+                    }
+                }
+            }
+            // a local's index may be negative, cf `Compiler::local_slot`:
+            static std::string refer_local(size_t n) {
+                return "items[f - " + std::to_string(static_cast<ssize_t>(n) + 1) + "]";
+            }
+            static std::string refer_free(size_t n) {
+                return "c.as_closure_p()->free_vars()[" + std::to_string(n) + "]";
+            }
+            // emit_check_push exits unless `count` items may be pushed without `VmStack::push_slow_path`.
+            void emit_check_push(ssize_t count, VmExpID x) {
+                emit(
+                    "if (s < fr->stack_captured_height || s + " + std::to_string(count) + " > fr->stack_limit) " +
+                    goto_exit(x)
+                );
+            }
+            // emit_shift is `VmStack::shift`, but exits rather than lower the captured height.
+            void emit_shift(ssize_t n, ssize_t m, VmExpID x) {
+                if (n > 0) {
+                    emit("if (s - " + std::to_string(n + m) + " < fr->stack_captured_height) " + goto_exit(x));
+                    for (ssize_t k = 0; k < n; k++) {
+                        emit(
+                            "items[s - " + std::to_string(n + m - k) + "] = items[s - " + std::to_string(n - k) + "];"
+                        );
+                    }
+                }
+                if (m > 0) {
+                    emit("s -= " + std::to_string(m) + ";");
+                }
+            }
+        };
+
+        void emit_string_literal(std::ostream& out, std::string const& s) {
+            out << '"';
+            for (char ch: s) {
+                unsigned char u = static_cast<unsigned char>(ch);
+                if (ch == '"' || ch == '\\') {
+                    out << '\\' << ch;
+                } else if (u < 0x20 || u >= 0x7f) {
+                    out << '\\' << std::oct << std::setw(3) << std::setfill('0') << static_cast<unsigned>(u) << std::dec;
+                } else {
+                    out << ch;
+                }
+            }
+            out << '"';
+        }
+
+    }
+
+    void emit_aot_program(
+        std::ostream& out, VCode& code, VSubr const& subr,
+        uint64_t key, std::vector<uint64_t> const& vcode_words
+    ) {
+        // subrs built by hand may not name their unit: cf `write_vcode_cache`
+        VCodeUnitID unit = subr.unit;
+        if (unit == VCODE_NO_UNIT && !subr.line_programs.empty()) {
+            unit = vmx_unit(subr.line_programs[0].s);
+        }
+
+        // the functions are translated first, since they add the slots: bodies that are not worth entering are
+        // dropped until none is, since calls of them are then exits.
+        AotUnitTranslator unit_translator{code, unit};
+        std::vector<std::unique_ptr<AotBodyTranslator>> translators;
+        for (bool dropped = true; dropped;) {
+            dropped = false;
+            translators.clear();
+            unit_translator.clear_slots();
+            std::vector<VmExpID> bodies = unit_translator.bodies();
+            for (VmExpID body: bodies) {
+                auto translator = std::make_unique<AotBodyTranslator>(unit_translator, body);
+                if (translator->translate()) {
+                    translators.push_back(std::move(translator));
+                } else {
+                    unit_translator.drop_body(body);
+                    dropped = true;
+                }
+            }
+        }
+        std::stringstream fns;
+        std::vector<std::pair<VmExpID, size_t>> entries;        // (entry, index into its body's function)
+        std::vector<std::pair<VmExpID, VmExpID>> entry_bodies;
+        for (auto const& translator: translators) {
+            translator->print(fns);
+            for (size_t i = 0; i < translator->entries().size(); i++) {
+                entries.push_back({translator->entries()[i], i});
+                entry_bodies.push_back({translator->entries()[i], translator->body()});
+            }
+        }
+
+        out << "// Emitted by 'ssc' for " << subr.name << ": cf `ss-core/aot.hh`" << std::endl;
+        out << "#include \"ss-core/aot.hh\"" << std::endl;
+        out << std::endl;
+        out << "namespace {" << std::endl;
+        out << std::endl;
+        out << "    using namespace ss;" << std::endl;
+        out << std::endl;
+
+        out << "    uint64_t const vcode_words[] = {";
+        for (size_t i = 0; i < vcode_words.size(); i++) {
+            out << ((i % 4 == 0) ? "\n        " : " ") << "0x" << std::hex << vcode_words[i] << std::dec << "ull,";
+        }
+        out << std::endl << "    };" << std::endl;
+
+        // a placeholder last entry keeps arrays from being empty:
+        std::vector<AotSlot> const& slots = unit_translator.slots();
+        out << "    AotSlot const slot_descs[] = {" << std::endl;
+        for (AotSlot slot: slots) {
+            char const* kind_name = (
+                slot.kind == AotSlotKind::Pc ? "Pc" :
+                slot.kind == AotSlotKind::Global ? "Global" :
+                "Constant"
+            );
+            out << "        {" << slot.exp_index << ", AotSlotKind::" << kind_name << "}," << std::endl;
+        }
+        out << "        {0, AotSlotKind::Pc}" << std::endl;
+        out << "    };" << std::endl;
+        out << "    uint64_t slots[" << slots.size() + 1 << "];" << std::endl;
+        out << std::endl;
+
+        for (VmExpID body: unit_translator.bodies()) {
+            out << "    VmCodePtr " << AotUnitTranslator::fn_name(body) << "(JitFrame* fr, uint32_t entry);" << std::endl;
+        }
+        out << std::endl;
+        out << fns.str();
+        out << std::endl;
+        for (size_t i = 0; i < entries.size(); i++) {
+            std::string fn_name = AotUnitTranslator::fn_name(entry_bodies[i].second);
+            out
+                << "    VmCodePtr " << fn_name << "_" << entries[i].second << "(JitFrame* fr) { "
+                << "return " << fn_name << "(fr, " << entries[i].second << "); }" << std::endl;
+        }
+        out << "    AotEntry const entries[] = {" << std::endl;
+        for (size_t i = 0; i < entries.size(); i++) {
+            out
+                << "        {" << vmx_index(entries[i].first) << ", &"
+                << AotUnitTranslator::fn_name(entry_bodies[i].second) << "_" << entries[i].second << "}," << std::endl;
+        }
+        out << "        {0, nullptr}" << std::endl;
+        out << "    };" << std::endl;
+        out << std::endl;
+        out << "}" << std::endl;
+        out << std::endl;
+
+        out << "int main(int argc, char const* argv[]) {" << std::endl;
+        out << "    ss::AotProgram program{" << std::endl;
+        out << "        ";
+        emit_string_literal(out, subr.name);
+        out << "," << std::endl;
+        out << "        0x" << std::hex << key << std::dec << "ull," << std::endl;
+        out << "        vcode_words, " << vcode_words.size() << "," << std::endl;
+        out << "        slot_descs, slots, " << slots.size() << "," << std::endl;
+        out << "        entries, " << entries.size() << std::endl;
+        out << "    };" << std::endl;
+        out << "    return ss::aot_main(argc, argv, program);" << std::endl;
+        out << "}" << std::endl;
+    }
+
+    ///
+    // Running:
+    //
+
+    // resolve_aot_slots resolves each slot of `program` into `unit`, returning false if one does not match.
+    static bool resolve_aot_slots(VirtualMachine* vm, VCodeUnitID unit, AotProgram const& program) {
+        VCode& code = *vm_compiler(vm)->code();
+        size_t exp_count = vmx_index(code.end_exp_id(unit));
+        for (size_t i = 0; i < program.slot_count; i++) {
+            AotSlot slot = program.slots[i];
+            if (slot.exp_index >= exp_count) {
+                return false;
+            }
+            VmExpID x = vmx_id(unit, slot.exp_index);
+            VmExp const& exp = code[x];
+            uint64_t& word = program.slot_words[i];
+            switch (slot.kind) {
+                case AotSlotKind::Pc: {
+                    word = reinterpret_cast<VmWord>(vm_code_entry(vm, x));
+                } break;
+                case AotSlotKind::Global: {
+                    switch (exp.kind) {
+                        case VmExpKind::ReferGlobal:
+                        case VmExpKind::ReferGlobalPush: word = exp.args.i_refer.n; break;
+                        case VmExpKind::AssignGlobal: word = exp.args.i_assign.n; break;
+                        case VmExpKind::CallGlobal:
+                        case VmExpKind::ShiftCallGlobal: word = exp.args.i_call_global.gn; break;
+                        default: return false;
+                    }
+                } break;
+                case AotSlotKind::Constant: {
+                    if (exp.kind != VmExpKind::Constant && exp.kind != VmExpKind::ConstantPush) {
+                        return false;
+                    }
+                    word = exp.args.i_constant.obj.as_raw();
+                } break;
+            }
+        }
+        return true;
+    }
+
+    int aot_main(int argc, char const* argv[], AotProgram const& program) {
+        CliArgsParser parser;
+        parser.add_ar0_option_rule("interpret");
+        parser.add_ar1_option_rule("snail-root");
+        parser.add_ar1_option_rule("heap-gib");
+        CliArgs args;
+        try {
+            args = parser.parse(argc, argv);
+        } catch (SsiError const&) {
+            return 1;
+        }
+        if (!args.pos.empty()) {
+            std::stringstream ss;
+            ss << "Expected no positional arguments: got " << args.pos.size();
+            error(ss.str());
+            return 1;
+        }
+        auto snail_root_it = args.ar1.find("snail-root");
+        std::string snail_root = (snail_root_it == args.ar1.end() ? "./snail-venv" : snail_root_it->second);
+        auto heap_gib_it = args.ar1.find("heap-gib");
+        size_t heap_size_in_bytes = (
+            heap_gib_it == args.ar1.end() ?
+            GIBIBYTES(2) :
+            GIBIBYTES(strtoull(heap_gib_it->second.c_str(), nullptr, 10))
+        );
+        bool interpret = (args.ar0.find("interpret") != args.ar0.end());
+
+        Gc gc{heap_size_in_bytes};
+        if (!CentralLibraryRepository::ensure_init(snail_root)) {
+            error("Failed to initialize the Central Library Repository (CLR)");
+            return 2;
+        }
+        VirtualMachine* vm = create_vm(&gc, bind_standard_procedures, VmEngine::Bytecode);
+        VCode& code = *vm_compiler(vm)->code();
+
+        // the embedded code is loaded like a cache file, so that it is checked against this build of ss-core:
+        std::optional<VSubr> subr = load_vcode_cache_words(
+            program.vcode_words, program.vcode_word_count, program.key, code, vm_gc_tfe(vm)
+        );
+        if (!subr.has_value()) {
+            std::stringstream ss;
+            ss  << "Could not load the code of '" << program.name << "': "
+                << "was it compiled by a different build of ss-core?";
+            error(ss.str());
+            return 3;
+        }
+        if (!interpret) {
+            if (!resolve_aot_slots(vm, subr->unit, program)) {
+                std::stringstream ss;
+                ss << "Native code for '" << program.name << "' does not match its VCode: running it interpreted";
+                warning(ss.str());
+            } else {
+                for (size_t i = 0; i < program.entry_count; i++) {
+                    vm_install_native_entry(vm, vmx_id(subr->unit, program.entries[i].exp_index), program.entries[i].code);
+                }
+            }
+        }
+        code.enqueue_main_subr(program.name, std::move(subr.value()));
+
+        int res = 0;
+        try {
+            bool print_each_line = false;
+            sync_execute_vm(vm, print_each_line);
+        } catch (SsiError const&) {
+            res = 1;
+        }
+        flush_standard_ports();
+        return res;
+    }
+
+}   // namespace ss
@@ -0,0 +1,727 @@
+#include "ss-core/bytecode.hh"
+
+#include <sstream>
+#include <iomanip>
+#include <bit>
+#include <algorithm>
+
+#include "ss-core/feedback.hh"
+#include "ss-core/printing.hh"
+
+namespace ss {
+
+    // each unit's chunks double in size, up to a limit: most units are small, e.g. one line of a REPL.
+    static constexpr size_t MIN_CHUNK_WORD_COUNT = 64;
+    static constexpr size_t MAX_CHUNK_WORD_COUNT = 16384;
+    static size_t chunk_word_count(size_t chunk_index) {
+        return std::min(MIN_CHUNK_WORD_COUNT << std::min<size_t>(chunk_index, 8), MAX_CHUNK_WORD_COUNT);
+    }
+
+    VBytecode::VBytecode(VCode* code, bool uses_registers)
+    :   m_code(code),
+        m_uses_registers(uses_registers),
+        m_units(),
+        m_unthreaded_units(),
+        m_threaded_labels(nullptr),
+        m_word_count(0),
+        m_op_count(0),
+        m_quickenings(),
+        m_quickened_global_counts(),
+        m_chunk_spans()
+    {}
+
+    ///
+    // Lowering:
+    //
+
+    VBytecode::Unit& VBytecode::lowered_unit(VCodeUnitID unit) {
+        if (unit >= m_units.size()) {
+            m_units.resize(unit + 1);
+        }
+        if (!m_units[unit]) {
+            m_units[unit] = std::make_unique<Unit>(Unit{unit, {}, nullptr, nullptr, {}, {}, 0, 0, false});
+        }
+        // expressions may be appended to a unit after it was lowered, e.g. the later lines of a subr:
+        Unit& u = *m_units[unit];
+        size_t exp_count = vmx_index(m_code->end_exp_id(unit));
+        if (u.entries.size() < exp_count) {
+            u.entries.resize(exp_count, nullptr);
+        }
+        return u;
+    }
+
+    VmWord* VBytecode::emit_op(Unit& u, VmExpKind kind, bool falls_through) {
+        // every instruction leaves room for a 'Jump' after it, so that its successor may start a new chunk:
+        size_t jump_width = width(VmExpKind::Jump);
+        if (static_cast<size_t>(u.end - u.next) < width(kind) + jump_width) {
+            size_t word_count = chunk_word_count(u.chunks.size());
+            VmWord* chunk = new VmWord[word_count];
+            if (falls_through) {
+                place_op(u, VmExpKind::Jump);
+                emit_word(u, addr_word(chunk));
+            }
+            u.chunks.emplace_back(chunk);
+            m_chunk_spans.clear();
+            u.next = chunk;
+            u.end = chunk + word_count;
+            u.word_count += word_count;
+            m_word_count += word_count;
+        }
+        return place_op(u, kind);
+    }
+    VmWord* VBytecode::place_op(Unit& u, VmExpKind kind) {
+        VmWord* op = u.next++;
+        *op = static_cast<VmWord>(kind);
+        u.ops.emplace_back(op, kind);
+        m_op_count++;
+        if (!u.is_queued) {
+            u.is_queued = true;
+            m_unthreaded_units.push_back(u.id);
+        }
+        return op;
+    }
+
+    void VBytecode::free_unit(VCodeUnitID unit) {
+        if (unit >= m_units.size() || !m_units[unit]) {
+            return;
+        }
+        Unit& u = *m_units[unit];
+        if (u.is_queued) {
+            m_unthreaded_units.erase(std::find(m_unthreaded_units.begin(), m_unthreaded_units.end(), unit));
+        }
+        for (size_t i = 0; i < u.chunks.size(); i++) {
+            VmWord const* chunk = u.chunks[i].get();
+            size_t word_count = chunk_word_count(i);
+            std::erase_if(m_quickenings, [&] (Quickening const& q) {
+                bool is_in_chunk = (q.op >= chunk && q.op < chunk + word_count);
+                if (is_in_chunk && q.kind == VmExpKind::ReferGlobal) {
+                    m_quickened_global_counts[q.operand]--;
+                }
+                return is_in_chunk;
+            });
+        }
+        m_word_count -= u.word_count;
+        m_op_count -= u.ops.size();
+        m_units[unit].reset();
+        m_chunk_spans.clear();
+    }
+
+    ///
+    // Attribution:
+    //
+
+    VmExpID VBytecode::exp_at(VmCodePtr pc, VmExpKind* out_kind) const {
+        if (m_chunk_spans.empty()) {
+            for (std::unique_ptr<Unit> const& u: m_units) {
+                if (!u) {
+                    continue;
+                }
+                for (size_t i = 0; i < u->chunks.size(); i++) {
+                    VmCodePtr chunk = u->chunks[i].get();
+                    m_chunk_spans.push_back({chunk, chunk + chunk_word_count(i), u->id});
+                }
+            }
+            std::sort(m_chunk_spans.begin(), m_chunk_spans.end(), [] (ChunkSpan const& l, ChunkSpan const& r) {
+                return l.begin < r.begin;
+            });
+        }
+        auto it = std::upper_bound(m_chunk_spans.begin(), m_chunk_spans.end(), pc, [] (VmCodePtr pc, ChunkSpan const& span) {
+            return pc < span.begin;
+        });
+        if (it == m_chunk_spans.begin() || pc >= (--it)->end) {
+            return -1;
+        }
+
+        // the closest entry at or before `pc` in its chunk:
+        Unit const& u = *m_units[it->unit];
+        VmExpID res = -1;
+        VmCodePtr res_pc = nullptr;
+        for (size_t i = 0; i < u.entries.size(); i++) {
+            VmCodePtr entry = u.entries[i];
+            if (entry && entry >= it->begin && entry <= pc && entry > res_pc) {
+                res = vmx_id(u.id, i);
+                res_pc = entry;
+            }
+        }
+        if (out_kind) {
+            auto op_it = std::find_if(u.ops.begin(), u.ops.end(), [pc] (auto const& op) { return op.first == pc; });
+            if (op_it != u.ops.end()) {
+                *out_kind = op_it->second;
+            }
+        }
+        return res;
+    }
+
+    VmCodePtr VBytecode::lower(VmExpID root_exp_id) {
+        // Each chain is laid out by following primary successors until we reach a terminal
+        // instruction or an already-placed one.
+        // Secondary successors are queued and patched in once every chain has been placed.
+        std::vector<VmExpID> chain_heads{root_exp_id};
+        std::vector<PendingPatch> patches;
+        auto placed = [this] (VmExpID exp_id) {
+            return m_units[vmx_unit(exp_id)]->entries[vmx_index(exp_id)];
+        };
+
+        while (!chain_heads.empty()) {
+            VmExpID x = chain_heads.back();
+            chain_heads.pop_back();
+            VCodeUnitID unit = vmx_unit(x);
+            Unit& u = lowered_unit(unit);
+            if (u.entries[vmx_index(x)]) {
+                continue;
+            }
+            auto defer = [&] (VmExpID target) {
+                patches.push_back({u.next, target});
+                chain_heads.push_back(target);
+                emit_word(u, 0);
+            };
+
+            bool falls_through = false;
+            while (x >= 0) {
+                if (vmx_unit(x) != unit) {
+                    // placed in the chunks of its own unit:
+                    emit_op(u, VmExpKind::Jump, falls_through);
+                    defer(x);
+                    break;
+                }
+                if (VmCodePtr pc = u.entries[vmx_index(x)]) {
+                    // already placed: cannot fall through, so we jump.
+                    emit_op(u, VmExpKind::Jump, falls_through);
+                    emit_word(u, addr_word(pc));
+                    break;
+                }
+
+                if (m_uses_registers) {
+                    VmExpID register_next_x = lower_register_op(u, x, falls_through);
+                    if (register_next_x >= 0) {
+                        falls_through = true;
+                        x = register_next_x;
+                        continue;
+                    }
+                }
+
+                VmExp const& exp = (*m_code)[x];
+                u.entries[vmx_index(x)] = emit_op(u, exp.kind, falls_through);
+                falls_through = true;
+                switch (exp.kind) {
+                    case VmExpKind::Halt: {
+                        x = -1;
+                    } break;
+                    case VmExpKind::ReferLocal:
+                    case VmExpKind::ReferFree:
+                    case VmExpKind::ReferGlobal: {
+                        emit_word(u, exp.args.i_refer.n);
+                        x = exp.args.i_refer.x;
+                    } break;
+                    case VmExpKind::Indirect: {
+                        x = exp.args.i_indirect.x;
+                    } break;
+                    case VmExpKind::Constant: {
+                        emit_obj(u, exp.args.i_constant.obj);
+                        x = exp.args.i_constant.x;
+                    } break;
+                    case VmExpKind::Close: {
+                        // closures store the body's VmExpID, so it need not be patched, only placed.
+                        emit_word(u, exp.args.i_close.vars_count);
+                        emit_word(u, exp.args.i_close.body);
+                        chain_heads.push_back(exp.args.i_close.body);
+                        x = exp.args.i_close.x;
+                    } break;
+                    case VmExpKind::Box: {
+                        emit_word(u, exp.args.i_box.n);
+                        x = exp.args.i_box.x;
+                    } break;
+                    case VmExpKind::Test: {
+                        defer(exp.args.i_test.next_if_f);
+                        x = exp.args.i_test.next_if_t;
+                    } break;
+                    case VmExpKind::AssignLocal:
+                    case VmExpKind::AssignFree:
+                    case VmExpKind::AssignGlobal:
+                    case VmExpKind::AssignLocalUnboxed: {
+                        emit_word(u, exp.args.i_assign.n);
+                        x = exp.args.i_assign.x;
+                    } break;
+                    case VmExpKind::Conti: {
+                        emit_word(u, exp.args.i_conti.n);
+                        x = exp.args.i_conti.x;
+                    } break;
+                    case VmExpKind::Nuate: {
+                        x = exp.args.i_nuate.x;
+                    } break;
+                    case VmExpKind::Frame: {
+                        defer(exp.args.i_frame.post_ret_x);
+                        x = exp.args.i_frame.fn_body_x;
+                    } break;
+                    case VmExpKind::Argument: {
+                        x = exp.args.i_argument.x;
+                    } break;
+                    case VmExpKind::Apply: {
+                        emit_call_cache(u);
+                        x = -1;
+                    } break;
+                    case VmExpKind::Return: {
+                        emit_word(u, exp.args.i_return.n);
+                        x = -1;
+                    } break;
+                    case VmExpKind::Shift: {
+                        emit_word(u, exp.args.i_shift.n);
+                        emit_word(u, exp.args.i_shift.m);
+                        x = exp.args.i_shift.x;
+                    } break;
+                    case VmExpKind::PInvoke: {
+                        emit_word(u, exp.args.i_pinvoke.n);
+                        emit_word(u, exp.args.i_pinvoke.proc_id);
+                        x = exp.args.i_pinvoke.x;
+                    } break;
+                    case VmExpKind::CallGlobal: {
+                        // the body's address is patched in, so that the call need not look it up.
+                        emit_word(u, exp.args.i_call_global.gn);
+                        defer(exp.args.i_call_global.body);
+                        x = -1;
+                    } break;
+                    case VmExpKind::ShiftCallGlobal: {
+                        emit_word(u, exp.args.i_call_global.gn);
+                        emit_word(u, exp.args.i_call_global.n);
+                        emit_word(u, exp.args.i_call_global.m);
+                        defer(exp.args.i_call_global.body);
+                        x = -1;
+                    } break;
+                    case VmExpKind::SelfTailCall: {
+                        emit_word(u, exp.args.i_call_global.n);
+                        defer(exp.args.i_call_global.body);
+                        x = -1;
+                    } break;
+                    case VmExpKind::ReferLocalPush:
+                    case VmExpKind::ReferFreePush:
+                    case VmExpKind::ReferGlobalPush: {
+                        emit_word(u, exp.args.i_refer.n);
+                        x = exp.args.i_refer.x;
+                    } break;
+                    case VmExpKind::ConstantPush: {
+                        emit_obj(u, exp.args.i_constant.obj);
+                        x = exp.args.i_constant.x;
+                    } break;
+                    case VmExpKind::ReferGlobalApply: {
+                        emit_call_cache(u);
+                        emit_word(u, exp.args.i_refer.n);
+                        x = -1;
+                    } break;
+                    case VmExpKind::ShiftApply: {
+                        emit_call_cache(u);
+                        emit_word(u, exp.args.i_shift.n);
+                        emit_word(u, exp.args.i_shift.m);
+                        x = -1;
+                    } break;
+                    case VmExpKind::ReferGlobalShiftApply: {
+                        emit_call_cache(u);
+                        emit_word(u, exp.args.i_refer_global_shift.gn);
+                        emit_word(u, exp.args.i_refer_global_shift.n);
+                        emit_word(u, exp.args.i_refer_global_shift.m);
+                        x = -1;
+                    } break;
+                    case VmExpKind::PrimAdd:
+                    case VmExpKind::PrimSub:
+                    case VmExpKind::PrimMul:
+                    case VmExpKind::PrimDiv:
+                    case VmExpKind::PrimRem:
+                    case VmExpKind::PrimEq:
+                    case VmExpKind::PrimLt:
+                    case VmExpKind::PrimGt:
+                    case VmExpKind::PrimLe:
+                    case VmExpKind::PrimGe:
+                    case VmExpKind::PrimCons:
+                    case VmExpKind::PrimCar:
+                    case VmExpKind::PrimCdr:
+                    case VmExpKind::PrimIsNull:
+                    case VmExpKind::PrimIsPair: {
+                        emit_word(u, exp.args.i_prim.proc_id);
+                        x = exp.args.i_prim.x;
+                    } break;
+                    default: {
+                        // 'define', and the kinds only emitted by lowering:
+                        std::stringstream ss;
+                        ss << "NotImplemented: lowering VmExp (" << x << ") to bytecode";
+                        error(ss.str());
+                        throw SsiError();
+                    }
+                }
+            }
+        }
+
+        for (PendingPatch const& patch: patches) {
+            *patch.operand = addr_word(placed(patch.target));
+        }
+        return placed(root_exp_id);
+    }
+
+    // lower_register_op places the register instruction for the VmExps from `exp_id`, if any, returning the
+    // VmExpID of its successor, else -1.
+    // Only VmExps of `exp_id`'s unit are covered, so that they need not be placed.
+    VmExpID VBytecode::lower_register_op(Unit& u, VmExpID exp_id, bool falls_through) {
+        VCodeUnitID unit = vmx_unit(exp_id);
+        auto covered = [&] (VmExpID x) -> VmExp const* {
+            return (x >= 0 && vmx_unit(x) == unit) ? &(*m_code)[x] : nullptr;
+        };
+        // each group of register kinds is in the order of the primitives:
+        auto register_kind = [] (VmExpKind first_register_kind, VmExpKind first_prim_kind, VmExpKind prim_kind) {
+            auto offset = static_cast<VmExpID>(prim_kind) - static_cast<VmExpID>(first_prim_kind);
+            return static_cast<VmExpKind>(static_cast<VmExpID>(first_register_kind) + offset);
+        };
+
+        VmExp const& exp = (*m_code)[exp_id];
+        switch (exp.kind) {
+            case VmExpKind::ReferLocal: {
+                // 'refer-local -> prim' for unary primitives: boxed locals are followed by 'indirect' instead.
+                VmExp const* prim = covered(exp.args.i_refer.x);
+                if (!prim || vmx_prim_arity(prim->kind) != 1) {
+                    return -1;
+                }
+                VmExpKind kind = register_kind(VmExpKind::PrimCarR, VmExpKind::PrimCar, prim->kind);
+                u.entries[vmx_index(exp_id)] = emit_op(u, kind, falls_through);
+                emit_word(u, prim->args.i_prim.proc_id);
+                emit_word(u, exp.args.i_refer.n);
+                return prim->args.i_prim.x;
+            }
+            case VmExpKind::ReferLocalPush:
+            case VmExpKind::ConstantPush: {
+                // 'push second argument -> load first argument -> prim' for binary primitives:
+                bool is_second_local = (exp.kind == VmExpKind::ReferLocalPush);
+                VmExp const* first = covered(is_second_local ? exp.args.i_refer.x : exp.args.i_constant.x);
+                if (!first || (first->kind != VmExpKind::ReferLocal && first->kind != VmExpKind::Constant)) {
+                    return -1;
+                }
+                bool is_first_local = (first->kind == VmExpKind::ReferLocal);
+                VmExp const* prim = covered(is_first_local ? first->args.i_refer.x : first->args.i_constant.x);
+                if (!prim || vmx_prim_arity(prim->kind) != 2) {
+                    return -1;
+                }
+
+                // a constant first argument is swapped with a local second one only if the primitive commutes,
+                // since the fallback then receives them swapped too.
+                size_t local_n = 0;
+                VmWord second_word = 0;
+                bool is_rr = false;
+                if (is_first_local && is_second_local) {
+                    local_n = first->args.i_refer.n;
+                    second_word = exp.args.i_refer.n;
+                    is_rr = true;
+                } else if (is_first_local) {
+                    local_n = first->args.i_refer.n;
+                    second_word = exp.args.i_constant.obj.as_raw();
+                } else if (is_second_local && (
+                    prim->kind == VmExpKind::PrimAdd || 
+                    prim->kind == VmExpKind::PrimMul || 
+                    prim->kind == VmExpKind::PrimEq
+                )) {
+                    local_n = exp.args.i_refer.n;
+                    second_word = first->args.i_constant.obj.as_raw();
+                } else {
+                    return -1;
+                }
+                VmExpKind kind = register_kind(
+                    is_rr ? VmExpKind::PrimAddRR : VmExpKind::PrimAddRK,
+                    VmExpKind::PrimAdd,
+                    prim->kind
+                );
+                u.entries[vmx_index(exp_id)] = emit_op(u, kind, falls_through);
+                emit_word(u, prim->args.i_prim.proc_id);
+                emit_word(u, local_n);
+                emit_word(u, second_word);
+                return prim->args.i_prim.x;
+            }
+            default: {
+                return -1;
+            }
+        }
+    }
+
+    ///
+    // Threading:
+    //
+
+    void VBytecode::thread(void* const* labels) {
+        if (labels != m_threaded_labels) {
+            // quickened operands would not match the handlers of the kinds they are threaded to:
+            deoptimize_all();
+            m_threaded_labels = labels;
+            m_unthreaded_units.clear();
+            for (std::unique_ptr<Unit>& u: m_units) {
+                if (u) {
+                    u->threaded_op_count = 0;
+                    u->is_queued = true;
+                    m_unthreaded_units.push_back(u->id);
+                }
+            }
+        }
+        for (VCodeUnitID unit: m_unthreaded_units) {
+            Unit& u = *m_units[unit];
+            for (; u.threaded_op_count < u.ops.size(); u.threaded_op_count++) {
+                auto [word, kind] = u.ops[u.threaded_op_count];
+                *word = reinterpret_cast<VmWord>(labels[static_cast<size_t>(kind)]);
+            }
+            u.is_queued = false;
+        }
+        m_unthreaded_units.clear();
+    }
+
+    void VBytecode::thread_entry(VmCodePtr pc, void* handler) {
+        std::erase_if(m_quickenings, [&] (Quickening const& q) {
+            if (q.op != pc) {
+                return false;
+            }
+            if (q.kind == VmExpKind::ReferGlobal) {
+                m_quickened_global_counts[q.operand]--;
+            }
+            deoptimize(q);
+            return true;
+        });
+        *const_cast<VmWord*>(pc) = reinterpret_cast<VmWord>(handler);
+    }
+
+    ///
+    // Quickening:
+    //
+
+    VmWord VBytecode::op_word(VmExpKind kind) const {
+        if (m_threaded_labels) {
+            return reinterpret_cast<VmWord>(m_threaded_labels[static_cast<size_t>(kind)]);
+        } else {
+            return static_cast<VmWord>(kind);
+        }
+    }
+
+    void VBytecode::quicken_global(VmCodePtr pc, OBJECT value) {
+        auto op = const_cast<VmWord*>(pc);
+        if (*op != op_word(VmExpKind::ReferGlobal)) {
+            return;
+        }
+        size_t gn = op[1];
+        m_quickenings.push_back({op, VmExpKind::ReferGlobal, 1, gn});
+        if (gn >= m_quickened_global_counts.size()) {
+            m_quickened_global_counts.resize(gn + 1, 0);
+        }
+        m_quickened_global_counts[gn]++;
+        op[1] = value.as_raw();
+        *op = op_word(VmExpKind::Constant);
+    }
+    void VBytecode::quicken_call(VmCodePtr pc, OBJECT closure, VmCodePtr body_pc) {
+        static constexpr std::pair<VmExpKind, VmExpKind> s_cached_kinds[] = {
+            {VmExpKind::Apply, VmExpKind::ApplyCached},
+            {VmExpKind::ReferGlobalApply, VmExpKind::ReferGlobalApplyCached},
+            {VmExpKind::ShiftApply, VmExpKind::ShiftApplyCached},
+            {VmExpKind::ReferGlobalShiftApply, VmExpKind::ReferGlobalShiftApplyCached}
+        };
+        auto op = const_cast<VmWord*>(pc);
+        for (auto [kind, cached_kind]: s_cached_kinds) {
+            if (*op != op_word(kind)) {
+                continue;
+            }
+            auto cache = const_cast<VmWord*>(call_cache(pc));
+            if (cache[0] != UNCACHED_CALL) {
+                return;
+            }
+            m_quickenings.push_back({op, kind, static_cast<size_t>(cache - op), UNCACHED_CALL});
+            cache[0] = closure.as_raw();
+            cache[1] = addr_word(body_pc);
+            *op = op_word(cached_kind);
+            return;
+        }
+    }
+    void VBytecode::uncache_call(VmCodePtr pc) {
+        // the call is not deoptimized again, so that it stays POLYMORPHIC_CALL:
+        auto op = const_cast<VmWord*>(pc);
+        std::erase_if(m_quickenings, [&] (Quickening const& q) {
+            if (q.op != op) {
+                return false;
+            }
+            *op = op_word(q.kind);
+            op[q.operand_index] = POLYMORPHIC_CALL;
+            return true;
+        });
+    }
+
+    void VBytecode::deoptimize(Quickening const& q) {
+        *q.op = op_word(q.kind);
+        q.op[q.operand_index] = q.operand;
+    }
+    void VBytecode::deoptimize_global(size_t gn) {
+        std::erase_if(m_quickenings, [&] (Quickening const& q) {
+            if (q.kind == VmExpKind::ReferGlobal && q.operand == gn) {
+                deoptimize(q);
+                return true;
+            }
+            return false;
+        });
+        m_quickened_global_counts[gn] = 0;
+    }
+    void VBytecode::deoptimize_all() {
+        for (Quickening const& q: m_quickenings) {
+            deoptimize(q);
+        }
+        m_quickenings.clear();
+        m_quickened_global_counts.clear();
+    }
+
+    ///
+    // Dump:
+    //
+
+    size_t VBytecode::width(VmExpKind kind) {
+        switch (kind) {
+            case VmExpKind::Halt:
+            case VmExpKind::Indirect:
+            case VmExpKind::Nuate:
+            case VmExpKind::Argument:
+                return 1;
+            case VmExpKind::ReferLocal:
+            case VmExpKind::ReferFree:
+            case VmExpKind::ReferGlobal:
+            case VmExpKind::Constant:
+            case VmExpKind::Conti:
+            case VmExpKind::Box:
+            case VmExpKind::Test:
+            case VmExpKind::AssignLocal:
+            case VmExpKind::AssignFree:
+            case VmExpKind::AssignGlobal:
+            case VmExpKind::AssignLocalUnboxed:
+            case VmExpKind::Frame:
+            case VmExpKind::Return:
+            case VmExpKind::Jump:
+            case VmExpKind::ReferLocalPush:
+            case VmExpKind::ReferFreePush:
+            case VmExpKind::ReferGlobalPush:
+            case VmExpKind::ConstantPush:
+            case VmExpKind::PrimAdd:
+            case VmExpKind::PrimSub:
+            case VmExpKind::PrimMul:
+            case VmExpKind::PrimDiv:
+            case VmExpKind::PrimRem:
+            case VmExpKind::PrimEq:
+            case VmExpKind::PrimLt:
+            case VmExpKind::PrimGt:
+            case VmExpKind::PrimLe:
+            case VmExpKind::PrimGe:
+            case VmExpKind::PrimCons:
+            case VmExpKind::PrimCar:
+            case VmExpKind::PrimCdr:
+            case VmExpKind::PrimIsNull:
+            case VmExpKind::PrimIsPair:
+                return 2;
+            case VmExpKind::Close:
+            case VmExpKind::Shift:
+            case VmExpKind::PInvoke:
+            case VmExpKind::CallGlobal:
+            case VmExpKind::SelfTailCall:
+            case VmExpKind::PrimCarR:
+            case VmExpKind::PrimCdrR:
+            case VmExpKind::PrimIsNullR:
+            case VmExpKind::PrimIsPairR:
+            case VmExpKind::Apply:              // calls begin with their cache: cf `call_cache`
+            case VmExpKind::ApplyCached:
+                return 3;
+            case VmExpKind::ReferGlobalApply:
+            case VmExpKind::ReferGlobalApplyCached:
+            case VmExpKind::PrimAddRR:
+            case VmExpKind::PrimSubRR:
+            case VmExpKind::PrimMulRR:
+            case VmExpKind::PrimDivRR:
+            case VmExpKind::PrimRemRR:
+            case VmExpKind::PrimEqRR:
+            case VmExpKind::PrimLtRR:
+            case VmExpKind::PrimGtRR:
+            case VmExpKind::PrimLeRR:
+            case VmExpKind::PrimGeRR:
+            case VmExpKind::PrimConsRR:
+            case VmExpKind::PrimAddRK:
+            case VmExpKind::PrimSubRK:
+            case VmExpKind::PrimMulRK:
+            case VmExpKind::PrimDivRK:
+            case VmExpKind::PrimRemRK:
+            case VmExpKind::PrimEqRK:
+            case VmExpKind::PrimLtRK:
+            case VmExpKind::PrimGtRK:
+            case VmExpKind::PrimLeRK:
+            case VmExpKind::PrimGeRK:
+            case VmExpKind::PrimConsRK:
+                return 4;
+            case VmExpKind::ShiftCallGlobal:
+            case VmExpKind::ShiftApply:
+            case VmExpKind::ShiftApplyCached:
+                return 5;
+            case VmExpKind::ReferGlobalShiftApply:
+            case VmExpKind::ReferGlobalShiftApplyCached:
+                return 6;
+            case VmExpKind::Define:
+                return 0;
+        }
+        return 0;
+    }
+
+    bool VBytecode::is_addr_operand(VmExpKind kind, size_t j) {
+        switch (kind) {
+            case VmExpKind::Test:
+            case VmExpKind::Frame:
+            case VmExpKind::Jump:
+                return j == 1;
+            case VmExpKind::CallGlobal:
+            case VmExpKind::SelfTailCall:
+                return j == 2;
+            case VmExpKind::ShiftCallGlobal:
+                return j == 4;
+            default:
+                return false;
+        }
+    }
+
+    bool VBytecode::is_obj_operand(VmExpKind kind, size_t j) {
+        switch (kind) {
+            case VmExpKind::Constant:
+            case VmExpKind::ConstantPush:
+                return j == 1;
+            default:
+                return j == 3 && kind >= VmExpKind::PrimAddRK && kind <= VmExpKind::PrimConsRK;
+        }
+    }
+
+    void VBytecode::print(std::ostream& out) const {
+        for (std::unique_ptr<Unit> const& u: m_units) {
+            if (!u) {
+                continue;
+            }
+            out << "  unit " << u->id << ":" << std::endl;
+            for (auto const& [word, kind]: u->ops) {
+                out << "  [" << static_cast<void const*>(word) << "] ";
+                print_one(word, out);
+                out << std::endl;
+            }
+        }
+    }
+    void VBytecode::print_one(VmCodePtr pc, std::ostream& out) const {
+        // only used to debug, so the instruction is looked up linearly:
+        for (std::unique_ptr<Unit> const& u: m_units) {
+            if (!u) {
+                continue;
+            }
+            for (auto const& [word, kind]: u->ops) {
+                if (word != pc) {
+                    continue;
+                }
+                out << "(" << vmx_kind_name(kind);
+                for (size_t j = 1; j < width(kind); j++) {
+                    if (is_obj_operand(kind, j)) {
+                        out << " " << std::bit_cast<OBJECT>(pc[j]);
+                    } else if (is_addr_operand(kind, j)) {
+                        out << " " << reinterpret_cast<void const*>(pc[j]);
+                    } else {
+                        out << " " << static_cast<ssize_t>(pc[j]);
+                    }
+                }
+                out << ")";
+                return;
+            }
+        }
+        out << "(?)";
+    }
+
+}   // namespace ss
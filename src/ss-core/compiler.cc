@@ -1,20 +1,26 @@
 #include "ss-core/compiler.hh"
 
 #include <utility>
+#include <algorithm>
 #include "ss-core/printing.hh"
 #include "ss-core/common.hh"
 #include "ss-core/object.hh"
 #include "ss-core/feedback.hh"
+#include "ss-core/config.hh"
+#include "ss-core/peephole.hh"
+#include "ss-core/trace.hh"
 
 namespace ss {
 
-    constexpr gc::SizeClassIndex vcode_sci = gc::sci(sizeof(VCode));
-
     Compiler::Compiler(GcThreadFrontEnd& gc_tfe) 
     :   Analyst(),
-        m_code(new(gc_tfe.allocate_size_class(vcode_sci)) VCode()),
+        m_code(new VCode()),
         m_gc_tfe(gc_tfe),
-        m_gdef_set(OBJECT::null)
+        m_lambda_locs(),
+        m_defining_procs(),
+        m_lambda_depth(0),
+        m_line_known_procs(),
+        m_local_frame()
     {}
 
     VSubr Compiler::compile_expr(std::string subr_name, OBJECT expr_datum) {
@@ -22,27 +28,61 @@ namespace ss {
         return compile_subr(std::move(subr_name), std::move(line_code_objects));
     }
     VSubr Compiler::compile_subr(std::string subr_name, std::vector<OBJECT> line_code_objects) {
-        std::vector<VmProgram> line_programs;
-        line_programs.reserve(line_code_objects.size());
+        VSubr subr{std::move(subr_name), {}, {}};
+        extend_subr(subr, std::move(line_code_objects));
+        return VSubr{std::move(subr)};
+    }
+    void Compiler::extend_subr(VSubr& subr, std::vector<OBJECT> line_code_objects) {
+        TraceSpan span{"compile", subr.name};
+        // each subr is compiled into a unit of its own, so that it can be freed on its own:
+        if (subr.unit == VCODE_NO_UNIT) {
+            subr.unit = m_code->new_unit();
+        } else {
+            m_code->select_unit(subr.unit);
+        }
+#if !CONFIG_DISABLE_SUPERINSTRUCTIONS
+        VmExpID first_exp_id = m_code->next_exp_id();
+#endif
+        subr.line_programs.reserve(subr.line_programs.size() + line_code_objects.size());
         for (auto const code_object: line_code_objects) {
             // convert 'syntax' object into datum before compiling, discarding line info
             // if passes previous pass, then only runtime errors can be generated
+            // - the location of each lambda is kept, cf `VCode::closure_loc`
             auto datum_code_object = code_object;
             if (code_object.is_syntax()) {
-                datum_code_object = code_object.as_syntax_p()->to_datum(&m_gc_tfe);
+                datum_code_object = code_object.as_syntax_p()->to_datum(&m_gc_tfe, &m_lambda_locs);
                 // std::cerr 
                 //     << "syntax->datum: " << std::endl
                 //     << "syntax: " << code_object << std::endl
                 //     << "datum:  " << datum_code_object << std::endl;
             }
             auto program = compile_line(datum_code_object);
-            line_programs.push_back(program);
+            subr.line_programs.push_back(program);
+            subr.line_code_objs.push_back(datum_code_object);
+            m_lambda_locs.clear();
+
+            // the line's syntax objects and locations are no longer needed, so only its datum is kept:
+            if (code_object.is_syntax()) {
+                FLocTable::drop(code_object.as_syntax_p()->loc_id());
+            }
         }
-        return VSubr{std::move(subr_name), std::move(line_code_objects), std::move(line_programs)};
+#if !CONFIG_DISABLE_SUPERINSTRUCTIONS
+        fuse_superinstructions(*m_code, first_exp_id);
+#endif
     }
     VmProgram Compiler::compile_line(OBJECT line_code_obj) {
+        m_defining_procs.clear();
+        m_line_known_procs.clear();
+        m_lambda_depth = 0;
+        m_local_frame = {};
         VmExpID last_exp_id = m_code->new_vmx_halt();
         VmExpID res = compile_exp(line_code_obj, last_exp_id);
+
+        // the procedures this line defines are only known to later lines, which run after it: this line
+        // may call them before they are assigned, since it is compiled last-to-first.
+        for (auto const& [gdef_id, proc]: m_line_known_procs) {
+            m_code->set_known_proc(gdef_id, proc);
+        }
         return {res, last_exp_id};
     }
     VmExpID Compiler::compile_exp(OBJECT x, VmExpID next) {
@@ -95,20 +135,30 @@ namespace ss {
                 
                 // NOTE: We make boxes for vars only, not free. 
                 // cf three-imp p.101.
-
+                // - the locals the body defines are popped with the arguments on return.
+
+                LocalFrame outer_frame = std::move(m_local_frame);
+                m_local_frame = {static_cast<size_t>(list_length(vars)), {}};
+                find_local_defines(body, m_local_frame.defines);
+                m_lambda_depth++;
+                VmExpID body_x = make_boxes(
+                    vars,
+                    reserve_local_defines(
+                        compile_exp(
+                            body,
+                            m_code->new_vmx_return(m_local_frame.arity + m_local_frame.defines.size())
+                        )
+                    )
+                );
+                m_lambda_depth--;
+                m_local_frame = std::move(outer_frame);
+                auto loc_it = m_lambda_locs.find(obj);
+                if (loc_it != m_lambda_locs.end()) {
+                    m_code->set_closure_loc(body_x, loc_it->second);
+                }
                 return collect_free(
                     free,
-                    m_code->new_vmx_close(
-                        list_length(free),
-                        make_boxes(
-                            vars,
-                            compile_exp(
-                                body,
-                                m_code->new_vmx_return(list_length(vars))
-                            )
-                        ),
-                        next
-                    )
+                    m_code->new_vmx_close(list_length(free), body_x, next)
                 );
             }
 
@@ -188,25 +238,25 @@ namespace ss {
                 auto args = extract_args<1>(tail);
                 auto x = args[0];
                 
-                bool is_tail_call = is_tail_vmx(next);
-                ssize_t m; 
-                if (is_tail_call) {
+                // in tail position, 'k' returns straight to our caller, whose frame is below our 'm' items:
+                // pushing a frame here would be dropped by the shift, cf three-imp p.97.
+                if (is_tail_vmx(next)) {
                     assert((*m_code)[next].kind == VmExpKind::Return);
-                    m = (*m_code)[next].args.i_return.n;
-                } else {
-                    // 'm' unused
+                    ssize_t m = (*m_code)[next].args.i_return.n;
+                    return m_code->new_vmx_conti(
+                        m,
+                        m_code->new_vmx_argument(
+                            compile_exp(x, m_code->new_vmx_shift(1, m, m_code->new_vmx_apply()))
+                        )
+                    );
                 }
 
                 return m_code->new_vmx_frame(
                     // 'x' in three-imp, p.97
                     m_code->new_vmx_conti(
+                        0,
                         m_code->new_vmx_argument(
-                            compile_exp(
-                                x, 
-                                (is_tail_call ? 
-                                    m_code->new_vmx_shift(1, m, m_code->new_vmx_apply()) : 
-                                    m_code->new_vmx_apply())
-                            )
+                            compile_exp(x, m_code->new_vmx_apply())
                         )
                     ),
 
@@ -228,17 +278,22 @@ namespace ss {
                 auto scope_sym = scope_sym_obj.as_symbol();
                 if (scope_sym == g_id_cache().global) {
                     GDefID gdef_id = static_cast<LDefID>(name.as_integer());
-                    return compile_exp(
-                        body,
-                        m_code->new_vmx_assign_global(gdef_id, next)
-                    );
+                    VmExpID assign_x = m_code->new_vmx_assign_global(gdef_id, next);
+                    if (is_known_proc_defn(gdef_id, body)) {
+                        return compile_known_proc_defn(gdef_id, body, assign_x);
+                    }
+                    return compile_exp(body, assign_x);
                 }
                 if (scope_sym == g_id_cache().local) {
-                    LDefID ldef_id = static_cast<LDefID>(name.as_integer());
-                    return compile_exp(
-                        body,
-                        m_code->new_vmx_assign_local(ldef_id, next)
+                    // the local's slot was reserved as the body was entered, like its box if it has one:
+                    ssize_t n = local_slot(-1, name);
+                    assert(n < 0 && "Expected a local defined by the body being compiled");
+                    VmExpID assign_x = (
+                        is_boxed_local(name) ?
+                        m_code->new_vmx_assign_local(n, next) :
+                        m_code->new_vmx_assign_local_unboxed(n, next)
                     );
+                    return compile_exp(body, assign_x);
                 }
 
                 std::stringstream ss;
@@ -257,6 +312,22 @@ namespace ss {
                 OBJECT rem_args = proc_args;
                 ssize_t arg_count = list_length(rem_args);
                 PlatformProcID platform_proc_idx = static_cast<PlatformProcID>(proc_name.as_integer());
+
+                // inlining primitives:
+                // like 'p/invoke', arguments are evaluated last-to-first, but the first argument is left in 
+                // the accumulator rather than pushed.
+                VmExpKind prim_kind = m_code->platform_proc_prim(platform_proc_idx);
+                if (prim_kind != VmExpKind::PInvoke && vmx_prim_arity(prim_kind) == arg_count) {
+                    VmExpID prim_body = compile_exp(
+                        car(proc_args),
+                        m_code->new_vmx_prim(prim_kind, platform_proc_idx, next)
+                    );
+                    if (arg_count == 2) {
+                        prim_body = compile_exp(cadr(proc_args), m_code->new_vmx_argument(prim_body));
+                    }
+                    return prim_body;
+                }
+
                 VmExpID next_body = m_code->new_vmx_pinvoke(
                     arg_count, platform_proc_idx,
                     next
@@ -266,9 +337,10 @@ namespace ss {
                 if (!m_code->platform_proc_is_variadic(platform_proc_idx)) {
                     if (arg_count != expected_arg_count) {
                         std::stringstream ss;
-                        ss  << "Invalid argument count for 'p/invoke' " << interned_string(proc_name.as_symbol())
+                        ss  << "Invalid argument count for 'p/invoke' " << interned_string(m_code->pproc_tab().metadata(platform_proc_idx).name)
                             << ": expected " << expected_arg_count << " args but got " << arg_count << " args";
                         error(ss.str());
+                        throw SsiError();
                     }                
                 }
                 
@@ -314,7 +386,7 @@ namespace ss {
 
             // (reference ...)
             else if (keyword_symbol_id == g_id_cache().reference) {
-                auto args = extract_args<2>(tail);
+                auto args = extract_args<2>(tail, true);
                 OBJECT rel_var_scope_sym_obj = args[0];
                 OBJECT def_id_obj = args[1];
 
@@ -324,23 +396,61 @@ namespace ss {
                 assert(def_id_obj.is_integer());
                 ssize_t def_id = def_id_obj.as_integer();
 
+                if (rel_var_scope_sym == g_id_cache().global) {
+                    return m_code->new_vmx_refer_global(def_id, next);
+                }
+
+                // (reference local|free idx ldef-id): boxed locals are unboxed after each reference.
+                auto local_args = extract_args<3>(tail);
+                VmExpID after_refer_x = (is_boxed_local(local_args[2]) ? m_code->new_vmx_indirect(next) : next);
                 if (rel_var_scope_sym == g_id_cache().local) {
-                    return m_code->new_vmx_refer_local(def_id, next);
+                    return m_code->new_vmx_refer_local(local_slot(def_id, local_args[2]), after_refer_x);
                 }
                 if (rel_var_scope_sym == g_id_cache().free) {
-                    return m_code->new_vmx_refer_free(def_id, next);
-                }
-                if (rel_var_scope_sym == g_id_cache().global) {
-                    return m_code->new_vmx_refer_global(def_id, next);
+                    return m_code->new_vmx_refer_free(def_id, after_refer_x);
                 }
 
-                error("Unknown rel_var_scope_sym: " + interned_string(rel_var_scope_sym));
+                error("Unknown rel_var_scope_sym: " + std::string{interned_string(rel_var_scope_sym)});
                 throw SsiError();
             }
 
             // (mutation ...)
             else if (keyword_symbol_id == g_id_cache().mutation) {
-                error("NotImplemented: compiling 'mutation' terms");
+                auto args = extract_args<4>(tail);
+                OBJECT rel_var_scope_sym_obj = args[0];
+                OBJECT def_id_obj = args[1];
+                OBJECT ldef_id_obj = args[2];
+                OBJECT init = args[3];
+
+                assert(rel_var_scope_sym_obj.is_symbol());
+                IntStr rel_var_scope_sym = rel_var_scope_sym_obj.as_symbol();
+
+                assert(def_id_obj.is_integer());
+                ssize_t def_id = def_id_obj.as_integer();
+
+                // see three-imp p.105
+                // - a local no closure captures is not boxed, so it is assigned in its stack slot.
+                // - a free variable is only mutated if boxed.
+                if (rel_var_scope_sym == g_id_cache().local) {
+                    ssize_t n = local_slot(def_id, ldef_id_obj);
+                    VmExpID assign_x = (
+                        is_boxed_local(ldef_id_obj) ?
+                        m_code->new_vmx_assign_local(n, next) :
+                        m_code->new_vmx_assign_local_unboxed(n, next)
+                    );
+                    return compile_exp(init, assign_x);
+                }
+                if (rel_var_scope_sym == g_id_cache().free) {
+                    assert(is_boxed_local(ldef_id_obj));
+                    return compile_exp(init, m_code->new_vmx_assign_free(def_id, next));
+                }
+                if (rel_var_scope_sym == g_id_cache().global) {
+                    // globals may be known procedures, called directly: cf `is_known_proc_defn`.
+                    error("NotImplemented: compiling 'mutation' terms for global variables");
+                    throw SsiError();
+                }
+
+                error("Unknown rel_var_scope_sym: " + std::string{interned_string(rel_var_scope_sym)});
                 throw SsiError();
             }
 
@@ -354,17 +464,49 @@ namespace ss {
         {
             // function call
             bool is_tail_call = is_tail_vmx(next);
-            ssize_t m;
+            ssize_t m = 0;
             if (is_tail_call) {
                 assert((*m_code)[next].kind == VmExpKind::Return);
                 m = (*m_code)[next].args.i_return.n;
             }
-            VmExpID next_body = compile_exp(
-                head, 
-                (is_tail_call ?
-                    m_code->new_vmx_shift(list_length(obj->cdr()), m, m_code->new_vmx_apply()) :
-                    m_code->new_vmx_apply())
-            );
+            VmExpID next_body;
+            GDefID callee_gdef_id;
+            KnownProc callee;
+            DefiningProc* defining_callee;
+            if (lookup_known_callee(head, &callee_gdef_id, &callee, &defining_callee)) {
+                // a known procedure is called: its body is entered directly, without checking the closure.
+                ssize_t arg_count = list_length(tail);
+                if (arg_count != static_cast<ssize_t>(callee.arity)) {
+                    std::stringstream ss;
+                    ss  << "Invalid argument count for call to " << interned_string(lookup_gdef(callee_gdef_id).name())
+                        << ": expected " << callee.arity << " args but got " << arg_count << " args";
+                    error(ss.str());
+                    throw SsiError();
+                }
+                if (
+                    defining_callee && is_tail_call && defining_callee->lambda_depth == m_lambda_depth && 
+                    m == arg_count
+                ) {
+                    // calling itself from its own frame, e.g. a loop: the arguments are overwritten in place.
+                    // A frame holding locals its body defined is shifted over instead, cf `LocalFrame`.
+                    next_body = m_code->new_vmx_self_tail_call(callee_gdef_id, callee.body, arg_count);
+                } else if (is_tail_call && m > 0) {
+                    next_body = m_code->new_vmx_shift_call_global(callee_gdef_id, callee.body, arg_count, m);
+                } else {
+                    next_body = m_code->new_vmx_call_global(callee_gdef_id, callee.body);
+                }
+                if (defining_callee) {
+                    defining_callee->self_calls.push_back(next_body);
+                }
+            } else {
+                // a tail call from a procedure without arguments has none to shift over.
+                next_body = compile_exp(
+                    head, 
+                    (is_tail_call && m > 0 ?
+                        m_code->new_vmx_shift(list_length(obj->cdr()), m, m_code->new_vmx_apply()) :
+                        m_code->new_vmx_apply())
+                );
+            }
             OBJECT rem_args = tail;
             // evaluating arguments in reverse order: first is 'next' of second, ...
             while (!rem_args.is_null()) {
@@ -394,7 +536,6 @@ namespace ss {
         assert(use_is_mut_obj.is_boolean());
 
 #if NDEBUG
-        SUPPRESS_UNUSED_VARIABLE_WARNING(ldef_id_obj);
         SUPPRESS_UNUSED_VARIABLE_WARNING(use_is_mut_obj);
 #endif
 
@@ -404,7 +545,7 @@ namespace ss {
         // bool is_mut = use_is_mut_obj.as_boolean();
 
         if (parent_rel_var_scope_sym == g_id_cache().local) {
-            return m_code->new_vmx_refer_local(parent_idx, next);
+            return m_code->new_vmx_refer_local(local_slot(parent_idx, ldef_id_obj), next);
         }
         if (parent_rel_var_scope_sym == g_id_cache().free) {
             return m_code->new_vmx_refer_free(parent_idx, next);
@@ -419,6 +560,68 @@ namespace ss {
         throw SsiError();
     }
 
+    bool Compiler::is_known_proc_defn(GDefID gdef_id, OBJECT init) const {
+        // (expanded-lambda vars () body) without 'set!' on the global: nothing but this closure is ever assigned
+        // to it.
+        if (lookup_gdef(gdef_id).is_mutated()) {
+            return false;
+        }
+        if (!init.is_pair() || !car(init).is_symbol() || car(init).as_symbol() != g_id_cache().expanded_lambda) {
+            return false;
+        }
+        auto args = extract_args<3>(cdr(init));
+        OBJECT free = args[1];
+        return free.is_null();
+    }
+    VmExpID Compiler::compile_known_proc_defn(GDefID gdef_id, OBJECT lambda, VmExpID next) {
+        auto args = extract_args<3>(cdr(lambda));
+        OBJECT vars = args[0];
+        m_defining_procs.push_back({gdef_id, static_cast<size_t>(list_length(vars)), m_lambda_depth+1, {}});
+        VmExpID close_x = compile_exp(lambda, next);
+        DefiningProc proc = std::move(m_defining_procs.back());
+        m_defining_procs.pop_back();
+
+        // without free variables, the lambda compiles to a lone 'close':
+        assert((*m_code)[close_x].kind == VmExpKind::Close);
+        VmExpID body = (*m_code)[close_x].args.i_close.body;
+        for (VmExpID call_x: proc.self_calls) {
+            (*m_code)[call_x].args.i_call_global.body = body;
+        }
+        m_line_known_procs.push_back({gdef_id, KnownProc{body, proc.arity}});
+        return close_x;
+    }
+    bool Compiler::lookup_known_callee(
+        OBJECT head, GDefID* out_gdef_id, KnownProc* out_proc, DefiningProc** out_defining_proc
+    ) {
+        // (reference global gdef-id), cf expander:
+        if (!head.is_pair() || !car(head).is_symbol() || car(head).as_symbol() != g_id_cache().reference) {
+            return false;
+        }
+        auto args = extract_args<2>(cdr(head), true);
+        if (!args[0].is_symbol() || args[0].as_symbol() != g_id_cache().global) {
+            return false;
+        }
+        GDefID gdef_id = static_cast<GDefID>(args[1].as_integer());
+        *out_gdef_id = gdef_id;
+
+        // a procedure defined by an earlier line:
+        if (KnownProc const* proc = m_code->known_proc(gdef_id)) {
+            *out_proc = *proc;
+            *out_defining_proc = nullptr;
+            return true;
+        }
+
+        // a procedure calling itself from its body, whose VmExpID is not known yet:
+        for (auto it = m_defining_procs.rbegin(); it != m_defining_procs.rend(); it++) {
+            if (it->gdef_id == gdef_id) {
+                *out_proc = KnownProc{-1, it->arity};
+                *out_defining_proc = &*it;
+                return true;
+            }
+        }
+        return false;
+    }
+
     bool Compiler::is_tail_vmx(VmExpID vmx_id) {
         return (*m_code)[vmx_id].kind == VmExpKind::Return;
     }
@@ -450,14 +653,61 @@ namespace ss {
             auto ldef_id = ldef_id_obj.as_integer();
             auto ldef = m_code->def_tab().local(ldef_id);
 
-            if (ldef.is_mutated()) {
+            if (ldef.is_boxed()) {
                 x = m_code->new_vmx_box(n, x);
             }
         }
         return x;
     }
+    bool Compiler::is_boxed_local(OBJECT ldef_id_obj) const {
+        assert(ldef_id_obj.is_integer() && "Expected LDefID (int) for local var");
+        LDefID ldef_id = static_cast<LDefID>(ldef_id_obj.as_integer());
+        return m_code->def_tab().local(ldef_id).is_boxed();
+    }
+    void Compiler::find_local_defines(OBJECT x, std::vector<LDefID>& out) const {
+        // the body's own definitions, in order: those of nested lambdas are in their frames, and quoted data 
+        // is not code.
+        if (!x.is_pair()) {
+            return;
+        }
+        OBJECT head = car(x);
+        if (head.is_symbol()) {
+            IntStr keyword = head.as_symbol();
+            if (keyword == g_id_cache().quote || keyword == g_id_cache().expanded_lambda) {
+                return;
+            }
+            if (keyword == g_id_cache().expanded_define) {
+                auto args = extract_args<3>(cdr(x));
+                if (args[0].is_symbol() && args[0].as_symbol() == g_id_cache().local) {
+                    out.push_back(static_cast<LDefID>(args[1].as_integer()));
+                }
+            }
+        }
+        for (OBJECT it = x; it.is_pair(); it = cdr(it)) {
+            find_local_defines(car(it), out);
+        }
+    }
+    VmExpID Compiler::reserve_local_defines(VmExpID next) {
+        // a slot is pushed for each definition before the body runs, so that closures made before a definition
+        // runs share its box, if it has one: cf `Scoper::rw_list_stx_data__define`.
+        VmExpID x = next;
+        for (auto it = m_local_frame.defines.rbegin(); it != m_local_frame.defines.rend(); it++) {
+            if (m_code->def_tab().local(*it).is_boxed()) {
+                x = m_code->new_vmx_box(0, x);
+            }
+            x = m_code->new_vmx_constant(OBJECT::undef, m_code->new_vmx_argument(x));
+        }
+        return x;
+    }
+    ssize_t Compiler::local_slot(ssize_t idx, OBJECT ldef_id_obj) const {
+        // a local's index is its argument's, unless the body defines it: the i-th definition is at -1-i.
+        assert(ldef_id_obj.is_integer() && "Expected LDefID (int) for local var");
+        LDefID ldef_id = static_cast<LDefID>(ldef_id_obj.as_integer());
+        auto const& defines = m_local_frame.defines;
+        auto it = std::find(defines.begin(), defines.end(), ldef_id);
+        return (it == defines.end()) ? idx : -1 - (it - defines.begin());
+    }
     GDefID Compiler::define_global(FLoc loc, IntStr name, OBJECT code, OBJECT init, std::string docstring) {
-        m_gdef_set = set_cons(OBJECT::make_symbol(name), m_gdef_set);
         return m_code->define_global(loc, name, code, init, docstring);
     }
     Definition const& Compiler::lookup_gdef(GDefID gdef_id) const {
@@ -467,6 +717,10 @@ namespace ss {
         return m_code->try_lookup_gdef_by_name(name);
     }
 
+    void Compiler::mark(GcMarker& marker) const {
+        m_code->mark(marker);
+    }
+
     void Compiler::initialize_platform_globals(std::vector<OBJECT>& global_vals) {
         for (size_t i = 0; i < m_code->count_globals(); i++) {
             GDefID gdef_id = static_cast<GDefID>(i);
@@ -498,52 +752,25 @@ namespace ss {
             is_variadic
         );
     }
-    PlatformProcID Compiler::lookup_platform_proc(IntStr name) {
-        return m_code->lookup_platform_proc(name);
-    }
-
-    /// Scheme Set functions
-    //
-
-    bool Compiler::is_set_member(OBJECT x, OBJECT s) {
-        if (s.is_null()) {
-            return false;
-        }
-        if (is_eq(x, car(s))) {
-            return true;
-        }
-        return is_set_member(x, cdr(s));
-    }
-    OBJECT Compiler::set_cons(OBJECT x, OBJECT s) {
-        if (is_set_member(x, s)) {
-            return s;
-        } else {
-            return cons(&m_gc_tfe, x, s);
-        }
-    }
-    OBJECT Compiler::set_union(OBJECT s1, OBJECT s2) {
-        if (s1.is_null()) {
-            return s2;
-        } else {
-            return set_union(cdr(s1), set_cons(car(s1), s2));
-        }
-    }
-    OBJECT Compiler::set_minus(OBJECT s1, OBJECT s2) {
-        if (s1.is_null()) {
-            return OBJECT::null;
-        } else if (is_set_member(car(s1), s2)) {
-            return set_minus(cdr(s1), s2);
-        } else {
-            return cons(&m_gc_tfe, car(s1), set_minus(cdr(s1), s2));
+    PlatformProcID Compiler::define_platform_proc(
+        IntStr platform_proc_name, 
+        std::vector<std::string> arg_names, 
+        PlatformProcFn fn, 
+        std::string docstring
+    ) {
+        std::vector<IntStr> rw_arg_names;
+        rw_arg_names.reserve(arg_names.size());
+        for (auto const& s: arg_names) {
+            rw_arg_names.push_back(intern(s));
         }
+        return m_code->define_platform_proc(
+            platform_proc_name, 
+            std::move(rw_arg_names), 
+            fn, 
+            std::move(docstring)
+        );
     }
-    OBJECT Compiler::set_intersect(OBJECT s1, OBJECT s2) {
-        if (s1.is_null()) {
-            return OBJECT::null;
-        } else if (is_set_member(car(s1), s2)) {
-            return cons(&m_gc_tfe, car(s1), set_intersect(cdr(s1), s2));
-        } else {
-            return set_intersect(cdr(s1), s2);
-        }
+    PlatformProcID Compiler::lookup_platform_proc(IntStr name) {
+        return m_code->lookup_platform_proc(name);
     }
 }
\ No newline at end of file
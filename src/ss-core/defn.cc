@@ -8,12 +8,20 @@ namespace ss {
     m_init(init),
     m_docstring(std::move(docstring)),
     m_loc(loc),
-    m_is_mutated(false)
+    m_is_mutated(false),
+    m_is_captured(false),
+    m_is_frame_capturable(false)
   {}
 
   void Definition::mark_as_mutated() {
     m_is_mutated = true;
   }
+  void Definition::mark_as_captured() {
+    m_is_captured = true;
+  }
+  void Definition::mark_as_frame_capturable() {
+    m_is_frame_capturable = true;
+  }
 
   void DefTable::mark_global_defn_mutated(GDefID def_id) {
     m_globals_vec[def_id].mark_as_mutated();
@@ -21,6 +29,12 @@ namespace ss {
   void DefTable::mark_local_defn_mutated(LDefID def_id) {
     m_locals_vec[def_id].mark_as_mutated();
   }
+  void DefTable::mark_local_defn_captured(LDefID def_id) {
+    m_locals_vec[def_id].mark_as_captured();
+  }
+  void DefTable::mark_local_defn_frame_capturable(LDefID def_id) {
+    m_locals_vec[def_id].mark_as_frame_capturable();
+  }
 
   GDefID DefTable::define_global(
     FLoc loc, IntStr name, 
@@ -43,6 +57,17 @@ namespace ss {
     return new_ldef_id;
   }
 
+  void DefTable::mark(GcMarker& marker) const {
+    for (Definition const& def: m_globals_vec) {
+      marker.mark(def.code());
+      marker.mark(def.init());
+    }
+    for (Definition const& def: m_locals_vec) {
+      marker.mark(def.code());
+      marker.mark(def.init());
+    }
+  }
+
   std::optional<GDefID> DefTable::lookup_global_id(IntStr name) const { 
     auto found_it = m_globals_id_symtab.find(name);
     if (found_it != m_globals_id_symtab.end()) {
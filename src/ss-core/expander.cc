@@ -39,6 +39,7 @@
 #include "ss-core/pinvoke.hh"
 #include "ss-core/gc.hh"
 #include "ss-core/feedback.hh"
+#include "ss-core/trace.hh"
 
 //
 // Impl: common utility
@@ -63,13 +64,17 @@ namespace ss {
 }
 
 // OrderedSymbolSet: flat vector-based ordered sets
+// - past INDEX_MIN_SIZE elements, each element's index is also kept in a hash-map, so that lookups in
+//   scopes with hundreds of locals or free variables take constant time rather than a scan.
 namespace ss {
 
   class OrderedSymbolSet {
   private:
     using Container = std::vector<IntStr>;
+    static constexpr size_t INDEX_MIN_SIZE = 16;
   private:
     Container m_elements;
+    UnstableHashMap<IntStr, size_t> m_index;    // empty until there are more than INDEX_MIN_SIZE elements
   public:
     OrderedSymbolSet() = default;
     OrderedSymbolSet(OrderedSymbolSet const& other) = default;
@@ -86,7 +91,7 @@ namespace ss {
     Container::const_iterator begin() const { return m_elements.begin(); }
     Container::const_iterator end() const { return m_elements.end(); }
     size_t size() const { return m_elements.size(); }
-    void swap(OrderedSymbolSet other) { m_elements.swap(other.m_elements); }
+    void swap(OrderedSymbolSet other) { m_elements.swap(other.m_elements); m_index.swap(other.m_index); }
   public:
     IntStr operator[](size_t idx) const { return m_elements[idx]; }
   public:
@@ -101,11 +106,26 @@ namespace ss {
   }
 
   void OrderedSymbolSet::add(IntStr element) {
-    if (!contains(element)) {
-      m_elements.push_back(element);
+    if (contains(element)) {
+      return;
+    }
+    m_elements.push_back(element);
+    if (!m_index.empty()) {
+      m_index.emplace(element, m_elements.size() - 1);
+    } else if (m_elements.size() > INDEX_MIN_SIZE) {
+      for (size_t i = 0; i < m_elements.size(); i++) {
+        m_index.emplace(m_elements[i], i);
+      }
     }
   }
   std::optional<size_t> OrderedSymbolSet::idx(IntStr element) const {
+    if (!m_index.empty()) {
+      auto it = m_index.find(element);
+      if (it == m_index.end()) {
+        return {};
+      }
+      return {it->second};
+    }
     for (size_t i = 0; i < m_elements.size(); i++) {
       if (m_elements[i] == element) {
         return {i};
@@ -164,12 +184,15 @@ namespace ss {
     std::vector<LDefID> local_defs;
     OrderedSymbolSet inuse_nonlocal_ordered_set;
     std::vector<Nonlocal> inuse_nonlocal_defs;
+    // whether a continuation may be captured while this scope's frame is on the stack, cf `Definition::is_boxed`
+    bool frame_is_capturable;
   public:
     Scope()
     : locals_ordered_set(),
       local_defs(),
       inuse_nonlocal_ordered_set(),
-      inuse_nonlocal_defs()
+      inuse_nonlocal_defs(),
+      frame_is_capturable(false)
     {
       assert(locals_ordered_set.size() == local_defs.size());
     }
@@ -190,6 +213,13 @@ namespace ss {
     PlatformProcTable& m_pproc_tab;
     std::vector<Scope> m_closure_scope_stack;
 
+    // the scopes defining each local name, innermost last: a name's defining scope is found without searching
+    // the scopes around a reference, and a name no scope defines is known to be global.
+    UnstableHashMap<IntStr, std::vector<size_t>> m_local_binding_scopes;
+
+    // whether the expression being rewritten is in tail position in the innermost lambda's body
+    bool m_is_tail;
+
   public:
     inline Scoper(GCTFE& gc_tfe, DefTable& gdef_tab, PlatformProcTable& pproc_tab);
   
@@ -198,7 +228,14 @@ namespace ss {
 
   private:
     // rewrites a syntax object's data, returning new data
-    OBJECT rw_expr_stx_data(FLoc loc, OBJECT expr_stx);
+    OBJECT rw_expr_stx_data(FLocID loc, OBJECT expr_stx);
+
+    // rewrites a subexpression, in tail position iff `is_tail`
+    OBJECT rw_subexpr_stx(OBJECT expr_stx, bool is_tail);
+
+    // notes that a continuation may be captured while the innermost lambda's frame is on the stack: e.g. by a 
+    // non-tail call, whose callee may call call/cc.
+    void note_frame_is_capturable();
     
     // pushes a fresh scope containing the given symbols
     void push_scope();
@@ -207,33 +244,37 @@ namespace ss {
     std::vector<Nonlocal> pop_scope();
     
     // defines a local variable in the current scope
-    LDefID define_local(FLoc loc, IntStr name);
+    LDefID define_local(FLocID loc, IntStr name);
 
     // defines a global variable
-    GDefID define_global(FLoc loc, IntStr name);
+    GDefID define_global(FLocID loc, IntStr name);
     
     // defines a local or global variable depending on the current scope stack.
     // RelVarScope is either Local or Global, indicating where the symbol was defined.
-    std::pair<RelVarScope, size_t> define(FLoc loc, IntStr name); 
+    std::pair<RelVarScope, size_t> define(FLocID loc, IntStr name); 
 
     // looks up a variable, returning the scope it was found in and an ID
     // - if local, then (RelVarScope::Local, LDefID)
     // - if nonlocal, then (RelVarScope::Free, LDefID) 
     // - if global, then (RelVarScope::Global, GDefID)
-    std::pair<RelVarScope, size_t> lookup_defn(FLoc loc, IntStr symbol, bool is_mut, size_t offset = 0);
+    // - unless global, writes the variable's LDefID to `out_ldef_id`, and marks it captured if found free.
+    std::pair<RelVarScope, size_t> lookup_defn(
+      FLocID loc, IntStr symbol, bool is_mut, LDefID* out_ldef_id = nullptr, size_t offset = 0
+    );
+    std::pair<RelVarScope, size_t> lookup_global_defn(FLocID loc, IntStr symbol);
 
   private:
-    OBJECT rw_id_expr_stx_data(FLoc loc, OBJECT expr_stx_data);
+    OBJECT rw_id_expr_stx_data(FLocID loc, OBJECT expr_stx_data);
     OBJECT rw_pair_expr_stx(OBJECT expr_stx);
-    OBJECT rw_pair_stx_data(FLoc loc, OBJECT expr_stx_data);
-    OBJECT rw_list_stx_data__lambda(FLoc loc, OBJECT expr_stx_data);
+    OBJECT rw_pair_stx_data(FLocID loc, OBJECT expr_stx_data);
+    OBJECT rw_list_stx_data__lambda(FLocID loc, OBJECT expr_stx_data);
     OBJECT rw_list_stx_data__if(OBJECT expr_stx_data);
-    OBJECT rw_list_stx_data__set(FLoc loc, OBJECT expr_stx_data);
+    OBJECT rw_list_stx_data__set(FLocID loc, OBJECT expr_stx_data);
     OBJECT rw_list_stx_data__call_cc(OBJECT expr_stx_data);
-    OBJECT rw_list_stx_data__define(FLoc loc, OBJECT expr_stx_data);
-    OBJECT rw_list_stx_data__p_invoke(FLoc loc, OBJECT expr_stx_data);
-    OBJECT rw_list_stx_data__begin(FLoc loc, OBJECT expr_stx_data);
-    OBJECT rw_list_stx_data__apply(FLoc loc, OBJECT expr_stx_data);
+    OBJECT rw_list_stx_data__define(FLocID loc, OBJECT expr_stx_data);
+    OBJECT rw_list_stx_data__p_invoke(FLocID loc, OBJECT expr_stx_data);
+    OBJECT rw_list_stx_data__begin(FLocID loc, OBJECT expr_stx_data);
+    OBJECT rw_list_stx_data__apply(FLocID loc, OBJECT expr_stx_data);
   
   private:
     bool in_global_scope() const { return m_closure_scope_stack.empty(); }
@@ -243,7 +284,9 @@ namespace ss {
   : m_gc_tfe(gc_tfe),
     m_def_tab(def_tab),
     m_pproc_tab(pproc_tab),
-    m_closure_scope_stack()
+    m_closure_scope_stack(),
+    m_local_binding_scopes(),
+    m_is_tail(false)
   {
     m_closure_scope_stack.reserve(256);
   }
@@ -253,46 +296,60 @@ namespace ss {
   }
 
   std::vector<Nonlocal> Scoper::pop_scope() {
+    for (IntStr name: m_closure_scope_stack.back().locals_ordered_set) {
+      auto it = m_local_binding_scopes.find(name);
+      assert(it != m_local_binding_scopes.end() && it->second.back() == m_closure_scope_stack.size()-1);
+      it->second.pop_back();
+      if (it->second.empty()) {
+        m_local_binding_scopes.erase(it);
+      }
+    }
+    if (m_closure_scope_stack.back().frame_is_capturable) {
+      for (LDefID ldef_id: m_closure_scope_stack.back().local_defs) {
+        m_def_tab.mark_local_defn_frame_capturable(ldef_id);
+      }
+    }
     auto res = std::move(m_closure_scope_stack.back().inuse_nonlocal_defs);
     m_closure_scope_stack.pop_back();
     return res;
   }
 
-  LDefID Scoper::define_local(FLoc loc, IntStr name) {
+  LDefID Scoper::define_local(FLocID loc, IntStr name) {
     assert(!m_closure_scope_stack.empty());
     auto old_def = m_closure_scope_stack.back().locals_ordered_set.idx(name);
     if (old_def.has_value()) {
       std::stringstream s;
       s << "Local variable re-defined in scope: " << interned_string(name) << std::endl
-        << "new: " << loc.as_text() << std::endl
+        << "new: " << FLocTable::loc(loc).as_text() << std::endl
         << "old: " << m_def_tab.local(old_def.value()).loc().as_text();
       error(s.str());
       throw SsiError();
     } else {
-      LDefID ldef_id = m_def_tab.define_local(loc, name);
+      LDefID ldef_id = m_def_tab.define_local(FLocTable::loc(loc), name);
       m_closure_scope_stack.back().locals_ordered_set.add(name);
       m_closure_scope_stack.back().local_defs.push_back(ldef_id);
+      m_local_binding_scopes[name].push_back(m_closure_scope_stack.size()-1);
       return ldef_id;
     }
   }
 
-  GDefID Scoper::define_global(FLoc loc, IntStr name) {
+  GDefID Scoper::define_global(FLocID loc, IntStr name) {
     assert(m_closure_scope_stack.empty());
     auto old_def = m_def_tab.lookup_global_id(name);
     if (old_def.has_value()) {
       std::stringstream s;
       s << "Global variable re-defined: " << interned_string(name) << std::endl
-        << "new: " << loc.as_text() << std::endl
+        << "new: " << FLocTable::loc(loc).as_text() << std::endl
         << "old: " << m_def_tab.global(old_def.value()).loc().as_text() << std::endl
         << "HINT: to update an existing value, use 'set!' instead.";
       error(s.str());
       throw SsiError();
     } else {
-      return m_def_tab.define_global(loc, name);
+      return m_def_tab.define_global(FLocTable::loc(loc), name);
     }
   }
 
-  std::pair<RelVarScope, size_t> Scoper::define(FLoc loc, IntStr name) {
+  std::pair<RelVarScope, size_t> Scoper::define(FLocID loc, IntStr name) {
     if (in_global_scope()) {
       return {RelVarScope::Global, define_global(loc, name)};
     } else {
@@ -301,56 +358,70 @@ namespace ss {
   }
   
   inline std::pair<RelVarScope, size_t> Scoper::lookup_defn(
-    FLoc loc, 
+    FLocID loc, 
     IntStr sym, 
     bool is_mut, 
+    LDefID* out_ldef_id,
     size_t offset
   ) {
-    // checking 'locals' unless in global scope already:
-    if (m_closure_scope_stack.size() > offset) {
-      Scope& top = m_closure_scope_stack[m_closure_scope_stack.size()-1 - offset];
-      auto opt_idx = top.locals_ordered_set.idx(sym);
-      if (opt_idx.has_value()) {
-        return {RelVarScope::Local, opt_idx.value()};
+    // finding the innermost scope defining this name, if any:
+    // - scopes inside `offset` were already checked, so cannot define it.
+    auto binding_it = m_local_binding_scopes.find(sym);
+    if (binding_it == m_local_binding_scopes.end()) {
+      return lookup_global_defn(loc, sym);
+    }
+    size_t binding_scope_idx = binding_it->second.back();
+    size_t top_scope_idx = m_closure_scope_stack.size()-1 - offset;
+    assert(binding_scope_idx <= top_scope_idx);
+    Scope& top_scope = m_closure_scope_stack[top_scope_idx];
+
+    // checking 'locals':
+    if (binding_scope_idx == top_scope_idx) {
+      auto opt_idx = top_scope.locals_ordered_set.idx(sym);
+      assert(opt_idx.has_value());
+      if (out_ldef_id) {
+        *out_ldef_id = top_scope.local_defs[opt_idx.value()];
       }
+      return {RelVarScope::Local, opt_idx.value()};
     }
     
-    // checking 'free' unless in top-most function already:
+    // checking 'free': defined by an enclosing scope
     // NOTE: what about 'begin'? It never pushes a new scope. This means that
     // nested begins' definitions _will_ conflict.
-    if (m_closure_scope_stack.size() > 1+offset) {
-      // seeing if this is a free variable that has been referred in this closure
-      // already:
-      Scope& top_scope = m_closure_scope_stack[m_closure_scope_stack.size()-1 - offset];
-      auto opt_cached_idx = top_scope.inuse_nonlocal_ordered_set.idx(sym);
-      if (opt_cached_idx.has_value()) {
-        auto cached_idx = opt_cached_idx.value();
-        auto& nonlocal = top_scope.inuse_nonlocal_defs[cached_idx];
-        if (is_mut) {
-          nonlocal.use_is_mut |= true;
-        }
-        return {RelVarScope::Free, cached_idx};
-      } else {
-        // must check whole scope stack, and if found, must insert into 'inuse' table
-        LDefID found_ldef_id = static_cast<LDefID>(-1);
-        auto [parent_rel_var_scope, found_idx] = lookup_defn(loc, sym, is_mut, 1+offset);
-        if (parent_rel_var_scope == RelVarScope::Global) {
-          return {RelVarScope::Global, found_idx};
-        }
-
-        // insert fresh into top 'inuse_nonlocals' table, then return
-        ssize_t nonlocal_idx = static_cast<ssize_t>(top_scope.inuse_nonlocal_defs.size());
-        top_scope.inuse_nonlocal_ordered_set.add(sym);
-        top_scope.inuse_nonlocal_defs.emplace_back(
-          parent_rel_var_scope,
-          found_idx,
-          found_ldef_id, 
-          is_mut
-        );
-        return {RelVarScope::Free, nonlocal_idx};
+    // seeing if this is a free variable that has been referred in this closure
+    // already:
+    auto opt_cached_idx = top_scope.inuse_nonlocal_ordered_set.idx(sym);
+    if (opt_cached_idx.has_value()) {
+      auto cached_idx = opt_cached_idx.value();
+      auto& nonlocal = top_scope.inuse_nonlocal_defs[cached_idx];
+      if (is_mut) {
+        nonlocal.use_is_mut |= true;
       }
-    }
-
+      if (out_ldef_id) {
+        *out_ldef_id = nonlocal.ldef_id;
+      }
+      return {RelVarScope::Free, cached_idx};
+    }
+
+    // else, must resolve it in the parent scope, and insert it into the 'inuse' table:
+    LDefID found_ldef_id = static_cast<LDefID>(-1);
+    auto [parent_rel_var_scope, found_idx] = lookup_defn(loc, sym, is_mut, &found_ldef_id, 1+offset);
+    assert(parent_rel_var_scope != RelVarScope::Global);
+    m_def_tab.mark_local_defn_captured(found_ldef_id);
+    if (out_ldef_id) {
+      *out_ldef_id = found_ldef_id;
+    }
+    ssize_t nonlocal_idx = static_cast<ssize_t>(top_scope.inuse_nonlocal_defs.size());
+    top_scope.inuse_nonlocal_ordered_set.add(sym);
+    top_scope.inuse_nonlocal_defs.emplace_back(
+      parent_rel_var_scope,
+      found_idx,
+      found_ldef_id, 
+      is_mut
+    );
+    return {RelVarScope::Free, nonlocal_idx};
+  }
+  inline std::pair<RelVarScope, size_t> Scoper::lookup_global_defn(FLocID loc, IntStr sym) {
     // checking globals
     {
       auto opt_gdef_id = m_def_tab.lookup_global_id(sym);
@@ -363,7 +434,7 @@ namespace ss {
     {
       std::stringstream ss;
       ss << "Lookup failed: symbol used but not defined: '" << interned_string(sym) << std::endl;
-      ss << "see: " << loc.as_text();
+      ss << "see: " << FLocTable::loc(loc).as_text();
       error(ss.str());
       throw SsiError();
     }
@@ -372,12 +443,26 @@ namespace ss {
   OBJECT Scoper::rw_expr_stx(OBJECT expr_stx) {
     assert(expr_stx.is_syntax());
     auto expr_stx_p = expr_stx.as_syntax_p();
-    return OBJECT::make_syntax(&m_gc_tfe,
-      rw_expr_stx_data(expr_stx_p->loc(), expr_stx_p->data()),
-      expr_stx_p->loc()
-    );
+    OBJECT data = rw_expr_stx_data(expr_stx_p->loc_id(), expr_stx_p->data());
+    if (data.as_raw() == expr_stx_p->data().as_raw()) {
+      // e.g. constants and quotations are kept as is
+      return expr_stx;
+    }
+    return OBJECT::make_syntax(&m_gc_tfe, data, expr_stx_p->loc_id());
   }
-  OBJECT Scoper::rw_expr_stx_data(FLoc loc, OBJECT expr_stx_data) {
+  OBJECT Scoper::rw_subexpr_stx(OBJECT expr_stx, bool is_tail) {
+    bool was_tail = m_is_tail;
+    m_is_tail = is_tail;
+    OBJECT res = rw_expr_stx(expr_stx);
+    m_is_tail = was_tail;
+    return res;
+  }
+  void Scoper::note_frame_is_capturable() {
+    if (!in_global_scope()) {
+      m_closure_scope_stack.back().frame_is_capturable = true;
+    }
+  }
+  OBJECT Scoper::rw_expr_stx_data(FLocID loc, OBJECT expr_stx_data) {
     // std::cerr << "RWs " << expr_stx_data << std::endl;
     if (expr_stx_data.is_symbol()) {
       auto res = rw_id_expr_stx_data(loc, expr_stx_data);      
@@ -397,19 +482,30 @@ namespace ss {
       return expr_stx_data;
     }
   }
-  OBJECT Scoper::rw_id_expr_stx_data(FLoc loc, OBJECT expr_stx_data) {
+  OBJECT Scoper::rw_id_expr_stx_data(FLocID loc, OBJECT expr_stx_data) {
     assert(expr_stx_data.is_symbol());
     auto sym = expr_stx_data.as_symbol();
-    auto [rel_var_scope, def_id] = lookup_defn(loc, sym, false);
+    LDefID ldef_id = static_cast<LDefID>(-1);
+    auto [rel_var_scope, def_id] = lookup_defn(loc, sym, false, &ldef_id);
     IntStr rel_var_scope_sym = rel_var_scope_to_sym(rel_var_scope);
-    auto res = list(&m_gc_tfe, 
-      OBJECT::make_symbol(g_id_cache().reference),
-      OBJECT::make_symbol(rel_var_scope_sym),
-      OBJECT::make_integer(def_id)
-    );
-    return res;
+    if (rel_var_scope == RelVarScope::Global) {
+      // (reference global ,gdef-id)
+      return list(&m_gc_tfe, 
+        OBJECT::make_symbol(g_id_cache().reference),
+        OBJECT::make_symbol(rel_var_scope_sym),
+        OBJECT::make_integer(def_id)
+      );
+    } else {
+      // (reference ,rel-var-scope ,idx ,ldef-id), where the LDefID says whether the variable is boxed
+      return list(&m_gc_tfe, 
+        OBJECT::make_symbol(g_id_cache().reference),
+        OBJECT::make_symbol(rel_var_scope_sym),
+        OBJECT::make_integer(def_id),
+        OBJECT::make_integer(ldef_id)
+      );
+    }
   }
-  OBJECT Scoper::rw_list_stx_data__lambda(FLoc loc, OBJECT expr_stx_data) {
+  OBJECT Scoper::rw_list_stx_data__lambda(FLocID loc, OBJECT expr_stx_data) {
     assert(expr_stx_data.is_pair());
     auto args = extract_args<3>(expr_stx_data);
     // auto lambda_syntax = args[0];
@@ -427,7 +523,7 @@ namespace ss {
     OBJECT vars = vars_syntax_p->to_datum(&m_gc_tfe);
     check_vars_list_else_throw(loc, vars);
 
-    std::vector<std::pair<LDefID, FLoc>> args_vec;
+    std::vector<std::pair<LDefID, FLocID>> args_vec;
     args_vec.reserve(10);
     OBJECT rewritten_body_stx;
     push_scope();
@@ -438,35 +534,37 @@ namespace ss {
         auto arg_p = arg.as_syntax_p();
         OBJECT arg_name = arg_p->data();
         assert(arg_name.is_symbol());
-        LDefID ldef_id = define_local(arg_p->loc(), arg_name.as_symbol());
-        args_vec.push_back({ldef_id, arg_p->loc()});
+        LDefID ldef_id = define_local(arg_p->loc_id(), arg_name.as_symbol());
+        args_vec.push_back({ldef_id, arg_p->loc_id()});
       }
 
       // ensuring we scope the body while the formal argument scope is pushed
       // - any 'define' gets added to this scope
       // - any lookup + opt mutation gets registered in this scope as free var
-      rewritten_body_stx = rw_expr_stx(body_syntax);
+      rewritten_body_stx = rw_subexpr_stx(body_syntax, true);
     }
     auto nonlocals_vec = pop_scope();
 
     // assembling 'nonlocals' list:
-    // TODO: confirm if reverse-order here is expected.
+    // - in index order: the i-th element is free variable 'i' of the closure, cf `Compiler::collect_free`.
     OBJECT nonlocals = OBJECT::null;
-    for (Nonlocal const& nonlocal: nonlocals_vec) {
-      auto element = list(   // (parent-rel-var-scope parent-idx use-is-mut ldef-id)
+    for (auto it = nonlocals_vec.rbegin(); it != nonlocals_vec.rend(); it++) {
+      Nonlocal const& nonlocal = *it;
+      auto element = list(   // (parent-rel-var-scope parent-idx ldef-id use-is-mut), cf `Compiler::refer_nonlocal`
         &m_gc_tfe,
         OBJECT::make_symbol(rel_var_scope_to_sym(nonlocal.parent_rel_var_scope)),
         OBJECT::make_integer(nonlocal.idx_in_parent_scope),
-        OBJECT::make_boolean(nonlocal.use_is_mut),
-        OBJECT::make_symbol(nonlocal.ldef_id)
+        OBJECT::make_integer(nonlocal.ldef_id),
+        OBJECT::make_boolean(nonlocal.use_is_mut)
       );
       nonlocals = cons(&m_gc_tfe, element, nonlocals);
     }
 
     // assembling 'vars' list (args):
-    // TODO: confirm if reverse-order here is expected.
+    // - in index order: the i-th element is argument 'i', cf `Compiler::make_boxes`.
     OBJECT res_args = OBJECT::null;
-    for (auto [ldef_id, loc]: args_vec) {
+    for (auto it = args_vec.rbegin(); it != args_vec.rend(); it++) {
+      auto [ldef_id, loc] = *it;
       auto element = OBJECT::make_syntax(
         &m_gc_tfe,
         OBJECT::make_integer(ldef_id),
@@ -493,13 +591,13 @@ namespace ss {
     return list(
       &m_gc_tfe,
       if_kw_stx,    // if, but a syntax object
-      rw_expr_stx(cond_stx),
-      rw_expr_stx(then_stx),
-      rw_expr_stx(else_stx)
+      rw_subexpr_stx(cond_stx, false),
+      rw_subexpr_stx(then_stx, m_is_tail),
+      rw_subexpr_stx(else_stx, m_is_tail)
     );
   }
-  OBJECT Scoper::rw_list_stx_data__set(FLoc loc, OBJECT expr_stx_data) {
-    // (mutation ,rel-var-scope ,def-id)
+  OBJECT Scoper::rw_list_stx_data__set(FLocID loc, OBJECT expr_stx_data) {
+    // (mutation ,rel-var-scope ,def-id ,ldef-id ,init)
     auto args = extract_args<3>(expr_stx_data);
     auto name_obj_stx = args[1];
     auto init_obj_stx = args[2];
@@ -512,19 +610,20 @@ namespace ss {
     if (!name_obj.is_symbol()) {
       std::stringstream ss;
       ss << "set!: expected first argument to be a symbol, got: " << name_obj << std::endl;
-      ss << "see: " << loc.as_text();
+      ss << "see: " << FLocTable::loc(loc).as_text();
       error(ss.str());
       throw SsiError();
     }
     IntStr name = name_obj.as_symbol();
-    auto [rel_var_scope, def_id] = lookup_defn(loc, name, true);
+    LDefID ldef_id = static_cast<LDefID>(-1);
+    auto [rel_var_scope, def_id] = lookup_defn(loc, name, true, &ldef_id);
 
     // updating this definition's properties to indicate that it may be mutated 
     // at some point during execution:
     switch (rel_var_scope) {
       case RelVarScope::Local:
       case RelVarScope::Free:
-        m_def_tab.mark_local_defn_mutated(def_id);
+        m_def_tab.mark_local_defn_mutated(ldef_id);
         break;
       case RelVarScope::Global:
         m_def_tab.mark_global_defn_mutated(def_id);
@@ -539,22 +638,27 @@ namespace ss {
     auto rel_var_scope_sym = rel_var_scope_to_sym(rel_var_scope);
     auto rel_var_scope_sym_obj = OBJECT::make_symbol(rel_var_scope_sym);
     auto def_id_obj = OBJECT::make_integer(def_id);
+    auto ldef_id_obj = OBJECT::make_integer(ldef_id);
     return list(
       &m_gc_tfe, 
-      mutation_obj, rel_var_scope_sym_obj, def_id_obj,
-      rw_expr_stx(init_obj_stx)
+      mutation_obj, rel_var_scope_sym_obj, def_id_obj, ldef_id_obj,
+      rw_subexpr_stx(init_obj_stx, false)
     );
   }
   OBJECT Scoper::rw_list_stx_data__call_cc(OBJECT expr_stx_data) {
     auto args = extract_args<2>(expr_stx_data);
     auto kw_call_cc_stx = args[0];
     auto continuation_cb_stx = args[1];
+    // in tail position, call/cc captures the stack below this frame's args, cf `Compiler::compile_list_exp`:
+    if (!m_is_tail) {
+      note_frame_is_capturable();
+    }
     return list(&m_gc_tfe,
       kw_call_cc_stx,
-      rw_expr_stx(continuation_cb_stx)
+      rw_subexpr_stx(continuation_cb_stx, false)
     );
   }
-  OBJECT Scoper::rw_list_stx_data__define(FLoc loc, OBJECT expr_stx_data) {
+  OBJECT Scoper::rw_list_stx_data__define(FLocID loc, OBJECT expr_stx_data) {
     auto args = extract_args<3>(expr_stx_data);
     // auto define_kw_stx = args[0];
     auto name_obj_stx = args[1];
@@ -567,20 +671,25 @@ namespace ss {
       std::stringstream s;
       s << "define: expected first arg to be name symbol, got: " 
         << name_obj_stx_p->to_datum(&m_gc_tfe) << std::endl;
-      s << "see: " << loc.as_text();
+      s << "see: " << FLocTable::loc(loc).as_text();
       error(s.str());
       throw SsiError();
     }
 
     IntStr name = name_obj.as_symbol();
     auto [rel_var_scope, def_id] = define(loc, name);
+    // a local's slot is reserved before the body runs, so its definition assigns it like 'set!': if captured,
+    // it is boxed, so that closures made before it is defined see its value, cf `Compiler::reserve_local_defines`.
+    if (rel_var_scope == RelVarScope::Local) {
+      m_def_tab.mark_local_defn_mutated(def_id);
+    }
     auto def_id_obj = OBJECT::make_integer(def_id);
     auto rel_var_scope_sym = rel_var_scope_to_sym(rel_var_scope);
     auto rel_var_scope_sym_obj = OBJECT::make_symbol(rel_var_scope_sym);
     auto def_id_obj_stx = OBJECT::make_syntax(
       &m_gc_tfe,
       def_id_obj,
-      name_obj_stx_p->loc()
+      name_obj_stx_p->loc_id()
     );
 
     OBJECT expanded_define_kw = OBJECT::make_symbol(g_id_cache().expanded_define);
@@ -588,10 +697,10 @@ namespace ss {
       expanded_define_kw,           // expanded-define
       rel_var_scope_sym_obj,        // rel-var-scope
       def_id_obj_stx,               // stx replacing IntStr name with GDefID
-      rw_expr_stx(init_obj_stx)     // initializer
+      rw_subexpr_stx(init_obj_stx, false)     // initializer
     );
   }
-  OBJECT Scoper::rw_list_stx_data__p_invoke(FLoc loc, OBJECT expr_stx_data) {
+  OBJECT Scoper::rw_list_stx_data__p_invoke(FLocID loc, OBJECT expr_stx_data) {
     auto args = extract_args<2>(expr_stx_data, true);
     auto p_invoke_stx = args[0];
     auto proc_name_obj_stx = args[1];
@@ -603,7 +712,7 @@ namespace ss {
       std::stringstream s;
       s << "p/invoke: expected first arg to be name symbol, got: " 
         << proc_name_obj_stx_p->to_datum(&m_gc_tfe) << std::endl
-        << "see: " << loc.as_text();
+        << "see: " << FLocTable::loc(loc).as_text();
       error(s.str());
       throw SsiError();
     }
@@ -614,7 +723,7 @@ namespace ss {
       std::stringstream s;
       s << "p/invoke: unbound platform procedure referenced: " 
         << proc_name_obj << std::endl
-        << "see: " << loc.as_text();
+        << "see: " << FLocTable::loc(loc).as_text();
       error(s.str());
       throw SsiError();
     }
@@ -625,7 +734,7 @@ namespace ss {
     std::vector<OBJECT> expanded_args;
     expanded_args.reserve(10);
     for (rem = cddr(expr_stx_data); !rem.is_null(); rem = cdr(rem)) {
-      expanded_args.push_back(rw_expr_stx(car(rem)));
+      expanded_args.push_back(rw_subexpr_stx(car(rem), false));
     }
 
     // cons-ing together the list in reverse-order:
@@ -634,7 +743,7 @@ namespace ss {
       res = cons(&m_gc_tfe, *it, res);
     }
     res = cons(&m_gc_tfe,
-      OBJECT::make_syntax(&m_gc_tfe, pproc_id_obj, proc_name_obj_stx_p->loc()),
+      OBJECT::make_syntax(&m_gc_tfe, pproc_id_obj, proc_name_obj_stx_p->loc_id()),
       res
     );
 
@@ -644,18 +753,18 @@ namespace ss {
       OBJECT::make_syntax(
         &m_gc_tfe, 
         OBJECT::make_symbol(g_id_cache().expanded_p_invoke),
-        p_invoke_stx.as_syntax_p()->loc()
+        p_invoke_stx.as_syntax_p()->loc_id()
       ), 
       res
     );
 
     return res;
   }
-  OBJECT Scoper::rw_list_stx_data__begin(FLoc loc, OBJECT expr_stx_data) {
+  OBJECT Scoper::rw_list_stx_data__begin(FLocID loc, OBJECT expr_stx_data) {
     if (!expr_stx_data.is_pair()) {
       std::stringstream s;
       s << "begin: expected at least 1 expression to evaluate, got 0 OR improper list" << std::endl
-        << "see: " << loc.as_text();
+        << "see: " << FLocTable::loc(loc).as_text();
       throw SsiError();
     }
 
@@ -674,13 +783,13 @@ namespace ss {
           std::stringstream ss;
           ss << "begin: expected a pair-list, got improper pair-list" << std::endl;
           ss << "item: " << rem << std::endl;
-          ss << "see:  " << loc.as_text() << std::endl;
+          ss << "see:  " << FLocTable::loc(loc).as_text() << std::endl;
           error(ss.str());
           throw SsiError();
         }
 
         OBJECT old_stx_obj = car(rem);
-        OBJECT new_stx_obj = rw_expr_stx(old_stx_obj);
+        OBJECT new_stx_obj = rw_subexpr_stx(old_stx_obj, m_is_tail && cdr(rem).is_null());
         items.push_back(new_stx_obj);
       }
 
@@ -692,17 +801,21 @@ namespace ss {
     
     return cons(&m_gc_tfe, car(expr_stx_data), rewritten_elements);
   }
-  OBJECT Scoper::rw_list_stx_data__apply(FLoc loc, OBJECT expr_stx_data) {
+  OBJECT Scoper::rw_list_stx_data__apply(FLocID loc, OBJECT expr_stx_data) {
     SUPPRESS_UNUSED_VARIABLE_WARNING(loc);
     auto expr_items = list_to_cpp_vector(expr_stx_data);
     std::vector<OBJECT> rw_items;
     rw_items.reserve(expr_items.size());
+    if (!m_is_tail) {
+      // the callee returns to this frame, so any continuation it captures holds this frame:
+      note_frame_is_capturable();
+    }
     for (OBJECT arg: expr_items) {
-      rw_items.push_back(rw_expr_stx(arg));
+      rw_items.push_back(rw_subexpr_stx(arg, false));
     }
     return cpp_vector_to_list(&m_gc_tfe, rw_items);
   }
-  OBJECT Scoper::rw_pair_stx_data(FLoc loc, OBJECT expr_stx_data) {
+  OBJECT Scoper::rw_pair_stx_data(FLocID loc, OBJECT expr_stx_data) {
     auto expr_stx_data_p = expr_stx_data.as_pair_p();
 
     if (!expr_stx_data_p->car().is_syntax()) {
@@ -803,6 +916,7 @@ namespace ss {
     PlatformProcTable& pproc_tab,
     std::vector<OBJECT> expr_stx_vec
   ) {
+    TraceSpan span{"macroexpand"};
     return macroexpand_syntax_impl(
       gc_tfe, def_tab, pproc_tab,
       std::move(expr_stx_vec)
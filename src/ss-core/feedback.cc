@@ -1,16 +1,25 @@
 #include "ss-core/feedback.hh"
 
+#include <mutex>
+
+#include "ss-core/port.hh"
+
 namespace ss {
 
+    // messages may be reported by several threads at once, e.g. by the front-end's parser threads: they are
+    // written to the standard output port, so that they stay in order with what the program displayed.
     void help_fb_print(char const* prefix, std::string msg) {
-        std::cout << prefix;
+        OutputPort& port = standard_output_port();
+        std::lock_guard lg{port.mutex()};
+        port.write(prefix);
         for (char const c: msg) {
-            std::cout << c;
+            port.put(c);
             if (c == '\n') {
-                std::cout << "       ";
+                port.write("       ");
             }
         }
-        std::cout << std::endl;
+        port.put('\n');
+        port.flush();
     }
     void error(std::string msg)     { help_fb_print("ERROR: ", std::move(msg)); }
     void warning(std::string msg)   { help_fb_print("WARN:  ", std::move(msg)); }
@@ -1,6 +1,12 @@
 #include "ss-core/file-loc.hh"
 
 #include <sstream>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <cassert>
+
+#include "ss-core/feedback.hh"
 
 namespace ss {
   std::string FLocSpan::as_text(bool include_guard_brackets) {
@@ -30,6 +36,175 @@ namespace ss {
       return ss.str();   
   }
   std::string FLoc::as_text() {
-    return interned_string(source) + ":" + span.as_text(false);
+    return std::string{interned_string(source)} + ":" + span.as_text(false);
+  }
+}
+
+//
+// FLocTable:
+//
+
+namespace ss {
+  // an ID is laid out as [ 0 | generation: 7 | slot+1: 24 | index: 32 ]: the top bit is left to `SyntaxObject`.
+  // - a slot is reused once its table is dropped, with the next generation, so that stale IDs are not decoded.
+  // - tables are looked up without a lock, like interned strings: cf 'intern.cc'.
+  static constexpr size_t FLOC_INDEX_BITS = 32;
+  static constexpr size_t FLOC_SLOT_BITS = 24;
+  static constexpr size_t FLOC_GENERATION_BITS = 7;
+  static constexpr size_t FLOC_SEGMENT_SIZE_LOG2 = 12;
+  static constexpr size_t FLOC_SEGMENT_SIZE = 1 << FLOC_SEGMENT_SIZE_LOG2;
+  static constexpr size_t FLOC_SEGMENT_COUNT = (1 << FLOC_SLOT_BITS) / FLOC_SEGMENT_SIZE;
+
+  // the segments, slot count, and free slots are only written while `s_floc_tables_mutex` is held:
+  static std::mutex                                                         s_floc_tables_mutex;
+  static std::array<std::atomic<std::atomic<FLocTable*>*>, FLOC_SEGMENT_COUNT> s_floc_table_segments;
+  static std::vector<uint8_t>                                               s_floc_slot_generations;
+  static std::vector<uint32_t>                                              s_free_floc_slots;
+  static size_t                                                             s_live_floc_table_count = 0;
+
+  static uint32_t floc_id_index(FLocID id) {
+    return static_cast<uint32_t>(id);
+  }
+  static size_t floc_id_slot(FLocID id) {
+    return static_cast<size_t>((id >> FLOC_INDEX_BITS) & ((uint64_t{1} << FLOC_SLOT_BITS) - 1)) - 1;
+  }
+  static FLocID floc_id_base(size_t slot, uint8_t generation) {
+    return (
+      (static_cast<uint64_t>(generation) << (FLOC_INDEX_BITS + FLOC_SLOT_BITS)) |
+      (static_cast<uint64_t>(slot + 1) << FLOC_INDEX_BITS)
+    );
+  }
+  static std::atomic<FLocTable*>* floc_table_slot(size_t slot) {
+    std::atomic<FLocTable*>* segment = s_floc_table_segments[slot >> FLOC_SEGMENT_SIZE_LOG2].load(std::memory_order_acquire);
+    return segment ? &segment[slot & (FLOC_SEGMENT_SIZE - 1)] : nullptr;
+  }
+
+  // spans are written as zigzag varints, so that small deltas of either sign take one byte:
+  static void push_varint(std::vector<uint8_t>& bytes, long v) {
+    uint64_t u = (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    while (u >= 0x80) {
+      bytes.push_back(static_cast<uint8_t>(u | 0x80));
+      u >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(u));
+  }
+  static long read_varint(uint8_t const*& cursor) {
+    uint64_t u = 0;
+    for (size_t shift = 0; ; shift += 7) {
+      uint8_t byte = *cursor++;
+      u |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        break;
+      }
+    }
+    return static_cast<long>((u >> 1) ^ (~(u & 1) + 1));
+  }
+
+  FLocTable::FLocTable(IntStr source, FLocID id_base)
+  : m_source(source),
+    m_id_base(id_base),
+    m_bytes(),
+    m_checkpoints(),
+    m_last_span({0, 0}, {0, 0}),
+    m_count(0)
+  {}
+
+  FLocTable* FLocTable::create(IntStr source) {
+    std::lock_guard lock{s_floc_tables_mutex};
+    size_t slot;
+    if (!s_free_floc_slots.empty()) {
+      slot = s_free_floc_slots.back();
+      s_free_floc_slots.pop_back();
+    } else {
+      slot = s_floc_slot_generations.size();
+      if (slot >> FLOC_SEGMENT_SIZE_LOG2 >= FLOC_SEGMENT_COUNT) {
+        std::stringstream ss;
+        ss << "Too many source location tables: at most " << FLOC_SEGMENT_COUNT * FLOC_SEGMENT_SIZE << " may be kept at once";
+        error(ss.str());
+        throw SsiError();
+      }
+      s_floc_slot_generations.push_back(0);
+      if (!floc_table_slot(slot)) {
+        auto segment = new std::atomic<FLocTable*>[FLOC_SEGMENT_SIZE];
+        for (size_t i = 0; i < FLOC_SEGMENT_SIZE; i++) {
+          segment[i].store(nullptr, std::memory_order_relaxed);
+        }
+        s_floc_table_segments[slot >> FLOC_SEGMENT_SIZE_LOG2].store(segment, std::memory_order_release);
+      }
+    }
+    auto table = new FLocTable(source, floc_id_base(slot, s_floc_slot_generations[slot]));
+    floc_table_slot(slot)->store(table, std::memory_order_release);
+    s_live_floc_table_count++;
+    return table;
+  }
+  void FLocTable::drop(FLocID id) {
+    if (id == NO_FLOC) {
+      return;
+    }
+    std::lock_guard lock{s_floc_tables_mutex};
+    size_t slot = floc_id_slot(id);
+    FLocTable* table = floc_table_slot(slot)->load(std::memory_order_relaxed);
+    if (table == nullptr || table->m_id_base != (id & ~((uint64_t{1} << FLOC_INDEX_BITS) - 1))) {
+      return;
+    }
+    floc_table_slot(slot)->store(nullptr, std::memory_order_release);
+    delete table;
+    s_floc_slot_generations[slot] = (s_floc_slot_generations[slot] + 1) & ((1 << FLOC_GENERATION_BITS) - 1);
+    s_free_floc_slots.push_back(static_cast<uint32_t>(slot));
+    s_live_floc_table_count--;
+  }
+  FLoc FLocTable::loc(FLocID id) {
+    static IntStr const s_unknown_source = intern("<unknown>");
+    if (id != NO_FLOC) {
+      std::atomic<FLocTable*>* slot = floc_table_slot(floc_id_slot(id));
+      FLocTable const* table = slot ? slot->load(std::memory_order_acquire) : nullptr;
+      if (table && table->m_id_base == (id & ~((uint64_t{1} << FLOC_INDEX_BITS) - 1))) {
+        return FLoc{table->m_source, table->span(floc_id_index(id))};
+      }
+    }
+    return FLoc{s_unknown_source, FLocSpan{{0, 0}, {0, 0}}};
+  }
+  size_t FLocTable::count_live_tables() {
+    std::lock_guard lock{s_floc_tables_mutex};
+    return s_live_floc_table_count;
+  }
+
+  FLocID FLocTable::add(FLocSpan span) {
+    // each span is written as the delta of its first position from that of the span before, then its last 
+    // position relative to its first: a column is only a delta on the same line.
+    FLocSpan base = m_last_span;
+    if (m_count % FLOC_CHECKPOINT_INTERVAL == 0) {
+      m_checkpoints.push_back(static_cast<uint32_t>(m_bytes.size()));
+      base = FLocSpan{{0, 0}, {0, 0}};
+    }
+    long line_delta = span.first_pos.line_index - base.first_pos.line_index;
+    long last_line_delta = span.last_pos.line_index - span.first_pos.line_index;
+    push_varint(m_bytes, line_delta);
+    push_varint(m_bytes, span.first_pos.column_index - (line_delta == 0 ? base.first_pos.column_index : 0));
+    push_varint(m_bytes, last_line_delta);
+    push_varint(m_bytes, span.last_pos.column_index - (last_line_delta == 0 ? span.first_pos.column_index : 0));
+    m_last_span = span;
+    return m_id_base | m_count++;
+  }
+  FLocSpan FLocTable::span(uint32_t index) const {
+    assert(index < m_count);
+    uint8_t const* cursor = m_bytes.data() + m_checkpoints[index / FLOC_CHECKPOINT_INTERVAL];
+    FLocSpan span{{0, 0}, {0, 0}};
+    for (size_t i = 0; i <= index % FLOC_CHECKPOINT_INTERVAL; i++) {
+      long line_delta = read_varint(cursor);
+      long column = read_varint(cursor);
+      long last_line_delta = read_varint(cursor);
+      long last_column = read_varint(cursor);
+      FLocPos first_pos{
+        span.first_pos.line_index + line_delta,
+        column + (line_delta == 0 ? span.first_pos.column_index : 0)
+      };
+      FLocPos last_pos{
+        first_pos.line_index + last_line_delta,
+        last_column + (last_line_delta == 0 ? first_pos.column_index : 0)
+      };
+      span = FLocSpan{first_pos, last_pos};
+    }
+    return span;
   }
 }
@@ -1,11 +1,17 @@
 #include "ss-core/gc.hh"
 
 #include <iostream>
+#include <iomanip>
 #include <sstream>
+#include <bit>
+#include <cmath>
+#include <limits>
 #include <cassert>
+#include <mutex>
 #include "ss-core/config.hh"
 #include "ss-core/allocator.hh"
 #include "ss-core/feedback.hh"
+#include "ss-core/trace.hh"
 
 ///
 // Interface:
@@ -15,7 +21,23 @@ namespace ss {
 
     Gc::Gc(APtr single_contiguous_region, size_t single_contiguous_region_size)
     :   m_gc_back_end(),
-        m_gc_middle_end()
+        m_gc_middle_end(),
+        m_minor_collect_requested(false),
+        m_nurseries_mutex(),
+        m_free_nurseries(),
+        m_retired_nurseries(),
+        m_retired_counters(),
+        m_retired_young_allocated_count(0),
+        m_pauses_mutex(),
+        m_minor_pauses(),
+        m_full_pauses(),
+        m_promoted_count(0),
+        m_promoted_list_link_count(0),
+        m_adjacent_list_link_count(0),
+        m_linearizes_lists(!CONFIG_DISABLE_GC_LIST_LINEARIZATION),
+        m_heap_sample_period(0),
+        m_heap_sample_hook(nullptr),
+        m_heap_sample_ctx(nullptr)
     {
         if (single_contiguous_region == nullptr) {
             std::stringstream ss;
@@ -41,19 +63,386 @@ namespace ss {
         );
         m_gc_middle_end.init(&m_gc_back_end);
     }
+    Gc::Gc(size_t initial_size_in_bytes, size_t max_size_in_bytes)
+    :   m_gc_back_end(),
+        m_gc_middle_end(),
+        m_minor_collect_requested(false),
+        m_nurseries_mutex(),
+        m_free_nurseries(),
+        m_retired_nurseries(),
+        m_retired_counters(),
+        m_retired_young_allocated_count(0),
+        m_pauses_mutex(),
+        m_minor_pauses(),
+        m_full_pauses(),
+        m_promoted_count(0),
+        m_promoted_list_link_count(0),
+        m_adjacent_list_link_count(0),
+        m_linearizes_lists(!CONFIG_DISABLE_GC_LIST_LINEARIZATION),
+        m_heap_sample_period(0),
+        m_heap_sample_hook(nullptr),
+        m_heap_sample_ctx(nullptr)
+    {
+        if (max_size_in_bytes == 0) {
+            max_size_in_bytes = initial_size_in_bytes * CONFIG_GC_HEAP_RESERVE_FACTOR;
+        }
+        max_size_in_bytes = std::max(max_size_in_bytes, initial_size_in_bytes);
+        m_gc_back_end.init_reserved(
+            initial_size_in_bytes >> CONFIG_TCMALLOC_PAGE_SHIFT,
+            max_size_in_bytes >> CONFIG_TCMALLOC_PAGE_SHIFT
+        );
+        m_gc_middle_end.init(&m_gc_back_end);
+    }
+
+    //
+    // GcThreadFrontEnd registry:
+    // front-ends may be created and destroyed by any thread, so the table of live front-ends is locked.
+    //
+
+    static std::mutex s_tfe_table_mutex;
+    static std::vector<GcThreadFrontEnd*> s_tfe_table;
+    static std::vector<GcThreadFrontEndID> s_free_tfids;
+
+    static GcThreadFrontEndID register_tfe(GcThreadFrontEnd* tfe) {
+        std::lock_guard lg{s_tfe_table_mutex};
+        if (!s_free_tfids.empty()) {
+            GcThreadFrontEndID tfid = s_free_tfids.back();
+            s_free_tfids.pop_back();
+            s_tfe_table[tfid] = tfe;
+            return tfid;
+        }
+        if (s_tfe_table.size() > UINT16_MAX) {
+            error("Too many live GcThreadFrontEnds: maximum 65536 front-ends supported.");
+            throw SsiError();
+        }
+        s_tfe_table.push_back(tfe);
+        return static_cast<GcThreadFrontEndID>(s_tfe_table.size() - 1);
+    }
+    // unregister_tfe expects the caller to hold `s_tfe_table_mutex`.
+    static void unregister_tfe(GcThreadFrontEndID tfid) {
+        s_tfe_table[tfid] = nullptr;
+        s_free_tfids.push_back(tfid);
+    }
 
     GcThreadFrontEnd::GcThreadFrontEnd(Gc* gc)
     :   m_impl(),
-        m_tfid(s_tfid_counter++)
+        m_tfid(register_tfe(this)),
+        m_gc(gc),
+        m_nursery(),
+        m_nursery_open(false),
+        m_young_allocated_count(0),
+        m_bytes_until_sample(0),
+        m_sample_rng_state(0x9e3779b97f4a7c15ull * (m_tfid + 1))
     {
-        assert(s_tfid_counter > m_tfid && "Too many GcThreadFrontEnds spawned: maximum 255 front-ends supported.");
         m_impl.init(&gc->middle_end_impl());
+        reset_sample_countdown();
+    }
+    GcThreadFrontEnd::~GcThreadFrontEnd() {
+        m_impl.return_all_to_middle_end();
+        {
+            // retired at once with unregistering, so that `Gc::stats` counts this front-end exactly once:
+            std::lock_guard lg{s_tfe_table_mutex};
+            m_gc->retire_counters(*this);
+            unregister_tfe(m_tfid);
+        }
+        // once unregistered, `Gc::reset_nurseries` no longer sees this nursery:
+        if (m_nursery) {
+            m_gc->release_nursery(std::move(m_nursery));
+        }
+    }
+    GcThreadFrontEnd* GcThreadFrontEnd::get_by_tfid(GcThreadFrontEndID tfid) {
+        std::lock_guard lg{s_tfe_table_mutex};
+        return s_tfe_table[tfid];
+    }
 
-        s_all_table[m_tfid] = this;
+    //
+    // Heap sampling:
+    //
+
+    void Gc::enable_heap_sampling(size_t period, HeapSampleHook hook, void* ctx) {
+        std::lock_guard lg{s_tfe_table_mutex};
+        m_heap_sample_period = period;
+        m_heap_sample_hook = hook;
+        m_heap_sample_ctx = ctx;
+        for (GcThreadFrontEnd* tfe: s_tfe_table) {
+            if (tfe && tfe->m_gc == this) {
+                tfe->reset_sample_countdown();
+            }
+        }
     }
 
-    void GcThreadFrontEnd::sweep(gc::MarkedSet& marked_set) {
-        m_impl.sweep(marked_set);
+    void GcThreadFrontEnd::take_sample(BaseBoxedObject* obj, size_t byte_count) {
+        reset_sample_countdown();
+        if (m_gc->m_heap_sample_hook) {
+            m_gc->m_heap_sample_hook(m_gc->m_heap_sample_ctx, obj, byte_count);
+        }
+    }
+    // reset_sample_countdown draws the bytes until the next sample from an exponential distribution whose
+    // mean is the period, so that samples are a Poisson process over bytes allocated.
+    void GcThreadFrontEnd::reset_sample_countdown() {
+        size_t period = m_gc->m_heap_sample_period;
+        if (period == 0) {
+            m_bytes_until_sample = std::numeric_limits<ssize_t>::max();
+            return;
+        }
+        // xorshift64*: the top 53 bits are a uniform double in (0, 1].
+        m_sample_rng_state ^= m_sample_rng_state >> 12;
+        m_sample_rng_state ^= m_sample_rng_state << 25;
+        m_sample_rng_state ^= m_sample_rng_state >> 27;
+        uint64_t bits = (m_sample_rng_state * 0x2545f4914f6cdd1dull) >> 11;
+        double u = static_cast<double>(bits + 1) / static_cast<double>(uint64_t{1} << 53);
+        double interval = -std::log(u) * static_cast<double>(period);
+        m_bytes_until_sample = static_cast<ssize_t>(std::min(interval, static_cast<double>(period) * 64.0));
+    }
+
+
+    bool GcThreadFrontEnd::set_nursery_open(bool open) {
+        bool was_open = m_nursery_open;
+        if (CONFIG_DISABLE_GC_NURSERY) {
+            return was_open;
+        }
+        if (open && !m_nursery) {
+            m_nursery = m_gc->acquire_nursery();
+        }
+        m_nursery_open = open;
+        return was_open;
+    }
+
+    //
+    // Nurseries:
+    // a front-end's nursery outlives it until the next minor collection, since young objects left in it 
+    // may still be reachable. Reset nurseries are pooled for the next front-ends.
+    //
+
+    std::unique_ptr<gc::Nursery> Gc::acquire_nursery() {
+        std::lock_guard lg{m_nurseries_mutex};
+        if (!m_free_nurseries.empty()) {
+            std::unique_ptr<gc::Nursery> nursery = std::move(m_free_nurseries.back());
+            m_free_nurseries.pop_back();
+            return nursery;
+        }
+        return std::make_unique<gc::Nursery>();
+    }
+    void Gc::release_nursery(std::unique_ptr<gc::Nursery> nursery) {
+        std::lock_guard lg{m_nurseries_mutex};
+        if (nursery->empty()) {
+            m_free_nurseries.push_back(std::move(nursery));
+        } else {
+            m_retired_nurseries.push_back(std::move(nursery));
+        }
+    }
+    void Gc::reset_nurseries() {
+        {
+            std::lock_guard lg{s_tfe_table_mutex};
+            for (GcThreadFrontEnd* tfe: s_tfe_table) {
+                if (tfe && tfe->m_gc == this && tfe->m_nursery) {
+                    tfe->m_nursery->reset();
+                }
+            }
+        }
+        {
+            std::lock_guard lg{m_nurseries_mutex};
+            for (std::unique_ptr<gc::Nursery>& nursery: m_retired_nurseries) {
+                nursery->reset();
+                m_free_nurseries.push_back(std::move(nursery));
+            }
+            m_retired_nurseries.clear();
+        }
+        m_minor_collect_requested.store(false, std::memory_order_relaxed);
+    }
+
+    //
+    // Remembered set:
+    //
+
+    static std::mutex s_remembered_set_mutex;
+    static std::vector<BaseBoxedObject*> s_remembered_set;
+
+    void Gc::remember(BaseBoxedObject* obj) {
+        std::lock_guard lg{s_remembered_set_mutex};
+        s_remembered_set.push_back(obj);
+    }
+    std::vector<BaseBoxedObject*> Gc::take_remembered_set() {
+        std::lock_guard lg{s_remembered_set_mutex};
+        std::vector<BaseBoxedObject*> taken;
+        auto is_ours = [this] (BaseBoxedObject* obj) { return page_map().contains(reinterpret_cast<APtr>(obj)); };
+        for (BaseBoxedObject* obj: s_remembered_set) {
+            if (is_ours(obj)) {
+                obj->gc_forget();
+                taken.push_back(obj);
+            }
+        }
+        s_remembered_set.erase(std::remove_if(s_remembered_set.begin(), s_remembered_set.end(), is_ours), s_remembered_set.end());
+        return taken;
+    }
+
+    //
+    // Collection:
+    //
+
+    void Gc::sweep() {
+        // every object cached by a front-end of this heap is returned to the middle-end first, so that
+        // each size-class's free-list is complete.
+        {
+            std::lock_guard lg{s_tfe_table_mutex};
+            for (GcThreadFrontEnd* tfe: s_tfe_table) {
+                if (tfe && tfe->m_impl.middle_end() == &m_gc_middle_end) {
+                    tfe->m_impl.return_all_to_middle_end();
+                }
+            }
+        }
+        m_gc_middle_end.sweep();
+        m_gc_back_end.release_idle_pages();
+    }
+
+    //
+    // Telemetry:
+    //
+
+    void GcPauseHistogram::record(std::chrono::nanoseconds pause) {
+        uint64_t us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(pause).count());
+        bucket_counts[std::min<size_t>(std::bit_width(us), BUCKET_COUNT - 1)]++;
+        count++;
+        total += pause;
+        max = std::max(max, pause);
+    }
+    void Gc::record_minor_collection(
+        std::chrono::nanoseconds pause, size_t promoted_count, 
+        size_t list_link_count, size_t adjacent_link_count
+    ) {
+        std::lock_guard lg{m_pauses_mutex};
+        m_minor_pauses.record(pause);
+        m_promoted_count += promoted_count;
+        m_promoted_list_link_count += list_link_count;
+        m_adjacent_list_link_count += adjacent_link_count;
+    }
+    void Gc::record_full_collection(std::chrono::nanoseconds pause) {
+        std::lock_guard lg{m_pauses_mutex};
+        m_full_pauses.record(pause);
+    }
+    void Gc::retire_counters(GcThreadFrontEnd const& tfe) {
+        for (gc::SizeClassIndex sci = 1; sci < gc::kSizeClassesCount; sci++) {
+            gc::FrontEndCounters const& counters = tfe.m_impl.counters(sci);
+            m_retired_counters[sci].allocated_count.fetch_add(counters.allocated_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            m_retired_counters[sci].freed_count.fetch_add(counters.freed_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        m_retired_young_allocated_count.fetch_add(tfe.m_young_allocated_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    GcStats Gc::stats() {
+        GcStats res;
+        res.size_classes.resize(gc::kSizeClassesCount);
+
+        // front-ends, live or destroyed:
+        auto add_front_end_counters = [&res] (gc::SizeClassIndex sci, gc::FrontEndCounters const& counters) {
+            res.size_classes[sci].allocated_count += counters.allocated_count.load(std::memory_order_relaxed);
+            res.size_classes[sci].freed_count += counters.freed_count.load(std::memory_order_relaxed);
+        };
+        {
+            std::lock_guard lg{s_tfe_table_mutex};
+            for (gc::SizeClassIndex sci = 1; sci < gc::kSizeClassesCount; sci++) {
+                add_front_end_counters(sci, m_retired_counters[sci]);
+            }
+            res.young_allocated_count = m_retired_young_allocated_count.load(std::memory_order_relaxed);
+            for (GcThreadFrontEnd* tfe: s_tfe_table) {
+                if (tfe && tfe->m_gc == this) {
+                    for (gc::SizeClassIndex sci = 1; sci < gc::kSizeClassesCount; sci++) {
+                        add_front_end_counters(sci, tfe->m_impl.counters(sci));
+                    }
+                    res.young_allocated_count += tfe->m_young_allocated_count.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // middle-end:
+        for (gc::SizeClassIndex sci = 1; sci < gc::kSizeClassesCount; sci++) {
+            GcStats::SizeClass& it = res.size_classes[sci];
+            gc::MiddleEndCounters const& counters = m_gc_middle_end.counters(sci);
+            it.object_size = gc::kSizeClasses[sci].size;
+            it.refill_count = counters.refill_count.load(std::memory_order_relaxed);
+            it.refill_from_transfer_cache_count = counters.refill_from_transfer_cache_count.load(std::memory_order_relaxed);
+            it.return_count = counters.return_count.load(std::memory_order_relaxed);
+            it.return_to_transfer_cache_count = counters.return_to_transfer_cache_count.load(std::memory_order_relaxed);
+            it.live_bytes = counters.live_bytes.load(std::memory_order_relaxed);
+            it.page_span_count = m_gc_middle_end.central_object_allocator(sci).page_span_count();
+            it.central_free_object_count = m_gc_middle_end.central_object_allocator(sci).free_object_count();
+        }
+        res.large_object_count = m_gc_middle_end.large_object_space().object_count();
+        res.large_object_bytes = m_gc_middle_end.large_object_space().byte_count();
+
+        // back-end:
+        res.reserved_page_count = m_gc_back_end.total_page_count();
+        res.exposed_page_count = m_gc_back_end.exposed_page_count();
+        res.free_page_count = m_gc_back_end.free_page_count();
+        res.committed_page_count = m_gc_back_end.committed_page_count();
+        res.released_page_count = m_gc_back_end.released_page_count();
+
+        // pauses:
+        {
+            std::lock_guard lg{m_pauses_mutex};
+            res.minor_pauses = m_minor_pauses;
+            res.full_pauses = m_full_pauses;
+            res.promoted_count = m_promoted_count;
+            res.promoted_list_link_count = m_promoted_list_link_count;
+            res.adjacent_list_link_count = m_adjacent_list_link_count;
+        }
+        return res;
+    }
+
+    static void print_pauses(std::ostream& out, char const* name, GcPauseHistogram const& pauses) {
+        auto to_ms = [] (std::chrono::nanoseconds d) { return std::chrono::duration<double, std::milli>(d).count(); };
+        out << "  " << name << ": " << pauses.count << " pauses, " 
+            << to_ms(pauses.total) << " ms total, "
+            << (pauses.count ? to_ms(pauses.total) / pauses.count : 0.0) << " ms mean, "
+            << to_ms(pauses.max) << " ms max" << std::endl;
+        for (size_t i = 0; i < GcPauseHistogram::BUCKET_COUNT; i++) {
+            if (pauses.bucket_counts[i] > 0) {
+                out << "    " << ((i+1 == GcPauseHistogram::BUCKET_COUNT) ? ">= " : "< ") 
+                    << std::setw(10) << (uint64_t(1) << (i+1 == GcPauseHistogram::BUCKET_COUNT ? i-1 : i)) << " us"
+                    << std::setw(14) << pauses.bucket_counts[i] << std::endl;
+            }
+        }
+    }
+    void GcStats::print(std::ostream& out) const {
+        out << std::fixed << std::setprecision(3);
+        auto to_mib = [] (size_t page_count) { return static_cast<double>(page_count * gc::PAGE_SIZE_IN_BYTES) / MIBIBYTES(1); };
+
+        // size-classes, only those used:
+        out << "=== GC: size-classes ===" << std::endl;
+        out << "  " << std::setw(8) << "size" 
+            << std::setw(14) << "allocated" << std::setw(14) << "freed"
+            << std::setw(10) << "refills" << std::setw(10) << "(cached)"
+            << std::setw(10) << "returns" << std::setw(10) << "(cached)"
+            << std::setw(14) << "live-bytes" << std::setw(8) << "spans" << std::setw(12) << "central" << std::endl;
+        for (SizeClass const& it: size_classes) {
+            if (it.allocated_count == 0 && it.refill_count == 0 && it.page_span_count == 0) {
+                continue;
+            }
+            out << "  " << std::setw(8) << it.object_size
+                << std::setw(14) << it.allocated_count << std::setw(14) << it.freed_count
+                << std::setw(10) << it.refill_count << std::setw(10) << it.refill_from_transfer_cache_count
+                << std::setw(10) << it.return_count << std::setw(10) << it.return_to_transfer_cache_count
+                << std::setw(14) << it.live_bytes << std::setw(8) << it.page_span_count 
+                << std::setw(12) << it.central_free_object_count << std::endl;
+        }
+
+        // heap:
+        out << "=== GC: heap ===" << std::endl;
+        out << "  young objects allocated: " << young_allocated_count << ", promoted: " << promoted_count << std::endl;
+        out << "  list links promoted: " << promoted_list_link_count << ", adjacent: " << adjacent_list_link_count
+            << " (" << (promoted_list_link_count ? 100.0 * adjacent_list_link_count / promoted_list_link_count : 0.0) 
+            << "%)" << std::endl;
+        out << "  large objects: " << large_object_count << " (" << large_object_bytes << " bytes)" << std::endl;
+        out << "  pages: " 
+            << to_mib(reserved_page_count) << " MiB reserved, "
+            << to_mib(exposed_page_count) << " MiB exposed, " 
+            << to_mib(committed_page_count) << " MiB committed, "
+            << to_mib(free_page_count) << " MiB free in the page-heap, "
+            << to_mib(released_page_count) << " MiB released to the OS in total" << std::endl;
+
+        // pauses:
+        out << "=== GC: pauses ===" << std::endl;
+        print_pauses(out, "minor", minor_pauses);
+        print_pauses(out, "full", full_pauses);
     }
 
 }
@@ -68,34 +457,40 @@ namespace ss::gc {
 // Free-list:
 //
 
-using GflIterator = GenericFreeList::Iterator;
-
-void GenericFreeList::init(size_t item_stride_in_bytes) {
+void GenericFreeList::init(size_t item_stride_in_bytes, PageMap* opt_link_table) {
     static_assert(__STDCPP_DEFAULT_NEW_ALIGNMENT__ == 16);
     static_assert(__STDCPP_DEFAULT_NEW_ALIGNMENT__ == sizeof(ABlk));
+    static_assert(sizeof(FreeSpanLink) <= sizeof(ABlk), "expected each item to be able to hold a link");
+    m_head = nullptr;
     m_item_stride_in_ablks = (item_stride_in_bytes >> 4);
+    m_opt_link_table = opt_link_table;
+}
+
+FreeSpanLink& GenericFreeList::link(APtr span_ptr) const {
+    if (m_opt_link_table) {
+        return m_opt_link_table->page_info(span_ptr).free_link;
+    } else {
+        return *reinterpret_cast<FreeSpanLink*>(span_ptr);
+    }
 }
 
 APtr GenericFreeList::try_allocate_items(size_t item_count) {
-    GflIterator pred = m_free_span_list.before_begin();
-    GflIterator self = m_free_span_list.begin();
-    
-    while (self != m_free_span_list.end()) {
-        if (self->count == item_count) {
-            auto extracted_ptr = self->ptr;
-            m_free_span_list.erase_after(pred);
-            return extracted_ptr;
-        }
-        else if (self->count > item_count) {
-            auto extracted_ptr = self->ptr;
-            self->count -= item_count;
-            self->ptr += m_item_stride_in_ablks * item_count;
-            return extracted_ptr;
+    APtr* pred_next = &m_head;
+    while (APtr self = *pred_next) {
+        FreeSpanLink& self_link = link(self);
+        if (self_link.count == item_count) {
+            *pred_next = self_link.next;
+            return self;
+        }
+        else if (self_link.count > item_count) {
+            APtr rest = self + m_item_stride_in_ablks * item_count;
+            link(rest) = {self_link.next, self_link.count - item_count};
+            *pred_next = rest;
+            return self;
         }
         else {
             // keep scanning...
-            pred = self;
-            self++;
+            pred_next = &self_link.next;
         }
     }
 
@@ -104,78 +499,83 @@ APtr GenericFreeList::try_allocate_items(size_t item_count) {
     return nullptr;
 }
 
-std::pair<GflIterator,GflIterator> GenericFreeList::return_items_impl(APtr ptr, size_t item_count) {
+GenericSpan GenericFreeList::try_allocate_up_to_items(size_t max_item_count) {
+    APtr self = m_head;
+    if (!self) {
+        return {nullptr, 0};
+    }
+    FreeSpanLink& self_link = link(self);
+    if (self_link.count <= max_item_count) {
+        m_head = self_link.next;
+        return {self, self_link.count};
+    } else {
+        APtr rest = self + m_item_stride_in_ablks * max_item_count;
+        link(rest) = {self_link.next, self_link.count - max_item_count};
+        m_head = rest;
+        return {self, max_item_count};
+    }
+}
+
+void GenericFreeList::return_items(APtr ptr, size_t item_count) {
     APtr free_beg = ptr;
     APtr free_end = ptr + item_count * m_item_stride_in_ablks;
 
-    GflIterator pred = m_free_span_list.before_begin();
-    GflIterator self = m_free_span_list.begin();
-
-    APtr self_beg = nullptr;
-    APtr self_end = nullptr;
-
-    while (self != m_free_span_list.end()) {
-        self_beg = self->ptr;
-        self_end = self->ptr + item_count * m_item_stride_in_ablks;
+    APtr* pred_next = &m_head;
+    while (APtr self = *pred_next) {
+        FreeSpanLink& self_link = link(self);
+        APtr self_end = self + self_link.count * m_item_stride_in_ablks;
         
         if (self_end == free_beg) {
             // extend 'self', possibly coalesce with 'next'
 
             // note we don't need to check for backward coalescence of
             // free-list spans if past forward coalescence fails.
-            
-            // acquiring 'next'
-            GflIterator self_backup = self;
-            GflIterator next = ++self;
-            self = self_backup;
-            
-            // trying to coalesce first:
-            bool can_coalesce = (
-                next != m_free_span_list.end() &&
-                // free_beg == self_end &&
-                free_end == next->ptr
-            );
-            if (can_coalesce) {
-                self->count += item_count + next->count;
-                m_free_span_list.erase_after(self);
-                return {pred, self};
+            APtr next = self_link.next;
+            if (next && free_end == next) {
+                FreeSpanLink const next_link = link(next);
+                self_link.count += item_count + next_link.count;
+                self_link.next = next_link.next;
+                return;
             }
 
             // otherwise, just extending 'self' in +ve direction
-            self->count += item_count;
-            return {pred, self};
+            self_link.count += item_count;
+            return;
         }
-        else if (free_end == self->ptr) {
-            // extend 'self' backward
+        else if (free_end == self) {
+            // extend 'self' backward, moving its link to the new first item
 
             // note we can never coalesce backward if past
             // forward coalescence has failed for 'pred'.
-
-            // can still extend backward
-            self->ptr -= item_count;
-            self->count += item_count;
-            return {pred, self};
+            link(free_beg) = {self_link.next, self_link.count + item_count};
+            *pred_next = free_beg;
+            return;
         }
-        else if (free_beg < self_beg) {
+        else if (free_beg < self) {
             // insert just before 'self', i.e. just after 'pred'
-            assert(free_end < self_beg);
-            m_free_span_list.insert_after(pred, {free_beg, item_count});
-            return {pred, self};
+            assert(free_end < self);
+            link(free_beg) = {self, item_count};
+            *pred_next = free_beg;
+            return;
         }
         else {
             // continue to scan...
-            pred = self;
-            self++;
+            pred_next = &self_link.next;
         }
     }
 
     // iff we reach the end of this free-list and could not satisfy this
-    // deallocation, even by extending the last free-list node, we append
-    // a new node, exploiting the fact that 'pred' points at the 'back()'
-    // node (since 'self' points at end())
-    GflIterator back = pred;
-    m_free_span_list.insert_after(back, {free_beg, item_count});
-    return {pred, self};
+    // deallocation, even by extending the last span, we append a new span, 
+    // exploiting the fact that 'pred_next' is the last span's link.
+    append_items(pred_next, free_beg, item_count);
+}
+
+APtr* GenericFreeList::append_items(APtr* tail_link, APtr ptr, size_t item_count) {
+    assert(*tail_link == nullptr);
+    FreeSpanLink& ptr_link = link(ptr);
+    ptr_link = {nullptr, item_count};
+    *tail_link = ptr;
+    return &ptr_link.next;
 }
 
 ///
@@ -187,34 +587,98 @@ void BaseObjectAllocator::init(SizeClassIndex sci) {
     m_object_free_list.init(sci);
 }
 
+void FrontEndObjectAllocator::init(SizeClassIndex sci) {
+    m_bump = nullptr;
+    m_bump_end = nullptr;
+    m_free_head = nullptr;
+    m_free_count = 0;
+    m_stride_in_ablks = kSizeClasses[sci].size / sizeof(ABlk);
+}
+void FrontEndObjectAllocator::refill(ObjectBatch batch) {
+    assert(m_free_head == nullptr && m_bump == m_bump_end);
+    m_bump = batch.span.ptr;
+    m_bump_end = batch.span.ptr + batch.span.count * m_stride_in_ablks;
+    m_free_head = batch.chain.head;
+    m_free_count = batch.chain.count;
+}
+FreeObjectChain FrontEndObjectAllocator::take_free_objects(size_t max_count) {
+    FreeObjectChain chain{m_free_head, 0};
+    FreeObject* last = nullptr;
+    while (m_free_head && chain.count < max_count) {
+        last = m_free_head;
+        m_free_head = m_free_head->next;
+        chain.count++;
+    }
+    if (last) {
+        last->next = nullptr;
+    } else {
+        chain.head = nullptr;
+    }
+    m_free_count -= chain.count;
+    return chain;
+}
+ObjectSpan FrontEndObjectAllocator::take_bump_span() {
+    if (m_bump == m_bump_end) {
+        return {{nullptr, 0}};
+    }
+    ObjectSpan span{{m_bump, static_cast<size_t>(m_bump_end - m_bump) / m_stride_in_ablks}};
+    m_bump = m_bump_end = nullptr;
+    return span;
+}
+
 void CentralObjectAllocator::init(SizeClassIndex sci) {
     BaseObjectAllocator::init(sci);
     m_page_spans.reserve(1024);
-    m_page_span_refcounts.reserve(1024);
-}
-std::optional<ObjectSpan> CentralObjectAllocator::try_allocate_object_span() { 
-    size_t const count = kSizeClasses[m_sci].num_to_move;
-    APtr ptr = m_object_free_list.try_allocate_items(count);
-    if (ptr) {
-        retain_page_spans(ptr, ptr + ((count*kSizeClasses[m_sci].size) >> CONFIG_TCMALLOC_PAGE_SHIFT));
-        return {{ptr, count}}; 
+    m_returned_objects = {nullptr, 0};
+}
+std::optional<ObjectBatch> CentralObjectAllocator::try_allocate_object_batch() { 
+    size_t const count = objects_per_move(m_sci);
+
+    // objects returned by front-ends are handed out first: they are not coalesced until the next sweep.
+    if (m_returned_objects.count > 0) {
+        FreeObjectChain chain{m_returned_objects.head, 0};
+        FreeObject* last = nullptr;
+        while (m_returned_objects.head && chain.count < count) {
+            last = m_returned_objects.head;
+            m_returned_objects.head = last->next;
+            chain.count++;
+        }
+        last->next = nullptr;
+        m_returned_objects.count -= chain.count;
+        return {{{{nullptr, 0}}, chain}};
+    }
+
+    // NOTE: after a sweep, free objects are scattered among live ones, so partial spans are handed out
+    // rather than searching for a run of `objects_per_move`.
+    GenericSpan span = m_object_free_list.try_allocate_up_to_items(count);
+    if (span.count > 0) {
+        return {{{{span.ptr, span.count}}, {nullptr, 0}}}; 
     } else {
         return {};
     }
 }
-std::pair<GenericFreeList::Iterator, GenericFreeList::Iterator> CentralObjectAllocator::return_object_span(ObjectSpan span) {
-    release_page_spans(span.ptr, span.ptr + span.count*kSizeClasses[m_sci].size/sizeof(ABlk));
-    return m_object_free_list.return_items_impl(span.ptr, span.count);
+void CentralObjectAllocator::return_object_chain(FreeObjectChain chain) {
+    if (chain.count == 0) {
+        return;
+    }
+    FreeObject* last = chain.head;
+    while (last->next) {
+        last = last->next;
+    }
+    last->next = m_returned_objects.head;
+    m_returned_objects.head = chain.head;
+    m_returned_objects.count += chain.count;
+}
+void CentralObjectAllocator::return_object_span(ObjectSpan span) {
+    m_object_free_list.return_items(span.ptr, span.count);
 }
 void CentralObjectAllocator::add_page_span_to_pool(PageSpan span) {
-#if !GC_SINGLE_THREADED_MODE
-    std::lock_guard lg{m_mutex};
-#endif    
+    // NOTE: `m_mutex` is already held by the middle-end.
 
     // NOTE: the number of pages in each page-span is determined kSizeClasses
     assert(span.count == kSizeClasses[m_sci].pages);
     
-    // adding this span into a vector, adding refcount 0 into a vector
+    // adding this span into a vector
     // Using a BFS to find the offset of the first element with ptr > this one
     // i.e. leftmost element (cf Wikipedia Binary Search)
     // Even if T is not in the array, L is the rank of T in the array
@@ -244,7 +708,6 @@ void CentralObjectAllocator::add_page_span_to_pool(PageSpan span) {
 
     // insert just before this element
     m_page_spans.insert(m_page_spans.begin() + insert_index, span);
-    m_page_span_refcounts.insert(m_page_span_refcounts.begin() + insert_index, 0);
 
     // adding objects to the free-list:
     size_t span_page_count = span.count;
@@ -253,184 +716,531 @@ void CentralObjectAllocator::add_page_span_to_pool(PageSpan span) {
     // assert(span_pages_size_in_bytes % kSizeClasses[m_sci].size == 0);
     m_object_free_list.return_items(span.ptr, num_objects);
 }
-void CentralObjectAllocator::retain_page_spans(APtr beg, APtr end) {
-    help_map_intersecting_page_spans(
-        [this] (size_t page_span_index) {
-            ++this->m_page_span_refcounts[page_span_index];
-        },
-        beg, end
-    );
-}
-void CentralObjectAllocator::release_page_spans(APtr beg, APtr end) {
-    help_map_intersecting_page_spans(
-        [this] (size_t page_span_index) {
-            --this->m_page_span_refcounts[page_span_index];
-        },
-        beg, end
-    );
-}
-void CentralObjectAllocator::help_map_intersecting_page_spans(std::function<void(size_t)> cb, APtr beg, APtr end) {
-    // Using a binary search to locate the first page-span before 'beg'
-    // According to Wikipedia, using procedure to find the right-most element: this performs 'rounding down'
-    // https://en.wikipedia.org/wiki/Binary_search_algorithm#Procedure_for_finding_the_rightmost_element
-    // NOTE: 'r' should be 'n' with 'l' '0' where 'n' is array length
-    
-    
-    size_t l_page_span = 0;
-    size_t r_page_span = m_page_spans.size();
-    while (l_page_span < r_page_span) {
-        size_t i_page_span = l_page_span/2 + r_page_span/2;
-        if (m_page_spans[i_page_span].ptr > beg) {
-            r_page_span = i_page_span;
-        } else {
-            l_page_span = i_page_span + 1;
-        }
-    }
-    size_t i_page_span = r_page_span - 1;
-
-    // scanning through pages to determine intersection
-    while (i_page_span < m_page_spans.size()) {
-        PageSpan span = m_page_spans[i_page_span];
-        APtr span_beg = span.ptr;
-        APtr span_end = span_beg + span.count * PAGE_SIZE_IN_ABLKS;
-        bool intersect = (
-            (beg <= span_beg && span_beg <= end) ||
-            (span_beg <= beg && beg <= span_end) ||
-            (span_beg <= beg && end <= span_end) ||
-            (beg <= span_beg && span_end <= end)
-        );
-        if (intersect) {
-            cb(i_page_span);
-        }
-        if (span_beg >= end) {
-            break;
-        } else {
-            i_page_span++;
-        }
-    }
+size_t CentralObjectAllocator::page_span_count() {
+#if !GC_SINGLE_THREADED_MODE
+    std::lock_guard lg{m_mutex};
+#endif
+    return m_page_spans.size();
 }
-void CentralObjectAllocator::trim_unused_pages(GcMiddleEnd* middle_end) {
+size_t CentralObjectAllocator::free_object_count() {
 #if !GC_SINGLE_THREADED_MODE
     std::lock_guard lg{m_mutex};
 #endif
-    assert(m_page_span_refcounts.size() == m_page_spans.size());
-    
-    size_t page_span_index = 0;
-    while (page_span_index < m_page_spans.size()) {
-        PageSpan page_span = m_page_spans[page_span_index];
-        if (m_page_span_refcounts[page_span_index] == 0) {
-            // erasing all parallel vectors:
-            m_page_spans.erase(m_page_spans.begin() + page_span_index);
-            m_page_span_refcounts.erase(m_page_span_refcounts.begin() + page_span_index);
-            // extract this space from the object free-list, return to back-end:
-            extract_page_span_from_object_free_list(page_span, middle_end->back_end());
-        } else {
-            ++page_span_index;
-        }
+    size_t count = m_returned_objects.count;
+    for (GenericSpan const& span: m_object_free_list) {
+        count += span.count;
     }
+    return count;
 }
-void CentralObjectAllocator::extract_page_span_from_object_free_list(
-    PageSpan extract_page_span, 
-    GcBackEnd* back_end
-) {
-    assert(kSizeClasses[m_sci].pages == extract_page_span.count);
-
-    GflIterator pred = m_object_free_list.before_begin();
-    GflIterator self = m_object_free_list.begin();
-
-    APtr extract_beg = extract_page_span.ptr;
-    APtr extract_end = extract_page_span.ptr + extract_page_span.count * PAGE_SIZE_IN_ABLKS;
-
-    while (self != m_object_free_list.end()) {
-        APtr span_beg = self->ptr;
-        APtr span_end = span_beg + self->count * m_object_free_list.object_size_in_ablks();
+// sort_free_objects merge-sorts a chain of `count` free objects by address, relinking them in place.
+static FreeObject* sort_free_objects(FreeObject* head, size_t count) {
+    if (count <= 1) {
+        return head;
+    }
+    FreeObject* mid = head;
+    for (size_t i = 1; i < count / 2; i++) {
+        mid = mid->next;
+    }
+    FreeObject* rest = mid->next;
+    mid->next = nullptr;
+    FreeObject* l = sort_free_objects(head, count / 2);
+    FreeObject* r = sort_free_objects(rest, count - count / 2);
 
-        if (span_beg <= extract_beg) {
-            // expect the first node we find to be suitable
-            assert(extract_end <= span_end);
+    FreeObject* sorted = nullptr;
+    FreeObject** tail = &sorted;
+    while (l && r) {
+        FreeObject** min = (l < r) ? &l : &r;
+        *tail = *min;
+        tail = &(*min)->next;
+        *min = (*min)->next;
+    }
+    *tail = l ? l : r;
+    return sorted;
+}
+size_t CentralObjectAllocator::sweep(GcBackEnd* back_end) {
+#if !GC_SINGLE_THREADED_MODE
+    std::lock_guard lg{m_mutex};
+#endif
+    PageMap& page_map = back_end->page_map();
+    size_t const object_size = kSizeClasses[m_sci].size;
+    size_t const stride = object_size / sizeof(ABlk);
+    size_t const objects_per_page_span = kSizeClasses[m_sci].pages * PAGE_SIZE_IN_BYTES / object_size;
 
-            // calculating leftover space before and after:
-            size_t bytes_before = reinterpret_cast<size_t>(extract_beg) - reinterpret_cast<size_t>(span_beg);
-            size_t bytes_after = reinterpret_cast<size_t>(span_end) - reinterpret_cast<size_t>(extract_end);
-            size_t object_size = kSizeClasses[m_sci].size;
-            size_t objects_before = bytes_before / object_size;
-            size_t objects_after = bytes_after / object_size;
+    // the old free-list and returned objects tell apart free slots from dead objects, which must be 
+    // finalized. Both are read in address order as the new free-list is built over them: each old link is 
+    // read before the slot it lies in is reached, and each new link is written after.
+    APtr old_ptr = m_object_free_list.take_head();
+    FreeSpanLink old_link = old_ptr ? m_object_free_list.link(old_ptr) : FreeSpanLink{nullptr, 0};
+    FreeObject* returned = sort_free_objects(m_returned_objects.head, m_returned_objects.count);
+    m_returned_objects = {nullptr, 0};
 
-            // must extract 'span' from this free-list node
-            if (objects_before == 0 && objects_after == 0) {
-                // delete this node
-                m_object_free_list.erase_after(pred);
+    // scanning every slot of every page-span, in address order, appending each run of free slots to the 
+    // new free-list:
+    APtr* tail = m_object_free_list.head_link();
+    size_t kept_count = 0;
+    size_t live_count = 0;
+    for (PageSpan page_span: m_page_spans) {
+        APtr const beg = page_span.ptr;
+        APtr const end = beg + objects_per_page_span * stride;
+        bool const any_live = page_map.any_marked(page_span);
+        APtr* const page_span_tail = tail;
+        size_t page_span_live_count = 0;
+        APtr run_beg = nullptr;
+        size_t run_count = 0;
+        for (APtr obj = beg; obj < end; obj += stride) {
+            while (old_ptr && old_ptr + old_link.count * stride <= obj) {
+                old_ptr = old_link.next;
+                if (old_ptr) {
+                    old_link = m_object_free_list.link(old_ptr);
+                }
             }
-            else if (objects_after == 0) {
-                // shrink, keep 'ptr'
-                self->count = objects_before;
+            bool was_free = (old_ptr && old_ptr <= obj);
+            if (reinterpret_cast<APtr>(returned) == obj) {
+                returned = returned->next;
+                was_free = true;
             }
-            else if (objects_before == 0) {
-                // shrink
-                self->ptr = extract_end;
-                self->count = objects_after;
+            if (any_live && page_map.is_marked(obj)) {
+                page_span_live_count++;
+                if (run_count > 0) {
+                    tail = m_object_free_list.append_items(tail, run_beg, run_count);
+                    run_count = 0;
+                }
+                continue;
             }
-            else {
-                // split in two
-                self->ptr = extract_beg;
-                self->count = objects_before;
-                m_object_free_list.insert_after(self, {extract_end, objects_after});
+            if (!was_free) {
+                reinterpret_cast<BaseBoxedObject*>(obj)->gc_finalize();
+            }
+            if (run_count == 0) {
+                run_beg = obj;
             }
+            run_count++;
+        }
+        if (run_count > 0) {
+            tail = m_object_free_list.append_items(tail, run_beg, run_count);
+        }
 
-            // returning extracted page-span directly to back-end:
-            back_end->return_page_span(extract_page_span);
+        if (any_live) {
+            page_map.clear_marks(page_span);
         }
+        if (page_span_live_count == 0) {
+            // nothing left in this page-span: unlinking its run, and returning it to the back-end for any 
+            // size-class.
+            tail = page_span_tail;
+            *tail = nullptr;
+            page_map.assign(page_span, 0);
+            back_end->return_page_span(page_span);
+        } else {
+            m_page_spans[kept_count++] = page_span;
+        }
+        live_count += page_span_live_count;
+    }
+    assert(returned == nullptr);
 
-        // next iteration
-        pred = self;
-        self++;
-    }    
+    m_page_spans.resize(kept_count);
+    return live_count * object_size;
 }
 
 ///
 // PageMap
 //
 
-#if 0
-void PageMap::init(GcBackEnd* back_end) {
-    m_beg_aptr_address = reinterpret_cast<size_t>(back_end->total_pages_beg_address());
-    m_end_aptr_address = reinterpret_cast<size_t>(back_end->total_pages_end_address());
-    m_page_table.resize(back_end->total_page_count());
+static size_t round_up_to_os_pages(size_t byte_count) {
+    size_t os_page = os_page_size();
+    return (byte_count + os_page - 1) / os_page * os_page;
+}
+PageMap::~PageMap() {
+    if (m_page_table) {
+        os_release_memory(reinterpret_cast<APtr>(m_page_table), m_page_table_byte_count);
+    }
+    if (m_mark_words) {
+        os_release_memory(reinterpret_cast<APtr>(m_mark_words), m_mark_words_byte_count);
+    }
+}
+void PageMap::init(APtr beg, size_t page_count) {
+    m_beg = beg;
+    m_end = beg + page_count * PAGE_SIZE_IN_ABLKS;
+    m_page_table_byte_count = round_up_to_os_pages(page_count * sizeof(PageInfo));
+    m_mark_words_byte_count = round_up_to_os_pages(page_count * MARK_WORDS_PER_PAGE * sizeof(uint64_t));
+    m_page_table = reinterpret_cast<PageInfo*>(os_allocate_zeroed_memory(m_page_table_byte_count));
+    m_mark_words = reinterpret_cast<uint64_t*>(os_allocate_zeroed_memory(m_mark_words_byte_count));
+    if (!m_page_table || !m_mark_words) {
+        std::stringstream ss;
+        ss << "Insufficient system memory: could not map the page-map of a " << page_count << "-page heap";
+        error(ss.str());
+        throw SsiError();
+    }
+}
+void PageMap::assign(PageSpan span, SizeClassIndex sci) {
+    PageIndex first = page_index(span.ptr);
+    for (PageIndex i = first; i < first + span.count; i++) {
+        m_page_table[i].sci = sci;
+    }
+}
+bool PageMap::any_marked(PageSpan span) const {
+    // OR-ing whole words: this loop is vectorized.
+    uint64_t const* words = mark_words(span);
+    size_t word_count = span.count * MARK_WORDS_PER_PAGE;
+    uint64_t any = 0;
+    for (size_t i = 0; i < word_count; i++) {
+        any |= words[i];
+    }
+    return any != 0;
+}
+void PageMap::clear_marks(PageSpan span) {
+    std::fill_n(mark_words(span), span.count * MARK_WORDS_PER_PAGE, 0);
 }
-#endif
 
 ///
 // Back-end:
 //
 
+GcBackEnd::~GcBackEnd() {
+    if (m_reservation) {
+        os_release_memory(m_reservation, m_reservation_byte_count);
+    }
+}
 void GcBackEnd::init(size_t single_contiguous_region_page_capacity, APtr single_contiguous_memory_region) {
-    m_single_contiguous_region_beg = single_contiguous_memory_region;
-    m_single_contiguous_region_end = reinterpret_cast<APtr>(
-        reinterpret_cast<uint8_t*>(m_single_contiguous_region_beg) + 
-        single_contiguous_region_page_capacity * PAGE_SIZE_IN_BYTES
-    );
-    m_single_contiguous_region_page_capacity = single_contiguous_region_page_capacity;
+    m_commit_on_use = false;
+    init_impl(single_contiguous_memory_region, single_contiguous_region_page_capacity, single_contiguous_region_page_capacity);
+}
+void GcBackEnd::init_reserved(size_t initial_page_count, size_t reserved_page_count) {
+    // reserving one more page than needed, so that the region can start on a page boundary:
+    m_reservation_byte_count = (reserved_page_count + 1) * PAGE_SIZE_IN_BYTES;
+    m_reservation = os_reserve_memory(m_reservation_byte_count);
+    if (!m_reservation) {
+        std::stringstream ss;
+        ss << "Insufficient address space: could not reserve " << m_reservation_byte_count << "B";
+        error(ss.str());
+        throw SsiError();
+    }
+    size_t bytes_after_page_start = reinterpret_cast<size_t>(m_reservation) % PAGE_SIZE_IN_BYTES;
+    APtr region = m_reservation + (bytes_after_page_start ? (PAGE_SIZE_IN_BYTES - bytes_after_page_start) / sizeof(ABlk) : 0);
+
+    // pages can only be committed one at a time if they are at least as large as the OS's: else, the
+    // whole reservation is committed up front, and the OS backs it as it is touched.
+    m_commit_on_use = (os_page_size() <= PAGE_SIZE_IN_BYTES);
+    if (!m_commit_on_use && !os_commit_memory(m_reservation, m_reservation_byte_count)) {
+        std::stringstream ss;
+        ss << "Insufficient system memory: could not commit " << m_reservation_byte_count << "B";
+        error(ss.str());
+        throw SsiError();
+    }
+    init_impl(region, initial_page_count, reserved_page_count);
+}
+void GcBackEnd::init_impl(APtr region, size_t initial_page_count, size_t reserved_page_count) {
+    m_single_contiguous_region_beg = region;
+    m_single_contiguous_region_end = region + reserved_page_count * PAGE_SIZE_IN_ABLKS;
+    m_single_contiguous_region_page_capacity = reserved_page_count;
+    m_committed_page_count = m_commit_on_use ? 0 : reserved_page_count;
+    m_released_page_count = 0;
+    m_collection_epoch = 0;
     
-    // initializing the page free list:
-    m_page_free_list.init();
-    return_page_span({m_single_contiguous_region_beg, m_single_contiguous_region_page_capacity});
+    // initializing the page map, then splitting the region into page-heap shards, each exposing its share 
+    // of the initial pages:
+    m_page_map.init(m_single_contiguous_region_beg, m_single_contiguous_region_page_capacity);
+    m_shard_count = std::clamp<size_t>(initial_page_count / MIN_PAGE_HEAP_SHARD_PAGE_CAPACITY, 1, MAX_PAGE_HEAP_SHARD_COUNT);
+    m_shard_page_capacity = m_single_contiguous_region_page_capacity / m_shard_count;
+    for (size_t i = 0; i < m_shard_count; i++) {
+        size_t initial_share = initial_page_count / m_shard_count;
+        if (i+1 == m_shard_count) {
+            initial_share = initial_page_count - i * initial_share;
+        }
+        m_shards[i].free_list.init(&m_page_map);
+        m_shards[i].exposed_page_count = std::min(initial_share, shard_page_capacity(i));
+        m_shards[i].free_list.return_items(shard_beg(i), m_shards[i].exposed_page_count);
+    }
+}
+size_t GcBackEnd::shard_index(APtr ptr) const {
+    size_t page_index = static_cast<size_t>(ptr - m_single_contiguous_region_beg) / PAGE_SIZE_IN_ABLKS;
+    return std::min(page_index / m_shard_page_capacity, m_shard_count - 1);
+}
+size_t GcBackEnd::home_shard_index() const {
+    // each OS thread starts searching from its own shard, spreading threads round-robin:
+    static std::atomic<size_t> s_thread_counter = 0;
+    thread_local size_t const t_home = s_thread_counter.fetch_add(1, std::memory_order_relaxed);
+    return t_home % m_shard_count;
+}
+APtr GcBackEnd::shard_beg(size_t shard_index) const {
+    return m_single_contiguous_region_beg + shard_index * m_shard_page_capacity * PAGE_SIZE_IN_ABLKS;
+}
+size_t GcBackEnd::shard_page_capacity(size_t shard_index) const {
+    // the last shard holds the remainder:
+    if (shard_index+1 == m_shard_count) {
+        return m_single_contiguous_region_page_capacity - shard_index * m_shard_page_capacity;
+    }
+    return m_shard_page_capacity;
 }
 std::optional<PageSpan> GcBackEnd::try_allocate_page_span(size_t page_count) {
+    // trying the pages each shard already exposes first, then growing shards into the reservation:
+    size_t const home = home_shard_index();
+    for (bool grow: {false, true}) {
+        for (size_t i = 0; i < m_shard_count; i++) {
+            size_t const shard_index = (home + i) % m_shard_count;
+            PageHeapShard& shard = m_shards[shard_index];
+        #if !GC_SINGLE_THREADED_MODE
+            std::lock_guard lg{shard.mutex};
+        #endif
+            if (grow && !try_grow_shard(shard_index, page_count)) {
+                continue;
+            }
+            auto res_ptr = shard.free_list.try_allocate_items(page_count);
+            if (res_ptr) {
+                PageSpan page_span{res_ptr, page_count};
+                if (!commit(page_span)) {
+                    shard.free_list.return_items(res_ptr, page_count);
+                    return {};
+                }
+                return {page_span};
+            }
+        }
+    }
+    return {};
+}
+void GcBackEnd::return_page_span(PageSpan page_span) {
+    PageHeapShard& shard = m_shards[shard_index(page_span.ptr)];
+#if !GC_SINGLE_THREADED_MODE
+    std::lock_guard lg{shard.mutex};
+#endif
+    uint32_t const epoch = m_collection_epoch.load(std::memory_order_relaxed);
+    PageIndex const first = m_page_map.page_index(page_span.ptr);
+    for (PageIndex i = first; i < first + page_span.count; i++) {
+        m_page_map.page_info(i).idle_since = epoch;
+    }
+    shard.free_list.return_items(page_span.ptr, page_span.count);
+}
+bool GcBackEnd::try_grow_shard(size_t shard_index, size_t page_count) {
+    // doubling the shard's exposed pages, but at least by `page_count`, within its range:
+    PageHeapShard& shard = m_shards[shard_index];
+    size_t const capacity = shard_page_capacity(shard_index);
+    if (shard.exposed_page_count >= capacity) {
+        return false;
+    }
+    size_t growth = std::min(capacity - shard.exposed_page_count, std::max(page_count, shard.exposed_page_count));
+    APtr grown_beg = shard_beg(shard_index) + shard.exposed_page_count * PAGE_SIZE_IN_ABLKS;
+    shard.exposed_page_count += growth;
+    shard.free_list.return_items(grown_beg, growth);
+    return true;
+}
+bool GcBackEnd::commit(PageSpan page_span) {
+    if (!m_commit_on_use) {
+        return true;
+    }
+    // committing each run of pages not yet committed:
+    PageIndex const first = m_page_map.page_index(page_span.ptr);
+    PageIndex const end = first + page_span.count;
+    for (PageIndex i = first; i < end;) {
+        if (m_page_map.page_info(i).committed) {
+            i++;
+            continue;
+        }
+        PageIndex run_end = i;
+        while (run_end < end && !m_page_map.page_info(run_end).committed) {
+            run_end++;
+        }
+        if (!os_commit_memory(m_single_contiguous_region_beg + i * PAGE_SIZE_IN_ABLKS, (run_end - i) * PAGE_SIZE_IN_BYTES)) {
+            return false;
+        }
+        for (PageIndex j = i; j < run_end; j++) {
+            m_page_map.page_info(j).committed = true;
+        }
+        m_committed_page_count.fetch_add(run_end - i, std::memory_order_relaxed);
+        i = run_end;
+    }
+    return true;
+}
+size_t GcBackEnd::release_idle_pages() {
+    uint32_t const epoch = m_collection_epoch.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (!m_commit_on_use || CONFIG_GC_RELEASE_IDLE_COLLECTIONS == 0) {
+        return 0;
+    }
+    auto is_idle = [this, epoch] (PageIndex i) {
+        PageInfo const& info = m_page_map.page_info(i);
+        return info.committed && epoch - info.idle_since >= CONFIG_GC_RELEASE_IDLE_COLLECTIONS;
+    };
+
+    // decommitting each run of idle pages in every free page-span:
+    size_t released_count = 0;
+    for (size_t shard_index = 0; shard_index < m_shard_count; shard_index++) {
+        PageHeapShard& shard = m_shards[shard_index];
+    #if !GC_SINGLE_THREADED_MODE
+        std::lock_guard lg{shard.mutex};
+    #endif
+        for (GenericSpan const& span: shard.free_list) {
+            PageIndex const first = m_page_map.page_index(span.ptr);
+            PageIndex const end = first + span.count;
+            for (PageIndex i = first; i < end;) {
+                if (!is_idle(i)) {
+                    i++;
+                    continue;
+                }
+                PageIndex run_end = i;
+                while (run_end < end && is_idle(run_end)) {
+                    run_end++;
+                }
+                os_decommit_memory(m_single_contiguous_region_beg + i * PAGE_SIZE_IN_ABLKS, (run_end - i) * PAGE_SIZE_IN_BYTES);
+                for (PageIndex j = i; j < run_end; j++) {
+                    m_page_map.page_info(j).committed = false;
+                }
+                released_count += run_end - i;
+                i = run_end;
+            }
+        }
+    }
+    m_committed_page_count.fetch_sub(released_count, std::memory_order_relaxed);
+    m_released_page_count.fetch_add(released_count, std::memory_order_relaxed);
+    return released_count;
+}
+size_t GcBackEnd::exposed_page_count() {
+    size_t count = 0;
+    for (size_t i = 0; i < m_shard_count; i++) {
+    #if !GC_SINGLE_THREADED_MODE
+        std::lock_guard lg{m_shards[i].mutex};
+    #endif
+        count += m_shards[i].exposed_page_count;
+    }
+    return count;
+}
+size_t GcBackEnd::free_page_count() {
+    size_t count = 0;
+    for (size_t i = 0; i < m_shard_count; i++) {
+    #if !GC_SINGLE_THREADED_MODE
+        std::lock_guard lg{m_shards[i].mutex};
+    #endif
+        for (GenericSpan const& span: m_shards[i].free_list) {
+            count += span.count;
+        }
+    }
+    return count;
+}
+
+///
+// Transfer-cache:
+//
+
+void TransferCache::init() {
+    for (size_t i = 0; i < CAPACITY; i++) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        m_cells[i].head = nullptr;
+    }
+    m_push_pos.store(0, std::memory_order_relaxed);
+    m_pop_pos.store(0, std::memory_order_relaxed);
+}
+bool TransferCache::try_push(FreeObject* head) {
+    size_t pos = m_push_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = m_cells[pos % CAPACITY];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            // cell free for this lap: claiming it.
+            if (m_push_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.head = head;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // cell still holds a chain from the last lap: full.
+            return false;
+        } else {
+            pos = m_push_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+FreeObject* TransferCache::try_pop() {
+    size_t pos = m_pop_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = m_cells[pos % CAPACITY];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+            // cell pushed for this lap: claiming it.
+            if (m_pop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                FreeObject* head = cell.head;
+                cell.sequence.store(pos + CAPACITY, std::memory_order_release);
+                return head;
+            }
+        } else if (diff < 0) {
+            // cell not yet pushed: empty.
+            return nullptr;
+        } else {
+            pos = m_pop_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+///
+// Large-object space:
+//
+
+void LargeObjectSpace::init(GcBackEnd* back_end) {
+    m_back_end = back_end;
+    m_page_spans.clear();
+}
+std::optional<PageSpan> LargeObjectSpace::try_allocate(size_t byte_count) {
+    size_t page_count = (byte_count + PAGE_SIZE_IN_BYTES - 1) / PAGE_SIZE_IN_BYTES;
+    auto opt_page_span = m_back_end->try_allocate_page_span(page_count);
+    if (opt_page_span.has_value()) {
+        m_back_end->page_map().assign(opt_page_span.value(), OVERSIZED_SCI);
+    #if !GC_SINGLE_THREADED_MODE
+        std::lock_guard lg{m_mutex};
+    #endif
+        m_page_spans.push_back(opt_page_span.value());
+    }
+    return opt_page_span;
+}
+void LargeObjectSpace::deallocate(APtr ptr) {
+    PageSpan page_span;
+    {
+    #if !GC_SINGLE_THREADED_MODE
+        std::lock_guard lg{m_mutex};
+    #endif
+        auto it = std::find_if(m_page_spans.begin(), m_page_spans.end(), [ptr] (PageSpan const& span) { 
+            return span.ptr == ptr; 
+        });
+        assert(it != m_page_spans.end() && "Deallocated a large object that was not allocated");
+        page_span = *it;
+        *it = m_page_spans.back();
+        m_page_spans.pop_back();
+    }
+    m_back_end->page_map().assign(page_span, 0);
+    m_back_end->return_page_span(page_span);
+}
+size_t LargeObjectSpace::sweep() {
 #if !GC_SINGLE_THREADED_MODE
     std::lock_guard lg{m_mutex};
 #endif
-    auto res_ptr = m_page_free_list.try_allocate_items(page_count);
-    if (res_ptr) {
-        return {PageSpan{res_ptr, page_count}};
-    } else {
-        return {};
+    PageMap& page_map = m_back_end->page_map();
+    size_t live_bytes = 0;
+    size_t kept_count = 0;
+    for (PageSpan page_span: m_page_spans) {
+        if (page_map.is_marked(page_span.ptr)) {
+            page_map.clear_marks(page_span);
+            m_page_spans[kept_count++] = page_span;
+            live_bytes += page_span.count * PAGE_SIZE_IN_BYTES;
+        } else {
+            reinterpret_cast<BaseBoxedObject*>(page_span.ptr)->gc_finalize();
+            page_map.assign(page_span, 0);
+            m_back_end->return_page_span(page_span);
+        }
     }
+    m_page_spans.resize(kept_count);
+    return live_bytes;
 }
-void GcBackEnd::return_page_span(PageSpan page_span) {
+size_t LargeObjectSpace::object_count() {
 #if !GC_SINGLE_THREADED_MODE
     std::lock_guard lg{m_mutex};
 #endif
-    m_page_free_list.return_items(page_span.ptr, page_span.count);
+    return m_page_spans.size();
+}
+size_t LargeObjectSpace::byte_count() {
+#if !GC_SINGLE_THREADED_MODE
+    std::lock_guard lg{m_mutex};
+#endif
+    size_t page_count = 0;
+    for (PageSpan const& span: m_page_spans) {
+        page_count += span.count;
+    }
+    return page_count * PAGE_SIZE_IN_BYTES;
 }
 
 ///
@@ -439,19 +1249,59 @@ void GcBackEnd::return_page_span(PageSpan page_span) {
 
 void GcMiddleEnd::init(GcBackEnd* backend) {
     m_back_end = backend;
+    m_allocated_bytes = 0;
+    m_collect_threshold_bytes = CONFIG_GC_MIN_COLLECT_THRESHOLD_BYTES;
+    m_collect_requested = false;
     for (SizeClassIndex sci = 1; sci < kSizeClassesCount; sci++) {
         m_central_object_allocators[sci].init(sci);
+        m_transfer_caches[sci].init();
+    }
+    m_large_object_space.init(backend);
+}
+std::optional<ObjectBatch> GcMiddleEnd::try_allocate_object_batch(SizeClassIndex sci) {
+    TraceSpan span{"gc-refill"};
+    // a full chain from the transfer-cache avoids taking the size-class's lock:
+    std::optional<ObjectBatch> opt_batch;
+    if (FreeObject* head = m_transfer_caches[sci].try_pop()) {
+        opt_batch = ObjectBatch{ObjectSpan{nullptr, 0}, FreeObjectChain{head, objects_per_move(sci)}};
+        m_counters[sci].refill_from_transfer_cache_count.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        opt_batch = help_allocate_object_batch(sci);
     }
+    if (opt_batch.has_value()) {
+        // counting allocation volume: objects are only handed to a front-end when it runs out, so this is
+        // rarely reached.
+        count_allocated_bytes((opt_batch->span.count + opt_batch->chain.count) * kSizeClasses[sci].size);
+        m_counters[sci].refill_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return opt_batch;
+}
+APtr GcMiddleEnd::try_allocate_large_object(size_t byte_count) {
+    auto opt_page_span = m_large_object_space.try_allocate(byte_count);
+    if (!opt_page_span.has_value()) {
+        return nullptr;
+    }
+    count_allocated_bytes(opt_page_span->count * PAGE_SIZE_IN_BYTES);
+    return opt_page_span->ptr;
 }
-std::optional<ObjectSpan> GcMiddleEnd::try_allocate_object_span(SizeClassIndex sci) {
+void GcMiddleEnd::return_large_object(APtr ptr) {
+    m_large_object_space.deallocate(ptr);
+}
+void GcMiddleEnd::count_allocated_bytes(size_t byte_count) {
+    size_t allocated_bytes = m_allocated_bytes.fetch_add(byte_count, std::memory_order_relaxed) + byte_count;
+    if (!CONFIG_DISABLE_GC_COLLECTION && allocated_bytes >= m_collect_threshold_bytes) {
+        m_collect_requested.store(true, std::memory_order_relaxed);
+    }
+}
+std::optional<ObjectBatch> GcMiddleEnd::help_allocate_object_batch(SizeClassIndex sci) {
 #if !GC_SINGLE_THREADED_MODE
     std::lock_guard lg{m_central_object_allocators[sci].mutex()};
 #endif
 
     // trying to satisfy allocation using existing page-span:
-    auto opt_object_span = m_central_object_allocators[sci].try_allocate_object_span();
-    if (opt_object_span.has_value()) {
-        return opt_object_span;
+    auto opt_batch = m_central_object_allocators[sci].try_allocate_object_batch();
+    if (opt_batch.has_value()) {
+        return opt_batch;
     }
 
     // TODO: check all larger allocators for spare objects/page-spans (?)
@@ -459,24 +1309,64 @@ std::optional<ObjectSpan> GcMiddleEnd::try_allocate_object_span(SizeClassIndex s
     // must fetch more page-spans from the page-heap:
     auto opt_page_span = m_back_end->try_allocate_page_span(kSizeClasses[sci].pages);
     if (opt_page_span.has_value()) {
+        m_back_end->page_map().assign(opt_page_span.value(), sci);
         m_central_object_allocators[sci].add_page_span_to_pool(opt_page_span.value());
 
         // now, allocation must succeed.
-        auto opt_object_span = m_central_object_allocators[sci].try_allocate_object_span();
-        assert(opt_object_span.has_value());
-        return opt_object_span;
+        auto opt_batch = m_central_object_allocators[sci].try_allocate_object_batch();
+        assert(opt_batch.has_value());
+        return opt_batch;
     }
 
     // allocation from page-heap failed => allocation failed.
     return {};
 }
 void GcMiddleEnd::return_object_span(SizeClassIndex sci, ObjectSpan span) {
+    m_counters[sci].return_count.fetch_add(1, std::memory_order_relaxed);
+#if !GC_SINGLE_THREADED_MODE
+    std::lock_guard lg{m_central_object_allocators[sci].mutex()};
+#endif
     m_central_object_allocators[sci].return_object_span(span);
 }
-void GcMiddleEnd::trim_unused_pages() {
+void GcMiddleEnd::return_object_chain(SizeClassIndex sci, FreeObjectChain chain) {
+    if (chain.count == 0) {
+        return;
+    }
+    m_counters[sci].return_count.fetch_add(1, std::memory_order_relaxed);
+    if (chain.count == objects_per_move(sci) && m_transfer_caches[sci].try_push(chain.head)) {
+        m_counters[sci].return_to_transfer_cache_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    help_return_object_chain(sci, chain);
+}
+void GcMiddleEnd::help_return_object_chain(SizeClassIndex sci, FreeObjectChain chain) {
+#if !GC_SINGLE_THREADED_MODE
+    std::lock_guard lg{m_central_object_allocators[sci].mutex()};
+#endif
+    m_central_object_allocators[sci].return_object_chain(chain);
+}
+void GcMiddleEnd::sweep() {
+    TraceSpan span{"gc-sweep"};
+    // the central allocators must know of every free object to tell them apart from dead ones: draining 
+    // the transfer-caches first.
     for (SizeClassIndex sci = 1; sci < kSizeClassesCount; sci++) {
-        m_central_object_allocators[sci].trim_unused_pages(this);
+        while (FreeObject* head = m_transfer_caches[sci].try_pop()) {
+            help_return_object_chain(sci, {head, objects_per_move(sci)});
+        }
     }
+
+    size_t live_bytes = 0;
+    for (SizeClassIndex sci = 1; sci < kSizeClassesCount; sci++) {
+        size_t sci_live_bytes = m_central_object_allocators[sci].sweep(m_back_end);
+        m_counters[sci].live_bytes.store(sci_live_bytes, std::memory_order_relaxed);
+        live_bytes += sci_live_bytes;
+    }
+    live_bytes += m_large_object_space.sweep();
+
+    // the next collection is due once the heap has grown in proportion to what survived this one:
+    m_allocated_bytes.store(0, std::memory_order_relaxed);
+    m_collect_threshold_bytes = std::max<size_t>(CONFIG_GC_MIN_COLLECT_THRESHOLD_BYTES, 2 * live_bytes);
+    m_collect_requested.store(false, std::memory_order_relaxed);
 }
 
 ///
@@ -490,112 +1380,62 @@ void GcFrontEnd::init(GcMiddleEnd* middle_end) {
     }
 }
 
-APtr GcFrontEnd::allocate(SizeClassIndex sci) {
-    if (sci == 0) {
-        error("NotImplemented: support for huge allocations");
+APtr GcFrontEnd::allocate_slow_path(SizeClassIndex sci) {
+    if (sci == 0 || is_oversized_sci(sci)) {
+        error("GC: allocation failed: objects above kMaxSize must be allocated in the large-object space");
         throw SsiError();
     }
-    APtr res = m_sub_allocators[sci].try_allocate_object();
-    if (res) {
-        // allocation from cache successful
-        return res;
-    } else {
-        // cache depleted: try to acquire a new object-span from the global middle-end
-        auto opt_object_span = m_middle_end->try_allocate_object_span(sci);
-        if (opt_object_span.has_value()) {
-            // adding the object-span to the free-list:
-            ObjectSpan objects = opt_object_span.value();
-            m_sub_allocators[sci].return_object_span({objects.ptr, objects.count});
-
-            // now, allocation for one object must succeeed:
-            APtr res = m_sub_allocators[sci].try_allocate_object();
-            assert(res && "Expected allocation to succeed after adding objects from transfer-cache");
-            
-            // DEBUG:
-            #if 0
-            {
-                std::cerr << "INFO: GC.F: allocated " << res << " for sci=" << (int)sci << " with size=" << kSizeClasses[sci].size << std::endl;
-            }
-            #endif
 
-            return res;
-        } else {
-            std::stringstream ss;
-            ss  << "GC: allocation failed: could not allocate " << kSizeClasses[sci].size << " bytes " << std::endl
-                << "    for object with SizeClassIndex " << static_cast<int>(sci) << std::endl;
-            error(ss.str());
-            throw SsiError();
+    // cache depleted: try to acquire a new object-batch from the global middle-end
+    auto opt_batch = m_middle_end->try_allocate_object_batch(sci);
+    if (opt_batch.has_value()) {
+        m_sub_allocators[sci].refill(opt_batch.value());
+
+        // now, allocation for one object must succeeed:
+        APtr res = m_sub_allocators[sci].try_allocate_object();
+        assert(res && "Expected allocation to succeed after adding objects from transfer-cache");
+        
+        // DEBUG:
+        #if 0
+        {
+            std::cerr << "INFO: GC.F: allocated " << res << " for sci=" << (int)sci << " with size=" << kSizeClasses[sci].size << std::endl;
         }
+        #endif
+
+        return res;
+    } else {
+        std::stringstream ss;
+        ss  << "GC: allocation failed: could not allocate " << kSizeClasses[sci].size << " bytes " << std::endl
+            << "    for object with SizeClassIndex " << static_cast<int>(sci) << std::endl;
+        error(ss.str());
+        throw SsiError();
     }
 }
-void GcFrontEnd::deallocate(APtr memory, SizeClassIndex sci) {
-    // returning the object to the free list:
-    auto fl_it_pair = m_sub_allocators[sci].return_object_span({memory, 1});
-    
-    // checking the modified free-list node to try to return objects to the transfer-cache:
-    GflIterator fl_node_pred = fl_it_pair.first;
-    GflIterator fl_node = fl_it_pair.second;
-    try_return_free_list_node_to_middle_end(sci, fl_node_pred, fl_node);
-}
-void GcFrontEnd::sweep(MarkedSet& marked_set) {
-    // clearing each free-list: we re-insert each live allocation later...
-    for (SizeClassIndex sci = 1; sci < kSizeClassesCount; sci++) {
-        m_sub_allocators[sci].clear();
-    }
-
-    // inserting each still-live allocation:
-    while (!marked_set.empty()) {
-        MarkedPtr mark = marked_set.pop_max();
-        m_sub_allocators[mark.sci].return_object(mark.ptr);
+APtr GcFrontEnd::allocate_large(size_t byte_count) {
+    APtr res = m_middle_end->try_allocate_large_object(byte_count);
+    if (!res) {
+        std::stringstream ss;
+        ss  << "GC: allocation failed: could not allocate " << byte_count << " bytes " << std::endl
+            << "    for a large object" << std::endl;
+        error(ss.str());
+        throw SsiError();
     }
-    
-    // scan each node in each object free-list, evict free objects to middle-end
+    return res;
+}
+void GcFrontEnd::deallocate_slow_path(SizeClassIndex sci) {
+    // too many free objects cached: returning the most recently freed to the transfer cache, keeping 
+    // enough for the next allocations.
+    FreeObjectChain chain = m_sub_allocators[sci].take_free_objects(objects_per_move(sci));
+    m_middle_end->return_object_chain(sci, chain);
+}
+void GcFrontEnd::return_all_to_middle_end() {
     for (SizeClassIndex sci = 1; sci < kSizeClassesCount; sci++) {
-        ObjectFreeList& fl = m_sub_allocators[sci].object_free_list();
-        ObjectFreeList::Iterator pred = fl.before_begin();
-        ObjectFreeList::Iterator node = fl.begin();
-        while (node != fl.end()) {
-            // try returning objects to the middle-end:
-            // - does not lock if insufficient memory.
-            // - performs as many returns as possible at once.
-            try_return_free_list_node_to_middle_end(sci, pred, node);
-
-            // preparing for the next iteration or termination:
-            pred = node;
-            ++node;
-        }
-    }
-
-    // ask middle-end to trim unused pages, returning them to back-end
-    // for subsequent allocations
-    m_middle_end->trim_unused_pages();
-}
-void GcFrontEnd::try_return_free_list_node_to_middle_end(
-    SizeClassIndex sci,
-    ObjectFreeList::Iterator fl_node_pred,
-    ObjectFreeList::Iterator fl_node
-) {
-    size_t const num_to_move = kSizeClasses[sci].num_to_move;
-    if (fl_node->count >= num_to_move) {
-        size_t const object_size = kSizeClasses[sci].size;
-    
-        // returning these free objects to the transfer cache, resizing or deleting this free-list node:
-        size_t const rem_objects = fl_node->count % num_to_move;
-        size_t const returned_objects_count = (fl_node->count / num_to_move) * num_to_move;
-        size_t const returned_objects_size_in_bytes = returned_objects_count * object_size;
-        size_t const returned_objects_size_in_ablks = returned_objects_size_in_bytes / sizeof(ABlk);
-        APtr const returned_objects_ptr = fl_node->ptr;
-        if (rem_objects) {
-            // resize the free-list node
-            fl_node->count = rem_objects;
-            fl_node->ptr += returned_objects_size_in_ablks;
-        } else {
-            // free-list node capacity becomes 0: delete it
-            m_sub_allocators[sci].object_free_list().erase_after(fl_node_pred);
+        FrontEndObjectAllocator& sub_allocator = m_sub_allocators[sci];
+        ObjectSpan bump_span = sub_allocator.take_bump_span();
+        if (bump_span.count > 0) {
+            m_middle_end->return_object_span(sci, bump_span);
         }
-
-        // locking middle-end CentralObjectAllocator for this size-class to return object span:
-        m_middle_end->return_object_span(sci, {returned_objects_ptr, returned_objects_count});
+        m_middle_end->return_object_chain(sci, sub_allocator.take_free_objects(sub_allocator.free_count()));
     }
 }
 
@@ -0,0 +1,281 @@
+#include "ss-core/heap-profile.hh"
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <string_view>
+#include <chrono>
+
+#include "ss-core/profile.hh"
+#include "ss-core/intern.hh"
+
+namespace ss {
+
+    VmHeapProfile::VmHeapProfile(size_t period)
+    :   m_period(period),
+        m_mutex(),
+        m_sites(),
+        m_site_stats(),
+        m_site_index(),
+        m_live_samples(),
+        m_sample_count(0)
+    {}
+
+    size_t VmHeapProfile::SiteHash::operator() (Site const& site) const {
+        uint64_t h = static_cast<uint64_t>(site.exp) * 0x9e3779b97f4a7c15ull;
+        h ^= static_cast<uint64_t>(site.body) + 0x7f4a7c15ull + (h << 6) + (h >> 2);
+        h ^= (static_cast<uint64_t>(site.obj_kind) << 8 | site.sci) + (h << 6) + (h >> 2);
+        return static_cast<size_t>(h);
+    }
+    bool VmHeapProfile::SiteEqual::operator() (Site const& l, Site const& r) const {
+        return l.exp == r.exp && l.body == r.body && l.obj_kind == r.obj_kind && l.sci == r.sci;
+    }
+
+    //
+    // Sampling:
+    //
+
+    void VmHeapProfile::record(BaseBoxedObject* obj, size_t byte_count, VmExpID exp, VmExpID body, VmExpKind exp_kind) {
+        Site site{exp, body, exp_kind, obj->kind(), obj->gc_sci()};
+        double weight = sample_weight(byte_count);
+        std::lock_guard lg{m_mutex};
+        auto [it, is_new] = m_site_index.try_emplace(site, m_sites.size());
+        if (is_new) {
+            m_sites.push_back(site);
+            m_site_stats.emplace_back();
+        }
+        SiteStats& stats = m_site_stats[it->second];
+        stats.alloc_count += weight;
+        stats.alloc_bytes += weight * static_cast<double>(byte_count);
+        m_live_samples.push_back({obj, it->second, weight, byte_count, obj->gc_young(), false});
+        m_sample_count++;
+    }
+    // sample_weight is the number of allocations of `byte_count` that one sample stands for: cf
+    // `Gc::enable_heap_sampling`
+    double VmHeapProfile::sample_weight(size_t byte_count) const {
+        double p = 1.0 - std::exp(-static_cast<double>(byte_count) / static_cast<double>(m_period));
+        return (p > 0) ? 1.0 / p : 1.0;
+    }
+
+    //
+    // Collections:
+    //
+
+    void VmHeapProfile::sweep_young() {
+        std::lock_guard lg{m_mutex};
+        std::erase_if(m_live_samples, [this] (LiveSample& sample) {
+            if (!sample.is_young) {
+                return false;
+            }
+            BaseBoxedObject* copy = sample.obj->gc_forwarded();
+            if (!copy) {
+                return true;
+            }
+            sample.obj = copy;
+            sample.is_young = false;
+            sample.is_resolved = true;
+            SiteStats& stats = m_site_stats[sample.site_index];
+            stats.survived_count += sample.weight;
+            stats.survived_bytes += sample.weight * static_cast<double>(sample.byte_count);
+            return false;
+        });
+    }
+    void VmHeapProfile::sweep(gc::PageMap& page_map) {
+        std::lock_guard lg{m_mutex};
+        std::erase_if(m_live_samples, [this, &page_map] (LiveSample& sample) {
+            APtr ptr = reinterpret_cast<APtr>(sample.obj);
+            if (!page_map.contains(ptr) || !page_map.is_marked(ptr)) {
+                return true;
+            }
+            if (!sample.is_resolved) {
+                sample.is_resolved = true;
+                SiteStats& stats = m_site_stats[sample.site_index];
+                stats.survived_count += sample.weight;
+                stats.survived_bytes += sample.weight * static_cast<double>(sample.byte_count);
+            }
+            return false;
+        });
+    }
+
+    //
+    // Reporting: cf 'profile.proto' in github.com/google/pprof
+    //
+
+    namespace pprof {
+        // ProtoWriter encodes the fields of one protobuf message.
+        class ProtoWriter {
+        private:
+            std::string m_bytes;
+
+        public:
+            std::string const& bytes() const { return m_bytes; }
+
+            void write_varint(uint64_t v) {
+                while (v >= 0x80) {
+                    m_bytes.push_back(static_cast<char>((v & 0x7f) | 0x80));
+                    v >>= 7;
+                }
+                m_bytes.push_back(static_cast<char>(v));
+            }
+            void write_int(int field, int64_t v) {
+                if (v != 0) {
+                    write_varint(static_cast<uint64_t>(field) << 3);
+                    write_varint(static_cast<uint64_t>(v));
+                }
+            }
+            void write_bytes(int field, std::string_view bytes) {
+                write_varint(static_cast<uint64_t>(field) << 3 | 2);
+                write_varint(bytes.size());
+                m_bytes.append(bytes);
+            }
+            void write_message(int field, ProtoWriter const& message) {
+                write_bytes(field, message.bytes());
+            }
+            void append(ProtoWriter const& fields) {
+                m_bytes.append(fields.bytes());
+            }
+            void write_packed(int field, std::vector<int64_t> const& vs) {
+                ProtoWriter packed;
+                for (int64_t v: vs) {
+                    packed.write_varint(static_cast<uint64_t>(v));
+                }
+                write_message(field, packed);
+            }
+        };
+
+        // StringTable is a profile's string table: index 0 must be "".
+        class StringTable {
+        private:
+            std::vector<std::string> m_strings;
+            UnstableHashMap<std::string, int64_t> m_index;
+
+        public:
+            StringTable(): m_strings(), m_index() { id(""); }
+            std::vector<std::string> const& strings() const { return m_strings; }
+
+            int64_t id(std::string const& s) {
+                auto [it, is_new] = m_index.try_emplace(s, static_cast<int64_t>(m_strings.size()));
+                if (is_new) {
+                    m_strings.push_back(s);
+                }
+                return it->second;
+            }
+        };
+    }
+
+    void VmHeapProfile::write_pprof(std::ostream& out, VCode& code) {
+        std::lock_guard lg{m_mutex};
+        pprof::ProtoWriter profile;
+        pprof::StringTable strings;
+
+        // the values of each sample:
+        char const* value_types[][2] = {
+            {"alloc_objects", "count"}, {"alloc_space", "bytes"},
+            {"survived_objects", "count"}, {"survived_space", "bytes"},
+            {"inuse_objects", "count"}, {"inuse_space", "bytes"}
+        };
+        for (auto const& [type, unit]: value_types) {
+            pprof::ProtoWriter value_type;
+            value_type.write_int(1, strings.id(type));
+            value_type.write_int(2, strings.id(unit));
+            profile.write_message(1, value_type);
+        }
+        std::vector<double> inuse_counts(m_sites.size(), 0.0);
+        std::vector<double> inuse_bytes(m_sites.size(), 0.0);
+        for (LiveSample const& sample: m_live_samples) {
+            inuse_counts[sample.site_index] += sample.weight;
+            inuse_bytes[sample.site_index] += sample.weight * static_cast<double>(sample.byte_count);
+        }
+
+        // a function for each body, and for each kind of instruction, and a location for each site:
+        UnstableHashMap<std::string, int64_t> function_ids;
+        std::vector<std::pair<std::string, FLoc const*>> functions;
+        auto function_id = [&] (std::string const& name, FLoc const* loc) {
+            auto [it, is_new] = function_ids.try_emplace(name, static_cast<int64_t>(functions.size() + 1));
+            if (is_new) {
+                functions.emplace_back(name, loc);
+            }
+            return it->second;
+        };
+        std::map<std::pair<VmExpID, VmExpID>, int64_t> location_ids;
+        pprof::ProtoWriter locations;
+        auto location_id = [&] (Site const& site) {
+            auto [it, is_new] = location_ids.try_emplace({site.exp, site.body}, static_cast<int64_t>(location_ids.size() + 1));
+            if (is_new) {
+                pprof::ProtoWriter location;
+                location.write_int(1, it->second);
+                location.write_int(3, site.exp >= 0 ? site.exp : 0);
+                // the instruction, inlined in its body:
+                if (site.exp >= 0) {
+                    pprof::ProtoWriter line;
+                    line.write_int(1, function_id(vmx_kind_name(site.exp_kind), nullptr));
+                    location.write_message(4, line);
+                }
+                FLoc const* loc = (site.body >= 0) ? code.closure_loc(site.body) : nullptr;
+                pprof::ProtoWriter body_line;
+                body_line.write_int(1, function_id(site.body == RUNTIME_BODY ? "<run-time>" : closure_name(code, site.body), loc));
+                if (loc) {
+                    body_line.write_int(2, loc->span.first_pos.line_index + 1);
+                }
+                location.write_message(4, body_line);
+                locations.write_message(4, location);
+            }
+            return it->second;
+        };
+
+        for (size_t i = 0; i < m_sites.size(); i++) {
+            Site const& site = m_sites[i];
+            SiteStats const& stats = m_site_stats[i];
+            pprof::ProtoWriter sample;
+            sample.write_packed(1, {location_id(site)});
+            sample.write_packed(2, {
+                std::llround(stats.alloc_count), std::llround(stats.alloc_bytes),
+                std::llround(stats.survived_count), std::llround(stats.survived_bytes),
+                std::llround(inuse_counts[i]), std::llround(inuse_bytes[i])
+            });
+            pprof::ProtoWriter kind_label;
+            kind_label.write_int(1, strings.id("kind"));
+            kind_label.write_int(2, strings.id(obj_kind_name(site.obj_kind)));
+            sample.write_message(3, kind_label);
+            if (site.sci != gc::OVERSIZED_SCI) {
+                pprof::ProtoWriter size_label;
+                size_label.write_int(1, strings.id("bytes"));
+                size_label.write_int(3, static_cast<int64_t>(gc::kSizeClasses[site.sci].size));
+                sample.write_message(3, size_label);
+            }
+            profile.write_message(2, sample);
+        }
+        // locations refer to functions, so they are written once every function is named:
+        profile.append(locations);
+        for (size_t i = 0; i < functions.size(); i++) {
+            auto const& [name, loc] = functions[i];
+            pprof::ProtoWriter function;
+            function.write_int(1, static_cast<int64_t>(i + 1));
+            function.write_int(2, strings.id(name));
+            function.write_int(3, strings.id(name));
+            if (loc) {
+                function.write_int(4, strings.id(std::string{interned_string(loc->source)}));
+                function.write_int(5, loc->span.first_pos.line_index + 1);
+            }
+            profile.write_message(5, function);
+        }
+
+        // the string table is written last, once complete:
+        int64_t period_type_id = strings.id("space");
+        int64_t bytes_id = strings.id("bytes");
+        int64_t default_sample_type_id = strings.id("inuse_space");
+        pprof::ProtoWriter period_type;
+        period_type.write_int(1, period_type_id);
+        period_type.write_int(2, bytes_id);
+        for (std::string const& s: strings.strings()) {
+            profile.write_bytes(6, s);
+        }
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        profile.write_int(9, std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+        profile.write_message(11, period_type);
+        profile.write_int(12, static_cast<int64_t>(m_period));
+        profile.write_int(14, default_sample_type_id);
+        out.write(profile.bytes().data(), static_cast<std::streamsize>(profile.bytes().size()));
+    }
+
+}   // namespace ss
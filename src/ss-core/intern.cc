@@ -1,55 +1,139 @@
 #include "ss-core/intern.hh"
-#include <map>
-#include <vector>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+#include <mutex>
+#include <shared_mutex>
+#include "ss-core/common.hh"
+#include "ss-core/feedback.hh"
 
 namespace ss {
 
-    static std::map<std::string, IntStr> s_intern_map;
-    static std::vector<std::string>      s_string_map;
-    static IdCache* s_id_cache = nullptr;
-
-    IntStr intern(std::string s) {
-        IntStr new_int_str = s_string_map.size();
-        auto insert_rec = s_intern_map.insert({s, new_int_str});
-        if (insert_rec.second) {
-            // insertion successful => this is a new entry in the intern map => update `s_string_map`
-            s_string_map.push_back(s);
-            return new_int_str;
-        } else {
-            // insertion failed => an old entry exists => query existing interned string ID
-            return insert_rec.first->second;
+    // the interner is shared by every thread, e.g. by the front-end's parser threads:
+    // - interned strings are copied into a bump arena that is never freed, so the views returned by 
+    //   `interned_string` (and those that key the shards) are stable.
+    // - lookups by string go to one of `SHARD_COUNT` hash tables picked by the string's hash: most identifiers
+    //   are already interned, so a lookup only takes its shard's shared lock.
+    // - lookups by ID take no lock: IDs index a table of fixed-size segments that never move.
+
+    static constexpr size_t SHARD_COUNT = 16;
+    static constexpr size_t ARENA_BLOCK_SIZE = 64 << 10;
+    static constexpr size_t SEGMENT_SIZE_LOG2 = 12;
+    static constexpr size_t SEGMENT_SIZE = 1 << SEGMENT_SIZE_LOG2;
+    static constexpr size_t SEGMENT_COUNT = 1 << 12;
+
+    struct InternShard {
+        std::shared_mutex                           mutex;
+        UnstableHashMap<std::string_view, IntStr>   ids;
+    };
+    static std::array<InternShard, SHARD_COUNT> s_intern_shards;
+
+    // the arena and the segments are only written while `s_new_string_mutex` is held:
+    static std::mutex                                               s_new_string_mutex;
+    static char*                                                    s_arena_cursor = nullptr;
+    static char*                                                    s_arena_end = nullptr;
+    static IntStr                                                   s_string_count = 0;
+    static std::array<std::atomic<std::string_view*>, SEGMENT_COUNT> s_string_segments;
+
+    static char const* copy_to_arena(std::string_view s) {
+        // NUL-terminated so that the bytes may also be used as a C string.
+        size_t size = s.size() + 1;
+        if (size > ARENA_BLOCK_SIZE / 4) {
+            // long strings get a block of their own, so that the current block is not wasted.
+            auto bytes = static_cast<char*>(std::malloc(size));
+            std::memcpy(bytes, s.data(), s.size());
+            bytes[s.size()] = '\0';
+            return bytes;
+        }
+        if (static_cast<size_t>(s_arena_end - s_arena_cursor) < size) {
+            s_arena_cursor = static_cast<char*>(std::malloc(ARENA_BLOCK_SIZE));
+            s_arena_end = s_arena_cursor + ARENA_BLOCK_SIZE;
+        }
+        char* bytes = s_arena_cursor;
+        std::memcpy(bytes, s.data(), s.size());
+        bytes[s.size()] = '\0';
+        s_arena_cursor += size;
+        return bytes;
+    }
+    static IntStr new_interned_string(std::string_view s, std::string_view* out_stable_s) {
+        std::lock_guard lock{s_new_string_mutex};
+        size_t segment_index = s_string_count >> SEGMENT_SIZE_LOG2;
+        if (segment_index >= SEGMENT_COUNT) {
+            std::stringstream ss;
+            ss << "Too many interned strings: at most " << SEGMENT_COUNT * SEGMENT_SIZE << " are supported";
+            error(ss.str());
+            throw SsiError();
+        }
+        std::string_view stable_s{copy_to_arena(s), s.size()};
+        IntStr new_int_str = s_string_count++;
+
+        std::string_view* segment = s_string_segments[segment_index].load(std::memory_order_relaxed);
+        if (segment == nullptr) {
+            segment = new std::string_view[SEGMENT_SIZE];
+            s_string_segments[segment_index].store(segment, std::memory_order_release);
+        }
+        segment[new_int_str & (SEGMENT_SIZE - 1)] = stable_s;
+
+        *out_stable_s = stable_s;
+        return new_int_str;
+    }
+
+    IntStr intern(std::string_view s) {
+        InternShard& shard = s_intern_shards[robin_hood::hash<std::string_view>{}(s) % SHARD_COUNT];
+        {
+            std::shared_lock lock{shard.mutex};
+            auto it = shard.ids.find(s);
+            if (it != shard.ids.end()) {
+                return it->second;
+            }
+        }
+        std::unique_lock lock{shard.mutex};
+        auto it = shard.ids.find(s);
+        if (it != shard.ids.end()) {
+            // another thread interned this string since the lookup above
+            return it->second;
         }
+        std::string_view stable_s;
+        IntStr new_int_str = new_interned_string(s, &stable_s);
+        shard.ids.insert({stable_s, new_int_str});
+        return new_int_str;
     }
 
-    std::string const& interned_string(IntStr int_str) {
-        return s_string_map[int_str];
+    std::string_view interned_string(IntStr int_str) {
+        // an ID is only handed out after its entry is written, so whoever holds it may read the entry.
+        std::string_view const* segment = s_string_segments[int_str >> SEGMENT_SIZE_LOG2].load(std::memory_order_acquire);
+        return segment[int_str & (SEGMENT_SIZE - 1)];
     }
 
+    static IdCache const* new_id_cache() {
+        IdCache init {
+            .quote = intern("quote"),
+            .lambda = intern("lambda"),
+            .if_ = intern("if"),
+            .set = intern("set!"),
+            .call_cc = intern("call/cc"),
+            .define = intern("define"),
+            .p_invoke = intern("p/invoke"),
+            .begin = intern("begin"),
+            .define_syntax = intern("define-syntax"),
+            .ellipses = intern("..."),
+            .underscore = intern("_"),
+            .reference = intern("scheme::private::reference"),
+            .local = intern("local"),
+            .free = intern("free"),
+            .global = intern("global"),
+            .mutation = intern("scheme::private::mutation"),
+            .expanded_lambda = intern("scheme::private::expanded-lambda"),
+            .expanded_define = intern("scheme::private::expanded-define"),
+            .expanded_p_invoke = intern("scheme::private::expanded-p/invoke")
+        };
+        return new IdCache(init);
+    }
     IdCache const& g_id_cache() {
-        if (s_id_cache == nullptr) {
-            IdCache init {
-                .quote = intern("quote"),
-                .lambda = intern("lambda"),
-                .if_ = intern("if"),
-                .set = intern("set!"),
-                .call_cc = intern("call/cc"),
-                .define = intern("define"),
-                .p_invoke = intern("p/invoke"),
-                .begin = intern("begin"),
-                .define_syntax = intern("define-syntax"),
-                .ellipses = intern("..."),
-                .underscore = intern("_"),
-                .reference = intern("scheme::private::reference"),
-                .local = intern("local"),
-                .free = intern("free"),
-                .global = intern("global"),
-                .mutation = intern("scheme::private::mutation"),
-                .expanded_lambda = intern("scheme::private::expanded-lambda"),
-                .expanded_define = intern("scheme::private::expanded-define"),
-                .expanded_p_invoke = intern("scheme::private::expanded-p/invoke")
-            };
-            s_id_cache = new IdCache(init);
-        }
+        // initialized exactly once, even if first used by several threads at once:
+        static IdCache const* s_id_cache = new_id_cache();
         return *s_id_cache;
     }
 
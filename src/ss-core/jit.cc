@@ -0,0 +1,749 @@
+#include "ss-core/jit.hh"
+
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+#include "ss-core/memory.hh"
+
+namespace ss {
+
+    // native code polls collection flags with a plain byte load:
+    static_assert(sizeof(std::atomic<bool>) == 1 && std::atomic<bool>::is_always_lock_free);
+
+#if VJIT_X86_64
+    namespace {
+
+        ///
+        // X64Emitter: encodes the few x86-64 instructions the templates use.
+        // - every memory operand is `[base + disp32]` or `[base + index*8 + disp32]`.
+        // - labels are bound once, and branches to them are patched in by `finish`.
+        //
+
+        enum Reg: uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+        enum Cond: uint8_t { CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+        enum AluOp: uint8_t { ALU_ADD = 0x01, ALU_OR = 0x09, ALU_AND = 0x21, ALU_SUB = 0x29, ALU_CMP = 0x39, ALU_TEST = 0x85 };
+        enum AluExt: uint8_t { EXT_ADD = 0, EXT_OR = 1, EXT_AND = 4, EXT_SUB = 5, EXT_CMP = 7 };
+        enum ShiftExt: uint8_t { EXT_SHL = 4, EXT_SAR = 7 };
+
+        struct Mem {
+            Reg base;
+            int32_t disp;
+            bool has_index = false;
+            Reg index = RAX;
+        };
+        inline Mem at(Reg base, ssize_t disp) { return {base, static_cast<int32_t>(disp)}; }
+        inline Mem at(Reg base, Reg index, ssize_t disp) { return {base, static_cast<int32_t>(disp), true, index}; }
+
+        using Label = size_t;
+
+        class X64Emitter {
+        private:
+            std::vector<uint8_t> m_bytes;
+            std::vector<ssize_t> m_label_offsets;                   // -1 until bound
+            std::vector<std::pair<size_t, Label>> m_fixups;         // the offset of each branch's rel32
+
+        public:
+            Label new_label() { m_label_offsets.push_back(-1); return m_label_offsets.size() - 1; }
+            void bind(Label label) { m_label_offsets[label] = static_cast<ssize_t>(m_bytes.size()); }
+            bool is_bound(Label label) const { return m_label_offsets[label] >= 0; }
+            size_t offset() const { return m_bytes.size(); }
+
+            // finish patches every branch, returning the code.
+            std::vector<uint8_t> const& finish() {
+                for (auto [at_offset, label]: m_fixups) {
+                    int32_t rel = static_cast<int32_t>(m_label_offsets[label] - static_cast<ssize_t>(at_offset + 4));
+                    std::memcpy(&m_bytes[at_offset], &rel, 4);
+                }
+                m_fixups.clear();
+                return m_bytes;
+            }
+
+        public:
+            void load(Reg dst, Mem m) { rex(true, dst, m); byte(0x8B); modrm(dst, m); }
+            void store(Mem m, Reg src) { rex(true, src, m); byte(0x89); modrm(src, m); }
+            void lea(Reg dst, Mem m) { rex(true, dst, m); byte(0x8D); modrm(dst, m); }
+            void cmp(Reg lt, Mem rt) { rex(true, lt, rt); byte(0x3B); modrm(lt, rt); }
+            void cmp_byte(Mem m, uint8_t imm) { rex(false, RAX, m); byte(0x80); modrm(EXT_CMP, m); byte(imm); }
+            void mov(Reg dst, Reg src) { alu(static_cast<AluOp>(0x89), dst, src); }
+            void mov(Reg dst, uint64_t imm) { rex(true, RAX, dst); byte(0xB8 | (dst & 7)); word(imm, 8); }
+            void alu(AluOp op, Reg dst, Reg src) { rex(true, src, dst); byte(op); modrm_rr(src, dst); }
+            void alu(AluExt ext, Reg dst, int32_t imm) { rex(true, RAX, dst); byte(0x81); modrm_rr(ext, dst); word(imm, 4); }
+            void test(Reg dst, int32_t imm) { rex(true, RAX, dst); byte(0xF7); modrm_rr(0, dst); word(imm, 4); }
+            void shift(ShiftExt ext, Reg dst, uint8_t imm) { rex(true, RAX, dst); byte(0xC1); modrm_rr(ext, dst); byte(imm); }
+            void imul(Reg dst, Reg src) { rex(true, dst, src); byte(0x0F); byte(0xAF); modrm_rr(dst, src); }
+            void cmov(Cond cc, Reg dst, Reg src) { rex(true, dst, src); byte(0x0F); byte(0x40 | cc); modrm_rr(dst, src); }
+            void push(Reg r) { if (r >= R8) { byte(0x41); } byte(0x50 | (r & 7)); }
+            void pop(Reg r) { if (r >= R8) { byte(0x41); } byte(0x58 | (r & 7)); }
+            void ret() { byte(0xC3); }
+            void jmp(Label label) { byte(0xE9); fixup(label); }
+            void jcc(Cond cc, Label label) { byte(0x0F); byte(0x80 | cc); fixup(label); }
+
+        private:
+            void byte(uint8_t b) { m_bytes.push_back(b); }
+            void word(uint64_t w, size_t byte_count) {
+                for (size_t i = 0; i < byte_count; i++) {
+                    byte(static_cast<uint8_t>(w >> (8 * i)));
+                }
+            }
+            void fixup(Label label) { m_fixups.emplace_back(m_bytes.size(), label); word(0, 4); }
+            void rex(bool w, uint8_t reg, uint8_t rm) {
+                byte(0x40 | (w << 3) | ((reg >> 3) << 2) | (rm >> 3));
+            }
+            void rex(bool w, uint8_t reg, Mem m) {
+                byte(0x40 | (w << 3) | ((reg >> 3) << 2) | ((m.has_index ? (m.index >> 3) : 0) << 1) | (m.base >> 3));
+            }
+            void modrm_rr(uint8_t reg, uint8_t rm) { byte(0xC0 | ((reg & 7) << 3) | (rm & 7)); }
+            void modrm(uint8_t reg, Mem m) {
+                // always 'mod=10', i.e. a 32-bit displacement: RSP and R12 as bases need a SIB byte.
+                if (m.has_index) {
+                    byte(0x80 | ((reg & 7) << 3) | 4);
+                    byte(0xC0 | ((m.index & 7) << 3) | (m.base & 7));
+                } else if ((m.base & 7) == 4) {
+                    byte(0x80 | ((reg & 7) << 3) | 4);
+                    byte(0x24);
+                } else {
+                    byte(0x80 | ((reg & 7) << 3) | (m.base & 7));
+                }
+                word(static_cast<uint32_t>(m.disp), 4);
+            }
+        };
+
+        ///
+        // JitTranslator: translates one closure body.
+        // - registers: a, f, c, s are in R12, R13, R14, and R15; RBX points at the JitFrame, and RBP at the
+        //   stack's items. Native code makes no calls, so the caller-saved registers are free: R8 and R9 hold
+        //   #f and #t, and RAX, RCX, RDX are scratch.
+        // - VmExps are laid out in chains, like `VBytecode::lower`: each is followed by its primary successor
+        //   where possible, and branches to the others.
+        // - an exit to `pc` stores the registers back into the frame and returns `pc`: each exit branches to
+        //   a stub shared by the exits to one pc, placed after the code.
+        //
+
+    #ifdef _WIN32
+        constexpr Reg ARG_REG = RCX;
+    #else
+        constexpr Reg ARG_REG = RDI;
+    #endif
+        constexpr Reg REG_A = R12;
+        constexpr Reg REG_F = R13;
+        constexpr Reg REG_C = R14;
+        constexpr Reg REG_S = R15;
+        constexpr Reg REG_FRAME = RBX;
+        constexpr Reg REG_ITEMS = RBP;
+        constexpr Reg REG_FALSE = R8;
+        constexpr Reg REG_TRUE = R9;
+
+        constexpr ssize_t MAX_SHIFTED_ARG_COUNT = 16;         // shifts are unrolled
+        constexpr size_t MIN_TRANSLATED_COUNT_PER_EXIT = 8;
+
+        class JitTranslator {
+        private:
+            VCode& m_code;
+            VBytecode& m_bytecode;
+            VmExpID m_body;
+            X64Emitter m_x;
+            robin_hood::unordered_flat_map<VmExpID, Label> m_labels;        // of translated VmExps
+            std::vector<VmExpID> m_chain_heads;
+            std::vector<std::pair<VmCodePtr, Label>> m_exits;
+            robin_hood::unordered_flat_map<VmCodePtr, Label> m_exit_labels;
+            std::vector<VmExpID> m_entries;                                  // the body, then return points
+            Label m_return_dispatch;
+            Label m_epilogue;
+            bool m_has_self_call;
+            size_t m_translated_count;
+            size_t m_untranslated_count;                                     // reached, i.e. exits
+
+        public:
+            JitTranslator(VCode& code, VBytecode& bytecode, VmExpID body)
+            :   m_code(code),
+                m_bytecode(bytecode),
+                m_body(body),
+                m_x(),
+                m_labels(),
+                m_chain_heads(),
+                m_exits(),
+                m_exit_labels(),
+                m_entries{body},
+                m_return_dispatch(m_x.new_label()),
+                m_epilogue(m_x.new_label()),
+                m_has_self_call(false),
+                m_translated_count(0),
+                m_untranslated_count(0)
+            {}
+
+        public:
+            // translates(x) is true iff `x` has a template here: else, it is an exit.
+            bool translates(VmExpID x) const {
+                if (x < 0 || vmx_unit(x) != vmx_unit(m_body)) {
+                    return false;
+                }
+                VmExp const& exp = m_code[x];
+                switch (exp.kind) {
+                    case VmExpKind::ReferLocal:
+                    case VmExpKind::ReferFree:
+                    case VmExpKind::ReferGlobal:
+                    case VmExpKind::Indirect:
+                    case VmExpKind::Constant:
+                    case VmExpKind::Test:
+                    case VmExpKind::AssignGlobal:
+                    case VmExpKind::AssignLocalUnboxed:
+                    case VmExpKind::Frame:
+                    case VmExpKind::Argument:
+                    case VmExpKind::Return:
+                    case VmExpKind::ReferLocalPush:
+                    case VmExpKind::ReferFreePush:
+                    case VmExpKind::ReferGlobalPush:
+                    case VmExpKind::ConstantPush:
+                    case VmExpKind::PrimAdd:
+                    case VmExpKind::PrimSub:
+                    case VmExpKind::PrimMul:
+                    case VmExpKind::PrimEq:
+                    case VmExpKind::PrimLt:
+                    case VmExpKind::PrimGt:
+                    case VmExpKind::PrimLe:
+                    case VmExpKind::PrimGe:
+                    case VmExpKind::PrimCar:
+                    case VmExpKind::PrimCdr:
+                    case VmExpKind::PrimIsNull:
+                    case VmExpKind::PrimIsPair:
+                        return true;
+                    case VmExpKind::CallGlobal:
+                    case VmExpKind::ShiftCallGlobal:
+                    case VmExpKind::SelfTailCall:
+                        // only calls of the body itself stay in native code.
+                        return exp.args.i_call_global.body == m_body && exp.args.i_call_global.n <= MAX_SHIFTED_ARG_COUNT;
+                    default:
+                        return false;
+                }
+            }
+
+            // translate emits the code for every VmExp reachable from the body, returning the code and the
+            // offset of each entry's prologue, in the order of `entries()`.
+            std::vector<uint8_t> const& translate(std::vector<size_t>& entry_offsets) {
+                m_chain_heads.push_back(m_body);
+                label_of(m_body);
+                while (!m_chain_heads.empty()) {
+                    VmExpID x = m_chain_heads.back();
+                    m_chain_heads.pop_back();
+                    if (!m_x.is_bound(m_labels[x])) {
+                        translate_chain(x);
+                    }
+                }
+                emit_return_dispatch();
+                emit_exits();
+                emit_epilogue();
+                for (VmExpID entry: m_entries) {
+                    entry_offsets.push_back(m_x.offset());
+                    emit_prologue(m_labels[entry]);
+                }
+                return m_x.finish();
+            }
+            std::vector<VmExpID> const& entries() const { return m_entries; }
+            // is_worth_it is true if the body loops in native code, i.e. calls itself, without leaving it
+            // too often: each exit and re-entry costs about as much as interpreting a few instructions.
+            bool is_worth_it() const {
+                return m_has_self_call && m_untranslated_count * MIN_TRANSLATED_COUNT_PER_EXIT <= m_translated_count;
+            }
+
+        private:
+            VmCodePtr pc_of(VmExpID x) { return m_bytecode.entry(x); }
+            Label label_of(VmExpID x) {
+                auto it = m_labels.find(x);
+                if (it != m_labels.end()) {
+                    return it->second;
+                }
+                Label label = m_x.new_label();
+                m_labels.insert({x, label});
+                m_chain_heads.push_back(x);
+                return label;
+            }
+            Label exit_label(VmCodePtr pc) {
+                auto it = m_exit_labels.find(pc);
+                if (it != m_exit_labels.end()) {
+                    return it->second;
+                }
+                Label label = m_x.new_label();
+                m_exit_labels.insert({pc, label});
+                m_exits.emplace_back(pc, label);
+                return label;
+            }
+            // target is where a branch to `x` goes.
+            Label target(VmExpID x) {
+                return translates(x) ? label_of(x) : untranslated(x);
+            }
+            Label untranslated(VmExpID x) {
+                VmCodePtr pc = pc_of(x);
+                if (m_exit_labels.find(pc) == m_exit_labels.end()) {
+                    m_untranslated_count++;
+                }
+                return exit_label(pc);
+            }
+
+            void translate_chain(VmExpID x) {
+                for (;;) {
+                    Label label = label_of(x);
+                    if (m_x.is_bound(label)) {
+                        m_x.jmp(label);
+                        return;
+                    }
+                    m_x.bind(label);
+                    m_translated_count++;
+                    VmExpID next = translate_one(x);
+                    if (next < 0) {
+                        return;
+                    }
+                    if (!translates(next)) {
+                        m_x.jmp(untranslated(next));
+                        return;
+                    }
+                    x = next;
+                }
+            }
+
+            // translate_one emits the template of `x`, returning its primary successor, or -1 if it has none.
+            VmExpID translate_one(VmExpID x) {
+                VmExp const& exp = m_code[x];
+                auto side_exit = [this, x] () { return exit_label(pc_of(x)); };
+                switch (exp.kind) {
+                    case VmExpKind::ReferLocal: {
+                        emit_refer_local(exp.args.i_refer.n);
+                        return exp.args.i_refer.x;
+                    }
+                    case VmExpKind::ReferFree: {
+                        emit_refer_free(exp.args.i_refer.n);
+                        return exp.args.i_refer.x;
+                    }
+                    case VmExpKind::ReferGlobal: {
+                        emit_refer_global(exp.args.i_refer.n);
+                        return exp.args.i_refer.x;
+                    }
+                    case VmExpKind::Constant: {
+                        m_x.mov(REG_A, static_cast<uint64_t>(exp.args.i_constant.obj.as_raw()));
+                        return exp.args.i_constant.x;
+                    }
+                    case VmExpKind::ReferLocalPush: {
+                        emit_check_push(1, side_exit());
+                        emit_refer_local(exp.args.i_refer.n);
+                        emit_push(REG_A);
+                        return exp.args.i_refer.x;
+                    }
+                    case VmExpKind::ReferFreePush: {
+                        emit_check_push(1, side_exit());
+                        emit_refer_free(exp.args.i_refer.n);
+                        emit_push(REG_A);
+                        return exp.args.i_refer.x;
+                    }
+                    case VmExpKind::ReferGlobalPush: {
+                        emit_check_push(1, side_exit());
+                        emit_refer_global(exp.args.i_refer.n);
+                        emit_push(REG_A);
+                        return exp.args.i_refer.x;
+                    }
+                    case VmExpKind::ConstantPush: {
+                        emit_check_push(1, side_exit());
+                        m_x.mov(REG_A, static_cast<uint64_t>(exp.args.i_constant.obj.as_raw()));
+                        emit_push(REG_A);
+                        return exp.args.i_constant.x;
+                    }
+                    case VmExpKind::Argument: {
+                        emit_check_push(1, side_exit());
+                        emit_push(REG_A);
+                        return exp.args.i_argument.x;
+                    }
+                    case VmExpKind::Indirect: {
+                        emit_check_kind(REG_A, ObjectKind::Box, side_exit());
+                        m_x.load(REG_A, at(REG_A, BoxObject::boxed_offset()));
+                        return exp.args.i_indirect.x;
+                    }
+                    case VmExpKind::Test: {
+                        m_x.alu(ALU_CMP, REG_A, REG_FALSE);
+                        m_x.jcc(CC_E, target(exp.args.i_test.next_if_f));
+                        return exp.args.i_test.next_if_t;
+                    }
+                    case VmExpKind::AssignGlobal: {
+                        m_x.load(RAX, at(REG_FRAME, offsetof(JitFrame, globals)));
+                        m_x.store(at(RAX, 8 * exp.args.i_assign.n), REG_A);
+                        return exp.args.i_assign.x;
+                    }
+                    case VmExpKind::AssignLocalUnboxed: {
+                        // cf `VmStack::index_set`: stores below the captured height must lower it, so they exit.
+                        ssize_t n = static_cast<ssize_t>(exp.args.i_assign.n);
+                        m_x.lea(RAX, at(REG_F, -(n + 1)));
+                        m_x.cmp(RAX, at(REG_FRAME, offsetof(JitFrame, stack_captured_height)));
+                        m_x.jcc(CC_L, side_exit());
+                        m_x.store(at(REG_ITEMS, REG_F, -8 * (n + 1)), REG_A);
+                        return exp.args.i_assign.x;
+                    }
+                    case VmExpKind::Frame: {
+                        // first (c, f, ret) last: the return address is that of the return point's word, which is
+                        // also an entry.
+                        VmExpID ret_x = exp.args.i_frame.post_ret_x;
+                        if (translates(ret_x) && m_labels.find(ret_x) == m_labels.end()) {
+                            m_entries.push_back(ret_x);
+                            label_of(ret_x);
+                        }
+                        emit_check_push(3, side_exit());
+                        m_x.store(at(REG_ITEMS, REG_S, 0), REG_C);
+                        m_x.mov(RAX, REG_F);
+                        m_x.shift(EXT_SHL, RAX, OBJECT::FIXNUM_TAG_BITS);
+                        m_x.alu(EXT_OR, RAX, OBJECT::FIXNUM_TAG);
+                        m_x.store(at(REG_ITEMS, REG_S, 8), RAX);
+                        VmWord ret_word = reinterpret_cast<VmWord>(pc_of(ret_x));
+                        m_x.mov(RAX, static_cast<uint64_t>(OBJECT::make_integer(static_cast<ssize_t>(ret_word)).as_raw()));
+                        m_x.store(at(REG_ITEMS, REG_S, 16), RAX);
+                        m_x.alu(EXT_ADD, REG_S, 3);
+                        return exp.args.i_frame.fn_body_x;
+                    }
+                    case VmExpKind::Return: {
+                        // cf `emit_return_dispatch`: the return address may be a return point of this body.
+                        ssize_t n = static_cast<ssize_t>(exp.args.i_return.n);
+                        if (n > 0) {
+                            m_x.alu(EXT_SUB, REG_S, static_cast<int32_t>(n));
+                        }
+                        m_x.load(RAX, at(REG_ITEMS, REG_S, -8));
+                        m_x.shift(EXT_SAR, RAX, OBJECT::FIXNUM_TAG_BITS);
+                        m_x.load(REG_F, at(REG_ITEMS, REG_S, -16));
+                        m_x.shift(EXT_SAR, REG_F, OBJECT::FIXNUM_TAG_BITS);
+                        m_x.load(REG_C, at(REG_ITEMS, REG_S, -24));
+                        m_x.alu(EXT_SUB, REG_S, 3);
+                        m_x.jmp(m_return_dispatch);
+                        return -1;
+                    }
+                    case VmExpKind::CallGlobal:
+                    case VmExpKind::ShiftCallGlobal:
+                    case VmExpKind::SelfTailCall: {
+                        // the collection flags are polled first, like the interpreter's safe-point: nothing has
+                        // changed yet if it exits.
+                        Label exit = side_exit();
+                        auto const& args = exp.args.i_call_global;
+                        m_x.load(RAX, at(REG_FRAME, offsetof(JitFrame, minor_collect_requested)));
+                        m_x.cmp_byte(at(RAX, 0), 0);
+                        m_x.jcc(CC_NE, exit);
+                        m_x.load(RAX, at(REG_FRAME, offsetof(JitFrame, sweep_requested)));
+                        m_x.cmp_byte(at(RAX, 0), 0);
+                        m_x.jcc(CC_NE, exit);
+                        if (exp.kind == VmExpKind::SelfTailCall) {
+                            emit_shift(args.n, args.n, exit);
+                        } else {
+                            if (exp.kind == VmExpKind::ShiftCallGlobal) {
+                                emit_shift(args.n, args.m, exit);
+                            }
+                            // cf 'do_call_known'
+                            emit_refer_global(args.gn);
+                            m_x.mov(REG_C, REG_A);
+                            m_x.mov(REG_F, REG_S);
+                        }
+                        m_has_self_call = true;
+                        m_x.jmp(label_of(m_body));
+                        return -1;
+                    }
+                    case VmExpKind::PrimAdd:
+                    case VmExpKind::PrimSub:
+                    case VmExpKind::PrimMul:
+                    case VmExpKind::PrimEq:
+                    case VmExpKind::PrimLt:
+                    case VmExpKind::PrimGt:
+                    case VmExpKind::PrimLe:
+                    case VmExpKind::PrimGe: {
+                        // fixnums are compared by their raw words, and added in place of their tags: like
+                        // `OBJECT::make_integer`, results wrap around.
+                        Label exit = side_exit();
+                        m_x.load(RAX, at(REG_ITEMS, REG_S, -8));
+                        emit_check_fixnum(REG_A, exit);
+                        emit_check_fixnum(RAX, exit);
+                        switch (exp.kind) {
+                            case VmExpKind::PrimAdd: {
+                                m_x.alu(ALU_ADD, REG_A, RAX);
+                                m_x.alu(EXT_SUB, REG_A, OBJECT::FIXNUM_TAG);
+                            } break;
+                            case VmExpKind::PrimSub: {
+                                m_x.alu(ALU_SUB, REG_A, RAX);
+                                m_x.alu(EXT_ADD, REG_A, OBJECT::FIXNUM_TAG);
+                            } break;
+                            case VmExpKind::PrimMul: {
+                                m_x.mov(RDX, REG_A);
+                                m_x.alu(EXT_SUB, RDX, OBJECT::FIXNUM_TAG);
+                                m_x.shift(EXT_SAR, RAX, OBJECT::FIXNUM_TAG_BITS);
+                                m_x.imul(RDX, RAX);
+                                m_x.alu(EXT_ADD, RDX, OBJECT::FIXNUM_TAG);
+                                m_x.mov(REG_A, RDX);
+                            } break;
+                            default: {
+                                m_x.alu(ALU_CMP, REG_A, RAX);
+                                m_x.mov(REG_A, REG_FALSE);
+                                m_x.cmov(compare_cond(exp.kind), REG_A, REG_TRUE);
+                            } break;
+                        }
+                        m_x.alu(EXT_SUB, REG_S, 1);
+                        return exp.args.i_prim.x;
+                    }
+                    case VmExpKind::PrimCar:
+                    case VmExpKind::PrimCdr: {
+                        emit_check_kind(REG_A, ObjectKind::Pair, side_exit());
+                        size_t offset = (exp.kind == VmExpKind::PrimCar) ? PairObject::car_offset() : PairObject::cdr_offset();
+                        m_x.load(REG_A, at(REG_A, offset));
+                        return exp.args.i_prim.x;
+                    }
+                    case VmExpKind::PrimIsNull: {
+                        m_x.alu(ALU_TEST, REG_A, REG_A);
+                        m_x.mov(REG_A, REG_FALSE);
+                        m_x.cmov(CC_E, REG_A, REG_TRUE);
+                        return exp.args.i_prim.x;
+                    }
+                    case VmExpKind::PrimIsPair: {
+                        Label done = m_x.new_label();
+                        m_x.mov(RAX, REG_A);
+                        m_x.mov(REG_A, REG_FALSE);
+                        emit_check_kind(RAX, ObjectKind::Pair, done);
+                        m_x.mov(REG_A, REG_TRUE);
+                        m_x.bind(done);
+                        return exp.args.i_prim.x;
+                    }
+                    default: {
+                        // cf `translates`: only reached for a call that is not translated.
+                        m_x.jmp(side_exit());
+                        return -1;
+                    }
+                }
+            }
+
+            void emit_refer_local(size_t n) {
+                m_x.load(REG_A, at(REG_ITEMS, REG_F, -8 * static_cast<ssize_t>(n + 1)));
+            }
+            void emit_refer_free(size_t n) {
+                m_x.load(REG_A, at(REG_C, sizeof(ClosureObject) + 8 * n));
+            }
+            void emit_refer_global(size_t n) {
+                m_x.load(RAX, at(REG_FRAME, offsetof(JitFrame, globals)));
+                m_x.load(REG_A, at(RAX, 8 * n));
+            }
+            // emit_check_push exits unless `count` items may be pushed without `VmStack::push_slow_path`.
+            void emit_check_push(ssize_t count, Label exit) {
+                m_x.cmp(REG_S, at(REG_FRAME, offsetof(JitFrame, stack_captured_height)));
+                m_x.jcc(CC_L, exit);
+                m_x.lea(RAX, at(REG_S, count));
+                m_x.cmp(RAX, at(REG_FRAME, offsetof(JitFrame, stack_limit)));
+                m_x.jcc(CC_G, exit);
+            }
+            void emit_push(Reg r) {
+                m_x.store(at(REG_ITEMS, REG_S, 0), r);
+                m_x.alu(EXT_ADD, REG_S, 1);
+            }
+            // emit_shift is `VmStack::shift`, but exits rather than lower the captured height.
+            void emit_shift(ssize_t n, ssize_t m, Label exit) {
+                if (n > 0) {
+                    m_x.lea(RAX, at(REG_S, -(n + m)));
+                    m_x.cmp(RAX, at(REG_FRAME, offsetof(JitFrame, stack_captured_height)));
+                    m_x.jcc(CC_L, exit);
+                    for (ssize_t k = 0; k < n; k++) {
+                        m_x.load(RDX, at(REG_ITEMS, REG_S, 8 * (k - n)));
+                        m_x.store(at(REG_ITEMS, REG_S, 8 * (k - n - m)), RDX);
+                    }
+                }
+                if (m > 0) {
+                    m_x.alu(EXT_SUB, REG_S, static_cast<int32_t>(m));
+                }
+            }
+            void emit_check_fixnum(Reg r, Label exit) {
+                m_x.mov(RDX, r);
+                m_x.alu(EXT_AND, RDX, (1 << OBJECT::FIXNUM_TAG_BITS) - 1);
+                m_x.alu(EXT_CMP, RDX, OBJECT::FIXNUM_TAG);
+                m_x.jcc(CC_NE, exit);
+            }
+            // emit_check_kind branches to `otherwise` unless `r` points at an object of `kind`, cf `OBJECT::is_ptr`.
+            void emit_check_kind(Reg r, ObjectKind kind, Label otherwise) {
+                m_x.alu(ALU_TEST, r, r);
+                m_x.jcc(CC_E, otherwise);
+                m_x.test(r, 0b111);
+                m_x.jcc(CC_NE, otherwise);
+                m_x.cmp_byte(at(r, BaseBoxedObject::kind_offset()), static_cast<uint8_t>(kind));
+                m_x.jcc(CC_NE, otherwise);
+            }
+            static Cond compare_cond(VmExpKind kind) {
+                switch (kind) {
+                    case VmExpKind::PrimEq: return CC_E;
+                    case VmExpKind::PrimLt: return CC_L;
+                    case VmExpKind::PrimGt: return CC_G;
+                    case VmExpKind::PrimLe: return CC_LE;
+                    default: return CC_GE;
+                }
+            }
+
+            // emit_return_dispatch jumps to the return point at RAX if it is one of this body's, as it is 
+            // when the body returns from a call of itself: else, the interpreter resumes there.
+            void emit_return_dispatch() {
+                m_x.bind(m_return_dispatch);
+                for (size_t i = 1; i < m_entries.size(); i++) {
+                    m_x.mov(RDX, static_cast<uint64_t>(reinterpret_cast<VmWord>(pc_of(m_entries[i]))));
+                    m_x.alu(ALU_CMP, RAX, RDX);
+                    m_x.jcc(CC_E, m_labels[m_entries[i]]);
+                }
+                m_x.jmp(m_epilogue);
+            }
+            void emit_exits() {
+                // exits may be added while they are emitted, so they are indexed:
+                for (size_t i = 0; i < m_exits.size(); i++) {
+                    auto [pc, label] = m_exits[i];
+                    m_x.bind(label);
+                    m_x.mov(RAX, static_cast<uint64_t>(reinterpret_cast<VmWord>(pc)));
+                    m_x.jmp(m_epilogue);
+                }
+            }
+            void emit_epilogue() {
+                m_x.bind(m_epilogue);
+                m_x.store(at(REG_FRAME, offsetof(JitFrame, a)), REG_A);
+                m_x.store(at(REG_FRAME, offsetof(JitFrame, f)), REG_F);
+                m_x.store(at(REG_FRAME, offsetof(JitFrame, c)), REG_C);
+                m_x.store(at(REG_FRAME, offsetof(JitFrame, s)), REG_S);
+                m_x.pop(R15);
+                m_x.pop(R14);
+                m_x.pop(R13);
+                m_x.pop(R12);
+                m_x.pop(RBP);
+                m_x.pop(RBX);
+                m_x.ret();
+            }
+            void emit_prologue(Label entry) {
+                // the callee-saved registers are saved: no calls are made, so the stack need not be aligned.
+                m_x.push(RBX);
+                m_x.push(RBP);
+                m_x.push(R12);
+                m_x.push(R13);
+                m_x.push(R14);
+                m_x.push(R15);
+                m_x.mov(REG_FRAME, ARG_REG);
+                m_x.load(REG_A, at(REG_FRAME, offsetof(JitFrame, a)));
+                m_x.load(REG_F, at(REG_FRAME, offsetof(JitFrame, f)));
+                m_x.load(REG_C, at(REG_FRAME, offsetof(JitFrame, c)));
+                m_x.load(REG_S, at(REG_FRAME, offsetof(JitFrame, s)));
+                m_x.load(REG_ITEMS, at(REG_FRAME, offsetof(JitFrame, stack_items)));
+                m_x.mov(REG_FALSE, static_cast<uint64_t>(OBJECT::make_boolean(false).as_raw()));
+                m_x.mov(REG_TRUE, static_cast<uint64_t>(OBJECT::make_boolean(true).as_raw()));
+                m_x.jmp(entry);
+            }
+        };
+
+    }
+#endif
+
+    ///
+    // VJit:
+    //
+
+    VJit::VJit(VCode* code, VBytecode* bytecode)
+    :   m_code(code),
+        m_bytecode(bytecode),
+        m_units(),
+        m_entries(),
+        m_code_byte_count(0),
+        m_compiled_body_count(0),
+        m_has_unthreaded_entries(false)
+    {}
+    VJit::~VJit() {
+        for (VCodeUnitID unit = 0; unit < m_units.size(); unit++) {
+            free_unit(unit);
+        }
+    }
+
+    VJit::Unit& VJit::counted_unit(VCodeUnitID unit) {
+        if (unit >= m_units.size()) {
+            m_units.resize(unit + 1);
+        }
+        if (!m_units[unit]) {
+            m_units[unit] = std::make_unique<Unit>();
+        }
+        // expressions may be appended to a unit after it was counted, cf `VBytecode::lowered_unit`:
+        Unit& u = *m_units[unit];
+        size_t exp_count = vmx_index(m_code->end_exp_id(unit));
+        if (u.call_counts.size() < exp_count) {
+            u.call_counts.resize(exp_count, 0);
+        }
+        return u;
+    }
+    bool VJit::count_first_call(VmExpID body) {
+        Unit& u = counted_unit(vmx_unit(body));
+        return ++u.call_counts[vmx_index(body)] == CONFIG_JIT_CALL_THRESHOLD;
+    }
+    void VJit::defer_call(VmExpID body) {
+        counted_unit(vmx_unit(body)).call_counts[vmx_index(body)] = 0;
+    }
+
+    bool VJit::compile(VmExpID body, void* enter_handler) {
+        Unit& u = counted_unit(vmx_unit(body));
+        if (find_entry(m_bytecode->entry(body))) {
+            return true;
+        }
+    #if VJIT_X86_64
+        JitTranslator translator{*m_code, *m_bytecode, body};
+        std::vector<size_t> entry_offsets;
+        std::vector<uint8_t> const* bytes = nullptr;
+        if (translator.translates(body)) {
+            bytes = &translator.translate(entry_offsets);
+        }
+        if (bytes && translator.is_worth_it()) {
+            size_t page_size = os_page_size();
+            size_t byte_count = (bytes->size() + page_size - 1) / page_size * page_size;
+            APtr mem = os_allocate_code_memory(byte_count);
+            if (mem) {
+                std::memcpy(mem, bytes->data(), bytes->size());
+                if (os_seal_code_memory(mem, byte_count)) {
+                    u.code.push_back({mem, byte_count});
+                    m_code_byte_count += byte_count;
+                    m_compiled_body_count++;
+                    std::vector<VmExpID> const& entries = translator.entries();
+                    for (size_t i = 0; i < entries.size(); i++) {
+                        VmCodePtr pc = m_bytecode->entry(entries[i]);
+                        JitCode code = reinterpret_cast<JitCode>(reinterpret_cast<uint8_t*>(mem) + entry_offsets[i]);
+                        m_entries.insert({pc, JitEntry{code, (*m_code)[entries[i]].kind}});
+                        u.entry_pcs.push_back(pc);
+                        if (enter_handler) {
+                            m_bytecode->thread_entry(pc, enter_handler);
+                        }
+                    }
+                    return true;
+                }
+                os_release_memory(mem, byte_count);
+            }
+        }
+    #else
+        SUPPRESS_UNUSED_VARIABLE_WARNING(enter_handler);
+    #endif
+        // counted past the threshold, so that it is not compiled again:
+        u.call_counts[vmx_index(body)] = CONFIG_JIT_CALL_THRESHOLD;
+        return false;
+    }
+
+    void VJit::install(VmExpID x, JitCode code) {
+        Unit& u = counted_unit(vmx_unit(x));
+        VmCodePtr pc = m_bytecode->entry(x);
+        if (m_entries.insert({pc, JitEntry{code, (*m_code)[x].kind}}).second) {
+            u.entry_pcs.push_back(pc);
+            m_has_unthreaded_entries = true;
+        }
+    }
+
+    void VJit::thread_entries(void* enter_handler) {
+        for (auto const& [pc, entry]: m_entries) {
+            m_bytecode->thread_entry(pc, enter_handler);
+        }
+        m_has_unthreaded_entries = false;
+    }
+
+    void VJit::free_unit(VCodeUnitID unit) {
+        if (unit >= m_units.size() || !m_units[unit]) {
+            return;
+        }
+        Unit& u = *m_units[unit];
+        for (VmCodePtr pc: u.entry_pcs) {
+            m_entries.erase(pc);
+        }
+        for (Code const& code: u.code) {
+            os_release_memory(code.mem, code.byte_count);
+            m_code_byte_count -= code.byte_count;
+            m_compiled_body_count--;
+        }
+        m_units[unit].reset();
+    }
+
+}   // namespace ss
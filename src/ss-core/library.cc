@@ -1,10 +1,26 @@
 #include "ss-core/library.hh"
 
 #include "ss-core/config.hh"
+#include "ss-core/memory.hh"
+#include "ss-core/vcode-cache.hh"
+#include "ss-core/parser.hh"
+#include "ss-core/expander.hh"
+#include "ss-core/compiler.hh"
+#include "ss-core/vm.hh"
+#include "ss-core/trace.hh"
 
 #include <filesystem>
+#include <fstream>
 #include <sstream>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
 #include <cassert>
 
 ///
@@ -17,6 +33,37 @@ namespace ss {
     static std::string const LIB_SUBDIR = "/lib";
     static std::string const SUBREPO_SUBDIR = "/subrepo";
     static std::string const BIN_SUBDIR = "/bin";
+    static std::string const INDEX_FILE = "/lib.index";
+
+    // file_mtime returns the last write time of the file at `path`, or `NO_SOURCE_MTIME` if there is none.
+    static int64_t file_mtime(std::string const& path) {
+        std::error_code ec;
+        auto mtime = std::filesystem::last_write_time(path, ec);
+        return ec ? BaseLibrary::Stamp::NO_SOURCE_MTIME : static_cast<int64_t>(mtime.time_since_epoch().count());
+    }
+
+    // has_up_to_date_artifact returns whether `library` is unchanged since it was last precompiled, and its
+    // artifact is still there to be loaded.
+    static bool has_up_to_date_artifact(BaseLibrary* library) {
+        if (library->validate() == BaseLibrary::Validation::Missing) {
+            return false;
+        }
+        BaseLibrary::Stamp const& stamp = library->stamp();
+        return !stamp.artifact_path.empty() && vcode_cache_matches(stamp.artifact_path, stamp.source_hash);
+    }
+
+    // precompile_library_trees precompiles each library in `libraries`, and each of their sub-libraries.
+    // - if `reuse_artifacts`, those with an up-to-date artifact are skipped: they are only loaded, if imported.
+    static bool precompile_library_trees(std::vector<BaseLibrary*> libraries, size_t worker_count, bool reuse_artifacts) {
+        for (size_t i = 0; i < libraries.size(); i++) {
+            std::vector<BaseLibrary*> children = libraries[i]->children();
+            libraries.insert(libraries.end(), children.begin(), children.end());
+        }
+        if (reuse_artifacts) {
+            libraries.erase(std::remove_if(libraries.begin(), libraries.end(), has_up_to_date_artifact), libraries.end());
+        }
+        return precompile_libraries(libraries, worker_count);
+    }
     
 //     static std::string dirname(std::filesystem::path file_path, bool exists_check = true);
 
@@ -45,6 +92,90 @@ namespace ss {
 
 }
 
+///
+// Library index format:
+// Like '.ssc' files, the index is a sequence of 64-bit words, so that it can be read in place once mapped: a
+// header, then each library's parent, relpath, source mtime, source hash, and artifact path.
+// - libraries are listed parents first: each parent is the index of an earlier entry, or `LIB_INDEX_NO_PARENT`
+//   for root libraries.
+// - each string is its byte count, then its bytes, padded to a whole word.
+//
+
+namespace ss {
+
+    static constexpr char LIB_INDEX_MAGIC[8] = {'S', 'N', 'A', 'I', 'L', 'I', 'D', 'X'};
+    static constexpr uint64_t LIB_INDEX_VERSION = 2;
+    static constexpr uint64_t LIB_INDEX_NO_PARENT = UINT64_MAX;
+
+    struct LibIndexHeader {
+        char magic[8];
+        uint64_t version;
+        uint64_t entry_count;
+        uint64_t checksum;      // of every word after the header
+    };
+    static_assert(sizeof(LibIndexHeader) % sizeof(uint64_t) == 0);
+
+    static uint64_t lib_index_checksum(uint64_t const* words, size_t word_count) {
+        uint64_t hash = 0x9e3779b97f4a7c15ull ^ word_count;
+        for (size_t i = 0; i < word_count; i++) {
+            hash = (hash ^ words[i]) * 0xff51afd7ed558ccdull;
+            hash ^= hash >> 32;
+        }
+        return hash;
+    }
+
+    static void push_lib_index_string(std::vector<uint64_t>& words, std::string const& s) {
+        words.push_back(s.size());
+        size_t first_word = words.size();
+        words.resize(first_word + (s.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+        memcpy(words.data() + first_word, s.data(), s.size());
+    }
+
+    // LibIndexReader reads words from a mapped index: once a read is out of bounds, every later one fails.
+    class LibIndexReader {
+    private:
+        uint64_t const* m_words;
+        size_t m_word_count;
+        size_t m_pos;
+        bool m_ok;
+
+    public:
+        LibIndexReader(uint64_t const* words, size_t word_count)
+        :   m_words(words),
+            m_word_count(word_count),
+            m_pos(0),
+            m_ok(true)
+        {}
+
+    public:
+        bool ok() const { return m_ok; }
+        bool at_end() const { return m_pos == m_word_count; }
+        uint64_t const* take(size_t count) {
+            if (!m_ok || count > m_word_count - m_pos) {
+                m_ok = false;
+                return nullptr;
+            }
+            uint64_t const* res = m_words + m_pos;
+            m_pos += count;
+            return res;
+        }
+        uint64_t next() {
+            uint64_t const* res = take(1);
+            return res ? *res : 0;
+        }
+        std::string next_string() {
+            uint64_t byte_count = next();
+            if (byte_count > (m_word_count - m_pos) * sizeof(uint64_t)) {
+                m_ok = false;
+                return {};
+            }
+            uint64_t const* words = take((byte_count + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+            return words ? std::string{reinterpret_cast<char const*>(words), byte_count} : std::string{};
+        }
+    };
+
+}
+
 ///
 // BaseLibraryContainer: inherited by LibraryRepository and BaseLibrary
 //
@@ -76,11 +207,13 @@ namespace ss {
         }
     }
 
-    void BaseLibraryContainer::install(std::filesystem::path src_path, OBJECT dst_key) {
+    BaseLibraryContainer::~BaseLibraryContainer() = default;
+
+    bool BaseLibraryContainer::install(std::filesystem::path src_path, OBJECT dst_key) {
         std::stringstream dst_path_ss;
         dst_path_ss << abspath() << "/" << dst_key;
         std::filesystem::path dst_path = dst_path_ss.str();
-        if (!std::filesystem::is_directory(dst_path)) {
+        if (std::filesystem::exists(dst_path) && !std::filesystem::is_directory(dst_path)) {
             bool ok = std::filesystem::remove(dst_path);
             if (!ok) {
                 std::stringstream ss;
@@ -95,13 +228,21 @@ namespace ss {
             src_path, dst_path, 
             std::filesystem::copy_options::recursive | 
             std::filesystem::copy_options::update_existing |
-            std::filesystem::copy_options::create_symlinks
+            std::filesystem::copy_options::copy_symlinks
         );
 
-#if CONFIG_DEBUG_MODE && !defined(NDEBUG)
+        // indexing the copy, then precompiling it:
         OBJECT key = discover(dst_path);
         assert(key.as_raw() == dst_key.as_raw());
-#endif
+        std::vector<BaseLibrary*> libraries{child(key)};
+        bool ok = precompile_library_trees(std::move(libraries), std::max(1u, std::thread::hardware_concurrency()), false);
+        on_index_changed();
+        return ok;
+    }
+    bool BaseLibraryContainer::precompile(size_t worker_count) {
+        bool ok = precompile_library_trees(children(), worker_count, true);
+        on_index_changed();
+        return ok;
     }
 
     void BaseLibraryContainer::uninstall(OBJECT key) {
@@ -109,20 +250,52 @@ namespace ss {
         if (it != m_index.end()) {
             it->second->uninstall_self();
             m_index.erase(it);
+            on_index_changed();
         } else {
             std::stringstream ss;
             ss << "uninstall: library not installed, so no action taken: " << key << std::endl;
             warning(ss.str());
         }
     }
-    BaseLibrary const* BaseLibraryContainer::lookup(OBJECT key) const {
+    BaseLibrary const* BaseLibraryContainer::lookup(OBJECT key) {
         auto it = m_index.find(key.as_raw());
-        if (it != m_index.end()) {
-            return it->second;
-        } else {
+        if (it == m_index.end()) {
             return nullptr;
         }
-        // TODO: perform file deletion
+        BaseLibrary* library = it->second.get();
+        switch (library->validate()) {
+            case BaseLibrary::Validation::Unchanged: {
+                return library;
+            }
+            case BaseLibrary::Validation::Changed: {
+                on_index_changed();
+                return library;
+            }
+            case BaseLibrary::Validation::Missing: {
+                // e.g. deleted by hand since it was indexed:
+                m_index.erase(it);
+                on_index_changed();
+                return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+    BaseLibrary* BaseLibraryContainer::child(OBJECT key) const {
+        auto it = m_index.find(key.as_raw());
+        return it != m_index.end() ? it->second.get() : nullptr;
+    }
+    void BaseLibraryContainer::adopt(std::unique_ptr<BaseLibrary> library) {
+        size_t key = library->key().as_raw();
+        m_index.insert_or_assign(key, std::move(library));
+    }
+    std::vector<BaseLibrary*> BaseLibraryContainer::children() const {
+        std::vector<BaseLibrary*> res;
+        res.reserve(m_index.size());
+        for (auto const& it: m_index) {
+            res.push_back(it.second.get());
+        }
+        return res;
     }
 
     void BaseLibraryContainer::uninstall_self() {
@@ -140,16 +313,16 @@ namespace ss {
 
 namespace ss {
 
-    bool CentralLibraryRepository::ensure_init(std::string executable_file_path) {
+    bool CentralLibraryRepository::ensure_init(std::string executable_file_path, bool rescan_index) {
         if (s_singleton == nullptr) {
             s_singleton = new CentralLibraryRepository();
         }
-        return s_singleton->try_init_instance(std::move(executable_file_path));
+        return s_singleton->try_init_instance(std::move(executable_file_path), rescan_index);
     }
-    bool CentralLibraryRepository::try_init_instance(std::string executable_file_path) {
+    bool CentralLibraryRepository::try_init_instance(std::string executable_file_path, bool rescan_index) {
         return (
             try_init_env(std::move(executable_file_path)) &&
-            try_init_index()
+            try_init_index(rescan_index)
         );
     }
     bool CentralLibraryRepository::try_init_env(std::string snail_scheme_root_path) {
@@ -214,12 +387,13 @@ namespace ss {
         return true;
     }
 
-    bool CentralLibraryRepository::try_init_index() {
+    bool CentralLibraryRepository::try_init_index(bool rescan_index) {
         assert(!m_abspath.empty() && "CentralLibraryRepository: Expected 'm_abspath' to be initialized");
         
         // ensuring the 'lib' subdirectory exists:
-        auto lib_path = m_abspath + LIB_SUBDIR;
-        if (!std::filesystem::is_directory(lib_path)) {
+        auto lib_path = abspath();
+        bool lib_path_existed = std::filesystem::is_directory(lib_path);
+        if (!lib_path_existed) {
             // notifying the user:
             {
                 std::stringstream ss;
@@ -239,35 +413,187 @@ namespace ss {
             }
         }
 
-        // scanning this directory:
-#if CONFIG_DEBUG_MODE
-        {
-            size_t entry_count = 0;
-            for (auto entry: std::filesystem::directory_iterator(lib_path)) {
-                auto root_lib_path = entry.path();
-                // std::cerr << "INFO: detected cached library in snail-root: " << root_lib_path.filename() << std::endl;
-                discover(std::move(root_lib_path));
-                entry_count++;
+        // loading the index, rather than scanning this directory:
+        TraceSpan span{"discover-libraries", lib_path};
+        if (rescan_index) {
+            rescan();
+        } else if (!try_load_index()) {
+            if (lib_path_existed) {
+                std::stringstream ss;
+                ss  << "Broken snail-root: missing or unreadable library index: " << index_abspath() << std::endl
+                    << "Attempting to repair...";
+                info(ss.str());
             }
-            // std::cerr << "INFO: detected " << entry_count << " cached libs." << std::endl;
+            rescan();
         }
-#endif
         
         // returning whether successful:
         return true;
     }
 
+    bool CentralLibraryRepository::try_load_index() {
+        size_t byte_count = 0;
+        APtr mem = os_map_file(index_abspath().c_str(), &byte_count);
+        if (!mem) {
+            return false;
+        }
+        uint64_t const* words = reinterpret_cast<uint64_t const*>(mem);
+        size_t word_count = byte_count / sizeof(uint64_t);
+        size_t header_word_count = sizeof(LibIndexHeader) / sizeof(uint64_t);
+
+        // everything is read before any library is added, so that a bad index adds none:
+        struct Entry {
+            uint64_t parent_index;
+            std::string relpath;
+            BaseLibrary::Stamp stamp;
+        };
+        LibIndexReader r{words, word_count};
+        std::vector<Entry> entries;
+        bool ok = false;
+        uint64_t const* header_words = r.take(header_word_count);
+        if (header_words && byte_count % sizeof(uint64_t) == 0) {
+            LibIndexHeader header;
+            memcpy(&header, header_words, sizeof(header));
+            ok = (
+                memcmp(header.magic, LIB_INDEX_MAGIC, sizeof(LIB_INDEX_MAGIC)) == 0 &&
+                header.version == LIB_INDEX_VERSION &&
+                header.entry_count <= word_count &&
+                header.checksum == lib_index_checksum(words + header_word_count, word_count - header_word_count)
+            );
+            if (ok) {
+                entries.resize(header.entry_count);
+                for (size_t i = 0; i < entries.size(); i++) {
+                    Entry& entry = entries[i];
+                    entry.parent_index = r.next();
+                    entry.relpath = r.next_string();
+                    entry.stamp.source_mtime = static_cast<int64_t>(r.next());
+                    entry.stamp.source_hash = r.next();
+                    entry.stamp.artifact_path = r.next_string();
+                    ok &= (entry.parent_index == LIB_INDEX_NO_PARENT || entry.parent_index < i);
+                }
+                ok &= r.ok() && r.at_end();
+            }
+        }
+        os_unmap_file(mem, byte_count);
+        if (!ok) {
+            return false;
+        }
+
+        // replacing every library indexed so far:
+        uninstall_self();
+        std::vector<BaseLibrary*> libraries;
+        libraries.reserve(entries.size());
+        for (Entry& entry: entries) {
+            OBJECT key = extract_key_from_path(entry.relpath);
+            std::unique_ptr<BaseLibrary> library;
+            BaseLibrary* parent = nullptr;
+            if (entry.parent_index == LIB_INDEX_NO_PARENT) {
+                library = std::make_unique<RootLibrary>(entry.relpath, key, this);
+            } else {
+                parent = libraries[entry.parent_index];
+                library = std::make_unique<SubLibrary>(entry.relpath, key, parent);
+            }
+            library->stamp(std::move(entry.stamp));
+            libraries.push_back(library.get());
+            if (parent) {
+                parent->adopt(std::move(library));
+            } else {
+                adopt(std::move(library));
+            }
+        }
+        return true;
+    }
+    bool CentralLibraryRepository::save_index() const {
+        // listing every library, parents first:
+        std::vector<std::pair<BaseLibrary*, uint64_t>> entries;
+        for (BaseLibrary* library: children()) {
+            entries.emplace_back(library, LIB_INDEX_NO_PARENT);
+        }
+        for (size_t i = 0; i < entries.size(); i++) {
+            for (BaseLibrary* library: entries[i].first->children()) {
+                entries.emplace_back(library, i);
+            }
+        }
+        std::vector<uint64_t> body_words;
+        for (auto const& [library, parent_index]: entries) {
+            BaseLibrary::Stamp const& stamp = library->stamp();
+            body_words.push_back(parent_index);
+            push_lib_index_string(body_words, library->relpath());
+            body_words.push_back(static_cast<uint64_t>(stamp.source_mtime));
+            body_words.push_back(stamp.source_hash);
+            push_lib_index_string(body_words, stamp.artifact_path);
+        }
+        LibIndexHeader header;
+        memcpy(header.magic, LIB_INDEX_MAGIC, sizeof(LIB_INDEX_MAGIC));
+        header.version = LIB_INDEX_VERSION;
+        header.entry_count = entries.size();
+        header.checksum = lib_index_checksum(body_words.data(), body_words.size());
+
+        // written beside, then renamed over, like '.ssc' files:
+        std::string index_path = index_abspath();
+        std::string tmp_path = index_path + ".tmp";
+        bool ok;
+        {
+            std::ofstream out{tmp_path, std::ios::binary | std::ios::trunc};
+            if (!out.is_open()) {
+                return false;
+            }
+            out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+            out.write(reinterpret_cast<char const*>(body_words.data()), static_cast<std::streamsize>(body_words.size() * sizeof(uint64_t)));
+            ok = out.good();
+        }
+        if (!ok || std::rename(tmp_path.c_str(), index_path.c_str()) != 0) {
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    void CentralLibraryRepository::rescan() {
+        // forgetting every library (their directories are kept), then discovering each again:
+        uninstall_self();
+        std::error_code ec;
+        for (auto const& entry: std::filesystem::directory_iterator(abspath(), ec)) {
+            if (entry.is_directory()) {
+                discover(entry.path());
+            }
+        }
+        on_index_changed();
+    }
+    BaseLibrary* CentralLibraryRepository::find(OBJECT library_name) const {
+        if (!library_name.is_pair()) {
+            return nullptr;
+        }
+        BaseLibrary* library = child(car(library_name));
+        for (OBJECT rem = cdr(library_name); library && rem.is_pair(); rem = cdr(rem)) {
+            library = library->child(car(rem));
+        }
+        return library;
+    }
+    void CentralLibraryRepository::on_index_changed() {
+        if (!save_index()) {
+            warning("Could not write the library index \"" + index_abspath() + "\"");
+        }
+    }
+
+    std::string CentralLibraryRepository::index_abspath() const {
+        return m_abspath + INDEX_FILE;
+    }
+    std::string CentralLibraryRepository::abspath() const {
+        return m_abspath + LIB_SUBDIR;
+    }
+
     OBJECT CentralLibraryRepository::discover(std::filesystem::path dirent_path) {
         OBJECT key = extract_key_from_path(dirent_path);
-        auto res = m_index.insert_or_assign(key.as_raw(), new RootLibrary(dirent_path.string(), key, this));
+        auto res = m_index.insert_or_assign(key.as_raw(), std::make_unique<RootLibrary>(dirent_path.filename().string(), key, this));
         if (!res.second) {
             std::stringstream ss;
             ss << "install: library re-installed: " << key << std::endl;
             warning(ss.str());
         }
-
-        // TODO: discover sub-packages
-
+        BaseLibrary* library = res.first->second.get();
+        library->restamp();
+        library->discover_children();
         return key;
     }
 }
@@ -283,18 +609,454 @@ namespace ss {
         m_relpath(std::move(relpath)),
         m_key(std::move(key)),
         m_opt_parent(opt_parent),
-        m_wb_ast(OBJECT::undef)
+        m_wb_ast(OBJECT::undef),
+        m_stamp(),
+        m_is_validated(false)
     {}
 
+    void BaseLibrary::stamp(Stamp stamp) {
+        m_stamp = std::move(stamp);
+        m_is_validated = false;
+    }
+    void BaseLibrary::restamp() {
+        Stamp stamp;
+        std::string source_path = source_abspath();
+        stamp.source_mtime = file_mtime(source_path);
+        if (stamp.source_mtime != Stamp::NO_SOURCE_MTIME) {
+            size_t byte_count = 0;
+            APtr source = os_map_file(source_path.c_str(), &byte_count);
+            stamp.source_hash = vcode_cache_key(
+                std::string_view{source ? reinterpret_cast<char const*>(source) : "", byte_count},
+                source_path
+            );
+            if (source) {
+                os_unmap_file(source, byte_count);
+            }
+            std::string artifact_path = std::filesystem::path{source_path}.replace_extension(".ssc").string();
+            if (vcode_cache_matches(artifact_path, stamp.source_hash)) {
+                stamp.artifact_path = std::move(artifact_path);
+            }
+        }
+        m_stamp = std::move(stamp);
+        m_is_validated = true;
+    }
+    BaseLibrary::Validation BaseLibrary::validate() {
+        if (m_is_validated) {
+            return Validation::Unchanged;
+        }
+        m_is_validated = true;
+
+        // a library with a 'main.scm' exists if it does, so that most are checked by one 'stat':
+        int64_t source_mtime = file_mtime(source_abspath());
+        if (source_mtime == Stamp::NO_SOURCE_MTIME && !std::filesystem::is_directory(abspath())) {
+            return Validation::Missing;
+        }
+        if (source_mtime == m_stamp.source_mtime) {
+            return Validation::Unchanged;
+        }
+        restamp();
+        return Validation::Changed;
+    }
+
+    void BaseLibrary::discover_children() {
+        std::error_code ec;
+        for (auto const& entry: std::filesystem::directory_iterator(abspath(), ec)) {
+            if (entry.is_directory()) {
+                discover(entry.path());
+            }
+        }
+    }
+    void BaseLibrary::on_index_changed() {
+        if (CentralLibraryRepository* clr = repository()) {
+            clr->on_index_changed();
+        }
+    }
+
     OBJECT BaseLibrary::discover(std::filesystem::path dirent_path) {
         OBJECT key = extract_key_from_path(dirent_path);
-        auto res = m_index.insert_or_assign(key.as_raw(), new SubLibrary(dirent_path.string(), key, this));
+        auto res = m_index.insert_or_assign(key.as_raw(), std::make_unique<SubLibrary>(dirent_path.filename().string(), key, this));
         if (!res.second) {
             std::stringstream ss;
             ss << "install: library re-installed: " << key << std::endl;
             warning(ss.str());
         }
+        BaseLibrary* library = res.first->second.get();
+        library->restamp();
+        library->discover_children();
         return key;
     }
     
-}
\ No newline at end of file
+}
+///
+// Precompiling: cf `precompile_libraries`
+//
+
+namespace ss {
+
+    // LibraryBuildNode: a library to compile, or one that one imports.
+    struct LibraryBuildNode {
+        BaseLibrary* library;
+        bool is_requested;
+        std::string source_path;
+        std::string source;
+        std::vector<OBJECT> lines;          // each but the imports, to compile
+        uint64_t key = 0;                   // of `source`, cf `vcode_cache_key`
+        std::string artifact_path;          // once built, empty if there is nothing to load
+        std::vector<size_t> imports;
+        std::vector<size_t> importers;
+        size_t pending_import_count = 0;
+        size_t rank = 0;                    // in import order
+        bool is_prebuilt = false;           // i.e. its artifact is up to date, so it is not compiled
+        bool is_built = false;
+        bool is_failed = false;
+    };
+
+    // library_name_of_import_set returns the name of the library an import set imports from, e.g. '(foo)' for
+    // '(prefix (only (foo) f) foo:)'.
+    static OBJECT library_name_of_import_set(OBJECT import_set) {
+        static IntStr const s_only = intern("only");
+        static IntStr const s_except = intern("except");
+        static IntStr const s_prefix = intern("prefix");
+        static IntStr const s_rename = intern("rename");
+        while (import_set.is_pair() && car(import_set).is_symbol() && cdr(import_set).is_pair()) {
+            IntStr head = car(import_set).as_symbol();
+            bool is_modifier = (head == s_only || head == s_except || head == s_prefix || head == s_rename);
+            if (!is_modifier || !cadr(import_set).is_pair()) {
+                break;
+            }
+            import_set = cadr(import_set);
+        }
+        return import_set;
+    }
+    // import_form_datum returns the datum of a top-level '(import ...)' form, else null.
+    static OBJECT import_form_datum(GcThreadFrontEnd* gc_tfe, OBJECT line) {
+        static IntStr const s_import = intern("import");
+        OBJECT data = line.is_syntax() ? line.as_syntax_p()->data() : line;
+        if (!data.is_pair()) {
+            return OBJECT::null;
+        }
+        OBJECT head = car(data);
+        OBJECT head_data = head.is_syntax() ? head.as_syntax_p()->data() : head;
+        if (!head_data.is_symbol() || head_data.as_symbol() != s_import) {
+            return OBJECT::null;
+        }
+        return line.is_syntax() ? line.as_syntax_p()->to_datum(gc_tfe) : line;
+    }
+
+    class LibraryBuild {
+    private:
+        GcThreadFrontEnd* m_gc_tfe;
+        std::vector<LibraryBuildNode> m_nodes;
+        UnstableHashMap<BaseLibrary*, size_t> m_node_indices;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::deque<size_t> m_ready;
+        size_t m_unfinished_count;
+        std::vector<BaseLibrary*> m_build_order;
+
+    public:
+        explicit LibraryBuild(GcThreadFrontEnd* gc_tfe)
+        :   m_gc_tfe(gc_tfe),
+            m_nodes(),
+            m_node_indices(),
+            m_mutex(),
+            m_cv(),
+            m_ready(),
+            m_unfinished_count(0),
+            m_build_order()
+        {}
+
+    public:
+        // add adds `library` to the build, unless it already is: it is compiled if requested, or if it has no 
+        // up-to-date artifact.
+        size_t add(BaseLibrary* library, bool is_requested);
+        // scan reads and parses every library, adding each library it imports: prebuilt ones are only scanned for
+        // their imports.
+        void scan();
+        // run compiles each library once every library it imports is built, on up to `worker_count` threads.
+        void run(size_t worker_count);
+        // restamp records the artifact of each library built, returning whether each requested one was.
+        bool restamp();
+        // build_order lists each library compiled, in the order each finished.
+        std::vector<BaseLibrary*> const& build_order() const { return m_build_order; }
+
+    private:
+        void scan(size_t node_index);
+        void work();
+        bool compile(size_t node_index);
+    };
+
+    size_t LibraryBuild::add(BaseLibrary* library, bool is_requested) {
+        auto it = m_node_indices.find(library);
+        if (it != m_node_indices.end()) {
+            return it->second;
+        }
+        size_t node_index = m_nodes.size();
+        m_node_indices.insert({library, node_index});
+        LibraryBuildNode& node = m_nodes.emplace_back();
+        node.library = library;
+        node.is_requested = is_requested;
+        node.source_path = library->source_abspath();
+        if (!is_requested && !library->stamp().artifact_path.empty()) {
+            node.key = library->stamp().source_hash;
+            node.artifact_path = library->stamp().artifact_path;
+            node.is_prebuilt = true;
+            node.is_built = true;
+        }
+        return node_index;
+    }
+    void LibraryBuild::scan() {
+        // nodes are added as their importers are scanned: prebuilt ones too, since their artifacts are only
+        // loaded after those of the libraries they import.
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            scan(i);
+        }
+    }
+    void LibraryBuild::scan(size_t node_index) {
+        std::string source_path = m_nodes[node_index].source_path;
+        {
+            std::ifstream f{source_path, std::ios::binary};
+            if (!f.is_open()) {
+                // a library without a 'main.scm' only holds sub-libraries: there is nothing to compile.
+                m_nodes[node_index].is_built = true;
+                return;
+            }
+            std::stringstream source_ss;
+            source_ss << f.rdbuf();
+            m_nodes[node_index].source = source_ss.str();
+        }
+        std::string const& source = m_nodes[node_index].source;
+        if (!m_nodes[node_index].is_prebuilt) {
+            m_nodes[node_index].key = vcode_cache_key(source, source_path);
+        }
+
+        // parsing, keeping each import's library name aside:
+        std::vector<OBJECT> lines;
+        std::vector<OBJECT> library_names;
+        try {
+            parse_all_lines_in_parallel(
+                source, source_path, m_gc_tfe, 1,
+                [&] (std::vector<OBJECT> chunk_lines) {
+                    for (OBJECT line: chunk_lines) {
+                        OBJECT import_datum = import_form_datum(m_gc_tfe, line);
+                        if (import_datum.is_null()) {
+                            lines.push_back(line);
+                            continue;
+                        }
+                        for (OBJECT rem = cdr(import_datum); rem.is_pair(); rem = cdr(rem)) {
+                            library_names.push_back(library_name_of_import_set(car(rem)));
+                        }
+                        if (line.is_syntax()) {
+                            // import forms are not compiled: cf `Compiler::extend_subr`
+                            FLocTable::drop(line.as_syntax_p()->loc_id());
+                        }
+                    }
+                }
+            );
+        } catch (SsiError const&) {
+            m_nodes[node_index].is_failed = true;
+            return;
+        }
+        if (!m_nodes[node_index].is_prebuilt) {
+            m_nodes[node_index].lines = std::move(lines);
+        }
+
+        // adding each library imported that is installed:
+        CentralLibraryRepository* clr = m_nodes[node_index].library->repository();
+        for (OBJECT library_name: library_names) {
+            BaseLibrary* imported = clr ? clr->find(library_name) : nullptr;
+            if (imported == nullptr || imported->validate() == BaseLibrary::Validation::Missing) {
+                continue;
+            }
+            size_t imported_index = add(imported, false);
+            m_nodes[node_index].imports.push_back(imported_index);
+        }
+    }
+
+    void LibraryBuild::run(size_t worker_count) {
+        // ordering the nodes before any is compiled, so that import cycles are found up front:
+        // - each node not ordered is in a cycle, or imports one that is.
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            m_nodes[i].pending_import_count = m_nodes[i].imports.size();
+            for (size_t imported_index: m_nodes[i].imports) {
+                m_nodes[imported_index].importers.push_back(i);
+            }
+        }
+        std::vector<size_t> order;
+        std::vector<size_t> pending_import_counts(m_nodes.size());
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            pending_import_counts[i] = m_nodes[i].pending_import_count;
+            if (pending_import_counts[i] == 0) {
+                order.push_back(i);
+            }
+        }
+        for (size_t i = 0; i < order.size(); i++) {
+            LibraryBuildNode& node = m_nodes[order[i]];
+            node.rank = i;
+            for (size_t importer_index: node.importers) {
+                if (--pending_import_counts[importer_index] == 0) {
+                    order.push_back(importer_index);
+                }
+            }
+        }
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            if (pending_import_counts[i] != 0) {
+                m_nodes[i].is_failed = true;
+                warning("Could not precompile library \"" + m_nodes[i].source_path + "\": its imports form a cycle");
+            }
+        }
+
+        // compiling each node once the nodes it imports are built:
+        m_unfinished_count = order.size();
+        for (size_t node_index: order) {
+            if (m_nodes[node_index].pending_import_count == 0) {
+                m_ready.push_back(node_index);
+            }
+        }
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < std::min(worker_count, order.size()); i++) {
+            workers.emplace_back(&LibraryBuild::work, this);
+        }
+        work();
+        for (std::thread& worker: workers) {
+            worker.join();
+        }
+    }
+    void LibraryBuild::work() {
+        for (;;) {
+            size_t node_index;
+            {
+                std::unique_lock lock{m_mutex};
+                m_cv.wait(lock, [this] () { return !m_ready.empty() || m_unfinished_count == 0; });
+                if (m_ready.empty()) {
+                    return;
+                }
+                node_index = m_ready.front();
+                m_ready.pop_front();
+            }
+
+            // the nodes this one imports are finished, and not written again:
+            LibraryBuildNode& node = m_nodes[node_index];
+            bool imports_ok = std::none_of(
+                node.imports.begin(), node.imports.end(),
+                [this] (size_t imported_index) { return m_nodes[imported_index].is_failed; }
+            );
+            bool is_compiled = !node.is_failed && imports_ok && !node.is_built;
+            bool ok = !node.is_failed && imports_ok && (node.is_built || compile(node_index));
+            if (!node.is_failed && !imports_ok) {
+                warning("Could not precompile library \"" + node.source_path + "\": a library it imports failed to");
+            }
+
+            {
+                std::lock_guard lg{m_mutex};
+                node.is_built = ok;
+                node.is_failed = !ok;
+                if (is_compiled && ok) {
+                    m_build_order.push_back(node.library);
+                }
+                m_unfinished_count--;
+                for (size_t importer_index: node.importers) {
+                    if (--m_nodes[importer_index].pending_import_count == 0) {
+                        m_ready.push_back(importer_index);
+                    }
+                }
+            }
+            m_cv.notify_all();
+        }
+    }
+    bool LibraryBuild::compile(size_t node_index) {
+        LibraryBuildNode& node = m_nodes[node_index];
+        TraceSpan span{"build-library", node.source_path};
+
+        // the artifacts to load first: each library this one imports, directly or not, in import order.
+        std::vector<size_t> loaded_indices;
+        std::vector<bool> is_loaded(m_nodes.size(), false);
+        std::vector<size_t> stack{node.imports};
+        while (!stack.empty()) {
+            size_t i = stack.back();
+            stack.pop_back();
+            if (!is_loaded[i]) {
+                is_loaded[i] = true;
+                loaded_indices.push_back(i);
+                stack.insert(stack.end(), m_nodes[i].imports.begin(), m_nodes[i].imports.end());
+            }
+        }
+        std::sort(
+            loaded_indices.begin(), loaded_indices.end(),
+            [this] (size_t lt, size_t rt) { return m_nodes[lt].rank < m_nodes[rt].rank; }
+        );
+
+        // compiling on a VM of its own, like 'interpret_file':
+        VirtualMachine* vm = create_vm(m_gc_tfe->gc(), bind_standard_procedures, VmEngine::Bytecode);
+        Compiler& compiler = *vm_compiler(vm);
+        VCode* code = compiler.code();
+        bool ok = true;
+        for (size_t i: loaded_indices) {
+            LibraryBuildNode const& loaded = m_nodes[i];
+            if (!loaded.artifact_path.empty() && !load_vcode_cache(loaded.artifact_path, loaded.key, *code, vm_gc_tfe(vm))) {
+                warning("Could not precompile library \"" + node.source_path + "\": could not load \"" + loaded.artifact_path + "\"");
+                ok = false;
+                break;
+            }
+        }
+        if (ok) {
+            std::string artifact_path = std::filesystem::path{node.source_path}.replace_extension(".ssc").string();
+            GDefID first_gdef_id = code->count_globals();
+            VSubr subr{node.source_path, {}, {}};
+            try {
+                auto expanded_lines = macroexpand_syntax(
+                    *vm_gc_tfe(vm),
+                    code->def_tab(),
+                    code->pproc_tab(),
+                    std::move(node.lines)
+                );
+                compiler.extend_subr(subr, std::move(expanded_lines));
+                ok = save_vcode_cache(artifact_path, node.key, *code, subr, first_gdef_id);
+                if (!ok) {
+                    warning("Could not write the compiled code cache \"" + artifact_path + "\"");
+                }
+            } catch (SsiError const&) {
+                warning("Could not precompile library \"" + node.source_path + "\": see above error messages");
+                ok = false;
+            }
+            if (ok) {
+                node.artifact_path = std::move(artifact_path);
+            }
+        }
+        destroy_vm(vm);
+        return ok;
+    }
+
+    bool LibraryBuild::restamp() {
+        bool ok = true;
+        for (LibraryBuildNode const& node: m_nodes) {
+            if (node.is_built && !node.is_prebuilt) {
+                node.library->restamp();
+            }
+            ok &= (node.is_built || !node.is_requested);
+        }
+        return ok;
+    }
+
+    bool precompile_libraries(
+        std::vector<BaseLibrary*> const& libraries, 
+        size_t worker_count, 
+        std::vector<BaseLibrary*>* opt_build_order
+    ) {
+        // the libraries are parsed and compiled on a heap of their own, which is never collected: no VM runs.
+        TraceSpan span{"build-libraries"};
+        Gc gc{CONFIG_LIBRARY_BUILD_HEAP_BYTES};
+        GcThreadFrontEnd gc_tfe{&gc};
+        LibraryBuild build{&gc_tfe};
+        for (BaseLibrary* library: libraries) {
+            build.add(library, true);
+        }
+        build.scan();
+        build.run(worker_count);
+        if (opt_build_order) {
+            *opt_build_order = build.build_order();
+        }
+        return build.restamp();
+    }
+
+}
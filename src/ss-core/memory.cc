@@ -1,10 +1,142 @@
 #include "ss-core/memory.hh"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace ss {
 
+    //
+    // OS virtual memory:
+    //
+
+#ifdef _WIN32
+    size_t os_page_size() {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+    }
+    APtr os_reserve_memory(size_t byte_count) {
+        return static_cast<APtr>(VirtualAlloc(nullptr, byte_count, MEM_RESERVE, PAGE_NOACCESS));
+    }
+    bool os_commit_memory(APtr ptr, size_t byte_count) {
+        return VirtualAlloc(ptr, byte_count, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+    }
+    void os_decommit_memory(APtr ptr, size_t byte_count) {
+        VirtualFree(ptr, byte_count, MEM_DECOMMIT);
+    }
+    void os_release_memory(APtr ptr, size_t byte_count) {
+        (void)byte_count;
+        VirtualFree(ptr, 0, MEM_RELEASE);
+    }
+    APtr os_allocate_zeroed_memory(size_t byte_count) {
+        return static_cast<APtr>(VirtualAlloc(nullptr, byte_count, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    }
+    APtr os_map_file(char const* path, size_t* out_byte_count) {
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return nullptr;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            CloseHandle(file);
+            return nullptr;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr) {
+            return nullptr;
+        }
+        void* res = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        *out_byte_count = static_cast<size_t>(size.QuadPart);
+        return static_cast<APtr>(res);
+    }
+    void os_unmap_file(APtr ptr, size_t byte_count) {
+        (void)byte_count;
+        UnmapViewOfFile(ptr);
+    }
+    APtr os_allocate_code_memory(size_t byte_count) {
+        return static_cast<APtr>(VirtualAlloc(nullptr, byte_count, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    }
+    bool os_seal_code_memory(APtr ptr, size_t byte_count) {
+        DWORD old_protect;
+        if (!VirtualProtect(ptr, byte_count, PAGE_EXECUTE_READ, &old_protect)) {
+            return false;
+        }
+        return FlushInstructionCache(GetCurrentProcess(), ptr, byte_count);
+    }
+#else
+    size_t os_page_size() {
+        static size_t const page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return page_size;
+    }
+    static APtr os_map(size_t byte_count, int prot) {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    #ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE;
+    #endif
+        void* res = mmap(nullptr, byte_count, prot, flags, -1, 0);
+        return (res == MAP_FAILED) ? nullptr : static_cast<APtr>(res);
+    }
+    APtr os_reserve_memory(size_t byte_count) {
+        return os_map(byte_count, PROT_NONE);
+    }
+    bool os_commit_memory(APtr ptr, size_t byte_count) {
+        return mprotect(ptr, byte_count, PROT_READ | PROT_WRITE) == 0;
+    }
+    void os_decommit_memory(APtr ptr, size_t byte_count) {
+        madvise(ptr, byte_count, MADV_DONTNEED);
+        mprotect(ptr, byte_count, PROT_NONE);
+    }
+    void os_release_memory(APtr ptr, size_t byte_count) {
+        munmap(ptr, byte_count);
+    }
+    APtr os_allocate_zeroed_memory(size_t byte_count) {
+        return os_map(byte_count, PROT_READ | PROT_WRITE);
+    }
+    APtr os_map_file(char const* path, size_t* out_byte_count) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return nullptr;
+        }
+        void* res = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (res == MAP_FAILED) {
+            return nullptr;
+        }
+        *out_byte_count = static_cast<size_t>(st.st_size);
+        return static_cast<APtr>(res);
+    }
+    void os_unmap_file(APtr ptr, size_t byte_count) {
+        munmap(ptr, byte_count);
+    }
+    APtr os_allocate_code_memory(size_t byte_count) {
+        return os_map(byte_count, PROT_READ | PROT_WRITE);
+    }
+    bool os_seal_code_memory(APtr ptr, size_t byte_count) {
+        if (mprotect(ptr, byte_count, PROT_READ | PROT_EXEC) != 0) {
+            return false;
+        }
+        __builtin___clear_cache(reinterpret_cast<char*>(ptr), reinterpret_cast<char*>(ptr) + byte_count);
+        return true;
+    }
+#endif
+
     StackAllocator::StackAllocator(APtr mem, size_t capacity)
     :   m_mem(mem),
-        m_capacity_bytes(capacity)
+        m_capacity_bytes(capacity),
+        m_occupied_bytes(0)
     {}
 
     RootStackAllocator::RootStackAllocator(size_t capacity, RootAllocCb alloc, RootDeallocCb dealloc) 
@@ -0,0 +1,636 @@
+#include "ss-core/numvec.hh"
+
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+
+#include "ss-core/config.hh"
+#include "ss-core/vm.hh"
+#include "ss-core/pinvoke.hh"
+#include "ss-core/printing.hh"
+#include "ss-core/feedback.hh"
+
+#if !CONFIG_DISABLE_SIMD_NUM_VECTOR_KERNELS && (defined(__SSE2__) || defined(_M_X64))
+    #include <emmintrin.h>
+    #define SS_NUM_VECTOR_SSE2 1
+#elif !CONFIG_DISABLE_SIMD_NUM_VECTOR_KERNELS && defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define SS_NUM_VECTOR_NEON 1
+#endif
+
+namespace ss {
+
+    //
+    // Blocks:
+    // `Block<T>` loads, operates on, and stores 16 bytes of `T` at a time. Element types without one are only
+    // handled by the scalar loops, which also handle each kernel's tail.
+    //
+
+    template <typename T>
+    struct Block {
+        static constexpr bool is_simd = false;
+    };
+
+#if SS_NUM_VECTOR_SSE2
+    template <>
+    struct Block<double> {
+        static constexpr bool is_simd = true;
+        static constexpr size_t N = 2;
+        using V = __m128d;
+        static V load(double const* p) { return _mm_loadu_pd(p); }
+        static void store(double* p, V v) { _mm_storeu_pd(p, v); }
+        static V splat(double x) { return _mm_set1_pd(x); }
+        static V add(V a, V b) { return _mm_add_pd(a, b); }
+        static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+        static V min(V a, V b) { return _mm_min_pd(a, b); }
+        static V max(V a, V b) { return _mm_max_pd(a, b); }
+    };
+    template <>
+    struct Block<float> {
+        static constexpr bool is_simd = true;
+        static constexpr size_t N = 4;
+        using V = __m128;
+        static V load(float const* p) { return _mm_loadu_ps(p); }
+        static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+        static V splat(float x) { return _mm_set1_ps(x); }
+        static V add(V a, V b) { return _mm_add_ps(a, b); }
+        static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+        static V min(V a, V b) { return _mm_min_ps(a, b); }
+        static V max(V a, V b) { return _mm_max_ps(a, b); }
+    };
+#elif SS_NUM_VECTOR_NEON
+    template <>
+    struct Block<double> {
+        static constexpr bool is_simd = true;
+        static constexpr size_t N = 2;
+        using V = float64x2_t;
+        static V load(double const* p) { return vld1q_f64(p); }
+        static void store(double* p, V v) { vst1q_f64(p, v); }
+        static V splat(double x) { return vdupq_n_f64(x); }
+        static V add(V a, V b) { return vaddq_f64(a, b); }
+        static V mul(V a, V b) { return vmulq_f64(a, b); }
+        static V min(V a, V b) { return vminq_f64(a, b); }
+        static V max(V a, V b) { return vmaxq_f64(a, b); }
+    };
+    template <>
+    struct Block<float> {
+        static constexpr bool is_simd = true;
+        static constexpr size_t N = 4;
+        using V = float32x4_t;
+        static V load(float const* p) { return vld1q_f32(p); }
+        static void store(float* p, V v) { vst1q_f32(p, v); }
+        static V splat(float x) { return vdupq_n_f32(x); }
+        static V add(V a, V b) { return vaddq_f32(a, b); }
+        static V mul(V a, V b) { return vmulq_f32(a, b); }
+        static V min(V a, V b) { return vminq_f32(a, b); }
+        static V max(V a, V b) { return vmaxq_f32(a, b); }
+    };
+#endif
+
+    // lanes: the elements of a block, first lane first.
+    template <typename T>
+    inline static std::array<T, Block<T>::N> lanes(typename Block<T>::V v) {
+        std::array<T, Block<T>::N> res;
+        Block<T>::store(res.data(), v);
+        return res;
+    }
+
+    // integer arithmetic wraps around: it is carried out unsigned, since signed overflow is undefined.
+    template <typename T>
+    inline static T wrapping_add(T a, T b) {
+        if constexpr (std::is_integral_v<T>) {
+            using U = std::make_unsigned_t<T>;
+            return static_cast<T>(static_cast<U>(static_cast<U>(a) + static_cast<U>(b)));
+        } else {
+            return a + b;
+        }
+    }
+    template <typename T>
+    inline static T wrapping_mul(T a, T b) {
+        if constexpr (std::is_integral_v<T>) {
+            using U = std::conditional_t<(sizeof(T) < sizeof(unsigned)), unsigned, std::make_unsigned_t<T>>;
+            return static_cast<T>(static_cast<U>(a) * static_cast<U>(b));
+        } else {
+            return a * b;
+        }
+    }
+
+    //
+    // Kernels:
+    //
+
+    template <typename T>
+    void NumVectorKernels<T>::add(T* dst, T const* a, T const* b, size_t n) {
+        size_t i = 0;
+        if constexpr (Block<T>::is_simd) {
+            using B = Block<T>;
+            for (; i + B::N <= n; i += B::N) {
+                B::store(dst + i, B::add(B::load(a + i), B::load(b + i)));
+            }
+        }
+        for (; i < n; i++) {
+            dst[i] = wrapping_add(a[i], b[i]);
+        }
+    }
+    template <typename T>
+    void NumVectorKernels<T>::mul(T* dst, T const* a, T const* b, size_t n) {
+        size_t i = 0;
+        if constexpr (Block<T>::is_simd) {
+            using B = Block<T>;
+            for (; i + B::N <= n; i += B::N) {
+                B::store(dst + i, B::mul(B::load(a + i), B::load(b + i)));
+            }
+        }
+        for (; i < n; i++) {
+            dst[i] = wrapping_mul(a[i], b[i]);
+        }
+    }
+    template <typename T>
+    void NumVectorKernels<T>::scale(T* dst, T const* a, T k, size_t n) {
+        size_t i = 0;
+        if constexpr (Block<T>::is_simd) {
+            using B = Block<T>;
+            auto kv = B::splat(k);
+            for (; i + B::N <= n; i += B::N) {
+                B::store(dst + i, B::mul(B::load(a + i), kv));
+            }
+        }
+        for (; i < n; i++) {
+            dst[i] = wrapping_mul(a[i], k);
+        }
+    }
+    template <typename T>
+    void NumVectorKernels<T>::fill(T* dst, T v, size_t n) {
+        std::fill(dst, dst + n, v);
+    }
+    template <typename T>
+    NumVectorAcc<T> NumVectorKernels<T>::dot(T const* a, T const* b, size_t n) {
+        NumVectorAcc<T> acc = 0;
+        size_t i = 0;
+        if constexpr (Block<T>::is_simd) {
+            using B = Block<T>;
+            auto acc_v = B::splat(0);
+            for (; i + B::N <= n; i += B::N) {
+                acc_v = B::add(acc_v, B::mul(B::load(a + i), B::load(b + i)));
+            }
+            for (T lane: lanes<T>(acc_v)) {
+                acc += lane;
+            }
+        }
+        for (; i < n; i++) {
+            acc = wrapping_add<NumVectorAcc<T>>(acc, wrapping_mul<NumVectorAcc<T>>(a[i], b[i]));
+        }
+        return acc;
+    }
+    template <typename T>
+    NumVectorAcc<T> NumVectorKernels<T>::sum(T const* a, size_t n) {
+        NumVectorAcc<T> acc = 0;
+        size_t i = 0;
+        if constexpr (Block<T>::is_simd) {
+            using B = Block<T>;
+            auto acc_v = B::splat(0);
+            for (; i + B::N <= n; i += B::N) {
+                acc_v = B::add(acc_v, B::load(a + i));
+            }
+            for (T lane: lanes<T>(acc_v)) {
+                acc += lane;
+            }
+        }
+        for (; i < n; i++) {
+            acc = wrapping_add<NumVectorAcc<T>>(acc, a[i]);
+        }
+        return acc;
+    }
+    template <typename T>
+    T NumVectorKernels<T>::min(T const* a, size_t n) {
+        assert(n > 0);
+        T res = a[0];
+        size_t i = 0;
+        if constexpr (Block<T>::is_simd) {
+            using B = Block<T>;
+            if (n >= B::N) {
+                auto res_v = B::load(a);
+                for (i = B::N; i + B::N <= n; i += B::N) {
+                    res_v = B::min(res_v, B::load(a + i));
+                }
+                for (T lane: lanes<T>(res_v)) {
+                    res = std::min(res, lane);
+                }
+            }
+        }
+        for (; i < n; i++) {
+            res = std::min(res, a[i]);
+        }
+        return res;
+    }
+    template <typename T>
+    T NumVectorKernels<T>::max(T const* a, size_t n) {
+        assert(n > 0);
+        T res = a[0];
+        size_t i = 0;
+        if constexpr (Block<T>::is_simd) {
+            using B = Block<T>;
+            if (n >= B::N) {
+                auto res_v = B::load(a);
+                for (i = B::N; i + B::N <= n; i += B::N) {
+                    res_v = B::max(res_v, B::load(a + i));
+                }
+                for (T lane: lanes<T>(res_v)) {
+                    res = std::max(res, lane);
+                }
+            }
+        }
+        for (; i < n; i++) {
+            res = std::max(res, a[i]);
+        }
+        return res;
+    }
+
+    template struct NumVectorKernels<double>;
+    template struct NumVectorKernels<float>;
+    template struct NumVectorKernels<int64_t>;
+    template struct NumVectorKernels<uint8_t>;
+
+}   // namespace ss
+
+//
+// Platform procedures:
+//
+
+namespace ss {
+
+    // with_element_type calls `f.template operator()<T>()` with the element type of a `NumVectorType`.
+    template <typename F>
+    inline static decltype(auto) with_element_type(NumVectorType type, F&& f) {
+        switch (type) {
+            case NumVectorType::F64: return f.template operator()<double>();
+            case NumVectorType::F32: return f.template operator()<float>();
+            case NumVectorType::S64: return f.template operator()<int64_t>();
+            case NumVectorType::U8: return f.template operator()<uint8_t>();
+        }
+        error("Unknown NumVectorType");
+        throw SsiError();
+    }
+    inline static char const* num_vector_type_name(NumVectorType type) {
+        switch (type) {
+            case NumVectorType::F64: return "f64vector";
+            case NumVectorType::F32: return "f32vector";
+            case NumVectorType::S64: return "s64vector";
+            case NumVectorType::U8: return "u8vector";
+        }
+        return "?";
+    }
+
+    // element_from_object converts a Scheme number to an element, else raises an error naming `proc_name`.
+    template <typename T>
+    static T element_from_object(char const* proc_name, OBJECT obj) {
+        if constexpr (std::is_floating_point_v<T>) {
+            if (obj.is_integer() || obj.is_float32() || obj.is_float64()) {
+                return static_cast<T>(obj.to_double());
+            }
+        } else if constexpr (std::is_same_v<T, uint8_t>) {
+            if (obj.is_integer() && obj.as_integer() >= 0 && obj.as_integer() <= 255) {
+                return static_cast<T>(obj.as_integer());
+            }
+        } else {
+            if (obj.is_integer()) {
+                return static_cast<T>(obj.as_integer());
+            }
+        }
+        std::stringstream ss;
+        ss << proc_name << ": cannot store " << obj << " in a numeric vector of this type";
+        error(ss.str());
+        throw SsiError();
+    }
+    // element_to_object converts an element (or accumulator) to a Scheme number.
+    template <typename T>
+    static OBJECT element_to_object(GcThreadFrontEnd* gc_tfe, char const* proc_name, T v) {
+        if constexpr (std::is_same_v<T, double>) {
+            return OBJECT::make_float64(gc_tfe, v);
+        } else if constexpr (std::is_same_v<T, float>) {
+            return OBJECT::make_float32(v);
+        } else {
+            // s64 elements and sums may not fit a fixnum:
+            OBJECT res = OBJECT::make_integer(static_cast<ssize_t>(v));
+            if (static_cast<T>(res.as_integer()) != v) {
+                std::stringstream ss;
+                ss << proc_name << ": " << static_cast<int64_t>(v) << " does not fit in an integer";
+                error(ss.str());
+                throw SsiError();
+            }
+            return res;
+        }
+    }
+
+    static NumVectorObject* expect_num_vector(char const* proc_name, char const* arg_desc, OBJECT obj) {
+        if (!obj.is_num_vector()) {
+            std::stringstream ss;
+            ss << proc_name << ": expected " << arg_desc << " arg to be a numeric vector, not " << obj;
+            error(ss.str());
+            throw SsiError();
+        }
+        return obj.as_num_vector_p();
+    }
+    static NumVectorObject* expect_num_vector_of_type(char const* proc_name, NumVectorType type, OBJECT obj) {
+        if (!obj.is_num_vector() || obj.as_num_vector_p()->type() != type) {
+            std::stringstream ss;
+            ss << proc_name << ": expected first arg to be a " << num_vector_type_name(type) << ", not " << obj;
+            error(ss.str());
+            throw SsiError();
+        }
+        return obj.as_num_vector_p();
+    }
+    static size_t expect_index(char const* proc_name, OBJECT obj, size_t bound) {
+        if (!obj.is_integer() || obj.as_integer() < 0 || static_cast<size_t>(obj.as_integer()) >= bound) {
+            std::stringstream ss;
+            ss << proc_name << ": expected an index in [0, " << bound << "), not " << obj;
+            error(ss.str());
+            throw SsiError();
+        }
+        return static_cast<size_t>(obj.as_integer());
+    }
+    // expect_same_shape checks that each of `others` has `v`'s element type and at least its count.
+    static void expect_same_shape(char const* proc_name, NumVectorObject* v, std::initializer_list<NumVectorObject*> others) {
+        for (NumVectorObject* other: others) {
+            if (other->type() != v->type() || other->count() < v->count()) {
+                std::stringstream ss;
+                ss  << proc_name << ": expected " << num_vector_type_name(v->type()) << " args of at least "
+                    << v->count() << " elements";
+                error(ss.str());
+                throw SsiError();
+            }
+        }
+    }
+
+    OBJECT num_vector_item(GcThreadFrontEnd* gc_tfe, char const* proc_name, NumVectorObject* v, size_t i) {
+        return with_element_type(v->type(), [&] <typename T> () {
+            return element_to_object<T>(gc_tfe, proc_name, v->data<T>()[i]);
+        });
+    }
+
+    template <NumVectorType type>
+    static void bind_typed_num_vector_procedures(VirtualMachine* vm) {
+        std::string name = num_vector_type_name(type);
+        static std::string const make_name = "make-" + name;
+        static std::string const length_name = name + "-length";
+        static std::string const ref_name = name + "-ref";
+        static std::string const set_name = name + "-set!";
+        static std::string const ctor_name = name;
+
+        vm_bind_platform_procedure(vm,
+            make_name,
+            [](void* ctx, ArgSpan aa) -> OBJECT {
+                if (aa.size() < 1 || aa.size() > 2 || !aa[0].is_integer() || aa[0].as_integer() < 0) {
+                    std::stringstream ss;
+                    ss << make_name << ": expected a count and an optional fill";
+                    error(ss.str());
+                    throw SsiError();
+                }
+                size_t count = static_cast<size_t>(aa[0].as_integer());
+                OBJECT res = OBJECT::make_num_vector(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), type, count);
+                if (aa.size() == 2) {
+                    with_element_type(type, [&] <typename T> () {
+                        NumVectorKernels<T>::fill(
+                            res.as_num_vector_p()->data<T>(), element_from_object<T>(make_name.c_str(), aa[1]), count
+                        );
+                    });
+                }
+                return res;
+            },
+            {"count", "fill..."},
+            "returns a new vector of 'count' numbers, each 'fill' if given, else 0",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            ctor_name,
+            [](void* ctx, ArgSpan aa) -> OBJECT {
+                size_t count = static_cast<size_t>(aa.size());
+                OBJECT res = OBJECT::make_num_vector(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), type, count);
+                with_element_type(type, [&] <typename T> () {
+                    T* data = res.as_num_vector_p()->data<T>();
+                    for (size_t i = 0; i < count; i++) {
+                        data[i] = element_from_object<T>(ctor_name.c_str(), aa[i]);
+                    }
+                });
+                return res;
+            },
+            {"items..."},
+            "returns a new vector of the given numbers",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            name + "?",
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(obj.is_num_vector() && obj.as_num_vector_p()->type() == type);
+            },
+            {"obj"}
+        );
+        vm_bind_platform_procedure(vm,
+            length_name,
+            [](void*, OBJECT vec) -> OBJECT {
+                NumVectorObject* v = expect_num_vector_of_type(length_name.c_str(), type, vec);
+                return OBJECT::make_integer(v->count());
+            },
+            {"vec"}
+        );
+        vm_bind_platform_procedure(vm,
+            ref_name,
+            [](void* ctx, OBJECT vec, OBJECT pos) -> OBJECT {
+                NumVectorObject* v = expect_num_vector_of_type(ref_name.c_str(), type, vec);
+                size_t i = expect_index(ref_name.c_str(), pos, v->count());
+                return with_element_type(type, [&] <typename T> () {
+                    GcThreadFrontEnd* gc_tfe = vm_gc_tfe(static_cast<VirtualMachine*>(ctx));
+                    return element_to_object<T>(gc_tfe, ref_name.c_str(), v->data<T>()[i]);
+                });
+            },
+            {"vec", "pos"},
+            "acquires the element of vec at pos, first slot at index 0",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            set_name,
+            [](void*, OBJECT vec, OBJECT pos, OBJECT it) -> OBJECT {
+                NumVectorObject* v = expect_num_vector_of_type(set_name.c_str(), type, vec);
+                size_t i = expect_index(set_name.c_str(), pos, v->count());
+                with_element_type(type, [&] <typename T> () {
+                    v->data<T>()[i] = element_from_object<T>(set_name.c_str(), it);
+                });
+                return OBJECT::null;
+            },
+            {"vec", "pos", "it"}
+        );
+    }
+
+    // expect_elementwise_args checks the args of an elementwise procedure: each of 'dst', 'a', and 'b' must
+    // hold `dst`'s element type, and 'a' and 'b' at least its count.
+    static void expect_elementwise_args(
+        char const* proc_name, OBJECT dst, OBJECT a, OBJECT b,
+        NumVectorObject** dst_p, NumVectorObject** a_p, NumVectorObject** b_p
+    ) {
+        *dst_p = expect_num_vector(proc_name, "first", dst);
+        *a_p = expect_num_vector(proc_name, "second", a);
+        *b_p = expect_num_vector(proc_name, "third", b);
+        expect_same_shape(proc_name, *dst_p, {*a_p, *b_p});
+    }
+
+    void bind_standard_num_vector_procedures(VirtualMachine* vm) {
+        bind_typed_num_vector_procedures<NumVectorType::F64>(vm);
+        bind_typed_num_vector_procedures<NumVectorType::F32>(vm);
+        bind_typed_num_vector_procedures<NumVectorType::S64>(vm);
+        bind_typed_num_vector_procedures<NumVectorType::U8>(vm);
+
+        // elementwise: each writes 'dst', and returns it.
+        vm_bind_platform_procedure(vm,
+            "numvec-add!",
+            [](void*, OBJECT dst, OBJECT a, OBJECT b) -> OBJECT {
+                NumVectorObject *dst_p, *a_p, *b_p;
+                expect_elementwise_args("numvec-add!", dst, a, b, &dst_p, &a_p, &b_p);
+                with_element_type(dst_p->type(), [&] <typename T> () {
+                    NumVectorKernels<T>::add(dst_p->data<T>(), a_p->data<T>(), b_p->data<T>(), dst_p->count());
+                });
+                return dst;
+            },
+            {"dst", "a", "b"},
+            "stores a[i] + b[i] in each dst[i], returning dst"
+        );
+        vm_bind_platform_procedure(vm,
+            "numvec-mul!",
+            [](void*, OBJECT dst, OBJECT a, OBJECT b) -> OBJECT {
+                NumVectorObject *dst_p, *a_p, *b_p;
+                expect_elementwise_args("numvec-mul!", dst, a, b, &dst_p, &a_p, &b_p);
+                with_element_type(dst_p->type(), [&] <typename T> () {
+                    NumVectorKernels<T>::mul(dst_p->data<T>(), a_p->data<T>(), b_p->data<T>(), dst_p->count());
+                });
+                return dst;
+            },
+            {"dst", "a", "b"},
+            "stores a[i] * b[i] in each dst[i], returning dst"
+        );
+        vm_bind_platform_procedure(vm,
+            "numvec-scale!",
+            [](void*, OBJECT dst, OBJECT a, OBJECT k) -> OBJECT {
+                NumVectorObject* dst_p = expect_num_vector("numvec-scale!", "first", dst);
+                NumVectorObject* a_p = expect_num_vector("numvec-scale!", "second", a);
+                expect_same_shape("numvec-scale!", dst_p, {a_p});
+                with_element_type(dst_p->type(), [&] <typename T> () {
+                    T k_elem = element_from_object<T>("numvec-scale!", k);
+                    NumVectorKernels<T>::scale(dst_p->data<T>(), a_p->data<T>(), k_elem, dst_p->count());
+                });
+                return dst;
+            },
+            {"dst", "a", "k"},
+            "stores a[i] * k in each dst[i], returning dst"
+        );
+        vm_bind_platform_procedure(vm,
+            "numvec-fill!",
+            [](void*, OBJECT dst, OBJECT it) -> OBJECT {
+                NumVectorObject* dst_p = expect_num_vector("numvec-fill!", "first", dst);
+                with_element_type(dst_p->type(), [&] <typename T> () {
+                    NumVectorKernels<T>::fill(dst_p->data<T>(), element_from_object<T>("numvec-fill!", it), dst_p->count());
+                });
+                return dst;
+            },
+            {"dst", "it"},
+            "stores 'it' in each dst[i], returning dst"
+        );
+        vm_bind_platform_procedure(vm,
+            "numvec-copy!",
+            [](void*, OBJECT dst, OBJECT src) -> OBJECT {
+                NumVectorObject* dst_p = expect_num_vector("numvec-copy!", "first", dst);
+                NumVectorObject* src_p = expect_num_vector("numvec-copy!", "second", src);
+                expect_same_shape("numvec-copy!", src_p, {dst_p});
+                // views of one vector may overlap:
+                std::memmove(dst_p->bytes(), src_p->bytes(), src_p->count() * NumVectorObject::element_size(src_p->type()));
+                return dst;
+            },
+            {"dst", "src"},
+            "copies each src[i] into dst[i], returning dst"
+        );
+
+        // reductions:
+        vm_bind_platform_procedure(vm,
+            "numvec-dot",
+            [](void* ctx, OBJECT a, OBJECT b) -> OBJECT {
+                NumVectorObject* a_p = expect_num_vector("numvec-dot", "first", a);
+                NumVectorObject* b_p = expect_num_vector("numvec-dot", "second", b);
+                expect_same_shape("numvec-dot", a_p, {b_p});
+                return with_element_type(a_p->type(), [&] <typename T> () {
+                    auto res = NumVectorKernels<T>::dot(a_p->data<T>(), b_p->data<T>(), a_p->count());
+                    return element_to_object(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), "numvec-dot", res);
+                });
+            },
+            {"a", "b"},
+            "returns the sum of each a[i] * b[i]",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "numvec-sum",
+            [](void* ctx, OBJECT a) -> OBJECT {
+                NumVectorObject* a_p = expect_num_vector("numvec-sum", "first", a);
+                return with_element_type(a_p->type(), [&] <typename T> () {
+                    auto res = NumVectorKernels<T>::sum(a_p->data<T>(), a_p->count());
+                    return element_to_object(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), "numvec-sum", res);
+                });
+            },
+            {"a"},
+            "returns the sum of each a[i]",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "numvec-min",
+            [](void* ctx, OBJECT a) -> OBJECT {
+                NumVectorObject* a_p = expect_num_vector("numvec-min", "first", a);
+                if (a_p->count() == 0) {
+                    error("numvec-min: expected a non-empty vector");
+                    throw SsiError();
+                }
+                return with_element_type(a_p->type(), [&] <typename T> () {
+                    T res = NumVectorKernels<T>::min(a_p->data<T>(), a_p->count());
+                    return element_to_object(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), "numvec-min", res);
+                });
+            },
+            {"a"},
+            "returns the least a[i]",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "numvec-max",
+            [](void* ctx, OBJECT a) -> OBJECT {
+                NumVectorObject* a_p = expect_num_vector("numvec-max", "first", a);
+                if (a_p->count() == 0) {
+                    error("numvec-max: expected a non-empty vector");
+                    throw SsiError();
+                }
+                return with_element_type(a_p->type(), [&] <typename T> () {
+                    T res = NumVectorKernels<T>::max(a_p->data<T>(), a_p->count());
+                    return element_to_object(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), "numvec-max", res);
+                });
+            },
+            {"a"},
+            "returns the greatest a[i]",
+            vm
+        );
+
+        // views:
+        vm_bind_platform_procedure(vm,
+            "numvec-slice",
+            [](void* ctx, OBJECT a, OBJECT start, OBJECT end) -> OBJECT {
+                NumVectorObject* a_p = expect_num_vector("numvec-slice", "first", a);
+                size_t start_i = expect_index("numvec-slice", start, a_p->count() + 1);
+                size_t end_i = expect_index("numvec-slice", end, a_p->count() + 1);
+                if (end_i < start_i) {
+                    std::stringstream ss;
+                    ss << "numvec-slice: expected start <= end, got " << start << " and " << end;
+                    error(ss.str());
+                    throw SsiError();
+                }
+                GcThreadFrontEnd* gc_tfe = vm_gc_tfe(static_cast<VirtualMachine*>(ctx));
+                return OBJECT::make_num_vector_view(gc_tfe, a, start_i, end_i - start_i);
+            },
+            {"a", "start", "end"},
+            "returns a view of a[start] up to a[end], which shares a's elements",
+            vm
+        );
+    }
+
+}   // namespace ss
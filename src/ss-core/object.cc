@@ -1,9 +1,11 @@
 #include "ss-core/object.hh"
 
 #include <map>
+#include <algorithm>
 #include <exception>
 
 #include <cstring>
+#include <cstddef>
 #include <cassert>
 
 #include "ss-core/config.hh"
@@ -25,33 +27,166 @@ namespace ss {
 
     constexpr gc::SizeClassIndex float64_sci = gc::sci(sizeof(Float64Object));
     constexpr gc::SizeClassIndex pair_sci = gc::sci(sizeof(PairObject));
-    constexpr gc::SizeClassIndex string_sci = gc::sci(sizeof(StringObject));
     constexpr gc::SizeClassIndex box_sci = gc::sci(sizeof(BoxObject));
-    const gc::SizeClassIndex VectorObject::sci = gc::sci(sizeof(VectorObject));
     const gc::SizeClassIndex SyntaxObject::sci = gc::sci(sizeof(SyntaxObject));
 
-    OBJECT OBJECT::make_float64(GcThreadFrontEnd* gc_tfe, double f64) {
-        auto boxed_object = new (gc_tfe, float64_sci) Float64Object(f64);
+    // new_boxed allocates and constructs a boxed object in the old space, then fills in its GC header.
+    template <typename T, typename... TArgs>
+    static T* new_boxed(GcThreadFrontEnd* gc_tfe, gc::SizeClassIndex sci, TArgs&&... args) {
+        T* ptr = new (gc_tfe, sci) T(std::forward<TArgs>(args)...);
+        ptr->init_gc_header(sci, gc_tfe->tfid());
+        gc_tfe->finish_allocation(ptr, gc::kSizeClasses[sci].size);
+        return ptr;
+    }
+    // new_young_boxed allocates and constructs a boxed object in the front-end's nursery if it is open and 
+    // has room, else in the old space, cf `GcEvacuator`.
+    template <typename T, typename... TArgs>
+    static T* new_young_boxed(GcThreadFrontEnd* gc_tfe, gc::SizeClassIndex sci, TArgs&&... args) {
+        static_assert(sizeof(T) >= sizeof(BaseBoxedObject) + sizeof(BaseBoxedObject*), "Young objects must fit a forwarding address");
+        APtr mem = gc_tfe->try_allocate_young(sci);
+        if (!mem) {
+            return new_boxed<T>(gc_tfe, sci, std::forward<TArgs>(args)...);
+        }
+        T* ptr = new (mem) T(std::forward<TArgs>(args)...);
+        ptr->init_gc_header(sci, gc_tfe->tfid(), true);
+        gc_tfe->finish_allocation(ptr, gc::kSizeClasses[sci].size);
+        return ptr;
+    }
+    // new_large_boxed allocates and constructs a boxed object above `gc::kMaxSize` in the large-object space.
+    template <typename T, typename... TArgs>
+    static T* new_large_boxed(GcThreadFrontEnd* gc_tfe, size_t byte_count, TArgs&&... args) {
+        APtr mem = gc_tfe->allocate_large_object(byte_count);
+        T* ptr = new (mem) T(std::forward<TArgs>(args)...);
+        ptr->init_gc_header(gc::OVERSIZED_SCI, gc_tfe->tfid());
+        gc_tfe->finish_allocation(ptr, byte_count);
+        return ptr;
+    }
+    // new_sized_boxed allocates and constructs a boxed object of `byte_count` in the old space, or in the 
+    // large-object space if it is above `gc::kMaxSize`.
+    template <typename T, typename... TArgs>
+    static T* new_sized_boxed(GcThreadFrontEnd* gc_tfe, size_t byte_count, TArgs&&... args) {
+        gc::SizeClassIndex sci = gc::sci(byte_count);
+        return (sci == 0) ?
+            new_large_boxed<T>(gc_tfe, byte_count, std::forward<TArgs>(args)...) :
+            new_boxed<T>(gc_tfe, sci, std::forward<TArgs>(args)...);
+    }
+    // remember_if_refers_to_young is the write barrier of an old object's initial fields.
+    static void remember_if_refers_to_young(BaseBoxedObject* obj) {
+        if (obj->gc_young()) {
+            return;
+        }
+        gc_for_each_child(obj, [obj] (OBJECT& child) { gc_write_barrier(obj, child); });
+    }
+
+    OBJECT OBJECT::make_boxed_float64(GcThreadFrontEnd* gc_tfe, double f64) {
+        auto boxed_object = new_young_boxed<Float64Object>(gc_tfe, float64_sci, f64);
         return OBJECT::make_ptr(boxed_object);
     }
     OBJECT OBJECT::make_box(GcThreadFrontEnd* gc_tfe, OBJECT stored) {
-        auto boxed_object = new(gc_tfe, box_sci) BoxObject(stored);
+        auto boxed_object = new_young_boxed<BoxObject>(gc_tfe, box_sci, stored);
+        remember_if_refers_to_young(boxed_object);
         return OBJECT::make_ptr(boxed_object);
     }
     OBJECT OBJECT::make_pair(GcThreadFrontEnd* gc_tfe, OBJECT head, OBJECT tail) {
-        auto boxed_object = new (gc_tfe, pair_sci) PairObject(head, tail);
+        auto boxed_object = new_young_boxed<PairObject>(gc_tfe, pair_sci, head, tail);
+        remember_if_refers_to_young(boxed_object);
         return OBJECT::make_ptr(boxed_object);
     }
     OBJECT OBJECT::make_string(GcThreadFrontEnd* gc_tfe, size_t byte_count, char* mv_bytes, bool collect_bytes) {
-        auto boxed_object = new (gc_tfe, string_sci) StringObject(byte_count, mv_bytes, collect_bytes);
-        return OBJECT::make_ptr(boxed_object);
+        auto ptr = new_sized_boxed<StringObject>(gc_tfe, StringObject::size_in_bytes(byte_count), byte_count);
+        if (byte_count > 0) {
+            std::memcpy(ptr->bytes(), mv_bytes, byte_count);
+        }
+        ptr->bytes()[byte_count] = '\0';
+        if (collect_bytes) {
+            delete[] mv_bytes;
+        }
+        return OBJECT::make_ptr(ptr);
+    }
+    OBJECT OBJECT::make_string(GcThreadFrontEnd* gc_tfe, size_t byte_count) {
+        auto ptr = new_sized_boxed<StringObject>(gc_tfe, StringObject::size_in_bytes(byte_count), byte_count);
+        std::memset(ptr->bytes(), 0, byte_count + 1);
+        return OBJECT::make_ptr(ptr);
+    }
+    OBJECT OBJECT::make_string_slice(GcThreadFrontEnd* gc_tfe, OBJECT base, char const* bytes, size_t byte_count) {
+        // slices of slices refer to the same base, so that chains do not form:
+        if (base.is_string() && base.as_string_p()->is_slice()) {
+            base = base.as_string_p()->base();
+        }
+        assert(base.is_string() || base.is_input_port());
+        auto ptr = new_boxed<StringObject>(gc_tfe, gc::sci(sizeof(StringObject)), byte_count, base, bytes);
+        remember_if_refers_to_young(ptr);
+        return OBJECT::make_ptr(ptr);
+    }
+    OBJECT OBJECT::make_vector(GcThreadFrontEnd* gc_tfe, std::vector<OBJECT> const& items) {
+        auto ptr = new_sized_boxed<VectorObject>(
+            gc_tfe, VectorObject::size_in_bytes(items.size()), 
+            items.size(), items.size(), OBJECT::null
+        );
+        std::copy(items.begin(), items.end(), ptr->array());
+        remember_if_refers_to_young(ptr);
+        return OBJECT::make_ptr(ptr);
+    }
+    OBJECT OBJECT::make_vector(GcThreadFrontEnd* gc_tfe, size_t count, size_t capacity, OBJECT fill) {
+        auto ptr = new_sized_boxed<VectorObject>(gc_tfe, VectorObject::size_in_bytes(capacity), count, capacity, fill);
+        remember_if_refers_to_young(ptr);
+        return OBJECT::make_ptr(ptr);
+    }
+    OBJECT OBJECT::make_num_vector(GcThreadFrontEnd* gc_tfe, NumVectorType type, size_t count) {
+        auto ptr = new_sized_boxed<NumVectorObject>(gc_tfe, NumVectorObject::size_in_bytes(type, count), type, count);
+        return OBJECT::make_ptr(ptr);
+    }
+    OBJECT OBJECT::make_num_vector_view(GcThreadFrontEnd* gc_tfe, OBJECT base, size_t start, size_t count) {
+        NumVectorObject* base_p = base.as_num_vector_p();
+        assert(start + count <= base_p->count());
+        if (!base_p->base().is_null()) {
+            // a view of a view refers to the owning vector, so that views never chain:
+            base = base_p->base();
+        }
+        NumVectorType type = base_p->type();
+        uint8_t* bytes = base_p->bytes() + start * NumVectorObject::element_size(type);
+        auto ptr = new_boxed<NumVectorObject>(gc_tfe, gc::sci(sizeof(NumVectorObject)), type, count, base, bytes);
+        remember_if_refers_to_young(ptr);
+        return OBJECT::make_ptr(ptr);
+    }
+    OBJECT OBJECT::make_syntax(GcThreadFrontEnd* gc_tfe, OBJECT data, FLocID loc, bool is_datum) {
+        auto ptr = new_boxed<SyntaxObject>(gc_tfe, SyntaxObject::sci, data, loc, is_datum);
+        remember_if_refers_to_young(ptr);
+        return OBJECT::make_ptr(ptr);
+    }
+    OBJECT OBJECT::make_closure(GcThreadFrontEnd* gc_tfe, ssize_t body, size_t free_var_count) {
+        size_t closure_size = ClosureObject::size_in_bytes(free_var_count);
+        gc::SizeClassIndex closure_sci = gc::sci(closure_size);
+        auto ptr = (closure_sci == 0) ?
+            new_large_boxed<ClosureObject>(gc_tfe, closure_size, body, free_var_count) :
+            new_young_boxed<ClosureObject>(gc_tfe, closure_sci, body, free_var_count);
+        if (!ptr->gc_young() && gc_tfe->nursery_open()) {
+            // the free variables are only filled in by the caller:
+            ptr->gc_remember();
+        }
+        return OBJECT::make_ptr(ptr);
     }
-    OBJECT OBJECT::make_vector(GcThreadFrontEnd* gc_tfe, std::vector<OBJECT> raw) {
-        auto ptr = new(gc_tfe, VectorObject::sci) VectorObject(std::move(raw));
+    OBJECT OBJECT::make_input_port(GcThreadFrontEnd* gc_tfe, IntStr path, char const* mapped_bytes, size_t mapped_count) {
+        auto ptr = new_boxed<InputPortObject>(gc_tfe, gc::sci(sizeof(InputPortObject)), path, mapped_bytes, mapped_count);
         return OBJECT::make_ptr(ptr);
     }
-    OBJECT OBJECT::make_syntax(GcThreadFrontEnd* gc_tfe, OBJECT data, FLoc loc) {
-        auto ptr = new(gc_tfe, SyntaxObject::sci) SyntaxObject{data, loc};
+    OBJECT OBJECT::make_input_port(GcThreadFrontEnd* gc_tfe, IntStr path, int fd) {
+        auto ptr = new_boxed<InputPortObject>(gc_tfe, gc::sci(sizeof(InputPortObject)), path, fd);
+        return OBJECT::make_ptr(ptr);
+    }
+    OBJECT OBJECT::make_hash_table(GcThreadFrontEnd* gc_tfe, HashTableEquivalence equivalence, size_t capacity) {
+        auto ptr = new_boxed<HashTableObject>(gc_tfe, gc::sci(sizeof(HashTableObject)), equivalence, capacity);
+        return OBJECT::make_ptr(ptr);
+    }
+    OBJECT OBJECT::make_channel(GcThreadFrontEnd* gc_tfe, ChannelKind channel_kind, size_t capacity) {
+        auto ptr = new_boxed<ChannelObject>(gc_tfe, gc::sci(sizeof(ChannelObject)), channel_kind, capacity);
+        return OBJECT::make_ptr(ptr);
+    }
+    OBJECT OBJECT::make_stack_segment(GcThreadFrontEnd* gc_tfe, OBJECT below, size_t base, size_t count, OBJECT const* items) {
+        size_t segment_size = StackSegmentObject::size_in_bytes(count);
+        auto ptr = new_sized_boxed<StackSegmentObject>(gc_tfe, segment_size, below, base, count);
+        std::copy(items, items + count, ptr->items());
+        remember_if_refers_to_young(ptr);
         return OBJECT::make_ptr(ptr);
     }
 
@@ -66,6 +201,24 @@ namespace ss {
         || is_symbol();
     }
 
+    ///
+    // layout: cf `VJit`
+    // - boxed objects have a vtable, so they are not standard-layout: GCC and Clang still lay out their
+    //   fields at fixed offsets.
+    //
+
+#if defined(__GNUC__) || defined(__clang__)
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Winvalid-offsetof"
+#endif
+    size_t BaseBoxedObject::kind_offset() { return offsetof(BaseBoxedObject, m_kind); }
+    size_t BoxObject::boxed_offset() { return offsetof(BoxObject, m_boxed); }
+    size_t PairObject::car_offset() { return offsetof(PairObject, m_car); }
+    size_t PairObject::cdr_offset() { return offsetof(PairObject, m_cdr); }
+#if defined(__GNUC__) || defined(__clang__)
+    #pragma GCC diagnostic pop
+#endif
+
     ///
     // equivalence predicates:
     // https://groups.csail.mit.edu/mac/ftpdir/scheme-7.4/doc-html/scheme_4.html
@@ -79,7 +232,7 @@ namespace ss {
     bool is_eq(OBJECT e1, OBJECT e2) {
         return e1.as_raw() == e2.as_raw();
     }
-    bool is_eqv(GcThreadFrontEnd* gc_tfe, OBJECT e1, OBJECT e2) {
+    bool is_eqv(OBJECT e1, OBJECT e2) {
         ObjectKind e1_kind = e1.kind();
         ObjectKind e2_kind = e2.kind();
         if (e1_kind != e2_kind) {
@@ -107,7 +260,7 @@ namespace ss {
                     auto s2 = static_cast<StringObject*>(e2.as_ptr());
                     return (
                         (s1->count() == s2->count()) && 
-                        (0 == strcmp(s1->bytes(), s2->bytes()))
+                        (0 == memcmp(s1->bytes(), s2->bytes(), s1->count()))
                     );
                 }
                 
@@ -116,13 +269,6 @@ namespace ss {
                     // kind-independent bit-based check:
                     return e1.as_float64() == e2.as_float64();
                 }
-                case ObjectKind::Pair: {
-                    auto p1 = e1.as_pair_p();
-                    auto p2 = e2.as_pair_p();
-                    return 
-                        is_eq(p1->car(), p2->car()) &&
-                        is_eq(p1->cdr(), p2->cdr());
-                }
                 case ObjectKind::Vector: {
                     auto v1 = e1.as_vector_p();
                     auto v2 = e2.as_vector_p();
@@ -130,17 +276,39 @@ namespace ss {
                         v1->count() == v2->count() &&
                         v1->array() == v2->array();
                 }
-                default: {
-                    std::stringstream ss;
-                    ss << "eqv?: invalid arguments: ";
-                    print_obj(list(gc_tfe, e1, e2), ss);
-                    error(ss.str());
-                    throw SsiError();
+                case ObjectKind::NumVector: {
+                    auto v1 = e1.as_num_vector_p();
+                    auto v2 = e2.as_num_vector_p();
+                    return 
+                        v1->type() == v2->type() &&
+                        v1->count() == v2->count() &&
+                        v1->bytes() == v2->bytes();
+                }
+                case ObjectKind::Pair:
+                case ObjectKind::Box:
+                case ObjectKind::InputPort:
+                case ObjectKind::HashTable:
+                case ObjectKind::Channel:
+                case ObjectKind::Syntax:
+                case ObjectKind::Closure: 
+                case ObjectKind::StackSegment:
+                {
+                    return is_eq(e1, e2);
                 }
             }
+            return false;
         }
     }
-    bool is_equal(GcThreadFrontEnd* gc_tfe, OBJECT e1, OBJECT e2) {
+    bool is_equal(OBJECT e1, OBJECT e2) {
+        // lists are compared element by element, iterating down their spines rather than recursing:
+        while (e1.is_pair() && e2.is_pair()) {
+            if (!is_equal(car(e1), car(e2))) {
+                return false;
+            }
+            e1 = cdr(e1);
+            e2 = cdr(e2);
+        }
+
         auto e1_kind = e1.kind();
         auto e2_kind = e2.kind();
 
@@ -149,31 +317,15 @@ namespace ss {
         } else {
             // e1 != null, e2 != null
             switch (e1_kind) {
-                case ObjectKind::Boolean:
-                case ObjectKind::Fixnum:
-                case ObjectKind::Float32:
-                case ObjectKind::Float64:
-                {
-                    return is_eqv(gc_tfe, e1, e2);
-                }
-                case ObjectKind::InternedSymbol: {
-                    return e1.as_symbol() == e2.as_symbol();
-                }
                 case ObjectKind::String: {
+                    // slices are equal to the strings they were read as:
                     auto s1 = static_cast<StringObject*>(e1.as_ptr());
                     auto s2 = static_cast<StringObject*>(e2.as_ptr());
                     return (
                         (s1->count() == s2->count()) && 
-                        (s1->bytes() == s2->bytes())
+                        (0 == memcmp(s1->bytes(), s2->bytes(), s1->count()))
                     );
                 }
-                case ObjectKind::Pair: {
-                    auto p1 = e1.as_pair_p();
-                    auto p2 = e2.as_pair_p();
-                    return 
-                        is_equal(gc_tfe, p1->car(), p2->car()) &&
-                        is_equal(gc_tfe, p1->cdr(), p2->cdr());
-                }
                 case ObjectKind::Vector: {
                     auto v1 = e1.as_vector_p();
                     auto v2 = e2.as_vector_p();
@@ -181,7 +333,7 @@ namespace ss {
                     if (v1->count() == v2->count()) {
                         size_t count = v1->count();
                         for (size_t i = 0; i < count; i++) {
-                            if (!is_equal(gc_tfe, v1->array()[i], v2->array()[i])) {
+                            if (!is_equal(v1->array()[i], v2->array()[i])) {
                                 return false;
                             }
                         }
@@ -190,21 +342,433 @@ namespace ss {
                         return false;
                     }
                 }
+                case ObjectKind::NumVector: {
+                    // elements are compared bitwise:
+                    auto v1 = e1.as_num_vector_p();
+                    auto v2 = e2.as_num_vector_p();
+                    return (
+                        v1->type() == v2->type() &&
+                        v1->count() == v2->count() &&
+                        0 == memcmp(v1->bytes(), v2->bytes(), v1->count() * NumVectorObject::element_size(v1->type()))
+                    );
+                }
                 default: {
-                    std::stringstream ss;
-                    ss << "eqv?: invalid arguments: ";
-                    print_obj(list(gc_tfe, e1, e2), ss);
-                    error(ss.str());
-                    throw SsiError();
+                    // atoms, and objects compared by identity:
+                    return is_eqv(e1, e2);
+                }
+            }
+        }
+    }
+
+    ///
+    // hashing:
+    // cf `HashTableObject`
+    //
+
+    // mix_hash scrambles the bits of `x`, so that nearby inputs (e.g. addresses, small integers) spread out:
+    // this is the finalizer of MurmurHash3.
+    inline static size_t mix_hash(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return static_cast<size_t>(x);
+    }
+    inline static size_t combine_hash(size_t seed, size_t h) {
+        return mix_hash(seed ^ (h + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+    }
+    inline static size_t hash_kind(ObjectKind kind) {
+        return mix_hash(static_cast<uint64_t>(kind) + 1);
+    }
+    // hash_number hashes floats by value, so that boxed and immediate flonums of one value, and both zeroes,
+    // hash alike.
+    template <typename T>
+    inline static size_t hash_number(T v) {
+        if (v == 0) {
+            v = 0;
+        }
+        if constexpr (sizeof(T) == sizeof(uint64_t)) {
+            return mix_hash(std::bit_cast<uint64_t>(v));
+        } else {
+            return mix_hash(std::bit_cast<uint32_t>(v));
+        }
+    }
+    inline static size_t hash_bytes(char const* bytes, size_t count) {
+        return std::hash<std::string_view>{}(std::string_view{bytes, count});
+    }
+
+    size_t hash_eq(OBJECT o) {
+        return mix_hash(o.as_raw());
+    }
+    size_t hash_eqv(OBJECT o) {
+        // cf `is_eqv`:
+        switch (o.kind()) {
+            case ObjectKind::Float32: {
+                return hash_number(o.as_float32());
+            }
+            case ObjectKind::Float64: {
+                return hash_number(o.as_float64());
+            }
+            case ObjectKind::String: {
+                auto s = o.as_string_p();
+                return hash_bytes(s->bytes(), s->count());
+            }
+            case ObjectKind::Vector: {
+                return mix_hash(reinterpret_cast<uint64_t>(o.as_vector_p()->array()));
+            }
+            case ObjectKind::NumVector: {
+                return mix_hash(reinterpret_cast<uint64_t>(o.as_num_vector_p()->bytes()));
+            }
+            default: {
+                return hash_eq(o);
+            }
+        }
+    }
+    // hash_equal_visit combines the hash of `o` into `seed`, visiting at most `*budget` pairs and vector items.
+    static size_t hash_equal_visit(OBJECT o, size_t seed, size_t* budget) {
+        // cf `is_equal`:
+        for (; o.is_pair() && *budget > 0; o = cdr(o)) {
+            --*budget;
+            seed = combine_hash(seed, hash_kind(ObjectKind::Pair));
+            seed = hash_equal_visit(car(o), seed, budget);
+        }
+        switch (o.kind()) {
+            case ObjectKind::Null:
+            case ObjectKind::Eof:
+            case ObjectKind::Rune:
+            case ObjectKind::Boolean:
+            case ObjectKind::Fixnum:
+            case ObjectKind::InternedSymbol:
+            {
+                return combine_hash(seed, hash_eq(o));
+            }
+            case ObjectKind::Float32:
+            case ObjectKind::Float64:
+            case ObjectKind::String:
+            {
+                return combine_hash(seed, hash_eqv(o));
+            }
+            case ObjectKind::Vector: {
+                auto v = o.as_vector_p();
+                seed = combine_hash(seed, v->count());
+                for (size_t i = 0; i < v->count() && *budget > 0; i++) {
+                    --*budget;
+                    seed = hash_equal_visit(v->array()[i], seed, budget);
                 }
+                return seed;
+            }
+            case ObjectKind::NumVector: {
+                auto v = o.as_num_vector_p();
+                size_t byte_count = v->count() * NumVectorObject::element_size(v->type());
+                seed = combine_hash(seed, static_cast<size_t>(v->type()));
+                return combine_hash(seed, hash_bytes(reinterpret_cast<char const*>(v->bytes()), byte_count));
             }
+            default: {
+                // pairs past the budget, and objects compared by identity, which may move:
+                return combine_hash(seed, hash_kind(o.kind()));
+            }
+        }
+    }
+    size_t hash_equal(OBJECT o) {
+        size_t budget = HASH_EQUAL_VISIT_LIMIT;
+        return hash_equal_visit(o, 0, &budget);
+    }
+
+    size_t ObjectHash::operator()(OBJECT key) const {
+        switch (equivalence) {
+            case HashTableEquivalence::Eq: return hash_eq(key);
+            case HashTableEquivalence::Eqv: return hash_eqv(key);
+            case HashTableEquivalence::Equal: return hash_equal(key);
+        }
+        return 0;
+    }
+    bool ObjectKeyEqual::operator()(OBJECT k1, OBJECT k2) const {
+        switch (equivalence) {
+            case HashTableEquivalence::Eq: return is_eq(k1, k2);
+            case HashTableEquivalence::Eqv: return is_eq(k1, k2) || is_eqv(k1, k2);
+            case HashTableEquivalence::Equal: return is_eq(k1, k2) || is_equal(k1, k2);
         }
+        return false;
     }
+
+    ///
+    // copying:
+    // cf `deep_copy`
+    //
+
+    inline static bool is_deep_copied(OBJECT o) {
+        if (!o.is_ptr()) {
+            return false;
+        }
+        switch (o.kind()) {
+            case ObjectKind::Pair:
+            case ObjectKind::Vector:
+            case ObjectKind::NumVector:
+            case ObjectKind::String:
+            {
+                return true;
+            }
+            default: {
+                return false;
+            }
+        }
+    }
+    OBJECT deep_copy(GcThreadFrontEnd* gc_tfe, OBJECT obj) {
+        if (!is_deep_copied(obj)) {
+            return obj;
+        }
+
+        // each object is copied once, with the fields of pairs and vectors still referring to the originals: 
+        // these are then replaced from a work-list rather than by recursion, so long lists cannot overflow the 
+        // C++ stack.
+        UnstableHashMap<BaseBoxedObject*, OBJECT> copies;
+        std::vector<OBJECT> work_list;
+        auto copy_one = [gc_tfe, &copies, &work_list] (OBJECT o) -> OBJECT {
+            if (!is_deep_copied(o)) {
+                return o;
+            }
+            auto it = copies.find(o.as_ptr());
+            if (it != copies.end()) {
+                return it->second;
+            }
+            OBJECT copy;
+            switch (o.kind()) {
+                case ObjectKind::Pair: {
+                    copy = OBJECT::make_pair(gc_tfe, car(o), cdr(o));
+                    work_list.push_back(copy);
+                } break;
+                case ObjectKind::Vector: {
+                    VectorObject* v = o.as_vector_p();
+                    copy = OBJECT::make_vector(gc_tfe, std::vector<OBJECT>{v->array(), v->array() + v->count()});
+                    work_list.push_back(copy);
+                } break;
+                case ObjectKind::NumVector: {
+                    NumVectorObject* v = o.as_num_vector_p();
+                    copy = OBJECT::make_num_vector(gc_tfe, v->type(), v->count());
+                    size_t byte_count = v->count() * NumVectorObject::element_size(v->type());
+                    std::memcpy(copy.as_num_vector_p()->bytes(), v->bytes(), byte_count);
+                } break;
+                case ObjectKind::String: {
+                    StringObject* str = o.as_string_p();
+                    if (str->is_slice()) {
+                        copy = OBJECT::make_string_slice(gc_tfe, str->base(), str->bytes(), str->count());
+                    } else {
+                        copy = OBJECT::make_string(gc_tfe, str->count());
+                        std::memcpy(copy.as_string_p()->bytes(), str->bytes(), str->count());
+                    }
+                } break;
+                default: {
+                    assert(0 && "NotImplemented: deep_copy for this kind of object");
+                } break;
+            }
+            copies.emplace(o.as_ptr(), copy);
+            return copy;
+        };
+
+        OBJECT res = copy_one(obj);
+        while (!work_list.empty()) {
+            OBJECT copy = work_list.back();
+            work_list.pop_back();
+            if (copy.is_pair()) {
+                PairObject* p = copy.as_pair_p();
+                p->set_car(copy_one(p->car()));
+                p->set_cdr(copy_one(p->cdr()));
+            } else {
+                VectorObject* v = copy.as_vector_p();
+                for (size_t i = 0; i < v->count(); i++) {
+                    v->set(i, copy_one(v->array()[i]));
+                }
+            }
+        }
+        return res;
+    }
+
     std::ostream& operator<<(std::ostream& out, const OBJECT& obj) {
         print_obj(obj, out);
         return out;
     }
 
+    ///
+    // StringObject
+    //
+
+    void StringObject::make_writable(GcThreadFrontEnd* gc_tfe) {
+        if (m_is_writable) {
+            return;
+        }
+        OBJECT copy = OBJECT::make_string(gc_tfe, m_count, m_bytes, false);
+        m_bytes = copy.as_string_p()->bytes();
+        m_base = copy;
+        m_is_writable = true;
+        gc_write_barrier(this, m_base);
+    }
+
+    ///
+    // NumVectorObject
+    //
+
+    NumVectorObject::NumVectorObject(NumVectorType type, size_t count)
+    :   BaseBoxedObject(ObjectKind::NumVector),
+        m_type(type),
+        m_count(count),
+        m_base(OBJECT::null),
+        m_bytes(nullptr)
+    {
+        uintptr_t first = reinterpret_cast<uintptr_t>(this + 1);
+        m_bytes = reinterpret_cast<uint8_t*>((first + ALIGNMENT - 1) & ~(ALIGNMENT - 1));
+        std::memset(m_bytes, 0, count * element_size(type));
+    }
+    NumVectorObject::NumVectorObject(NumVectorType type, size_t count, OBJECT base, uint8_t* bytes)
+    :   BaseBoxedObject(ObjectKind::NumVector),
+        m_type(type),
+        m_count(count),
+        m_base(base),
+        m_bytes(bytes)
+    {}
+
+    ///
+    // HashTableObject
+    //
+
+    HashTableObject::HashTableObject(HashTableEquivalence equivalence, size_t capacity)
+    :   BaseBoxedObject(ObjectKind::HashTable),
+        m_map(capacity, ObjectHash{equivalence}, ObjectKeyEqual{equivalence}),
+        m_equivalence(equivalence),
+        m_has_young_keys(false),
+        m_keys_moved(false)
+    {}
+
+    OBJECT const* HashTableObject::find(OBJECT key) {
+        rehash_if_keys_moved();
+        auto it = m_map.find(key);
+        return (it != m_map.end()) ? &it->second : nullptr;
+    }
+    void HashTableObject::set(OBJECT key, OBJECT value) {
+        rehash_if_keys_moved();
+        m_map[key] = value;
+        if (hashes_by_young_address(key)) {
+            // the next minor collection must visit this table even if it refers to no young object itself:
+            m_has_young_keys = true;
+            gc_remember();
+        }
+        gc_write_barrier(this, key);
+        gc_write_barrier(this, value);
+    }
+    bool HashTableObject::remove(OBJECT key) {
+        rehash_if_keys_moved();
+        return m_map.erase(key) > 0;
+    }
+    void HashTableObject::clear() {
+        m_map.clear();
+        m_has_young_keys = false;
+        m_keys_moved = false;
+    }
+
+    bool HashTableObject::hashes_by_young_address(OBJECT key) const {
+        auto is_young = [] (OBJECT o) { return o.is_ptr() && o.as_ptr()->gc_young(); };
+        switch (m_equivalence) {
+            case HashTableEquivalence::Eq: {
+                return is_young(key);
+            }
+            case HashTableEquivalence::Eqv: {
+                // cf `hash_eqv`: flonums are hashed by value.
+                return is_young(key) && !key.is_float64();
+            }
+            case HashTableEquivalence::Equal: {
+                return false;
+            }
+        }
+        return false;
+    }
+    void HashTableObject::rehash_if_keys_moved() {
+        if (!m_keys_moved) {
+            return;
+        }
+        // every young object is promoted by a minor collection, so no key is hashed by a young address after:
+        Map rehashed(m_map.size(), ObjectHash{m_equivalence}, ObjectKeyEqual{m_equivalence});
+        for (auto const& entry: m_map) {
+            rehashed.emplace(entry.first, entry.second);
+        }
+        m_map = std::move(rehashed);
+        m_has_young_keys = false;
+        m_keys_moved = false;
+    }
+
+    ///
+    // ChannelObject
+    //
+
+    ChannelObject::ChannelObject(ChannelKind channel_kind, size_t capacity)
+    :   BaseBoxedObject(ObjectKind::Channel),
+        m_channel_kind(channel_kind),
+        m_spsc_ring(channel_kind == ChannelKind::Spsc ? std::make_unique<SmtSpscRing<OBJECT>>(capacity) : nullptr),
+        m_mpsc_ring(channel_kind == ChannelKind::Mpsc ? std::make_unique<SmtMpscRing<OBJECT>>(capacity) : nullptr),
+        m_sender_id(-1),
+        m_receiver_id(-1),
+        m_mutex(),
+        m_blocked_count(0),
+        m_blocked_receiver(nullptr),
+        m_blocked_senders()
+    {}
+
+    size_t ChannelObject::capacity() const {
+        return m_spsc_ring ? m_spsc_ring->capacity() : m_mpsc_ring->capacity();
+    }
+    size_t ChannelObject::count() const {
+        return m_spsc_ring ? m_spsc_ring->size() : m_mpsc_ring->size();
+    }
+    static bool claim_channel_end(std::atomic<ssize_t>& owner_id, ssize_t id) {
+        ssize_t expected = -1;
+        return owner_id.compare_exchange_strong(expected, id) || expected == id;
+    }
+    bool ChannelObject::claim_sender(ssize_t id) {
+        return m_channel_kind == ChannelKind::Mpsc || claim_channel_end(m_sender_id, id);
+    }
+    bool ChannelObject::claim_receiver(ssize_t id) {
+        return claim_channel_end(m_receiver_id, id);
+    }
+
+    size_t ChannelObject::try_push_batch(OBJECT const* messages, size_t count) {
+        size_t pushed_count = m_spsc_ring ? 
+            m_spsc_ring->try_push_batch(messages, count) : 
+            m_mpsc_ring->try_push_batch(messages, count);
+        for (size_t i = 0; i < pushed_count; i++) {
+            gc_write_barrier(this, messages[i]);
+        }
+        return pushed_count;
+    }
+    std::optional<OBJECT> ChannelObject::try_pop() {
+        return m_spsc_ring ? m_spsc_ring->try_pop() : m_mpsc_ring->try_pop();
+    }
+    size_t ChannelObject::try_pop_batch(OBJECT* out, size_t count) {
+        return m_spsc_ring ? m_spsc_ring->try_pop_batch(out, count) : m_mpsc_ring->try_pop_batch(out, count);
+    }
+
+    void ChannelObject::block_receiver(VThread* t) {
+        assert(m_blocked_receiver == nullptr);
+        m_blocked_receiver = t;
+        ++m_blocked_count;
+    }
+    void ChannelObject::block_sender(VThread* t) {
+        m_blocked_senders.push_back(t);
+        ++m_blocked_count;
+    }
+    bool ChannelObject::unblock(VThread* t) {
+        if (m_blocked_receiver == t) {
+            m_blocked_receiver = nullptr;
+            --m_blocked_count;
+            return true;
+        }
+        auto it = std::find(m_blocked_senders.begin(), m_blocked_senders.end(), t);
+        if (it != m_blocked_senders.end()) {
+            m_blocked_senders.erase(it);
+            --m_blocked_count;
+            return true;
+        }
+        return false;
+    }
+
     ///
     // BaseBoxedObject
     //
@@ -247,29 +811,179 @@ namespace ss {
         BaseBoxedObject::operator delete(ptr);
     }
     void BaseBoxedObject::delete_() {
-        return GcThreadFrontEnd::get_by_tfid(m_gc_tfid)->deallocate_size_class(reinterpret_cast<APtr>(this), m_sci);
+        assert(!gc_young() && "Young objects are never deleted: their nursery is reset");
+        GcThreadFrontEnd* gc_tfe = GcThreadFrontEnd::get_by_tfid(m_gc_tfid);
+        if (gc::is_oversized_sci(m_sci)) {
+            return gc_tfe->deallocate_large_object(reinterpret_cast<APtr>(this));
+        }
+        return gc_tfe->deallocate_size_class(reinterpret_cast<APtr>(this), m_sci);
+    }
+    void BaseBoxedObject::remember_slow_path() {
+        Gc::remember(this);
+    }
+
+    //
+    // GcMarker
+    //
+
+    GcMarker::GcMarker(gc::PageMap& page_map)
+    :   m_page_map(page_map),
+        m_work_list(),
+        m_marked_count(0),
+        m_closure_hook(nullptr),
+        m_closure_hook_ctx(nullptr)
+    {
+        m_work_list.reserve(1024);
+    }
+    void GcMarker::mark(OBJECT root) {
+        push(root);
+        while (!m_work_list.empty()) {
+            BaseBoxedObject* obj = m_work_list.back();
+            m_work_list.pop_back();
+            trace(obj);
+        }
+    }
+    void GcMarker::mark_all(OBJECT const* roots, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            mark(roots[i]);
+        }
+    }
+    void GcMarker::push(OBJECT obj) {
+        if (!obj.is_ptr()) {
+            return;
+        }
+        BaseBoxedObject* ptr = obj.as_ptr();
+        APtr aptr = reinterpret_cast<APtr>(ptr);
+        if (!m_page_map.contains(aptr) || !m_page_map.try_mark(aptr)) {
+            return;
+        }
+        assert(m_page_map.page_info(aptr).sci == ptr->gc_sci() && "Marked an object outside its size-class's page-spans");
+        m_marked_count++;
+        m_work_list.push_back(ptr);
+    }
+    void GcMarker::trace(BaseBoxedObject* obj) {
+        if (m_closure_hook && obj->kind() == ObjectKind::Closure) {
+            m_closure_hook(m_closure_hook_ctx, static_cast<ClosureObject*>(obj));
+        }
+        gc_for_each_child(obj, [this] (OBJECT& child) { push(child); });
+    }
+
+    //
+    // GcEvacuator
+    //
+
+    GcEvacuator::GcEvacuator(GcThreadFrontEnd* promote_tfe, bool linearizes_lists)
+    :   m_promote_tfe(promote_tfe),
+        m_work_list(),
+        m_promoted_count(0),
+        m_list_link_count(0),
+        m_adjacent_link_count(0),
+        m_linearizes_lists(linearizes_lists)
+    {
+        m_work_list.reserve(1024);
+    }
+    void GcEvacuator::evacuate(OBJECT& root) {
+        if (root.is_ptr() && root.as_ptr()->gc_young()) {
+            root = OBJECT::make_ptr(promote(root.as_ptr()));
+            drain();
+        }
+    }
+    void GcEvacuator::evacuate_all(OBJECT* roots, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            evacuate(roots[i]);
+        }
+    }
+    void GcEvacuator::evacuate_children(BaseBoxedObject* old_obj) {
+        assert(!old_obj->gc_young());
+        gc_for_each_child(old_obj, [this] (OBJECT& child) { evacuate(child); });
+    }
+    BaseBoxedObject* GcEvacuator::promote(BaseBoxedObject* obj) {
+        BaseBoxedObject* copy = obj->gc_forwarded();
+        if (copy) {
+            return copy;
+        }
+        gc::SizeClassIndex sci = obj->gc_sci();
+        copy = reinterpret_cast<BaseBoxedObject*>(m_promote_tfe->allocate_size_class(sci));
+        std::memcpy(static_cast<void*>(copy), static_cast<void*>(obj), gc::kSizeClasses[sci].size);
+        copy->init_gc_header(sci, m_promote_tfe->tfid());
+        obj->gc_forward(copy);
+        m_promoted_count++;
+        m_work_list.push_back(copy);
+        return copy;
+    }
+    void GcEvacuator::drain() {
+        while (!m_work_list.empty()) {
+            BaseBoxedObject* obj = m_work_list.back();
+            m_work_list.pop_back();
+            trace(obj);
+        }
+    }
+    static bool is_young_pair(OBJECT obj) {
+        return obj.is_ptr() && obj.as_ptr()->gc_young() && obj.as_ptr()->kind() == ObjectKind::Pair;
+    }
+    void GcEvacuator::trace(BaseBoxedObject* obj) {
+        PairObject* pair = (obj->kind() == ObjectKind::Pair) ? static_cast<PairObject*>(obj) : nullptr;
+        if (pair && m_linearizes_lists) {
+            linearize_spine(pair);
+        }
+        bool is_link = pair && is_young_pair(pair->m_cdr);
+        gc_for_each_child(obj, [this] (OBJECT& child) {
+            if (child.is_ptr() && child.as_ptr()->gc_young()) {
+                child = OBJECT::make_ptr(promote(child.as_ptr()));
+            }
+        });
+        if (is_link) {
+            count_link(pair, pair->m_cdr.as_ptr());
+        }
+    }
+    // linearize_spine promotes the young pairs of the spine that begins at `copy`, one after another: each 
+    // is still on the work-list, so that its car is traced once the whole spine is promoted.
+    void GcEvacuator::linearize_spine(PairObject* copy) {
+        while (is_young_pair(copy->m_cdr)) {
+            BaseBoxedObject* cdr_copy = promote(copy->m_cdr.as_ptr());
+            copy->m_cdr = OBJECT::make_ptr(cdr_copy);
+            count_link(copy, cdr_copy);
+            copy = static_cast<PairObject*>(cdr_copy);
+        }
+    }
+    void GcEvacuator::count_link(PairObject* copy, BaseBoxedObject* cdr_copy) {
+        m_list_link_count++;
+        uint8_t* next = reinterpret_cast<uint8_t*>(copy) + gc::kSizeClasses[copy->gc_sci()].size;
+        if (reinterpret_cast<uint8_t*>(cdr_copy) == next) {
+            m_adjacent_link_count++;
+        }
     }
 
     //
     // SyntaxObject
     //
 
-    OBJECT SyntaxObject::to_datum(GcThreadFrontEnd* gc_tfe) const {
-        return SyntaxObject::data_to_datum(gc_tfe, m_data);
+    OBJECT SyntaxObject::to_datum(GcThreadFrontEnd* gc_tfe, LambdaLocTable* lambda_locs) const {
+        if (is_datum()) {
+            return m_data;
+        }
+        OBJECT datum = SyntaxObject::data_to_datum(gc_tfe, m_data, lambda_locs);
+        if (lambda_locs && datum.is_pair()) {
+            OBJECT head = datum.as_pair_p()->car();
+            if (head.is_symbol() && head.as_symbol() == g_id_cache().expanded_lambda) {
+                (*lambda_locs)[datum.as_pair_p()] = loc();
+            }
+        }
+        return datum;
     }
-    OBJECT SyntaxObject::data_to_datum(GcThreadFrontEnd* gc_tfe, OBJECT data) {
+    OBJECT SyntaxObject::data_to_datum(GcThreadFrontEnd* gc_tfe, OBJECT data, LambdaLocTable* lambda_locs) {
         if (data.is_pair()) {
-            return pair_data_to_datum(gc_tfe, data);
+            return pair_data_to_datum(gc_tfe, data, lambda_locs);
         }
         else if (data.is_vector()) {
-            return vector_data_to_datum(gc_tfe, data);
+            return vector_data_to_datum(gc_tfe, data, lambda_locs);
         }
         else {
             assert(data.is_atom());
             return data;
         }
     } 
-    OBJECT SyntaxObject::pair_data_to_datum(GcThreadFrontEnd* gc_tfe, OBJECT pair_data) {
+    OBJECT SyntaxObject::pair_data_to_datum(GcThreadFrontEnd* gc_tfe, OBJECT pair_data, LambdaLocTable* lambda_locs) {
         assert(pair_data.is_pair());
 
         // std::cerr << "pair_data_to_datum: " << pair_data << std::endl;
@@ -280,7 +994,7 @@ namespace ss {
         OBJECT new_car = OBJECT::null;
         OBJECT new_cdr = OBJECT::null;
         if (p->car().is_syntax()) {
-            new_car = p->car().as_syntax_p()->to_datum(gc_tfe);
+            new_car = p->car().as_syntax_p()->to_datum(gc_tfe, lambda_locs);
         }
         else if (p->car().is_symbol()) {
             auto sym = p->car().as_symbol();
@@ -292,9 +1006,14 @@ namespace ss {
                     return pair_data;
                 }
                 if (sym == g_id_cache().mutation) {
-                    is_pseudo_atom = true;
-                    // (mutation ...) can return as is
-                    return pair_data;
+                    // (_ 'scope 'def-id 'ldef-id init): only the init is syntax
+                    auto args = extract_args<4>(p->cdr());
+                    OBJECT init_stx = args[3];
+                    assert(init_stx.is_syntax());
+                    return list(gc_tfe,
+                        p->car(), args[0], args[1], args[2],
+                        init_stx.as_syntax_p()->to_datum(gc_tfe, lambda_locs)
+                    );
                 }
                 if (sym == g_id_cache().expanded_lambda) {
                     // (_ ((arg-syntax-object-list ...)) (non-local-vars ...) body-syntax)
@@ -309,9 +1028,9 @@ namespace ss {
                         p->car(),
                         (arg_stx_list.is_null() ?
                             arg_stx_list :
-                            pair_data_to_datum(gc_tfe, arg_stx_list)),
+                            pair_data_to_datum(gc_tfe, arg_stx_list, lambda_locs)),
                         non_local_vars,
-                        body_stx.as_syntax_p()->to_datum(gc_tfe)
+                        body_stx.as_syntax_p()->to_datum(gc_tfe, lambda_locs)
                     );
                 }
                 if (sym == g_id_cache().expanded_define) {
@@ -333,7 +1052,7 @@ namespace ss {
                         p->car(),
                         rel_var_scope_sym_obj,
                         OBJECT::make_integer(def_id),
-                        body_stx.as_syntax_p()->to_datum(gc_tfe)
+                        body_stx.as_syntax_p()->to_datum(gc_tfe, lambda_locs)
                     );
                 }
             }
@@ -349,10 +1068,10 @@ namespace ss {
 
         if (p->cdr().is_syntax()) {
             // improper list
-            new_cdr = p->cdr().as_syntax_p()->to_datum(gc_tfe);
+            new_cdr = p->cdr().as_syntax_p()->to_datum(gc_tfe, lambda_locs);
         } else if (p->cdr().is_pair()) {
             // proper list => recurse
-            new_cdr = pair_data_to_datum(gc_tfe, p->cdr());
+            new_cdr = pair_data_to_datum(gc_tfe, p->cdr(), lambda_locs);
         } else {
             assert(p->cdr().is_atom());
             new_cdr = p->cdr();
@@ -368,7 +1087,7 @@ namespace ss {
         error(ss.str());
         throw SsiError();
     }
-    OBJECT SyntaxObject::vector_data_to_datum(GcThreadFrontEnd* gc_tfe, OBJECT vec_data) {
+    OBJECT SyntaxObject::vector_data_to_datum(GcThreadFrontEnd* gc_tfe, OBJECT vec_data, LambdaLocTable* lambda_locs) {
         assert(vec_data.is_vector());
         auto p = vec_data.as_vector_p();
 
@@ -377,12 +1096,9 @@ namespace ss {
         for (ssize_t i = 0; i <p->size(); i++) {
             auto it = (*p)[i];
             assert(it.is_syntax());
-            res[i] = it.as_syntax_p()->to_datum(gc_tfe);
+            res[i] = it.as_syntax_p()->to_datum(gc_tfe, lambda_locs);
         }
-        return OBJECT::make_ptr(
-            new(gc_tfe->allocate_size_class(VectorObject::sci))
-            VectorObject(std::move(res))
-        );
+        return OBJECT::make_vector(gc_tfe, std::move(res));
     }
 
     //
@@ -390,11 +1106,10 @@ namespace ss {
     //
 
     OBJECT cpp_vector_to_list(GcThreadFrontEnd* gc_tfe, std::vector<OBJECT> const& vec) {
-        auto raw_mem = gc_tfe->allocate_bytes(sizeof(PairObject) * vec.size());
-        auto mem = reinterpret_cast<PairObject*>(raw_mem);
+        // NOTE: each pair is a separate allocation, so that each can be collected, cf `Gc::sweep`
         OBJECT lst = OBJECT::null;
         for (ssize_t i = vec.size()-1; i >= 0; i--) {
-            lst = OBJECT::make_ptr(new(mem+i) PairObject(vec[i], lst));
+            lst = OBJECT::make_pair(gc_tfe, vec[i], lst);
         }
         return lst;
     }
@@ -406,16 +1121,39 @@ namespace ss {
             throw SsiError();
         }
 #endif        
-        return cpp_vector_to_list(
-            gc_tfe, 
-            vec.as_vector_p()->as_cpp_vec()
-        );
+        VectorObject* p = vec.as_vector_p();
+        OBJECT lst = OBJECT::null;
+        for (ssize_t i = p->size()-1; i >= 0; i--) {
+            lst = OBJECT::make_pair(gc_tfe, (*p)[i], lst);
+        }
+        return lst;
     }
 
     //
     // Vector
     //
 
+    OBJECT vector_push(GcThreadFrontEnd* gc_tfe, OBJECT vec, OBJECT v) {
+#if !CONFIG_DISABLE_RUNTIME_TYPE_CHECKS
+        if (!vec.is_vector()) {
+            std::stringstream ss;
+            ss << "vector-push: expected 'vec' as first argument, got: " << vec << std::endl;
+            error(ss.str());
+            throw SsiError();
+        }
+#endif
+        VectorObject* p = vec.as_vector_p();
+        if (p->try_push(v)) {
+            return vec;
+        }
+        OBJECT grown = OBJECT::make_vector(gc_tfe, 0, std::max<size_t>(2 * p->capacity(), 4));
+        VectorObject* grown_p = grown.as_vector_p();
+        for (size_t i = 0; i < p->count(); i++) {
+            grown_p->try_push((*p)[i]);
+        }
+        grown_p->try_push(v);
+        return grown;
+    }
     std::vector<OBJECT> list_to_cpp_vector(OBJECT lst) {
         std::vector<OBJECT> res;
         for (OBJECT rem = lst; !rem.is_null(); rem = cdr(rem)) {
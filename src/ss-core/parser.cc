@@ -5,12 +5,20 @@
 #include <algorithm>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <array>
+#include <bit>
 #include <functional>
 #include <optional>
 #include <bitset>
 #include <cassert>
 #include <cstring>
 #include <cctype>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
 
 #include "ss-core/gc.hh"
 #include "ss-core/object.hh"
@@ -19,43 +27,170 @@
 #include "ss-core/feedback.hh"
 #include "ss-core/printing.hh"
 #include "ss-core/file-loc.hh"
+#include "ss-core/config.hh"
+#include "ss-core/trace.hh"
+
+#if !CONFIG_DISABLE_SIMD_LEXER && (defined(__SSE2__) || defined(_M_X64))
+    #include <emmintrin.h>
+    #define SS_LEXER_SSE2 1
+#elif !CONFIG_DISABLE_SIMD_LEXER && defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define SS_LEXER_NEON 1
+#endif
 
 namespace ss {
 
+    //
+    // Character classes:
+    // The lexer classifies each character with a table lookup, and, where SSE2 or NEON is available, runs of 
+    // whitespace, comments, identifiers, and string literals 16 bytes at a time.
+    // - only ASCII characters are in any class.
+    //
+
+    enum CharClassBits: uint8_t {
+        CHAR_CLASS_WHITESPACE = 0x1,
+        CHAR_CLASS_IDENTIFIER = 0x2,
+        CHAR_CLASS_FIRST_NUMBER = 0x4,
+        CHAR_CLASS_NEW_LINE = 0x8
+    };
+    static constexpr std::array<uint8_t, 256> CHAR_CLASS_TABLE = [] () {
+        std::array<uint8_t, 256> table{};
+        for (int c = 0; c < 128; c++) {
+            bool is_digit = (c >= '0' && c <= '9');
+            bool is_alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+            if (c == ' ' || (c >= '\t' && c <= '\r')) {
+                table[c] |= CHAR_CLASS_WHITESPACE;
+            }
+            if (is_digit || is_alpha) {
+                table[c] |= CHAR_CLASS_IDENTIFIER;
+            }
+            if (is_digit || c == '.' || c == '+' || c == '-') {
+                table[c] |= CHAR_CLASS_FIRST_NUMBER;
+            }
+            if (c == '\n' || c == '\r') {
+                table[c] |= CHAR_CLASS_NEW_LINE;
+            }
+        }
+        for (char const* it = "!$%&*+-./:<=>?@^_~"; *it; it++) {
+            table[static_cast<uint8_t>(*it)] |= CHAR_CLASS_IDENTIFIER;
+        }
+        return table;
+    }();
+    inline static bool char_has_class(char c, uint8_t class_bits) {
+        return (CHAR_CLASS_TABLE[static_cast<uint8_t>(c)] & class_bits) != 0;
+    }
+
+#if SS_LEXER_SSE2
+    #define SS_LEXER_SIMD 1
+    using ByteBlock = __m128i;
+    inline static ByteBlock bb_load(char const* p) { return _mm_loadu_si128(reinterpret_cast<__m128i const*>(p)); }
+    inline static ByteBlock bb_eq(ByteBlock v, char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); }
+    // bb_in_range: `lo <= c <= hi` for ASCII bounds: bytes past 0x7F compare as negative, so are never in range.
+    inline static ByteBlock bb_in_range(ByteBlock v, char lo, char hi) {
+        return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+    }
+    inline static ByteBlock bb_or(ByteBlock a, ByteBlock b) { return _mm_or_si128(a, b); }
+    inline static ByteBlock bb_and_not(ByteBlock a, ByteBlock not_b) { return _mm_andnot_si128(not_b, a); }
+    inline static ByteBlock bb_not(ByteBlock a) { return _mm_xor_si128(a, _mm_set1_epi8(-1)); }
+    // bb_count_leading: the number of bytes set in `mask` before the first that is not.
+    inline static size_t bb_count_leading(ByteBlock mask) {
+        uint32_t unset_bits = ~static_cast<uint32_t>(_mm_movemask_epi8(mask)) & 0xFFFFu;
+        return (unset_bits == 0) ? 16 : std::countr_zero(unset_bits);
+    }
+#elif SS_LEXER_NEON
+    #define SS_LEXER_SIMD 1
+    using ByteBlock = uint8x16_t;
+    inline static ByteBlock bb_load(char const* p) { return vld1q_u8(reinterpret_cast<uint8_t const*>(p)); }
+    inline static ByteBlock bb_eq(ByteBlock v, char c) { return vceqq_u8(v, vdupq_n_u8(static_cast<uint8_t>(c))); }
+    inline static ByteBlock bb_in_range(ByteBlock v, char lo, char hi) {
+        return vandq_u8(vcgeq_u8(v, vdupq_n_u8(static_cast<uint8_t>(lo))), vcleq_u8(v, vdupq_n_u8(static_cast<uint8_t>(hi))));
+    }
+    inline static ByteBlock bb_or(ByteBlock a, ByteBlock b) { return vorrq_u8(a, b); }
+    inline static ByteBlock bb_and_not(ByteBlock a, ByteBlock not_b) { return vbicq_u8(a, not_b); }
+    inline static ByteBlock bb_not(ByteBlock a) { return vmvnq_u8(a); }
+    inline static size_t bb_count_leading(ByteBlock mask) {
+        // narrowing each byte of the mask to 4 bits, since NEON has no 'movemask':
+        uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(mask), 4)), 0);
+        uint64_t unset_bits = ~bits;
+        return (unset_bits == 0) ? 16 : std::countr_zero(unset_bits) / 4;
+    }
+#else
+    #define SS_LEXER_SIMD 0
+#endif
+
+#if SS_LEXER_SIMD
+    inline static ByteBlock bb_whitespace(ByteBlock v) {
+        return bb_or(bb_eq(v, ' '), bb_in_range(v, '\t', '\r'));
+    }
+    inline static ByteBlock bb_identifier(ByteBlock v) {
+        // printable ASCII but for the characters that delimit tokens: cf `CHAR_CLASS_TABLE`
+        ByteBlock delimiter = bb_or(
+            bb_or(bb_in_range(v, '"', '#'), bb_in_range(v, '\'', ')')),
+            bb_or(
+                bb_or(bb_eq(v, ','), bb_eq(v, ';')), 
+                bb_or(bb_in_range(v, '[', ']'), bb_or(bb_eq(v, '`'), bb_in_range(v, '{', '}')))
+            )
+        );
+        return bb_and_not(bb_in_range(v, '!', '~'), delimiter);
+    }
+    inline static ByteBlock bb_not_new_line(ByteBlock v) {
+        return bb_not(bb_or(bb_eq(v, '\n'), bb_eq(v, '\r')));
+    }
+#endif
+
+    // scan_run returns the end of the run of characters starting at `it` for which `char_fn` holds.
+    // - `block_fn` must classify each byte of a block like `char_fn`.
+    template <typename CharFn, typename BlockFn>
+    inline static char const* scan_run(char const* it, char const* end, CharFn char_fn, BlockFn block_fn) {
+#if SS_LEXER_SIMD
+        while (end - it >= 16) {
+            size_t n = bb_count_leading(block_fn(bb_load(it)));
+            it += n;
+            if (n < 16) {
+                return it;
+            }
+        }
+#else
+        (void)block_fn;
+#endif
+        while (it < end && char_fn(*it)) {
+            it++;
+        }
+        return it;
+    }
+
     //
     // Source Reader implementation:
+    // Reads a contiguous buffer in place.
     //
 
     class SourceReader {
     private:
         std::string m_input_desc;
-        std::istream& m_input_stream;
+        char const* m_cursor;
+        char const* m_end;
         FLocPos m_cursor_pos;
-        bool m_at_eof;
 
     public:
-        SourceReader(std::string source_file_path, std::istream& file)
+        SourceReader(std::string source_file_path, std::string_view source, FLocPos first_pos)
         :   m_input_desc(std::move(source_file_path)),
-            m_input_stream(file),
-            m_cursor_pos({0, 0}),
-            m_at_eof(false)
+            m_cursor(source.data()),
+            m_end(source.data() + source.size()),
+            m_cursor_pos(first_pos)
         {}
 
     public:
         std::string const& file_path() const { return m_input_desc; }
         FLocPos const& cursor_pos() const { return m_cursor_pos; }
+        char const* cursor() const { return m_cursor; }
+        char const* end() const { return m_end; }
 
     public:
-        bool eof() {
-            return m_at_eof;
+        bool eof() const {
+            return m_cursor >= m_end;
         }
-        char peek() {
-            if (!m_input_stream.eof()) {
-                return m_input_stream.peek();
-            } else {
-                m_at_eof = true;
-                return '\0';
-            }
+        char peek() const {
+            return (m_cursor < m_end) ? *m_cursor : '\0';
         }
         void get();
         bool match(char c) {
@@ -66,19 +201,27 @@ namespace ss {
                 return false;
             }
         }
+
+    public:
+        // skip_to moves the cursor to `it`, counting lines in bulk.
+        void skip_to(char const* it);
+        // skip_within_line_to moves the cursor to `it`, before which there must be no new lines.
+        void skip_within_line_to(char const* it) {
+            assert(std::none_of(m_cursor, it, [] (char c) { return char_has_class(c, CHAR_CLASS_NEW_LINE); }));
+            m_cursor_pos.column_index += it - m_cursor;
+            m_cursor = it;
+        }
     };
 
     void SourceReader::get() {
-        if (m_input_stream.eof()) {
-            m_at_eof = true;
-        } else {
-            char c = m_input_stream.get();
+        if (m_cursor < m_end) {
+            char c = *m_cursor++;
             
             bool c_is_new_line = false;
             if (c == '\r') {
-                if (m_input_stream.peek() == '\n') {
+                if (m_cursor < m_end && *m_cursor == '\n') {
                     // CRLF
-                    m_input_stream.get();
+                    m_cursor++;
                 }
                 // CR
                 c_is_new_line = true;
@@ -96,25 +239,32 @@ namespace ss {
             }
         }
     }
+    void SourceReader::skip_to(char const* it) {
+        // counting lines like `get`: LF, CR, and CRLF each end one line.
+        char const* line_start = nullptr;
+        for (char const* c = m_cursor; c < it; c++) {
+            if (*c == '\n' || (*c == '\r' && !(c+1 < m_end && c[1] == '\n'))) {
+                m_cursor_pos.line_index++;
+                line_start = c+1;
+            }
+        }
+        if (line_start) {
+            m_cursor_pos.column_index = it - line_start;
+        } else {
+            m_cursor_pos.column_index += it - m_cursor;
+        }
+        m_cursor = it;
+    }
 
     //
     // Lexer Implementation:
     //
 
     inline static bool is_first_identifier_or_number_char(char c) {
-        return isalnum(c) || !!strchr("!$%&*+-./:<=>?@^_~", c);
+        return char_has_class(c, CHAR_CLASS_IDENTIFIER);
     }
     inline static bool is_first_number_char(char c) {
-        return isdigit(c) || !!strchr(".+-", c);
-    }
-    // inline static bool is_number_char(char c) {
-    //     return isdigit(c) || !!strchr(".", c);
-    // }
-    // inline static bool is_first_identifier_char(char c) {
-    //     return isalpha(c) || !!strchr("!$%&*+-./:<=>?@^_~", c);
-    // }
-    inline static bool is_identifier_char(char c) {
-        return isalnum(c) || !!strchr("!$%&*+-./:<=>?@^_~", c);
+        return char_has_class(c, CHAR_CLASS_FIRST_NUMBER);
     }
 
     enum class TokenKind {
@@ -163,9 +313,11 @@ namespace ss {
         bool boolean;
         ssize_t integer;
         float_t floating_pt;
+        // `bytes` is copied out of the source only if the literal has escape sequences:
         struct {
             size_t count;
             char* bytes;
+            bool owns_bytes;
         } string;
     };
     struct TokenInfo {
@@ -180,7 +332,7 @@ namespace ss {
         TokenInfo m_peek_token_info;
 
     public:
-        explicit Lexer(std::istream& file, std::string file_path);
+        Lexer(std::string_view source, std::string file_path, FLocPos first_pos);
 
     public:
         SourceReader source() const { return m_source_reader; }
@@ -188,7 +340,7 @@ namespace ss {
     private:
         void advance();
         TokenKind advance_no_trim(TokenInfo* out_info_p);
-        TokenKind help_scan_one_identifier_or_number_literal(TokenInfo* out_info_p, char opt_first_char);
+        TokenKind help_scan_one_identifier_or_number_literal(TokenInfo* out_info_p);
         TokenKind help_scan_one_string_literal(TokenInfo* out_info_p, char quote_char);
         char help_scan_one_char_in_string_literal(char quote_char);
 
@@ -232,8 +384,8 @@ namespace ss {
         }
     };
 
-    Lexer::Lexer(std::istream& file, std::string file_path)
-    :   m_source_reader(std::move(file_path), file),
+    Lexer::Lexer(std::string_view source, std::string file_path, FLocPos first_pos)
+    :   m_source_reader(std::move(file_path), source, first_pos),
         m_peek_token_kind(),
         m_peek_token_info()
     {
@@ -247,21 +399,23 @@ namespace ss {
         // scanning out all leading whitespace and comments:
         for (;;) {
             // culling whitespace:
-            bool whitespace_culled = std::isspace(f.peek());
+            bool whitespace_culled = char_has_class(f.peek(), CHAR_CLASS_WHITESPACE);
             if (whitespace_culled) {
-                while (std::isspace(f.peek())) {
-                    f.get();
-                }
+                f.skip_to(scan_run(
+                    f.cursor(), f.end(), 
+                    [] (char c) { return char_has_class(c, CHAR_CLASS_WHITESPACE); }, 
+                    [] (auto v) { return bb_whitespace(v); }
+                ));
             }
 
-            // culling line-comments:
+            // culling line-comments: up to, but not including, the new line.
             bool line_comment_culled = (f.peek() == ';');
             if (line_comment_culled) {
-                char nc = f.peek();
-                while (!f.eof() && nc != '\n' && nc != '\r') {
-                    f.get();
-                    nc = f.peek();
-                }
+                f.skip_within_line_to(scan_run(
+                    f.cursor(), f.end(), 
+                    [] (char c) { return !char_has_class(c, CHAR_CLASS_NEW_LINE); }, 
+                    [] (auto v) { return bb_not_new_line(v); }
+                ));
                 continue;
             }
             
@@ -342,7 +496,7 @@ namespace ss {
 
         // identifiers & numbers:
         if (is_first_identifier_or_number_char(f.peek())) {
-            return help_scan_one_identifier_or_number_literal(out_info_p, '\0');
+            return help_scan_one_identifier_or_number_literal(out_info_p);
         }
 
         // error:
@@ -365,24 +519,24 @@ namespace ss {
             throw SsiError();
         }
     }
-    TokenKind Lexer::help_scan_one_identifier_or_number_literal(TokenInfo* out_info_p, char opt_first_char) {
-        // scanning all relevant characters into `id_name_str`:
-        std::string id_name_str;
+    TokenKind Lexer::help_scan_one_identifier_or_number_literal(TokenInfo* out_info_p) {
+        // scanning all relevant characters into `id_name`, a view of the source:
+        std::string_view id_name;
         {
             auto& f = m_source_reader;
-            std::stringstream id_name_ss;
-            if (opt_first_char) {
-                id_name_ss << opt_first_char;
-            }
-            while (!f.eof() && is_identifier_char(f.peek())) {
-                id_name_ss << f.peek();
-                f.get();
-            }
-            id_name_str = id_name_ss.str();
+            char const* id_start = f.cursor();
+            f.skip_within_line_to(scan_run(
+                id_start, f.end(), 
+                [] (char c) { return char_has_class(c, CHAR_CLASS_IDENTIFIER); }, 
+                [] (auto v) { return bb_identifier(v); }
+            ));
+            id_name = std::string_view{id_start, static_cast<size_t>(f.cursor() - id_start)};
         }
 
         // checking if this ID is actually a number:
-        if (!id_name_str.empty() && is_first_number_char(id_name_str[0])) {
+        if (!id_name.empty() && is_first_number_char(id_name[0])) {
+            std::string id_name_str{id_name};
+
             // need to deduce if this ID actually refers to a number.
             // this is true if it only contains digits, up to 1 '.' character, and up to 1 '+' or '-' initially.
 
@@ -437,10 +591,10 @@ namespace ss {
         }
 
         // since this is a bonafide identifier (not a number literal), we can now intern it and return the 'ID' TokenKind.
-        if (id_name_str == ".") {
+        if (id_name == ".") {
             return TokenKind::Period;
         } else {
-            out_info_p->as.identifier = intern(id_name_str);
+            out_info_p->as.identifier = intern(id_name);
             return TokenKind::Identifier;
         }
     }
@@ -448,25 +602,50 @@ namespace ss {
         assert(quote_char == '"' || quote_char == '\'');
         auto& f = m_source_reader;
 
-        std::vector<char> code_points;
-
+        // scanning runs of plain characters in bulk: a literal is only copied into `code_points` if it differs from 
+        // the source, i.e. if it has escape sequences, or CRLFs, which are read as one CR like `SourceReader::get`.
+        auto is_plain_char = [quote_char] (char c) {
+            return c != quote_char && c != '\\' && !char_has_class(c, CHAR_CLASS_NEW_LINE);
+        };
+        char const* literal_start = f.cursor();
+        std::string code_points;
+        bool is_copied = false;
         while (!f.eof()) {
-            if (f.match(quote_char)) {
+            char const* run_start = f.cursor();
+            char const* run_end = scan_run(
+                run_start, f.end(), is_plain_char,
+                [quote_char] (auto v) { return bb_and_not(bb_not_new_line(v), bb_or(bb_eq(v, quote_char), bb_eq(v, '\\'))); }
+            );
+            if (is_copied) {
+                code_points.append(run_start, run_end);
+            }
+            f.skip_within_line_to(run_end);
+
+            if (f.eof() || f.peek() == quote_char) {
                 break;
             }
-            
+            bool is_crlf = (f.peek() == '\r' && f.end() - f.cursor() > 1 && f.cursor()[1] == '\n');
+            if (!is_copied && (f.peek() == '\\' || is_crlf)) {
+                code_points.assign(literal_start, f.cursor());
+                is_copied = true;
+            }
             char sc = help_scan_one_char_in_string_literal(quote_char);
-            code_points.push_back(sc);
+            if (is_copied) {
+                code_points.push_back(sc);
+            }
         }
+        char const* literal_end = f.cursor();
+        f.match(quote_char);
 
-        size_t data_size = code_points.size() * sizeof(char);
-        if (data_size > 0) {
+        if (is_copied) {
             out_info_p->as.string.count = code_points.size();
             out_info_p->as.string.bytes = new char[code_points.size()];
-            memcpy(out_info_p->as.string.bytes, code_points.data(), data_size); 
+            out_info_p->as.string.owns_bytes = true;
+            memcpy(out_info_p->as.string.bytes, code_points.data(), code_points.size());
         } else {
-            out_info_p->as.string.count = 0;
-            out_info_p->as.string.bytes = nullptr;
+            out_info_p->as.string.count = literal_end - literal_start;
+            out_info_p->as.string.bytes = const_cast<char*>(literal_start);
+            out_info_p->as.string.owns_bytes = false;
         }
         return TokenKind::String;
     }
@@ -504,21 +683,25 @@ namespace ss {
 
     class Parser {
     private:
+        std::string m_read_source;
         Lexer m_lexer;
         IntStr m_source;
+        FLocTable* m_locs;
         GcThreadFrontEnd* m_gc_tfe;
     public:
-        explicit Parser(std::istream& istream, std::string file_path, GcThreadFrontEnd* gc_tfe);
+        Parser(std::string_view source, std::string file_path, GcThreadFrontEnd* gc_tfe, FLocPos first_pos = {0, 0});
+        Parser(std::istream& istream, std::string file_path, GcThreadFrontEnd* gc_tfe);
     public:
         std::optional<OBJECT> parse_next_line();
         void run_lexer_test();
     private:
         OBJECT parse_top_level_line();
+        OBJECT parse_constant_data(FLocSpan* out_span);
         OBJECT try_parse_constant();
-        OBJECT parse_datum();
+        OBJECT parse_datum(FLocPos* out_last_pos);
         
         template <bool contents_is_datum_not_exp>
-        OBJECT parse_list();
+        OBJECT parse_list(FLocPos* out_last_pos = nullptr);
         
         OBJECT parse_form();
     
@@ -526,9 +709,24 @@ namespace ss {
         GcThreadFrontEnd* gc_tfe() const { return m_gc_tfe; }
     };
 
+    static std::string read_whole_stream(std::istream& input_stream) {
+        std::stringstream ss;
+        ss << input_stream.rdbuf();
+        return ss.str();
+    }
+
+    Parser::Parser(std::string_view source, std::string input_desc, GcThreadFrontEnd* gc_tfe, FLocPos first_pos) 
+    :   m_read_source(),
+        m_lexer(source, input_desc, first_pos),
+        m_source(intern(input_desc)),
+        m_locs(nullptr),
+        m_gc_tfe(gc_tfe)
+    {}
     Parser::Parser(std::istream& input_stream, std::string input_desc, GcThreadFrontEnd* gc_tfe) 
-    :   m_lexer(input_stream, input_desc),
+    :   m_read_source(read_whole_stream(input_stream)),
+        m_lexer(m_read_source, input_desc, {0, 0}),
         m_source(intern(input_desc)),
+        m_locs(nullptr),
         m_gc_tfe(gc_tfe)
     {}
 
@@ -541,54 +739,40 @@ namespace ss {
         }
     }
     OBJECT Parser::parse_top_level_line() {
+        // each top-level form's locations are kept in a table of their own, so that it can be dropped once
+        // the form is compiled.
+        m_locs = FLocTable::create(m_source);
         return parse_form();
     }
-    OBJECT Parser::try_parse_constant() {
+    OBJECT Parser::parse_constant_data(FLocSpan* out_span) {
         TokenInfo la_ti;
         TokenKind la_tk;
 
         Lexer& ts = m_lexer;
 
         la_tk = ts.peek(&la_ti);
-        FLoc loc{m_source, la_ti.span};
+        *out_span = la_ti.span;
 
         switch (la_tk) {
             case TokenKind::Identifier: {
                 ts.skip();
-                return OBJECT::make_syntax(
-                    m_gc_tfe, 
-                    OBJECT::make_symbol(la_ti.as.identifier), 
-                    loc
-                );
+                return OBJECT::make_symbol(la_ti.as.identifier);
             }
             case TokenKind::Boolean: {
                 ts.skip();
-                return OBJECT::make_syntax(
-                    m_gc_tfe, 
-                    OBJECT::make_boolean(la_ti.as.boolean), loc
-                );
+                return OBJECT::make_boolean(la_ti.as.boolean);
             }
             case TokenKind::Integer: {
                 ts.skip();
-                return OBJECT::make_syntax(
-                    m_gc_tfe, 
-                    OBJECT::make_integer(la_ti.as.integer), loc
-                );
+                return OBJECT::make_integer(la_ti.as.integer);
             }
             case TokenKind::Float: {
                 ts.skip();
-                return OBJECT::make_syntax(
-                    m_gc_tfe, 
-                    OBJECT::make_float64(m_gc_tfe, la_ti.as.floating_pt), loc
-                );
+                return OBJECT::make_float64(m_gc_tfe, la_ti.as.floating_pt);
             }
             case TokenKind::String: {
                 ts.skip();
-                return OBJECT::make_syntax(
-                    m_gc_tfe, 
-                    OBJECT::make_string(m_gc_tfe, la_ti.as.string.count, la_ti.as.string.bytes, true), 
-                    loc
-                );
+                return OBJECT::make_string(m_gc_tfe, la_ti.as.string.count, la_ti.as.string.bytes, la_ti.as.string.owns_bytes);
             }
             default: {
                 error("Expected constant, got unknown character.");
@@ -596,7 +780,13 @@ namespace ss {
             }
         }
     }
-    OBJECT Parser::parse_datum() {
+    OBJECT Parser::try_parse_constant() {
+        FLocSpan span;
+        OBJECT data = parse_constant_data(&span);
+        return OBJECT::make_syntax(m_gc_tfe, data, m_locs->add(span));
+    }
+    // parse_datum parses quoted data, which is not wrapped in syntax objects: cf `SyntaxObject::is_datum`.
+    OBJECT Parser::parse_datum(FLocPos* out_last_pos) {
         TokenInfo la_ti;
         TokenKind la_tk;
 
@@ -611,14 +801,15 @@ namespace ss {
             case TokenKind::Float:
             case TokenKind::String: 
             {
-                auto out = try_parse_constant();
-                assert(out.is_syntax());
+                FLocSpan span;
+                OBJECT out = parse_constant_data(&span);
+                if (out_last_pos) {
+                    *out_last_pos = span.last_pos;
+                }
                 return out;
             }
             case TokenKind::LParen: {
-                auto out = parse_list<true>();
-                assert(out.is_syntax());
-                return out;
+                return parse_list<true>(out_last_pos);
             }
             default: {
                 error("Unexpected token in datum: " + std::string(tk_text(la_tk)));
@@ -650,23 +841,26 @@ namespace ss {
             }
             case TokenKind::Quote: {
                 ts.skip();
-                OBJECT quoted = parse_datum();
-                auto quoted_stx = static_cast<SyntaxObject*>(quoted.as_ptr());
-                FLocSpan span{la_ti.span.first_pos, quoted_stx->loc().span.last_pos};
+                TokenInfo quoted_ti;
+                ts.peek(&quoted_ti);
+                FLocPos quoted_last_pos;
+                OBJECT quoted = parse_datum(&quoted_last_pos);
                 
-                FLoc loc{m_source, span};
-                FLoc quote_loc{m_source, la_ti.span};
+                FLocID quote_loc = m_locs->add(la_ti.span);
+                FLocID quoted_loc = m_locs->add({quoted_ti.span.first_pos, quoted_last_pos});
+                FLocID loc = m_locs->add({la_ti.span.first_pos, quoted_last_pos});
 
+                // the quoted datum is wrapped once, as a whole:
                 return OBJECT::make_syntax(
                     m_gc_tfe,
                     list(
                         m_gc_tfe,
                         OBJECT::make_syntax(
                             m_gc_tfe,
-                            OBJECT::make_symbol(intern("quote")),
+                            OBJECT::make_symbol(g_id_cache().quote),
                             quote_loc
                         ),
-                        quoted
+                        OBJECT::make_syntax(m_gc_tfe, quoted, quoted_loc, true)
                     ), 
                     loc
                 );
@@ -679,7 +873,7 @@ namespace ss {
     }
 
     template <bool contents_is_datum_not_exp>
-    OBJECT Parser::parse_list() {
+    OBJECT Parser::parse_list(FLocPos* out_last_pos) {
         Lexer& ts = m_lexer;
 
         TokenInfo lp_token_info;
@@ -687,7 +881,7 @@ namespace ss {
 
         std::function<OBJECT()> parse_item;
         if (contents_is_datum_not_exp) {
-            parse_item = [this] () -> OBJECT { return this->parse_datum(); };
+            parse_item = [this] () -> OBJECT { return this->parse_datum(nullptr); };
         } else {
             parse_item = [this] () -> OBJECT { return this->parse_form(); };
         };
@@ -719,7 +913,7 @@ namespace ss {
                     element_object = OBJECT::make_pair(m_gc_tfe, car, cdr);
                     parsed_improper_list = true;
                 }
-                assert(element_object.is_syntax() || element_object.is_pair() || element_object.is_vector());
+                assert(contents_is_datum_not_exp || element_object.is_syntax() || element_object.is_pair());
                 list_stack.push_back(element_object);
             }
         }
@@ -735,16 +929,22 @@ namespace ss {
             throw SsiError();
         }
 
-        // composing floc before return
-        FLocSpan span;
-        span.first_pos = lp_token_info.span.first_pos;
-        span.last_pos = rp_token_info.span.last_pos;
-        FLoc loc{m_source, span};
+        // composing floc before return: data are not wrapped
+        if (out_last_pos) {
+            *out_last_pos = rp_token_info.span.last_pos;
+        }
+        auto wrap = [&] (OBJECT list_data) -> OBJECT {
+            if (contents_is_datum_not_exp) {
+                return list_data;
+            }
+            FLocSpan span{lp_token_info.span.first_pos, rp_token_info.span.last_pos};
+            return OBJECT::make_syntax(m_gc_tfe, list_data, m_locs->add(span));
+        };
         
         // popping from the stack to build the pair-list, return:
         if (parsed_improper_list && list_stack.size() == 1) {
             // singleton pair
-            return OBJECT::make_syntax(m_gc_tfe, list_stack[0], loc);
+            return wrap(list_stack[0]);
         } else {
             // consing all but the last element to the last element recursively:
             // - iff improper list, then last item in the stack is post-dot.
@@ -758,7 +958,7 @@ namespace ss {
                 pair_list = OBJECT::make_pair(m_gc_tfe, list_stack[i], pair_list);
                 list_stack.pop_back();
             }
-            return OBJECT::make_syntax(m_gc_tfe, pair_list, loc);
+            return wrap(pair_list);
         }
     }
     void Parser::run_lexer_test() {
@@ -823,16 +1023,20 @@ namespace ss {
     Parser* create_parser(std::istream& input_stream, std::string input_desc, GcThreadFrontEnd* gc_tfe) {
         return new Parser(input_stream, std::move(input_desc), gc_tfe);
     }
+    Parser* create_parser(std::string_view source, std::string input_desc, GcThreadFrontEnd* gc_tfe) {
+        return new Parser(source, std::move(input_desc), gc_tfe);
+    }
     void dispose_parser(Parser* p) {
         delete p;
     }
     std::optional<OBJECT> parse_next_line_datum(Parser* p) {
         auto res = parse_next_line(p);
         if (res.has_value()) {
-            return {
-                static_cast<SyntaxObject*>(res.value().as_ptr())
-                ->to_datum(p->gc_tfe())
-            };
+            // the datum has no use for the line's locations:
+            SyntaxObject* line_stx = res.value().as_syntax_p();
+            OBJECT datum = line_stx->to_datum(p->gc_tfe());
+            FLocTable::drop(line_stx->loc_id());
+            return {datum};
         } else {
             return {};
         }
@@ -843,6 +1047,7 @@ namespace ss {
         objs.reserve(syntax_objs.size());
         for (size_t i = 0; i < syntax_objs.size(); i++) {
             auto it = syntax_objs[i].as_syntax_p()->to_datum(p->gc_tfe());
+            FLocTable::drop(syntax_objs[i].as_syntax_p()->loc_id());
             objs.push_back(it);
         }
         return objs;
@@ -869,4 +1074,360 @@ namespace ss {
         dispose_parser(p);
     }
 
+    //
+    // Parallel parsing:
+    //
+
+    // sources are split into at most this many chunks per worker, so that workers finishing early can take more,
+    // but into none smaller than this, so that each thread has enough to do:
+    static constexpr size_t PARALLEL_CHUNKS_PER_WORKER = 4;
+    static constexpr size_t PARALLEL_MIN_CHUNK_SIZE = 64 << 10;
+
+    std::vector<SourceChunk> split_top_level_forms(std::string_view source, size_t min_chunk_size) {
+        // only parentheses, string literals, and line-comments need to be scanned to find where top-level forms 
+        // end: cf `Lexer::advance`.
+        // - positions are tracked like `SourceReader::get`, so that each chunk's locations match a serial parse.
+        std::vector<SourceChunk> chunks;
+        SourceChunk chunk{0, 0, {0, 0}};
+        FLocPos pos{0, 0};
+        size_t depth = 0;
+        size_t i = 0;
+        auto advance = [&] () {
+            char c = source[i++];
+            if (c == '\r' && i < source.size() && source[i] == '\n') {
+                i++;
+            }
+            if (c == '\r' || c == '\n') {
+                pos.line_index++;
+                pos.column_index = 0;
+            } else {
+                pos.column_index++;
+            }
+        };
+        while (i < source.size()) {
+            char c = source[i];
+            if (c == ';') {
+                while (i < source.size() && source[i] != '\n' && source[i] != '\r') {
+                    advance();
+                }
+            } else if (c == '"') {
+                advance();
+                while (i < source.size() && source[i] != '"') {
+                    if (source[i] == '\\' && i+1 < source.size()) {
+                        advance();
+                    }
+                    advance();
+                }
+                if (i < source.size()) {
+                    advance();
+                }
+            } else if (c == '(') {
+                depth++;
+                advance();
+            } else if (c == ')') {
+                // an unmatched ')' is left for the parser to report.
+                advance();
+                if (depth > 0 && --depth == 0 && i - chunk.offset >= min_chunk_size) {
+                    chunk.size = i - chunk.offset;
+                    chunks.push_back(chunk);
+                    chunk = {i, 0, pos};
+                }
+            } else {
+                advance();
+            }
+        }
+        if (chunk.offset < source.size() || chunks.empty()) {
+            chunk.size = source.size() - chunk.offset;
+            chunks.push_back(chunk);
+        }
+        return chunks;
+    }
+
+    static std::vector<OBJECT> parse_source_chunk(
+        std::string_view source, SourceChunk const& chunk, std::string const& input_desc, GcThreadFrontEnd* gc_tfe
+    ) {
+        TraceSpan span{"parse", input_desc};
+        Parser p{source.substr(chunk.offset, chunk.size), input_desc, gc_tfe, chunk.first_pos};
+        return parse_all_subsequent_lines(&p);
+    }
+
+    void parse_all_lines_in_parallel(
+        std::string_view source, std::string const& input_desc, GcThreadFrontEnd* gc_tfe, size_t worker_count,
+        std::function<void(std::vector<OBJECT>)> const& on_lines
+    ) {
+        size_t min_chunk_size = std::max(PARALLEL_MIN_CHUNK_SIZE, source.size() / std::max<size_t>(1, worker_count * PARALLEL_CHUNKS_PER_WORKER));
+        std::vector<SourceChunk> chunks = (
+            worker_count > 1 ? 
+            split_top_level_forms(source, min_chunk_size) :
+            std::vector<SourceChunk>{{0, source.size(), {0, 0}}}
+        );
+        if (chunks.size() == 1) {
+            on_lines(parse_source_chunk(source, chunks[0], input_desc, gc_tfe));
+            return;
+        }
+
+        // each worker claims the next unparsed chunk, so chunks are always claimed in source order:
+        // - parsed objects are allocated in the old space, so they outlive each worker's GC front-end.
+        struct ParsedChunk {
+            std::vector<OBJECT> lines;
+            std::exception_ptr error;
+            bool done = false;
+        };
+        std::vector<ParsedChunk> parsed_chunks(chunks.size());
+        std::mutex parsed_chunks_mutex;
+        std::condition_variable parsed_chunks_cv;
+        std::atomic<size_t> next_chunk_index{0};
+        std::atomic<bool> cancelled{false};
+        auto work = [&] () {
+            GcThreadFrontEnd worker_gc_tfe{gc_tfe->gc()};
+            for (;;) {
+                size_t chunk_index = next_chunk_index.fetch_add(1);
+                if (chunk_index >= chunks.size() || cancelled.load()) {
+                    break;
+                }
+                ParsedChunk parsed_chunk;
+                try {
+                    parsed_chunk.lines = parse_source_chunk(source, chunks[chunk_index], input_desc, &worker_gc_tfe);
+                } catch (SsiError const&) {
+                    parsed_chunk.error = std::current_exception();
+                }
+                {
+                    std::lock_guard lg{parsed_chunks_mutex};
+                    parsed_chunks[chunk_index] = std::move(parsed_chunk);
+                    parsed_chunks[chunk_index].done = true;
+                }
+                parsed_chunks_cv.notify_all();
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < std::min(worker_count, chunks.size()); i++) {
+            workers.emplace_back(work);
+        }
+
+        // handing each chunk's lines to `on_lines` in source order, stopping at the first error:
+        // - workers are joined before any error is rethrown.
+        std::exception_ptr error;
+        try {
+            for (size_t i = 0; i < chunks.size(); i++) {
+                std::vector<OBJECT> lines;
+                {
+                    std::unique_lock lock{parsed_chunks_mutex};
+                    parsed_chunks_cv.wait(lock, [&] () { return parsed_chunks[i].done; });
+                    if (parsed_chunks[i].error) {
+                        std::rethrow_exception(parsed_chunks[i].error);
+                    }
+                    lines = std::move(parsed_chunks[i].lines);
+                }
+                on_lines(std::move(lines));
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        cancelled.store(true);
+        for (std::thread& worker: workers) {
+            worker.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    //
+    // Streaming parsing:
+    //
+
+    // StreamFormReader reads one top-level form at a time from a stream into a buffer, tracking positions like
+    // `SourceReader::get`, so that each form's locations match a parse of the whole stream.
+    // - like `split_top_level_forms`, only parentheses, string literals, and line-comments are scanned: the 
+    //   parser reports any error in the form.
+    class StreamFormReader {
+    private:
+        std::istream& m_input_stream;
+        std::string m_form;
+        FLocPos m_form_first_pos;
+        FLocPos m_cursor_pos;
+
+    public:
+        explicit StreamFormReader(std::istream& input_stream)
+        :   m_input_stream(input_stream),
+            m_form(),
+            m_form_first_pos{0, 0},
+            m_cursor_pos{0, 0}
+        {}
+
+    public:
+        std::string_view form() const { return m_form; }
+        FLocPos form_first_pos() const { return m_form_first_pos; }
+
+    public:
+        // read_next_form returns false at EOF, once every form has been read.
+        bool read_next_form();
+    private:
+        int peek() { return m_input_stream.peek(); }
+        void get(bool keep);
+    };
+
+    void StreamFormReader::get(bool keep) {
+        char c = static_cast<char>(m_input_stream.get());
+        if (keep) {
+            m_form.push_back(c);
+        }
+        if (c == '\r' && m_input_stream.peek() == '\n') {
+            // CRLF
+            m_input_stream.get();
+            if (keep) {
+                m_form.push_back('\n');
+            }
+        }
+        if (c == '\r' || c == '\n') {
+            m_cursor_pos.line_index++;
+            m_cursor_pos.column_index = 0;
+        } else {
+            m_cursor_pos.column_index++;
+        }
+    }
+    bool StreamFormReader::read_next_form() {
+        // skipping whitespace and line-comments between forms: cf `Lexer::advance`
+        for (;;) {
+            int c = peek();
+            if (c == EOF) {
+                return false;
+            } else if (char_has_class(static_cast<char>(c), CHAR_CLASS_WHITESPACE)) {
+                get(false);
+            } else if (c == ';') {
+                while (peek() != EOF && !char_has_class(static_cast<char>(peek()), CHAR_CLASS_NEW_LINE)) {
+                    get(false);
+                }
+            } else {
+                break;
+            }
+        }
+
+        // reading up to the end of the form: an atom ends at the first delimiter after it, a list at its ')'
+        m_form.clear();
+        m_form_first_pos = m_cursor_pos;
+        size_t depth = 0;
+        for (;;) {
+            int c = peek();
+            if (c == EOF) {
+                return true;
+            } else if (c == ';') {
+                while (peek() != EOF && !char_has_class(static_cast<char>(peek()), CHAR_CLASS_NEW_LINE)) {
+                    get(true);
+                }
+            } else if (c == '"') {
+                get(true);
+                while (peek() != EOF && peek() != '"') {
+                    if (peek() == '\\') {
+                        get(true);
+                        if (peek() == EOF) {
+                            break;
+                        }
+                    }
+                    get(true);
+                }
+                if (peek() != EOF) {
+                    get(true);
+                }
+                if (depth == 0) {
+                    return true;
+                }
+            } else if (c == '(') {
+                depth++;
+                get(true);
+            } else if (c == ')') {
+                // an unmatched ')' is left for the parser to report.
+                get(true);
+                if (depth <= 1) {
+                    return true;
+                }
+                depth--;
+            } else if (char_has_class(static_cast<char>(c), CHAR_CLASS_WHITESPACE) || strchr("'`,", c)) {
+                // within a list, or between a quote and what it quotes.
+                get(true);
+            } else {
+                while (peek() != EOF && !char_has_class(static_cast<char>(peek()), CHAR_CLASS_WHITESPACE) && !strchr("()\";'`,", peek())) {
+                    get(true);
+                }
+                if (depth == 0) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    std::optional<size_t> find_first_form_end(std::string_view source) {
+        // cf `StreamFormReader::read_next_form`
+        size_t i = 0;
+        auto skip_line_comment = [&] () {
+            while (i < source.size() && !char_has_class(source[i], CHAR_CLASS_NEW_LINE)) {
+                i++;
+            }
+        };
+        for (;;) {
+            if (i == source.size()) {
+                return {};
+            } else if (char_has_class(source[i], CHAR_CLASS_WHITESPACE)) {
+                i++;
+            } else if (source[i] == ';') {
+                skip_line_comment();
+            } else {
+                break;
+            }
+        }
+        size_t depth = 0;
+        while (i < source.size()) {
+            char c = source[i];
+            if (c == ';') {
+                skip_line_comment();
+            } else if (c == '"') {
+                i++;
+                while (i < source.size() && source[i] != '"') {
+                    i += (source[i] == '\\') ? 2 : 1;
+                }
+                if (i >= source.size()) {
+                    return {};
+                }
+                i++;
+                if (depth == 0) {
+                    return {i};
+                }
+            } else if (c == '(') {
+                depth++;
+                i++;
+            } else if (c == ')') {
+                // an unmatched ')' is left for the parser to report.
+                i++;
+                if (depth <= 1) {
+                    return {i};
+                }
+                depth--;
+            } else if (char_has_class(c, CHAR_CLASS_WHITESPACE) || strchr("'`,", c)) {
+                i++;
+            } else {
+                while (i < source.size() && !char_has_class(source[i], CHAR_CLASS_WHITESPACE) && !strchr("()\";'`,", source[i])) {
+                    i++;
+                }
+                if (i == source.size()) {
+                    return {};
+                }
+                if (depth == 0) {
+                    return {i};
+                }
+            }
+        }
+        return {};
+    }
+
+    void parse_each_line_from_stream(
+        std::istream& input_stream, std::string const& input_desc, GcThreadFrontEnd* gc_tfe,
+        std::function<void(std::vector<OBJECT>)> const& on_lines
+    ) {
+        StreamFormReader reader{input_stream};
+        while (reader.read_next_form()) {
+            Parser p{reader.form(), input_desc, gc_tfe, reader.form_first_pos()};
+            on_lines(parse_all_subsequent_lines(&p));
+        }
+    }
+
 }   // namespace ss
@@ -0,0 +1,66 @@
+#include "ss-core/peephole.hh"
+
+namespace ss {
+
+    size_t fuse_superinstructions(VCode& code, VmExpID first_exp_id) {
+        auto const end_exp_id = code.end_exp_id(vmx_unit(first_exp_id));
+        size_t fusion_count = 0;
+
+        // pass 1: 'shift -> apply'
+        // Run first so that 'refer-global' can fuse with the result in pass 2.
+        for (VmExpID i = first_exp_id; i < end_exp_id; i++) {
+            VmExp& exp = code[i];
+            if (exp.kind == VmExpKind::Shift && code[exp.args.i_shift.x].kind == VmExpKind::Apply) {
+                exp.kind = VmExpKind::ShiftApply;
+                fusion_count++;
+            }
+        }
+
+        // pass 2: 'refer-* -> argument', 'constant -> argument', 'refer-global -> apply'
+        for (VmExpID i = first_exp_id; i < end_exp_id; i++) {
+            VmExp& exp = code[i];
+            switch (exp.kind) {
+                case VmExpKind::ReferLocal:
+                case VmExpKind::ReferFree:
+                case VmExpKind::ReferGlobal: {
+                    VmExp const& next = code[exp.args.i_refer.x];
+                    if (next.kind == VmExpKind::Argument) {
+                        switch (exp.kind) {
+                            case VmExpKind::ReferLocal: exp.kind = VmExpKind::ReferLocalPush; break;
+                            case VmExpKind::ReferFree: exp.kind = VmExpKind::ReferFreePush; break;
+                            default: exp.kind = VmExpKind::ReferGlobalPush; break;
+                        }
+                        exp.args.i_refer.x = next.args.i_argument.x;
+                        fusion_count++;
+                    }
+                    else if (exp.kind == VmExpKind::ReferGlobal && next.kind == VmExpKind::Apply) {
+                        exp.kind = VmExpKind::ReferGlobalApply;
+                        fusion_count++;
+                    } 
+                    else if (exp.kind == VmExpKind::ReferGlobal && next.kind == VmExpKind::ShiftApply) {
+                        auto gn = exp.args.i_refer.n;
+                        exp.kind = VmExpKind::ReferGlobalShiftApply;
+                        exp.args.i_refer_global_shift.gn = gn;
+                        exp.args.i_refer_global_shift.n = next.args.i_shift.n;
+                        exp.args.i_refer_global_shift.m = next.args.i_shift.m;
+                        fusion_count++;
+                    }
+                } break;
+                case VmExpKind::Constant: {
+                    VmExp const& next = code[exp.args.i_constant.x];
+                    if (next.kind == VmExpKind::Argument) {
+                        exp.kind = VmExpKind::ConstantPush;
+                        exp.args.i_constant.x = next.args.i_argument.x;
+                        fusion_count++;
+                    }
+                } break;
+                default: {
+                    // no fusion rule
+                } break;
+            }
+        }
+
+        return fusion_count;
+    }
+
+}   // namespace ss
@@ -1,9 +1,12 @@
 #include "ss-core/pinvoke.hh"
 
+#include <sstream>
+
 namespace ss {
 
     PlatformProcTable::PlatformProcTable(size_t init_capacity) {
       m_cb_table.reserve(init_capacity);
+      m_fn_table.reserve(init_capacity);
       m_metadata_table.reserve(init_capacity);
       m_id_symtab.reserve(init_capacity);
     }
@@ -24,7 +27,7 @@ namespace ss {
       bool is_variadic
     ) {
       if (m_id_symtab.find(proc_name) != m_id_symtab.end()) {
-        error("Cannot re-define platform procedure: " + interned_string(proc_name));
+        error("Cannot re-define platform procedure: " + std::string{interned_string(proc_name)});
         throw SsiError();
       }
       
@@ -35,6 +38,7 @@ namespace ss {
       auto new_id = m_cb_table.size();
       
       m_cb_table.emplace_back(std::move(cb));
+      m_fn_table.emplace_back();
       m_metadata_table.emplace_back(
         proc_name, 
         is_variadic ? -1 : static_cast<ssize_t>(arg_names.size()),
@@ -45,4 +49,59 @@ namespace ss {
       m_id_symtab[proc_name] = new_id;
       return new_id;
     }
-}
\ No newline at end of file
+    PlatformProcID PlatformProcTable::define(
+      IntStr proc_name, 
+      std::vector<IntStr> arg_names,
+      PlatformProcFn fn,
+      std::string docstring
+    ) {
+      if (fn.kind == PlatformProcFnKind::Callback) {
+        error("Cannot define platform procedure without a function-pointer: " + std::string{interned_string(proc_name)});
+        throw SsiError();
+      }
+      ssize_t arity = fn.arity();
+      if (arity >= 0 && static_cast<size_t>(arity) != arg_names.size()) {
+        std::stringstream ss;
+        ss  << "Cannot define platform procedure " << interned_string(proc_name) << ": "
+            << "function-pointer accepts " << arity << " args but " << arg_names.size() << " arg names were given";
+        error(ss.str());
+        throw SsiError();
+      }
+
+      // the boxed callback is kept for callers that only have an ArgView, e.g. inlined primitives' fallback.
+      PlatformProcCb cb = [fn] (ArgView const& args) -> OBJECT {
+        switch (fn.kind) {
+          case PlatformProcFnKind::Arity0: return fn.fn0(fn.ctx);
+          case PlatformProcFnKind::Arity1: return fn.fn1(fn.ctx, args[0]);
+          case PlatformProcFnKind::Arity2: return fn.fn2(fn.ctx, args[0], args[1]);
+          case PlatformProcFnKind::Arity3: return fn.fn3(fn.ctx, args[0], args[1], args[2]);
+          case PlatformProcFnKind::Arity4: return fn.fn4(fn.ctx, args[0], args[1], args[2], args[3]);
+          case PlatformProcFnKind::Variadic: {
+            std::vector<OBJECT> items(args.size());
+            for (ssize_t i = 0; i < args.size(); i++) {
+              items[args.size() - i - 1] = args[i];
+            }
+            return fn.fnv(fn.ctx, ArgSpan{items.data() + items.size() - 1, args.size()});
+          }
+          case PlatformProcFnKind::Callback: break;
+        }
+        return OBJECT::null;
+      };
+      PlatformProcID new_id = define(proc_name, std::move(arg_names), std::move(cb), std::move(docstring), arity < 0);
+      m_fn_table[new_id] = fn;
+      return new_id;
+    }
+
+    ssize_t PlatformProcFn::arity() const {
+      switch (kind) {
+        case PlatformProcFnKind::Arity0: return 0;
+        case PlatformProcFnKind::Arity1: return 1;
+        case PlatformProcFnKind::Arity2: return 2;
+        case PlatformProcFnKind::Arity3: return 3;
+        case PlatformProcFnKind::Arity4: return 4;
+        case PlatformProcFnKind::Variadic:
+        case PlatformProcFnKind::Callback: return -1;
+      }
+      return -1;
+    }
+}
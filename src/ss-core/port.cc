@@ -0,0 +1,357 @@
+#include "ss-core/port.hh"
+
+#include <charconv>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#include "ss-core/memory.hh"
+#include "ss-core/parser.hh"
+
+namespace ss {
+
+    //
+    // Formatting numbers:
+    //
+
+    size_t format_integer(char* out, int64_t v) {
+        // digits are written backwards into a scratch buffer, then copied out in order:
+        char digits[24];
+        char* end = digits + sizeof(digits);
+        char* it = end;
+        uint64_t mag = (v < 0) ? (~static_cast<uint64_t>(v) + 1) : static_cast<uint64_t>(v);
+        do {
+            *--it = static_cast<char>('0' + mag % 10);
+            mag /= 10;
+        } while (mag != 0);
+        if (v < 0) {
+            *--it = '-';
+        }
+        size_t count = end - it;
+        std::memcpy(out, it, count);
+        return count;
+    }
+    size_t format_float64(char* out, double v) {
+        auto res = std::to_chars(out, out + MAX_FORMATTED_NUMBER_SIZE, v, std::chars_format::general, 6);
+        assert(res.ec == std::errc{});
+        return res.ptr - out;
+    }
+    size_t format_float32(char* out, float v) {
+        auto res = std::to_chars(out, out + MAX_FORMATTED_NUMBER_SIZE, v, std::chars_format::general, 6);
+        assert(res.ec == std::errc{});
+        return res.ptr - out;
+    }
+
+    //
+    // OutputPort:
+    //
+
+    OutputPort::OutputPort(std::FILE* file, PortBufferMode mode, size_t capacity)
+    :   m_file(file),
+        m_buf(new char[std::max(capacity, MAX_FORMATTED_NUMBER_SIZE)]),
+        m_capacity(std::max(capacity, MAX_FORMATTED_NUMBER_SIZE)),
+        m_count(0),
+        m_mode(mode),
+        m_wrote_newline(false),
+        m_mutex()
+    {}
+    OutputPort::~OutputPort() {
+        flush();
+    }
+
+    void OutputPort::set_mode(PortBufferMode mode) {
+        m_mode = mode;
+    }
+
+    void OutputPort::write(char const* bytes, size_t count) {
+        if (count > m_capacity - m_count) {
+            drain();
+            if (count >= m_capacity) {
+                std::fwrite(bytes, 1, count, m_file);
+                m_wrote_newline |= (std::memchr(bytes, '\n', count) != nullptr);
+                return;
+            }
+        }
+        std::memcpy(m_buf.get() + m_count, bytes, count);
+        m_count += count;
+        if (!m_wrote_newline) {
+            m_wrote_newline = (std::memchr(bytes, '\n', count) != nullptr);
+        }
+    }
+    void OutputPort::write_integer(int64_t v) {
+        char* out = reserve(MAX_FORMATTED_NUMBER_SIZE);
+        m_count += format_integer(out, v);
+    }
+    void OutputPort::write_float64(double v) {
+        char* out = reserve(MAX_FORMATTED_NUMBER_SIZE);
+        m_count += format_float64(out, v);
+    }
+    void OutputPort::write_float32(float v) {
+        char* out = reserve(MAX_FORMATTED_NUMBER_SIZE);
+        m_count += format_float32(out, v);
+    }
+
+    void OutputPort::end_write() {
+        switch (m_mode) {
+            case PortBufferMode::Block: {
+                // only flushed when full, or on request.
+            } break;
+            case PortBufferMode::Line: {
+                if (m_wrote_newline) {
+                    flush();
+                }
+            } break;
+            case PortBufferMode::None: {
+                flush();
+            } break;
+        }
+    }
+    void OutputPort::flush() {
+        drain();
+        std::fflush(m_file);
+    }
+
+    void OutputPort::drain() {
+        if (m_count > 0) {
+            std::fwrite(m_buf.get(), 1, m_count, m_file);
+            m_count = 0;
+        }
+        m_wrote_newline = false;
+    }
+    char* OutputPort::reserve(size_t count) {
+        assert(count <= m_capacity);
+        if (count > m_capacity - m_count) {
+            drain();
+        }
+        return m_buf.get() + m_count;
+    }
+
+    //
+    // Standard ports:
+    //
+
+    static bool is_terminal(std::FILE* file) {
+    #ifdef _WIN32
+        return _isatty(_fileno(file));
+    #else
+        return isatty(fileno(file));
+    #endif
+    }
+
+    OutputPort& standard_output_port() {
+        static OutputPort s_port{stdout, is_terminal(stdout) ? PortBufferMode::Line : PortBufferMode::Block};
+        return s_port;
+    }
+    OutputPort& standard_error_port() {
+        static OutputPort s_port{stderr, PortBufferMode::None};
+        return s_port;
+    }
+    OutputPort* output_port(OutputPortID id) {
+        switch (id) {
+            case STANDARD_OUTPUT_PORT_ID: return &standard_output_port();
+            case STANDARD_ERROR_PORT_ID: return &standard_error_port();
+            default: return nullptr;
+        }
+    }
+    void flush_standard_ports() {
+        for (OutputPort* port: {&standard_output_port(), &standard_error_port()}) {
+            std::lock_guard lg{port->mutex()};
+            port->flush();
+        }
+    }
+
+    //
+    // InputPortObject:
+    //
+
+    static int os_open_for_reading(char const* path) {
+    #ifdef _WIN32
+        return _open(path, _O_RDONLY | _O_BINARY);
+    #else
+        return open(path, O_RDONLY);
+    #endif
+    }
+    static void os_close(int fd) {
+    #ifdef _WIN32
+        _close(fd);
+    #else
+        close(fd);
+    #endif
+    }
+    // os_read returns the number of bytes read, 0 at EOF, or -1 on errors: like `read`, it may read fewer bytes than 
+    // asked for, e.g. only those a pipe holds, so that reading a line does not wait for a whole chunk.
+    static ssize_t os_read(int fd, char* out, size_t count) {
+        for (;;) {
+        #ifdef _WIN32
+            ssize_t res = _read(fd, out, static_cast<unsigned>(std::min<size_t>(count, INT32_MAX)));
+        #else
+            ssize_t res = read(fd, out, count);
+        #endif
+            if (res >= 0 || errno != EINTR) {
+                return res;
+            }
+        }
+    }
+
+    InputPortObject::InputPortObject(IntStr path, char const* mapped_bytes, size_t mapped_count)
+    :   BaseBoxedObject(ObjectKind::InputPort),
+        m_path(path),
+        m_bytes(mapped_bytes),
+        m_count(mapped_count),
+        m_pos(0),
+        m_mapped_count(mapped_count),
+        m_fd(-1),
+        m_chunk(OBJECT::null),
+        m_is_closed(false)
+    {}
+    InputPortObject::InputPortObject(IntStr path, int fd)
+    :   BaseBoxedObject(ObjectKind::InputPort),
+        m_path(path),
+        m_bytes(nullptr),
+        m_count(0),
+        m_pos(0),
+        m_mapped_count(0),
+        m_fd(fd),
+        m_chunk(OBJECT::null),
+        m_is_closed(false)
+    {}
+    InputPortObject::~InputPortObject() {
+        if (m_mapped_count > 0) {
+            os_unmap_file(reinterpret_cast<APtr>(const_cast<char*>(m_bytes)), m_mapped_count);
+        }
+        if (m_fd >= 0) {
+            os_close(m_fd);
+        }
+    }
+
+    bool InputPortObject::fill(GcThreadFrontEnd* gc_tfe) {
+        if (m_fd < 0) {
+            return false;
+        }
+
+        // the bytes not yet consumed are copied to the start of the new chunk: slices of the old chunk keep it
+        // alive, so it cannot be reused.
+        size_t leftover = m_count - m_pos;
+        size_t capacity = std::max<size_t>(CONFIG_INPUT_PORT_CHUNK_BYTES, 2 * leftover);
+        OBJECT chunk = OBJECT::make_string(gc_tfe, capacity);
+        char* chunk_bytes = chunk.as_string_p()->bytes();
+        if (leftover > 0) {
+            std::memcpy(chunk_bytes, m_bytes + m_pos, leftover);
+        }
+        ssize_t read_count = os_read(m_fd, chunk_bytes + leftover, capacity - leftover);
+        if (read_count <= 0) {
+            os_close(m_fd);
+            m_fd = -1;
+            return false;
+        }
+        m_chunk = chunk;
+        gc_write_barrier(this, m_chunk);
+        m_bytes = chunk_bytes;
+        m_count = leftover + static_cast<size_t>(read_count);
+        m_pos = 0;
+        return true;
+    }
+    void InputPortObject::close() {
+        // a mapping is only unmapped once unreachable, since strings read from it may still refer to it.
+        m_is_closed = true;
+        if (m_fd >= 0) {
+            os_close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    //
+    // Reading:
+    //
+
+    OBJECT open_input_file(GcThreadFrontEnd* gc_tfe, std::string const& path) {
+        size_t mapped_count = 0;
+        APtr mapped_bytes = os_map_file(path.c_str(), &mapped_count);
+        if (mapped_bytes) {
+            return OBJECT::make_input_port(gc_tfe, intern(path), reinterpret_cast<char const*>(mapped_bytes), mapped_count);
+        }
+        // e.g. pipes, or empty files:
+        int fd = os_open_for_reading(path.c_str());
+        if (fd < 0) {
+            return OBJECT::null;
+        }
+        return OBJECT::make_input_port(gc_tfe, intern(path), fd);
+    }
+
+    OBJECT read_line(GcThreadFrontEnd* gc_tfe, InputPortObject* port) {
+        // bytes already scanned for a new line are not scanned again after a fill, which keeps them in place.
+        size_t scanned_count = 0;
+        for (;;) {
+            std::string_view available = port->available();
+            auto new_line = static_cast<char const*>(std::memchr(
+                available.data() + scanned_count, '\n', available.size() - scanned_count
+            ));
+            if (new_line || !port->fill(gc_tfe)) {
+                if (!new_line && available.empty()) {
+                    return OBJECT::eof;
+                }
+                size_t line_count = new_line ? new_line - available.data() : available.size();
+                size_t consumed_count = new_line ? line_count + 1 : line_count;
+                if (line_count > 0 && available[line_count - 1] == '\r') {
+                    line_count--;
+                }
+                OBJECT line = OBJECT::make_string_slice(gc_tfe, port->bytes_owner(), available.data(), line_count);
+                port->consume(consumed_count);
+                return line;
+            }
+            scanned_count = available.size();
+        }
+    }
+    OBJECT peek_char(GcThreadFrontEnd* gc_tfe, InputPortObject* port) {
+        if (port->available().empty() && !port->fill(gc_tfe)) {
+            return OBJECT::eof;
+        }
+        return OBJECT::make_integer(static_cast<unsigned char>(port->available()[0]));
+    }
+    OBJECT read_char(GcThreadFrontEnd* gc_tfe, InputPortObject* port) {
+        OBJECT res = peek_char(gc_tfe, port);
+        if (!res.is_eof()) {
+            port->consume(1);
+        }
+        return res;
+    }
+    OBJECT read_string(GcThreadFrontEnd* gc_tfe, InputPortObject* port, size_t count) {
+        while (port->available().size() < count && port->fill(gc_tfe)) {}
+        std::string_view available = port->available();
+        if (available.empty() && count > 0) {
+            return OBJECT::eof;
+        }
+        count = std::min(count, available.size());
+        OBJECT res = OBJECT::make_string_slice(gc_tfe, port->bytes_owner(), available.data(), count);
+        port->consume(count);
+        return res;
+    }
+    OBJECT read_datum(GcThreadFrontEnd* gc_tfe, InputPortObject* port) {
+        // reading until the whole datum is available, or there is nothing left to read:
+        std::optional<size_t> form_end;
+        while (!(form_end = find_first_form_end(port->available())) && port->fill(gc_tfe)) {}
+        std::string_view form = port->available().substr(0, form_end.value_or(port->available().size()));
+
+        Parser* parser = create_parser(form, std::string(interned_string(port->path())), gc_tfe);
+        std::optional<OBJECT> datum;
+        try {
+            datum = parse_next_line_datum(parser);
+        } catch (SsiError const&) {
+            dispose_parser(parser);
+            throw;
+        }
+        dispose_parser(parser);
+        port->consume(form.size());
+        return datum.value_or(OBJECT::eof);
+    }
+
+}   // namespace ss
@@ -6,60 +6,78 @@
 
 namespace ss {
 
-    void print_obj(OBJECT obj, std::ostream& out) {
+    // OstreamOut lets `print_obj_to` write to a `std::ostream` as it would to an `OutputPort`.
+    class OstreamOut {
+    private:
+        std::ostream& m_out;
+
+    public:
+        explicit OstreamOut(std::ostream& out): m_out(out) {}
+
+    public:
+        void put(char c) { m_out.put(c); }
+        void write(std::string_view s) { m_out.write(s.data(), s.size()); }
+        void write_integer(int64_t v) { char buf[MAX_FORMATTED_NUMBER_SIZE]; m_out.write(buf, format_integer(buf, v)); }
+        void write_float64(double v) { char buf[MAX_FORMATTED_NUMBER_SIZE]; m_out.write(buf, format_float64(buf, v)); }
+        void write_float32(float v) { char buf[MAX_FORMATTED_NUMBER_SIZE]; m_out.write(buf, format_float32(buf, v)); }
+        void write_symbol(IntStr sym) { write(interned_string(sym)); }
+    };
+
+    template <typename Out>
+    static void print_obj_to(OBJECT obj, Out& out) {
         switch (obj_kind(obj)) {
             case ObjectKind::Eof: {
-                out << "#\\eof";
-            }
+                out.write("#\\eof");
+            } break;
             case ObjectKind::Null: {
-                out << "()";
+                out.write("()");
             } break;
             case ObjectKind::Rune: {
                 throw std::runtime_error("NotImplemented: print_obj for GraunlarObjectType::Rune");
             } break;
             case ObjectKind::Boolean: {
-                out << (obj.as_boolean() ? "#t": "#f");
+                out.write(obj.as_boolean() ? "#t": "#f");
             } break;
             case ObjectKind::Fixnum: {
-                out << obj.as_integer();
+                out.write_integer(obj.as_integer());
             } break;
             case ObjectKind::Float32: {
-                out << obj.as_float32();
+                out.write_float32(obj.as_float32());
             } break;
             case ObjectKind::Float64: {
-                out << obj.as_float64();
+                out.write_float64(obj.as_float64());
             } break;
             case ObjectKind::String: {
                 auto str_obj = static_cast<StringObject*>(obj.as_ptr());
-                out << '"';
+                out.put('"');
                 for (size_t i = 0; i < str_obj->count(); i++) {
                     char cc = str_obj->bytes()[i];
                     if (cc >= 0) {
                         switch (cc) {
-                            case '\n': out << "\\n"; break;
-                            case '\r': out << "\\r"; break;
-                            case '\t': out << "\\t"; break;
-                            case '\0': out << "\\0"; break;
-                            case '"': out << "\\\""; break;
+                            case '\n': out.write("\\n"); break;
+                            case '\r': out.write("\\r"); break;
+                            case '\t': out.write("\\t"); break;
+                            case '\0': out.write("\\0"); break;
+                            case '"': out.write("\\\""); break;
                             default: {
-                                out << cc;
+                                out.put(cc);
                             } break;
                         }
                     } else {
-                        out << "\\x?";
+                        out.write("\\x?");
                     }
                 }
-                out << '"';
+                out.put('"');
             } break;
             case ObjectKind::InternedSymbol: {
-                out << interned_string(obj.as_symbol());
+                out.write_symbol(obj.as_symbol());
             } break;
             case ObjectKind::Pair: {
                 auto pair_obj = obj;
-                out << '(';
+                out.put('(');
                 if (cdr(pair_obj).is_null()) {
                     // singleton object
-                    print_obj(car(pair_obj), out);
+                    print_obj_to(car(pair_obj), out);
                 } else {
                     // (possibly improper) list or pair
                     if (cdr(pair_obj).is_pair()) {
@@ -69,41 +87,88 @@ namespace ss {
                             if (rem_list.is_pair()) {
                                 // just a regular list item
                                 auto rem_list_pair = dynamic_cast<PairObject*>(rem_list.as_ptr());
-                                print_obj(rem_list_pair->car(), out);
+                                print_obj_to(rem_list_pair->car(), out);
                                 rem_list = rem_list_pair->cdr();
                                 if (!rem_list.is_null()) {
-                                    out << ' ';
+                                    out.put(' ');
                                 }
                             } else {
                                 // improper list, with trailing '. <item>'
-                                out << ". ";
-                                print_obj(rem_list, out);
+                                out.write(". ");
+                                print_obj_to(rem_list, out);
                                 break;
                             }
                         }
                     } else {
                         // pair
-                        print_obj(car(pair_obj), out);
-                        out << " . ";
-                        print_obj(cdr(pair_obj), out);
+                        print_obj_to(car(pair_obj), out);
+                        out.write(" . ");
+                        print_obj_to(cdr(pair_obj), out);
                     }
                 }
-                out << ')';
+                out.put(')');
             } break;
             case ObjectKind::Vector: {
-                out << "<Vector>";
+                out.write("<Vector>");
+            } break;
+            case ObjectKind::NumVector: {
+                // SRFI-4 notation, e.g. '#f64(1 2.5)'
+                auto vec = obj.as_num_vector_p();
+                switch (vec->type()) {
+                    case NumVectorType::F64: out.write("#f64("); break;
+                    case NumVectorType::F32: out.write("#f32("); break;
+                    case NumVectorType::S64: out.write("#s64("); break;
+                    case NumVectorType::U8: out.write("#u8("); break;
+                }
+                for (size_t i = 0; i < vec->count(); i++) {
+                    if (i > 0) {
+                        out.put(' ');
+                    }
+                    switch (vec->type()) {
+                        case NumVectorType::F64: out.write_float64(vec->data<double>()[i]); break;
+                        case NumVectorType::F32: out.write_float32(vec->data<float>()[i]); break;
+                        case NumVectorType::S64: out.write_integer(vec->data<int64_t>()[i]); break;
+                        case NumVectorType::U8: out.write_integer(vec->data<uint8_t>()[i]); break;
+                    }
+                }
+                out.put(')');
+            } break;
+            case ObjectKind::InputPort: {
+                out.write("<InputPort>");
+            } break;
+            case ObjectKind::HashTable: {
+                out.write("<HashTable>");
+            } break;
+            case ObjectKind::Channel: {
+                out.write("<Channel>");
             } break;
             case ObjectKind::Box: {
                 auto box_obj = static_cast<BoxObject*>(obj.as_ptr());
-                out << "(box ";
-                print_obj(box_obj->boxed(), out);
-                out << ")";
+                out.write("(box ");
+                print_obj_to(box_obj->boxed(), out);
+                out.write(")");
             } break;
             case ObjectKind::Syntax: {
                 auto syntax_obj = obj.as_syntax_p();
-                out << "(syntax " << syntax_obj->data() << ")";
+                out.write("(syntax ");
+                print_obj_to(syntax_obj->data(), out);
+                out.put(')');
+            } break;
+            case ObjectKind::Closure: {
+                out.write("<Closure>");
+            } break;
+            case ObjectKind::StackSegment: {
+                out.write("<StackSegment>");
             } break;
         }
     }
 
+    void print_obj(OBJECT obj, std::ostream& out) {
+        OstreamOut ostream_out{out};
+        print_obj_to(obj, ostream_out);
+    }
+    void print_obj(OBJECT obj, OutputPort& out) {
+        print_obj_to(obj, out);
+    }
+
 }   // namespace ss
@@ -0,0 +1,120 @@
+#include "ss-core/profile.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "ss-core/intern.hh"
+
+namespace ss {
+
+    VmProfile::VmProfile()
+    :   m_op_counts(),
+        m_closure_stats(),
+        m_pproc_counts(),
+        m_last_sample_time(Clock::now()),
+        m_sample_countdown(SAMPLE_PERIOD)
+    {
+        m_op_counts.fill(0);
+    }
+
+    void VmProfile::sample(VmExpID running_body) {
+        Clock::time_point now = Clock::now();
+        m_closure_stats[running_body].time += now - m_last_sample_time;
+        m_last_sample_time = now;
+        m_sample_countdown = SAMPLE_PERIOD;
+    }
+
+    void VmProfile::merge(VmProfile const& other) {
+        for (size_t i = 0; i < VMX_KIND_COUNT; i++) {
+            m_op_counts[i] += other.m_op_counts[i];
+        }
+        for (auto const& [body, stats]: other.m_closure_stats) {
+            ClosureStats& it = m_closure_stats[body];
+            it.call_count += stats.call_count;
+            it.time += stats.time;
+        }
+        if (other.m_pproc_counts.size() > m_pproc_counts.size()) {
+            m_pproc_counts.resize(other.m_pproc_counts.size(), 0);
+        }
+        for (size_t i = 0; i < other.m_pproc_counts.size(); i++) {
+            m_pproc_counts[i] += other.m_pproc_counts[i];
+        }
+    }
+
+    std::string closure_name(VCode& code, VmExpID body) {
+        if (body == VmProfile::TOP_LEVEL_BODY) {
+            return "<top-level>";
+        }
+        FLoc const* loc = code.closure_loc(body);
+        if (loc) {
+            FLoc loc_copy = *loc;
+            return "lambda @ " + loc_copy.as_text();
+        }
+        std::stringstream ss;
+        ss << "lambda @ (" << body << ")";
+        return ss.str();
+    }
+    static double percentage(double part, double total) {
+        return (total > 0) ? (100.0 * part / total) : 0.0;
+    }
+
+    void VmProfile::print(std::ostream& out, VCode& code) const {
+        out << std::fixed << std::setprecision(1);
+
+        // instructions:
+        uint64_t total_op_count = 0;
+        std::vector<size_t> kinds;
+        for (size_t i = 0; i < VMX_KIND_COUNT; i++) {
+            total_op_count += m_op_counts[i];
+            if (m_op_counts[i] > 0) {
+                kinds.push_back(i);
+            }
+        }
+        std::sort(kinds.begin(), kinds.end(), [this] (size_t l, size_t r) { return m_op_counts[l] > m_op_counts[r]; });
+        out << "=== PROFILE: instructions (" << total_op_count << " total) ===" << std::endl;
+        for (size_t i: kinds) {
+            out << "  " << std::left << std::setw(24) << vmx_kind_name(static_cast<VmExpKind>(i)) << std::right
+                << std::setw(14) << m_op_counts[i]
+                << std::setw(8) << percentage(m_op_counts[i], total_op_count) << "%" << std::endl;
+        }
+
+        // closures, by time then by calls:
+        Clock::duration total_time{0};
+        std::vector<std::pair<VmExpID, ClosureStats>> closures;
+        for (auto const& [body, stats]: m_closure_stats) {
+            total_time += stats.time;
+            closures.push_back({body, stats});
+        }
+        std::sort(closures.begin(), closures.end(), [] (auto const& l, auto const& r) {
+            if (l.second.time != r.second.time) {
+                return l.second.time > r.second.time;
+            }
+            return l.second.call_count > r.second.call_count;
+        });
+        auto to_ms = [] (Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+        out << "=== PROFILE: closures (" << to_ms(total_time) << " ms sampled) ===" << std::endl;
+        out << "  " << std::setw(14) << "calls" << std::setw(12) << "ms" << std::setw(9) << "time" << "  closure" << std::endl;
+        for (auto const& [body, stats]: closures) {
+            out << "  " << std::setw(14) << stats.call_count
+                << std::setw(12) << to_ms(stats.time)
+                << std::setw(8) << percentage(to_ms(stats.time), to_ms(total_time)) << "%"
+                << "  " << closure_name(code, body) << std::endl;
+        }
+
+        // platform procedures:
+        std::vector<PlatformProcID> pprocs;
+        for (PlatformProcID i = 0; i < m_pproc_counts.size(); i++) {
+            if (m_pproc_counts[i] > 0) {
+                pprocs.push_back(i);
+            }
+        }
+        std::sort(pprocs.begin(), pprocs.end(), [this] (PlatformProcID l, PlatformProcID r) { return m_pproc_counts[l] > m_pproc_counts[r]; });
+        out << "=== PROFILE: platform procedures ===" << std::endl;
+        for (PlatformProcID i: pprocs) {
+            out << "  " << std::setw(14) << m_pproc_counts[i]
+                << "  " << interned_string(code.pproc_tab().metadata(i).name) << std::endl;
+        }
+    }
+
+}   // namespace ss
@@ -3,11 +3,15 @@
 #include "ss-core/feedback.hh"
 
 #include <cmath>
+#include <fstream>
 #include "ss-core/config.hh"
 #include "ss-core/vm.hh"
 #include "ss-core/object.hh"
 #include "ss-core/pinvoke.hh"
 #include "ss-core/printing.hh"
+#include "ss-core/intern.hh"
+#include "ss-core/numvec.hh"
+#include "ss-core/port.hh"
 
 ///
 // Declarations:
@@ -18,6 +22,8 @@ namespace ss {
     typedef void(*IntFoldCb)(ssize_t& accum, ssize_t item);
     typedef void(*Float32FoldCb)(float& accum, float item);
     typedef void(*Float64FoldCb)(double& accum, double item);
+    typedef bool(*IntCompareCb)(ssize_t lt, ssize_t rt);
+    typedef bool(*Float64CompareCb)(double lt, double rt);
 
     static void bind_standard_kind_predicates(VirtualMachine* vm);
     static void bind_standard_pair_procedures(VirtualMachine* vm);
@@ -26,24 +32,77 @@ namespace ss {
     static void bind_standard_vector_procedures(VirtualMachine* vm);
     static void bind_standard_logical_operators(VirtualMachine* vm);
     void bind_standard_arithmetic_procedures(VirtualMachine* vm);
+    static void bind_standard_comparison_procedures(VirtualMachine* vm);
+    static void bind_standard_prims(VirtualMachine* vm);
+    static void bind_standard_vthread_procedures(VirtualMachine* vm);
+    static void bind_standard_parallel_procedures(VirtualMachine* vm);
+    static void bind_standard_channel_procedures(VirtualMachine* vm);
+    static void bind_standard_gc_procedures(VirtualMachine* vm);
 
-    template <IntFoldCb int_fold_cb, Float32FoldCb float32_fold_cb, Float64FoldCb float64_fold_cb>
-    void bind_standard_binary_arithmetic_procedure(VirtualMachine* vm, char const* const name_str);
+    // ArithmeticArity: the args an arithmetic procedure accepts, and how it folds fewer than 2 of them.
+    // - with no args, the result is the integer identity, e.g. '(+)' is 0.
+    // - with one, the result is the arg itself, unless `unary_folds_identity`: then the identity is folded with
+    //   it, e.g. '(- x)' is '(- -0.0 x)' for a float, so that the sign of zero is flipped too.
+    struct ArithmeticArity {
+        ssize_t min_arg_count;
+        bool unary_folds_identity;
+        ssize_t int_identity;
+        double float_identity;
+    };
+    // each arithmetic and comparison procedure is a function-pointer, cf `PlatformProcFnV`, so its name and arity
+    // are template args along with its callbacks, and the VM is its `ctx`:
+    template <IntFoldCb int_fold_cb, Float32FoldCb float32_fold_cb, Float64FoldCb float64_fold_cb, char const* name_str, ArithmeticArity arity>
+    OBJECT arithmetic_procedure(void* ctx, ArgSpan args);
+    template <IntFoldCb int_fold_cb, Float32FoldCb float32_fold_cb, Float64FoldCb float64_fold_cb, char const* name_str, ArithmeticArity arity>
+    void bind_standard_arithmetic_procedure(VirtualMachine* vm);
+    static constexpr char mul_name[] = "*";
+    static constexpr char div_name[] = "/";
+    static constexpr char rem_name[] = "%";
+    static constexpr char add_name[] = "+";
+    static constexpr char sub_name[] = "-";
+    static constexpr char min_name[] = "min";
+    static constexpr char max_name[] = "max";
     inline void int_mul_cb(ssize_t& accum, ssize_t item);
     inline void int_div_cb(ssize_t& accum, ssize_t item);
     inline void int_rem_cb(ssize_t& accum, ssize_t item);
     inline void int_add_cb(ssize_t& accum, ssize_t item);
     inline void int_sub_cb(ssize_t& accum, ssize_t item);
+    inline void int_min_cb(ssize_t& accum, ssize_t item);
+    inline void int_max_cb(ssize_t& accum, ssize_t item);
     inline void float32_mul_cb(float& accum, float item);
     inline void float32_div_cb(float& accum, float item);
     inline void float32_rem_cb(float& accum, float item);
     inline void float32_add_cb(float& accum, float item);
     inline void float32_sub_cb(float& accum, float item);
+    inline void float32_min_cb(float& accum, float item);
+    inline void float32_max_cb(float& accum, float item);
     inline void float64_mul_cb(double& accum, double item);
     inline void float64_div_cb(double& accum, double item);
     inline void float64_rem_cb(double& accum, double item);
     inline void float64_add_cb(double& accum, double item);
     inline void float64_sub_cb(double& accum, double item);
+    inline void float64_min_cb(double& accum, double item);
+    inline void float64_max_cb(double& accum, double item);
+
+    template <IntCompareCb int_compare_cb, Float64CompareCb float64_compare_cb, char const* name_str>
+    OBJECT comparison_procedure(void* ctx, ArgSpan args);
+    template <IntCompareCb int_compare_cb, Float64CompareCb float64_compare_cb, char const* name_str>
+    void bind_standard_comparison_procedure(VirtualMachine* vm);
+    static constexpr char eq_name[] = "=";
+    static constexpr char lt_name[] = "<";
+    static constexpr char gt_name[] = ">";
+    static constexpr char le_name[] = "<=";
+    static constexpr char ge_name[] = ">=";
+    inline bool int_eq_cb(ssize_t lt, ssize_t rt);
+    inline bool int_lt_cb(ssize_t lt, ssize_t rt);
+    inline bool int_gt_cb(ssize_t lt, ssize_t rt);
+    inline bool int_le_cb(ssize_t lt, ssize_t rt);
+    inline bool int_ge_cb(ssize_t lt, ssize_t rt);
+    inline bool float64_eq_cb(double lt, double rt);
+    inline bool float64_lt_cb(double lt, double rt);
+    inline bool float64_gt_cb(double lt, double rt);
+    inline bool float64_le_cb(double lt, double rt);
+    inline bool float64_ge_cb(double lt, double rt);
 
 }   // namespace ss
 
@@ -56,71 +115,71 @@ namespace ss {
     void bind_standard_kind_predicates(VirtualMachine* vm) {
         vm_bind_platform_procedure(vm,
             "null?",
-            [](ArgView const& aa) -> OBJECT {
-                return boolean(is_null(aa[0]));
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(is_null(obj));
             },
             {"obj"}
         );
         vm_bind_platform_procedure(vm,
             "boolean?",
-            [](ArgView const& aa) -> OBJECT {
-                return boolean(is_boolean(aa[0]));
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(is_boolean(obj));
             },
             {"obj"}
         );
         vm_bind_platform_procedure(vm,
             "pair?",
-            [](ArgView const& aa) -> OBJECT {
-                return boolean(is_pair(aa[0]));
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(is_pair(obj));
             },
             {"obj"}
         );
         vm_bind_platform_procedure(vm,
             "procedure?",
-            [](ArgView const& aa) -> OBJECT {
-                return boolean(is_procedure(aa[0]));
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(is_procedure(obj));
             },
             {"obj"}
         );
         vm_bind_platform_procedure(vm,
             "integer?",
-            [](ArgView const& aa) -> OBJECT {
-                return boolean(is_integer(aa[0]));
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(is_integer(obj));
             },
             {"obj"}
         );
         vm_bind_platform_procedure(vm,
             "real?",
-            [](ArgView const& aa) -> OBJECT {
-                return boolean(is_float(aa[0]));
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(is_float(obj));
             },
             {"obj"}
         );
         vm_bind_platform_procedure(vm,
             "number?",
-            [](ArgView const& aa) -> OBJECT {
-                return boolean(is_number(aa[0]));
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(is_number(obj));
             },
             {"obj"}
         );
         vm_bind_platform_procedure(vm,
             "symbol?",
-            [](ArgView const& aa) -> OBJECT {
-                return boolean(is_symbol(aa[0]));
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(is_symbol(obj));
             },
             {"obj"}
         );
         vm_bind_platform_procedure(vm,
             "string?",
-            [](ArgView const& aa) -> OBJECT {
-                return boolean(is_string(aa[0]));
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(is_string(obj));
             },
             {"obj"}
         );
         vm_bind_platform_procedure(vm,
             "vector?",
-            [](ArgView const& aa) -> OBJECT {
-                return boolean(is_vector(aa[0]));
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(is_vector(obj));
             },
             {"obj"}
         );
@@ -169,13 +228,6 @@ namespace ss {
     }
 
     void bind_standard_equality_procedures(VirtualMachine* vm) {
-        vm_bind_platform_procedure(vm,
-            "=",
-            [=](ArgView const& aa) -> OBJECT {
-                return boolean(is_eqn(aa[0], aa[1]));
-            },
-            {"lt-arg", "rt-arg"}
-        );
         vm_bind_platform_procedure(vm,
             "eq?",
             [=](ArgView const& aa) -> OBJECT {
@@ -186,14 +238,14 @@ namespace ss {
         vm_bind_platform_procedure(vm,
             "eqv?",
             [=](ArgView const& aa) -> OBJECT {
-                return boolean(is_eqv(vm_gc_tfe(vm), aa[0], aa[1]));
+                return boolean(is_eqv(aa[0], aa[1]));
             },
             {"lt-arg", "rt-arg"}
         );
         vm_bind_platform_procedure(vm,
             "equal?",
             [=](ArgView const& aa) -> OBJECT {
-                return boolean(is_equal(vm_gc_tfe(vm), aa[0], aa[1]));
+                return boolean(is_equal(aa[0], aa[1]));
             },
             {"lt-arg", "rt-arg"}
         );
@@ -251,15 +303,11 @@ namespace ss {
         vm_bind_platform_procedure(vm,
             "vector",
             [=](ArgView const& aa) -> OBJECT {
-                std::vector<OBJECT> items;
-                items.reserve(aa.size());
+                OBJECT res = OBJECT::make_vector(vm_gc_tfe(vm), aa.size(), aa.size());
                 for (ssize_t i = 0; i < aa.size(); i++) {
-                    items[i] = aa[i];
+                    res.as_vector_p()->set(i, aa[i]);
                 }
-                return OBJECT::make_ptr(
-                    new(vm_gc_tfe(vm)->allocate_size_class(VectorObject::sci))
-                    VectorObject(std::move(items))
-                );
+                return res;
             },
             {"items..."},
             "constructs a list from a sequence of items",
@@ -298,7 +346,7 @@ namespace ss {
                 auto idx = aa[1].as_integer();
                 return aa[0].as_vector_p()->operator[](idx);
             },
-            {"vec, pos"},
+            {"vec", "pos"},
             "acquires the element of vec at pos, first slot at index 0"
         );
         vm_bind_platform_procedure(vm,
@@ -317,9 +365,10 @@ namespace ss {
                     throw SsiError();
                 }
                 auto idx = aa[1].as_integer();
-                return aa[0].as_vector_p()->operator[](idx) = aa[2];
+                aa[0].as_vector_p()->set(idx, aa[2]);
+                return aa[2];
             },
-            {"vec, pos", "v"},
+            {"vec", "pos", "v"},
             "acquires the element of vec at pos, first slot at index 0"
         );
     }
@@ -376,109 +425,1049 @@ namespace ss {
     }
 
     void bind_standard_arithmetic_procedures(VirtualMachine* vm) {
-        bind_standard_binary_arithmetic_procedure<int_mul_cb, float32_mul_cb, float64_mul_cb>(vm, "*");
-        bind_standard_binary_arithmetic_procedure<int_div_cb, float32_div_cb, float64_div_cb>(vm, "/");
-        bind_standard_binary_arithmetic_procedure<int_rem_cb, float32_rem_cb, float64_rem_cb>(vm, "%");
-        bind_standard_binary_arithmetic_procedure<int_add_cb, float32_add_cb, float64_add_cb>(vm, "+");
-        bind_standard_binary_arithmetic_procedure<int_sub_cb, float32_sub_cb, float64_sub_cb>(vm, "-");
+        bind_standard_arithmetic_procedure<int_mul_cb, float32_mul_cb, float64_mul_cb, mul_name, ArithmeticArity{0, false, 1, 1.0}>(vm);
+        bind_standard_arithmetic_procedure<int_div_cb, float32_div_cb, float64_div_cb, div_name, ArithmeticArity{1, true, 1, 1.0}>(vm);
+        bind_standard_arithmetic_procedure<int_rem_cb, float32_rem_cb, float64_rem_cb, rem_name, ArithmeticArity{2, false, 0, 0.0}>(vm);
+        bind_standard_arithmetic_procedure<int_add_cb, float32_add_cb, float64_add_cb, add_name, ArithmeticArity{0, false, 0, 0.0}>(vm);
+        bind_standard_arithmetic_procedure<int_sub_cb, float32_sub_cb, float64_sub_cb, sub_name, ArithmeticArity{1, true, 0, -0.0}>(vm);
+        bind_standard_arithmetic_procedure<int_min_cb, float32_min_cb, float64_min_cb, min_name, ArithmeticArity{1, false, 0, 0.0}>(vm);
+        bind_standard_arithmetic_procedure<int_max_cb, float32_max_cb, float64_max_cb, max_name, ArithmeticArity{1, false, 0, 0.0}>(vm);
     }
-    template <IntFoldCb int_fold_cb, Float32FoldCb float32_fold_cb, Float64FoldCb float64_fold_cb>
-    void bind_standard_binary_arithmetic_procedure(VirtualMachine* vm, char const* const name_str) {
-        vm_bind_platform_procedure(vm,
-            name_str,
-            [=](ArgView const& args) -> OBJECT {
-                // first, ensuring we have exactly 2 arguments:
-                if (args.size() != 2) {
-                    std::stringstream ss;
-                    ss << "Expected 2 arguments to binary arithmetic operator " << name_str << ": got 0";
-                    error(ss.str());
-                    throw SsiError();
-                }
+    // fold_arithmetic_args folds args left-to-right in an unboxed accumulator of type `T`, cf `ArithmeticArity`.
+    template <typename T, typename UnboxCb>
+    inline T fold_arithmetic_args(ArgSpan args, ArithmeticArity arity, T identity, void(*fold_cb)(T&, T), UnboxCb unbox_cb) {
+        ssize_t arg_count = args.size();
+        if (arg_count == 0) {
+            return identity;
+        }
+        T res = identity;
+        ssize_t first_index = 0;
+        if (arg_count > 1 || !arity.unary_folds_identity) {
+            res = unbox_cb(args[0]);
+            first_index = 1;
+        }
+        for (ssize_t i = first_index; i < arg_count; i++) {
+            fold_cb(res, unbox_cb(args[i]));
+        }
+        return res;
+    }
+    template <IntFoldCb int_fold_cb, Float32FoldCb float32_fold_cb, Float64FoldCb float64_fold_cb, char const* name_str, ArithmeticArity arity>
+    OBJECT arithmetic_procedure(void* ctx, ArgSpan args) {
+        // first, ensuring we have enough arguments:
+        ssize_t arg_count = args.size();
+        if (arg_count < arity.min_arg_count) {
+            std::stringstream ss;
+            ss  << "Expected at least " << arity.min_arg_count << " arguments to arithmetic operator " 
+                << name_str << ": got " << arg_count;
+            error(ss.str());
+            throw SsiError();
+        }
 
-                // next, determining the kind of the result:
-                //  - this is accomplished by performing a linear scan through the arguments
-                //  - though inefficient, this ironically improves throughput, presumably by loading cache lines 
-                //    containing each operand before 'load'
-                bool float64_operand_present = false;
-                bool float32_operand_present = false;
-                bool int_operand_present = false;
-                for (size_t i = 0; i < 2; i++) {
-                    OBJECT operand = args[i];
-                    if (operand.is_float64()) {
-                        float64_operand_present = true;
-                    } else if (operand.is_float32()) {
-                        float32_operand_present = true;
-                    } else if (operand.is_integer()) {
-                        int_operand_present = true;
-                    } else {
-                        // error:
-                        std::stringstream ss;
-                        ss << "Invalid argument to arithmetic operator " << name_str << ": ";
-                        print_obj(operand, ss);
-                        error(ss.str());
-                        throw SsiError();
-                    }
-                }
+        // next, determining the kind of the result:
+        //  - this is accomplished by performing a linear scan through the arguments
+        //  - though inefficient, this ironically improves throughput, presumably by loading cache lines 
+        //    containing each operand before 'load'
+        bool float64_operand_present = false;
+        bool float32_operand_present = false;
+        bool int_operand_present = false;
+        for (ssize_t i = 0; i < arg_count; i++) {
+            OBJECT operand = args[i];
+            if (operand.is_float64()) {
+                float64_operand_present = true;
+            } else if (operand.is_float32()) {
+                float32_operand_present = true;
+            } else if (operand.is_integer()) {
+                int_operand_present = true;
+            } else {
+                // error:
+                std::stringstream ss;
+                ss << "Invalid argument to arithmetic operator " << name_str << ": ";
+                print_obj(operand, ss);
+                error(ss.str());
+                throw SsiError();
+            }
+        }
 
-                // next, computing the result of this operation:
-                // NOTE: computation broken into several 'hot paths' for frequent operations.
-                if (!float64_operand_present && !float32_operand_present) {
-                    // adding two integers:
-                    auto& aa = args;
-                    ssize_t res = aa[0].as_integer();
-                    int_fold_cb(res, aa[1].as_integer());
-                    return OBJECT::make_integer(res);
-                }
-                else if (!int_operand_present && !float64_operand_present) {
-                    // adding two float32:
-                    auto& aa = args;
-                    auto res = aa[0].as_float32();
-                    float32_fold_cb(res, aa[1].as_float32());
-                    return OBJECT::make_float32(res);
-                }
-                else {
-                    // adding two float64:
-                    auto& aa = args;
-                    auto res = aa[0].as_float64();
-                    float64_fold_cb(res, aa[1].as_float64());
-                    return OBJECT::make_float64(vm_gc_tfe(vm), res);
-                }
-            },
-            {"lt-arg", "rt-arg"}
+        // next, folding the arguments: only the result is boxed.
+        if (!float64_operand_present && !float32_operand_present) {
+            // all integers:
+            ssize_t res = fold_arithmetic_args<ssize_t>(
+                args, arity, arity.int_identity, int_fold_cb,
+                [](OBJECT o) { return o.as_integer(); }
+            );
+            return OBJECT::make_integer(res);
+        }
+        else if (!int_operand_present && !float64_operand_present) {
+            // all float32:
+            float res = fold_arithmetic_args<float>(
+                args, arity, static_cast<float>(arity.float_identity), float32_fold_cb,
+                [](OBJECT o) { return o.as_float32(); }
+            );
+            return OBJECT::make_float32(res);
+        }
+        else {
+            // float64, or mixed kinds, promoted to float64:
+            double res = fold_arithmetic_args<double>(
+                args, arity, arity.float_identity, float64_fold_cb,
+                [](OBJECT o) { return o.to_double(); }
+            );
+            return OBJECT::make_float64(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), res);
+        }
+    }
+    template <IntFoldCb int_fold_cb, Float32FoldCb float32_fold_cb, Float64FoldCb float64_fold_cb, char const* name_str, ArithmeticArity arity>
+    void bind_standard_arithmetic_procedure(VirtualMachine* vm) {
+        vm_bind_platform_procedure(vm,
+            name_str,
+            arithmetic_procedure<int_fold_cb, float32_fold_cb, float64_fold_cb, name_str, arity>,
+            {"args..."},
+            "",
+            vm
         );
     }
+    static void check_int_divisor(ssize_t item) {
+        if (item == 0) {
+            error("Integer division by zero");
+            throw SsiError();
+        }
+    }
     inline void int_mul_cb(ssize_t& accum, ssize_t item) { accum *= item; }
-    inline void int_div_cb(ssize_t& accum, ssize_t item) { accum /= item; }
-    inline void int_rem_cb(ssize_t& accum, ssize_t item) { accum %= item; }
+    inline void int_div_cb(ssize_t& accum, ssize_t item) { check_int_divisor(item); accum /= item; }
+    inline void int_rem_cb(ssize_t& accum, ssize_t item) { check_int_divisor(item); accum %= item; }
     inline void int_add_cb(ssize_t& accum, ssize_t item) { accum += item; }
     inline void int_sub_cb(ssize_t& accum, ssize_t item) { accum -= item; }
+    inline void int_min_cb(ssize_t& accum, ssize_t item) { accum = std::min(accum, item); }
+    inline void int_max_cb(ssize_t& accum, ssize_t item) { accum = std::max(accum, item); }
     inline void float32_mul_cb(float& accum, float item) { accum *= item; }
     inline void float32_div_cb(float& accum, float item) { accum /= item; }
     inline void float32_rem_cb(float& accum, float item) { accum = fmod(accum, item); }
     inline void float32_add_cb(float& accum, float item) { accum += item; }
     inline void float32_sub_cb(float& accum, float item) { accum -= item; }
+    inline void float32_min_cb(float& accum, float item) { accum = std::fmin(accum, item); }
+    inline void float32_max_cb(float& accum, float item) { accum = std::fmax(accum, item); }
     inline void float64_mul_cb(double& accum, double item) { accum *= item; }
     inline void float64_div_cb(double& accum, double item) { accum /= item; }
     inline void float64_rem_cb(double& accum, double item) { accum = fmod(accum, item); }
     inline void float64_add_cb(double& accum, double item) { accum += item; }
     inline void float64_sub_cb(double& accum, double item) { accum -= item; }
+    inline void float64_min_cb(double& accum, double item) { accum = std::fmin(accum, item); }
+    inline void float64_max_cb(double& accum, double item) { accum = std::fmax(accum, item); }
+
+    void bind_standard_comparison_procedures(VirtualMachine* vm) {
+        bind_standard_comparison_procedure<int_eq_cb, float64_eq_cb, eq_name>(vm);
+        bind_standard_comparison_procedure<int_lt_cb, float64_lt_cb, lt_name>(vm);
+        bind_standard_comparison_procedure<int_gt_cb, float64_gt_cb, gt_name>(vm);
+        bind_standard_comparison_procedure<int_le_cb, float64_le_cb, le_name>(vm);
+        bind_standard_comparison_procedure<int_ge_cb, float64_ge_cb, ge_name>(vm);
+    }
+    template <IntCompareCb int_compare_cb, Float64CompareCb float64_compare_cb, char const* name_str>
+    OBJECT comparison_procedure(void*, ArgSpan aa) {
+        // each adjacent pair of args is compared: e.g. '(< a b c)' is '(and (< a b) (< b c))'.
+        ssize_t arg_count = aa.size();
+        if (arg_count < 1) {
+            std::stringstream ss;
+            ss << "Expected at least 1 argument to comparison operator " << name_str << ": got 0";
+            error(ss.str());
+            throw SsiError();
+        }
+        bool all_int_operands = true;
+        for (ssize_t i = 0; i < arg_count; i++) {
+            OBJECT operand = aa[i];
+            if (!operand.is_integer() && !operand.is_float32() && !operand.is_float64()) {
+                std::stringstream ss;
+                ss << "Invalid argument to comparison operator " << name_str << ": ";
+                print_obj(operand, ss);
+                error(ss.str());
+                throw SsiError();
+            }
+            all_int_operands &= operand.is_integer();
+        }
+        for (ssize_t i = 1; i < arg_count; i++) {
+            bool holds = (
+                all_int_operands ?
+                int_compare_cb(aa[i-1].as_integer(), aa[i].as_integer()) :
+                float64_compare_cb(aa[i-1].to_double(), aa[i].to_double())
+            );
+            if (!holds) {
+                return OBJECT::make_boolean(false);
+            }
+        }
+        return OBJECT::make_boolean(true);
+    }
+    template <IntCompareCb int_compare_cb, Float64CompareCb float64_compare_cb, char const* name_str>
+    void bind_standard_comparison_procedure(VirtualMachine* vm) {
+        vm_bind_platform_procedure(vm,
+            name_str,
+            comparison_procedure<int_compare_cb, float64_compare_cb, name_str>,
+            {"args..."}
+        );
+    }
+    inline bool int_eq_cb(ssize_t lt, ssize_t rt) { return lt == rt; }
+    inline bool int_lt_cb(ssize_t lt, ssize_t rt) { return lt < rt; }
+    inline bool int_gt_cb(ssize_t lt, ssize_t rt) { return lt > rt; }
+    inline bool int_le_cb(ssize_t lt, ssize_t rt) { return lt <= rt; }
+    inline bool int_ge_cb(ssize_t lt, ssize_t rt) { return lt >= rt; }
+    inline bool float64_eq_cb(double lt, double rt) { return lt == rt; }
+    inline bool float64_lt_cb(double lt, double rt) { return lt < rt; }
+    inline bool float64_gt_cb(double lt, double rt) { return lt > rt; }
+    inline bool float64_le_cb(double lt, double rt) { return lt <= rt; }
+    inline bool float64_ge_cb(double lt, double rt) { return lt >= rt; }
+
+    void bind_standard_prims(VirtualMachine* vm) {
+        // each primitive's fast-path in the VM must agree with the callbacks bound above.
+        vm_bind_platform_procedure_prim(vm, "+", VmExpKind::PrimAdd);
+        vm_bind_platform_procedure_prim(vm, "-", VmExpKind::PrimSub);
+        vm_bind_platform_procedure_prim(vm, "*", VmExpKind::PrimMul);
+        vm_bind_platform_procedure_prim(vm, "/", VmExpKind::PrimDiv);
+        vm_bind_platform_procedure_prim(vm, "%", VmExpKind::PrimRem);
+        vm_bind_platform_procedure_prim(vm, "=", VmExpKind::PrimEq);
+        vm_bind_platform_procedure_prim(vm, "<", VmExpKind::PrimLt);
+        vm_bind_platform_procedure_prim(vm, ">", VmExpKind::PrimGt);
+        vm_bind_platform_procedure_prim(vm, "<=", VmExpKind::PrimLe);
+        vm_bind_platform_procedure_prim(vm, ">=", VmExpKind::PrimGe);
+        vm_bind_platform_procedure_prim(vm, "cons", VmExpKind::PrimCons);
+        vm_bind_platform_procedure_prim(vm, "car", VmExpKind::PrimCar);
+        vm_bind_platform_procedure_prim(vm, "cdr", VmExpKind::PrimCdr);
+        vm_bind_platform_procedure_prim(vm, "null?", VmExpKind::PrimIsNull);
+        vm_bind_platform_procedure_prim(vm, "pair?", VmExpKind::PrimIsPair);
+    }
+
+    // expect_output_port returns the port 'port...' names, else the standard output port.
+    static OutputPort& expect_output_port(char const* proc_name, ArgSpan aa, ssize_t port_arg_index) {
+        if (aa.size() <= port_arg_index) {
+            return standard_output_port();
+        }
+        OBJECT id = aa[port_arg_index];
+        OutputPort* port = id.is_integer() ? output_port(id.as_integer()) : nullptr;
+        if (aa.size() > port_arg_index + 1 || port == nullptr) {
+            std::stringstream ss;
+            ss << proc_name << ": expected an optional output port, received: " << id;
+            error(ss.str());
+            throw SsiError();
+        }
+        return *port;
+    }
 
     void bind_standard_console_io_procedures(VirtualMachine* vm) {
         vm_bind_platform_procedure(vm,
             "display",
-            [=](ArgView const& aa) -> OBJECT {
-                std::cout << aa[0];
+            [](void*, ArgSpan aa) -> OBJECT {
+                if (aa.size() < 1) {
+                    error("display: expected an object to display");
+                    throw SsiError();
+                }
+                OutputPortWriter writer{expect_output_port("display", aa, 1)};
+                print_obj(aa[0], writer.port());
                 return OBJECT::null;
             },
-            {"it"}
+            {"it", "port..."}
         );
         vm_bind_platform_procedure(vm,
             "displayln",
-            [=](ArgView const& aa) -> OBJECT {
-                std::cout << aa[0] << std::endl;
+            [](void*, ArgSpan aa) -> OBJECT {
+                if (aa.size() < 1) {
+                    error("displayln: expected an object to display");
+                    throw SsiError();
+                }
+                OutputPortWriter writer{expect_output_port("displayln", aa, 1)};
+                print_obj(aa[0], writer.port());
+                writer.port().put('\n');
+                return OBJECT::null;
+            },
+            {"it", "port..."}
+        );
+        vm_bind_platform_procedure(vm,
+            "current-output-port",
+            [](void*) -> OBJECT {
+                return OBJECT::make_integer(STANDARD_OUTPUT_PORT_ID);
+            },
+            {}
+        );
+        vm_bind_platform_procedure(vm,
+            "current-error-port",
+            [](void*) -> OBJECT {
+                return OBJECT::make_integer(STANDARD_ERROR_PORT_ID);
+            },
+            {}
+        );
+        vm_bind_platform_procedure(vm,
+            "flush-output-port",
+            [](void*, ArgSpan aa) -> OBJECT {
+                OutputPort& port = expect_output_port("flush-output-port", aa, 0);
+                std::lock_guard lg{port.mutex()};
+                port.flush();
+                return OBJECT::null;
+            },
+            {"port..."},
+            "writes out everything written to 'port' so far"
+        );
+        vm_bind_platform_procedure(vm,
+            "set-output-port-buffer-mode!",
+            [](void*, OBJECT port_id, OBJECT mode) -> OBJECT {
+                OutputPort* port = port_id.is_integer() ? output_port(port_id.as_integer()) : nullptr;
+                if (port == nullptr) {
+                    std::stringstream ss;
+                    ss << "set-output-port-buffer-mode!: expected an output port, received: " << port_id;
+                    error(ss.str());
+                    throw SsiError();
+                }
+                PortBufferMode new_mode;
+                if (mode.is_symbol() && mode.as_symbol() == intern("block")) {
+                    new_mode = PortBufferMode::Block;
+                } else if (mode.is_symbol() && mode.as_symbol() == intern("line")) {
+                    new_mode = PortBufferMode::Line;
+                } else if (mode.is_symbol() && mode.as_symbol() == intern("none")) {
+                    new_mode = PortBufferMode::None;
+                } else {
+                    std::stringstream ss;
+                    ss << "set-output-port-buffer-mode!: expected 'block, 'line, or 'none, received: " << mode;
+                    error(ss.str());
+                    throw SsiError();
+                }
+                OutputPortWriter writer{*port};
+                port->set_mode(new_mode);
+                return OBJECT::null;
+            },
+            {"port", "mode"},
+            "sets when 'port' writes out: 'block when its buffer is full, 'line after each newline, or 'none after each write"
+        );
+    }
+
+    static InputPortObject* expect_open_input_port(char const* proc_name, OBJECT obj) {
+        if (!obj.is_input_port() || obj.as_input_port_p()->is_closed()) {
+            std::stringstream ss;
+            ss << proc_name << ": expected an open input port, received: " << obj;
+            error(ss.str());
+            throw SsiError();
+        }
+        return obj.as_input_port_p();
+    }
+    static StringObject* expect_string(char const* proc_name, OBJECT obj) {
+        if (!obj.is_string()) {
+            std::stringstream ss;
+            ss << proc_name << ": expected a string, received: " << obj;
+            error(ss.str());
+            throw SsiError();
+        }
+        return obj.as_string_p();
+    }
+    static size_t expect_string_index(char const* proc_name, OBJECT obj, size_t bound) {
+        if (!obj.is_integer() || obj.as_integer() < 0 || static_cast<size_t>(obj.as_integer()) >= bound) {
+            std::stringstream ss;
+            ss << proc_name << ": expected an index in [0, " << bound << "), received: " << obj;
+            error(ss.str());
+            throw SsiError();
+        }
+        return static_cast<size_t>(obj.as_integer());
+    }
+
+    void bind_standard_file_io_procedures(VirtualMachine* vm) {
+        vm_bind_platform_procedure(vm,
+            "open-input-file",
+            [](void* ctx, OBJECT path) -> OBJECT {
+                StringObject* path_p = expect_string("open-input-file", path);
+                std::string path_str{path_p->bytes(), path_p->count()};
+                OBJECT port = open_input_file(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), path_str);
+                if (port.is_null()) {
+                    std::stringstream ss;
+                    ss << "open-input-file: cannot open file: " << path;
+                    error(ss.str());
+                    throw SsiError();
+                }
+                return port;
+            },
+            {"path"},
+            "returns an input port reading the file at 'path'",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "close-input-port",
+            [](void*, OBJECT port) -> OBJECT {
+                if (!port.is_input_port()) {
+                    std::stringstream ss;
+                    ss << "close-input-port: expected an input port, received: " << port;
+                    error(ss.str());
+                    throw SsiError();
+                }
+                port.as_input_port_p()->close();
+                return OBJECT::null;
+            },
+            {"port"}
+        );
+        vm_bind_platform_procedure(vm,
+            "input-port?",
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(obj.is_input_port());
+            },
+            {"obj"}
+        );
+        vm_bind_platform_procedure(vm,
+            "read-line",
+            [](void* ctx, OBJECT port) -> OBJECT {
+                InputPortObject* port_p = expect_open_input_port("read-line", port);
+                return read_line(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), port_p);
+            },
+            {"port"},
+            "returns the next line read from 'port', without its line ending, or the EOF object",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "read-char",
+            [](void* ctx, OBJECT port) -> OBJECT {
+                InputPortObject* port_p = expect_open_input_port("read-char", port);
+                return read_char(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), port_p);
+            },
+            {"port"},
+            "returns the next byte read from 'port' as an integer, or the EOF object",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "peek-char",
+            [](void* ctx, OBJECT port) -> OBJECT {
+                InputPortObject* port_p = expect_open_input_port("peek-char", port);
+                return peek_char(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), port_p);
+            },
+            {"port"},
+            "returns the byte 'read-char' would, without consuming it",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "read-string",
+            [](void* ctx, OBJECT count, OBJECT port) -> OBJECT {
+                if (!count.is_integer() || count.as_integer() < 0) {
+                    std::stringstream ss;
+                    ss << "read-string: expected a count, received: " << count;
+                    error(ss.str());
+                    throw SsiError();
+                }
+                InputPortObject* port_p = expect_open_input_port("read-string", port);
+                return read_string(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), port_p, count.as_integer());
+            },
+            {"count", "port"},
+            "returns the next 'count' bytes read from 'port', or fewer at its end, or the EOF object",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "read",
+            [](void* ctx, OBJECT port) -> OBJECT {
+                InputPortObject* port_p = expect_open_input_port("read", port);
+                return read_datum(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), port_p);
+            },
+            {"port"},
+            "returns the next datum parsed from 'port', or the EOF object",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "eof-object",
+            [](void*) -> OBJECT {
+                return OBJECT::eof;
+            },
+            {}
+        );
+        vm_bind_platform_procedure(vm,
+            "eof-object?",
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(obj.is_eof());
+            },
+            {"obj"}
+        );
+    }
+
+    void bind_standard_string_procedures(VirtualMachine* vm) {
+        vm_bind_platform_procedure(vm,
+            "string-length",
+            [](void*, OBJECT str) -> OBJECT {
+                return OBJECT::make_integer(expect_string("string-length", str)->count());
+            },
+            {"str"}
+        );
+        vm_bind_platform_procedure(vm,
+            "string-ref",
+            [](void*, OBJECT str, OBJECT pos) -> OBJECT {
+                StringObject* str_p = expect_string("string-ref", str);
+                size_t i = expect_string_index("string-ref", pos, str_p->count());
+                return OBJECT::make_integer(static_cast<unsigned char>(str_p->bytes()[i]));
+            },
+            {"str", "pos"},
+            "returns the byte of 'str' at 'pos' as an integer: chars are not yet supported"
+        );
+        vm_bind_platform_procedure(vm,
+            "string-set!",
+            [](void* ctx, OBJECT str, OBJECT pos, OBJECT it) -> OBJECT {
+                StringObject* str_p = expect_string("string-set!", str);
+                size_t i = expect_string_index("string-set!", pos, str_p->count());
+                if (!it.is_integer() || it.as_integer() < 0 || it.as_integer() > 255) {
+                    std::stringstream ss;
+                    ss << "string-set!: expected a byte, received: " << it;
+                    error(ss.str());
+                    throw SsiError();
+                }
+                str_p->make_writable(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)));
+                str_p->bytes()[i] = static_cast<char>(it.as_integer());
                 return OBJECT::null;
             },
-            {"it"}
+            {"str", "pos", "it"},
+            "sets the byte of 'str' at 'pos': slices, e.g. lines read from a port, are copied first",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "substring",
+            [](void* ctx, OBJECT str, OBJECT start, OBJECT end) -> OBJECT {
+                StringObject* str_p = expect_string("substring", str);
+                size_t start_i = expect_string_index("substring", start, str_p->count() + 1);
+                size_t end_i = expect_string_index("substring", end, str_p->count() + 1);
+                if (end_i < start_i) {
+                    std::stringstream ss;
+                    ss << "substring: expected start <= end, received " << start << " and " << end;
+                    error(ss.str());
+                    throw SsiError();
+                }
+                // a writable string may be mutated later, so only slices are shared without copying:
+                GcThreadFrontEnd* gc_tfe = vm_gc_tfe(static_cast<VirtualMachine*>(ctx));
+                if (str_p->is_slice() && !str_p->base().is_string()) {
+                    return OBJECT::make_string_slice(gc_tfe, str_p->base(), str_p->bytes() + start_i, end_i - start_i);
+                }
+                return OBJECT::make_string(gc_tfe, end_i - start_i, str_p->bytes() + start_i, false);
+            },
+            {"str", "start", "end"},
+            "returns the bytes of 'str' from 'start' up to 'end'",
+            vm
+        );
+    }
+
+    static HashTableObject* expect_hash_table(char const* proc_name, OBJECT obj) {
+        if (!obj.is_hash_table()) {
+            std::stringstream ss;
+            ss << proc_name << ": expected a hash table, received: " << obj;
+            error(ss.str());
+            throw SsiError();
+        }
+        return obj.as_hash_table_p();
+    }
+    // expect_hash_table_equivalence reads the name of an equivalence predicate, e.g. 'eqv?, defaulting to 'equal?'.
+    static HashTableEquivalence expect_hash_table_equivalence(char const* proc_name, ArgSpan aa, ssize_t arg_index) {
+        if (aa.size() <= arg_index) {
+            return HashTableEquivalence::Equal;
+        }
+        OBJECT name = aa[arg_index];
+        if (name.is_symbol()) {
+            std::string_view name_str = interned_string(name.as_symbol());
+            if (name_str == "eq?") { return HashTableEquivalence::Eq; }
+            if (name_str == "eqv?") { return HashTableEquivalence::Eqv; }
+            if (name_str == "equal?") { return HashTableEquivalence::Equal; }
+        }
+        std::stringstream ss;
+        ss << proc_name << ": expected 'eq?, 'eqv?, or 'equal?, received: " << name;
+        error(ss.str());
+        throw SsiError();
+    }
+
+    void bind_standard_hash_table_procedures(VirtualMachine* vm) {
+        vm_bind_platform_procedure(vm,
+            "make-hash-table",
+            [](void* ctx, ArgSpan aa) -> OBJECT {
+                HashTableEquivalence equivalence = expect_hash_table_equivalence("make-hash-table", aa, 0);
+                size_t capacity = 0;
+                if (aa.size() >= 2) {
+                    if (aa.size() > 2 || !aa[1].is_integer() || aa[1].as_integer() < 0) {
+                        std::stringstream ss;
+                        ss << "make-hash-table: expected an optional equivalence, then an optional capacity";
+                        error(ss.str());
+                        throw SsiError();
+                    }
+                    capacity = static_cast<size_t>(aa[1].as_integer());
+                }
+                return OBJECT::make_hash_table(vm_gc_tfe(static_cast<VirtualMachine*>(ctx)), equivalence, capacity);
+            },
+            {"equivalence...", "capacity..."},
+            "returns a new hash table comparing keys by 'eq?, 'eqv?, or 'equal? (the default)",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "alist->hash-table",
+            [](void* ctx, ArgSpan aa) -> OBJECT {
+                if (aa.size() < 1 || aa.size() > 2 || !aa[0].is_list()) {
+                    std::stringstream ss;
+                    ss << "alist->hash-table: expected an association list and an optional equivalence";
+                    error(ss.str());
+                    throw SsiError();
+                }
+                HashTableEquivalence equivalence = expect_hash_table_equivalence("alist->hash-table", aa, 1);
+                GcThreadFrontEnd* gc_tfe = vm_gc_tfe(static_cast<VirtualMachine*>(ctx));
+                OBJECT res = OBJECT::make_hash_table(gc_tfe, equivalence, list_length(aa[0]));
+                HashTableObject* table = res.as_hash_table_p();
+                for (OBJECT rem = aa[0]; !rem.is_null(); rem = cdr(rem)) {
+                    OBJECT entry = car(rem);
+                    if (!entry.is_pair()) {
+                        std::stringstream ss;
+                        ss << "alist->hash-table: expected each item to be a pair, received: " << entry;
+                        error(ss.str());
+                        throw SsiError();
+                    }
+                    // earlier associations shadow later ones, like 'assoc':
+                    if (!table->find(car(entry))) {
+                        table->set(car(entry), cdr(entry));
+                    }
+                }
+                return res;
+            },
+            {"alist", "equivalence..."},
+            "returns a new hash table of the associations in 'alist'",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "hash-table?",
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(obj.is_hash_table());
+            },
+            {"obj"}
+        );
+        vm_bind_platform_procedure(vm,
+            "hash-table-size",
+            [](void*, OBJECT table) -> OBJECT {
+                return OBJECT::make_integer(expect_hash_table("hash-table-size", table)->count());
+            },
+            {"table"}
+        );
+        vm_bind_platform_procedure(vm,
+            "hash-table-ref",
+            [](void*, OBJECT table, OBJECT key) -> OBJECT {
+                OBJECT const* value = expect_hash_table("hash-table-ref", table)->find(key);
+                if (!value) {
+                    std::stringstream ss;
+                    ss << "hash-table-ref: no entry for key: " << key;
+                    error(ss.str());
+                    throw SsiError();
+                }
+                return *value;
+            },
+            {"table", "key"},
+            "returns the value stored under 'key', which must have one"
+        );
+        vm_bind_platform_procedure(vm,
+            "hash-table-ref/default",
+            [](void*, OBJECT table, OBJECT key, OBJECT default_value) -> OBJECT {
+                OBJECT const* value = expect_hash_table("hash-table-ref/default", table)->find(key);
+                return value ? *value : default_value;
+            },
+            {"table", "key", "default"},
+            "returns the value stored under 'key', or 'default' if there is none"
+        );
+        vm_bind_platform_procedure(vm,
+            "hash-table-set!",
+            [](void*, OBJECT table, OBJECT key, OBJECT value) -> OBJECT {
+                expect_hash_table("hash-table-set!", table)->set(key, value);
+                return OBJECT::null;
+            },
+            {"table", "key", "value"}
+        );
+        vm_bind_platform_procedure(vm,
+            "hash-table-delete!",
+            [](void*, OBJECT table, OBJECT key) -> OBJECT {
+                expect_hash_table("hash-table-delete!", table)->remove(key);
+                return OBJECT::null;
+            },
+            {"table", "key"}
+        );
+        vm_bind_platform_procedure(vm,
+            "hash-table-exists?",
+            [](void*, OBJECT table, OBJECT key) -> OBJECT {
+                return boolean(expect_hash_table("hash-table-exists?", table)->find(key) != nullptr);
+            },
+            {"table", "key"}
+        );
+        vm_bind_platform_procedure(vm,
+            "hash-table-clear!",
+            [](void*, OBJECT table) -> OBJECT {
+                expect_hash_table("hash-table-clear!", table)->clear();
+                return OBJECT::null;
+            },
+            {"table"}
+        );
+        vm_bind_platform_procedure(vm,
+            "hash-table-copy",
+            [](void* ctx, OBJECT table) -> OBJECT {
+                HashTableObject* table_p = expect_hash_table("hash-table-copy", table);
+                GcThreadFrontEnd* gc_tfe = vm_gc_tfe(static_cast<VirtualMachine*>(ctx));
+                OBJECT res = OBJECT::make_hash_table(gc_tfe, table_p->equivalence(), table_p->count());
+                table_p->for_each([res] (OBJECT key, OBJECT value) {
+                    res.as_hash_table_p()->set(key, value);
+                });
+                return res;
+            },
+            {"table"},
+            "returns a new hash table with the entries of 'table'",
+            vm
+        );
+
+        // updating entries with a procedure: cf `vm_hash_table_update`
+        vm_bind_platform_procedure(vm,
+            "hash-table-update!",
+            [](void* ctx, OBJECT table, OBJECT key, OBJECT proc) -> OBJECT {
+                OBJECT const* value = expect_hash_table("hash-table-update!", table)->find(key);
+                if (!value) {
+                    std::stringstream ss;
+                    ss << "hash-table-update!: no entry for key: " << key;
+                    error(ss.str());
+                    throw SsiError();
+                }
+                return vm_hash_table_update(static_cast<VirtualMachine*>(ctx), table, key, proc, *value);
+            },
+            {"table", "key", "proc"},
+            "stores '(proc value)' under 'key', which must have a value",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "hash-table-update!/default",
+            [](void* ctx, OBJECT table, OBJECT key, OBJECT proc, OBJECT default_value) -> OBJECT {
+                OBJECT const* value = expect_hash_table("hash-table-update!/default", table)->find(key);
+                return vm_hash_table_update(static_cast<VirtualMachine*>(ctx), table, key, proc, value ? *value : default_value);
+            },
+            {"table", "key", "proc", "default"},
+            "stores '(proc value)' under 'key', where 'value' is 'default' if there is none",
+            vm
+        );
+
+        // walking a table: each returns a new list, in no particular order.
+        vm_bind_platform_procedure(vm,
+            "hash-table-walk",
+            [](void* ctx, OBJECT table, OBJECT proc) -> OBJECT {
+                expect_hash_table("hash-table-walk", table);
+                return vm_hash_table_walk(static_cast<VirtualMachine*>(ctx), table, proc);
+            },
+            {"table", "proc"},
+            "applies 'proc' to each key and value of 'table', for effect: 'proc' may modify the table",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "hash-table-keys",
+            [](void* ctx, OBJECT table) -> OBJECT {
+                GcThreadFrontEnd* gc_tfe = vm_gc_tfe(static_cast<VirtualMachine*>(ctx));
+                OBJECT res = OBJECT::null;
+                expect_hash_table("hash-table-keys", table)->for_each([gc_tfe, &res] (OBJECT key, OBJECT) {
+                    res = cons(gc_tfe, key, res);
+                });
+                return res;
+            },
+            {"table"},
+            "returns a list of the keys of 'table'",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "hash-table-values",
+            [](void* ctx, OBJECT table) -> OBJECT {
+                GcThreadFrontEnd* gc_tfe = vm_gc_tfe(static_cast<VirtualMachine*>(ctx));
+                OBJECT res = OBJECT::null;
+                expect_hash_table("hash-table-values", table)->for_each([gc_tfe, &res] (OBJECT, OBJECT value) {
+                    res = cons(gc_tfe, value, res);
+                });
+                return res;
+            },
+            {"table"},
+            "returns a list of the values of 'table'",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "hash-table->alist",
+            [](void* ctx, OBJECT table) -> OBJECT {
+                GcThreadFrontEnd* gc_tfe = vm_gc_tfe(static_cast<VirtualMachine*>(ctx));
+                OBJECT res = OBJECT::null;
+                expect_hash_table("hash-table->alist", table)->for_each([gc_tfe, &res] (OBJECT key, OBJECT value) {
+                    res = cons(gc_tfe, cons(gc_tfe, key, value), res);
+                });
+                return res;
+            },
+            {"table"},
+            "returns an association list of the entries of 'table'",
+            vm
+        );
+    }
+
+    void bind_standard_vthread_procedures(VirtualMachine* vm) {
+        vm_bind_platform_procedure(vm,
+            "spawn",
+            [](void* ctx, OBJECT thunk) -> OBJECT {
+                return vm_spawn_vthread(static_cast<VirtualMachine*>(ctx), thunk);
+            },
+            {"thunk"},
+            "runs `thunk` on a new VThread, returning its ID",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "yield",
+            [](void* ctx) -> OBJECT {
+                vm_yield_vthread(static_cast<VirtualMachine*>(ctx));
+                return OBJECT::null;
+            },
+            {},
+            "lets other VThreads run before resuming this one",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "join",
+            [](void* ctx, OBJECT id) -> OBJECT {
+                if (!id.is_integer()) {
+                    std::stringstream ss;
+                    ss << "join: expected a VThread ID, received: " << id;
+                    error(ss.str());
+                    throw SsiError();
+                }
+                vm_join_vthread(static_cast<VirtualMachine*>(ctx), id.as_integer());
+                return OBJECT::null;
+            },
+            {"id"},
+            "waits for VThread `id` to halt, returning its result",
+            vm
+        );
+    }
+
+    void bind_standard_parallel_procedures(VirtualMachine* vm) {
+        vm_bind_platform_procedure(vm,
+            "parallel-vector-map",
+            [](void* ctx, OBJECT proc, OBJECT items) -> OBJECT {
+                return vm_parallel_vector_map(static_cast<VirtualMachine*>(ctx), proc, items);
+            },
+            {"proc", "items"},
+            "returns a new vector of `(proc item)` for each item of the vector (or numeric vector) `items`, "
+            "applied in parallel",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "parallel-for-each",
+            [](void* ctx, OBJECT proc, OBJECT start, OBJECT end) -> OBJECT {
+                if (!start.is_integer() || !end.is_integer()) {
+                    std::stringstream ss;
+                    ss << "parallel-for-each: expected an index range, received: " << start << ", " << end;
+                    error(ss.str());
+                    throw SsiError();
+                }
+                return vm_parallel_for_each(static_cast<VirtualMachine*>(ctx), proc, start.as_integer(), end.as_integer());
+            },
+            {"proc", "start", "end"},
+            "applies `proc` to each index in [start, end) in parallel, for effect",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "parallel-fold",
+            [](void* ctx, OBJECT combine, OBJECT init, OBJECT items) -> OBJECT {
+                return vm_parallel_fold(static_cast<VirtualMachine*>(ctx), combine, init, items);
+            },
+            {"combine", "init", "items"},
+            "folds the vector (or numeric vector) `items` from `init` with `(combine acc item)` in parallel: "
+            "`combine` must be associative, and `init` its identity",
+            vm
+        );
+    }
+
+    static OBJECT expect_channel(char const* proc_name, OBJECT obj) {
+        if (!obj.is_channel()) {
+            std::stringstream ss;
+            ss << proc_name << ": expected a channel, received: " << obj;
+            error(ss.str());
+            throw SsiError();
+        }
+        return obj;
+    }
+    static size_t expect_channel_batch_count(char const* proc_name, OBJECT obj) {
+        if (!obj.is_integer() || obj.as_integer() < 0) {
+            std::stringstream ss;
+            ss << proc_name << ": expected a message count, received: " << obj;
+            error(ss.str());
+            throw SsiError();
+        }
+        return static_cast<size_t>(obj.as_integer());
+    }
+
+    void bind_standard_channel_procedures(VirtualMachine* vm) {
+        vm_bind_platform_procedure(vm,
+            "make-channel",
+            [](void* ctx, ArgSpan aa) -> OBJECT {
+                if (aa.size() < 1 || aa.size() > 2 || !aa[0].is_integer() || aa[0].as_integer() <= 0) {
+                    std::stringstream ss;
+                    ss << "make-channel: expected a capacity, then an optional 'spsc or 'mpsc";
+                    error(ss.str());
+                    throw SsiError();
+                }
+                ChannelKind channel_kind = ChannelKind::Mpsc;
+                if (aa.size() == 2) {
+                    std::string_view kind_str = aa[1].is_symbol() ? interned_string(aa[1].as_symbol()) : "";
+                    if (kind_str == "spsc") {
+                        channel_kind = ChannelKind::Spsc;
+                    } else if (kind_str != "mpsc") {
+                        std::stringstream ss;
+                        ss << "make-channel: expected 'spsc or 'mpsc, received: " << aa[1];
+                        error(ss.str());
+                        throw SsiError();
+                    }
+                }
+                GcThreadFrontEnd* gc_tfe = vm_gc_tfe(static_cast<VirtualMachine*>(ctx));
+                return OBJECT::make_channel(gc_tfe, channel_kind, static_cast<size_t>(aa[0].as_integer()));
+            },
+            {"capacity", "kind..."},
+            "returns a new channel with room for 'capacity' messages, rounded up to a power of 2, from one VThread "
+            "('spsc) or many ('mpsc, the default), to one",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "channel?",
+            [](void*, OBJECT obj) -> OBJECT {
+                return boolean(obj.is_channel());
+            },
+            {"obj"}
+        );
+        vm_bind_platform_procedure(vm,
+            "channel-count",
+            [](void*, OBJECT channel) -> OBJECT {
+                return OBJECT::make_integer(expect_channel("channel-count", channel).as_channel_p()->count());
+            },
+            {"channel"},
+            "returns how many messages are queued on 'channel' (an estimate, while other VThreads use it)"
+        );
+        vm_bind_platform_procedure(vm,
+            "channel-send",
+            [](void* ctx, OBJECT channel, OBJECT message) -> OBJECT {
+                return vm_channel_send(static_cast<VirtualMachine*>(ctx), expect_channel("channel-send", channel), message);
+            },
+            {"channel", "message"},
+            "queues 'message' on 'channel', waiting while it is full",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "channel-receive",
+            [](void* ctx, OBJECT channel) -> OBJECT {
+                return vm_channel_receive(static_cast<VirtualMachine*>(ctx), expect_channel("channel-receive", channel));
+            },
+            {"channel"},
+            "returns a copy of the oldest message on 'channel', waiting while it is empty",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "channel-try-send",
+            [](void* ctx, OBJECT channel, OBJECT message) -> OBJECT {
+                auto vm = static_cast<VirtualMachine*>(ctx);
+                return boolean(vm_channel_try_send_batch(vm, expect_channel("channel-try-send", channel), &message, 1) == 1);
+            },
+            {"channel", "message"},
+            "queues 'message' on 'channel' unless it is full, returning whether it did",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "channel-try-receive",
+            [](void* ctx, OBJECT channel, OBJECT fallback) -> OBJECT {
+                auto vm = static_cast<VirtualMachine*>(ctx);
+                OBJECT message;
+                if (vm_channel_try_receive_batch(vm, expect_channel("channel-try-receive", channel), &message, 1) == 0) {
+                    return fallback;
+                }
+                return message;
+            },
+            {"channel", "fallback"},
+            "returns a copy of the oldest message on 'channel', or 'fallback' if it is empty",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "channel-send-batch",
+            [](void* ctx, OBJECT channel, OBJECT messages) -> OBJECT {
+                auto vm = static_cast<VirtualMachine*>(ctx);
+                expect_channel("channel-send-batch", channel);
+                if (!messages.is_list()) {
+                    std::stringstream ss;
+                    ss << "channel-send-batch: expected a list of messages, received: " << messages;
+                    error(ss.str());
+                    throw SsiError();
+                }
+                std::vector<OBJECT> items;
+                for (OBJECT rem = messages; !rem.is_null(); rem = cdr(rem)) {
+                    items.push_back(car(rem));
+                }
+                return OBJECT::make_integer(vm_channel_try_send_batch(vm, channel, items.data(), items.size()));
+            },
+            {"channel", "messages"},
+            "queues as many of 'messages' on 'channel' as there is room for, in order, returning how many",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "channel-receive-batch",
+            [](void* ctx, OBJECT channel, OBJECT max_count) -> OBJECT {
+                auto vm = static_cast<VirtualMachine*>(ctx);
+                expect_channel("channel-receive-batch", channel);
+                // no more than the channel holds:
+                size_t count = std::min(
+                    expect_channel_batch_count("channel-receive-batch", max_count), 
+                    channel.as_channel_p()->capacity()
+                );
+                std::vector<OBJECT> items(count);
+                items.resize(vm_channel_try_receive_batch(vm, channel, items.data(), items.size()));
+                return cpp_vector_to_list(vm_gc_tfe(vm), items);
+            },
+            {"channel", "max-count"},
+            "returns a list of copies of up to 'max-count' of the oldest messages on 'channel', oldest first, "
+            "without waiting",
+            vm
+        );
+    }
+
+    void bind_standard_gc_procedures(VirtualMachine* vm) {
+        vm_bind_platform_procedure(vm,
+            "gc-stats",
+            [](void* ctx) -> OBJECT {
+                VirtualMachine* vm = static_cast<VirtualMachine*>(ctx);
+                GcStats stats = vm_gc(vm)->stats();
+                uint64_t allocated_count = 0;
+                uint64_t freed_count = 0;
+                uint64_t live_bytes = stats.large_object_bytes;
+                for (GcStats::SizeClass const& it: stats.size_classes) {
+                    allocated_count += it.allocated_count;
+                    freed_count += it.freed_count;
+                    live_bytes += it.live_bytes;
+                }
+                auto to_us = [] (std::chrono::nanoseconds d) { 
+                    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count()); 
+                };
+                std::pair<char const*, uint64_t> const fields[] = {
+                    {"allocated", allocated_count},
+                    {"freed", freed_count},
+                    {"young-allocated", stats.young_allocated_count},
+                    {"promoted", stats.promoted_count},
+                    {"promoted-list-links", stats.promoted_list_link_count},
+                    {"adjacent-list-links", stats.adjacent_list_link_count},
+                    {"large-objects", stats.large_object_count},
+                    {"live-bytes", live_bytes},
+                    {"committed-bytes", stats.committed_page_count * gc::PAGE_SIZE_IN_BYTES},
+                    {"released-bytes", stats.released_page_count * gc::PAGE_SIZE_IN_BYTES},
+                    {"minor-collections", stats.minor_pauses.count},
+                    {"minor-pause-us", to_us(stats.minor_pauses.total)},
+                    {"minor-pause-max-us", to_us(stats.minor_pauses.max)},
+                    {"full-collections", stats.full_pauses.count},
+                    {"full-pause-us", to_us(stats.full_pauses.total)},
+                    {"full-pause-max-us", to_us(stats.full_pauses.max)}
+                };
+                OBJECT res = OBJECT::null;
+                for (ssize_t i = std::size(fields) - 1; i >= 0; i--) {
+                    OBJECT field = cons(
+                        vm_gc_tfe(vm),
+                        OBJECT::make_symbol(intern(fields[i].first)), 
+                        OBJECT::make_integer(static_cast<ssize_t>(fields[i].second))
+                    );
+                    res = cons(vm_gc_tfe(vm), field, res);
+                }
+                return res;
+            },
+            {},
+            "returns an association list of GC counters, cf `Gc::stats`: live-bytes as of the last full collection",
+            vm
+        );
+        vm_bind_platform_procedure(vm,
+            "write-heap-profile",
+            [](void* ctx, OBJECT path) -> OBJECT {
+                StringObject* path_p = expect_string("write-heap-profile", path);
+                std::string path_str{path_p->bytes(), path_p->count()};
+                std::ofstream out{path_str, std::ios::binary | std::ios::trunc};
+                return boolean(out.is_open() && vm_write_heap_profile(static_cast<VirtualMachine*>(ctx), out));
+            },
+            {"path"},
+            "writes the heap profile so far to the file at 'path' in pprof's format, cf `vm_enable_heap_profiler`: "
+            "returns #f if heap profiling is not enabled, or if the file cannot be written",
+            vm
         );
     }
 
@@ -499,8 +1488,18 @@ namespace ss {
         bind_standard_logical_operators(vm);
         bind_standard_list_procedures(vm);
         bind_standard_vector_procedures(vm);
+        bind_standard_num_vector_procedures(vm);
         bind_standard_arithmetic_procedures(vm);
+        bind_standard_comparison_procedures(vm);
         bind_standard_console_io_procedures(vm);
+        bind_standard_file_io_procedures(vm);
+        bind_standard_string_procedures(vm);
+        bind_standard_hash_table_procedures(vm);
+        bind_standard_vthread_procedures(vm);
+        bind_standard_parallel_procedures(vm);
+        bind_standard_channel_procedures(vm);
+        bind_standard_gc_procedures(vm);
+        bind_standard_prims(vm);
     }
 
 }
\ No newline at end of file
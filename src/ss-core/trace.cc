@@ -0,0 +1,121 @@
+#include "ss-core/trace.hh"
+
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+namespace ss {
+
+    namespace trace {
+        std::atomic<bool> g_enabled{false};
+
+        struct Event {
+            char const* name;
+            std::string detail;
+            std::chrono::steady_clock::time_point start;
+            std::chrono::steady_clock::duration duration;
+        };
+
+        // ThreadBuffer holds the spans of one OS thread: its lock is only contended while the trace is written.
+        struct ThreadBuffer {
+            size_t tid;
+            std::mutex mutex;
+            std::vector<Event> events;
+        };
+
+        // the buffers of every thread that recorded, and the time that the trace begins at:
+        static std::mutex s_buffers_mutex;
+        static std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+        static std::chrono::steady_clock::time_point const s_epoch = std::chrono::steady_clock::now();
+        static thread_local ThreadBuffer* t_buffer = nullptr;
+
+        static ThreadBuffer& thread_buffer() {
+            if (!t_buffer) {
+                std::lock_guard lg{s_buffers_mutex};
+                s_buffers.push_back(std::make_unique<ThreadBuffer>());
+                s_buffers.back()->tid = s_buffers.size();
+                t_buffer = s_buffers.back().get();
+            }
+            return *t_buffer;
+        }
+
+        static void write_json_string(std::ostream& out, std::string_view s) {
+            out << '"';
+            for (char c: s) {
+                switch (c) {
+                    case '"': out << "\\\""; break;
+                    case '\\': out << "\\\\"; break;
+                    case '\n': out << "\\n"; break;
+                    case '\t': out << "\\t"; break;
+                    default: {
+                        if (static_cast<unsigned char>(c) < 0x20) {
+                            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+                                << std::dec << std::setfill(' ');
+                        } else {
+                            out << c;
+                        }
+                    }
+                }
+            }
+            out << '"';
+        }
+        // write_us writes a time in microseconds, as trace-events are, to the nanosecond.
+        static void write_us(std::ostream& out, std::chrono::steady_clock::duration d) {
+            int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+            if (ns < 0) {
+                out << '-';
+                ns = -ns;
+            }
+            out << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000 << std::setfill(' ');
+        }
+    }
+
+    void enable_tracing(bool enabled) {
+        trace::g_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void TraceSpan::record() {
+        Clock::duration duration = Clock::now() - m_start;
+        trace::ThreadBuffer& buffer = trace::thread_buffer();
+        std::lock_guard lg{buffer.mutex};
+        buffer.events.push_back({m_name, std::move(m_detail), m_start, duration});
+    }
+
+    void write_trace(std::ostream& out) {
+        std::lock_guard lg{trace::s_buffers_mutex};
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool is_first = true;
+        for (std::unique_ptr<trace::ThreadBuffer> const& buffer: trace::s_buffers) {
+            std::lock_guard buffer_lg{buffer->mutex};
+            for (trace::Event const& event: buffer->events) {
+                out << (is_first ? "\n" : ",\n");
+                is_first = false;
+                out << "{\"name\":";
+                trace::write_json_string(out, event.name);
+                out << ",\"cat\":\"ss\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":";
+                trace::write_us(out, event.start - trace::s_epoch);
+                out << ",\"dur\":";
+                trace::write_us(out, event.duration);
+                if (!event.detail.empty()) {
+                    out << ",\"args\":{\"detail\":";
+                    trace::write_json_string(out, event.detail);
+                    out << "}";
+                }
+                out << "}";
+            }
+        }
+        out << "\n]}\n";
+    }
+    bool write_trace_file(std::string const& file_path) {
+        std::ofstream out{file_path, std::ios::trunc};
+        if (!out.is_open()) {
+            return false;
+        }
+        write_trace(out);
+        return out.good();
+    }
+
+}   // namespace ss
@@ -0,0 +1,773 @@
+#include "ss-core/vcode-cache.hh"
+
+#include <array>
+#include <bit>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <type_traits>
+
+#include "ss-core/config.hh"
+#include "ss-core/common.hh"
+#include "ss-core/intern.hh"
+#include "ss-core/memory.hh"
+#include "ss-core/object.hh"
+#include "ss-core/trace.hh"
+
+namespace ss {
+
+    //
+    // Format:
+    // The file is a sequence of 64-bit words: a header, then each table, each led by its entry count.
+    //
+
+    static constexpr char SSC_MAGIC[8] = {'S', 'N', 'A', 'I', 'L', 'S', 'S', 'C'};
+    static constexpr uint64_t SSC_VERSION = 7;
+
+    // the build configuration the compiler's output depends on:
+    static constexpr uint64_t SSC_BUILD_KEY = (
+        (sizeof(void*) << 8) |
+        (static_cast<uint64_t>(CONFIG_IMMEDIATE_FLOAT64) << 1) |
+        (static_cast<uint64_t>(CONFIG_DISABLE_SUPERINSTRUCTIONS) << 0)
+    );
+
+    struct SscHeader {
+        char magic[8];
+        uint64_t version;
+        uint64_t build_key;
+        uint64_t key;
+        uint64_t checksum;      // of every word after the header
+    };
+    static_assert(sizeof(SscHeader) % sizeof(uint64_t) == 0);
+
+    // ssc_checksum detects truncated or corrupted files: the tables' contents are only bounds-checked.
+    static uint64_t ssc_checksum(uint64_t const* words, size_t word_count) {
+        uint64_t hash = 0x9e3779b97f4a7c15ull ^ word_count;
+        for (size_t i = 0; i < word_count; i++) {
+            hash = (hash ^ words[i]) * 0xff51afd7ed558ccdull;
+            hash ^= hash >> 32;
+        }
+        return hash;
+    }
+
+    // each expression is its kind, then its arguments' words: each argument word has a role.
+    // - a 'ProcBody' is that of the known procedure the previous word's global is bound to, cf `VCode::known_proc`.
+    enum class SscArgRole { Plain, Exp, Obj, GDef, PProc, ProcBody };
+    static constexpr size_t SSC_ARG_WORD_COUNT = 3;
+    static_assert(sizeof(VmExpArgs) == SSC_ARG_WORD_COUNT * sizeof(uint64_t));
+    static_assert(std::is_trivially_copyable_v<VmExpArgs> && std::is_trivially_copyable_v<OBJECT>);
+    using SscArgRoles = std::array<SscArgRole, SSC_ARG_WORD_COUNT>;
+
+    // ssc_arg_roles follows the layout of each `VmExpArgs` member: returns false for kinds that are never cached.
+    static bool ssc_arg_roles(VmExpKind kind, SscArgRoles* out) {
+        using R = SscArgRole;
+        switch (kind) {
+            case VmExpKind::Halt:
+            case VmExpKind::Apply:
+            case VmExpKind::Return: *out = {R::Plain, R::Plain, R::Plain}; return true;
+            case VmExpKind::ReferLocal:
+            case VmExpKind::ReferFree:
+            case VmExpKind::ReferLocalPush:
+            case VmExpKind::ReferFreePush:
+            case VmExpKind::AssignLocal:
+            case VmExpKind::AssignFree:
+            case VmExpKind::AssignLocalUnboxed:
+            case VmExpKind::Conti:
+            case VmExpKind::Box: *out = {R::Plain, R::Exp, R::Plain}; return true;
+            case VmExpKind::ReferGlobal:
+            case VmExpKind::ReferGlobalPush:
+            case VmExpKind::ReferGlobalApply:
+            case VmExpKind::AssignGlobal: *out = {R::GDef, R::Exp, R::Plain}; return true;
+            case VmExpKind::ReferGlobalShiftApply: *out = {R::GDef, R::Plain, R::Plain}; return true;
+            case VmExpKind::Constant:
+            case VmExpKind::ConstantPush:
+            case VmExpKind::Define: *out = {R::Obj, R::Exp, R::Plain}; return true;
+            case VmExpKind::Close: *out = {R::Plain, R::Exp, R::Exp}; return true;
+            case VmExpKind::Test:
+            case VmExpKind::Frame: *out = {R::Exp, R::Exp, R::Plain}; return true;
+            case VmExpKind::Nuate:
+            case VmExpKind::Argument:
+            case VmExpKind::Indirect: *out = {R::Exp, R::Plain, R::Plain}; return true;
+            case VmExpKind::Shift:
+            case VmExpKind::ShiftApply: *out = {R::Plain, R::Plain, R::Exp}; return true;
+            case VmExpKind::PInvoke: *out = {R::Plain, R::PProc, R::Exp}; return true;
+            case VmExpKind::CallGlobal:
+            case VmExpKind::ShiftCallGlobal:
+            case VmExpKind::SelfTailCall: *out = {R::GDef, R::ProcBody, R::Plain}; return true;
+            case VmExpKind::Jump: return false;
+            default: {
+                if (vmx_kind_is_prim(kind)) {
+                    *out = {R::PProc, R::Exp, R::Plain};
+                    return true;
+                }
+                return false;
+            }
+        }
+    }
+
+    // each constant is a tag, then its payload: constants only refer to constants before them.
+    enum class SscObjTag: uint64_t {
+        Immediate,      // raw
+        Symbol,         // string
+        Float64,        // bits
+        String,         // byte count, bytes...
+        Pair,           // car, cdr
+        Vector          // count, items...
+    };
+
+    uint64_t vcode_cache_key(std::string_view source, std::string const& input_desc) {
+        // FNV-1a:
+        uint64_t hash = 0xcbf29ce484222325ull;
+        auto mix = [&hash] (std::string_view s) {
+            for (char c: s) {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 0x100000001b3ull;
+            }
+        };
+        mix(input_desc);
+        hash ^= 0xff;
+        hash *= 0x100000001b3ull;
+        mix(source);
+        return hash;
+    }
+
+    //
+    // Saving:
+    //
+
+    class SscWriter {
+    private:
+        VCode& m_code;
+        VmExpID m_first_exp_id;
+        VmExpID m_end_exp_id;
+        GDefID m_first_gdef_id;
+        std::vector<uint64_t> m_string_words;
+        UnstableHashMap<IntStr, uint64_t> m_string_ids;
+        size_t m_string_count;
+        std::vector<uint64_t> m_gdef_words;
+        UnstableHashMap<GDefID, uint64_t> m_gdef_ids;
+        size_t m_gdef_count;
+        std::vector<uint64_t> m_pproc_words;
+        UnstableHashMap<PlatformProcID, uint64_t> m_pproc_ids;
+        std::vector<uint64_t> m_obj_words;
+        UnstableHashMap<BaseBoxedObject*, uint64_t> m_obj_ids;
+        size_t m_obj_count;
+
+    public:
+        SscWriter(VCode& code, VCodeUnitID unit, GDefID first_gdef_id)
+        :   m_code(code),
+            m_first_exp_id(unit == VCODE_NO_UNIT ? 0 : vmx_id(unit, 0)),
+            m_end_exp_id(unit == VCODE_NO_UNIT ? 0 : code.end_exp_id(unit)),
+            m_first_gdef_id(first_gdef_id),
+            m_string_count(0),
+            m_gdef_count(0),
+            m_obj_count(0)
+        {}
+
+    public:
+        bool write(std::ostream& out, uint64_t key, VSubr const& subr);
+
+    private:
+        uint64_t string_id(IntStr s);
+        uint64_t gdef_id(GDefID gdef_id);
+        uint64_t pproc_id(PlatformProcID proc_id);
+        bool obj_id(OBJECT obj, uint64_t* out);
+        bool rel_exp_id(VmExpID exp_id, uint64_t* out) const;
+        void push_loc(std::vector<uint64_t>& words, FLoc loc);
+        static void push_bytes(std::vector<uint64_t>& words, char const* bytes, size_t byte_count);
+    };
+
+    uint64_t SscWriter::string_id(IntStr s) {
+        auto it = m_string_ids.find(s);
+        if (it != m_string_ids.end()) {
+            return it->second;
+        }
+        std::string_view text = interned_string(s);
+        push_bytes(m_string_words, text.data(), text.size());
+        uint64_t id = m_string_count++;
+        m_string_ids[s] = id;
+        return id;
+    }
+    void SscWriter::push_bytes(std::vector<uint64_t>& words, char const* bytes, size_t byte_count) {
+        words.push_back(byte_count);
+        size_t first_word = words.size();
+        words.resize(first_word + (byte_count + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+        if (byte_count > 0) {
+            memcpy(words.data() + first_word, bytes, byte_count);
+        }
+    }
+    void SscWriter::push_loc(std::vector<uint64_t>& words, FLoc loc) {
+        words.push_back(string_id(loc.source));
+        words.push_back(loc.span.first_pos.line_index);
+        words.push_back(loc.span.first_pos.column_index);
+        words.push_back(loc.span.last_pos.line_index);
+        words.push_back(loc.span.last_pos.column_index);
+    }
+    uint64_t SscWriter::gdef_id(GDefID gdef_id) {
+        auto it = m_gdef_ids.find(gdef_id);
+        if (it != m_gdef_ids.end()) {
+            return it->second;
+        }
+        // globals the subr defines are written first and in order, cf `write`, so they are defined again in order.
+        // known procedures keep their body and arity: the body is only relinked if it is defined here.
+        Definition const& def = m_code.global(gdef_id);
+        bool is_defined_here = (gdef_id >= m_first_gdef_id);
+        KnownProc const* proc = m_code.known_proc(gdef_id);
+        m_gdef_words.push_back(string_id(def.name()));
+        m_gdef_words.push_back((is_defined_here ? 0x1 : 0x0) | (def.is_mutated() ? 0x2 : 0x0) | (proc ? 0x4 : 0x0));
+        push_loc(m_gdef_words, def.loc());
+        m_gdef_words.push_back((proc && is_defined_here) ? static_cast<uint64_t>(proc->body - m_first_exp_id) : 0);
+        m_gdef_words.push_back(proc ? proc->arity : 0);
+        uint64_t id = m_gdef_count++;
+        m_gdef_ids[gdef_id] = id;
+        return id;
+    }
+    uint64_t SscWriter::pproc_id(PlatformProcID proc_id) {
+        auto it = m_pproc_ids.find(proc_id);
+        if (it != m_pproc_ids.end()) {
+            return it->second;
+        }
+        uint64_t id = m_pproc_words.size();
+        m_pproc_words.push_back(string_id(m_code.pproc_tab().metadata(proc_id).name));
+        m_pproc_ids[proc_id] = id;
+        return id;
+    }
+    bool SscWriter::rel_exp_id(VmExpID exp_id, uint64_t* out) const {
+        if (exp_id < m_first_exp_id || exp_id >= m_end_exp_id) {
+            return false;
+        }
+        *out = static_cast<uint64_t>(exp_id - m_first_exp_id);
+        return true;
+    }
+    bool SscWriter::obj_id(OBJECT obj, uint64_t* out) {
+        if (obj.is_ptr()) {
+            auto it = m_obj_ids.find(obj.as_ptr());
+            if (it != m_obj_ids.end()) {
+                *out = it->second;
+                return true;
+            }
+        }
+        switch (obj.kind()) {
+            case ObjectKind::InternedSymbol: {
+                uint64_t s = string_id(obj.as_symbol());
+                m_obj_words.push_back(static_cast<uint64_t>(SscObjTag::Symbol));
+                m_obj_words.push_back(s);
+            } break;
+            case ObjectKind::Float64: {
+                double f64 = obj.as_float64();
+                uint64_t bits;
+                memcpy(&bits, &f64, sizeof(bits));
+                m_obj_words.push_back(static_cast<uint64_t>(SscObjTag::Float64));
+                m_obj_words.push_back(bits);
+            } break;
+            case ObjectKind::String: {
+                auto str = static_cast<StringObject*>(obj.as_ptr());
+                m_obj_words.push_back(static_cast<uint64_t>(SscObjTag::String));
+                push_bytes(m_obj_words, str->bytes(), str->count());
+            } break;
+            case ObjectKind::Pair: {
+                // lists are written from their last pair, so that long lists do not recurse deeply:
+                std::vector<PairObject*> spine;
+                OBJECT it = obj;
+                while (it.is_pair() && m_obj_ids.find(it.as_ptr()) == m_obj_ids.end()) {
+                    spine.push_back(it.as_pair_p());
+                    it = it.as_pair_p()->cdr();
+                }
+                uint64_t cdr_id;
+                if (!obj_id(it, &cdr_id)) {
+                    return false;
+                }
+                for (size_t i = spine.size(); i-- > 0;) {
+                    uint64_t car_id;
+                    if (!obj_id(spine[i]->car(), &car_id)) {
+                        return false;
+                    }
+                    m_obj_words.push_back(static_cast<uint64_t>(SscObjTag::Pair));
+                    m_obj_words.push_back(car_id);
+                    m_obj_words.push_back(cdr_id);
+                    cdr_id = m_obj_count++;
+                    m_obj_ids[spine[i]] = cdr_id;
+                }
+                *out = cdr_id;
+                return true;
+            }
+            case ObjectKind::Vector: {
+                VectorObject* vec = obj.as_vector_p();
+                std::vector<uint64_t> item_ids(vec->count());
+                for (size_t i = 0; i < vec->count(); i++) {
+                    if (!obj_id(vec->array()[i], &item_ids[i])) {
+                        return false;
+                    }
+                }
+                m_obj_words.push_back(static_cast<uint64_t>(SscObjTag::Vector));
+                m_obj_words.push_back(vec->count());
+                m_obj_words.insert(m_obj_words.end(), item_ids.begin(), item_ids.end());
+            } break;
+            case ObjectKind::Null:
+            case ObjectKind::Eof:
+            case ObjectKind::Boolean:
+            case ObjectKind::Fixnum:
+            case ObjectKind::Float32:
+            case ObjectKind::Rune: {
+                m_obj_words.push_back(static_cast<uint64_t>(SscObjTag::Immediate));
+                m_obj_words.push_back(obj.as_raw());
+            } break;
+            default: {
+                // boxes, closures, and stack segments are never constants of compiled code.
+                return false;
+            }
+        }
+        *out = m_obj_count++;
+        if (obj.is_ptr()) {
+            m_obj_ids[obj.as_ptr()] = *out;
+        }
+        return true;
+    }
+
+    bool SscWriter::write(std::ostream& out, uint64_t key, VSubr const& subr) {
+        for (GDefID gdef = m_first_gdef_id; gdef < m_code.count_globals(); gdef++) {
+            gdef_id(gdef);
+        }
+
+        // expressions:
+        std::vector<uint64_t> exp_words;
+        std::vector<uint64_t> loc_words;
+        exp_words.reserve(static_cast<size_t>(m_end_exp_id - m_first_exp_id) * (1 + SSC_ARG_WORD_COUNT));
+        for (VmExpID exp_id = m_first_exp_id; exp_id < m_end_exp_id; exp_id++) {
+            VmExp const& exp = m_code[exp_id];
+            SscArgRoles roles;
+            if (!ssc_arg_roles(exp.kind, &roles)) {
+                return false;
+            }
+            uint64_t words[SSC_ARG_WORD_COUNT];
+            memcpy(words, &exp.args, sizeof(words));
+            for (size_t i = 0; i < SSC_ARG_WORD_COUNT; i++) {
+                switch (roles[i]) {
+                    case SscArgRole::Plain: break;
+                    case SscArgRole::Exp: {
+                        if (!rel_exp_id(static_cast<VmExpID>(words[i]), &words[i])) {
+                            return false;
+                        }
+                    } break;
+                    case SscArgRole::Obj: {
+                        OBJECT obj = std::bit_cast<OBJECT>(words[i]);
+                        if (!obj_id(obj, &words[i])) {
+                            return false;
+                        }
+                    } break;
+                    case SscArgRole::GDef: words[i] = gdef_id(static_cast<GDefID>(words[i])); break;
+                    case SscArgRole::PProc: words[i] = pproc_id(static_cast<PlatformProcID>(words[i])); break;
+                    case SscArgRole::ProcBody: words[i] = 0; break;
+                }
+            }
+            exp_words.push_back(static_cast<uint64_t>(exp.kind));
+            exp_words.insert(exp_words.end(), words, words + SSC_ARG_WORD_COUNT);
+
+            // closure locations:
+            if (exp.kind == VmExpKind::Close) {
+                FLoc const* loc = m_code.closure_loc(exp.args.i_close.body);
+                if (loc) {
+                    loc_words.push_back(exp.args.i_close.body - m_first_exp_id);
+                    push_loc(loc_words, *loc);
+                }
+            }
+        }
+
+        // lines: only each line's program is written, cf `load_vcode_cache`.
+        std::vector<uint64_t> line_words;
+        for (size_t i = 0; i < subr.line_programs.size(); i++) {
+            uint64_t s, t;
+            if (!rel_exp_id(subr.line_programs[i].s, &s) || !rel_exp_id(subr.line_programs[i].t, &t)) {
+                return false;
+            }
+            line_words.push_back(s);
+            line_words.push_back(t);
+        }
+
+        // writing: string ids are only final once every other table is built.
+        std::vector<uint64_t> body_words;
+        auto push_table = [&body_words] (uint64_t count, std::vector<uint64_t> const& words) {
+            body_words.push_back(count);
+            body_words.insert(body_words.end(), words.begin(), words.end());
+        };
+        push_bytes(body_words, subr.name.data(), subr.name.size());
+        push_table(m_string_count, m_string_words);
+        push_table(m_gdef_count, m_gdef_words);
+        push_table(m_pproc_words.size(), m_pproc_words);
+        push_table(m_obj_count, m_obj_words);
+        push_table(static_cast<uint64_t>(m_end_exp_id - m_first_exp_id), exp_words);
+        push_table(subr.line_programs.size(), line_words);
+        push_table(loc_words.size() / 6, loc_words);
+
+        SscHeader header;
+        memcpy(header.magic, SSC_MAGIC, sizeof(SSC_MAGIC));
+        header.version = SSC_VERSION;
+        header.build_key = SSC_BUILD_KEY;
+        header.key = key;
+        header.checksum = ssc_checksum(body_words.data(), body_words.size());
+        out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        out.write(reinterpret_cast<char const*>(body_words.data()), static_cast<std::streamsize>(body_words.size() * sizeof(uint64_t)));
+        return out.good();
+    }
+
+    bool write_vcode_cache(
+        std::ostream& out, uint64_t key, VCode& code, VSubr const& subr, GDefID first_gdef_id
+    ) {
+        // subrs built by hand may not name their unit: it is then that of their programs.
+        VCodeUnitID unit = subr.unit;
+        if (unit == VCODE_NO_UNIT && !subr.line_programs.empty()) {
+            unit = vmx_unit(subr.line_programs[0].s);
+        }
+        SscWriter writer{code, unit, first_gdef_id};
+        return writer.write(out, key, subr);
+    }
+
+    bool save_vcode_cache(
+        std::string const& ssc_path, uint64_t key, VCode& code, VSubr const& subr, GDefID first_gdef_id
+    ) {
+        // written beside, then renamed over, so that other processes never map a partially written file:
+        std::string tmp_path = ssc_path + ".tmp";
+        bool ok;
+        {
+            std::ofstream out{tmp_path, std::ios::binary | std::ios::trunc};
+            if (!out.is_open()) {
+                return false;
+            }
+            ok = write_vcode_cache(out, key, code, subr, first_gdef_id);
+        }
+        if (!ok || std::rename(tmp_path.c_str(), ssc_path.c_str()) != 0) {
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool vcode_cache_matches(std::string const& ssc_path, uint64_t key) {
+        std::ifstream in{ssc_path, std::ios::binary};
+        SscHeader header;
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return false;
+        }
+        return (
+            memcmp(header.magic, SSC_MAGIC, sizeof(SSC_MAGIC)) == 0 &&
+            header.version == SSC_VERSION &&
+            header.build_key == SSC_BUILD_KEY &&
+            header.key == key
+        );
+    }
+
+    //
+    // Loading:
+    // Everything is read and checked before `code` is changed, so that a bad file leaves it as it was.
+    //
+
+    class SscReader {
+    private:
+        uint64_t const* m_words;
+        size_t m_word_count;
+        size_t m_pos;
+        bool m_ok;
+
+    public:
+        SscReader(uint64_t const* words, size_t word_count)
+        :   m_words(words),
+            m_word_count(word_count),
+            m_pos(0),
+            m_ok(true)
+        {}
+
+    public:
+        bool ok() const { return m_ok; }
+        uint64_t const* take(size_t count) {
+            if (!m_ok || count > m_word_count - m_pos) {
+                m_ok = false;
+                return nullptr;
+            }
+            uint64_t const* res = m_words + m_pos;
+            m_pos += count;
+            return res;
+        }
+        uint64_t next() {
+            uint64_t const* res = take(1);
+            return res ? *res : 0;
+        }
+        // next_index reads a word, which must be less than `bound`:
+        uint64_t next_index(uint64_t bound) {
+            uint64_t res = next();
+            if (res >= bound) {
+                m_ok = false;
+                return 0;
+            }
+            return res;
+        }
+        std::string next_string() {
+            uint64_t byte_count = next();
+            if (byte_count > (m_word_count - m_pos) * sizeof(uint64_t)) {
+                m_ok = false;
+                return {};
+            }
+            uint64_t const* words = take((byte_count + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+            return words ? std::string{reinterpret_cast<char const*>(words), byte_count} : std::string{};
+        }
+    };
+
+    static FLoc read_loc(SscReader& r, std::vector<IntStr> const& strings) {
+        IntStr source = strings[r.next_index(strings.size())];
+        long first_line = static_cast<long>(r.next());
+        long first_column = static_cast<long>(r.next());
+        long last_line = static_cast<long>(r.next());
+        long last_column = static_cast<long>(r.next());
+        return FLoc{source, FLocSpan{FLocPos{first_line, first_column}, FLocPos{last_line, last_column}}};
+    }
+
+    std::optional<VSubr> load_vcode_cache_words(
+        uint64_t const* words, size_t word_count, uint64_t key, VCode& code, GcThreadFrontEnd* gc_tfe
+    ) {
+        SscReader r{words, word_count};
+        uint64_t const* header_words = r.take(sizeof(SscHeader) / sizeof(uint64_t));
+        if (!header_words) {
+            return {};
+        }
+        SscHeader header;
+        memcpy(&header, header_words, sizeof(header));
+        if (
+            memcmp(header.magic, SSC_MAGIC, sizeof(SSC_MAGIC)) != 0 ||
+            header.version != SSC_VERSION ||
+            header.build_key != SSC_BUILD_KEY ||
+            header.key != key ||
+            header.checksum != ssc_checksum(words + sizeof(SscHeader) / sizeof(uint64_t), word_count - sizeof(SscHeader) / sizeof(uint64_t))
+        ) {
+            return {};
+        }
+        std::string subr_name = r.next_string();
+
+        // strings:
+        std::vector<IntStr> strings(r.next_index(word_count));
+        for (IntStr& s: strings) {
+            s = intern(r.next_string());
+        }
+
+        // globals: each global this subr defines must be new, and each it refers to must exist.
+        struct CachedGlobal {
+            IntStr name;
+            bool is_defined_here;
+            bool is_mutated;
+            bool is_known_proc;
+            FLoc loc;
+            KnownProc proc;
+            GDefID gdef_id;
+        };
+        std::vector<CachedGlobal> globals(r.next_index(word_count));
+        GDefID next_gdef_id = code.count_globals();
+        for (CachedGlobal& global: globals) {
+            global.name = strings[r.next_index(strings.size())];
+            uint64_t flags = r.next();
+            global.is_defined_here = flags & 0x1;
+            global.is_mutated = flags & 0x2;
+            global.is_known_proc = flags & 0x4;
+            global.loc = read_loc(r, strings);
+            uint64_t rel_proc_body = r.next();
+            global.proc.arity = r.next();
+            std::optional<GDefID> old_gdef_id = code.def_tab().lookup_global_id(global.name);
+            if (global.is_defined_here) {
+                if (old_gdef_id.has_value()) {
+                    return {};
+                }
+                global.gdef_id = next_gdef_id++;
+                global.proc.body = static_cast<VmExpID>(rel_proc_body);     // relinked below
+            } else {
+                if (!old_gdef_id.has_value()) {
+                    return {};
+                }
+                global.gdef_id = old_gdef_id.value();
+                if (global.is_known_proc) {
+                    // calls to a procedure defined elsewhere are only direct if it is still known, and agrees:
+                    KnownProc const* proc = code.known_proc(global.gdef_id);
+                    if (!proc || proc->arity != global.proc.arity) {
+                        return {};
+                    }
+                    global.proc.body = proc->body;
+                }
+            }
+        }
+
+        // platform procedures:
+        std::vector<PlatformProcID> pprocs(r.next_index(word_count));
+        for (PlatformProcID& proc_id: pprocs) {
+            std::optional<PlatformProcID> opt_proc_id = code.pproc_tab().lookup(strings[r.next_index(strings.size())]);
+            if (!opt_proc_id.has_value()) {
+                return {};
+            }
+            proc_id = opt_proc_id.value();
+        }
+
+        // constants:
+        std::vector<OBJECT> objs(r.next_index(word_count));
+        for (size_t i = 0; i < objs.size() && r.ok(); i++) {
+            switch (static_cast<SscObjTag>(r.next())) {
+                case SscObjTag::Immediate: {
+                    objs[i] = std::bit_cast<OBJECT>(r.next());
+                    if (objs[i].is_ptr() || objs[i].is_symbol() || objs[i].is_immediate_float64()) {
+                        return {};
+                    }
+                } break;
+                case SscObjTag::Symbol: {
+                    objs[i] = OBJECT::make_symbol(strings[r.next_index(strings.size())]);
+                } break;
+                case SscObjTag::Float64: {
+                    uint64_t bits = r.next();
+                    double f64;
+                    memcpy(&f64, &bits, sizeof(f64));
+                    objs[i] = OBJECT::make_float64(gc_tfe, f64);
+                } break;
+                case SscObjTag::String: {
+                    std::string text = r.next_string();
+                    objs[i] = OBJECT::make_string(gc_tfe, text.size(), text.data(), false);
+                } break;
+                case SscObjTag::Pair: {
+                    OBJECT car = objs[r.next_index(i)];
+                    OBJECT cdr = objs[r.next_index(i)];
+                    objs[i] = OBJECT::make_pair(gc_tfe, car, cdr);
+                } break;
+                case SscObjTag::Vector: {
+                    uint64_t count = r.next_index(word_count);
+                    std::vector<OBJECT> items(count);
+                    for (OBJECT& item: items) {
+                        item = objs[r.next_index(i)];
+                    }
+                    objs[i] = OBJECT::make_vector(gc_tfe, items);
+                } break;
+                default: {
+                    return {};
+                }
+            }
+        }
+
+        // expressions: these are loaded into a new unit, cf `VCode::new_unit`.
+        VmExpID base_exp_id = vmx_id(code.next_unit_id(), 0);
+        uint64_t exp_count = r.next_index(word_count);
+        if (exp_count >= (uint64_t{1} << VMX_UNIT_SHIFT)) {
+            return {};
+        }
+        for (CachedGlobal& global: globals) {
+            if (global.is_defined_here && global.is_known_proc) {
+                if (static_cast<uint64_t>(global.proc.body) >= exp_count) {
+                    return {};
+                }
+                global.proc.body += base_exp_id;
+            }
+        }
+        std::vector<VmExp> exps;
+        exps.reserve(exp_count);
+        for (uint64_t i = 0; i < exp_count && r.ok(); i++) {
+            uint64_t raw_kind = r.next_index(VMX_KIND_COUNT);
+            VmExp& exp = exps.emplace_back(static_cast<VmExpKind>(raw_kind));
+            SscArgRoles roles;
+            uint64_t const* arg_words = r.take(SSC_ARG_WORD_COUNT);
+            if (!arg_words || !ssc_arg_roles(exp.kind, &roles)) {
+                return {};
+            }
+            uint64_t words[SSC_ARG_WORD_COUNT];
+            memcpy(words, arg_words, sizeof(words));
+            for (size_t j = 0; j < SSC_ARG_WORD_COUNT; j++) {
+                switch (roles[j]) {
+                    case SscArgRole::Plain: break;
+                    case SscArgRole::Exp: {
+                        if (words[j] >= exp_count) {
+                            return {};
+                        }
+                        words[j] = static_cast<uint64_t>(base_exp_id + static_cast<VmExpID>(words[j]));
+                    } break;
+                    case SscArgRole::Obj: {
+                        if (words[j] >= objs.size()) {
+                            return {};
+                        }
+                        memcpy(&words[j], &objs[words[j]], sizeof(OBJECT));
+                    } break;
+                    case SscArgRole::GDef: {
+                        if (words[j] >= globals.size()) {
+                            return {};
+                        }
+                        words[j] = globals[words[j]].gdef_id;
+                    } break;
+                    case SscArgRole::PProc: {
+                        if (words[j] >= pprocs.size()) {
+                            return {};
+                        }
+                        words[j] = pprocs[words[j]];
+                    } break;
+                    case SscArgRole::ProcBody: {
+                        // the previous word is a global, which was bounds-checked:
+                        if (j == 0 || roles[j - 1] != SscArgRole::GDef || !globals[arg_words[j - 1]].is_known_proc) {
+                            return {};
+                        }
+                        words[j] = static_cast<uint64_t>(globals[arg_words[j - 1]].proc.body);
+                    } break;
+                }
+            }
+            memcpy(&exp.args, words, sizeof(words));
+        }
+
+        // lines:
+        uint64_t line_count = r.next_index(word_count);
+        std::vector<OBJECT> line_code_objs;
+        std::vector<VmProgram> line_programs;
+        for (uint64_t i = 0; i < line_count && r.ok(); i++) {
+            line_code_objs.push_back(OBJECT::null);
+            VmExpID s = base_exp_id + static_cast<VmExpID>(r.next_index(exp_count));
+            VmExpID t = base_exp_id + static_cast<VmExpID>(r.next_index(exp_count));
+            line_programs.push_back({s, t});
+        }
+
+        // closure locations:
+        uint64_t loc_count = r.next_index(word_count);
+        std::vector<std::pair<VmExpID, FLoc>> closure_locs;
+        for (uint64_t i = 0; i < loc_count && r.ok(); i++) {
+            VmExpID body = base_exp_id + static_cast<VmExpID>(r.next_index(exp_count));
+            closure_locs.push_back({body, read_loc(r, strings)});
+        }
+        if (!r.ok()) {
+            return {};
+        }
+
+        // committing:
+        VCodeUnitID unit = code.new_unit(std::move(exps));
+        assert(unit == vmx_unit(base_exp_id));
+        for (CachedGlobal const& global: globals) {
+            if (global.is_defined_here) {
+                GDefID gdef_id = code.define_global(global.loc, global.name);
+                assert(gdef_id == global.gdef_id);
+                if (global.is_mutated) {
+                    code.def_tab().mark_global_defn_mutated(gdef_id);
+                }
+                if (global.is_known_proc) {
+                    code.set_known_proc(gdef_id, global.proc);
+                }
+            }
+        }
+        for (auto const& [body, loc]: closure_locs) {
+            code.set_closure_loc(body, loc);
+        }
+        std::optional<VSubr> res;
+        res.emplace(std::move(subr_name), std::move(line_code_objs), std::move(line_programs), unit);
+        return res;
+    }
+
+    std::optional<VSubr> load_vcode_cache(
+        std::string const& ssc_path, uint64_t key, VCode& code, GcThreadFrontEnd* gc_tfe
+    ) {
+        TraceSpan span{"load-vcode-cache", ssc_path};
+        size_t byte_count = 0;
+        APtr mem = os_map_file(ssc_path.c_str(), &byte_count);
+        if (!mem) {
+            return {};
+        }
+        std::optional<VSubr> res = load_vcode_cache_words(
+            reinterpret_cast<uint64_t const*>(mem), byte_count / sizeof(uint64_t), key, code, gc_tfe
+        );
+        os_unmap_file(mem, byte_count);
+        return res;
+    }
+
+}   // namespace ss
@@ -2,6 +2,8 @@
 #include <iomanip>
 #include <sstream>
 #include <cmath>
+#include <array>
+#include <algorithm>
 
 #include "ss-core/printing.hh"
 
@@ -10,13 +12,25 @@ namespace ss {
     /// VCode:
     //
     VCode::VCode(size_t file_count)
-    :   m_exps(), 
+    :   m_units(), 
+        m_free_unit_ids(),
+        m_current_unit(0),
+        m_exp_count(0),
         m_subrs(),
         m_def_tab(),
-        m_pproc_tab()
+        m_pproc_tab(),
+        m_pproc_prims(),
+        m_nuate_entry(-1),
+        m_spawn_entry(-1),
+        m_call_entry(-1),
+        m_halt_entry(-1),
+        m_closure_locs(),
+        m_known_procs()
     {
         size_t expected_num_defs = file_count * 100;
-        m_exps.reserve(4096);
+        new_unit();
+        m_units[0]->exps.reserve(4096);
+        pin_unit(0);
         m_subrs.reserve(expected_num_defs);
     }
     void VCode::enqueue_main_subr(std::string const& file_name, VSubr&& script) {
@@ -25,7 +39,10 @@ namespace ss {
         bool is_empty = true;
 
         if (!script.line_programs.empty()) {
-            // storing the input lines and the programs on this VM:
+            // storing the input lines and the programs on this VM: these may run again, cf `sync_execute`.
+            if (script.unit != VCODE_NO_UNIT) {
+                pin_unit(script.unit);
+            }
             m_subrs.push_back(std::move(script));
             is_empty = false;
         }
@@ -33,10 +50,155 @@ namespace ss {
             warning(std::string("VM: Input file `") + file_name + "` is empty.");
         }
     }
+    void VCode::mark(GcMarker& marker) const {
+        for (std::unique_ptr<Unit> const& unit: m_units) {
+            if (!unit) {
+                continue;
+            }
+            for (VmExp const& exp: unit->exps) {
+                switch (exp.kind) {
+                    case VmExpKind::Constant:
+                    case VmExpKind::ConstantPush: {
+                        marker.mark(exp.args.i_constant.obj);
+                    } break;
+                    case VmExpKind::Define: {
+                        marker.mark(exp.args.i_define.var);
+                    } break;
+                    default: {} break;
+                }
+            }
+        }
+        for (VSubr const& subr: m_subrs) {
+            marker.mark_all(subr.line_code_objs.data(), subr.line_code_objs.size());
+        }
+        m_def_tab.mark(marker);
+    }
     VCode::VCode(VCode&& other) noexcept
-    :   m_exps(std::move(other.m_exps)),
-        m_subrs(std::move(other.m_subrs)) 
+    :   m_units(std::move(other.m_units)),
+        m_free_unit_ids(std::move(other.m_free_unit_ids)),
+        m_current_unit(other.m_current_unit),
+        m_exp_count(other.m_exp_count),
+        m_subrs(std::move(other.m_subrs)),
+        m_nuate_entry(other.m_nuate_entry),
+        m_spawn_entry(other.m_spawn_entry),
+        m_call_entry(other.m_call_entry),
+        m_halt_entry(other.m_halt_entry),
+        m_closure_locs(std::move(other.m_closure_locs)),
+        m_known_procs(std::move(other.m_known_procs))
     {}
+    template <typename F>
+    VmExpID VCode::new_shared_vmx(F&& make) {
+        // entries shared by all code are made in unit 0, whatever unit is being compiled:
+        VCodeUnitID unit = m_current_unit;
+        m_current_unit = 0;
+        VmExpID res = make();
+        m_current_unit = unit;
+        return res;
+    }
+
+    VmExpID VCode::nuate_entry() {
+        // cf p.86 of three-imp
+        if (m_nuate_entry < 0) {
+            m_nuate_entry = new_shared_vmx([this] () {
+                return new_vmx_refer_local(0, new_vmx_nuate(new_vmx_return(0)));
+            });
+        }
+        return m_nuate_entry;
+    }
+    VmExpID VCode::spawn_entry() {
+        if (m_spawn_entry < 0) {
+            m_spawn_entry = new_shared_vmx([this] () {
+                return new_vmx_frame(new_vmx_apply(), new_vmx_halt());
+            });
+        }
+        return m_spawn_entry;
+    }
+    VmExpID VCode::call_entry() {
+        if (m_call_entry < 0) {
+            m_call_entry = new_shared_vmx([this] () {
+                return new_vmx_apply();
+            });
+        }
+        return m_call_entry;
+    }
+    VmExpID VCode::halt_entry() {
+        if (m_halt_entry < 0) {
+            m_halt_entry = new_shared_vmx([this] () {
+                return new_vmx_halt();
+            });
+        }
+        return m_halt_entry;
+    }
+
+    // Units:
+    //
+
+    VCodeUnitID VCode::new_unit() {
+        VCodeUnitID unit;
+        if (!m_free_unit_ids.empty()) {
+            unit = m_free_unit_ids.back();
+            m_free_unit_ids.pop_back();
+        } else {
+            unit = m_units.size();
+            assert(unit < (size_t{1} << (8*sizeof(VmExpID) - 1 - VMX_UNIT_SHIFT)) && "Too many VCode units");
+            m_units.emplace_back();
+        }
+        m_units[unit] = std::make_unique<Unit>(Unit{{}, false, false});
+        m_current_unit = unit;
+        return unit;
+    }
+    VCodeUnitID VCode::new_unit(std::vector<VmExp> exps) {
+        VCodeUnitID unit = new_unit();
+        m_exp_count += exps.size();
+        m_units[unit]->exps = std::move(exps);
+        return unit;
+    }
+    void VCode::select_unit(VCodeUnitID unit) {
+        assert(has_unit(unit));
+        m_current_unit = unit;
+    }
+    void VCode::free_unit(VCodeUnitID unit) {
+        assert(has_unit(unit) && !m_units[unit]->is_pinned);
+        assert(vmx_unit(m_nuate_entry) != unit && vmx_unit(m_spawn_entry) != unit);
+        assert(std::all_of(
+            m_known_procs.begin(), m_known_procs.end(), 
+            [unit] (auto const& it) { return vmx_unit(it.second.body) != unit; }
+        ));
+
+        // closure locations are only kept for the bodies of 'close' expressions:
+        std::unique_ptr<Unit> freed = std::move(m_units[unit]);
+        for (VmExp const& exp: freed->exps) {
+            if (exp.kind == VmExpKind::Close) {
+                m_closure_locs.erase(exp.args.i_close.body);
+            }
+        }
+        m_exp_count -= freed->exps.size();
+        m_free_unit_ids.push_back(unit);
+        if (m_current_unit == unit) {
+            m_current_unit = 0;
+        }
+    }
+    void VCode::clear_unit_marks() {
+        for (std::unique_ptr<Unit>& unit: m_units) {
+            if (unit) {
+                unit->is_marked = false;
+            }
+        }
+    }
+    std::vector<VCodeUnitID> VCode::free_unmarked_units() {
+        std::vector<VCodeUnitID> freed;
+        for (VCodeUnitID unit = 0; unit < m_units.size(); unit++) {
+            if (m_units[unit] && !m_units[unit]->is_pinned && !m_units[unit]->is_marked) {
+                free_unit(unit);
+                freed.push_back(unit);
+            }
+        }
+        return freed;
+    }
+
+    // Globals:
+    //
+
     GDefID VCode::define_global(FLoc loc, IntStr name, OBJECT code, OBJECT init, std::string docstring) {
         return m_def_tab.define_global(loc, name, code, init, std::move(docstring));
     }
@@ -70,10 +232,33 @@ namespace ss {
             is_variadic
         );
     }
+    PlatformProcID VCode::define_platform_proc(
+        IntStr platform_proc_name, 
+        std::vector<IntStr> arg_names,
+        PlatformProcFn fn, 
+        std::string docstring
+    ) {
+        return m_pproc_tab.define(
+            platform_proc_name,
+            std::move(arg_names),
+            fn,
+            std::move(docstring)
+        );
+    }
+    void VCode::set_platform_proc_prim(PlatformProcID id, VmExpKind prim_kind) {
+        assert(vmx_kind_is_prim(prim_kind));
+        if (m_pproc_prims.size() <= id) {
+            m_pproc_prims.resize(id + 1, VmExpKind::PInvoke);
+        }
+        m_pproc_prims[id] = prim_kind;
+    }
+    VmExpKind VCode::platform_proc_prim(PlatformProcID id) const {
+        return (id < m_pproc_prims.size()) ? m_pproc_prims[id] : VmExpKind::PInvoke;
+    }
     PlatformProcID VCode::lookup_platform_proc(IntStr platform_proc_name) {
         auto opt_res = m_pproc_tab.lookup(platform_proc_name);
         if (!opt_res.has_value()) {
-            error("Undefined platform procedure used: " + interned_string(platform_proc_name));
+            error("Undefined platform procedure used: " + std::string{interned_string(platform_proc_name)});
             throw SsiError();
         }
         return opt_res.value();
@@ -83,8 +268,11 @@ namespace ss {
     /// Creating VM Expressions:
     //
     std::pair<VmExpID, VmExp&> VCode::help_new_vmx(VmExpKind kind) {
-        VmExpID exp_id = m_exps.size();
-        VmExp& exp_ref = m_exps.emplace_back(kind);
+        std::vector<VmExp>& exps = m_units[m_current_unit]->exps;
+        assert(exps.size() < (size_t{1} << VMX_UNIT_SHIFT) && "Too many VmExps in one VCode unit");
+        VmExpID exp_id = vmx_id(m_current_unit, exps.size());
+        VmExp& exp_ref = exps.emplace_back(kind);
+        m_exp_count++;
         return {exp_id, exp_ref};
     }
     VmExpID VCode::new_vmx_halt() {
@@ -133,16 +321,16 @@ namespace ss {
         args.next_if_f = next_if_f;
         return exp_id;
     }
-    VmExpID VCode::new_vmx_conti(VmExpID x) {
+    VmExpID VCode::new_vmx_conti(size_t n, VmExpID x) {
         auto [exp_id, exp_ref] = help_new_vmx(VmExpKind::Conti);
         auto& args = exp_ref.args.i_conti;
+        args.n = n;
         args.x = x;
         return exp_id;
     }
-    VmExpID VCode::new_vmx_nuate(OBJECT stack, VmExpID x) {
+    VmExpID VCode::new_vmx_nuate(VmExpID x) {
         auto [exp_id, exp_ref] = help_new_vmx(VmExpKind::Nuate);
         auto& args = exp_ref.args.i_nuate;
-        args.stack = stack;
         args.x = x;
         return exp_id;
     }
@@ -209,6 +397,13 @@ namespace ss {
         args.x = next;
         return exp_id;
     }
+    VmExpID VCode::new_vmx_assign_local_unboxed(size_t n, VmExpID next) {
+        auto [exp_id, exp_ref] = help_new_vmx(VmExpKind::AssignLocalUnboxed);
+        auto& args = exp_ref.args.i_assign;
+        args.n = n;
+        args.x = next;
+        return exp_id;
+    }
     VmExpID VCode::new_vmx_shift(ssize_t n, ssize_t m, VmExpID x) {
         auto [exp_id, exp_ref] = help_new_vmx(VmExpKind::Shift);
         auto& args = exp_ref.args.i_shift;
@@ -226,28 +421,203 @@ namespace ss {
         return exp_id;
     }
 
+    VmExpID VCode::new_vmx_prim(VmExpKind prim_kind, size_t platform_proc_idx, VmExpID x) {
+        assert(vmx_kind_is_prim(prim_kind));
+        auto [exp_id, exp_ref] = help_new_vmx(prim_kind);
+        auto& args = exp_ref.args.i_prim;
+        args.proc_id = platform_proc_idx;
+        args.x = x;
+        return exp_id;
+    }
+    VmExpID VCode::new_vmx_call_global(size_t gn, VmExpID body) {
+        auto [exp_id, exp_ref] = help_new_vmx(VmExpKind::CallGlobal);
+        auto& args = exp_ref.args.i_call_global;
+        args.gn = gn;
+        args.body = body;
+        args.n = 0;
+        args.m = 0;
+        return exp_id;
+    }
+    VmExpID VCode::new_vmx_shift_call_global(size_t gn, VmExpID body, ssize_t n, ssize_t m) {
+        auto [exp_id, exp_ref] = help_new_vmx(VmExpKind::ShiftCallGlobal);
+        auto& args = exp_ref.args.i_call_global;
+        args.gn = gn;
+        args.body = body;
+        args.n = static_cast<int32_t>(n);
+        args.m = static_cast<int32_t>(m);
+        return exp_id;
+    }
+    VmExpID VCode::new_vmx_self_tail_call(size_t gn, VmExpID body, ssize_t n) {
+        auto [exp_id, exp_ref] = help_new_vmx(VmExpKind::SelfTailCall);
+        auto& args = exp_ref.args.i_call_global;
+        args.gn = gn;
+        args.body = body;
+        args.n = n;
+        args.m = n;
+        return exp_id;
+    }
+
     /// Dump
     //
+    char const* vmx_kind_name(VmExpKind kind) {
+        switch (kind) {
+            case VmExpKind::Halt: return "halt";
+            case VmExpKind::ReferLocal: return "refer-local";
+            case VmExpKind::ReferFree: return "refer-free";
+            case VmExpKind::ReferGlobal: return "refer-global";
+            case VmExpKind::Constant: return "constant";
+            case VmExpKind::Close: return "close";
+            case VmExpKind::Test: return "test";
+            case VmExpKind::AssignLocal: return "assign-local";
+            case VmExpKind::AssignFree: return "assign-free";
+            case VmExpKind::AssignGlobal: return "assign-global";
+            case VmExpKind::AssignLocalUnboxed: return "assign-local-unboxed";
+            case VmExpKind::Conti: return "conti";
+            case VmExpKind::Nuate: return "nuate";
+            case VmExpKind::Frame: return "frame";
+            case VmExpKind::Argument: return "argument";
+            case VmExpKind::Apply: return "apply";
+            case VmExpKind::Return: return "return";
+            case VmExpKind::Define: return "define";
+            case VmExpKind::Indirect: return "indirect";
+            case VmExpKind::Box: return "box";
+            case VmExpKind::Shift: return "shift";
+            case VmExpKind::PInvoke: return "p/invoke";
+            case VmExpKind::CallGlobal: return "call-global";
+            case VmExpKind::ShiftCallGlobal: return "shift-call-global";
+            case VmExpKind::SelfTailCall: return "self-tail-call";
+            case VmExpKind::ReferLocalPush: return "refer-local-push";
+            case VmExpKind::ReferFreePush: return "refer-free-push";
+            case VmExpKind::ReferGlobalPush: return "refer-global-push";
+            case VmExpKind::ConstantPush: return "constant-push";
+            case VmExpKind::ReferGlobalApply: return "refer-global-apply";
+            case VmExpKind::ShiftApply: return "shift-apply";
+            case VmExpKind::ReferGlobalShiftApply: return "refer-global-shift-apply";
+            case VmExpKind::PrimAdd: return "prim-add";
+            case VmExpKind::PrimSub: return "prim-sub";
+            case VmExpKind::PrimMul: return "prim-mul";
+            case VmExpKind::PrimDiv: return "prim-div";
+            case VmExpKind::PrimRem: return "prim-rem";
+            case VmExpKind::PrimEq: return "prim-eq";
+            case VmExpKind::PrimLt: return "prim-lt";
+            case VmExpKind::PrimGt: return "prim-gt";
+            case VmExpKind::PrimLe: return "prim-le";
+            case VmExpKind::PrimGe: return "prim-ge";
+            case VmExpKind::PrimCons: return "prim-cons";
+            case VmExpKind::PrimCar: return "prim-car";
+            case VmExpKind::PrimCdr: return "prim-cdr";
+            case VmExpKind::PrimIsNull: return "prim-null?";
+            case VmExpKind::PrimIsPair: return "prim-pair?";
+            case VmExpKind::Jump: return "jump";
+            case VmExpKind::PrimAddRR: return "prim-add-rr";
+            case VmExpKind::PrimSubRR: return "prim-sub-rr";
+            case VmExpKind::PrimMulRR: return "prim-mul-rr";
+            case VmExpKind::PrimDivRR: return "prim-div-rr";
+            case VmExpKind::PrimRemRR: return "prim-rem-rr";
+            case VmExpKind::PrimEqRR: return "prim-eq-rr";
+            case VmExpKind::PrimLtRR: return "prim-lt-rr";
+            case VmExpKind::PrimGtRR: return "prim-gt-rr";
+            case VmExpKind::PrimLeRR: return "prim-le-rr";
+            case VmExpKind::PrimGeRR: return "prim-ge-rr";
+            case VmExpKind::PrimConsRR: return "prim-cons-rr";
+            case VmExpKind::PrimAddRK: return "prim-add-rk";
+            case VmExpKind::PrimSubRK: return "prim-sub-rk";
+            case VmExpKind::PrimMulRK: return "prim-mul-rk";
+            case VmExpKind::PrimDivRK: return "prim-div-rk";
+            case VmExpKind::PrimRemRK: return "prim-rem-rk";
+            case VmExpKind::PrimEqRK: return "prim-eq-rk";
+            case VmExpKind::PrimLtRK: return "prim-lt-rk";
+            case VmExpKind::PrimGtRK: return "prim-gt-rk";
+            case VmExpKind::PrimLeRK: return "prim-le-rk";
+            case VmExpKind::PrimGeRK: return "prim-ge-rk";
+            case VmExpKind::PrimConsRK: return "prim-cons-rk";
+            case VmExpKind::PrimCarR: return "prim-car-r";
+            case VmExpKind::PrimCdrR: return "prim-cdr-r";
+            case VmExpKind::PrimIsNullR: return "prim-null?-r";
+            case VmExpKind::PrimIsPairR: return "prim-pair?-r";
+            case VmExpKind::ApplyCached: return "apply-cached";
+            case VmExpKind::ReferGlobalApplyCached: return "refer-global-apply-cached";
+            case VmExpKind::ShiftApplyCached: return "shift-apply-cached";
+            case VmExpKind::ReferGlobalShiftApplyCached: return "refer-global-shift-apply-cached";
+        }
+        return "?";
+    }
+    bool vmx_kind_is_fused(VmExpKind kind) {
+        return kind >= VmExpKind::ReferLocalPush && kind <= VmExpKind::ReferGlobalShiftApply;
+    }
+    bool vmx_kind_is_prim(VmExpKind kind) {
+        return kind >= VmExpKind::PrimAdd && kind <= VmExpKind::PrimIsPair;
+    }
+    bool vmx_kind_is_register(VmExpKind kind) {
+        return kind >= VmExpKind::PrimAddRR && kind <= VmExpKind::PrimIsPairR;
+    }
+    ssize_t vmx_prim_arity(VmExpKind kind) {
+        switch (kind) {
+            case VmExpKind::PrimCar:
+            case VmExpKind::PrimCdr:
+            case VmExpKind::PrimIsNull:
+            case VmExpKind::PrimIsPair:
+                return 1;
+            default:
+                return vmx_kind_is_prim(kind) ? 2 : -1;
+        }
+    }
+    static char const* vmx_fusion_source(VmExpKind kind) {
+        switch (kind) {
+            case VmExpKind::ReferLocalPush: return "refer-local + argument";
+            case VmExpKind::ReferFreePush: return "refer-free + argument";
+            case VmExpKind::ReferGlobalPush: return "refer-global + argument";
+            case VmExpKind::ConstantPush: return "constant + argument";
+            case VmExpKind::ReferGlobalApply: return "refer-global + apply";
+            case VmExpKind::ShiftApply: return "shift + apply";
+            case VmExpKind::ReferGlobalShiftApply: return "refer-global + shift + apply";
+            default: return "";
+        }
+    }
     void VCode::dump(std::ostream& out) const {
         out << "--- ALL_EXPS ---" << std::endl;
-        print_all_exps(out);
+        print_all_exps(out, true);
         out << "--- ALL_FILES ---" << std::endl;
         print_all_files(out);
     }
-    void VCode::print_all_exps(std::ostream& out) const {
-        size_t pad_w = static_cast<size_t>(std::ceil(std::log(1+m_exps.size()) / std::log(10)));
-        for (size_t index = 0; index < m_exps.size(); index++) {
-            out << "  [";
-            out << std::setfill('0') << std::setw(pad_w) << index;
-            out << "] ";
+    void VCode::print_all_exps(std::ostream& out, bool show_fusions) const {
+        std::array<size_t, VMX_KIND_COUNT> fusion_counts{};
+        for (VCodeUnitID unit = 0; unit < m_units.size(); unit++) {
+            if (!m_units[unit]) {
+                continue;
+            }
+            std::vector<VmExp> const& exps = m_units[unit]->exps;
+            out << "  unit " << unit << ":" << std::endl;
+            VmExpID end_exp_id = vmx_id(unit, exps.size());
+            size_t pad_w = static_cast<size_t>(std::ceil(std::log(1+end_exp_id) / std::log(10)));
+            for (VmExpID exp_id = vmx_id(unit, 0); exp_id < end_exp_id; exp_id++) {
+                out << "  [";
+                out << std::setfill('0') << std::setw(pad_w) << exp_id;
+                out << "] ";
 
-            print_one_exp(index, out);
-            
-            out << std::endl;
+                print_one_exp(exp_id, out);
+
+                VmExpKind kind = (*this)[exp_id].kind;
+                if (show_fusions && vmx_kind_is_fused(kind)) {
+                    out << "  ; fused: " << vmx_fusion_source(kind);
+                    fusion_counts[static_cast<size_t>(kind)]++;
+                }
+                
+                out << std::endl;
+            }
+        }
+        if (show_fusions) {
+            out << "  fusions fired:" << std::endl;
+            for (size_t i = 0; i < VMX_KIND_COUNT; i++) {
+                auto kind = static_cast<VmExpKind>(i);
+                if (vmx_kind_is_fused(kind)) {
+                    out << "    " << vmx_kind_name(kind) << ": " << fusion_counts[i] << std::endl;
+                }
+            }
         }
     }
     void VCode::print_one_exp(VmExpID exp_id, std::ostream& out) const {
-        auto const& exp = m_exps[exp_id];
+        auto const& exp = (*this)[exp_id];
         out << "(";
         switch (exp.kind) {
             case VmExpKind::Halt: {
@@ -255,7 +625,7 @@ namespace ss {
             } break;
             case VmExpKind::ReferLocal: {
                 out << "refer-local "
-                    << "#:n " << exp.args.i_refer.n << ' '
+                    << "#:n " << static_cast<ssize_t>(exp.args.i_refer.n) << ' '
                     << "#:x " << exp.args.i_refer.x;
             } break;
             case VmExpKind::ReferFree: {
@@ -270,7 +640,7 @@ namespace ss {
             } break;
             case VmExpKind::AssignLocal: {
                 out << "assign-local "
-                    << "#:n " << exp.args.i_assign.n << ' '
+                    << "#:n " << static_cast<ssize_t>(exp.args.i_assign.n) << ' '
                     << "#:x " << exp.args.i_assign.x;
             } break;
             case VmExpKind::AssignFree: {
@@ -283,6 +653,11 @@ namespace ss {
                     << "#:n " << exp.args.i_assign.n << ' '
                     << "#:x " << exp.args.i_assign.x;
             } break;
+            case VmExpKind::AssignLocalUnboxed: {
+                out << "assign-local-unboxed "
+                    << "#:n " << static_cast<ssize_t>(exp.args.i_assign.n) << ' '
+                    << "#:x " << exp.args.i_assign.x;
+            } break;
             case VmExpKind::Constant: {
                 out << "constant "
                     << "#:obj " << exp.args.i_constant.obj << ' '
@@ -300,11 +675,11 @@ namespace ss {
             } break;
             case VmExpKind::Conti: {
                 out << "conti ";
+                out << "#:n " << exp.args.i_conti.n << ' ';
                 out << "#:x " << exp.args.i_conti.x;
             } break;
             case VmExpKind::Nuate: {
                 out << "nuate "
-                    << "#:stack " << exp.args.i_nuate.stack << ' '
                     << "#:x " << exp.args.i_nuate.x;
             } break;
             case VmExpKind::Frame: {
@@ -340,6 +715,75 @@ namespace ss {
             case VmExpKind::PInvoke: {
                 out << "p/invoke #:n " << exp.args.i_pinvoke.n << " #:proc_idx " << exp.args.i_pinvoke.proc_id;
             } break;
+            case VmExpKind::CallGlobal: {
+                out << "call-global "
+                    << "#:gn " << exp.args.i_call_global.gn << ' '
+                    << "#:body " << exp.args.i_call_global.body;
+            } break;
+            case VmExpKind::ShiftCallGlobal: {
+                out << "shift-call-global "
+                    << "#:gn " << exp.args.i_call_global.gn << ' '
+                    << "#:body " << exp.args.i_call_global.body << ' '
+                    << "#:m " << exp.args.i_call_global.m << ' '
+                    << "#:n " << exp.args.i_call_global.n;
+            } break;
+            case VmExpKind::SelfTailCall: {
+                out << "self-tail-call "
+                    << "#:gn " << exp.args.i_call_global.gn << ' '
+                    << "#:body " << exp.args.i_call_global.body << ' '
+                    << "#:n " << exp.args.i_call_global.n;
+            } break;
+            case VmExpKind::ReferLocalPush:
+            case VmExpKind::ReferFreePush:
+            case VmExpKind::ReferGlobalPush: {
+                out << vmx_kind_name(exp.kind) << " "
+                    << "#:n " << exp.args.i_refer.n << ' '
+                    << "#:x " << exp.args.i_refer.x;
+            } break;
+            case VmExpKind::ConstantPush: {
+                out << "constant-push "
+                    << "#:obj " << exp.args.i_constant.obj << ' '
+                    << "#:x " << exp.args.i_constant.x;
+            } break;
+            case VmExpKind::ReferGlobalApply: {
+                out << "refer-global-apply "
+                    << "#:n " << exp.args.i_refer.n;
+            } break;
+            case VmExpKind::ShiftApply: {
+                out << "shift-apply #:m " << exp.args.i_shift.m << " #:n " << exp.args.i_shift.n;
+            } break;
+            case VmExpKind::ReferGlobalShiftApply: {
+                out << "refer-global-shift-apply "
+                    << "#:gn " << exp.args.i_refer_global_shift.gn << ' '
+                    << "#:m " << exp.args.i_refer_global_shift.m << ' '
+                    << "#:n " << exp.args.i_refer_global_shift.n;
+            } break;
+            case VmExpKind::PrimAdd:
+            case VmExpKind::PrimSub:
+            case VmExpKind::PrimMul:
+            case VmExpKind::PrimDiv:
+            case VmExpKind::PrimRem:
+            case VmExpKind::PrimEq:
+            case VmExpKind::PrimLt:
+            case VmExpKind::PrimGt:
+            case VmExpKind::PrimLe:
+            case VmExpKind::PrimGe:
+            case VmExpKind::PrimCons:
+            case VmExpKind::PrimCar:
+            case VmExpKind::PrimCdr:
+            case VmExpKind::PrimIsNull:
+            case VmExpKind::PrimIsPair: {
+                out << vmx_kind_name(exp.kind) << " "
+                    << "#:proc_idx " << exp.args.i_prim.proc_id << ' '
+                    << "#:x " << exp.args.i_prim.x;
+            } break;
+            case VmExpKind::Jump: {
+                out << "jump";
+            } break;
+            default: {
+                // register instructions and quickened calls are only in bytecode, cf `VBytecode`
+                out << vmx_kind_name(exp.kind);
+            } break;
         }
         out << ")";
     }
@@ -2,26 +2,68 @@
 
 #include <vector>
 #include <string>
+#include <iterator>
 #include <sstream>
 #include <array>
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <cstdint>
 #include <cmath>
 #include <cassert>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 #include "ss-core/config.hh"
 #include "ss-core/feedback.hh"
 #include "ss-core/object.hh"
 #include "ss-core/printing.hh"
+#include "ss-core/port.hh"
 #include "ss-core/common.hh"
 #include "ss-core/std.hh"
 #include "ss-core/vcode.hh"
 #include "ss-core/vthread.hh"
 #include "ss-core/compiler.hh"
+#include "ss-core/expander.hh"
+#include "ss-core/bytecode.hh"
+#include "ss-core/jit.hh"
+#include "ss-core/smt.hh"
+#include "ss-core/profile.hh"
+#include "ss-core/heap-profile.hh"
+#include "ss-core/numvec.hh"
+#include "ss-core/trace.hh"
+
+// VM_THREADED_DISPATCH: whether the bytecode engine dispatches with computed-goto (labels-as-values)
+// - tracing each instruction requires a single dispatch point, so it forces the 'switch' loop.
+#if (defined(__GNUC__) || defined(__clang__)) && !CONFIG_DISABLE_THREADED_DISPATCH && !CONFIG_PRINT_EACH_INSTRUCTION_ON_EXECUTION
+    #define VM_THREADED_DISPATCH (1)
+#else
+    #define VM_THREADED_DISPATCH (0)
+#endif
+
+// VM_JIT: whether the bytecode engine enters native code for hot closure bodies, cf `VJit`
+// - entries are threaded to a handler, so they require threaded dispatch.
+#if VM_THREADED_DISPATCH && !CONFIG_DISABLE_JIT
+    #define VM_JIT (1)
+#else
+    #define VM_JIT (0)
+#endif
 
 namespace ss {
 
+    // Continuations capture the stack in segments of at most this many items, aligned to multiples of it,
+    // so that captures at different depths still share all but their topmost segments.
+    inline constexpr ssize_t VM_STACK_SEGMENT_CAPACITY = 512;
+
     //
     // VmSyntheticEnv
     // A way to build vars and vals in parallel.
@@ -32,20 +74,104 @@ namespace ss {
         OBJECT val_ribs;
     };
 
+    //
+    // VmScheduler
+    // Runs spawned VThreads on a pool of worker OS threads, M:N.
+    //  - worker 0 is the OS thread that runs the VM's main VThread: it only runs others while the main 
+    //    VThread is suspended, or once the current subr's lines are done.
+    //  - other workers are started on the first spawn, one per remaining hardware thread: they are stopped
+    //    before forking, and started again on the next spawn, cf `vm_fork`.
+    //  - each worker queues the VThreads it spawns (or wakes) on its own deque. Idle workers steal from 
+    //    the others' deques.
+    //  - yielding VThreads are queued on a shared FIFO instead, so every other runnable VThread gets a turn.
+    //
+
+    class VmScheduler {
+    private:
+        VirtualMachine* m_vm;
+        std::vector<std::unique_ptr<SmtWorkDeque<VThread*>>> m_deques;     // one per worker
+        SmtFifo<VThread*> m_yielded;
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::atomic<size_t> m_ready_count;  // queued VThreads
+        std::atomic<size_t> m_live_count;   // spawned VThreads that are not Done
+        bool m_shutdown;
+    public:
+        explicit VmScheduler(VirtualMachine* vm);
+        ~VmScheduler();
+    public:
+        void spawn(VThread* t);
+        void enqueue(VThread* t, bool yielded = false);
+        void finish(VThread* t);
+        void notify();
+        // stop_workers joins every worker but worker 0: no VThread may be live, cf `live_count`.
+        void stop_workers();
+        // set_worker_count stops the workers, then sets how many there are (worker 0 included) once started again.
+        void set_worker_count(size_t worker_count);
+    public:
+        // help_until runs queued VThreads on worker 0 until `pred` holds.
+        template <typename Pred>
+        void help_until(Pred pred);
+        // help_once runs at most one queued VThread on worker 0.
+        void help_once();
+    public:
+        size_t live_count() const { return m_live_count.load(); }
+        size_t worker_count() const { return m_deques.size(); }
+    private:
+        VThread* try_pick(size_t worker);
+        void worker_main(size_t worker);
+    };
+
+    // the VThread running on this OS thread (and its VM), if any:
+    static thread_local VirtualMachine* t_running_vm = nullptr;
+    static thread_local VThread* t_running_vthread = nullptr;
+    // the VmScheduler worker index of this OS thread:
+    static thread_local size_t t_worker_index = 0;
+    // how many engines are running on this OS thread, i.e. including nested runs: cf `MutatorGuard`
+    static thread_local size_t t_mutator_depth = 0;
+
     //
     // VirtualMachine (VM)
     //  - stores and constructs VmExps
     //  - runs VmExps to `halt`
     //  - de-allocates all expressions (and thus, all `Object` instances parsed and possibly reused)
+    //  - hosts VThreads: the main VThread runs each line, others are spawned.
+    //    VCode and VBytecode must not change while spawned VThreads run, so each subr is lowered in full
+    //    before it runs, cf `prepare_subr`.
+    //  - collects garbage at safe-points, cf `safepoint`: once the heap requests a collection, each OS 
+    //    thread running an engine stops at its next 'apply', and the last to stop promotes the young objects
+    //    reachable from the roots and remembered set, then (if due) marks the roots and sweeps while the 
+    //    others wait.
+    //    NOTE: only this VM's roots are updated and marked, so a Gc must not be shared by several live VMs.
     //
 
     class VirtualMachine {
     private:
-        VThread m_thread;
+        Gc* m_gc;
+        std::vector<std::unique_ptr<VThread>> m_threads;    // indexed by VThreadID, 0 is the main VThread
+        std::vector<VThreadID> m_free_thread_ids;           // of Free VThreads, reused by `new_vthread`
+        std::mutex m_threads_mutex;                         // guards both
         Compiler m_jit_compiler;
         std::vector<OBJECT> m_global_vals;
+        VmEngine m_engine;
+        VBytecode m_bytecode;
+        VJit m_jit;                     // must be declared after `m_bytecode`
+        bool m_profiling;
+        std::unique_ptr<VmHeapProfile> m_heap_profile;  // cf `vm_enable_heap_profiler`
+        std::mutex m_alloc_site_mutex;                  // cf `sample_allocation`
+        VmScheduler m_scheduler;
+        std::vector<VSubr const*> m_running_subrs;      // may not be in `code()`, cf `vm_interp_expr`
+        std::atomic<size_t> m_continuation_count;       // captured so far, cf `stream_lines`
+        
+        // collection: guarded by `m_gc_mutex`
+        std::mutex m_gc_mutex;
+        std::condition_variable m_gc_cv;
+        size_t m_gc_running_count;      // OS threads running an engine
+        size_t m_gc_stopped_count;      // ... of which are waiting at a safe-point
+        size_t m_gc_epoch;              // incremented by each collection
     public:
-        explicit VirtualMachine(Gc* gc, VirtualMachineStandardProcedureBinder binder);
+        explicit VirtualMachine(Gc* gc, VirtualMachineStandardProcedureBinder binder, VmEngine engine);
         ~VirtualMachine();
     
     // Source code loading + compilation:
@@ -61,6 +187,126 @@ namespace ss {
         template <bool print_each_line>
         OBJECT sync_execute_subr(VSubr const& subr);
 
+        // sync_execute_subr_once runs a subr that is not kept, e.g. `vm_interp_expr`: its code is freed at once 
+        // if it cannot be entered again, and otherwise by a collection once unreachable.
+        template <bool print_each_line>
+        OBJECT sync_execute_subr_once(VSubr const& subr);
+
+    // Streaming execution: cf `vm_stream_lines`
+    public:
+        void begin_streaming();
+
+        template <bool print_each_line>
+        OBJECT stream_lines(std::vector<OBJECT> line_code_objs);
+
+        // Snapshots: cf `vm_fork`
+        int64_t fork();
+    private:
+        void grow_globals();
+        bool is_one_shot(VCodeUnitID unit);
+        void free_unit(VCodeUnitID unit);
+
+    // Engines: each resumes a VThread from its registers until 'halt', leaving the result in the 
+    // accumulator, or until it asks to be suspended.
+    // Returns true iff the VThread halted.
+    private:
+        // With `profiling`, each VThread's VmProfile is updated as it runs, cf `vm_enable_profiler`.
+        template <bool profiling> bool sync_execute_graph(VThread& t);
+        template <bool profiling> bool sync_execute_bytecode(VThread& t);
+
+    // Quickening: cf `VBytecode::quicken_global`
+    // Quickened code only exists while the main VThread runs alone: it is deoptimized before a VThread is
+    // spawned, and by each collection, which may move the objects it refers to.
+    private:
+        bool may_quicken(VThread& t) { return &t == &main_thread() && m_scheduler.live_count() == 0; }
+
+    // VThreads:
+    public:
+        OBJECT spawn_vthread(OBJECT thunk);
+        VThread* find_vthread(VThreadID id);
+        size_t count_vthreads();
+        void set_worker_count(size_t worker_count);
+        void run_spawned_vthread(VThread* t);
+        // take_join_result gives `joiner` the result of `target`, which is Done: the caller must be a mutator.
+        void take_join_result(VThread* joiner, VThread* target);
+        // reclaim_vthread recycles a released VThread once its result is joined, so that `new_vthread` reuses it
+        // and its ID: the caller must hold its mutex. So each VThread may only be joined once, since its ID may 
+        // later refer to another.
+        void reclaim_vthread(VThread* t);
+        void resume(VThread* t);
+    private:
+        // new_vthread makes a VThread that may run alongside this one, but does not spawn it: e.g. by reusing a 
+        // Free VThread.
+        VThread* new_vthread();
+
+    // Bulk operations: cf `vm_parallel_vector_map`
+    // - spawn_bulk splits [begin, end) into chunks, each run by a VThread of its own, then suspends the running 
+    //   VThread to join the root chunk, which halts with the result.
+    // - step_bulk_task runs between the calls of a chunk's VThread: it stores the result of the last, then sets 
+    //   up the next call (or join), returning false once the chunk is done.
+    public:
+        OBJECT spawn_bulk(char const* proc_name, VmBulkKind kind, OBJECT proc, OBJECT items, OBJECT result, ssize_t begin, ssize_t end);
+    private:
+        bool step_bulk_task(VThread* t);
+        void prepare_bulk_call(VThread* t, std::initializer_list<OBJECT> args);
+        OBJECT bulk_item(VThread* t, ssize_t i);
+
+    // Calling back into Scheme: cf `vm_hash_table_update`
+    // - apply_nested applies `proc` to `args` on the running VThread, returning the result: a frame returning 
+    //   to `halt_entry` is pushed above the platform procedure's args, then a nested engine runs it, cf 
+    //   `run_vthread`. Nested engines never stop for a collection, so `proc` may yield, but not join or use 
+    //   channels, which could wait on VThreads that do.
+    public:
+        OBJECT apply_nested(char const* proc_name, OBJECT proc, std::initializer_list<OBJECT> args);
+
+    // Channels: cf `vm_channel_send`
+    // - a VThread suspended on a channel retries once, then blocks on it until another completes the send or 
+    //   receive on its behalf, cf `try_channel_op`.
+    // - each push wakes a blocked receiver, and each pop blocked senders: callers must be mutators.
+    public:
+        OBJECT channel_send(OBJECT channel, OBJECT message);
+        OBJECT channel_receive(OBJECT channel);
+        size_t channel_try_send_batch(OBJECT channel, OBJECT const* messages, size_t count);
+        size_t channel_try_receive_batch(OBJECT channel, OBJECT* out, size_t count);
+    private:
+        ChannelObject* claim_channel_end(char const* proc_name, OBJECT channel, bool is_sender);
+        bool try_channel_op(VThread* t);
+        void cancel_channel_op(VThread* t);
+        void wake_channel_receiver(ChannelObject* channel, GcThreadFrontEnd* gc_tfe);
+        void wake_channel_senders(ChannelObject* channel);
+    
+    // Profiling:
+    public:
+        void enable_profiler();
+        void print_profile(std::ostream& out);
+        void enable_heap_profiler(size_t period);
+        bool write_heap_profile(std::ostream& out);
+    private:
+        void sample_allocation(BaseBoxedObject* obj, size_t byte_count);
+
+    // Collection:
+    public:
+        // safepoint is polled by the engines once the heap requests a collection: the running VThread's 
+        // registers must be saved first. Returns once the collection is done.
+        void safepoint();
+    private:
+        friend struct MutatorGuard;
+        void enter_mutator();
+        void exit_mutator();
+        // collect always collects young objects, and sweeps if the heap requests it, or if `full`.
+        void collect(bool full = false);
+        void collect_young();
+        void mark_closure_code(ClosureObject* closure);
+    private:
+        VmExpID profiled_body(OBJECT c) { return c.is_closure() ? closure_body(c) : VmProfile::TOP_LEVEL_BODY; }
+    private:
+        void prepare_entries();
+        void prepare_subr(VSubr const& subr);
+        VmExpID vthread_entry(VmExpID exp_id);
+        bool run_vthread(VThread* t);
+        void run_main_vthread(VThread* t);
+        bool try_join(VThread* t);
+
     // Interpreter environment setup:
     public:
         OBJECT closure(VmExpID body, ssize_t vars_count, ssize_t s);
@@ -69,43 +315,108 @@ namespace ss {
         OBJECT continuation(ssize_t s);
     public:
         OBJECT save_stack(ssize_t s);
-        ssize_t restore_stack(OBJECT vector);
-        ssize_t push(OBJECT v, ssize_t s) { return m_thread.stack().push(v, s); }
+        ssize_t restore_stack(OBJECT segments);
+        ssize_t push(OBJECT v, ssize_t s) { return thread().stack().push(v, s); }
         ssize_t push(ssize_t v, ssize_t s) { return push(OBJECT::make_integer(v), s); }
-        OBJECT index(ssize_t s, ssize_t i) { return m_thread.stack().index(s, i); }
+        OBJECT index(ssize_t s, ssize_t i) { return thread().stack().index(s, i); }
         OBJECT index(OBJECT s, ssize_t i) { return index(s.as_integer(), i); }
-        void index_set(ssize_t s, ssize_t i, OBJECT v) { m_thread.stack().index_set(s, i, v); }
+        void index_set(ssize_t s, ssize_t i, OBJECT v) { thread().stack().index_set(s, i, v); }
     public:
         VmExpID closure_body(OBJECT c);
         OBJECT index_closure(OBJECT c, ssize_t n);
     public: // for tail-call optimizations, three-imp 4.6.2 p.111
         ssize_t shift_args(ssize_t n, ssize_t m, ssize_t s);
 
+    // Primitives: fast-paths for inlined platform procedures, cf `VmExpKind::PrimAdd`
+    // On a type mismatch, the primitive's platform procedure is called instead.
+    public:
+        // `is_rt_pushed` is false for register instructions, whose second argument is only pushed for the fallback.
+        template <VmExpKind prim_kind, bool is_rt_pushed = true> OBJECT prim_binary(size_t proc_id, OBJECT lt, OBJECT rt, ssize_t s);
+        template <VmExpKind prim_kind> OBJECT prim_unary(size_t proc_id, OBJECT arg, ssize_t s);
+        OBJECT prim(VmExpKind prim_kind, size_t proc_id, OBJECT a, ssize_t& s);
+        OBJECT prim_fallback(size_t proc_id, OBJECT first_arg, ssize_t s, ssize_t arg_count);
+
     // Properties:
     public:
-        GcThreadFrontEnd& gc_tfe() { return *m_thread.gc_tfe(); }
+        // thread is the VThread running on this OS thread.
+        VThread& thread() { return *t_running_vthread; }
+        VThread& main_thread() { return *m_threads[0]; }
+        GcThreadFrontEnd& gc_tfe() { return *thread().gc_tfe(); }
+        Gc* gc() { return m_gc; }
         Compiler& jit_compiler() { return m_jit_compiler; }
         VCode& code() { return *m_jit_compiler.code(); }
+        VBytecode& bytecode() { return m_bytecode; }
+        VJit& jit() { return m_jit; }
+        VmEngine engine() const { return m_engine; }
+        bool runs_bytecode() const { return m_engine != VmEngine::Graph; }
+    };
+
+    // MutatorGuard: counts this OS thread as running an engine, cf `safepoint`.
+    // Only the outermost engine on each OS thread is counted: nested engines cannot stop for a collection
+    // since their callers may hold OBJECTs the roots do not include.
+    // It also keeps collections (which may move young objects) from overlapping accesses to the registers of
+    // VThreads from outside an engine.
+    struct MutatorGuard {
+        VirtualMachine* vm;
+        explicit MutatorGuard(VirtualMachine* vm): vm(vm) {
+            if (t_mutator_depth++ == 0) {
+                vm->enter_mutator();
+            }
+        }
+        ~MutatorGuard() {
+            if (--t_mutator_depth == 0) {
+                vm->exit_mutator();
+            }
+        }
     };
 
     //
     // ctor/dtor
     //
 
+    static std::vector<std::unique_ptr<VThread>> main_vthread_table(Gc* gc) {
+        std::vector<std::unique_ptr<VThread>> threads;
+        threads.push_back(std::make_unique<VThread>(gc, 0));
+        return threads;
+    }
+
     VirtualMachine::VirtualMachine(
         Gc* gc,
-        VirtualMachineStandardProcedureBinder binder
-    ):  m_thread(gc),
-        m_jit_compiler(*m_thread.gc_tfe())
+        VirtualMachineStandardProcedureBinder binder,
+        VmEngine engine
+    ):  m_gc(gc),
+        m_threads(main_vthread_table(gc)),
+        m_free_thread_ids(),
+        m_threads_mutex(),
+        m_jit_compiler(*m_threads[0]->gc_tfe()),
+        m_global_vals(),
+        m_engine(engine),
+        m_bytecode(m_jit_compiler.code(), engine == VmEngine::Register),
+        m_jit(m_jit_compiler.code(), &m_bytecode),
+        m_profiling(false),
+        m_heap_profile(),
+        m_alloc_site_mutex(),
+        m_scheduler(this),
+        m_running_subrs(),
+        m_continuation_count(0),
+        m_gc_mutex(),
+        m_gc_cv(),
+        m_gc_running_count(0),
+        m_gc_stopped_count(0),
+        m_gc_epoch(0)
     {
         // setting up threads using initial val-rib:
-        m_thread.init();
+        main_thread().init();
 
         // binding platform globals:
         binder(this);
     }
 
-    VirtualMachine::~VirtualMachine() {}
+    VirtualMachine::~VirtualMachine() {
+        if (m_heap_profile) {
+            m_gc->enable_heap_sampling(0, nullptr, nullptr);
+        }
+    }
 
     //
     // Blocking execution:
@@ -130,208 +441,1075 @@ namespace ss {
         for (VSubr const& f: code().subrs()) {
             sync_execute_subr<print_each_line>(f);
         }
-        assert(m_thread.regs().s == 0);
-        assert(m_thread.regs().f == 0);
-        return m_thread.regs().a;
+        assert(main_thread().regs().s == 0);
+        assert(main_thread().regs().f == 0);
+        return main_thread().regs().a;
     }
     template <bool print_each_line>
     OBJECT VirtualMachine::sync_execute_subr(VSubr const& f) {
+        TraceSpan span{"run-subr", f.name};
+        VThread* main = &main_thread();
+        prepare_subr(f);
+
+        // the subr's source objects are roots while it runs:
+        struct RunningSubrGuard {
+            std::vector<VSubr const*>& running_subrs;
+            ~RunningSubrGuard() { running_subrs.pop_back(); }
+        } running_subr_guard{m_running_subrs};
+        m_running_subrs.push_back(&f);
+
         auto line_count = f.line_code_objs.size();
         for (size_t i = 0; i < line_count; i++) {
             // acquiring input:
             OBJECT input = f.line_code_objs[i];
             VmProgram program = f.line_programs[i];
 
-            // setting start instruction:
-            m_thread.regs().x = program.s;
+            // running until 'halt':
+            main->regs().x = vthread_entry(program.s);
+            run_main_vthread(main);
 
-            // running iteratively until 'halt':
-            //  - cf `VM` function on p. 60 of `three-imp.pdf`
-            bool vm_is_running = true;
-            while (vm_is_running) {
-                VmExp const& exp = code()[m_thread.regs().x];
+            // returning pages left behind by deep recursion:
+            main->stack().trim(main->regs().s);
 
-                // DEBUG ONLY: print each instruction on execution to help trace
-                // todo: perhaps include a thread-ID? Some synchronization around IO [basically GIL]
+            // printing if desired: VThreads spawned by this subr may still run, so this must not overlap a 
+            // collection, which may move the result.
+            if (print_each_line) {
+                MutatorGuard mutator_guard{this};
+                OutputPortWriter writer{standard_output_port()};
+                writer.port().write("  > ");
+                print_obj(input, writer.port());
+                writer.port().put('\n');
+
+                writer.port().write(" => ");
+                print_obj(main->regs().a, writer.port());
+                writer.port().put('\n');
+            }
+        }
+
+        // waiting for every VThread spawned by this subr:
+        m_scheduler.help_until([this] () { return m_scheduler.live_count() == 0; });
+        return main->regs().a;
+    }
+
+    //
+    // Streaming execution:
+    //
+
+    void VirtualMachine::begin_streaming() {
+        m_global_vals.clear();
+        m_global_vals.resize(m_jit_compiler.count_globals(), OBJECT::undef);
+        m_jit_compiler.initialize_platform_globals(m_global_vals);
+
+        // the entries shared by all code are made now, in the unit they share: cf `VCode::new_unit`
+        prepare_entries();
+    }
+    template <bool print_each_line>
+    OBJECT VirtualMachine::sync_execute_subr_once(VSubr const& subr) {
+        size_t first_continuation_count = m_continuation_count.load();
+        size_t first_word_count = m_bytecode.size();
+        OBJECT res = sync_execute_subr<print_each_line>(subr);
+
+        // freeing the code compiled for the subr unless it may be entered again: i.e. if it made closures or
+        // continuations (whose frames may return into it).
+        bool is_droppable = (
+            !m_profiling &&
+            m_continuation_count.load() == first_continuation_count &&
+            subr.unit != VCODE_NO_UNIT &&
+            is_one_shot(subr.unit)
+        );
+        if (is_droppable) {
+            free_unit(subr.unit);
+        } else if (subr.unit != VCODE_NO_UNIT && code().has_unit(subr.unit)) {
+            // kept until a full collection, which is due sooner the more code is kept:
+            size_t exp_count = vmx_index(code().end_exp_id(subr.unit));
+            size_t word_count = m_bytecode.size() - std::min(first_word_count, m_bytecode.size());
+            m_gc->count_external_bytes(exp_count * sizeof(VmExp) + word_count * sizeof(VmWord));
+        }
+        return res;
+    }
+    template <bool print_each_line>
+    OBJECT VirtualMachine::stream_lines(std::vector<OBJECT> line_code_objs) {
+        GcThreadFrontEnd& gc_tfe = *main_thread().gc_tfe();
+        auto expanded_line_code_objs = macroexpand_syntax(gc_tfe, code().def_tab(), code().pproc_tab(), std::move(line_code_objs));
+        VSubr subr = m_jit_compiler.compile_subr("stream", std::move(expanded_line_code_objs));
+        grow_globals();
+
+        OBJECT res = sync_execute_subr_once<print_each_line>(subr);
+
+        // collecting between lines, since lines that never apply a closure never reach a safe-point, while most
+        // of what each line allocates (its syntax, expansion, and code) is garbage once it has run.
+        // - the result is the main VThread's accumulator, so it is kept.
+        if (m_gc->collect_requested()) {
+            MutatorGuard mutator_guard{this};
+            safepoint();
+            res = main_thread().regs().a;
+        }
+        return res;
+    }
+    int64_t VirtualMachine::fork() {
+    #ifdef _WIN32
+        return -1;
+    #else
+        assert(t_mutator_depth == 0 && m_scheduler.live_count() == 0);
+
+        // collecting first, so that each child does not copy the pages of garbage it would sweep:
+        {
+            MutatorGuard mutator_guard{this};
+            collect(true);
+        }
+        // a child only inherits the calling OS thread, so it must not wait on the others, nor flush what the
+        // parent had buffered: cf `VmScheduler::spawn`
+        m_scheduler.stop_workers();
+        flush_standard_ports();
+        return ::fork();
+    #endif
+    }
+        void VirtualMachine::grow_globals() {
+        // globals defined since the last line start as their initializers, like in `sync_execute`.
+        // - no VThread is running, so `m_global_vals` may move.
+        for (size_t i = m_global_vals.size(); i < m_jit_compiler.count_globals(); i++) {
+            m_global_vals.push_back(code().global(static_cast<GDefID>(i)).init());
+        }
+    }
+    bool VirtualMachine::is_one_shot(VCodeUnitID unit) {
+        if (!code().has_unit(unit) || code().is_pinned(unit)) {
+            return false;
+        }
+        for (VmExpID exp_id = vmx_id(unit, 0); exp_id < code().end_exp_id(unit); exp_id++) {
+            switch (code()[exp_id].kind) {
+                case VmExpKind::Close:
+                case VmExpKind::Conti: {
+                    return false;
+                }
+                default: {} break;
+            }
+        }
+        return true;
+    }
+    void VirtualMachine::free_unit(VCodeUnitID unit) {
+        code().free_unit(unit);
+        m_bytecode.free_unit(unit);
+        m_jit.free_unit(unit);
+    }
+
+    template <bool profiling>
+    bool VirtualMachine::sync_execute_graph(VThread& t) {
+        VmProfile* profile = t.profile();
+        if constexpr (profiling) {
+            profile->resume();
+        }
+
+        // running iteratively until 'halt':
+        //  - cf `VM` function on p. 60 of `three-imp.pdf`
+        for (;;) {
+            VmExp const& exp = code()[t.regs().x];
+
+            if constexpr (profiling) {
+                if (profile->count_op(exp.kind)) {
+                    profile->sample(profiled_body(t.regs().c));
+                }
+            }
+
+            // DEBUG ONLY: print each instruction on execution to help trace
+            // todo: perhaps include a thread-ID? Some synchronization around IO [basically GIL]
 #if CONFIG_PRINT_EACH_INSTRUCTION_ON_EXECUTION
-                std::cout << "\tVM <- (" << m_thread.regs().x << ") ";
-                code().print_one_exp(m_thread.regs().x, std::cout);
-                std::cout << std::endl;
+            std::cout << "\tVM <- (" << t.regs().x << ") ";
+            code().print_one_exp(t.regs().x, std::cout);
+            std::cout << std::endl;
 #endif
 
-                switch (exp.kind) {
-                    case VmExpKind::Halt: {
-                        // m_thread.regs().a now contains the return value of this computation.
-                        vm_is_running = false;
-                    } break;
-                    case VmExpKind::ReferLocal: {
-                        m_thread.regs().a = index(m_thread.regs().f, exp.args.i_refer.n);
-                        m_thread.regs().x = exp.args.i_refer.x;
-                    } break;
-                    case VmExpKind::ReferFree: {
-                        m_thread.regs().a = index_closure(m_thread.regs().c, exp.args.i_refer.n);
-                        m_thread.regs().x = exp.args.i_refer.x;
-                    } break;
-                    case VmExpKind::ReferGlobal: {
-                        m_thread.regs().a = m_global_vals[exp.args.i_refer.n];
-                        m_thread.regs().x = exp.args.i_refer.x;
-                    } break;
-                    case VmExpKind::Indirect: {
-                        m_thread.regs().a = unbox(m_thread.regs().a);
-                        m_thread.regs().x = exp.args.i_indirect.x;
-                    } break;
-                    case VmExpKind::Constant: {
-                        m_thread.regs().a = exp.args.i_constant.obj;
-                        m_thread.regs().x = exp.args.i_constant.x;
-                    } break;
-                    case VmExpKind::Close: {
-                        // instantiate a closure with bound free-var arguments,
-                        // then pop these args as though a constructor were applied.
-                        m_thread.regs().a = closure(exp.args.i_close.body, exp.args.i_close.vars_count, m_thread.regs().s);
-                        m_thread.regs().x = exp.args.i_close.x;
-                        m_thread.regs().s -= exp.args.i_close.vars_count;
-                    } break;
-                    case VmExpKind::Box: {
-                        // replaces nth argument with a box of its former contents
-                        // see three-imp p.105
-                        auto s = m_thread.regs().s;
-                        auto n = exp.args.i_box.n;
-                        index_set(s, n, box(&gc_tfe(), index(s, n)));
-                        m_thread.regs().x = exp.args.i_box.x;
-                    } break;
-                    case VmExpKind::Test: {
-                        if (m_thread.regs().a.is_boolean(false)) {
-                            m_thread.regs().x = exp.args.i_test.next_if_f;
-                        } else {
-                            m_thread.regs().x = exp.args.i_test.next_if_t;
-                        }
-                    } break;
-                    case VmExpKind::AssignLocal: {
-                        // see three-imp p.106
-                        auto f = m_thread.regs().f;
-                        auto n = exp.args.i_assign.n;
-                        set_box(index(f, n), m_thread.regs().a);
-                        m_thread.regs().x = exp.args.i_assign.x;
-                    } break;
-                    case VmExpKind::AssignFree: {
-                        auto c = m_thread.regs().c;
-                        auto n = exp.args.i_assign.n;
-                        set_box(index_closure(c, n), m_thread.regs().a);
-                        m_thread.regs().x = exp.args.i_assign.x;
-                    } break;
-                    case VmExpKind::AssignGlobal: {
-                        m_global_vals[exp.args.i_refer.n] = m_thread.regs().a;
-                        m_thread.regs().x = exp.args.i_refer.x;
-                    } break;
-                    case VmExpKind::Conti: {
-                        m_thread.regs().a = continuation(m_thread.regs().s);
-                        m_thread.regs().x = exp.args.i_conti.x;
-                    } break;
-                    case VmExpKind::Nuate: {
-                        m_thread.regs().x = exp.args.i_nuate.x;
-                        m_thread.regs().s = restore_stack(exp.args.i_nuate.stack);
-                    } break;
-                    case VmExpKind::Frame: {
-                        // pushing...
-                        // first (c, f, ret) last
-                        m_thread.regs().x = exp.args.i_frame.fn_body_x;
-                        m_thread.regs().s = 
-                            push(OBJECT::make_integer(exp.args.i_frame.post_ret_x), 
-                                push(m_thread.regs().f, 
-                                    push(m_thread.regs().c, m_thread.regs().s)));
-                    } break;
-                    case VmExpKind::Argument: {
-                        m_thread.regs().x = exp.args.i_argument.x;
-                        m_thread.regs().s = push(m_thread.regs().a, m_thread.regs().s);
-                    } break;
-                    case VmExpKind::Apply: {
-                        if (m_thread.regs().a.is_closure()) {
-                            // a Scheme function is called: actually a vector
-                            OBJECT c = m_thread.regs().a;
-#if !CONFIG_DISABLE_RUNTIME_TYPE_CHECKS
-                            assert(c.is_vector());
-#endif
-                            // DEBUG:
-                            // std::cerr 
-                            //     << "Applying: " << m_thread.regs().a << std::endl
-                            //     << "- args: " << m_thread.regs().r << std::endl
-                            //     << "- next: " << m_thread.regs().x << std::endl;
-
-                            // m_thread.regs().a = m_thread.regs().a;
-                            m_thread.regs().x = closure_body(c);
-                            m_thread.regs().f = m_thread.regs().s;
-                            m_thread.regs().c = c;
-                            // m_thread.regs().s = m_thread.regs().s;
-                        } else {
-                            std::stringstream ss;
-                            ss << "apply: expected a procedure, received: " << m_thread.regs().a;
-                            error(ss.str());
-                            throw SsiError();
+            switch (exp.kind) {
+                case VmExpKind::Halt: {
+                    // t.regs().a now contains the return value of this computation.
+                    return true;
+                }
+                case VmExpKind::ReferLocal: {
+                    t.regs().a = index(t.regs().f, exp.args.i_refer.n);
+                    t.regs().x = exp.args.i_refer.x;
+                } break;
+                case VmExpKind::ReferFree: {
+                    t.regs().a = index_closure(t.regs().c, exp.args.i_refer.n);
+                    t.regs().x = exp.args.i_refer.x;
+                } break;
+                case VmExpKind::ReferGlobal: {
+                    t.regs().a = m_global_vals[exp.args.i_refer.n];
+                    t.regs().x = exp.args.i_refer.x;
+                } break;
+                case VmExpKind::Indirect: {
+                    t.regs().a = unbox(t.regs().a);
+                    t.regs().x = exp.args.i_indirect.x;
+                } break;
+                case VmExpKind::Constant: {
+                    t.regs().a = exp.args.i_constant.obj;
+                    t.regs().x = exp.args.i_constant.x;
+                } break;
+                case VmExpKind::Close: {
+                    // instantiate a closure with bound free-var arguments,
+                    // then pop these args as though a constructor were applied.
+                    t.regs().a = closure(exp.args.i_close.body, exp.args.i_close.vars_count, t.regs().s);
+                    t.regs().x = exp.args.i_close.x;
+                    t.regs().s -= exp.args.i_close.vars_count;
+                } break;
+                case VmExpKind::Box: {
+                    // replaces nth argument with a box of its former contents
+                    // see three-imp p.105
+                    auto s = t.regs().s;
+                    auto n = exp.args.i_box.n;
+                    index_set(s, n, box(&gc_tfe(), index(s, n)));
+                    t.regs().x = exp.args.i_box.x;
+                } break;
+                case VmExpKind::Test: {
+                    if (t.regs().a.is_boolean(false)) {
+                        t.regs().x = exp.args.i_test.next_if_f;
+                    } else {
+                        t.regs().x = exp.args.i_test.next_if_t;
+                    }
+                } break;
+                case VmExpKind::AssignLocal: {
+                    // see three-imp p.106
+                    auto f = t.regs().f;
+                    auto n = exp.args.i_assign.n;
+                    set_box(index(f, n), t.regs().a);
+                    t.regs().x = exp.args.i_assign.x;
+                } break;
+                case VmExpKind::AssignFree: {
+                    auto c = t.regs().c;
+                    auto n = exp.args.i_assign.n;
+                    set_box(index_closure(c, n), t.regs().a);
+                    t.regs().x = exp.args.i_assign.x;
+                } break;
+                case VmExpKind::AssignGlobal: {
+                    m_global_vals[exp.args.i_refer.n] = t.regs().a;
+                    t.regs().x = exp.args.i_refer.x;
+                } break;
+                case VmExpKind::AssignLocalUnboxed: {
+                    index_set(t.regs().f, exp.args.i_assign.n, t.regs().a);
+                    t.regs().x = exp.args.i_assign.x;
+                } break;
+                case VmExpKind::Conti: {
+                    t.regs().a = continuation(t.regs().s - exp.args.i_conti.n);
+                    t.regs().x = exp.args.i_conti.x;
+                } break;
+                case VmExpKind::Nuate: {
+                    t.regs().x = exp.args.i_nuate.x;
+                    t.regs().s = restore_stack(index_closure(t.regs().c, 0));
+                } break;
+                case VmExpKind::Frame: {
+                    // pushing...
+                    // first (c, f, ret) last
+                    t.regs().x = exp.args.i_frame.fn_body_x;
+                    t.regs().s = 
+                        push(OBJECT::make_integer(exp.args.i_frame.post_ret_x), 
+                            push(t.regs().f, 
+                                push(t.regs().c, t.regs().s)));
+                } break;
+                case VmExpKind::Argument: {
+                    t.regs().x = exp.args.i_argument.x;
+                    t.regs().s = push(t.regs().a, t.regs().s);
+                } break;
+                case VmExpKind::Apply: do_apply: {
+                    if (m_gc->collect_requested()) {
+                        safepoint();
+                    }
+                    if (t.regs().a.is_closure()) {
+                        // a Scheme function is called
+                        OBJECT c = t.regs().a;
+                        // DEBUG:
+                        // std::cerr 
+                        //     << "Applying: " << t.regs().a << std::endl
+                        //     << "- args: " << t.regs().r << std::endl
+                        //     << "- next: " << t.regs().x << std::endl;
+
+                        // t.regs().a = t.regs().a;
+                        t.regs().x = closure_body(c);
+                        t.regs().f = t.regs().s;
+                        t.regs().c = c;
+                        if constexpr (profiling) {
+                            profile->count_call(t.regs().x);
                         }
-                    } break;
-                    case VmExpKind::Return: {
-                        auto s = m_thread.regs().s - exp.args.i_return.n;
-                        m_thread.regs().x = index(s, 0).as_integer();
-                        m_thread.regs().f = index(s, 1).as_integer();
-                        m_thread.regs().c = index(s, 2);
-                        m_thread.regs().s = s - 3;
-                    } break;
-                    case VmExpKind::Shift: {
-                        // three-imp p.112
-                        auto m = exp.args.i_shift.m;
-                        auto n = exp.args.i_shift.n;
-                        auto x = exp.args.i_shift.x;
-                        auto s = m_thread.regs().s;
-                        m_thread.regs().x = x;
-                        m_thread.regs().s = shift_args(n, m, s);
-                    } break;
-                    case VmExpKind::PInvoke: {
-                        // WARNING: 
-                        // args are pushed without a wrapping Frame for this.
-                        // This elides a 'Frame' and 'Return' instruction pair.
-
-                        auto n = exp.args.i_pinvoke.n;
-                        auto x = exp.args.i_pinvoke.x;
-                        auto p = exp.args.i_pinvoke.proc_id;
-                        
-                        ArgView args{m_thread.stack(), m_thread.regs().s, n};
-                        auto res = m_jit_compiler.code()->platform_proc_cb(p)(args);
-                        
-                        m_thread.regs().a = res;    // store retval in accum reg
-                        m_thread.regs().x = x;      // prep for next statement
-                        m_thread.regs().s -= n;     // pop arguments
-                    } break;
-                    default: {
+                        // t.regs().s = t.regs().s;
+                    } else {
                         std::stringstream ss;
-                        ss << "NotImplemented: running interpreter for instruction VmExpKind::?";
+                        ss << "apply: expected a procedure, received: " << t.regs().a;
                         error(ss.str());
                         throw SsiError();
                     }
+                } break;
+                case VmExpKind::Return: {
+                    auto s = t.regs().s - exp.args.i_return.n;
+                    t.regs().x = index(s, 0).as_integer();
+                    t.regs().f = index(s, 1).as_integer();
+                    t.regs().c = index(s, 2);
+                    t.regs().s = s - 3;
+                } break;
+                case VmExpKind::Shift: {
+                    // three-imp p.112
+                    auto m = exp.args.i_shift.m;
+                    auto n = exp.args.i_shift.n;
+                    auto x = exp.args.i_shift.x;
+                    auto s = t.regs().s;
+                    t.regs().x = x;
+                    t.regs().s = shift_args(n, m, s);
+                } break;
+                case VmExpKind::PInvoke: {
+                    // WARNING: 
+                    // args are pushed without a wrapping Frame for this.
+                    // This elides a 'Frame' and 'Return' instruction pair.
+
+                    auto n = exp.args.i_pinvoke.n;
+                    auto x = exp.args.i_pinvoke.x;
+                    auto p = exp.args.i_pinvoke.proc_id;
+                    if constexpr (profiling) {
+                        profile->count_pproc(p);
+                    }
+                    
+                    auto res = m_jit_compiler.code()->pproc_tab().call(p, t.stack(), t.regs().s, n);
+                    
+                    t.regs().a = res;    // store retval in accum reg
+                    t.regs().x = x;      // prep for next statement
+                    t.regs().s -= n;     // pop arguments
+
+                    // the procedure may ask to suspend this VThread, e.g. `yield`
+                    if (t.suspend_requested()) {
+                        return false;
+                    }
+                } break;
+                case VmExpKind::CallGlobal:
+                case VmExpKind::ShiftCallGlobal: {
+                    // a known procedure is called: the compiler checked that the global is a closure, and
+                    // knows its body.
+                    auto const& args = exp.args.i_call_global;
+                    if (exp.kind == VmExpKind::ShiftCallGlobal) {
+                        t.regs().s = shift_args(args.n, args.m, t.regs().s);
+                    }
+                    if (m_gc->collect_requested()) {
+                        safepoint();
+                    }
+                    t.regs().a = m_global_vals[args.gn];
+                    t.regs().x = args.body;
+                    t.regs().f = t.regs().s;
+                    t.regs().c = t.regs().a;
+                    if constexpr (profiling) {
+                        profile->count_call(t.regs().x);
+                    }
+                } break;
+                case VmExpKind::SelfTailCall: {
+                    // a known procedure calls itself in tail position: its arguments are overwritten in place,
+                    // and its body is entered again in the same frame, with the same closure.
+                    auto const& args = exp.args.i_call_global;
+                    t.regs().s = shift_args(args.n, args.n, t.regs().s);
+                    assert(t.regs().s == t.regs().f);
+                    if (m_gc->collect_requested()) {
+                        safepoint();
+                    }
+                    t.regs().x = args.body;
+                    if constexpr (profiling) {
+                        profile->count_call(t.regs().x);
+                    }
+                } break;
+                case VmExpKind::ReferLocalPush: {
+                    t.regs().a = index(t.regs().f, exp.args.i_refer.n);
+                    t.regs().s = push(t.regs().a, t.regs().s);
+                    t.regs().x = exp.args.i_refer.x;
+                } break;
+                case VmExpKind::ReferFreePush: {
+                    t.regs().a = index_closure(t.regs().c, exp.args.i_refer.n);
+                    t.regs().s = push(t.regs().a, t.regs().s);
+                    t.regs().x = exp.args.i_refer.x;
+                } break;
+                case VmExpKind::ReferGlobalPush: {
+                    t.regs().a = m_global_vals[exp.args.i_refer.n];
+                    t.regs().s = push(t.regs().a, t.regs().s);
+                    t.regs().x = exp.args.i_refer.x;
+                } break;
+                case VmExpKind::ConstantPush: {
+                    t.regs().a = exp.args.i_constant.obj;
+                    t.regs().s = push(t.regs().a, t.regs().s);
+                    t.regs().x = exp.args.i_constant.x;
+                } break;
+                case VmExpKind::ReferGlobalApply: {
+                    t.regs().a = m_global_vals[exp.args.i_refer.n];
+                    goto do_apply;
+                }
+                case VmExpKind::ShiftApply: {
+                    t.regs().s = shift_args(exp.args.i_shift.n, exp.args.i_shift.m, t.regs().s);
+                    goto do_apply;
                 }
+                case VmExpKind::ReferGlobalShiftApply: {
+                    auto const& args = exp.args.i_refer_global_shift;
+                    t.regs().a = m_global_vals[args.gn];
+                    t.regs().s = shift_args(args.n, args.m, t.regs().s);
+                    goto do_apply;
+                }
+                case VmExpKind::PrimAdd:
+                case VmExpKind::PrimSub:
+                case VmExpKind::PrimMul:
+                case VmExpKind::PrimDiv:
+                case VmExpKind::PrimRem:
+                case VmExpKind::PrimEq:
+                case VmExpKind::PrimLt:
+                case VmExpKind::PrimGt:
+                case VmExpKind::PrimLe:
+                case VmExpKind::PrimGe:
+                case VmExpKind::PrimCons:
+                case VmExpKind::PrimCar:
+                case VmExpKind::PrimCdr:
+                case VmExpKind::PrimIsNull:
+                case VmExpKind::PrimIsPair: {
+                    t.regs().a = prim(exp.kind, exp.args.i_prim.proc_id, t.regs().a, t.regs().s);
+                    t.regs().x = exp.args.i_prim.x;
+                } break;
+                default: {
+                    std::stringstream ss;
+                    ss << "NotImplemented: running interpreter for instruction VmExpKind::?";
+                    error(ss.str());
+                    throw SsiError();
+                }
+            }
+        }
+    }
+
+    // The bytecode engine:
+    //  - registers are held in locals and only written back to `t.regs()` on 'halt' or suspension: 
+    //    while a VThread is suspended, `t.regs().x` holds the address of the word at which it resumes.
+    //  - 'pc' points at the opcode word of the current instruction; return addresses pushed by 'Frame'
+    //    are word addresses, while closures keep the VmExpID of their body so that they remain valid 
+    //    across engines, and keep their unit from being freed.
+    //  - each handler is written once: with VM_THREADED_DISPATCH, VM_CASE is a label and VM_NEXT jumps
+    //    through the handler address stored in the opcode word; otherwise, both expand to a plain
+    //    'switch' loop.
+    //  - VM_CASE also counts the instruction when profiling (and compiles to nothing otherwise).
+    //  - instructions that may allocate publish their word and closure first, so that sampled allocations are
+    //    attributed to them: cf `sample_allocation`.
+    //  - with VM_JIT, the engine that does not profile counts self-calls on the main VThread, and compiles 
+    //    hot bodies while no other VThread runs, since that rewrites opcode words: entries into native code are
+    //    threaded to 'jit_enter', which runs it until it exits at the word of an instruction it leaves to 
+    //    the interpreter. cf `VJit`
+
+    #define VM_PROFILE_OP(kind) \
+        if constexpr (profiling) { \
+            if (profile->count_op(kind)) { \
+                profile->sample(profiled_body(c)); \
+            } \
+        }
+    #define VM_PUBLISH_ALLOC_SITE() \
+        t.publish_alloc_site(reinterpret_cast<VmExpID>(pc), c)
+    // only primitives that make pairs or flonums publish their site, which costs stores on every run:
+    #define VM_PUBLISH_PRIM_ALLOC_SITE(kind) \
+        if constexpr ((kind) == VmExpKind::PrimCons || ((kind) >= VmExpKind::PrimAdd && (kind) <= VmExpKind::PrimRem)) { \
+            VM_PUBLISH_ALLOC_SITE(); \
+        }
+#if VM_JIT
+    #define VM_JIT_COUNT_SELF_CALL(callee) \
+        if constexpr (jits) { \
+            if (counts_calls && (callee).as_raw() == c.as_raw() && m_jit.count_call(closure_body(c))) { \
+                if (m_scheduler.live_count() == 0) { \
+                    VM_SYNC_CODE(); \
+                    m_jit.compile(closure_body(c), &&lbl_jit_enter); \
+                } else { \
+                    m_jit.defer_call(closure_body(c)); \
+                } \
+            } \
+        }
+#else
+    #define VM_JIT_COUNT_SELF_CALL(callee)
+#endif
+#if VM_THREADED_DISPATCH
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wpedantic"
+    #define VM_CASE(kind) lbl_##kind: VM_PROFILE_OP(VmExpKind::kind)
+    #define VM_NEXT() goto *reinterpret_cast<void*>(*pc)
+#else
+    #define VM_CASE(kind) case VmExpKind::kind: VM_PROFILE_OP(VmExpKind::kind)
+    #define VM_NEXT() goto dispatch
+#endif
+
+    template <bool profiling>
+    bool VirtualMachine::sync_execute_bytecode(VThread& t) {
+#if VM_THREADED_DISPATCH
+        // must match the order of `VmExpKind`
+        static void* const s_labels[] = {
+            &&lbl_Halt,
+            &&lbl_ReferLocal,
+            &&lbl_ReferFree,
+            &&lbl_ReferGlobal,
+            &&lbl_Constant,
+            &&lbl_Close,
+            &&lbl_Test,
+            &&lbl_AssignLocal,
+            &&lbl_AssignFree,
+            &&lbl_AssignGlobal,
+            &&lbl_AssignLocalUnboxed,
+            &&lbl_Conti,
+            &&lbl_Nuate,
+            &&lbl_Frame,
+            &&lbl_Argument,
+            &&lbl_Apply,
+            &&lbl_Return,
+            &&lbl_Define,
+            &&lbl_Indirect,
+            &&lbl_Box,
+            &&lbl_Shift,
+            &&lbl_PInvoke,
+            &&lbl_CallGlobal,
+            &&lbl_ShiftCallGlobal,
+            &&lbl_SelfTailCall,
+            &&lbl_ReferLocalPush,
+            &&lbl_ReferFreePush,
+            &&lbl_ReferGlobalPush,
+            &&lbl_ConstantPush,
+            &&lbl_ReferGlobalApply,
+            &&lbl_ShiftApply,
+            &&lbl_ReferGlobalShiftApply,
+            &&lbl_PrimAdd,
+            &&lbl_PrimSub,
+            &&lbl_PrimMul,
+            &&lbl_PrimDiv,
+            &&lbl_PrimRem,
+            &&lbl_PrimEq,
+            &&lbl_PrimLt,
+            &&lbl_PrimGt,
+            &&lbl_PrimLe,
+            &&lbl_PrimGe,
+            &&lbl_PrimCons,
+            &&lbl_PrimCar,
+            &&lbl_PrimCdr,
+            &&lbl_PrimIsNull,
+            &&lbl_PrimIsPair,
+            &&lbl_Jump,
+            &&lbl_PrimAddRR,
+            &&lbl_PrimSubRR,
+            &&lbl_PrimMulRR,
+            &&lbl_PrimDivRR,
+            &&lbl_PrimRemRR,
+            &&lbl_PrimEqRR,
+            &&lbl_PrimLtRR,
+            &&lbl_PrimGtRR,
+            &&lbl_PrimLeRR,
+            &&lbl_PrimGeRR,
+            &&lbl_PrimConsRR,
+            &&lbl_PrimAddRK,
+            &&lbl_PrimSubRK,
+            &&lbl_PrimMulRK,
+            &&lbl_PrimDivRK,
+            &&lbl_PrimRemRK,
+            &&lbl_PrimEqRK,
+            &&lbl_PrimLtRK,
+            &&lbl_PrimGtRK,
+            &&lbl_PrimLeRK,
+            &&lbl_PrimGeRK,
+            &&lbl_PrimConsRK,
+            &&lbl_PrimCarR,
+            &&lbl_PrimCdrR,
+            &&lbl_PrimIsNullR,
+            &&lbl_PrimIsPairR,
+            &&lbl_ApplyCached,
+            &&lbl_ReferGlobalApplyCached,
+            &&lbl_ShiftApplyCached,
+            &&lbl_ReferGlobalShiftApplyCached
+        };
+        static_assert(sizeof(s_labels) / sizeof(s_labels[0]) == VMX_KIND_COUNT);
+        #define VM_SYNC_CODE() m_bytecode.thread(s_labels)
+#else
+        #define VM_SYNC_CODE() do {} while (0)
+#endif
+
+#if VM_JIT
+        // native code built ahead of time is entered on any target, but only x86-64 compiles it.
+        // register code is not compiled, since the JIT's exits may enter any VmExp it covers: cf `VBytecode`.
+        constexpr bool jits = !profiling;
+        bool const counts_calls = jits && VJit::is_supported() && !m_bytecode.uses_registers() && &t == &main_thread();
+        if constexpr (jits) {
+            // re-threading every unit (e.g. after profiling) overwrites the entries:
+            if (m_bytecode.threaded_labels() != s_labels || m_jit.has_unthreaded_entries()) {
+                VM_SYNC_CODE();
+                m_jit.thread_entries(&&lbl_jit_enter);
             }
+        }
+#endif
+        VM_SYNC_CODE();
+        VmCodePtr pc = reinterpret_cast<VmCodePtr>(t.regs().x);
 
-            // printing if desired:
-            if (print_each_line) {
-                std::cout << "  > ";
-                print_obj(input, std::cout);
-                std::cout << std::endl;
+        VmProfile* profile = t.profile();
+        if constexpr (profiling) {
+            profile->resume();
+        }
+
+        VmStack& stack = t.stack();
+        OBJECT a = t.regs().a;
+        ssize_t f = t.regs().f;
+        OBJECT c = t.regs().c;
+        ssize_t s = t.regs().s;
+        VmCodePtr known_body;               // cf 'CallGlobal'
+
+#if VM_THREADED_DISPATCH
+        VM_NEXT();
+#else
+    dispatch:
+#endif
+
+#if CONFIG_PRINT_EACH_INSTRUCTION_ON_EXECUTION
+        std::cout << "\tVM <- [" << static_cast<void const*>(pc) << "] ";
+        m_bytecode.print_one(pc, std::cout);
+        std::cout << std::endl;
+#endif
+
+#if !VM_THREADED_DISPATCH
+        switch (static_cast<VmExpKind>(*pc))
+#endif
+        {
+            VM_CASE(Halt) {
+                t.regs().a = a;
+                t.regs().f = f;
+                t.regs().c = c;
+                t.regs().s = s;
+                return true;
+            }
+            VM_CASE(ReferLocal) {
+                a = stack.index(f, pc[1]);
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(ReferFree) {
+                a = index_closure(c, pc[1]);
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(ReferGlobal) {
+                a = m_global_vals[pc[1]];
+                if constexpr (!profiling) {
+                    // globals are only assigned by their definitions, which deoptimize them, since the
+                    // compiler rejects 'set!' of a global:
+                    if (!code().global(pc[1]).is_mutated() && may_quicken(t)) {
+                        m_bytecode.quicken_global(pc, a);
+                    }
+                }
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(Indirect) {
+                a = unbox(a);
+                pc += 1;
+                VM_NEXT();
+            }
+            VM_CASE(Constant) {
+                a = std::bit_cast<OBJECT>(pc[1]);
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(Close) {
+                auto vars_count = static_cast<ssize_t>(pc[1]);
+                VM_PUBLISH_ALLOC_SITE();
+                a = closure(static_cast<VmExpID>(pc[2]), vars_count, s);
+                s -= vars_count;
+                pc += 3;
+                VM_NEXT();
+            }
+            VM_CASE(Box) {
+                auto n = static_cast<ssize_t>(pc[1]);
+                VM_PUBLISH_ALLOC_SITE();
+                stack.index_set(s, n, box(t.gc_tfe(), stack.index(s, n)));
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(Test) {
+                if (a.is_boolean(false)) {
+                    pc = reinterpret_cast<VmCodePtr>(pc[1]);
+                } else {
+                    pc += 2;
+                }
+                VM_NEXT();
+            }
+            VM_CASE(AssignLocal) {
+                set_box(stack.index(f, pc[1]), a);
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(AssignFree) {
+                set_box(index_closure(c, pc[1]), a);
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(AssignGlobal) {
+                m_global_vals[pc[1]] = a;
+                if (m_bytecode.has_quickened_global(pc[1])) {
+                    m_bytecode.deoptimize_global(pc[1]);
+                }
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(AssignLocalUnboxed) {
+                stack.index_set(f, pc[1], a);
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(Conti) {
+                VM_PUBLISH_ALLOC_SITE();
+                a = continuation(s - pc[1]);
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(Nuate) {
+                s = restore_stack(index_closure(c, 0));
+                pc += 1;
+                VM_NEXT();
+            }
+            VM_CASE(Frame) {
+                // pushing...
+                // first (c, f, ret) last
+                s = stack.push(OBJECT::make_integer(pc[1]), stack.push(OBJECT::make_integer(f), stack.push(c, s)));
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(Argument) {
+                s = stack.push(a, s);
+                pc += 1;
+                VM_NEXT();
+            }
+            VM_CASE(Apply) do_apply: {
+                if (m_gc->collect_requested()) {
+                    t.regs().a = a;
+                    t.regs().f = f;
+                    t.regs().c = c;
+                    t.regs().s = s;
+                    safepoint();
+                    // young objects may have moved:
+                    a = t.regs().a;
+                    c = t.regs().c;
+                }
+                if (a.is_closure()) {
+                    c = a;
+                    f = s;
+                    VmExpID body = closure_body(c);
+                    if constexpr (profiling) {
+                        profile->count_call(body);
+                    }
+                    VmCodePtr body_pc = m_bytecode.entry(body);
+                    if (m_bytecode.has_unthreaded_ops()) {
+                        // the body was lowered just now, e.g. a continuation.
+                        VM_SYNC_CODE();
+                    }
+                    if constexpr (!profiling) {
+                        if (*VBytecode::call_cache(pc) == VBytecode::UNCACHED_CALL && may_quicken(t)) {
+                            m_bytecode.quicken_call(pc, c, body_pc);
+                        }
+                    }
+                    pc = body_pc;
+                    VM_NEXT();
+                } else {
+                    std::stringstream ss;
+                    ss << "apply: expected a procedure, received: " << a;
+                    error(ss.str());
+                    throw SsiError();
+                }
+            }
+            VM_CASE(Return) {
+                s -= static_cast<ssize_t>(pc[1]);
+                pc = reinterpret_cast<VmCodePtr>(stack.index(s, 0).as_integer());
+                f = stack.index(s, 1).as_integer();
+                c = stack.index(s, 2);
+                s -= 3;
+                VM_NEXT();
+            }
+            VM_CASE(Shift) {
+                // three-imp p.112
+                s = shift_args(static_cast<ssize_t>(pc[1]), static_cast<ssize_t>(pc[2]), s);
+                pc += 3;
+                VM_NEXT();
+            }
+            VM_CASE(PInvoke) {
+                // WARNING: 
+                // args are pushed without a wrapping Frame for this.
+                // This elides a 'Frame' and 'Return' instruction pair.
+                auto n = static_cast<ssize_t>(pc[1]);
+                if constexpr (profiling) {
+                    profile->count_pproc(pc[2]);
+                }
+                VM_PUBLISH_ALLOC_SITE();
+                // the procedure may call back into Scheme above its args, cf `apply_nested`:
+                t.regs().s = s;
+                a = m_jit_compiler.code()->pproc_tab().call(pc[2], stack, s, n);
+                s -= n;
+                pc += 3;
 
-                std::cout << " => ";
-                print_obj(m_thread.regs().a, std::cout);
-                std::cout << std::endl;
+                // the procedure may ask to suspend this VThread, e.g. `yield`
+                if (t.suspend_requested()) {
+                    t.regs().a = a;
+                    t.regs().x = reinterpret_cast<VmExpID>(pc);
+                    t.regs().f = f;
+                    t.regs().c = c;
+                    t.regs().s = s;
+                    return false;
+                }
+                VM_NEXT();
+            }
+            VM_CASE(CallGlobal) {
+                // a known procedure is called: the compiler checked that the global is a closure, and its 
+                // body's address is an operand.
+                known_body = reinterpret_cast<VmCodePtr>(pc[2]);
+                goto do_call_known;
+            }
+            VM_CASE(ShiftCallGlobal) {
+                s = shift_args(static_cast<ssize_t>(pc[2]), static_cast<ssize_t>(pc[3]), s);
+                known_body = reinterpret_cast<VmCodePtr>(pc[4]);
+                goto do_call_known;
+            }
+            do_call_known: {
+                // before the safe-point, which may move the closure:
+                VM_JIT_COUNT_SELF_CALL(m_global_vals[pc[1]]);
+                if (m_gc->collect_requested()) {
+                    t.regs().a = a;
+                    t.regs().f = f;
+                    t.regs().c = c;
+                    t.regs().s = s;
+                    safepoint();
+                }
+                a = m_global_vals[pc[1]];
+                c = a;
+                f = s;
+                if constexpr (profiling) {
+                    profile->count_call(closure_body(c));
+                }
+                pc = known_body;
+                VM_NEXT();
+            }
+            VM_CASE(SelfTailCall) {
+                // the frame and closure are reused: cf 'CallGlobal'
+                s = shift_args(static_cast<ssize_t>(pc[1]), static_cast<ssize_t>(pc[1]), s);
+                assert(s == f);
+                if (m_gc->collect_requested()) {
+                    t.regs().a = a;
+                    t.regs().f = f;
+                    t.regs().c = c;
+                    t.regs().s = s;
+                    safepoint();
+                    // the closure may have moved:
+                    c = t.regs().c;
+                }
+                if constexpr (profiling) {
+                    profile->count_call(closure_body(c));
+                }
+                VM_JIT_COUNT_SELF_CALL(c);
+                pc = reinterpret_cast<VmCodePtr>(pc[2]);
+                VM_NEXT();
+            }
+            VM_CASE(ReferLocalPush) {
+                a = stack.index(f, pc[1]);
+                s = stack.push(a, s);
+                pc += 2;
+                VM_NEXT();
             }
+            VM_CASE(ReferFreePush) {
+                a = index_closure(c, pc[1]);
+                s = stack.push(a, s);
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(ReferGlobalPush) {
+                a = m_global_vals[pc[1]];
+                s = stack.push(a, s);
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(ConstantPush) {
+                a = std::bit_cast<OBJECT>(pc[1]);
+                s = stack.push(a, s);
+                pc += 2;
+                VM_NEXT();
+            }
+            VM_CASE(ReferGlobalApply) {
+                a = m_global_vals[pc[3]];
+                goto do_apply;
+            }
+            VM_CASE(ShiftApply) {
+                s = shift_args(static_cast<ssize_t>(pc[3]), static_cast<ssize_t>(pc[4]), s);
+                goto do_apply;
+            }
+            VM_CASE(ReferGlobalShiftApply) {
+                a = m_global_vals[pc[3]];
+                s = shift_args(static_cast<ssize_t>(pc[4]), static_cast<ssize_t>(pc[5]), s);
+                goto do_apply;
+            }
+            // cached calls: cf `VBytecode::quicken_call`
+            VM_CASE(ApplyCached) do_apply_cached: {
+                if (m_gc->collect_requested()) {
+                    t.regs().a = a;
+                    t.regs().f = f;
+                    t.regs().c = c;
+                    t.regs().s = s;
+                    // the collection deoptimizes this call, so it is applied uncached:
+                    safepoint();
+                    a = t.regs().a;
+                    c = t.regs().c;
+                    goto do_apply;
+                }
+                VmCodePtr cache = VBytecode::call_cache(pc);
+                if (a.as_raw() == cache[0]) {
+                    c = a;
+                    f = s;
+                    pc = reinterpret_cast<VmCodePtr>(cache[1]);
+                    VM_NEXT();
+                }
+                m_bytecode.uncache_call(pc);
+                goto do_apply;
+            }
+            VM_CASE(ReferGlobalApplyCached) {
+                a = m_global_vals[pc[3]];
+                goto do_apply_cached;
+            }
+            VM_CASE(ShiftApplyCached) {
+                s = shift_args(static_cast<ssize_t>(pc[3]), static_cast<ssize_t>(pc[4]), s);
+                goto do_apply_cached;
+            }
+            VM_CASE(ReferGlobalShiftApplyCached) {
+                a = m_global_vals[pc[3]];
+                s = shift_args(static_cast<ssize_t>(pc[4]), static_cast<ssize_t>(pc[5]), s);
+                goto do_apply_cached;
+            }
+            #define VM_PRIM_BINARY_CASE(kind) \
+                VM_CASE(kind) { \
+                    VM_PUBLISH_PRIM_ALLOC_SITE(VmExpKind::kind); \
+                    a = prim_binary<VmExpKind::kind>(pc[1], a, stack.index(s, 0), s); \
+                    s -= 1; \
+                    pc += 2; \
+                    VM_NEXT(); \
+                }
+            #define VM_PRIM_UNARY_CASE(kind) \
+                VM_CASE(kind) { \
+                    a = prim_unary<VmExpKind::kind>(pc[1], a, s); \
+                    pc += 2; \
+                    VM_NEXT(); \
+                }
+            VM_PRIM_BINARY_CASE(PrimAdd)
+            VM_PRIM_BINARY_CASE(PrimSub)
+            VM_PRIM_BINARY_CASE(PrimMul)
+            VM_PRIM_BINARY_CASE(PrimDiv)
+            VM_PRIM_BINARY_CASE(PrimRem)
+            VM_PRIM_BINARY_CASE(PrimEq)
+            VM_PRIM_BINARY_CASE(PrimLt)
+            VM_PRIM_BINARY_CASE(PrimGt)
+            VM_PRIM_BINARY_CASE(PrimLe)
+            VM_PRIM_BINARY_CASE(PrimGe)
+            VM_PRIM_BINARY_CASE(PrimCons)
+            VM_PRIM_UNARY_CASE(PrimCar)
+            VM_PRIM_UNARY_CASE(PrimCdr)
+            VM_PRIM_UNARY_CASE(PrimIsNull)
+            VM_PRIM_UNARY_CASE(PrimIsPair)
+            #undef VM_PRIM_BINARY_CASE
+            #undef VM_PRIM_UNARY_CASE
+            // register instructions: cf `VBytecode::lower_register_op`
+            #define VM_PRIM_RR_CASE(kind) \
+                VM_CASE(kind##RR) { \
+                    VM_PUBLISH_PRIM_ALLOC_SITE(VmExpKind::kind); \
+                    a = prim_binary<VmExpKind::kind, false>(pc[1], stack.index(f, pc[2]), stack.index(f, pc[3]), s); \
+                    pc += 4; \
+                    VM_NEXT(); \
+                }
+            #define VM_PRIM_RK_CASE(kind) \
+                VM_CASE(kind##RK) { \
+                    VM_PUBLISH_PRIM_ALLOC_SITE(VmExpKind::kind); \
+                    a = prim_binary<VmExpKind::kind, false>(pc[1], stack.index(f, pc[2]), std::bit_cast<OBJECT>(pc[3]), s); \
+                    pc += 4; \
+                    VM_NEXT(); \
+                }
+            #define VM_PRIM_R_CASE(kind) \
+                VM_CASE(kind##R) { \
+                    a = prim_unary<VmExpKind::kind>(pc[1], stack.index(f, pc[2]), s); \
+                    pc += 3; \
+                    VM_NEXT(); \
+                }
+            VM_PRIM_RR_CASE(PrimAdd)
+            VM_PRIM_RR_CASE(PrimSub)
+            VM_PRIM_RR_CASE(PrimMul)
+            VM_PRIM_RR_CASE(PrimDiv)
+            VM_PRIM_RR_CASE(PrimRem)
+            VM_PRIM_RR_CASE(PrimEq)
+            VM_PRIM_RR_CASE(PrimLt)
+            VM_PRIM_RR_CASE(PrimGt)
+            VM_PRIM_RR_CASE(PrimLe)
+            VM_PRIM_RR_CASE(PrimGe)
+            VM_PRIM_RR_CASE(PrimCons)
+            VM_PRIM_RK_CASE(PrimAdd)
+            VM_PRIM_RK_CASE(PrimSub)
+            VM_PRIM_RK_CASE(PrimMul)
+            VM_PRIM_RK_CASE(PrimDiv)
+            VM_PRIM_RK_CASE(PrimRem)
+            VM_PRIM_RK_CASE(PrimEq)
+            VM_PRIM_RK_CASE(PrimLt)
+            VM_PRIM_RK_CASE(PrimGt)
+            VM_PRIM_RK_CASE(PrimLe)
+            VM_PRIM_RK_CASE(PrimGe)
+            VM_PRIM_RK_CASE(PrimCons)
+            VM_PRIM_R_CASE(PrimCar)
+            VM_PRIM_R_CASE(PrimCdr)
+            VM_PRIM_R_CASE(PrimIsNull)
+            VM_PRIM_R_CASE(PrimIsPair)
+            #undef VM_PRIM_RR_CASE
+            #undef VM_PRIM_RK_CASE
+            #undef VM_PRIM_R_CASE
+            VM_CASE(Jump) {
+                pc = reinterpret_cast<VmCodePtr>(pc[1]);
+                VM_NEXT();
+            }
+            VM_CASE(Define) {
+                std::stringstream ss;
+                ss << "NotImplemented: running bytecode for instruction " << vmx_kind_name(VmExpKind::Define);
+                error(ss.str());
+                throw SsiError();
+            }
+#if VM_JIT
+            // 'unused' in the profiling engine, which never threads entries:
+            lbl_jit_enter: __attribute__((unused)); {
+                JitEntry const* entry = m_jit.find_entry(pc);
+                assert(entry && "jit_enter: no entry at this word");
+                JitFrame frame{
+                    a, f, c, s,
+                    stack.data(), stack.captured_height(), static_cast<ssize_t>(stack.committed_count()),
+                    m_global_vals.data(),
+                    m_gc->minor_collect_requested_flag(), m_gc->sweep_requested_flag()
+                };
+                VmCodePtr exit_pc = entry->code(&frame);
+                a = frame.a;
+                f = frame.f;
+                c = frame.c;
+                s = frame.s;
+                if (exit_pc == pc) {
+                    // the entry's own instruction exits, e.g. its fast path failed: it runs its handler.
+                    goto *s_labels[static_cast<size_t>(entry->kind)];
+                }
+                pc = exit_pc;
+                VM_NEXT();
+            }
+#endif
         }
-        return m_thread.regs().a;
+#if !VM_THREADED_DISPATCH
+        // every instruction above returns or dispatches the next, so only an unknown kind falls through:
+        std::stringstream ss;
+        ss << "NotImplemented: running bytecode for instruction VmExpKind::" << static_cast<int>(*pc);
+        error(ss.str());
+        throw SsiError();
+#endif
+        #undef VM_SYNC_CODE
     }
 
+    #undef VM_CASE
+    #undef VM_NEXT
+    #undef VM_PROFILE_OP
+    #undef VM_JIT_COUNT_SELF_CALL
+    #undef VM_PUBLISH_ALLOC_SITE
+    #undef VM_PUBLISH_PRIM_ALLOC_SITE
+#if VM_THREADED_DISPATCH
+    #pragma GCC diagnostic pop
+#endif
+
     OBJECT VirtualMachine::closure(VmExpID body, ssize_t n, ssize_t s) {
-        std::vector<OBJECT> items;
-        items.resize(1 + n);
-        items[0] = OBJECT::make_integer(body);
+        VThread& t = thread();
+        OBJECT c = OBJECT::make_closure(t.gc_tfe(), body, n);
+        OBJECT* free_vars = c.as_closure_p()->free_vars();
         for (ssize_t i = 0; i < n; i++) {
-            items[1+i] = index(s, i);
+            free_vars[i] = t.stack().index(s, i);
         }
-        return OBJECT::make_ptr(new(&gc_tfe(), VectorObject::sci) VectorObject(std::move(items)));
+        return c;
     }
 
     ssize_t VirtualMachine::find_link(ssize_t n, ssize_t e) {
@@ -343,91 +1521,1298 @@ namespace ss {
 
     OBJECT VirtualMachine::continuation(ssize_t s) {
         // cf p.86 of three-imp
-        return closure(
-            code().new_vmx_refer_local(
-                0,
-                code().new_vmx_nuate(save_stack(s), code().new_vmx_return(0))
-            ),
-            0,
-            s   // -> FIXME: guess, check if this is right, could be a source of bugs
-        );
-        throw SsiError();
+        // All continuations share one body: only the captured stack, free variable 0, differs.
+        // - those of the main VThread may return into the code of each running subr, whose units are free
+        //   variables 1.., so that a collection keeps them: cf `mark_closure_code`.
+        std::vector<VCodeUnitID> units;
+        if (&thread() == &main_thread()) {
+            for (VSubr const* subr: m_running_subrs) {
+                if (subr->unit != VCODE_NO_UNIT) {
+                    units.push_back(subr->unit);
+                }
+            }
+        }
+        OBJECT k = OBJECT::make_closure(&gc_tfe(), code().nuate_entry(), 1 + units.size());
+        OBJECT* free_vars = k.as_closure_p()->free_vars();
+        for (size_t i = 0; i < units.size(); i++) {
+            free_vars[1 + i] = OBJECT::make_integer(static_cast<int64_t>(units[i]));
+        }
+        free_vars[0] = save_stack(s);
+        m_continuation_count.fetch_add(1, std::memory_order_relaxed);
+        return k;
     }
     OBJECT VirtualMachine::save_stack(ssize_t s) {
-        std::vector<OBJECT> vs{m_thread.stack().begin(), m_thread.stack().begin() + s};
-        return OBJECT::make_ptr(new(&gc_tfe(), VectorObject::sci) VectorObject(std::move(vs)));
+        VmStack& stack = thread().stack();
+
+        // reusing the segments of the last capture/restore that are still intact:
+        OBJECT segments = stack.captured();
+        ssize_t intact_height = std::min(stack.captured_height(), s);
+        while (!segments.is_null() && static_cast<ssize_t>(segments.as_stack_segment_p()->end()) > intact_height) {
+            segments = segments.as_stack_segment_p()->below();
+        }
+
+        // copying the remainder:
+        ssize_t base = segments.is_null() ? 0 : segments.as_stack_segment_p()->end();
+        while (base < s) {
+            ssize_t end = std::min(s, (base / VM_STACK_SEGMENT_CAPACITY + 1) * VM_STACK_SEGMENT_CAPACITY);
+            segments = OBJECT::make_stack_segment(&gc_tfe(), segments, base, end - base, stack.data() + base);
+            base = end;
+        }
+
+        stack.set_captured(segments, s);
+        return segments;
     }
-    ssize_t VirtualMachine::restore_stack(OBJECT vector) {
-        assert(vector.is_vector() && "Expected stack to restore to be a 'vector' object");
-        std::vector<OBJECT>& cpp_vector = dynamic_cast<VectorObject*>(vector.as_ptr())->as_cpp_vec();
-        assert(cpp_vector.size() <= m_thread.stack().capacity() && "Cannot restore a stack larger than VM stack's capacity.");
-        std::copy(cpp_vector.begin(), cpp_vector.end(), m_thread.stack().begin());
-        return cpp_vector.size();
+    ssize_t VirtualMachine::restore_stack(OBJECT segments) {
+        assert((segments.is_null() || segments.kind() == ObjectKind::StackSegment) && "Expected stack to restore to be a chain of segments");
+        VmStack& stack = thread().stack();
+        ssize_t height = segments.is_null() ? 0 : segments.as_stack_segment_p()->end();
+        assert(static_cast<size_t>(height) <= stack.capacity() && "Cannot restore a stack larger than VM stack's capacity.");
+        stack.commit(height);
+
+        // segments shared with the intact part of the stack need not be copied back:
+        // since chains share their lower segments, we stop at the first shared one.
+        OBJECT intact = stack.captured();
+        while (!intact.is_null() && static_cast<ssize_t>(intact.as_stack_segment_p()->end()) > stack.captured_height()) {
+            intact = intact.as_stack_segment_p()->below();
+        }
+        for (OBJECT it = segments; !it.is_null(); it = it.as_stack_segment_p()->below()) {
+            StackSegmentObject* segment = it.as_stack_segment_p();
+            while (!intact.is_null() && intact.as_stack_segment_p()->end() > segment->end()) {
+                intact = intact.as_stack_segment_p()->below();
+            }
+            if (is_eq(intact, it)) {
+                break;
+            }
+            std::copy(segment->items(), segment->items() + segment->count(), stack.data() + segment->base());
+        }
+
+        stack.set_captured(segments, height);
+        return height;
     }
 
     VmExpID VirtualMachine::closure_body(OBJECT c) {
-        return c.as_vector_p()->operator[](0).as_integer();
+        return c.as_closure_p()->body();
     }
     OBJECT VirtualMachine::index_closure(OBJECT c, ssize_t n) {
-        return c.as_vector_p()->operator[](1 + n);
+        return c.as_closure_p()->free_vars()[n];
     }
 
     ssize_t VirtualMachine::shift_args(ssize_t n, ssize_t m, ssize_t s) {
         // see three-imp p.111
-        ssize_t i = n - 1;
-        while (i >= 0) {
-            index_set(s, i + m, index(s, i));
-            --i;
-        }
-        return s - m;
+        return thread().stack().shift(s, n, m);
     }
 
     //
-    //
-    // Interface:
-    //
+    // Primitives:
     //
 
-    VirtualMachine* create_vm(
-        Gc* gc,
-        VirtualMachineStandardProcedureBinder binder
-    ) {
-        auto vm = new VirtualMachine(gc, binder); 
-        return vm;
-    }
-    void destroy_vm(VirtualMachine* vm) {
-        delete vm;
-    }
-    GcThreadFrontEnd* vm_gc_tfe(VirtualMachine* vm) {
-        return &vm->gc_tfe();
+    template <VmExpKind prim_kind, bool is_rt_pushed>
+    inline OBJECT VirtualMachine::prim_binary(size_t proc_id, OBJECT lt, OBJECT rt, ssize_t s) {
+        if constexpr (prim_kind == VmExpKind::PrimCons) {
+            SUPPRESS_UNUSED_VARIABLE_WARNING(proc_id);
+            SUPPRESS_UNUSED_VARIABLE_WARNING(s);
+            return cons(&gc_tfe(), lt, rt);
+        } else {
+            if (lt.is_integer() && rt.is_integer()) {
+                ssize_t l = lt.as_integer();
+                ssize_t r = rt.as_integer();
+                if constexpr (prim_kind == VmExpKind::PrimAdd) { return OBJECT::make_integer(l + r); }
+                if constexpr (prim_kind == VmExpKind::PrimSub) { return OBJECT::make_integer(l - r); }
+                if constexpr (prim_kind == VmExpKind::PrimMul) { return OBJECT::make_integer(l * r); }
+                if constexpr (prim_kind == VmExpKind::PrimDiv) { if (r != 0) { return OBJECT::make_integer(l / r); } }
+                if constexpr (prim_kind == VmExpKind::PrimRem) { if (r != 0) { return OBJECT::make_integer(l % r); } }
+                if constexpr (prim_kind == VmExpKind::PrimEq) { return boolean(l == r); }
+                if constexpr (prim_kind == VmExpKind::PrimLt) { return boolean(l < r); }
+                if constexpr (prim_kind == VmExpKind::PrimGt) { return boolean(l > r); }
+                if constexpr (prim_kind == VmExpKind::PrimLe) { return boolean(l <= r); }
+                if constexpr (prim_kind == VmExpKind::PrimGe) { return boolean(l >= r); }
+            } else if ((lt.is_float64() || rt.is_float64()) && is_number(lt) && is_number(rt)) {
+                // cf `bind_standard_arithmetic_procedure`: flonum results are immediate if they can be.
+                double l = lt.to_double();
+                double r = rt.to_double();
+                if constexpr (prim_kind == VmExpKind::PrimAdd) { return OBJECT::make_float64(&gc_tfe(), l + r); }
+                if constexpr (prim_kind == VmExpKind::PrimSub) { return OBJECT::make_float64(&gc_tfe(), l - r); }
+                if constexpr (prim_kind == VmExpKind::PrimMul) { return OBJECT::make_float64(&gc_tfe(), l * r); }
+                if constexpr (prim_kind == VmExpKind::PrimDiv) { return OBJECT::make_float64(&gc_tfe(), l / r); }
+                if constexpr (prim_kind == VmExpKind::PrimRem) { return OBJECT::make_float64(&gc_tfe(), std::fmod(l, r)); }
+                if constexpr (prim_kind == VmExpKind::PrimEq) { return boolean(l == r); }
+                if constexpr (prim_kind == VmExpKind::PrimLt) { return boolean(l < r); }
+                if constexpr (prim_kind == VmExpKind::PrimGt) { return boolean(l > r); }
+                if constexpr (prim_kind == VmExpKind::PrimLe) { return boolean(l <= r); }
+                if constexpr (prim_kind == VmExpKind::PrimGe) { return boolean(l >= r); }
+            }
+            return prim_fallback(proc_id, lt, is_rt_pushed ? s : push(rt, s), 2);
+        }
     }
-    OBJECT sync_execute_vm(VirtualMachine* vm, bool print_each_line) {
-        if (print_each_line) {
-            return vm->sync_execute<true>();
+    template <VmExpKind prim_kind>
+    inline OBJECT VirtualMachine::prim_unary(size_t proc_id, OBJECT arg, ssize_t s) {
+        if constexpr (prim_kind == VmExpKind::PrimIsNull) {
+            SUPPRESS_UNUSED_VARIABLE_WARNING(proc_id);
+            SUPPRESS_UNUSED_VARIABLE_WARNING(s);
+            return boolean(arg.is_null());
+        } else if constexpr (prim_kind == VmExpKind::PrimIsPair) {
+            SUPPRESS_UNUSED_VARIABLE_WARNING(proc_id);
+            SUPPRESS_UNUSED_VARIABLE_WARNING(s);
+            return boolean(arg.is_pair());
         } else {
-            return vm->sync_execute<false>();
+            if (arg.is_pair()) {
+                if constexpr (prim_kind == VmExpKind::PrimCar) { return arg.as_pair_p()->car(); }
+                if constexpr (prim_kind == VmExpKind::PrimCdr) { return arg.as_pair_p()->cdr(); }
+            }
+            return prim_fallback(proc_id, arg, s, 1);
+        }
+    }
+    OBJECT VirtualMachine::prim(VmExpKind prim_kind, size_t proc_id, OBJECT a, ssize_t& s) {
+        // pops the second argument of binary primitives only after the fallback (if any) has run.
+        bool is_binary = (vmx_prim_arity(prim_kind) == 2);
+        OBJECT rt = (is_binary ? index(s, 0) : OBJECT::null);
+        OBJECT res;
+        switch (prim_kind) {
+            case VmExpKind::PrimAdd: res = prim_binary<VmExpKind::PrimAdd>(proc_id, a, rt, s); break;
+            case VmExpKind::PrimSub: res = prim_binary<VmExpKind::PrimSub>(proc_id, a, rt, s); break;
+            case VmExpKind::PrimMul: res = prim_binary<VmExpKind::PrimMul>(proc_id, a, rt, s); break;
+            case VmExpKind::PrimDiv: res = prim_binary<VmExpKind::PrimDiv>(proc_id, a, rt, s); break;
+            case VmExpKind::PrimRem: res = prim_binary<VmExpKind::PrimRem>(proc_id, a, rt, s); break;
+            case VmExpKind::PrimEq: res = prim_binary<VmExpKind::PrimEq>(proc_id, a, rt, s); break;
+            case VmExpKind::PrimLt: res = prim_binary<VmExpKind::PrimLt>(proc_id, a, rt, s); break;
+            case VmExpKind::PrimGt: res = prim_binary<VmExpKind::PrimGt>(proc_id, a, rt, s); break;
+            case VmExpKind::PrimLe: res = prim_binary<VmExpKind::PrimLe>(proc_id, a, rt, s); break;
+            case VmExpKind::PrimGe: res = prim_binary<VmExpKind::PrimGe>(proc_id, a, rt, s); break;
+            case VmExpKind::PrimCons: res = prim_binary<VmExpKind::PrimCons>(proc_id, a, rt, s); break;
+            case VmExpKind::PrimCar: res = prim_unary<VmExpKind::PrimCar>(proc_id, a, s); break;
+            case VmExpKind::PrimCdr: res = prim_unary<VmExpKind::PrimCdr>(proc_id, a, s); break;
+            case VmExpKind::PrimIsNull: res = prim_unary<VmExpKind::PrimIsNull>(proc_id, a, s); break;
+            case VmExpKind::PrimIsPair: res = prim_unary<VmExpKind::PrimIsPair>(proc_id, a, s); break;
+            default: {
+                std::stringstream ss;
+                ss << "Expected a primitive, received: " << vmx_kind_name(prim_kind);
+                error(ss.str());
+                throw SsiError();
+            }
+        }
+        if (is_binary) {
+            s -= 1;
+        }
+        return res;
+    }
+    OBJECT VirtualMachine::prim_fallback(size_t proc_id, OBJECT first_arg, ssize_t s, ssize_t arg_count) {
+        // the first argument is pushed atop the remaining args (if any), as 'p/invoke' would.
+        ssize_t top = push(first_arg, s);
+        return code().pproc_tab().call(proc_id, thread().stack(), top, arg_count);
+    }
+
+    //
+    // VThreads:
+    //
+
+    void VirtualMachine::prepare_entries() {
+        VmExpID nuate_entry = code().nuate_entry();
+        VmExpID spawn_entry = code().spawn_entry();
+        VmExpID call_entry = code().call_entry();
+        VmExpID halt_entry = code().halt_entry();
+        if (runs_bytecode()) {
+            m_bytecode.entry(nuate_entry);
+            m_bytecode.entry(spawn_entry);
+            m_bytecode.entry(call_entry);
+            m_bytecode.entry(halt_entry);
+        }
+    }
+    void VirtualMachine::prepare_subr(VSubr const& subr) {
+        // lowering everything the subr may enter ahead of time: spawned VThreads only read code.
+        prepare_entries();
+        if (runs_bytecode()) {
+            for (VmProgram const& program: subr.line_programs) {
+                m_bytecode.entry(program.s);
+            }
+        }
+    }
+    VmExpID VirtualMachine::vthread_entry(VmExpID exp_id) {
+        // cf `sync_execute_bytecode`: suspended VThreads hold the address of a word instead.
+        if (runs_bytecode()) {
+            return reinterpret_cast<VmExpID>(m_bytecode.entry(exp_id));
+        } else {
+            return exp_id;
+        }
+    }
+    bool VirtualMachine::run_vthread(VThread* t) {
+        // NOTE: this may nest, e.g. when a platform procedure runs a subr.
+        struct RunningGuard {
+            VirtualMachine* vm;
+            VThread* vthread;
+            ~RunningGuard() { t_running_vm = vm; t_running_vthread = vthread; }
+        } guard{t_running_vm, t_running_vthread};
+        MutatorGuard mutator_guard{this};
+        t_running_vm = this;
+        t_running_vthread = t;
+
+        // young objects are only allocated while an engine runs, cf `GcThreadFrontEnd`:
+        struct NurseryGuard {
+            GcThreadFrontEnd* gc_tfe;
+            bool was_open;
+            ~NurseryGuard() { gc_tfe->set_nursery_open(was_open); }
+        } nursery_guard{t->gc_tfe(), t->gc_tfe()->set_nursery_open(true)};
+
+        if (m_profiling) {
+            switch (m_engine) {
+                case VmEngine::Graph: return sync_execute_graph<true>(*t);
+                case VmEngine::Bytecode:
+                case VmEngine::Register: return sync_execute_bytecode<true>(*t);
+            }
+        } else {
+            switch (m_engine) {
+                case VmEngine::Graph: return sync_execute_graph<false>(*t);
+                case VmEngine::Bytecode:
+                case VmEngine::Register: return sync_execute_bytecode<false>(*t);
+            }
+        }
+        return true;
+    }
+    void VirtualMachine::run_main_vthread(VThread* t) {
+        while (!run_vthread(t)) {
+            switch (t->suspend()) {
+                case VThreadSuspend::Yield: {
+                    t->clear_suspend();
+                    m_scheduler.help_once();
+                } break;
+                case VThreadSuspend::Join: {
+                    VThreadID target_id = t->suspend_arg();
+                    if (!try_join(t)) {
+                        m_scheduler.help_until([t] () { return t->state() != VThreadState::Blocked; });
+                    }
+                    if (t->failed()) {
+                        t->set_failed(false);
+                        std::stringstream ss;
+                        ss << "join: VThread " << target_id << " failed";
+                        error(ss.str());
+                        throw SsiError();
+                    }
+                } break;
+                case VThreadSuspend::Send:
+                case VThreadSuspend::Receive: {
+                    bool is_send = (t->suspend() == VThreadSuspend::Send);
+                    if (!try_channel_op(t)) {
+                        // once no other VThread is live, none may ever complete this:
+                        m_scheduler.help_until([this, t] () { 
+                            return t->state() != VThreadState::Blocked || m_scheduler.live_count() == 0; 
+                        });
+                        if (t->state() == VThreadState::Blocked) {
+                            cancel_channel_op(t);
+                            error(is_send ?
+                                "channel-send: the channel is full, and no other VThread is live to receive from it" :
+                                "channel-receive: the channel is empty, and no other VThread is live to send to it"
+                            );
+                            throw SsiError();
+                        }
+                    }
+                } break;
+                case VThreadSuspend::None: {
+                    assert(0 && "VThread suspended without a request");
+                } break;
+            }
+        }
+    }
+    void VirtualMachine::run_spawned_vthread(VThread* t) {
+        for (;;) {
+            bool halted = true;
+            if (!t->failed()) {
+                try {
+                    halted = run_vthread(t);
+                    // a bulk task's VThread halts after each call until its chunk is done: cf `step_bulk_task`
+                    while (halted && t->bulk_task() && step_bulk_task(t)) {
+                        halted = t->suspend_requested() ? false : run_vthread(t);
+                    }
+                } catch (SsiError const&) {
+                    // the error has been reported: joiners fail in turn.
+                    t->set_failed();
+                }
+            }
+            if (halted) {
+                m_scheduler.finish(t);
+                return;
+            }
+            switch (t->suspend()) {
+                case VThreadSuspend::Yield: {
+                    t->clear_suspend();
+                    m_scheduler.enqueue(t, true);
+                    return;
+                }
+                case VThreadSuspend::Join: {
+                    if (!try_join(t)) {
+                        // resumed by `VmScheduler::finish`
+                        return;
+                    }
+                } break;
+                case VThreadSuspend::Send:
+                case VThreadSuspend::Receive: {
+                    if (!try_channel_op(t)) {
+                        // resumed by `wake_channel_receiver` or `wake_channel_senders`
+                        return;
+                    }
+                } break;
+                case VThreadSuspend::None: {
+                    assert(0 && "VThread suspended without a request");
+                } break;
+            }
+        }
+    }
+    OBJECT VirtualMachine::spawn_vthread(OBJECT thunk) {
+        if (!thunk.is_closure()) {
+            std::stringstream ss;
+            ss << "spawn: expected a procedure, received: " << thunk;
+            error(ss.str());
+            throw SsiError();
+        }
+        VThread* t = new_vthread();
+        t->regs().a = thunk;
+        t->regs().x = vthread_entry(code().spawn_entry());
+        m_scheduler.spawn(t);
+        return OBJECT::make_integer(t->id());
+    }
+    VThread* VirtualMachine::new_vthread() {
+        if (m_scheduler.live_count() == 0) {
+            // the spawned VThread reads code concurrently: cf `may_quicken`
+            m_bytecode.deoptimize_all();
+        }
+        VThread* t = nullptr; {
+            std::lock_guard lg{m_threads_mutex};
+            if (m_free_thread_ids.empty()) {
+                VThreadID id = static_cast<VThreadID>(m_threads.size());
+                m_threads.push_back(std::make_unique<VThread>(m_gc, id));
+                t = m_threads.back().get();
+            } else {
+                t = m_threads[m_free_thread_ids.back()].get();
+                m_free_thread_ids.pop_back();
+            }
+        }
+        if (t->state() == VThreadState::Free) {
+            // a late join may still lock it, cf `try_join`:
+            std::lock_guard lg{t->mutex()};
+            t->reuse(m_gc);
+        }
+        t->init();
+        if (m_profiling) {
+            t->enable_profile();
+        }
+        return t;
+    }
+    VThread* VirtualMachine::find_vthread(VThreadID id) {
+        std::lock_guard lg{m_threads_mutex};
+        if (id < 0 || id >= static_cast<VThreadID>(m_threads.size()) || m_threads[id]->state() == VThreadState::Free) {
+            return nullptr;
+        }
+        return m_threads[id].get();
+    }
+    size_t VirtualMachine::count_vthreads() {
+        std::lock_guard lg{m_threads_mutex};
+        return m_threads.size();
+    }
+    void VirtualMachine::set_worker_count(size_t worker_count) {
+        assert(t_mutator_depth == 0);
+        m_scheduler.set_worker_count(worker_count);
+    }
+    bool VirtualMachine::try_join(VThread* t) {
+        // `t` is suspended, so the target may wake it as soon as it is registered as a joiner.
+        // - the target may have been joined by another since `vm_join_vthread` found it: then this join fails.
+        VThread* target = find_vthread(t->suspend_arg());
+        t->clear_suspend();
+        if (target == nullptr) {
+            t->set_failed();
+            return true;
+        }
+        std::lock_guard lg{target->mutex()};
+        if (target->state() == VThreadState::Free) {
+            t->set_failed();
+            return true;
+        } else if (target->state() == VThreadState::Done) {
+            // not overlapping a collection, which may move the result:
+            MutatorGuard mutator_guard{this};
+            take_join_result(t, target);
+            reclaim_vthread(target);
+            return true;
+        } else {
+            t->set_state(VThreadState::Blocked);
+            target->joiners().push_back(t);
+            return false;
+        }
+    }
+    void VirtualMachine::take_join_result(VThread* joiner, VThread* target) {
+        joiner->regs().a = target->regs().a;
+        if (target->failed()) {
+            joiner->set_failed();
+        }
+    }
+    void VirtualMachine::reclaim_vthread(VThread* t) {
+        t->recycle();
+        std::lock_guard lg{m_threads_mutex};
+        m_free_thread_ids.push_back(t->id());
+    }
+    void VirtualMachine::resume(VThread* t) {
+        t->set_state(VThreadState::Runnable);
+        if (t == &main_thread()) {
+            m_scheduler.notify();
+        } else {
+            m_scheduler.enqueue(t);
+        }
+    }
+
+    //
+    // Bulk operations:
+    //
+
+    OBJECT VirtualMachine::spawn_bulk(char const* proc_name, VmBulkKind kind, OBJECT proc, OBJECT items, OBJECT result, ssize_t begin, ssize_t end) {
+        if (!proc.is_closure()) {
+            std::stringstream ss;
+            ss << proc_name << ": expected a procedure, received: " << proc;
+            error(ss.str());
+            throw SsiError();
+        }
+        if (begin >= end) {
+            return result;
+        }
+
+        // chunks are large enough to amortize making their VThreads, and numerous enough that idle workers
+        // may steal some while others run long calls:
+        size_t count = static_cast<size_t>(end - begin);
+        size_t max_chunk_count = m_scheduler.worker_count() * VmBulkTask::CHUNKS_PER_WORKER;
+        size_t chunk_count = std::clamp(count / VmBulkTask::MIN_CHUNK_SIZE, size_t{1}, max_chunk_count);
+        size_t chunk_size = (count + chunk_count - 1) / chunk_count;
+        chunk_count = (count + chunk_size - 1) / chunk_size;
+
+        // every chunk's VThread is made before any is spawned, so that each knows its children: chunk `k`
+        // joins `k + 1`, `k + 2`, `k + 4`, ... while `k` is a multiple of twice the stride.
+        std::vector<VThread*> chunks;
+        for (size_t k = 0; k < chunk_count; k++) {
+            chunks.push_back(new_vthread());
+        }
+        for (size_t k = 0; k < chunk_count; k++) {
+            VmBulkTask task{
+                kind, VmBulkTask::Step::Start,
+                begin + static_cast<ssize_t>(k * chunk_size), 
+                std::min(begin + static_cast<ssize_t>((k + 1) * chunk_size), end),
+                {}, 0
+            };
+            for (size_t stride = 1; stride < chunk_count && k % (2 * stride) == 0; stride *= 2) {
+                if (k + stride < chunk_count) {
+                    task.children.push_back(chunks[k + stride]->id());
+                }
+            }
+            VThread* t = chunks[k];
+            t->set_bulk_task(std::move(task));
+            VmStack& stack = t->stack();
+            t->regs().s = stack.push(result, stack.push(items, stack.push(proc, 0)));
+            t->regs().x = vthread_entry(code().halt_entry());
+        }
+        for (VThread* t: chunks) {
+            m_scheduler.spawn(t);
+        }
+        thread().request_suspend(VThreadSuspend::Join, chunks[0]->id());
+        return OBJECT::null;
+    }
+    bool VirtualMachine::step_bulk_task(VThread* t) {
+        // not overlapping a collection, which may move the objects at the base of the stack:
+        MutatorGuard mutator_guard{this};
+        VmBulkTask& task = *t->bulk_task();
+        VmStack& stack = t->stack();
+        auto base_slot = [&stack] (ssize_t slot) { return stack.index(slot + 1, 0); };
+        auto set_base_slot = [&stack] (ssize_t slot, OBJECT v) { stack.index_set(slot + 1, 0, v); };
+
+        // the result of the last run:
+        OBJECT res = t->regs().a;
+        switch (task.step) {
+            case VmBulkTask::Step::Start: {
+            } break;
+            case VmBulkTask::Step::Call: {
+                if (task.kind == VmBulkKind::Map) {
+                    base_slot(VmBulkTask::RESULT_SLOT).as_vector_p()->set(task.next - 1, res);
+                } else if (task.kind == VmBulkKind::Fold) {
+                    set_base_slot(VmBulkTask::RESULT_SLOT, res);
+                }
+            } break;
+            case VmBulkTask::Step::Join: {
+                // maps and for-eaches only wait for their children:
+                if (task.kind == VmBulkKind::Fold) {
+                    task.step = VmBulkTask::Step::Combine;
+                    prepare_bulk_call(t, {base_slot(VmBulkTask::RESULT_SLOT), res});
+                    return true;
+                }
+            } break;
+            case VmBulkTask::Step::Combine: {
+                set_base_slot(VmBulkTask::RESULT_SLOT, res);
+            } break;
+        }
+
+        // the next call, then the next child, else the result:
+        if (task.next < task.end) {
+            ssize_t i = task.next++;
+            task.step = VmBulkTask::Step::Call;
+            switch (task.kind) {
+                case VmBulkKind::Map: prepare_bulk_call(t, {bulk_item(t, i)}); break;
+                case VmBulkKind::ForEach: prepare_bulk_call(t, {OBJECT::make_integer(i)}); break;
+                case VmBulkKind::Fold: prepare_bulk_call(t, {base_slot(VmBulkTask::RESULT_SLOT), bulk_item(t, i)}); break;
+            }
+            return true;
+        }
+        if (task.joined_count < task.children.size()) {
+            // resumed with the child's result, halting at once: cf `run_spawned_vthread`
+            task.step = VmBulkTask::Step::Join;
+            t->regs().s = VmBulkTask::BASE_COUNT;
+            t->regs().x = vthread_entry(code().halt_entry());
+            t->request_suspend(VThreadSuspend::Join, task.children[task.joined_count++]);
+            return true;
+        }
+        t->regs().a = base_slot(VmBulkTask::RESULT_SLOT);
+        return false;
+    }
+    void VirtualMachine::prepare_bulk_call(VThread* t, std::initializer_list<OBJECT> args) {
+        // a frame returning to `halt_entry` is pushed above the base, then the arguments, last-to-first:
+        // cf 'frame', first (c, f, ret) last
+        VmStack& stack = t->stack();
+        ssize_t s = VmBulkTask::BASE_COUNT;
+        s = stack.push(OBJECT::make_integer(vthread_entry(code().halt_entry())), 
+            stack.push(OBJECT::make_integer(s), 
+                stack.push(OBJECT::null, s)));
+        for (auto it = std::rbegin(args); it != std::rend(args); ++it) {
+            s = stack.push(*it, s);
+        }
+        t->regs().a = stack.index(VmBulkTask::PROC_SLOT + 1, 0);
+        t->regs().x = vthread_entry(code().call_entry());
+        t->regs().f = VmBulkTask::BASE_COUNT;
+        t->regs().c = OBJECT::null;
+        t->regs().s = s;
+    }
+    OBJECT VirtualMachine::apply_nested(char const* proc_name, OBJECT proc, std::initializer_list<OBJECT> args) {
+        if (!proc.is_closure()) {
+            std::stringstream ss;
+            ss << proc_name << ": expected a procedure, received: " << proc;
+            error(ss.str());
+            throw SsiError();
+        }
+        VThread& t = thread();
+
+        // the caller's registers are restored however the call ends:
+        struct RegsGuard {
+            VThread& t;
+            VmRegs saved;
+            ~RegsGuard() { t.regs() = saved; }
+        } regs_guard{t, t.regs()};
+
+        // cf `prepare_bulk_call`, above the caller's frame and args rather than a bulk task's base:
+        VmStack& stack = t.stack();
+        ssize_t const base = regs_guard.saved.s;
+        ssize_t s = stack.push(OBJECT::make_integer(vthread_entry(code().halt_entry())), 
+            stack.push(OBJECT::make_integer(base), 
+                stack.push(OBJECT::null, base)));
+        for (auto it = std::rbegin(args); it != std::rend(args); ++it) {
+            s = stack.push(*it, s);
+        }
+        t.regs().a = proc;
+        t.regs().x = vthread_entry(code().call_entry());
+        t.regs().f = base;
+        t.regs().c = OBJECT::null;
+        t.regs().s = s;
+        while (!run_vthread(&t)) {
+            VThreadSuspend suspend = t.suspend();
+            t.clear_suspend();
+            if (suspend != VThreadSuspend::Yield) {
+                std::stringstream ss;
+                ss << proc_name << ": the procedure may not join a VThread, nor use a channel";
+                error(ss.str());
+                throw SsiError();
+            }
+        }
+        return t.regs().a;
+    }
+    OBJECT VirtualMachine::bulk_item(VThread* t, ssize_t i) {
+        OBJECT items = t->stack().index(VmBulkTask::ITEMS_SLOT + 1, 0);
+        if (items.is_num_vector()) {
+            char const* proc_name = (t->bulk_task()->kind == VmBulkKind::Fold) ? "parallel-fold" : "parallel-vector-map";
+            return num_vector_item(t->gc_tfe(), proc_name, items.as_num_vector_p(), static_cast<size_t>(i));
+        } else {
+            return items.as_vector_p()->operator[](i);
+        }
+    }
+
+    //
+    // Channels:
+    //
+
+    ChannelObject* VirtualMachine::claim_channel_end(char const* proc_name, OBJECT channel, bool is_sender) {
+        assert(channel.is_channel());
+        ChannelObject* ch = channel.as_channel_p();
+        bool is_owner = is_sender ? ch->claim_sender(thread().id()) : ch->claim_receiver(thread().id());
+        if (!is_owner) {
+            std::stringstream ss;
+            ss << proc_name << ": another VThread already " << (is_sender ? "sends to" : "receives from") << " this channel";
+            error(ss.str());
+            throw SsiError();
+        }
+        return ch;
+    }
+    OBJECT VirtualMachine::channel_send(OBJECT channel, OBJECT message) {
+        ChannelObject* ch = claim_channel_end("channel-send", channel, true);
+        if (ch->try_push(message)) {
+            wake_channel_receiver(ch, &gc_tfe());
+            return OBJECT::null;
+        }
+        // the accumulator holds the message while this VThread is suspended, cf `try_channel_op`:
+        thread().request_suspend(VThreadSuspend::Send, channel);
+        return message;
+    }
+    OBJECT VirtualMachine::channel_receive(OBJECT channel) {
+        ChannelObject* ch = claim_channel_end("channel-receive", channel, false);
+        if (std::optional<OBJECT> message = ch->try_pop()) {
+            wake_channel_senders(ch);
+            return deep_copy(&gc_tfe(), *message);
+        }
+        thread().request_suspend(VThreadSuspend::Receive, channel);
+        return OBJECT::null;
+    }
+    size_t VirtualMachine::channel_try_send_batch(OBJECT channel, OBJECT const* messages, size_t count) {
+        ChannelObject* ch = claim_channel_end("channel-send", channel, true);
+        size_t sent_count = ch->try_push_batch(messages, count);
+        if (sent_count > 0) {
+            wake_channel_receiver(ch, &gc_tfe());
+        }
+        return sent_count;
+    }
+    size_t VirtualMachine::channel_try_receive_batch(OBJECT channel, OBJECT* out, size_t count) {
+        ChannelObject* ch = claim_channel_end("channel-receive", channel, false);
+        size_t received_count = ch->try_pop_batch(out, count);
+        if (received_count > 0) {
+            wake_channel_senders(ch);
+        }
+        for (size_t i = 0; i < received_count; i++) {
+            out[i] = deep_copy(&gc_tfe(), out[i]);
+        }
+        return received_count;
+    }
+    bool VirtualMachine::try_channel_op(VThread* t) {
+        // not overlapping a collection, which may move the message: the lock is only taken once a mutator.
+        MutatorGuard mutator_guard{this};
+        bool is_send = (t->suspend() == VThreadSuspend::Send);
+        ChannelObject* ch = t->suspend_obj().as_channel_p();
+        t->clear_suspend();
+        bool is_done = false; {
+            std::lock_guard lg{ch->mutex()};
+            // blocking before retrying: either the retry sees the other end's last push (or pop), or the other
+            // end sees this VThread blocked, cf the fences in `wake_channel_receiver` and `wake_channel_senders`.
+            t->set_state(VThreadState::Blocked);
+            if (is_send) {
+                ch->block_sender(t);
+            } else {
+                ch->block_receiver(t);
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (is_send) {
+                is_done = ch->try_push(t->regs().a);
+                if (is_done) {
+                    t->regs().a = OBJECT::null;
+                }
+            } else if (std::optional<OBJECT> message = ch->try_pop()) {
+                is_done = true;
+                t->regs().a = deep_copy(t->gc_tfe(), *message);
+            }
+            if (is_done) {
+                ch->unblock(t);
+                t->set_state(VThreadState::Runnable);
+            }
+        }
+        if (!is_done) {
+            return false;
+        }
+        t->suspend_obj() = OBJECT::null;
+        if (is_send) {
+            wake_channel_receiver(ch, t->gc_tfe());
+        } else {
+            wake_channel_senders(ch);
+        }
+        return true;
+    }
+    void VirtualMachine::cancel_channel_op(VThread* t) {
+        ChannelObject* ch = t->suspend_obj().as_channel_p();
+        {
+            std::lock_guard lg{ch->mutex()};
+            ch->unblock(t);
+            t->set_state(VThreadState::Runnable);
+        }
+        t->suspend_obj() = OBJECT::null;
+    }
+    void VirtualMachine::wake_channel_receiver(ChannelObject* ch, GcThreadFrontEnd* gc_tfe) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!ch->has_blocked()) {
+            return;
+        }
+        // the receiver is blocked, so the message is popped (and copied) on its behalf:
+        VThread* receiver; {
+            std::lock_guard lg{ch->mutex()};
+            receiver = ch->blocked_receiver();
+            if (receiver == nullptr) {
+                return;
+            }
+            std::optional<OBJECT> message = ch->try_pop();
+            if (!message.has_value()) {
+                return;
+            }
+            ch->unblock(receiver);
+            receiver->regs().a = deep_copy(gc_tfe, *message);
+            receiver->suspend_obj() = OBJECT::null;
+        }
+        resume(receiver);
+        wake_channel_senders(ch);
+    }
+    void VirtualMachine::wake_channel_senders(ChannelObject* ch) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!ch->has_blocked()) {
+            return;
+        }
+        // blocked senders' messages are pushed on their behalf, oldest first, for as long as there is room:
+        std::vector<VThread*> senders; {
+            std::lock_guard lg{ch->mutex()};
+            while (VThread* sender = ch->blocked_sender()) {
+                if (!ch->try_push(sender->regs().a)) {
+                    break;
+                }
+                ch->unblock(sender);
+                sender->regs().a = OBJECT::null;
+                sender->suspend_obj() = OBJECT::null;
+                senders.push_back(sender);
+            }
+        }
+        for (VThread* sender: senders) {
+            resume(sender);
+        }
+    }
+
+    //
+    // Collection:
+    //
+
+    void VirtualMachine::enter_mutator() {
+        // not starting while a collection is pending: the OS threads waiting for it have counted us out.
+        std::unique_lock lk{m_gc_mutex};
+        m_gc_cv.wait(lk, [this] () { return m_gc_stopped_count == 0; });
+        m_gc_running_count++;
+    }
+    void VirtualMachine::exit_mutator() {
+        std::lock_guard lg{m_gc_mutex};
+        m_gc_running_count--;
+        if (m_gc_stopped_count > 0 && m_gc_stopped_count == m_gc_running_count) {
+            // the OS threads waiting at safe-points may now collect.
+            m_gc_cv.notify_all();
+        }
+    }
+    void VirtualMachine::safepoint() {
+        if (t_mutator_depth > 1) {
+            return;
+        }
+        std::unique_lock lk{m_gc_mutex};
+        if (!m_gc->collect_requested()) {
+            // another OS thread has just collected.
+            return;
+        }
+        size_t epoch = m_gc_epoch;
+        m_gc_stopped_count++;
+        m_gc_cv.wait(lk, [this, epoch] () { 
+            return m_gc_epoch != epoch || m_gc_stopped_count == m_gc_running_count; 
+        });
+        if (m_gc_epoch == epoch) {
+            // every other running OS thread is stopped: their VThreads' registers are saved.
+            collect();
+            m_gc_epoch++;
+        }
+        m_gc_stopped_count--;
+        m_gc_cv.notify_all();
+    }
+    void VirtualMachine::collect(bool full) {
+        // quickened code refers to objects that may move: cf `may_quicken`
+        m_bytecode.deoptimize_all();
+        collect_young();
+        if (!full && !m_gc->sweep_requested()) {
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        // marking: the sweep is traced by the GC, cf `GcMiddleEnd::sweep`
+        {
+            TraceSpan mark_span{"gc-mark"};
+            GcMarker marker{m_gc->page_map()};
+
+            // the units of code that may still run are marked as closures are, cf `VCode::free_unmarked_units`:
+            code().clear_unit_marks();
+            for (VSubr const* subr: m_running_subrs) {
+                for (VmProgram const& program: subr->line_programs) {
+                    code().mark_unit(vmx_unit(program.s));
+                }
+            }
+            marker.set_closure_hook(
+                [] (void* vm, ClosureObject* closure) { static_cast<VirtualMachine*>(vm)->mark_closure_code(closure); },
+                this
+            );
+
+            // globals, code, and source objects:
+            marker.mark_all(m_global_vals.data(), m_global_vals.size());
+            m_jit_compiler.mark(marker);
+            for (VSubr const* subr: m_running_subrs) {
+                marker.mark_all(subr->line_code_objs.data(), subr->line_code_objs.size());
+            }
+
+            // every VThread's registers and stack: done VThreads only keep their result.
+            {
+                std::lock_guard lg{m_threads_mutex};
+                for (std::unique_ptr<VThread>& t: m_threads) {
+                    marker.mark(t->regs().a);
+                    marker.mark(t->regs().c);
+                    marker.mark(t->suspend_obj());
+                    if (t->has_stack()) {
+                        marker.mark_all(t->stack().data(), t->regs().s);
+                        marker.mark(t->stack().captured());
+                    }
+                }
+            }
+        }
+        if (m_heap_profile) {
+            m_heap_profile->sweep(m_gc->page_map());
+        }
+        m_gc->sweep();
+        // profiles refer to the expressions they counted, so they keep all code:
+        if (!m_profiling) {
+            for (VCodeUnitID unit: code().free_unmarked_units()) {
+                m_bytecode.free_unit(unit);
+                m_jit.free_unit(unit);
+            }
+        }
+        m_gc->record_full_collection(std::chrono::steady_clock::now() - start);
+    }
+    void VirtualMachine::mark_closure_code(ClosureObject* closure) {
+        code().mark_unit(vmx_unit(closure->body()));
+        if (closure->body() == code().nuate_entry()) {
+            // cf `continuation`
+            for (size_t i = 1; i < closure->count(); i++) {
+                code().mark_unit(static_cast<VCodeUnitID>(closure->free_vars()[i].as_integer()));
+            }
+        }
+    }
+    void VirtualMachine::collect_young() {
+        TraceSpan span{"gc-minor"};
+        auto start = std::chrono::steady_clock::now();
+        // between stream lines, no VThread runs on this OS thread, so survivors are promoted for the main VThread:
+        GcEvacuator evacuator{t_running_vthread ? thread().gc_tfe() : main_thread().gc_tfe(), m_gc->linearizes_lists()};
+
+        // only objects made while an engine runs can be young, so code and source objects are not roots:
+        evacuator.evacuate_all(m_global_vals.data(), m_global_vals.size());
+        {
+            std::lock_guard lg{m_threads_mutex};
+            for (std::unique_ptr<VThread>& t: m_threads) {
+                evacuator.evacuate(t->regs().a);
+                evacuator.evacuate(t->regs().c);
+                evacuator.evacuate(t->suspend_obj());
+                if (t->has_stack()) {
+                    evacuator.evacuate_all(t->stack().data(), t->regs().s);
+                }
+                // the closures of allocation sites may move, or be freed by a sweep:
+                t->clear_alloc_site();
+            }
+        }
+        for (BaseBoxedObject* obj: m_gc->take_remembered_set()) {
+            evacuator.evacuate_children(obj);
+        }
+
+        if (m_heap_profile) {
+            m_heap_profile->sweep_young();
+        }
+        m_gc->reset_nurseries();
+        m_gc->record_minor_collection(
+            std::chrono::steady_clock::now() - start, evacuator.promoted_count(),
+            evacuator.list_link_count(), evacuator.adjacent_link_count()
+        );
+    }
+
+    //
+    // Profiling:
+    //
+
+    void VirtualMachine::enable_profiler() {
+        std::lock_guard lg{m_threads_mutex};
+        m_profiling = true;
+        for (std::unique_ptr<VThread>& t: m_threads) {
+            t->enable_profile();
+        }
+    }
+    void VirtualMachine::print_profile(std::ostream& out) {
+        VmProfile total;
+        {
+            std::lock_guard lg{m_threads_mutex};
+            for (std::unique_ptr<VThread>& t: m_threads) {
+                if (t->profile()) {
+                    total.merge(*t->profile());
+                }
+            }
+        }
+        total.print(out, code());
+    }
+
+    void VirtualMachine::enable_heap_profiler(size_t period) {
+        m_heap_profile = std::make_unique<VmHeapProfile>(period);
+        m_gc->enable_heap_sampling(
+            period,
+            [] (void* vm, BaseBoxedObject* obj, size_t byte_count) {
+                static_cast<VirtualMachine*>(vm)->sample_allocation(obj, byte_count);
+            },
+            this
+        );
+    }
+    bool VirtualMachine::write_heap_profile(std::ostream& out) {
+        if (!m_heap_profile) {
+            return false;
+        }
+        m_heap_profile->write_pprof(out, code());
+        return out.good();
+    }
+    // sample_allocation attributes a sampled object to the instruction allocating it on this OS thread, if any:
+    // the graph engine's registers are always current, but the bytecode engines publish each allocating 
+    // instruction, cf `VThread::publish_alloc_site`.
+    void VirtualMachine::sample_allocation(BaseBoxedObject* obj, size_t byte_count) {
+        VmExpID exp = -1;
+        VmExpID body = VmHeapProfile::RUNTIME_BODY;
+        VmExpKind exp_kind = VmExpKind::Halt;
+        if (t_running_vm == this && t_running_vthread) {
+            VThread& t = thread();
+            if (!runs_bytecode()) {
+                exp = t.regs().x;
+                exp_kind = code()[exp].kind;
+                body = profiled_body(t.regs().c);
+            } else if (t.has_alloc_site()) {
+                // VThreads on other OS threads may sample at once, while `exp_at` builds its index:
+                std::lock_guard lg{m_alloc_site_mutex};
+                exp = m_bytecode.exp_at(reinterpret_cast<VmCodePtr>(t.alloc_x()), &exp_kind);
+                body = profiled_body(t.alloc_c());
+            }
+        }
+        m_heap_profile->record(obj, byte_count, exp, body, exp_kind);
+    }
+
+    //
+    // VmScheduler:
+    //
+
+    VmScheduler::VmScheduler(VirtualMachine* vm)
+    :   m_vm(vm),
+        m_deques(),
+        m_yielded(),
+        m_workers(),
+        m_mutex(),
+        m_cv(),
+        m_ready_count(0),
+        m_live_count(0),
+        m_shutdown(false)
+    {
+        size_t worker_count = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < worker_count; i++) {
+            m_deques.push_back(std::make_unique<SmtWorkDeque<VThread*>>());
+        }
+    }
+    VmScheduler::~VmScheduler() {
+        stop_workers();
+    }
+    void VmScheduler::spawn(VThread* t) {
+        {
+            std::lock_guard lg{m_mutex};
+            if (m_workers.empty()) {
+                for (size_t i = 1; i < m_deques.size(); i++) {
+                    m_workers.emplace_back(&VmScheduler::worker_main, this, i);
+                }
+            }
+        }
+        ++m_live_count;
+        enqueue(t);
+    }
+    void VmScheduler::enqueue(VThread* t, bool yielded) {
+        if (yielded) {
+            m_yielded.enqueue(t);
+        } else {
+            m_deques[t_worker_index]->push(t);
+        }
+        ++m_ready_count;
+        notify();
+    }
+    void VmScheduler::finish(VThread* t) {
+        std::vector<VThread*> joiners; {
+            // joiners take the result while `t` is locked: a later join may reclaim `t` as soon as it is Done.
+            std::lock_guard lg{t->mutex()};
+            t->set_state(VThreadState::Done);
+            joiners.swap(t->joiners());
+            // not overlapping a collection, which may move the result, and scans each VThread's stack and front-end:
+            MutatorGuard mutator_guard{m_vm};
+            for (VThread* joiner: joiners) {
+                m_vm->take_join_result(joiner, t);
+            }
+            t->release();
+            if (!joiners.empty()) {
+                m_vm->reclaim_vthread(t);
+            }
+        }
+        // joiners resume only once `t` is reclaimed, so that the next VThread they spawn may reuse it:
+        for (VThread* joiner: joiners) {
+            m_vm->resume(joiner);
+        }
+        --m_live_count;
+        notify();
+    }
+    void VmScheduler::notify() {
+        // locking so that no waiter can miss this between checking its predicate and waiting:
+        { std::lock_guard lg{m_mutex}; }
+        m_cv.notify_all();
+    }
+    void VmScheduler::stop_workers() {
+        {
+            std::lock_guard lg{m_mutex};
+            m_shutdown = true;
+        }
+        m_cv.notify_all();
+        for (std::thread& worker: m_workers) {
+            worker.join();
+        }
+        std::lock_guard lg{m_mutex};
+        m_workers.clear();
+        m_shutdown = false;
+    }
+    void VmScheduler::set_worker_count(size_t worker_count) {
+        assert(live_count() == 0);
+        stop_workers();
+        m_deques.clear();
+        for (size_t i = 0; i < std::max<size_t>(1, worker_count); i++) {
+            m_deques.push_back(std::make_unique<SmtWorkDeque<VThread*>>());
+        }
+    }
+    VThread* VmScheduler::try_pick(size_t worker) {
+        std::optional<VThread*> picked = m_deques[worker]->try_pop();
+        if (!picked.has_value()) {
+            picked = m_yielded.try_dequeue();
+        }
+        for (size_t i = 1; !picked.has_value() && i < m_deques.size(); i++) {
+            picked = m_deques[(worker + i) % m_deques.size()]->try_steal();
+        }
+        if (!picked.has_value()) {
+            return nullptr;
+        }
+        --m_ready_count;
+        return picked.value();
+    }
+    template <typename Pred>
+    void VmScheduler::help_until(Pred pred) {
+        assert(t_worker_index == 0);
+        while (!pred()) {
+            if (VThread* t = try_pick(0)) {
+                m_vm->run_spawned_vthread(t);
+            } else {
+                std::unique_lock lock{m_mutex};
+                m_cv.wait(lock, [&] () { return pred() || m_ready_count.load() > 0; });
+            }
+        }
+    }
+    void VmScheduler::help_once() {
+        if (VThread* t = try_pick(0)) {
+            m_vm->run_spawned_vthread(t);
+        }
+    }
+    void VmScheduler::worker_main(size_t worker) {
+        t_worker_index = worker;
+        for (;;) {
+            if (VThread* t = try_pick(worker)) {
+                m_vm->run_spawned_vthread(t);
+            } else {
+                std::unique_lock lock{m_mutex};
+                m_cv.wait(lock, [this] () { return m_shutdown || m_ready_count.load() > 0; });
+                if (m_shutdown) {
+                    return;
+                }
+            }
+        }
+    }
+
+    //
+    //
+    // Interface:
+    //
+    //
+
+    VirtualMachine* create_vm(
+        Gc* gc,
+        VirtualMachineStandardProcedureBinder binder,
+        VmEngine engine
+    ) {
+        auto vm = new VirtualMachine(gc, binder, engine); 
+        return vm;
+    }
+    void destroy_vm(VirtualMachine* vm) {
+        delete vm;
+    }
+    char const* vm_engine_name(VmEngine engine) {
+        switch (engine) {
+            case VmEngine::Graph: return "graph";
+            case VmEngine::Bytecode: return "bytecode";
+            case VmEngine::Register: return "register";
+        }
+        return "?";
+    }
+    Gc* vm_gc(VirtualMachine* vm) {
+        return vm->gc();
+    }
+    GcThreadFrontEnd* vm_gc_tfe(VirtualMachine* vm) {
+        if (t_running_vm == vm) {
+            return &vm->gc_tfe();
+        } else {
+            return vm->main_thread().gc_tfe();
+        }
+    }
+    OBJECT vm_spawn_vthread(VirtualMachine* vm, OBJECT thunk) {
+        return vm->spawn_vthread(thunk);
+    }
+    void vm_set_worker_count(VirtualMachine* vm, size_t worker_count) {
+        vm->set_worker_count(worker_count);
+    }
+    size_t vm_vthread_count(VirtualMachine* vm) {
+        return vm->count_vthreads();
+    }
+    void vm_yield_vthread(VirtualMachine* vm) {
+        vm->thread().request_suspend(VThreadSuspend::Yield);
+    }
+    void vm_join_vthread(VirtualMachine* vm, VThreadID id) {
+        VThread* target = vm->find_vthread(id);
+        if (target == nullptr) {
+            std::stringstream ss;
+            ss << "join: no VThread with ID " << id;
+            error(ss.str());
+            throw SsiError();
+        }
+        if (target == &vm->thread()) {
+            error("join: a VThread cannot join itself");
+            throw SsiError();
+        }
+        vm->thread().request_suspend(VThreadSuspend::Join, id);
+    }
+    static size_t expect_bulk_items(char const* proc_name, OBJECT items) {
+        if (items.is_vector()) {
+            return items.as_vector_p()->count();
+        } else if (items.is_num_vector()) {
+            return items.as_num_vector_p()->count();
+        } else {
+            std::stringstream ss;
+            ss << proc_name << ": expected a vector or numeric vector, received: " << items;
+            error(ss.str());
+            throw SsiError();
+        }
+    }
+    OBJECT vm_parallel_vector_map(VirtualMachine* vm, OBJECT proc, OBJECT items) {
+        size_t count = expect_bulk_items("parallel-vector-map", items);
+        OBJECT result = OBJECT::make_vector(vm_gc_tfe(vm), count, count);
+        return vm->spawn_bulk("parallel-vector-map", VmBulkKind::Map, proc, items, result, 0, static_cast<ssize_t>(count));
+    }
+    OBJECT vm_parallel_for_each(VirtualMachine* vm, OBJECT proc, ssize_t begin, ssize_t end) {
+        return vm->spawn_bulk("parallel-for-each", VmBulkKind::ForEach, proc, OBJECT::null, OBJECT::null, begin, end);
+    }
+    OBJECT vm_parallel_fold(VirtualMachine* vm, OBJECT combine, OBJECT init, OBJECT items) {
+        size_t count = expect_bulk_items("parallel-fold", items);
+        return vm->spawn_bulk("parallel-fold", VmBulkKind::Fold, combine, items, init, 0, static_cast<ssize_t>(count));
+    }
+    OBJECT vm_hash_table_walk(VirtualMachine* vm, OBJECT table, OBJECT proc) {
+        // the entries are copied first, so that `proc` may modify the table:
+        HashTableObject* table_p = table.as_hash_table_p();
+        size_t count = table_p->count();
+        // - nested engines cannot collect, so `entries` stays put while `proc` runs.
+        OBJECT entries = OBJECT::make_vector(vm_gc_tfe(vm), 2 * count, 2 * count);
+        size_t i = 0;
+        table_p->for_each([entries, &i] (OBJECT key, OBJECT value) {
+            entries.as_vector_p()->set(i++, key);
+            entries.as_vector_p()->set(i++, value);
+        });
+        for (size_t j = 0; j < count; j++) {
+            VectorObject* entries_p = entries.as_vector_p();
+            vm->apply_nested("hash-table-walk", proc, {(*entries_p)[2*j], (*entries_p)[2*j + 1]});
+        }
+        return OBJECT::null;
+    }
+    OBJECT vm_hash_table_update(VirtualMachine* vm, OBJECT table, OBJECT key, OBJECT proc, OBJECT value) {
+        OBJECT res = vm->apply_nested("hash-table-update!", proc, {value});
+        table.as_hash_table_p()->set(key, res);
+        return OBJECT::null;
+    }
+
+    OBJECT vm_channel_send(VirtualMachine* vm, OBJECT channel, OBJECT message) {
+        return vm->channel_send(channel, message);
+    }
+    OBJECT vm_channel_receive(VirtualMachine* vm, OBJECT channel) {
+        return vm->channel_receive(channel);
+    }
+    size_t vm_channel_try_send_batch(VirtualMachine* vm, OBJECT channel, OBJECT const* messages, size_t count) {
+        return vm->channel_try_send_batch(channel, messages, count);
+    }
+    size_t vm_channel_try_receive_batch(VirtualMachine* vm, OBJECT channel, OBJECT* out, size_t count) {
+        return vm->channel_try_receive_batch(channel, out, count);
+    }
+    void vm_enable_profiler(VirtualMachine* vm) {
+        vm->enable_profiler();
+    }
+    void vm_print_profile(VirtualMachine* vm, std::ostream& out) {
+        vm->print_profile(out);
+    }
+    void vm_enable_heap_profiler(VirtualMachine* vm, size_t period) {
+        vm->enable_heap_profiler(period);
+    }
+    bool vm_write_heap_profile(VirtualMachine* vm, std::ostream& out) {
+        return vm->write_heap_profile(out);
+    }
+    void vm_begin_streaming(VirtualMachine* vm) {
+        vm->begin_streaming();
+    }
+    OBJECT vm_stream_lines(VirtualMachine* vm, std::vector<OBJECT> line_code_objs, bool print_each_line) {
+        if (print_each_line) {
+            return vm->stream_lines<true>(std::move(line_code_objs));
+        } else {
+            return vm->stream_lines<false>(std::move(line_code_objs));
+        }
+    }
+    int64_t vm_fork(VirtualMachine* vm) {
+        return vm->fork();
+    }
+    OBJECT sync_execute_vm(VirtualMachine* vm, bool print_each_line) {
+        if (print_each_line) {
+            return vm->sync_execute<true>();
+        } else {
+            return vm->sync_execute<false>();
         }
     }
     void dump_vm(VirtualMachine* vm, std::ostream& out) {
         std::cerr << "<dump>" << std::endl;
         std::cerr << "=== VROM ===" << std::endl;
         vm->code().dump(out);
+        if (vm->runs_bytecode()) {
+            out << "--- BYTECODE ---" << std::endl;
+            vm->bytecode().print(out);
+        }
         std::cerr << "</dump>" << std::endl;
     }
     Compiler* vm_compiler(VirtualMachine* vm) {
         return &vm->jit_compiler();
     }
 
+    VmCodePtr vm_code_entry(VirtualMachine* vm, VmExpID exp_id) {
+        return vm->bytecode().entry(exp_id);
+    }
+    void vm_install_native_entry(VirtualMachine* vm, VmExpID exp_id, JitCode code) {
+        vm->jit().install(exp_id, code);
+    }
+
     OBJECT vm_interp_expr(VirtualMachine* vm, OBJECT line_code_obj) {
         VSubr subr = vm->jit_compiler().compile_expr("subr-1shot", line_code_obj);
-        return vm->sync_execute_subr<false>(subr);
+        return vm->sync_execute_subr_once<false>(subr);
     }
     OBJECT vm_interp_subr(VirtualMachine* vm, std::vector<OBJECT> line_code_objs, bool print_each_line) {
         VSubr subr = vm->jit_compiler().compile_subr("subr", line_code_objs);
         if (print_each_line) {
-            return vm->sync_execute_subr<true>(subr);
+            return vm->sync_execute_subr_once<true>(subr);
         } else {
-            return vm->sync_execute_subr<false>(subr);
+            return vm->sync_execute_subr_once<false>(subr);
         }
     }
 
@@ -435,13 +2820,10 @@ namespace ss {
     // Utility
     //
 
-    void vm_bind_platform_procedure(
-        VirtualMachine* vm, 
-        std::string proc_name,
-        PlatformProcCb callable_cb,
-        std::vector<std::string> arg_names,
-        std::string docstring_more,
-        bool is_variadic
+    static std::string platform_procedure_docstring(
+        std::string const& proc_name,
+        std::vector<std::string> const& arg_names,
+        std::string const& docstring_more
     ) {
         std::stringstream docstring;
         docstring
@@ -457,16 +2839,69 @@ namespace ss {
         if (!docstring_more.empty()) {
             docstring << ": " << docstring_more;
         }
-
+        return docstring.str();
+    }
+    void vm_bind_platform_procedure(
+        VirtualMachine* vm, 
+        std::string proc_name,
+        PlatformProcCb callable_cb,
+        std::vector<std::string> arg_names,
+        std::string docstring_more,
+        bool is_variadic
+    ) {
+        std::string docstring = platform_procedure_docstring(proc_name, arg_names, docstring_more);
         Compiler* c = vm_compiler(vm);
         c->define_platform_proc(
             intern(std::move(proc_name)),
             std::move(arg_names),
             callable_cb,
-            docstring.str(),
+            std::move(docstring),
             is_variadic
         );
     }
+    static void vm_bind_platform_procedure_fn(
+        VirtualMachine* vm, 
+        std::string proc_name,
+        PlatformProcFn fn,
+        std::vector<std::string> arg_names,
+        std::string docstring_more
+    ) {
+        std::string docstring = platform_procedure_docstring(proc_name, arg_names, docstring_more);
+        Compiler* c = vm_compiler(vm);
+        c->define_platform_proc(
+            intern(std::move(proc_name)),
+            std::move(arg_names),
+            fn,
+            std::move(docstring)
+        );
+    }
+    void vm_bind_platform_procedure(VirtualMachine* vm, std::string proc_name, PlatformProcFn0 fn, std::vector<std::string> arg_names, std::string docstring_more, void* ctx) {
+        vm_bind_platform_procedure_fn(vm, std::move(proc_name), PlatformProcFn{fn, ctx}, std::move(arg_names), std::move(docstring_more));
+    }
+    void vm_bind_platform_procedure(VirtualMachine* vm, std::string proc_name, PlatformProcFn1 fn, std::vector<std::string> arg_names, std::string docstring_more, void* ctx) {
+        vm_bind_platform_procedure_fn(vm, std::move(proc_name), PlatformProcFn{fn, ctx}, std::move(arg_names), std::move(docstring_more));
+    }
+    void vm_bind_platform_procedure(VirtualMachine* vm, std::string proc_name, PlatformProcFn2 fn, std::vector<std::string> arg_names, std::string docstring_more, void* ctx) {
+        vm_bind_platform_procedure_fn(vm, std::move(proc_name), PlatformProcFn{fn, ctx}, std::move(arg_names), std::move(docstring_more));
+    }
+    void vm_bind_platform_procedure(VirtualMachine* vm, std::string proc_name, PlatformProcFn3 fn, std::vector<std::string> arg_names, std::string docstring_more, void* ctx) {
+        vm_bind_platform_procedure_fn(vm, std::move(proc_name), PlatformProcFn{fn, ctx}, std::move(arg_names), std::move(docstring_more));
+    }
+    void vm_bind_platform_procedure(VirtualMachine* vm, std::string proc_name, PlatformProcFn4 fn, std::vector<std::string> arg_names, std::string docstring_more, void* ctx) {
+        vm_bind_platform_procedure_fn(vm, std::move(proc_name), PlatformProcFn{fn, ctx}, std::move(arg_names), std::move(docstring_more));
+    }
+    void vm_bind_platform_procedure(VirtualMachine* vm, std::string proc_name, PlatformProcFnV fn, std::vector<std::string> arg_names, std::string docstring_more, void* ctx) {
+        vm_bind_platform_procedure_fn(vm, std::move(proc_name), PlatformProcFn{fn, ctx}, std::move(arg_names), std::move(docstring_more));
+    }
 
+    void vm_bind_platform_procedure_prim(
+        VirtualMachine* vm,
+        std::string const& proc_name,
+        VmExpKind prim_kind
+    ) {
+        Compiler* c = vm_compiler(vm);
+        PlatformProcID proc_id = c->lookup_platform_proc(intern(proc_name));
+        c->code()->set_platform_proc_prim(proc_id, prim_kind);
+    }
 
 }   // namespace ss
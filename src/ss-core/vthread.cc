@@ -1,12 +1,71 @@
 #include "ss-core/vthread.hh"
 
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ss-core/memory.hh"
 #include "ss-core/object.hh"
+#include "ss-core/feedback.hh"
+#include "ss-core/profile.hh"
 
 namespace ss {
 
+    VThread::VThread(Gc* gc, VThreadID id, size_t stack_capacity)
+    :   m_id(id),
+        m_regs(),
+        m_stack_capacity(stack_capacity),
+        m_stack(std::in_place, stack_capacity),
+        m_gc_tfe(std::in_place, gc),
+        m_mutex(),
+        m_state(VThreadState::Runnable),
+        m_failed(false),
+        m_joiners(),
+        m_suspend(VThreadSuspend::None),
+        m_suspend_arg(-1),
+        m_suspend_obj(OBJECT::null),
+        m_alloc_x(0),
+        m_alloc_c(OBJECT::null),
+        m_profile(),
+        m_bulk_task()
+    {}
+    VThread::~VThread() {}
+
     void VThread::init() {
         m_regs.init();
     }
+    void VThread::enable_profile() {
+        if (!m_profile) {
+            m_profile = std::make_unique<VmProfile>();
+        }
+    }
+    void VThread::release() {
+        assert(state() == VThreadState::Done && "Cannot release a VThread that may still run");
+        m_stack.reset();
+        m_gc_tfe.reset();
+    }
+    void VThread::recycle() {
+        assert(state() == VThreadState::Done && !has_stack() && "Cannot recycle a VThread that was not released");
+        m_regs.init();
+        m_failed = false;
+        m_suspend = VThreadSuspend::None;
+        m_suspend_arg = -1;
+        m_suspend_obj = OBJECT::null;
+        m_alloc_x = 0;
+        m_alloc_c = OBJECT::null;
+        m_bulk_task.reset();
+        set_state(VThreadState::Free);
+    }
+    void VThread::reuse(Gc* gc) {
+        assert(state() == VThreadState::Free && "Cannot reuse a VThread that was not recycled");
+        m_stack.emplace(m_stack_capacity);
+        m_gc_tfe.emplace(gc);
+        set_state(VThreadState::Runnable);
+    }
 
     void VmRegs::init() {
         a = OBJECT::null;
@@ -16,4 +75,87 @@ namespace ss {
         s = 0;
     }
 
+    ///
+    // VmStack
+    //
+
+    static size_t round_up_to_os_page(size_t byte_count) {
+        size_t page_size = os_page_size();
+        return ((byte_count + page_size - 1) / page_size) * page_size;
+    }
+    static void vm_stack_os_error(char const* what) {
+        std::stringstream ss;
+        ss << "VmStack: " << what << " failed: " << std::strerror(errno);
+        error(ss.str());
+        throw SsiError();
+    }
+
+    VmStack::VmStack(size_t capacity)
+    :   m_items(nullptr),
+        m_capacity(round_up_to_os_page(capacity * sizeof(OBJECT)) / sizeof(OBJECT)),
+        m_limit(0),
+        m_reserved_bytes(m_capacity * sizeof(OBJECT) + os_page_size()),
+        m_captured(OBJECT::null),
+        m_captured_height(0)
+    {
+        // reserving address space only: nothing is accessible until committed.
+        void* mem = mmap(nullptr, m_reserved_bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mem == MAP_FAILED) {
+            vm_stack_os_error("reserving stack memory");
+        }
+        m_items = static_cast<OBJECT*>(mem);
+        commit(std::min(m_capacity, MIN_COMMITTED_BYTES / sizeof(OBJECT)));
+    }
+    VmStack::~VmStack() {
+        munmap(m_items, m_reserved_bytes);
+    }
+
+    void VmStack::push_slow_path(ssize_t s) {
+        if (s < m_captured_height) {
+            m_captured_height = s;
+        }
+        if (s >= m_limit) {
+            if (static_cast<size_t>(s) >= m_capacity) {
+                std::stringstream ss;
+                ss << "Stack overflow: exceeded the VM stack's capacity of " << m_capacity << " items";
+                error(ss.str());
+                throw SsiError();
+            }
+            // growing geometrically to amortize the cost of each commit:
+            commit(std::min<ssize_t>(m_capacity, std::max<ssize_t>(s + 1, 2 * m_limit)));
+        }
+    }
+    void VmStack::commit(ssize_t count) {
+        if (count <= m_limit) {
+            return;
+        }
+        size_t byte_count = std::min(round_up_to_os_page(count * sizeof(OBJECT)), m_capacity * sizeof(OBJECT));
+        if (mprotect(m_items, byte_count, PROT_READ | PROT_WRITE) != 0) {
+            vm_stack_os_error("committing stack memory");
+        }
+        m_limit = byte_count / sizeof(OBJECT);
+    }
+    void VmStack::trim(ssize_t s) {
+        size_t keep_byte_count = std::max(
+            round_up_to_os_page(s * sizeof(OBJECT)), 
+            std::min(MIN_COMMITTED_BYTES, m_capacity * sizeof(OBJECT))
+        );
+        size_t limit_byte_count = m_limit * sizeof(OBJECT);
+        if (keep_byte_count >= limit_byte_count) {
+            return;
+        }
+
+        // returning pages to the OS: they read back as zero (null) if committed again.
+        char* trim_beg = reinterpret_cast<char*>(m_items) + keep_byte_count;
+        size_t trim_byte_count = limit_byte_count - keep_byte_count;
+        if (madvise(trim_beg, trim_byte_count, MADV_DONTNEED) != 0) {
+            vm_stack_os_error("releasing stack memory");
+        }
+        if (mprotect(trim_beg, trim_byte_count, PROT_NONE) != 0) {
+            vm_stack_os_error("decommitting stack memory");
+        }
+        m_limit = keep_byte_count / sizeof(OBJECT);
+        m_captured_height = std::min(m_captured_height, m_limit);
+    }
+
 }   // namespace ss
@@ -0,0 +1,185 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <optional>
+#include <cstring>
+#include <cstdlib>
+
+#include "ss-core/allocator.hh"
+#include "ss-core/feedback.hh"
+#include "ss-core/gc.hh"
+#include "ss-core/cli.hh"
+#include "ss-core/parser.hh"
+#include "ss-core/vm.hh"
+#include "ss-core/compiler.hh"
+#include "ss-core/expander.hh"
+#include "ss-core/library.hh"
+#include "ss-core/vcode-cache.hh"
+#include "ss-core/aot.hh"
+
+///
+// ssc: compiles a program ahead of time into a native executable, cf `ss-core/aot.hh`.
+// E.g.
+//  ssc fib.scm -o fib
+//  ./fib -snail-root ./snail-venv
+// - the program is compiled as `ssi` would, then emitted as a C++ translation unit, '<out>.cc': this is
+//   compiled by a C++ compiler ('SSC_CXX', or '-cxx') and linked against ss-core, its run-time library.
+// - '-emit-cc' only writes the translation unit, e.g. to build it elsewhere.
+//
+
+// the build's paths, for compiling translation units: cf 'CMakeLists.txt'
+#ifndef SSC_CXX_PATH
+    #define SSC_CXX_PATH "clang++"
+#endif
+#ifndef SSC_INCLUDE_FLAGS
+    #define SSC_INCLUDE_FLAGS ""
+#endif
+#ifndef SSC_RUNTIME_LIB_PATH
+    #define SSC_RUNTIME_LIB_PATH "libss-core.a"
+#endif
+
+namespace ss {
+
+    struct SscArgs {
+        std::string entry_point_path;
+        std::string out_path;
+        std::string snail_root;
+        std::string cxx_path;
+        bool emit_cc;
+    };
+
+    SscArgs parse_cli_args(int argc, char const* argv[]) {
+        CliArgsParser parser;
+        parser.add_ar0_option_rule("emit-cc");
+        parser.add_ar1_option_rule("o");
+        parser.add_ar1_option_rule("snail-root");
+        parser.add_ar1_option_rule("cxx");
+        CliArgs raw = parser.parse(argc, argv);
+
+        SscArgs res;
+        if (raw.pos.size() != 1) {
+            std::stringstream ss;
+            ss << "Expected exactly 1 positional argument, denoting the entry-point filepath: got " << raw.pos.size();
+            error(ss.str());
+            throw SsiError();
+        }
+        res.entry_point_path = raw.pos[0];
+        auto out_it = raw.ar1.find("o");
+        res.out_path = (out_it == raw.ar1.end() ? "a.out" : out_it->second);
+        auto snail_root_it = raw.ar1.find("snail-root");
+        res.snail_root = (snail_root_it == raw.ar1.end() ? "./snail-venv" : snail_root_it->second);
+        auto cxx_it = raw.ar1.find("cxx");
+        res.cxx_path = (cxx_it == raw.ar1.end() ? SSC_CXX_PATH : cxx_it->second);
+        res.emit_cc = (raw.ar0.find("emit-cc") != raw.ar0.end());
+        return res;
+    }
+
+    // compile_file compiles the file at `file_path` into a subr, as `ssi` does, with the source's cache key.
+    std::optional<VSubr> compile_file(VirtualMachine* vm, std::string const& file_path, uint64_t* out_key) {
+        std::ifstream f;
+        f.open(file_path);
+        if (!f.is_open()) {
+            std::stringstream ss;
+            ss  << "Failed to load file \"" << file_path << "\" to compile." << std::endl
+                << "Does it exist? Is it readable?";
+            error(ss.str());
+            return {};
+        }
+        std::stringstream source_ss;
+        source_ss << f.rdbuf();
+        std::string source = source_ss.str();
+        *out_key = vcode_cache_key(source, file_path);
+
+        Compiler& compiler = *vm_compiler(vm);
+        VCode* code = compiler.code();
+        VSubr subr{file_path, {}, {}};
+        try {
+            parse_all_lines_in_parallel(
+                source, file_path, vm_gc_tfe(vm), 1,
+                [&] (std::vector<OBJECT> line_code_obj_array) {
+                    auto expanded_line_code_obj_array = macroexpand_syntax(
+                        *vm_gc_tfe(vm),
+                        code->def_tab(),
+                        code->pproc_tab(),
+                        std::move(line_code_obj_array)
+                    );
+                    compiler.extend_subr(subr, std::move(expanded_line_code_obj_array));
+                }
+            );
+        } catch (SsiError const&) {
+            return {};
+        }
+        return std::optional<VSubr>{std::move(subr)};
+    }
+
+    // emit_program writes the translation unit of the program at `file_path` to `cc_path`.
+    bool emit_program(VirtualMachine* vm, std::string const& file_path, std::string const& cc_path) {
+        VCode& code = *vm_compiler(vm)->code();
+        GDefID first_gdef_id = code.count_globals();
+        uint64_t key;
+        std::optional<VSubr> subr = compile_file(vm, file_path, &key);
+        if (!subr.has_value()) {
+            return false;
+        }
+
+        // the subr's code is embedded as a VCode cache:
+        std::stringstream cache_ss;
+        if (!write_vcode_cache(cache_ss, key, code, subr.value(), first_gdef_id)) {
+            error("Could not write the compiled code of \"" + file_path + "\", e.g. it has a constant that cannot be");
+            return false;
+        }
+        std::string cache_bytes = cache_ss.str();
+        std::vector<uint64_t> cache_words(cache_bytes.size() / sizeof(uint64_t));
+        std::memcpy(cache_words.data(), cache_bytes.data(), cache_words.size() * sizeof(uint64_t));
+
+        std::ofstream out{cc_path, std::ios::trunc};
+        if (!out.is_open()) {
+            error("Could not write \"" + cc_path + "\"");
+            return false;
+        }
+        emit_aot_program(out, code, subr.value(), key, cache_words);
+        return out.good();
+    }
+
+    // build_executable compiles and links the translation unit at `cc_path` into `out_path`.
+    bool build_executable(std::string const& cxx_path, std::string const& cc_path, std::string const& out_path) {
+        std::stringstream cmd;
+        cmd << '"' << cxx_path << "\" -std=c++20 -O2 " << SSC_INCLUDE_FLAGS
+            << " \"" << cc_path << "\" \"" << SSC_RUNTIME_LIB_PATH << "\""
+            << " -lstdc++ -lm -lpthread -o \"" << out_path << '"';
+        if (std::system(cmd.str().c_str()) != 0) {
+            error("Failed to build \"" + out_path + "\": ran " + cmd.str());
+            return false;
+        }
+        return true;
+    }
+
+}   // namespace ss
+
+int main(int argc, char const* argv[]) {
+    ss::SscArgs args;
+    try {
+        args = ss::parse_cli_args(argc, argv);
+    } catch (ss::SsiError const&) {
+        return 1;
+    }
+
+    // the program is compiled by a VM like the one that runs it: cf `ss::aot_main`
+    ss::Gc gc{ss::GIBIBYTES(1)};
+    if (!ss::CentralLibraryRepository::ensure_init(args.snail_root)) {
+        ss::error("Failed to initialize the Central Library Repository (CLR)");
+        return 2;
+    }
+    ss::VirtualMachine* vm = ss::create_vm(&gc, ss::bind_standard_procedures, ss::VmEngine::Bytecode);
+
+    std::string cc_path = args.emit_cc ? args.out_path : args.out_path + ".cc";
+    if (!ss::emit_program(vm, args.entry_point_path, cc_path)) {
+        return 1;
+    }
+    if (!args.emit_cc && !ss::build_executable(args.cxx_path, cc_path, args.out_path)) {
+        return 1;
+    }
+    return 0;
+}
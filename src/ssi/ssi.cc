@@ -2,37 +2,77 @@
 #include <sstream>
 #include <fstream>
 #include <chrono>
+#include <thread>
+#include <algorithm>
+#include <optional>
+#include <filesystem>
+#include <string_view>
 
 #include "ss-core/allocator.hh"
+#include "ss-core/memory.hh"
 #include "ss-core/feedback.hh"
 #include "ss-core/gc.hh"
 #include "ss-core/cli.hh"
 #include "ss-core/parser.hh"
 #include "ss-core/printing.hh"
+#include "ss-core/port.hh"
 #include "ss-core/vm.hh"
 #include "ss-core/compiler.hh"
 #include "ss-core/library.hh"
+#include "ss-core/vcode-cache.hh"
+#include "ss-core/trace.hh"
 
 namespace ss {
 
     struct SsiArgs {
         std::string entry_point_path;
         std::string snail_root;
+        std::string trace_path;
+        std::string heap_profile_path;
+        std::string install_path;
+        size_t heap_profile_period;
         size_t heap_size_in_bytes;
+        VmEngine engine;
+        size_t fe_worker_count;
         bool debug;
         bool help;
+        bool profile;
+        bool gc_stats;
+        bool gc_no_linearize;
+        bool ssc;
+        bool stream;
+        bool rescan_libs;
+        bool precompile_libs;
     };
 
     SsiArgs parse_cli_args(int argc, char const* argv[]) {
         CliArgsParser parser;
         parser.add_ar0_option_rule("help");
         parser.add_ar0_option_rule("debug");
+        parser.add_ar0_option_rule("profile");
+        parser.add_ar0_option_rule("gc-stats");
+        parser.add_ar0_option_rule("gc-no-linearize");
+        parser.add_ar0_option_rule("ssc");
+        parser.add_ar0_option_rule("stream");
+        parser.add_ar0_option_rule("rescan-libs");
+        parser.add_ar0_option_rule("precompile-libs");
         parser.add_ar1_option_rule("heap-gib");
         parser.add_ar1_option_rule("snail-root");
+        parser.add_ar1_option_rule("engine");
+        parser.add_ar1_option_rule("fe-workers");
+        parser.add_ar1_option_rule("trace");
+        parser.add_ar1_option_rule("heap-profile");
+        parser.add_ar1_option_rule("heap-profile-kib");
+        parser.add_ar1_option_rule("install");
         CliArgs raw = parser.parse(argc, argv);
         
         SsiArgs res; {
-            if (raw.pos.size() != 1) {
+            // only managing libraries, e.g. 'ssi -install ./foo', needs no entry-point:
+            bool is_library_command = (
+                raw.ar1.find("install") != raw.ar1.end() || 
+                raw.ar0.find("precompile-libs") != raw.ar0.end()
+            );
+            if (raw.pos.size() > 1 || (raw.pos.empty() && !is_library_command)) {
                 std::stringstream ss;
                 ss << "Expected exactly 1 positional argument, denoting the entry-point filepath: got " << raw.pos.size();
                 error(ss.str());
@@ -42,8 +82,8 @@ namespace ss {
             // pos args
             //
             
-            // entry_point_path
-            res.entry_point_path = raw.pos[0];
+            // entry_point_path, or empty if there is none to run
+            res.entry_point_path = (raw.pos.empty() ? std::string{} : raw.pos[0]);
 
             // arity-1 (ar1) args
             //
@@ -66,11 +106,61 @@ namespace ss {
                 GIBIBYTES(strtoull(heap_gib_it->second.c_str(), nullptr, 10))
             );
 
+            // engine:
+            auto engine_it = raw.ar1.find("engine");
+            if (engine_it == raw.ar1.end() || engine_it->second == "bytecode") {
+                res.engine = VmEngine::Bytecode;
+            } else if (engine_it->second == "graph") {
+                res.engine = VmEngine::Graph;
+            } else if (engine_it->second == "register") {
+                res.engine = VmEngine::Register;
+            } else {
+                std::stringstream ss;
+                ss << "Unknown engine '" << engine_it->second << "': expected 'bytecode', 'register', or 'graph'";
+                error(ss.str());
+                throw SsiError();
+            }
+
+            // fe_worker_count: the number of threads that parse large files, where 1 parses on the main thread.
+            auto fe_workers_it = raw.ar1.find("fe-workers");
+            res.fe_worker_count = (
+                fe_workers_it == raw.ar1.end() ?
+                std::max(1u, std::thread::hardware_concurrency()) :
+                std::max<size_t>(1, strtoull(fe_workers_it->second.c_str(), nullptr, 10))
+            );
+
+            // trace_path: where to write a trace of each phase, if anywhere, cf `ss-core/trace.hh`
+            auto trace_it = raw.ar1.find("trace");
+            res.trace_path = (trace_it == raw.ar1.end() ? std::string{} : trace_it->second);
+
+            // heap_profile_path: where to write a heap profile at exit, if anywhere, cf `ss-core/heap-profile.hh`
+            // heap_profile_period: the mean bytes allocated between samples.
+            auto heap_profile_it = raw.ar1.find("heap-profile");
+            res.heap_profile_path = (heap_profile_it == raw.ar1.end() ? std::string{} : heap_profile_it->second);
+            auto heap_profile_kib_it = raw.ar1.find("heap-profile-kib");
+            res.heap_profile_period = (
+                heap_profile_kib_it == raw.ar1.end() ?
+                VmHeapProfile::DEFAULT_SAMPLE_PERIOD :
+                std::max<size_t>(1, strtoull(heap_profile_kib_it->second.c_str(), nullptr, 10)) * 1024
+            );
+
+            // install_path: a library directory to install into the snail-root, if any, cf 
+            // `BaseLibraryContainer::install`
+            auto install_it = raw.ar1.find("install");
+            res.install_path = (install_it == raw.ar1.end() ? std::string{} : install_it->second);
+
             // ar0
             //
 
             res.help = (raw.ar0.find("help") != raw.ar0.end());
             res.debug = (raw.ar0.find("debug") != raw.ar0.end());
+            res.profile = (raw.ar0.find("profile") != raw.ar0.end());
+            res.gc_stats = (raw.ar0.find("gc-stats") != raw.ar0.end());
+            res.gc_no_linearize = (raw.ar0.find("gc-no-linearize") != raw.ar0.end());
+            res.ssc = (raw.ar0.find("ssc") != raw.ar0.end());
+            res.stream = (raw.ar0.find("stream") != raw.ar0.end());
+            res.rescan_libs = (raw.ar0.find("rescan-libs") != raw.ar0.end());
+            res.precompile_libs = (raw.ar0.find("precompile-libs") != raw.ar0.end());
 
             // arN: none
             //
@@ -78,93 +168,115 @@ namespace ss {
         return std::move(res);
     }
 
-    void interpret_file(VirtualMachine* vm, std::string file_path) {
-        // Opening the file:
-        std::ifstream f;
-        f.open(file_path);
-        if (!f.is_open()) {
-            std::stringstream error_ss;
-            error_ss
-                << "Failed to load file \"" << file_path << "\" to interpret." << std::endl 
-                << "Does it exist? Is it readable?";
-            error(error_ss.str());
-            return;
-        }
-
-        // parsing all lines into a vector of syntax objects:
-        std::vector<OBJECT> line_code_obj_array;
-        {
-            auto start = std::chrono::steady_clock::now();
-            Parser* p = create_parser(f, file_path, vm_gc_tfe(vm));
-            line_code_obj_array = parse_all_subsequent_lines(p);
-            auto end = std::chrono::steady_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-
-#if CONFIG_DEBUG_MODE
-            {
-                std::stringstream ss;
-                ss << "parsing took " << duration.count();
-                info(ss.str());
+    // SourceMapping unmaps a mapped source file once it goes out of scope.
+    struct SourceMapping {
+        APtr mem;
+        size_t byte_count;
+        ~SourceMapping() {
+            if (mem) {
+                os_unmap_file(mem, byte_count);
             }
-#endif
+        }
+    };
 
-#if CONFIG_DEBUG_MODE
-            {
-                std::stringstream ss;
-                ss << "parsed '" << file_path << "'" << std::endl;
-                for (size_t i = 0; i < line_code_obj_array.size(); i++) {
-                    auto o = line_code_obj_array[i];
-                    ss << "- " << o;
-                    if (i+1 < line_code_obj_array.size()) {
-                        ss << std::endl;
-                    }
-                }
-                info(ss.str());
+    void interpret_file(VirtualMachine* vm, std::string file_path, size_t fe_worker_count, bool use_ssc) {
+        // Mapping the whole file, so that it can be parsed in place and split into chunks of top-level forms:
+        // - files that cannot be mapped (e.g. empty files) are read instead.
+        SourceMapping mapping{nullptr, 0};
+        mapping.mem = os_map_file(file_path.c_str(), &mapping.byte_count);
+        std::string read_source;
+        if (!mapping.mem) {
+            std::ifstream f;
+            f.open(file_path);
+            if (!f.is_open()) {
+                std::stringstream error_ss;
+                error_ss
+                    << "Failed to load file \"" << file_path << "\" to interpret." << std::endl 
+                    << "Does it exist? Is it readable?";
+                error(error_ss.str());
+                return;
             }
-#endif
+            std::stringstream source_ss;
+            source_ss << f.rdbuf();
+            read_source = source_ss.str();
         }
+        std::string_view source = (
+            mapping.mem ?
+            std::string_view{reinterpret_cast<char const*>(mapping.mem), mapping.byte_count} :
+            std::string_view{read_source}
+        );
 
-        // compiling the program into VM representation:
+        // parsing, scoping (performing macro expansion), and compiling the program into VM representation:
         // c.f. §3.4.2 (Translation) on p.56 (pos 66/190)
+        // - large files are parsed on `fe_worker_count` threads, while the chunks already parsed are expanded and 
+        //   compiled on this thread, in source order.
         {
+            TraceSpan span{"front-end", file_path};
             auto start = std::chrono::steady_clock::now();
             ss::Compiler& compiler = *vm_compiler(vm);
             ss::VCode* code = compiler.code();
-            try {
-                // scoping, performing macro expansion:
-                auto expanded_line_code_obj_array = macroexpand_syntax(
-                    *vm_gc_tfe(vm),
-                    code->def_tab(),
-                    code->pproc_tab(),            
-                    std::move(line_code_obj_array)
-                );
 
+            // reusing the code cached for this source, if any: cf `vcode-cache.hh`
+            std::string ssc_path = std::filesystem::path{file_path}.replace_extension(".ssc").string();
+            uint64_t ssc_key = vcode_cache_key(source, file_path);
+            std::optional<VSubr> cached_subr = (
+                use_ssc ?
+                load_vcode_cache(ssc_path, ssc_key, *code, vm_gc_tfe(vm)) :
+                std::optional<VSubr>{}
+            );
+            if (cached_subr.has_value()) {
+                code->enqueue_main_subr(file_path, std::move(cached_subr.value()));
+            } else {
+                GDefID first_gdef_id = code->count_globals();
+                VSubr subr{file_path, {}, {}};
+                try {
+                    parse_all_lines_in_parallel(
+                        source, file_path, vm_gc_tfe(vm), fe_worker_count,
+                        [&] (std::vector<OBJECT> line_code_obj_array) {
 #if CONFIG_DEBUG_MODE
-                std::stringstream ss;
-                ss << "macro expansion complete";
-                info(ss.str());
+                            {
+                                std::stringstream ss;
+                                ss << "parsed '" << file_path << "'" << std::endl;
+                                for (size_t i = 0; i < line_code_obj_array.size(); i++) {
+                                    auto o = line_code_obj_array[i];
+                                    ss << "- " << o;
+                                    if (i+1 < line_code_obj_array.size()) {
+                                        ss << std::endl;
+                                    }
+                                }
+                                info(ss.str());
+                            }
 #endif
-
-                VSubr subr = compiler.compile_subr(
-                    file_path, 
-                    std::move(expanded_line_code_obj_array)
-                );
+                            auto expanded_line_code_obj_array = macroexpand_syntax(
+                                *vm_gc_tfe(vm),
+                                code->def_tab(),
+                                code->pproc_tab(),
+                                std::move(line_code_obj_array)
+                            );
+                            compiler.extend_subr(subr, std::move(expanded_line_code_obj_array));
+                        }
+                    );
+                } catch (SsiError const& ssi_error) {
+                    return;
+                }
+                if (use_ssc && !save_vcode_cache(ssc_path, ssc_key, *code, subr, first_gdef_id)) {
+                    warning("Could not write the compiled code cache \"" + ssc_path + "\"");
+                }
                 code->enqueue_main_subr(file_path, std::move(subr));
-            } catch (SsiError const& ssi_error) {
-                return;
             }
             auto end = std::chrono::steady_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 
 #if CONFIG_DEBUG_MODE
             std::stringstream ss;
-            ss << "compile and lib-loading took " << duration.count();
+            ss << "parsing, compile, and lib-loading took " << duration.count();
             info(ss.str());
 #endif
         }
         
         // Executing:
         {
+            TraceSpan span{"run", file_path};
             auto start = std::chrono::steady_clock::now();
             try {
                 bool print_each_line = false;
@@ -186,12 +298,37 @@ namespace ss {
     #if CONFIG_DUMP_VM_STATE_AFTER_EXECUTION
         {
             info("Begin Dump:");
+            flush_standard_ports();
             dump_vm(vm, std::cout);
             info("End Dump");
         }
     #endif
     }
 
+    // interpret_stream runs each top-level form of a file as soon as it has been read, e.g. from a pipe such as
+    // '/dev/stdin', so that input of any length runs in bounded memory: cf `vm_stream_lines`.
+    void interpret_stream(VirtualMachine* vm, std::string file_path) {
+        std::ifstream f;
+        f.open(file_path);
+        if (!f.is_open()) {
+            std::stringstream error_ss;
+            error_ss
+                << "Failed to load file \"" << file_path << "\" to interpret." << std::endl 
+                << "Does it exist? Is it readable?";
+            error(error_ss.str());
+            return;
+        }
+        try {
+            vm_begin_streaming(vm);
+            parse_each_line_from_stream(f, file_path, vm_gc_tfe(vm), [vm] (std::vector<OBJECT> line_code_obj_array) {
+                bool print_each_line = false;
+                vm_stream_lines(vm, std::move(line_code_obj_array), print_each_line);
+            });
+        } catch (SsiError const& ssi_error) {
+            return;
+        }
+    }
+
 }   // namespace ss
 
 int main(int argc, char const* argv[]) {
@@ -213,7 +350,18 @@ int main(int argc, char const* argv[]) {
             << argv[0] << std::endl
             << "    " << args.entry_point_path << std::endl
             << "    -snail-root " << args.snail_root << std::endl
-            << "    -heap-gib " << args.heap_size_in_bytes / ss::GIBIBYTES(1) << std::endl;
+            << "    -heap-gib " << args.heap_size_in_bytes / ss::GIBIBYTES(1) << std::endl
+            << "    -engine " << ss::vm_engine_name(args.engine) << std::endl
+            << "    -fe-workers " << args.fe_worker_count << std::endl;
+        if (!args.trace_path.empty()) {
+            std::cerr
+                << "    -trace " << args.trace_path << std::endl;
+        }
+        if (!args.heap_profile_path.empty()) {
+            std::cerr
+                << "    -heap-profile " << args.heap_profile_path << std::endl
+                << "    -heap-profile-kib " << args.heap_profile_period / 1024 << std::endl;
+        }
         if (args.debug) {
             std::cerr
                 << "    -debug" << std::endl;
@@ -222,18 +370,55 @@ int main(int argc, char const* argv[]) {
             std::cerr
                 << "    -help" << std::endl;
         }
+        if (args.profile) {
+            std::cerr
+                << "    -profile" << std::endl;
+        }
+        if (args.gc_stats) {
+            std::cerr
+                << "    -gc-stats" << std::endl;
+        }
+        if (args.gc_no_linearize) {
+            std::cerr
+                << "    -gc-no-linearize" << std::endl;
+        }
+        if (args.ssc) {
+            std::cerr
+                << "    -ssc" << std::endl;
+        }
+        if (args.stream) {
+            std::cerr
+                << "    -stream" << std::endl;
+        }
+        if (args.rescan_libs) {
+            std::cerr
+                << "    -rescan-libs" << std::endl;
+        }
+        if (!args.install_path.empty()) {
+            std::cerr
+                << "    -install " << args.install_path << std::endl;
+        }
+        if (args.precompile_libs) {
+            std::cerr
+                << "    -precompile-libs" << std::endl;
+        }
     }
 
-    // Initializing the GC, may be shared among multiple VMs
-    size_t constexpr max_heap_size_in_bytes = ss::GIBIBYTES(4);
-    size_t constexpr max_heap_size_in_pages = max_heap_size_in_bytes >> CONFIG_TCMALLOC_PAGE_SHIFT;
-    ss::Gc gc {
-        reinterpret_cast<ss::APtr>(calloc(max_heap_size_in_pages, ss::gc::PAGE_SIZE_IN_BYTES)), 
-        max_heap_size_in_bytes
-    };
+    // Tracing from here on, so that library discovery is traced too:
+    if (!args.trace_path.empty()) {
+        ss::enable_tracing();
+    }
 
-    // Initializing the central library repository at the snail-root specified:
-    bool clr_init_ok = ss::CentralLibraryRepository::ensure_init(args.snail_root);
+    // Initializing the GC, may be shared among multiple VMs: '-heap-gib' is its initial size, and it grows
+    // on demand.
+    ss::Gc gc{args.heap_size_in_bytes};
+    if (args.gc_no_linearize) {
+        gc.set_linearizes_lists(false);
+    }
+
+    // Initializing the central library repository at the snail-root specified: its library index is only
+    // rebuilt from the 'lib' directory if '-rescan-libs' is passed.
+    bool clr_init_ok = ss::CentralLibraryRepository::ensure_init(args.snail_root, args.rescan_libs);
     if (!clr_init_ok) {
         std::stringstream error_ss;
         error_ss
@@ -242,10 +427,68 @@ int main(int argc, char const* argv[]) {
         return 2;
     }
 
+    // Installing and precompiling libraries, before running the entry-point, if there is one:
+    ss::CentralLibraryRepository* clr = ss::CentralLibraryRepository::instance();
+    if (!args.install_path.empty()) {
+        std::filesystem::path src_path = std::filesystem::absolute(args.install_path).lexically_normal();
+        if (!src_path.has_filename()) {
+            // e.g. for './foo/'
+            src_path = src_path.parent_path();
+        }
+        if (!std::filesystem::is_directory(src_path)) {
+            ss::error("Cannot install \"" + src_path.string() + "\": expected a library directory");
+            return 3;
+        }
+        bool install_ok;
+        try {
+            install_ok = clr->install(src_path, ss::BaseLibraryContainer::extract_key_from_path(src_path));
+        } catch (ss::SsiError const&) {
+            install_ok = false;
+        }
+        if (!install_ok) {
+            ss::error("Failed to install \"" + src_path.string() + "\": see above error messages");
+            return 3;
+        }
+    }
+    if (args.precompile_libs && !clr->precompile(args.fe_worker_count)) {
+        ss::error("Failed to precompile every library: see above error messages");
+        return 3;
+    }
+    if (args.entry_point_path.empty()) {
+        return 0;
+    }
+
     // Instantiating, programming, and running a VM:
     // TODO: switch to JIT
-    ss::VirtualMachine* vm = ss::create_vm(&gc);
-    ss::interpret_file(vm, argv[1]);
+    ss::VirtualMachine* vm = ss::create_vm(&gc, ss::bind_standard_procedures, args.engine);
+    if (args.profile) {
+        ss::vm_enable_profiler(vm);
+    }
+    if (!args.heap_profile_path.empty()) {
+        ss::vm_enable_heap_profiler(vm, args.heap_profile_period);
+    }
+    if (args.stream) {
+        ss::interpret_stream(vm, args.entry_point_path);
+    } else {
+        ss::interpret_file(vm, args.entry_point_path, args.fe_worker_count, args.ssc);
+    }
+    // the program's output is written out before any reports on 'stderr':
+    ss::flush_standard_ports();
+    if (args.profile) {
+        ss::vm_print_profile(vm, std::cerr);
+    }
+    if (args.gc_stats) {
+        gc.stats().print(std::cerr);
+    }
+    if (!args.trace_path.empty() && !ss::write_trace_file(args.trace_path)) {
+        ss::warning("Could not write the trace \"" + args.trace_path + "\"");
+    }
+    if (!args.heap_profile_path.empty()) {
+        std::ofstream heap_profile_out{args.heap_profile_path, std::ios::binary | std::ios::trunc};
+        if (!ss::vm_write_heap_profile(vm, heap_profile_out)) {
+            ss::warning("Could not write the heap profile \"" + args.heap_profile_path + "\"");
+        }
+    }
 
     // all OK
     return 0;
@@ -0,0 +1,620 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "ss-core/object.hh"
+#include "ss-core/gc.hh"
+#include "ss-core/vm.hh"
+#include "ss-core/parser.hh"
+#include "ss-core/compiler.hh"
+#include "ss-core/intern.hh"
+
+///
+/// EVAL TESTS
+/// - each source is streamed to a fresh VM of each engine, as `ssi -stream` would, cf `vm_stream_lines`.
+///
+
+static ss::VmEngine const kEngines[] = {ss::VmEngine::Graph, ss::VmEngine::Bytecode, ss::VmEngine::Register};
+
+// eval_lines runs each line of `source`, returning the last one's value as written.
+static std::string eval_lines(ss::VirtualMachine* vm, std::string const& source) {
+    ss::Parser* p = ss::create_parser(std::string_view{source}, "<test>", ss::vm_gc_tfe(vm));
+    std::vector<ss::OBJECT> lines = ss::parse_all_subsequent_lines(p);
+    ss::dispose_parser(p);
+    std::stringstream out;
+    out << ss::vm_stream_lines(vm, std::move(lines), false);
+    return out.str();
+}
+
+// find_local returns the last local named `name`, e.g. to check whether it was boxed.
+static ss::Definition const* find_local(ss::VirtualMachine* vm, std::string_view name) {
+    ss::DefTable const& def_tab = ss::vm_compiler(vm)->code()->def_tab();
+    for (size_t i = def_tab.count_locals(); i > 0; i--) {
+        if (ss::interned_string(def_tab.local(i-1).name()) == name) {
+            return &def_tab.local(i-1);
+        }
+    }
+    return nullptr;
+}
+
+// count_exps_of_kind counts the VmExps of `kind` in every unit, e.g. to check what a source was compiled into.
+static size_t count_exps_of_kind(ss::VirtualMachine* vm, ss::VmExpKind kind) {
+    ss::VCode& code = *ss::vm_compiler(vm)->code();
+    size_t res = 0;
+    size_t unit_count = 0;
+    for (ss::VCodeUnitID unit = 0; unit_count < code.count_units(); unit++) {
+        if (!code.has_unit(unit)) {
+            continue;
+        }
+        unit_count++;
+        for (ss::VmExpID x = ss::vmx_id(unit, 0); x < code.end_exp_id(unit); x++) {
+            res += code[x].kind == kind;
+        }
+    }
+    return res;
+}
+
+// EvalTest runs each test on a VM of its own for each engine: cf `each_engine`
+class EvalTest: public testing::Test {
+protected:
+    template <typename F>
+    void each_engine(F&& f) {
+        for (ss::VmEngine engine: kEngines) {
+            SCOPED_TRACE(ss::vm_engine_name(engine));
+            ss::Gc gc{size_t{64} << 20};
+            ss::VirtualMachine* vm = ss::create_vm(&gc, ss::bind_standard_procedures, engine);
+            ss::vm_begin_streaming(vm);
+            f(vm);
+            ss::destroy_vm(vm);
+        }
+    }
+    void expect_eval(std::string const& source, std::string const& expected) {
+        each_engine([&] (ss::VirtualMachine* vm) { EXPECT_EQ(eval_lines(vm, source), expected); });
+    }
+};
+
+//
+// Internal definitions: in slots reserved as the body is entered, cf `Compiler::LocalFrame`
+//
+
+TEST_F(EvalTest, InternalDefineIsReferred) {
+    expect_eval("((lambda (x) (begin (define y 7) y)) 1)", "7");
+    expect_eval("((lambda () (begin (define a 1) (define b 2) (define c (p/invoke + a b)) c)))", "3");
+}
+
+TEST_F(EvalTest, InternalDefineIsMutated) {
+    expect_eval("((lambda (x) (begin (define y 7) (set! y (p/invoke + y x)) y)) 1)", "8");
+}
+
+TEST_F(EvalTest, InternalDefineIsCapturedAndMutated) {
+    expect_eval("((lambda (x) (begin (define y 7) (define f (lambda () y)) (set! y 9) (f))) 1)", "9");
+    expect_eval(
+        "((lambda (x) (begin (define y x) (define g (lambda () (begin (set! y (p/invoke + y 1)) y))) (g) (g))) 10)", 
+        "12"
+    );
+    // a procedure defined in a body calls its parent, which reserves its slots again:
+    expect_eval(
+        "(define ev? (lambda (n) (begin "
+        "   (define od? (lambda (k) (if (p/invoke = k 0) #f (ev? (p/invoke - k 1))))) "
+        "   (if (p/invoke = n 0) #t (od? (p/invoke - n 1)))))) "
+        "(ev? 10)",
+        "#t"
+    );
+}
+
+TEST_F(EvalTest, InternalDefineInTailCallingLoop) {
+    // the loop's frame holds its definitions, so it is shifted over, rather than overwritten in place:
+    expect_eval(
+        "(define loop (lambda (i acc) (begin "
+        "   (define j (p/invoke - i 1)) "
+        "   (if (p/invoke = i 0) acc (loop j (p/invoke + acc i)))))) "
+        "(loop 100000 0)",
+        "5000050000"
+    );
+}
+
+//
+// Scopes with many names: past 16, each name's slot is found through a hash index, cf `OrderedSymbolSet`
+//
+
+TEST_F(EvalTest, ManyLocalsKeepTheirSlots) {
+    // each define's value is its index, so that any slot mixed up shows in the list:
+    std::string defines;
+    std::string listed = "'()";
+    for (int i = 0; i < 40; i++) {
+        defines += "(define v" + std::to_string(i) + " " + std::to_string(i) + ") ";
+        if (i % 8 == 0 || i == 39) {
+            listed = "(p/invoke cons v" + std::to_string(i) + " " + listed + ")";
+        }
+    }
+    expect_eval("((lambda () (begin " + defines + listed + ")))", "(39 32 24 16 8 0)");
+}
+
+TEST_F(EvalTest, ManyFreeVariablesKeepTheirSlots) {
+    // a closure capturing each arg of its parent, in the reverse of their order:
+    std::string params;
+    std::string args;
+    std::string listed = "'()";
+    for (int i = 0; i < 24; i++) {
+        params += " a" + std::to_string(i);
+        args += " " + std::to_string(i * 10);
+        listed = "(p/invoke cons a" + std::to_string(i) + " " + listed + ")";
+    }
+    expect_eval(
+        "((lambda (" + params + ") ((lambda () " + listed + "))) " + args + ")",
+        "(230 220 210 200 190 180 170 160 150 140 130 120 110 100 90 80 70 60 50 40 30 20 10 0)"
+    );
+}
+
+//
+// Arithmetic folds over any number of args, cf `bind_standard_arithmetic_procedure`
+//
+
+TEST_F(EvalTest, ArithmeticWithNoArgs) {
+    expect_eval("(p/invoke +)", "0");
+    expect_eval("(p/invoke *)", "1");
+}
+
+TEST_F(EvalTest, ArithmeticWithOneArg) {
+    expect_eval("(p/invoke + 5)", "5");
+    expect_eval("(p/invoke * 5)", "5");
+    // '-' negates, and '/' takes the reciprocal:
+    expect_eval("(p/invoke - 5)", "-5");
+    expect_eval("(p/invoke / 4.0)", "0.25");
+}
+
+TEST_F(EvalTest, ArithmeticWithManyArgs) {
+    // two args are lowered to primitives, more are folded left-to-right:
+    expect_eval("(p/invoke + 1 2)", "3");
+    expect_eval("(p/invoke + 1 2 3 4)", "10");
+    expect_eval("(p/invoke - 10 1 2 3)", "4");
+    expect_eval("(p/invoke * 2 3 4)", "24");
+    expect_eval("(p/invoke / 100 5 2)", "10");
+}
+
+TEST_F(EvalTest, ArithmeticWithMixedArgs) {
+    // fixnums are promoted once any arg is a float:
+    expect_eval("(p/invoke + 1 2.5)", "3.5");
+    expect_eval("(p/invoke + 1 2 0.5)", "3.5");
+    expect_eval("(p/invoke - 1.5 1 1)", "-0.5");
+    expect_eval("(p/invoke * 2 1.5 2)", "6");
+    expect_eval("(p/invoke / 7 2)", "3");
+    expect_eval("(p/invoke / 7 2.0)", "3.5");
+}
+
+TEST_F(EvalTest, ArithmeticIsBoundAsFunctionPointers) {
+    // called through PInvoke without an `ArgView`, cf `PlatformProcFnV`:
+    each_engine([&] (ss::VirtualMachine* vm) {
+        ss::VCode* code = ss::vm_compiler(vm)->code();
+        for (char const* name: {"+", "-", "*", "/", "%", "min", "max", "=", "<", "<=", ">", ">="}) {
+            SCOPED_TRACE(name);
+            ss::PlatformProcID id = code->lookup_platform_proc(ss::intern(name));
+            EXPECT_EQ(code->pproc_tab().fn(id).kind, ss::PlatformProcFnKind::Variadic);
+            EXPECT_EQ(code->pproc_tab().metadata(id).arity, -1);
+        }
+    });
+    expect_eval("(p/invoke < 1 2 3)", "#t");
+    expect_eval("(p/invoke <= 1 1 0.5)", "#f");
+    expect_eval("(p/invoke = 2 2.0 2)", "#t");
+}
+
+TEST_F(EvalTest, PrimitivesAreInlinedWithFallbacks) {
+    // a PInvoke with the primitive's arity is compiled into its instruction, cf `VCode::set_platform_proc_prim`:
+    each_engine([] (ss::VirtualMachine* vm) {
+        ss::VCode* code = ss::vm_compiler(vm)->code();
+        EXPECT_EQ(code->platform_proc_prim(code->lookup_platform_proc(ss::intern("+"))), ss::VmExpKind::PrimAdd);
+        size_t add_count = count_exps_of_kind(vm, ss::VmExpKind::PrimAdd);
+        size_t car_count = count_exps_of_kind(vm, ss::VmExpKind::PrimCar);
+        EXPECT_EQ(eval_lines(vm, "(define add (lambda (a b) (p/invoke + a b))) (add 1 2)"), "3");
+        EXPECT_EQ(count_exps_of_kind(vm, ss::VmExpKind::PrimAdd), add_count + 1);
+        EXPECT_EQ(eval_lines(vm, "(define first (lambda (p) (p/invoke car p))) (first (p/invoke cons 4 5))"), "4");
+        EXPECT_EQ(count_exps_of_kind(vm, ss::VmExpKind::PrimCar), car_count + 1);
+
+        // off the fixnum fast-path, the platform procedure is called:
+        EXPECT_EQ(eval_lines(vm, "(add 1 2.5)"), "3.5");
+        EXPECT_EQ(eval_lines(vm, "(add 0.25 0.5)"), "0.75");
+        EXPECT_THROW(eval_lines(vm, "(add 1 'x)"), ss::SsiError);
+        EXPECT_THROW(eval_lines(vm, "(first 5)"), ss::SsiError);
+    });
+    expect_eval("(p/invoke - 7 10)", "-3");
+    expect_eval("(p/invoke * 6 7)", "42");
+    expect_eval("(p/invoke / 7 2.0)", "3.5");
+    expect_eval("(p/invoke % 7 3)", "1");
+    expect_eval("(p/invoke = 2 2.0)", "#t");
+    expect_eval("(p/invoke < 1 0.5)", "#f");
+    expect_eval("(p/invoke > 2 1)", "#t");
+    expect_eval("(p/invoke cdr (p/invoke cons 1 2))", "2");
+    expect_eval("(p/invoke null? (p/invoke cdr (p/invoke cons 1 '())))", "#t");
+    expect_eval("(p/invoke pair? 5)", "#f");
+    expect_eval("(p/invoke pair? (p/invoke cons 1 2))", "#t");
+}
+
+TEST_F(EvalTest, ArithmeticArityErrors) {
+    for (char const* source: {"(p/invoke -)", "(p/invoke /)", "(p/invoke % 1)"}) {
+        SCOPED_TRACE(source);
+        each_engine([&] (ss::VirtualMachine* vm) {
+            EXPECT_THROW(eval_lines(vm, source), ss::SsiError);
+        });
+    }
+}
+
+//
+// Globals: assigned only by their definitions
+//
+
+TEST_F(EvalTest, QuickenedGlobalIsDeoptimizedByItsDefinition) {
+    // a reference to a global is quickened into a constant of its value, so one run before the global's 
+    // definition must be undone by it: cf `VBytecode::quicken_global`.
+    each_engine([] (ss::VirtualMachine* vm) {
+        EXPECT_EQ(eval_lines(vm, 
+            "(define g ((lambda (get) (p/invoke cons (get) get)) (lambda () g))) "
+            "(p/invoke pair? ((p/invoke cdr g)))"
+        ), "#t");
+        // 'set!' of a global is rejected, so its definition is the only assignment a global sees:
+        EXPECT_THROW(eval_lines(vm, "(set! g 3)"), ss::SsiError);
+        EXPECT_EQ(eval_lines(vm, "(p/invoke pair? ((p/invoke cdr g)))"), "#t");
+    });
+}
+
+//
+// call/cc in tail position captures our caller's continuation, without pushing a frame of its own
+//
+
+TEST_F(EvalTest, TailCallCcReturns) {
+    expect_eval("((lambda (i) (call/cc (lambda (k) i))) 5)", "5");
+    expect_eval("(p/invoke + 1 ((lambda (i) (call/cc (lambda (k) i))) 5))", "6");
+}
+
+TEST_F(EvalTest, TailCallCcEscapes) {
+    expect_eval("((lambda (i) (call/cc (lambda (k) (k i)))) 5)", "5");
+    expect_eval("(p/invoke + 1 ((lambda (i j) (call/cc (lambda (k) (begin (k i) j)))) 5 7))", "6");
+}
+
+TEST_F(EvalTest, TailCallCcInLoop) {
+    // each iteration replaces the last, so the stack does not grow:
+    expect_eval(
+        "(define loop (lambda (i) (if (p/invoke = i 0) 'done (call/cc (lambda (k) (loop (p/invoke - i 1))))))) "
+        "(loop 100000)",
+        "done"
+    );
+}
+
+//
+// Profiling: closure calls are counted by body, and named by where each was written, cf `vm_enable_profiler`
+//
+
+// profile_counts maps each row's name to its count in the `section` of a `vm_print_profile` report.
+static std::map<std::string, uint64_t> profile_counts(std::string const& report, std::string_view section) {
+    std::map<std::string, uint64_t> res;
+    std::stringstream in{report};
+    bool in_section = false;
+    for (std::string line; std::getline(in, line);) {
+        if (line.starts_with("=== PROFILE: ")) {
+            in_section = line.find(section) != std::string::npos;
+            continue;
+        }
+        std::stringstream row{line};
+        uint64_t count;
+        if (in_section && row >> count) {
+            // the name follows the last column, after two spaces:
+            res[line.substr(line.rfind("  ") + 2)] = count;
+        }
+    }
+    return res;
+}
+
+TEST_F(EvalTest, ProfilerCountsCallsByClosureLoc) {
+    each_engine([] (ss::VirtualMachine* vm) {
+        ss::vm_enable_profiler(vm);
+        EXPECT_EQ(eval_lines(vm, 
+            "(define f (lambda (x) x))\n"
+            "  (define g (lambda (x) (f x)))\n"
+            "(f 1) (f 2) (g 3) (g 4) (g (p/invoke + 1 2 2))"
+        ), "5");
+        std::stringstream report;
+        ss::vm_print_profile(vm, report);
+        SCOPED_TRACE(report.str());
+
+        std::map<std::string, uint64_t> closures = profile_counts(report.str(), "closures");
+        EXPECT_EQ(closures.size(), 2);
+        EXPECT_EQ(closures["lambda @ <test>:1:11-25"], 5);
+        EXPECT_EQ(closures["lambda @ <test>:2:13-31"], 3);
+        // only the call with more args than the primitive's is a PInvoke:
+        std::map<std::string, uint64_t> pprocs = profile_counts(report.str(), "platform procedures");
+        EXPECT_EQ(pprocs.size(), 1);
+        EXPECT_EQ(pprocs["+"], 1);
+    });
+}
+
+//
+// Selective boxing: a mutated local is boxed only if a closure or continuation may capture it, cf `Definition::is_boxed`
+//
+
+TEST_F(EvalTest, MutatedLocalIsUnboxed) {
+    each_engine([] (ss::VirtualMachine* vm) {
+        EXPECT_EQ(eval_lines(vm, "((lambda (mut-only) (begin (set! mut-only (p/invoke + mut-only 1)) mut-only)) 1)"), "2");
+        ss::Definition const* def = find_local(vm, "mut-only");
+        ASSERT_NE(def, nullptr);
+        EXPECT_TRUE(def->is_mutated());
+        EXPECT_FALSE(def->is_captured());
+        EXPECT_FALSE(def->is_boxed());
+    });
+}
+
+TEST_F(EvalTest, CapturedLocalIsUnboxed) {
+    each_engine([] (ss::VirtualMachine* vm) {
+        EXPECT_EQ(eval_lines(vm, "(define mk (lambda (cap-only) (lambda () cap-only))) ((mk 5))"), "5");
+        ss::Definition const* def = find_local(vm, "cap-only");
+        ASSERT_NE(def, nullptr);
+        EXPECT_FALSE(def->is_mutated());
+        EXPECT_TRUE(def->is_captured());
+        EXPECT_FALSE(def->is_boxed());
+    });
+}
+
+TEST_F(EvalTest, MutatedAndCapturedLocalIsBoxed) {
+    each_engine([] (ss::VirtualMachine* vm) {
+        EXPECT_EQ(eval_lines(vm, 
+            "(define counter (lambda (both) (lambda () (begin (set! both (p/invoke + both 1)) both)))) "
+            "(define c (counter 0)) "
+            "(c) "
+            "(c)"
+        ), "2");
+        ss::Definition const* def = find_local(vm, "both");
+        ASSERT_NE(def, nullptr);
+        EXPECT_TRUE(def->is_boxed());
+        // each closure has a box of its own:
+        EXPECT_EQ(eval_lines(vm, "(define d (counter 10)) (d) (c)"), "3");
+    });
+}
+
+TEST_F(EvalTest, MutatedLocalInTailCallingFrameIsUnboxed) {
+    each_engine([] (ss::VirtualMachine* vm) {
+        EXPECT_EQ(eval_lines(vm, 
+            "(define id (lambda (x) x)) "
+            "((lambda (tail-only) (begin (set! tail-only (p/invoke + tail-only 1)) (id tail-only))) 1)"
+        ), "2");
+        ss::Definition const* def = find_local(vm, "tail-only");
+        ASSERT_NE(def, nullptr);
+        EXPECT_FALSE(def->is_frame_capturable());
+        EXPECT_FALSE(def->is_boxed());
+    });
+}
+
+TEST_F(EvalTest, MutatedLocalSurvivesReenteredContinuation) {
+    // re-entering 'kk' restores the stack it captured, so an unboxed 'cnt' would be reset to 0 each time:
+    each_engine([] (ss::VirtualMachine* vm) {
+        EXPECT_EQ(eval_lines(vm, 
+            "(define reenter ((lambda (cnt kk) (begin "
+            "   (p/invoke displayln (p/invoke + 100 (call/cc (lambda (k) (begin (set! kk k) 0))))) "
+            "   (set! cnt (p/invoke + cnt 1)) "
+            "   (if (p/invoke < cnt 3) (kk cnt) cnt))) 0 #f)) "
+            "reenter"
+        ), "3");
+        ss::Definition const* def = find_local(vm, "cnt");
+        ASSERT_NE(def, nullptr);
+        EXPECT_FALSE(def->is_captured());
+        EXPECT_TRUE(def->is_frame_capturable());
+        EXPECT_TRUE(def->is_boxed());
+    });
+}
+
+//
+// Snapshots: a forked child runs on a copy of the VM, cf `vm_fork`
+//
+
+#ifndef _WIN32
+TEST_F(EvalTest, ForkedChildRunsInIsolation) {
+    char const* const parallel_sum = 
+        "(p/invoke parallel-fold add 0 (p/invoke parallel-vector-map (lambda (x) (p/invoke + x 1)) "
+        "   (p/invoke make-s64vector 3 2)))";
+    each_engine([&] (ss::VirtualMachine* vm) {
+        // starting the workers before forking, so that the child must start its own:
+        eval_lines(vm, "(define g 40) (define l (p/invoke cons 1 2)) (define add (lambda (a b) (p/invoke + a b)))");
+        ASSERT_EQ(eval_lines(vm, parallel_sum), "9");
+
+        int64_t pid = ss::vm_fork(vm);
+        ASSERT_GE(pid, 0);
+        if (pid == 0) {
+            // the child only reports through its exit status: 40+2 + 10 + 9
+            int status = 255;
+            try {
+                std::string res = eval_lines(vm, 
+                    std::string{"(define h (p/invoke + g 2)) (p/invoke set-car! l 10) "} +
+                    "(p/invoke + h (p/invoke car l) " + parallel_sum + ")"
+                );
+                status = std::stoi(res);
+            } catch (...) {}
+            _exit(status);
+        }
+        int status = 0;
+        ASSERT_EQ(waitpid(static_cast<pid_t>(pid), &status, 0), pid);
+        ASSERT_TRUE(WIFEXITED(status));
+        EXPECT_EQ(WEXITSTATUS(status), 61);
+
+        // the child's definitions and writes to the heap are its own, and the parent's workers start again:
+        EXPECT_EQ(eval_lines(vm, "(define h 5) (p/invoke + g h)"), "45");
+        EXPECT_EQ(eval_lines(vm, "(p/invoke car l)"), "1");
+        EXPECT_EQ(eval_lines(vm, parallel_sum), "9");
+    });
+}
+#endif
+
+//
+// Parallel bulk operations: chunks run on VThreads, whatever the worker count, cf `vm_parallel_vector_map`
+//
+
+static size_t const kWorkerCounts[] = {1, 2, 3, 8};
+
+// enough items for several chunks per worker, cf `VmBulkTask::MIN_CHUNK_SIZE`, and serial equivalents to check them:
+static char const* const kBulkDefinitions =
+    "(define n 5000) "
+    "(define xs (p/invoke make-s64vector n)) "
+    "(define fill (lambda (i) (if (p/invoke = i n) xs "
+    "   (begin (p/invoke s64vector-set! xs i (p/invoke - (p/invoke * i 7) 1000)) (fill (p/invoke + i 1)))))) "
+    "(fill 0) "
+    "(define f (lambda (x) (p/invoke + (p/invoke * x x) 1))) "
+    "(define add (lambda (a b) (p/invoke + a b))) "
+    "(define serial-sum (lambda (i acc) (if (p/invoke = i n) acc "
+    "   (serial-sum (p/invoke + i 1) (p/invoke + acc (f (p/invoke s64vector-ref xs i))))))) "
+    "(define first-mismatch (lambda (ys i) (if (p/invoke = i n) -1 "
+    "   (if (p/invoke = (p/invoke vector-ref ys i) (f (p/invoke s64vector-ref xs i))) (first-mismatch ys (p/invoke + i 1)) i)))) "
+    // joins adjacent ranges, so that only an in-order fold spans them all:
+    "(define join-ranges (lambda (a b) (if (p/invoke null? a) b (if (p/invoke null? b) a "
+    "   (if (p/invoke = (p/invoke + (p/invoke cdr a) 1) (p/invoke car b)) (p/invoke cons (p/invoke car a) (p/invoke cdr b)) 'gap)))))";
+
+TEST_F(EvalTest, ParallelOpsMatchSerialAcrossWorkerCounts) {
+    for (size_t worker_count: kWorkerCounts) {
+        SCOPED_TRACE(worker_count);
+        each_engine([&] (ss::VirtualMachine* vm) {
+            ss::vm_set_worker_count(vm, worker_count);
+            eval_lines(vm, kBulkDefinitions);
+            EXPECT_EQ(eval_lines(vm, "(first-mismatch (p/invoke parallel-vector-map f xs) 0)"), "-1");
+            EXPECT_EQ(
+                eval_lines(vm, "(p/invoke parallel-fold add 0 (p/invoke parallel-vector-map f xs))"),
+                eval_lines(vm, "(serial-sum 0 0)")
+            );
+            EXPECT_EQ(
+                eval_lines(vm, 
+                    "(p/invoke parallel-fold join-ranges '() "
+                    "   (p/invoke parallel-vector-map (lambda (x) (p/invoke cons x x)) "
+                    "       (p/invoke parallel-vector-map (lambda (x) (p/invoke / (p/invoke + x 1000) 7)) xs)))"
+                ),
+                "(0 . 4999)"
+            );
+            // without any items, the init is returned at once:
+            EXPECT_EQ(eval_lines(vm, "(p/invoke parallel-fold add 42 (p/invoke make-s64vector 0))"), "42");
+        });
+    }
+}
+
+TEST_F(EvalTest, ParallelOpsRaiseErrorsInChunks) {
+    for (size_t worker_count: kWorkerCounts) {
+        SCOPED_TRACE(worker_count);
+        each_engine([&] (ss::VirtualMachine* vm) {
+            ss::vm_set_worker_count(vm, worker_count);
+            eval_lines(vm, kBulkDefinitions);
+            // an item deep inside a later chunk fails: 
+            EXPECT_THROW(
+                eval_lines(vm, "(p/invoke parallel-vector-map (lambda (x) (if (p/invoke = x 27000) (p/invoke car x) x)) xs)"),
+                ss::SsiError
+            );
+            EXPECT_THROW(
+                eval_lines(vm, "(p/invoke parallel-fold (lambda (a b) (if (p/invoke = b 27000) (p/invoke car b) a)) 0 xs)"),
+                ss::SsiError
+            );
+            // and the failed chunks' VThreads do not keep later operations waiting:
+            EXPECT_EQ(eval_lines(vm, "(p/invoke parallel-fold add 0 xs)"), "82482500");
+        });
+    }
+}
+
+TEST_F(EvalTest, JoinedVThreadsAreReused) {
+    // once joined, a VThread and its ID are reused, so spawning and joining in a loop keeps the table bounded:
+    for (size_t worker_count: kWorkerCounts) {
+        SCOPED_TRACE(worker_count);
+        each_engine([&] (ss::VirtualMachine* vm) {
+            ss::vm_set_worker_count(vm, worker_count);
+            eval_lines(vm, 
+                "(define spawn-join (lambda (i acc) (if (p/invoke = i 0) acc "
+                "   (spawn-join (p/invoke - i 1) (p/invoke + acc (p/invoke join (p/invoke spawn (lambda () i))))))))"
+            );
+            size_t const vthread_count = ss::vm_vthread_count(vm);
+            EXPECT_EQ(eval_lines(vm, "(spawn-join 2000 0)"), "2001000");
+            EXPECT_LE(ss::vm_vthread_count(vm), vthread_count + 1);
+            // a joined ID no longer refers to a VThread until it is reused:
+            EXPECT_THROW(eval_lines(vm, "(define id (p/invoke spawn (lambda () 1))) (p/invoke join id) (p/invoke join id)"), ss::SsiError);
+
+            // bulk operations join every chunk, so they reuse theirs too:
+            eval_lines(vm, kBulkDefinitions);
+            eval_lines(vm, "(p/invoke parallel-fold add 0 xs)");
+            size_t const bulk_vthread_count = ss::vm_vthread_count(vm);
+            EXPECT_EQ(eval_lines(vm, "(p/invoke parallel-fold add 0 xs)"), "82482500");
+            EXPECT_EQ(ss::vm_vthread_count(vm), bulk_vthread_count);
+        });
+    }
+}
+
+//
+// Hash tables call back into Scheme on the running VThread, cf `vm_hash_table_walk`
+//
+
+TEST_F(EvalTest, HashTableUpdateAppliesProc) {
+    expect_eval(
+        "(define t (p/invoke make-hash-table)) "
+        "(p/invoke hash-table-set! t 'a 1) "
+        "(p/invoke hash-table-update! t 'a (lambda (v) (p/invoke + v 41))) "
+        "(p/invoke hash-table-ref t 'a)",
+        "42"
+    );
+    expect_eval(
+        "(define t (p/invoke make-hash-table 'eqv?)) "
+        "(define count-in (lambda (xs) (if (p/invoke null? xs) t (begin "
+        "   (p/invoke hash-table-update!/default t (p/invoke car xs) (lambda (n) (p/invoke + n 1)) 0) "
+        "   (count-in (p/invoke cdr xs)))))) "
+        "(count-in '(1 2 1 3 1 2)) "
+        "(p/invoke + (p/invoke * 100 (p/invoke hash-table-ref t 1)) (p/invoke * 10 (p/invoke hash-table-ref t 2)) (p/invoke hash-table-ref t 3))",
+        "321"
+    );
+    for (char const* source: {
+        "(p/invoke hash-table-update! (p/invoke make-hash-table) 'missing (lambda (v) v))",
+        "(p/invoke hash-table-update!/default (p/invoke make-hash-table) 'k (lambda (v) (p/invoke car v)) 0)",
+        "(p/invoke hash-table-update!/default (p/invoke make-hash-table) 'k 'not-a-procedure 0)"
+    }) {
+        SCOPED_TRACE(source);
+        each_engine([&] (ss::VirtualMachine* vm) {
+            EXPECT_THROW(eval_lines(vm, source), ss::SsiError);
+        });
+    }
+}
+
+TEST_F(EvalTest, HashTableWalkVisitsEachEntry) {
+    // the walk may modify the table it walks, since it walks a copy of its entries:
+    expect_eval(
+        "(define t (p/invoke alist->hash-table '((1 . 10) (2 . 20) (3 . 30)))) "
+        "(define sum (p/invoke make-hash-table)) "
+        "(p/invoke hash-table-set! sum 'total 0) "
+        "(p/invoke hash-table-walk t (lambda (k v) (begin "
+        "   (p/invoke hash-table-update! sum 'total (lambda (n) (p/invoke + n k v))) "
+        "   (p/invoke hash-table-delete! t k)))) "
+        "(p/invoke cons (p/invoke hash-table-ref sum 'total) (p/invoke hash-table-size t))",
+        "(66 . 0)"
+    );
+    expect_eval("(p/invoke hash-table-walk (p/invoke make-hash-table) (lambda (k v) (p/invoke car k)))", "()");
+}
+
+TEST_F(EvalTest, HashTableProcsRunOnTheRunningVThread) {
+    // no VThread is made per call, whether the caller is the main VThread or a spawned one:
+    for (size_t worker_count: kWorkerCounts) {
+        SCOPED_TRACE(worker_count);
+        each_engine([&] (ss::VirtualMachine* vm) {
+            ss::vm_set_worker_count(vm, worker_count);
+            eval_lines(vm, 
+                "(define t (p/invoke make-hash-table)) "
+                "(define bump (lambda (i) (if (p/invoke = i 0) (p/invoke hash-table-ref t 'n) (begin "
+                "   (p/invoke hash-table-update!/default t 'n (lambda (n) (p/invoke + n 1)) 0) "
+                "   (bump (p/invoke - i 1))))))"
+            );
+            size_t const vthread_count = ss::vm_vthread_count(vm);
+            EXPECT_EQ(eval_lines(vm, "(bump 1000)"), "1000");
+            EXPECT_EQ(ss::vm_vthread_count(vm), vthread_count);
+            EXPECT_EQ(eval_lines(vm, "(p/invoke join (p/invoke spawn (lambda () (bump 1000))))"), "2000");
+
+            // `proc` may not wait on other VThreads, but the caller carries on once it fails:
+            EXPECT_THROW(
+                eval_lines(vm, "(p/invoke hash-table-update! t 'n (lambda (n) (p/invoke join (p/invoke spawn (lambda () n)))))"), 
+                ss::SsiError
+            );
+            EXPECT_EQ(eval_lines(vm, "(bump 1)"), "2001");
+        });
+    }
+}
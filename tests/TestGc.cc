@@ -0,0 +1,323 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "ss-core/object.hh"
+#include "ss-core/gc.hh"
+
+#include "TestHeap.hh"
+
+///
+/// GC TESTS
+///
+
+// room for a few of the large objects in `SweepReturnsLargeObjectsToThePageHeap`:
+class GcTests: public HeapTest<(2 << 20)> {};
+
+TEST_F(GcTests, SweepKeepsMarkedAndReclaimsTheRest) {
+    // the heap is far smaller than the total allocated, so each sweep must reclaim the garbage.
+
+    ss::OBJECT kept = ss::OBJECT::null;
+    for (ssize_t i = 0; i < 100; i++) {
+        kept = ss::OBJECT::make_pair(&gc_tfe, ss::OBJECT::make_integer(i), kept);
+    }
+    for (size_t round = 0; round < 64; round++) {
+        for (ssize_t i = 0; i < 8192; i++) {
+            ss::OBJECT::make_pair(&gc_tfe, ss::OBJECT::make_integer(i), ss::OBJECT::null);
+        }
+        ss::GcMarker marker{gc.page_map()};
+        marker.mark(kept);
+        EXPECT_EQ(marker.marked_count(), 100u);
+        gc.sweep();
+    }
+
+    ssize_t expected = 99;
+    for (ss::OBJECT it = kept; !it.is_null(); it = ss::cdr(it)) {
+        EXPECT_FALSE(gc.page_map().is_marked(reinterpret_cast<ss::APtr>(it.as_pair_p())));
+        EXPECT_EQ(ss::car(it).as_integer(), expected--);
+    }
+    EXPECT_EQ(expected, -1);
+}
+
+TEST_F(GcTests, MinorCollectionPromotesReachableYoungObjects) {
+    if (CONFIG_DISABLE_GC_NURSERY) {
+        GTEST_SKIP();
+    }
+
+    // an old object, made while the nursery is closed, later refers to a young list:
+    ss::OBJECT old_box = ss::OBJECT::make_box(&gc_tfe, ss::OBJECT::null);
+    gc_tfe.set_nursery_open(true);
+    ss::OBJECT root = ss::OBJECT::null;
+    ss::OBJECT remembered = ss::OBJECT::null;
+    for (ssize_t i = 0; i < 100; i++) {
+        root = ss::OBJECT::make_pair(&gc_tfe, ss::OBJECT::make_integer(i), root);
+        remembered = ss::OBJECT::make_pair(&gc_tfe, root, remembered);
+    }
+    ss::set_box(old_box, remembered);
+    ASSERT_TRUE(root.as_ptr()->gc_young());
+
+    ss::GcEvacuator evacuator{&gc_tfe};
+    evacuator.evacuate(root);
+    for (ss::BaseBoxedObject* obj: gc.take_remembered_set()) {
+        evacuator.evacuate_children(obj);
+    }
+    gc.reset_nurseries();
+    gc_tfe.set_nursery_open(false);
+    EXPECT_EQ(evacuator.promoted_count(), 200u);
+
+    // both references to the shared list now refer to the same copy:
+    ss::OBJECT promoted = ss::unbox(old_box);
+    EXPECT_FALSE(promoted.as_ptr()->gc_young());
+    EXPECT_EQ(ss::car(promoted).as_raw(), root.as_raw());
+    ssize_t expected = 99;
+    for (ss::OBJECT it = root; !it.is_null(); it = ss::cdr(it)) {
+        EXPECT_FALSE(it.as_ptr()->gc_young());
+        EXPECT_EQ(ss::car(it).as_integer(), expected--);
+    }
+    EXPECT_EQ(expected, -1);
+}
+
+// promote_alist promotes a young association list, returning the evacuator's count of adjacent list links.
+static size_t promote_alist(bool linearizes_lists, size_t& list_link_count) {
+    TestHeap heap;
+    ss::Gc& gc = heap.gc;
+    ss::GcThreadFrontEnd& gc_tfe = heap.gc_tfe;
+    gc_tfe.set_nursery_open(true);
+    ss::OBJECT root = ss::OBJECT::null;
+    for (ssize_t i = 0; i < 100; i++) {
+        ss::OBJECT entry = ss::OBJECT::make_pair(&gc_tfe, ss::OBJECT::make_integer(i), ss::OBJECT::make_integer(-i));
+        root = ss::OBJECT::make_pair(&gc_tfe, entry, root);
+    }
+
+    ss::GcEvacuator evacuator{&gc_tfe, linearizes_lists};
+    evacuator.evacuate(root);
+    gc.reset_nurseries();
+    gc_tfe.set_nursery_open(false);
+    EXPECT_EQ(evacuator.promoted_count(), 200u);
+    ssize_t expected = 99;
+    for (ss::OBJECT it = root; !it.is_null(); it = ss::cdr(it)) {
+        EXPECT_FALSE(it.as_ptr()->gc_young());
+        EXPECT_FALSE(ss::car(it).as_ptr()->gc_young());
+        EXPECT_EQ(ss::car(ss::car(it)).as_integer(), expected);
+        EXPECT_EQ(ss::cdr(ss::car(it)).as_integer(), -expected);
+        expected--;
+    }
+    EXPECT_EQ(expected, -1);
+    list_link_count = evacuator.list_link_count();
+    return evacuator.adjacent_link_count();
+}
+
+TEST_F(GcTests, MinorCollectionLinearizesListSpines) {
+    if (CONFIG_DISABLE_GC_NURSERY) {
+        GTEST_SKIP();
+    }
+
+    // traced in order, each entry is copied between two links of the spine; cdr-first, the spine is copied 
+    // in a run, but for (at most) one span running out:
+    size_t list_link_count = 0;
+    size_t interleaved_count = promote_alist(false, list_link_count);
+    EXPECT_EQ(list_link_count, 99u);
+    EXPECT_LT(interleaved_count, 10u);
+    size_t linearized_count = promote_alist(true, list_link_count);
+    EXPECT_EQ(list_link_count, 99u);
+    EXPECT_GE(linearized_count, 98u);
+}
+
+TEST_F(GcTests, MinorCollectionRehashesTablesKeyedByYoungObjects) {
+    if (CONFIG_DISABLE_GC_NURSERY) {
+        GTEST_SKIP();
+    }
+
+    // an old 'eq?' table hashes young keys by their addresses, which promoting them changes:
+    ss::OBJECT table = ss::OBJECT::make_hash_table(&gc_tfe, ss::HashTableEquivalence::Eq);
+    gc_tfe.set_nursery_open(true);
+    std::vector<ss::OBJECT> keys;
+    for (ssize_t i = 0; i < 100; i++) {
+        keys.push_back(ss::OBJECT::make_pair(&gc_tfe, ss::OBJECT::make_integer(i), ss::OBJECT::null));
+        table.as_hash_table_p()->set(keys.back(), ss::OBJECT::make_integer(i));
+    }
+    ASSERT_TRUE(keys[0].as_ptr()->gc_young());
+
+    ss::GcEvacuator evacuator{&gc_tfe};
+    evacuator.evacuate_all(keys.data(), keys.size());
+    for (ss::BaseBoxedObject* obj: gc.take_remembered_set()) {
+        evacuator.evacuate_children(obj);
+    }
+    gc.reset_nurseries();
+    gc_tfe.set_nursery_open(false);
+
+    EXPECT_EQ(table.as_hash_table_p()->count(), 100u);
+    for (ssize_t i = 0; i < 100; i++) {
+        EXPECT_FALSE(keys[i].as_ptr()->gc_young());
+        ss::OBJECT const* value = table.as_hash_table_p()->find(keys[i]);
+        ASSERT_NE(value, nullptr);
+        EXPECT_EQ(value->as_integer(), i);
+    }
+}
+
+TEST_F(GcTests, SweepReturnsLargeObjectsToThePageHeap) {
+    // each stack segment is above kMaxSize, and the heap only fits a few: each sweep must return the dead
+    // ones' page-spans.
+    size_t constexpr item_count = 40000;
+    ASSERT_EQ(ss::gc::sci(ss::StackSegmentObject::size_in_bytes(item_count)), 0);
+
+    std::vector<ss::OBJECT> items(item_count);
+    for (size_t i = 0; i < item_count; i++) {
+        items[i] = ss::OBJECT::make_integer(i);
+    }
+    ss::OBJECT kept = ss::OBJECT::make_stack_segment(&gc_tfe, ss::OBJECT::null, 0, item_count, items.data());
+    EXPECT_EQ(kept.as_ptr()->gc_sci(), ss::gc::OVERSIZED_SCI);
+    for (size_t round = 0; round < 16; round++) {
+        for (size_t i = 0; i < 2; i++) {
+            ss::OBJECT::make_stack_segment(&gc_tfe, kept, 0, item_count, items.data());
+        }
+        ss::GcMarker marker{gc.page_map()};
+        marker.mark(kept);
+        EXPECT_EQ(marker.marked_count(), 1u);
+        gc.sweep();
+    }
+
+    ss::StackSegmentObject* segment = kept.as_stack_segment_p();
+    EXPECT_FALSE(gc.page_map().is_marked(reinterpret_cast<ss::APtr>(segment)));
+    for (size_t i = 0; i < item_count; i++) {
+        EXPECT_EQ(segment->items()[i].as_integer(), static_cast<ssize_t>(i));
+    }
+}
+
+TEST_F(GcTests, FreeListsCoalesceReturnedItems) {
+    // items are a few ABlks wide, so that spans are measured in items but addressed in ABlks:
+    ss::gc::ObjectFreeList free_list;
+    free_list.init(ss::gc::sci(48));
+    size_t const stride = free_list.object_size_in_ablks();
+    ASSERT_GT(stride, 1u);
+    std::vector<ss::ABlk> region(16 * stride);
+    using Spans = std::vector<std::pair<ss::APtr, size_t>>;
+    auto item = [&] (size_t i) { return region.data() + i * stride; };
+    auto spans = [&] () {
+        Spans res;
+        for (ss::gc::GenericSpan const& span: free_list) {
+            res.push_back({span.ptr, span.count});
+        }
+        return res;
+    };
+
+    free_list.return_items(item(10), 2);
+    free_list.return_items(item(8), 2);
+    EXPECT_EQ(spans(), (Spans{{item(8), 4}}));
+    free_list.return_items(item(0), 2);
+    free_list.return_items(item(2), 2);
+    EXPECT_EQ(spans(), (Spans{{item(0), 4}, {item(8), 4}}));
+    // filling the gap coalesces both neighbours:
+    free_list.return_items(item(4), 4);
+    EXPECT_EQ(spans(), (Spans{{item(0), 12}}));
+    free_list.return_items(item(14), 2);
+    EXPECT_EQ(spans(), (Spans{{item(0), 12}, {item(14), 2}}));
+    // each span is linked through its own first item, so the list never allocates:
+    auto const* link = reinterpret_cast<ss::gc::FreeSpanLink const*>(item(0));
+    EXPECT_EQ(link->next, item(14));
+    EXPECT_EQ(link->count, 12u);
+
+    EXPECT_EQ(free_list.try_allocate_items(4), item(0));
+    EXPECT_EQ(free_list.try_allocate_items(10), nullptr);
+    EXPECT_EQ(free_list.try_allocate_items(8), item(4));
+    EXPECT_EQ(spans(), (Spans{{item(14), 2}}));
+}
+
+TEST_F(GcTests, ReservedHeapGrowsThenReturnsIdlePagesToTheOs) {
+    size_t constexpr initial_size = (1 << 20);
+    size_t constexpr initial_page_count = initial_size / ss::gc::PAGE_SIZE_IN_BYTES;
+    ss::Gc reserved_gc{initial_size, 8 * initial_size};
+    ss::GcThreadFrontEnd reserved_tfe{&reserved_gc};
+    if (ss::os_page_size() > ss::gc::PAGE_SIZE_IN_BYTES || CONFIG_GC_RELEASE_IDLE_COLLECTIONS == 0) {
+        GTEST_SKIP();
+    }
+
+    // a list several times the initial size only fits once the heap grows:
+    ss::OBJECT list = ss::OBJECT::null;
+    for (ssize_t i = 0; i < 4 * static_cast<ssize_t>(initial_size / sizeof(ss::PairObject)); i++) {
+        list = ss::OBJECT::make_pair(&reserved_tfe, ss::OBJECT::make_integer(i), list);
+    }
+    EXPECT_GT(reserved_gc.back_end_impl().committed_page_count(), initial_page_count);
+
+    // once unreachable, its pages are returned to the back-end, then to the OS once idle:
+    for (size_t round = 0; round <= CONFIG_GC_RELEASE_IDLE_COLLECTIONS; round++) {
+        reserved_gc.sweep();
+    }
+    EXPECT_LT(reserved_gc.back_end_impl().committed_page_count(), initial_page_count);
+
+    // released pages are committed again, zeroed, as they are reused:
+    for (ssize_t i = 0; i < 4 * static_cast<ssize_t>(initial_size / sizeof(ss::PairObject)); i++) {
+        list = ss::OBJECT::make_pair(&reserved_tfe, ss::OBJECT::make_integer(i), ss::OBJECT::null);
+        EXPECT_EQ(ss::car(list).as_integer(), i);
+    }
+}
+
+TEST_F(GcTests, FrontEndsOnSeparateThreadsShareOneHeap) {
+    // each thread frees whole batches, which other threads then reuse through the transfer-caches: no 
+    // object may be handed to two threads at once.
+    size_t constexpr thread_count = 4;
+    size_t constexpr objects_per_round = 1000;
+
+    std::vector<std::thread> threads;
+    std::vector<size_t> mismatch_counts(thread_count, 0);
+    for (size_t t = 0; t < thread_count; t++) {
+        threads.emplace_back([this, &mismatch_counts, t] () {
+            ss::GcThreadFrontEnd thread_tfe{&gc};
+            std::vector<size_t*> objects(objects_per_round);
+            for (size_t round = 0; round < 200; round++) {
+                for (size_t i = 0; i < objects_per_round; i++) {
+                    objects[i] = reinterpret_cast<size_t*>(thread_tfe.allocate_bytes(2 * sizeof(size_t)));
+                    objects[i][0] = t;
+                    objects[i][1] = i;
+                }
+                for (size_t i = 0; i < objects_per_round; i++) {
+                    if (objects[i][0] != t || objects[i][1] != i) {
+                        mismatch_counts[t]++;
+                    }
+                    thread_tfe.deallocate_bytes(reinterpret_cast<ss::APtr>(objects[i]), 2 * sizeof(size_t));
+                }
+            }
+        });
+    }
+    for (std::thread& thread: threads) {
+        thread.join();
+    }
+    for (size_t t = 0; t < thread_count; t++) {
+        EXPECT_EQ(mismatch_counts[t], 0u);
+    }
+}
+
+TEST_F(GcTests, StatsCountEveryFrontEndOnce) {
+    ss::gc::SizeClassIndex sci = ss::gc::sci(sizeof(ss::PairObject));
+
+    // a destroyed front-end's counts are kept by the GC:
+    {
+        ss::GcThreadFrontEnd short_lived_tfe{&gc};
+        for (ssize_t i = 0; i < 1000; i++) {
+            ss::OBJECT::make_pair(&short_lived_tfe, ss::OBJECT::make_integer(i), ss::OBJECT::null);
+        }
+    }
+    std::vector<ss::APtr> objects;
+    for (size_t i = 0; i < 500; i++) {
+        objects.push_back(gc_tfe.allocate_size_class(sci));
+    }
+    for (size_t i = 0; i < 200; i++) {
+        gc_tfe.deallocate_size_class(objects[i], sci);
+    }
+
+    ss::GcStats stats = gc.stats();
+    EXPECT_EQ(stats.size_classes[sci].allocated_count, 1500u);
+    EXPECT_EQ(stats.size_classes[sci].freed_count, 200u);
+    EXPECT_GT(stats.size_classes[sci].refill_count, 0u);
+    EXPECT_GT(stats.committed_page_count, 0u);
+
+    // sweeping frees the unmarked and times nothing: pauses are recorded by the VM.
+    for (size_t i = 200; i < objects.size(); i++) {
+        gc_tfe.deallocate_size_class(objects[i], sci);
+    }
+    gc.sweep();
+    stats = gc.stats();
+    EXPECT_EQ(stats.size_classes[sci].live_bytes, 0u);
+    EXPECT_EQ(stats.full_pauses.count, 0u);
+}
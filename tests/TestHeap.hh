@@ -0,0 +1,35 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "ss-core/gc.hh"
+
+///
+/// TEST HEAPS
+/// - a GC over a region owned by the test, freed with it, and a front-end on the thread that made it.
+///
+
+class TestHeap {
+public:
+    static size_t constexpr DEFAULT_SIZE_IN_BYTES = (1 << 20);
+private:
+    std::unique_ptr<ss::ABlk[]> m_region;
+public:
+    ss::Gc gc;
+    ss::GcThreadFrontEnd gc_tfe;
+public:
+    explicit TestHeap(size_t size_in_bytes = DEFAULT_SIZE_IN_BYTES)
+    :   m_region(new ss::ABlk[size_in_bytes / sizeof(ss::ABlk)]),
+        gc(m_region.get(), size_in_bytes),
+        gc_tfe(&gc)
+    {}
+};
+
+// HeapTest gives each test a fresh `TestHeap` of `size_in_bytes`.
+template <size_t size_in_bytes = TestHeap::DEFAULT_SIZE_IN_BYTES>
+class HeapTest: public testing::Test, protected TestHeap {
+protected:
+    HeapTest(): TestHeap(size_in_bytes) {}
+};
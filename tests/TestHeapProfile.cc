@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include "ss-core/object.hh"
+#include "ss-core/gc.hh"
+#include "ss-core/heap-profile.hh"
+
+#include "TestHeap.hh"
+
+///
+/// HEAP PROFILE TESTS
+/// - samples are recorded as the run-time's, as objects made outside any engine are.
+///
+
+class HeapProfileTests: public HeapTest<> {};
+
+static void record_sample(void* ctx, ss::BaseBoxedObject* obj, size_t byte_count) {
+    static_cast<ss::VmHeapProfile*>(ctx)->record(obj, byte_count, -1, ss::VmHeapProfile::RUNTIME_BODY, ss::VmExpKind::Halt);
+}
+
+TEST_F(HeapProfileTests, SamplesAllocationsAndFollowsThemUntilSwept) {
+    size_t constexpr period = 1024;
+    ss::VmHeapProfile profile{period};
+    gc.enable_heap_sampling(period, record_sample, &profile);
+    EXPECT_EQ(gc.heap_sample_period(), period);
+
+    ss::OBJECT kept = ss::OBJECT::null;
+    for (ssize_t i = 0; i < 2000; i++) {
+        kept = ss::OBJECT::make_pair(&gc_tfe, ss::OBJECT::make_integer(i), kept);
+    }
+    for (size_t round = 0; round < 64; round++) {
+        for (ssize_t i = 0; i < 8192; i++) {
+            ss::OBJECT::make_pair(&gc_tfe, ss::OBJECT::make_integer(i), ss::OBJECT::null);
+        }
+        ss::GcMarker marker{gc.page_map()};
+        marker.mark(kept);
+        profile.sweep(gc.page_map());
+        gc.sweep();
+    }
+
+    // each pair is sampled with probability 1-exp(-32/1024), i.e. about 1 in 32.5:
+    double p = 1.0 - std::exp(-static_cast<double>(sizeof(ss::PairObject)) / period);
+    double expected_count = p * (2000 + 64 * 8192);
+    EXPECT_GT(static_cast<double>(profile.count_samples()), 0.9 * expected_count);
+    EXPECT_LT(static_cast<double>(profile.count_samples()), 1.1 * expected_count);
+    // only samples of the kept list are still live:
+    EXPECT_GT(profile.count_live_samples(), 0u);
+    EXPECT_LT(profile.count_live_samples(), 200u);
+
+    ss::VCode code;
+    std::stringstream out;
+    profile.write_pprof(out, code);
+    std::string bytes = out.str();
+    EXPECT_NE(bytes.find("survived_space"), std::string::npos);
+    EXPECT_NE(bytes.find("<run-time>"), std::string::npos);
+    EXPECT_NE(bytes.find("Pair"), std::string::npos);
+}
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ss-core/intern.hh"
+
+///
+/// INTERNER TESTS
+/// - several threads intern overlapping strings at once, as the front-end's parser threads do.
+///
+
+TEST(InternTests, ConcurrentInterningAgrees) {
+    size_t const thread_count = 4;
+    size_t const string_count = 20000;
+    std::vector<std::vector<ss::IntStr>> thread_ids(thread_count);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; t++) {
+        threads.emplace_back([&thread_ids, t, string_count] () {
+            for (size_t i = 0; i < string_count; i++) {
+                // each thread interns the strings in a different order:
+                size_t j = (i * (t + 1) * 7919) % string_count;
+                thread_ids[t].push_back(ss::intern("intern-test-" + std::to_string(j)));
+            }
+        });
+    }
+    for (std::thread& thread: threads) {
+        thread.join();
+    }
+
+    for (size_t t = 0; t < thread_count; t++) {
+        for (size_t i = 0; i < string_count; i++) {
+            size_t j = (i * (t + 1) * 7919) % string_count;
+            std::string expected = "intern-test-" + std::to_string(j);
+            EXPECT_EQ(ss::interned_string(thread_ids[t][i]), expected);
+            EXPECT_EQ(ss::intern(expected), thread_ids[t][i]);
+        }
+    }
+
+    // views are stable while more strings are interned:
+    std::string_view first = ss::interned_string(ss::intern("intern-test-stable"));
+    for (size_t i = 0; i < string_count; i++) {
+        ss::intern("intern-test-more-" + std::to_string(i));
+    }
+    EXPECT_EQ(first, "intern-test-stable");
+    EXPECT_EQ(first.data(), ss::interned_string(ss::intern("intern-test-stable")).data());
+}
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+#include "ss-core/config.hh"
+#include "ss-core/vcode.hh"
+#include "ss-core/bytecode.hh"
+#include "ss-core/vthread.hh"
+#include "ss-core/jit.hh"
+
+///
+/// JIT UNIT TESTS
+/// - bodies are built by hand, and their native code is entered directly, as the bytecode engine would.
+///
+
+namespace {
+
+    // sum_loop builds a body that adds locals 0, 0-1, ..., 1 to local 1, then halts with the sum:
+    // i.e. `(let loop ((i i) (acc acc)) (if (= 0 i) acc (loop (- i 1) (+ acc i))))`
+    ss::VmExpID sum_loop(ss::VCode& code, ss::VmExpID* halt, ss::VmExpID* eq) {
+        ss::VmExpID self_tail_call = code.new_vmx_self_tail_call(0, -1, 2);
+        ss::VmExpID next_i = code.new_vmx_refer_local(0, code.new_vmx_prim(
+            ss::VmExpKind::PrimSub, 0, code.new_vmx_argument(self_tail_call)
+        ));
+        ss::VmExpID next_acc = code.new_vmx_refer_local(1, code.new_vmx_prim(
+            ss::VmExpKind::PrimAdd, 0, code.new_vmx_argument(
+                code.new_vmx_constant(ss::OBJECT::make_integer(1), code.new_vmx_argument(next_i))
+            )
+        ));
+        ss::VmExpID recur = code.new_vmx_refer_local(0, code.new_vmx_argument(next_acc));
+        *halt = code.new_vmx_halt();
+        ss::VmExpID test = code.new_vmx_test(code.new_vmx_refer_local(1, *halt), recur);
+        *eq = code.new_vmx_prim(ss::VmExpKind::PrimEq, 0, test);
+        ss::VmExpID body = code.new_vmx_refer_local(0, code.new_vmx_argument(
+            code.new_vmx_constant(ss::OBJECT::make_integer(0), *eq)
+        ));
+        code[self_tail_call].args.i_call_global.body = body;
+        return body;
+    }
+
+    struct Args {
+        ss::VmStack stack{1 << 12};
+        ssize_t s = 0;
+        std::atomic<bool> minor_collect_requested{false};
+        std::atomic<bool> sweep_requested{false};
+
+        ss::JitFrame frame() {
+            return {
+                ss::OBJECT::null, s, ss::OBJECT::null, s,
+                stack.data(), stack.captured_height(), static_cast<ssize_t>(stack.committed_count()),
+                nullptr,
+                &minor_collect_requested, &sweep_requested
+            };
+        }
+    };
+
+}
+
+TEST(JitTests, CountsCallsUpToTheThreshold) {
+    ss::VCode code;
+    ss::VBytecode bytecode{&code};
+    ss::VJit jit{&code, &bytecode};
+    code.new_unit();
+    ss::VmExpID body = code.new_vmx_return(0);
+    for (size_t i = 1; i < CONFIG_JIT_CALL_THRESHOLD; i++) {
+        ASSERT_FALSE(jit.count_call(body));
+    }
+    EXPECT_TRUE(jit.count_call(body));
+    EXPECT_FALSE(jit.count_call(body));
+    jit.defer_call(body);
+    EXPECT_FALSE(jit.count_call(body));
+}
+TEST(JitTests, RunsSelfTailCallsNatively) {
+    if (!ss::VJit::is_supported()) {
+        GTEST_SKIP();
+    }
+    ss::VCode code;
+    ss::VBytecode bytecode{&code};
+    ss::VJit jit{&code, &bytecode};
+    ss::VCodeUnitID unit = code.new_unit();
+    ss::VmExpID halt, eq;
+    ss::VmExpID body = sum_loop(code, &halt, &eq);
+    bytecode.entry(body);
+    ASSERT_TRUE(jit.compile(body, nullptr));
+    ss::JitEntry const* entry = jit.find_entry(bytecode.entry(body));
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->kind, ss::VmExpKind::ReferLocal);
+    EXPECT_EQ(jit.compiled_body_count(), 1);
+
+    Args args;
+    args.s = args.stack.push(ss::OBJECT::make_integer(0), args.s);
+    args.s = args.stack.push(ss::OBJECT::make_integer(100), args.s);
+    ss::JitFrame frame = args.frame();
+    EXPECT_EQ(entry->code(&frame), bytecode.entry(halt));
+    EXPECT_EQ(frame.a.as_integer(), 5050);
+    EXPECT_EQ(frame.s, 2);
+
+    jit.free_unit(unit);
+    EXPECT_EQ(jit.find_entry(bytecode.entry(body)), nullptr);
+    EXPECT_EQ(jit.code_byte_count(), 0);
+}
+TEST(JitTests, ExitsWhereFastPathsFail) {
+    if (!ss::VJit::is_supported()) {
+        GTEST_SKIP();
+    }
+    ss::VCode code;
+    ss::VBytecode bytecode{&code};
+    ss::VJit jit{&code, &bytecode};
+    code.new_unit();
+    ss::VmExpID halt, eq;
+    ss::VmExpID body = sum_loop(code, &halt, &eq);
+    bytecode.entry(body);
+    ASSERT_TRUE(jit.compile(body, nullptr));
+    ss::JitEntry const* entry = jit.find_entry(bytecode.entry(body));
+    ASSERT_NE(entry, nullptr);
+
+    // a non-fixnum: the interpreter runs '=' with the registers left as they were.
+    Args args;
+    args.s = args.stack.push(ss::OBJECT::make_integer(0), args.s);
+    args.s = args.stack.push(ss::OBJECT::make_boolean(true), args.s);
+    ss::JitFrame frame = args.frame();
+    EXPECT_EQ(entry->code(&frame), bytecode.entry(eq));
+    EXPECT_EQ(frame.a.as_integer(), 0);
+    EXPECT_EQ(frame.s, 3);
+    EXPECT_TRUE(args.stack.index(frame.s, 0).is_boolean(true));
+
+    // a requested collection: the interpreter runs the self tail call, and stops there.
+    args.minor_collect_requested = true;
+    args.s = 0;
+    args.s = args.stack.push(ss::OBJECT::make_integer(0), args.s);
+    args.s = args.stack.push(ss::OBJECT::make_integer(3), args.s);
+    frame = args.frame();
+    ss::VmCodePtr exit_pc = entry->code(&frame);
+    EXPECT_EQ(static_cast<ss::VmExpKind>(*exit_pc), ss::VmExpKind::SelfTailCall);
+    EXPECT_EQ(frame.s, 4);
+    EXPECT_EQ(args.stack.index(frame.s, 0).as_integer(), 2);
+    EXPECT_EQ(args.stack.index(frame.s, 1).as_integer(), 3);
+}
+TEST(JitTests, InstallsCodeBuiltElsewhere) {
+    // e.g. ahead of time, cf `aot.hh`: this is entered on any target.
+    ss::VCode code;
+    ss::VBytecode bytecode{&code};
+    ss::VJit jit{&code, &bytecode};
+    ss::VCodeUnitID unit = code.new_unit();
+    ss::VmExpID halt, eq;
+    ss::VmExpID body = sum_loop(code, &halt, &eq);
+    ss::JitCode native = [] (ss::JitFrame* frame) -> ss::VmCodePtr {
+        frame->a = ss::OBJECT::make_integer(42);
+        return nullptr;
+    };
+    EXPECT_FALSE(jit.has_unthreaded_entries());
+    jit.install(body, native);
+    EXPECT_TRUE(jit.has_unthreaded_entries());
+    ss::JitEntry const* entry = jit.find_entry(bytecode.entry(body));
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->code, native);
+    EXPECT_EQ(entry->kind, ss::VmExpKind::ReferLocal);
+
+    jit.free_unit(unit);
+    EXPECT_EQ(jit.find_entry(bytecode.entry(body)), nullptr);
+}
@@ -0,0 +1,348 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+
+#include "ss-core/library.hh"
+#include "ss-core/intern.hh"
+
+///
+/// LIBRARY TESTS
+/// - each test sets up a snail-root of its own in the temporary directory, with a library directory per
+///   library, and a repository of its own rather than the singleton's, cf `CentralLibraryRepository`.
+///
+
+// make_snail_root returns an empty snail-root named `name`.
+static std::filesystem::path make_snail_root(std::string const& name) {
+    std::filesystem::path root = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "lib");
+    return root;
+}
+// write_library writes the `main.scm` of the library at `relpath`, e.g. 'foo/bar' for '(foo bar)'.
+static void write_library(std::filesystem::path const& root, std::string const& relpath, std::string const& source) {
+    std::filesystem::path dir = root / "lib" / relpath;
+    std::filesystem::create_directories(dir);
+    std::ofstream out{dir / "main.scm", std::ios::binary | std::ios::trunc};
+    out << source;
+}
+static ss::OBJECT library_key(char const* name) {
+    return ss::OBJECT::make_symbol(ss::intern(name));
+}
+
+// IndexEntry is what the index records about a library: its path under 'lib', then its stamp.
+using IndexEntry = std::tuple<std::string, int64_t, uint64_t, std::string>;
+
+// collect_index_entries adds each library in `container`, and each of their sub-libraries, to `out`.
+static void collect_index_entries(ss::BaseLibraryContainer const& container, std::string const& prefix, std::vector<IndexEntry>& out) {
+    for (ss::BaseLibrary* library: container.children()) {
+        std::string path = prefix + library->relpath();
+        ss::BaseLibrary::Stamp const& stamp = library->stamp();
+        out.emplace_back(path, stamp.source_mtime, stamp.source_hash, stamp.artifact_path);
+        collect_index_entries(*library, path + "/", out);
+    }
+}
+// index_entries lists every library in `clr`, sub-libraries included, in path order.
+static std::vector<IndexEntry> index_entries(ss::CentralLibraryRepository const& clr) {
+    std::vector<IndexEntry> res;
+    collect_index_entries(clr, "", res);
+    std::sort(res.begin(), res.end());
+    return res;
+}
+static std::vector<std::string> index_paths(ss::CentralLibraryRepository const& clr) {
+    std::vector<std::string> res;
+    for (IndexEntry const& entry: index_entries(clr)) {
+        res.push_back(std::get<0>(entry));
+    }
+    return res;
+}
+
+//
+// Index: cf 'Library index format' in `library.cc`
+//
+
+TEST(LibraryTests, IndexRoundTrips) {
+    std::filesystem::path root = make_snail_root("ss-test-lib-index");
+    write_library(root, "a", "(define a-val 1)");
+    write_library(root, "b", "(define b-val 2)");
+    write_library(root, "b/c", "(define c-val 3)");
+
+    // scanning the 'lib' directory writes the index, sub-libraries included:
+    ss::CentralLibraryRepository scanned;
+    ASSERT_TRUE(scanned.try_init_instance(root.string(), true));
+    EXPECT_EQ(index_paths(scanned), (std::vector<std::string>{"a", "b", "b/c"}));
+    ASSERT_TRUE(std::filesystem::exists(scanned.index_abspath()));
+
+    // a library added since is not seen, since the index is loaded rather than the directory scanned:
+    write_library(root, "d", "(define d-val 4)");
+    ss::CentralLibraryRepository loaded;
+    ASSERT_TRUE(loaded.try_init_instance(root.string(), false));
+    EXPECT_EQ(index_entries(loaded), index_entries(scanned));
+    ASSERT_NE(loaded.child(library_key("b")), nullptr);
+    EXPECT_NE(loaded.child(library_key("b"))->child(library_key("c")), nullptr);
+}
+
+TEST(LibraryTests, BadIndexIsRescanned) {
+    std::filesystem::path root = make_snail_root("ss-test-lib-bad-index");
+    write_library(root, "a", "(define a-val 1)");
+    ss::CentralLibraryRepository scanned;
+    ASSERT_TRUE(scanned.try_init_instance(root.string(), true));
+    std::string index_path = scanned.index_abspath();
+    uintmax_t index_size = std::filesystem::file_size(index_path);
+
+    // a truncated index:
+    write_library(root, "b", "(define b-val 2)");
+    std::filesystem::resize_file(index_path, index_size / 2);
+    {
+        ss::CentralLibraryRepository clr;
+        ASSERT_TRUE(clr.try_init_instance(root.string(), false));
+        EXPECT_EQ(index_paths(clr), (std::vector<std::string>{"a", "b"}));
+    }
+
+    // an index whose last word is corrupt, which its checksum catches:
+    write_library(root, "c", "(define c-val 3)");
+    index_size = std::filesystem::file_size(index_path);
+    {
+        std::fstream f{index_path, std::ios::in | std::ios::out | std::ios::binary};
+        f.seekp(static_cast<std::streamoff>(index_size - 1));
+        f.put('\x7f');
+    }
+    {
+        ss::CentralLibraryRepository clr;
+        ASSERT_TRUE(clr.try_init_instance(root.string(), false));
+        EXPECT_EQ(index_paths(clr), (std::vector<std::string>{"a", "b", "c"}));
+    }
+}
+
+TEST(LibraryTests, ValidateFindsChanges) {
+    std::filesystem::path root = make_snail_root("ss-test-lib-validate");
+    write_library(root, "a", "(define a-val 1)");
+    write_library(root, "b", "(define b-val 2)");
+    write_library(root, "c", "(define c-val 3)");
+    {
+        ss::CentralLibraryRepository scanned;
+        ASSERT_TRUE(scanned.try_init_instance(root.string(), true));
+    }
+
+    // 'a' is unchanged, 'b' is written to since, and 'c' is deleted:
+    std::filesystem::path b_source = root / "lib" / "b" / "main.scm";
+    std::filesystem::last_write_time(b_source, std::filesystem::last_write_time(b_source) + std::chrono::hours{1});
+    std::filesystem::remove_all(root / "lib" / "c");
+
+    ss::CentralLibraryRepository clr;
+    ASSERT_TRUE(clr.try_init_instance(root.string(), false));
+    ss::BaseLibrary* b = clr.child(library_key("b"));
+    ASSERT_NE(b, nullptr);
+    int64_t old_b_mtime = b->stamp().source_mtime;
+    EXPECT_EQ(clr.child(library_key("a"))->validate(), ss::BaseLibrary::Validation::Unchanged);
+    EXPECT_EQ(b->validate(), ss::BaseLibrary::Validation::Changed);
+    EXPECT_NE(b->stamp().source_mtime, old_b_mtime);
+    ASSERT_NE(clr.child(library_key("c")), nullptr);
+    EXPECT_EQ(clr.child(library_key("c"))->validate(), ss::BaseLibrary::Validation::Missing);
+
+    // a library is only validated once: the next lookup of 'b' finds it unchanged.
+    EXPECT_EQ(b->validate(), ss::BaseLibrary::Validation::Unchanged);
+    EXPECT_EQ(clr.lookup(library_key("b")), b);
+
+    // a missing library is dropped from the index on lookup:
+    write_library(root, "d", "(define d-val 4)");
+    clr.rescan();
+    std::filesystem::remove_all(root / "lib" / "d");
+    ss::CentralLibraryRepository reloaded;
+    ASSERT_TRUE(reloaded.try_init_instance(root.string(), false));
+    ASSERT_NE(reloaded.child(library_key("d")), nullptr);
+    EXPECT_EQ(reloaded.lookup(library_key("d")), nullptr);
+    EXPECT_EQ(reloaded.child(library_key("d")), nullptr);
+}
+
+TEST(LibraryTests, StaleIndexIsRewrittenOnLookup) {
+    std::filesystem::path root = make_snail_root("ss-test-lib-stale-index");
+    write_library(root, "a", "(define a-val 1)");
+    write_library(root, "b", "(define b-val 2)");
+    std::vector<IndexEntry> old_entries;
+    {
+        ss::CentralLibraryRepository scanned;
+        ASSERT_TRUE(scanned.try_init_instance(root.string(), true));
+        old_entries = index_entries(scanned);
+    }
+
+    // 'b' is rewritten since it was indexed:
+    write_library(root, "b", "(define b-val 20)");
+    std::filesystem::path b_source = root / "lib" / "b" / "main.scm";
+    std::filesystem::last_write_time(b_source, std::filesystem::last_write_time(b_source) + std::chrono::hours{1});
+    {
+        ss::CentralLibraryRepository stale;
+        ASSERT_TRUE(stale.try_init_instance(root.string(), false));
+        EXPECT_EQ(index_entries(stale), old_entries);
+        ASSERT_NE(stale.lookup(library_key("b")), nullptr);
+    }
+
+    // the lookup wrote 'b's new stamp back to the index, without rescanning:
+    ss::CentralLibraryRepository reloaded;
+    ASSERT_TRUE(reloaded.try_init_instance(root.string(), false));
+    std::vector<IndexEntry> new_entries = index_entries(reloaded);
+    ASSERT_EQ(new_entries.size(), 2u);
+    EXPECT_EQ(new_entries[0], old_entries[0]);
+    EXPECT_NE(std::get<1>(new_entries[1]), std::get<1>(old_entries[1]));
+    EXPECT_NE(std::get<2>(new_entries[1]), std::get<2>(old_entries[1]));
+    EXPECT_EQ(reloaded.child(library_key("b"))->validate(), ss::BaseLibrary::Validation::Unchanged);
+}
+
+//
+// Precompiling: cf `precompile_libraries`
+//
+
+// read_file returns the bytes of the file at `path`, or none if there is none.
+static std::string read_file(std::filesystem::path const& path) {
+    std::ifstream f{path, std::ios::binary};
+    std::stringstream ss;
+    ss << f.rdbuf();
+    return ss.str();
+}
+// artifact_path is where the library at `relpath` is precompiled to.
+static std::filesystem::path artifact_path(std::filesystem::path const& root, std::string const& relpath) {
+    return root / "lib" / relpath / "main.ssc";
+}
+static size_t position_of(std::vector<ss::BaseLibrary*> const& order, ss::BaseLibrary* library) {
+    return std::find(order.begin(), order.end(), library) - order.begin();
+}
+
+// write_diamond writes a library that imports two that both import a fourth.
+static void write_diamond(std::filesystem::path const& root) {
+    write_library(root, "base", "(define base-val 1)");
+    write_library(root, "left", "(import (base)) (define left-val (p/invoke + base-val 1))");
+    write_library(root, "right", "(import (base)) (define right-val (p/invoke + base-val 2))");
+    write_library(root, "top", "(import (left) (only (right) right-val)) (define top-val (p/invoke + left-val right-val))");
+}
+
+TEST(LibraryTests, PrecompilesInImportOrder) {
+    std::filesystem::path root = make_snail_root("ss-test-lib-order");
+    write_diamond(root);
+    ss::CentralLibraryRepository clr;
+    ASSERT_TRUE(clr.try_init_instance(root.string(), true));
+    ss::BaseLibrary* base = clr.child(library_key("base"));
+    ss::BaseLibrary* left = clr.child(library_key("left"));
+    ss::BaseLibrary* right = clr.child(library_key("right"));
+    ss::BaseLibrary* top = clr.child(library_key("top"));
+
+    // requesting only 'top' builds what it imports first, each once:
+    std::vector<ss::BaseLibrary*> order;
+    ASSERT_TRUE(ss::precompile_libraries({top}, 4, &order));
+    ASSERT_EQ(order.size(), 4u);
+    EXPECT_EQ(order.front(), base);
+    EXPECT_LT(position_of(order, left), position_of(order, top));
+    EXPECT_LT(position_of(order, right), position_of(order, top));
+    for (char const* relpath: {"base", "left", "right", "top"}) {
+        EXPECT_TRUE(std::filesystem::exists(artifact_path(root, relpath))) << relpath;
+    }
+    EXPECT_EQ(top->stamp().artifact_path, artifact_path(root, "top").string());
+
+    // once built, only what is requested is built again:
+    ASSERT_TRUE(ss::precompile_libraries({top}, 4, &order));
+    EXPECT_EQ(order, std::vector<ss::BaseLibrary*>{top});
+}
+
+TEST(LibraryTests, PrecompileReusesUpToDateArtifacts) {
+    // as 'ssi -precompile-libs' would be run again, on a repository loaded from the index:
+    std::filesystem::path root = make_snail_root("ss-test-lib-reuse");
+    write_diamond(root);
+    std::vector<std::string> relpaths{"base", "left", "right", "top"};
+    {
+        ss::CentralLibraryRepository scanned;
+        ASSERT_TRUE(scanned.try_init_instance(root.string(), true));
+        ASSERT_TRUE(scanned.precompile(4));
+    }
+    // dating each artifact back, so that any written again is told apart:
+    auto const old_time = std::filesystem::last_write_time(artifact_path(root, "base")) - std::chrono::hours{1};
+    for (std::string const& relpath: relpaths) {
+        std::filesystem::last_write_time(artifact_path(root, relpath), old_time);
+    }
+    {
+        ss::CentralLibraryRepository clr;
+        ASSERT_TRUE(clr.try_init_instance(root.string(), false));
+        ASSERT_TRUE(clr.precompile(4));
+        for (std::string const& relpath: relpaths) {
+            EXPECT_EQ(std::filesystem::last_write_time(artifact_path(root, relpath)), old_time) << relpath;
+        }
+    }
+
+    // only a library whose 'main.scm' changed is compiled again, loading the artifacts of those it imports:
+    write_library(root, "left", "(import (base)) (define left-val (p/invoke + base-val 10))");
+    std::filesystem::path left_source = root / "lib" / "left" / "main.scm";
+    std::filesystem::last_write_time(left_source, std::filesystem::last_write_time(left_source) + std::chrono::hours{1});
+    ss::CentralLibraryRepository clr;
+    ASSERT_TRUE(clr.try_init_instance(root.string(), false));
+    ASSERT_TRUE(clr.precompile(4));
+    for (std::string const& relpath: relpaths) {
+        bool is_rebuilt = std::filesystem::last_write_time(artifact_path(root, relpath)) != old_time;
+        EXPECT_EQ(is_rebuilt, relpath == "left") << relpath;
+    }
+    EXPECT_EQ(clr.child(library_key("left"))->stamp().artifact_path, artifact_path(root, "left").string());
+}
+
+TEST(LibraryTests, ImportCycleIsReported) {
+    std::filesystem::path root = make_snail_root("ss-test-lib-cycle");
+    write_library(root, "ping", "(import (pong)) (define ping-val 1)");
+    write_library(root, "pong", "(import (ping)) (define pong-val 2)");
+    write_library(root, "solo", "(define solo-val 3)");
+    ss::CentralLibraryRepository clr;
+    ASSERT_TRUE(clr.try_init_instance(root.string(), true));
+
+    // the cycle fails up front, rather than waiting on itself, and the rest is still built:
+    std::vector<ss::BaseLibrary*> order;
+    EXPECT_FALSE(clr.precompile(4));
+    EXPECT_FALSE(ss::precompile_libraries(clr.children(), 4, &order));
+    EXPECT_EQ(order, std::vector<ss::BaseLibrary*>{clr.child(library_key("solo"))});
+    EXPECT_FALSE(std::filesystem::exists(artifact_path(root, "ping")));
+    EXPECT_FALSE(std::filesystem::exists(artifact_path(root, "pong")));
+    EXPECT_TRUE(clr.child(library_key("ping"))->stamp().artifact_path.empty());
+}
+
+TEST(LibraryTests, ParallelBuildMatchesSerialBuild) {
+    std::filesystem::path root = make_snail_root("ss-test-lib-parallel");
+    write_diamond(root);
+    ss::CentralLibraryRepository clr;
+    ASSERT_TRUE(clr.try_init_instance(root.string(), true));
+
+    std::vector<std::string> relpaths{"base", "left", "right", "top"};
+    std::vector<std::string> serial_artifacts;
+    ASSERT_TRUE(clr.precompile(1));
+    for (std::string const& relpath: relpaths) {
+        serial_artifacts.push_back(read_file(artifact_path(root, relpath)));
+        EXPECT_FALSE(serial_artifacts.back().empty()) << relpath;
+        std::filesystem::remove(artifact_path(root, relpath));
+    }
+    ASSERT_TRUE(clr.precompile(4));
+    for (size_t i = 0; i < relpaths.size(); i++) {
+        EXPECT_EQ(read_file(artifact_path(root, relpaths[i])), serial_artifacts[i]) << relpaths[i];
+    }
+}
+
+TEST(LibraryTests, InstallPrecompilesSubLibraries) {
+    std::filesystem::path root = make_snail_root("ss-test-lib-install");
+    std::filesystem::path src = std::filesystem::temp_directory_path() / "ss-test-lib-install-src" / "pkg";
+    std::filesystem::remove_all(src.parent_path());
+    std::filesystem::create_directories(src / "util");
+    std::ofstream{src / "util" / "main.scm"} << "(define util-val 1)";
+    std::ofstream{src / "main.scm"} << "(import (pkg util)) (define pkg-val (p/invoke + util-val 1))";
+
+    ss::CentralLibraryRepository clr;
+    ASSERT_TRUE(clr.try_init_instance(root.string(), false));
+    ASSERT_TRUE(clr.install(src, library_key("pkg")));
+    EXPECT_TRUE(std::filesystem::exists(artifact_path(root, "pkg")));
+    EXPECT_TRUE(std::filesystem::exists(artifact_path(root, "pkg/util")));
+
+    // the index records each artifact:
+    ss::CentralLibraryRepository loaded;
+    ASSERT_TRUE(loaded.try_init_instance(root.string(), false));
+    EXPECT_EQ(index_entries(loaded), index_entries(clr));
+    ss::BaseLibrary* pkg = loaded.child(library_key("pkg"));
+    ASSERT_NE(pkg, nullptr);
+    EXPECT_EQ(pkg->stamp().artifact_path, artifact_path(root, "pkg").string());
+}
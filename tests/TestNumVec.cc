@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cstdint>
+
+#include "ss-core/numvec.hh"
+
+///
+/// NUMERIC VECTOR TESTS
+/// - lengths are chosen so that each kernel runs both its SIMD blocks (if any) and its scalar tail.
+///
+
+TEST(NumVecTests, FloatKernelsMatchScalarLoops) {
+    size_t const n = 11;
+    std::vector<double> a(n), b(n), dst(n);
+    for (size_t i = 0; i < n; i++) {
+        a[i] = static_cast<double>(i) + 0.5;
+        b[i] = 2.0 * static_cast<double>(n - i);
+    }
+    ss::NumVectorKernels<double>::add(dst.data(), a.data(), b.data(), n);
+    for (size_t i = 0; i < n; i++) {
+        EXPECT_EQ(dst[i], a[i] + b[i]);
+    }
+    ss::NumVectorKernels<double>::scale(dst.data(), dst.data(), 0.5, n);
+    for (size_t i = 0; i < n; i++) {
+        EXPECT_EQ(dst[i], (a[i] + b[i]) * 0.5);
+    }
+    double expected_dot = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        expected_dot += a[i] * b[i];
+    }
+    EXPECT_DOUBLE_EQ(ss::NumVectorKernels<double>::dot(a.data(), b.data(), n), expected_dot);
+    EXPECT_EQ(ss::NumVectorKernels<double>::min(b.data(), n), 2.0);
+    EXPECT_EQ(ss::NumVectorKernels<double>::max(b.data(), n), 2.0 * n);
+
+    std::vector<float> f = {3, -1, 4, 1, -5, 9, 2};
+    EXPECT_EQ(ss::NumVectorKernels<float>::sum(f.data(), f.size()), 13.0f);
+    EXPECT_EQ(ss::NumVectorKernels<float>::min(f.data(), f.size()), -5.0f);
+    EXPECT_EQ(ss::NumVectorKernels<float>::max(f.data(), f.size()), 9.0f);
+}
+
+TEST(NumVecTests, IntegerKernelsWrapAndWiden) {
+    std::vector<uint8_t> a = {200, 100, 255};
+    std::vector<uint8_t> dst(a.size());
+    ss::NumVectorKernels<uint8_t>::add(dst.data(), a.data(), a.data(), a.size());
+    EXPECT_EQ(dst, (std::vector<uint8_t>{144, 200, 254}));
+    EXPECT_EQ(ss::NumVectorKernels<uint8_t>::sum(a.data(), a.size()), 555);
+    EXPECT_EQ(ss::NumVectorKernels<uint8_t>::dot(a.data(), a.data(), a.size()), 200*200 + 100*100 + 255*255);
+
+    std::vector<int64_t> s = {INT64_MAX, 1, -7};
+    std::vector<int64_t> s_dst(s.size());
+    ss::NumVectorKernels<int64_t>::add(s_dst.data(), s.data(), s.data(), s.size());
+    EXPECT_EQ(s_dst[0], -2);
+    EXPECT_EQ(s_dst[2], -14);
+    EXPECT_EQ(ss::NumVectorKernels<int64_t>::min(s.data(), s.size()), -7);
+}
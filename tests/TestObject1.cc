@@ -3,6 +3,10 @@
 #include "ss-core/object.1.hh"
 #include "ss-core/gc.hh"
 #include <bitset>
+#include <limits>
+#include <cmath>
+
+#include "TestHeap.hh"
 
 ///
 /// TAG TESTS
@@ -56,4 +60,113 @@ TEST(ObjectTests1, PtrTagTests) {
     
     DBG_PRINT("PtrTagTests: PTR:  " << std::bitset<64>(p1.as_raw()));
     DBG_PRINT("PtrTagTests: BITS: " << std::bitset<64>(p1.as_raw()));
-}
\ No newline at end of file
+}
+
+///
+/// HEAP OBJECT TESTS
+/// - each test allocates from a heap of its own, cf `HeapTest`.
+///
+
+class ObjectHeapTests: public HeapTest<> {};
+
+TEST_F(ObjectHeapTests, ClosureTests) {
+    ss::OBJECT c = ss::OBJECT::make_closure(&gc_tfe, 42, 2);
+    c.as_closure_p()->free_vars()[0] = ss::OBJECT::make_integer(7);
+    c.as_closure_p()->free_vars()[1] = ss::OBJECT::null;
+
+    EXPECT_EQ(c.is_closure(), 1);
+    EXPECT_EQ(c.is_vector(), 0);
+    EXPECT_EQ(c.kind(), ss::ObjectKind::Closure);
+    EXPECT_EQ(c.as_closure_p()->body(), 42);
+    EXPECT_EQ(c.as_closure_p()->count(), 2);
+    EXPECT_EQ((*c.as_closure_p())[0].as_integer(), 7);
+    EXPECT_EQ((*c.as_closure_p())[1].is_null(), 1);
+}
+TEST_F(ObjectHeapTests, InlineVectorAndStringTests) {
+    char msg_buf[] = {'h', 'i'};
+    ss::OBJECT s = ss::OBJECT::make_string(&gc_tfe, sizeof(msg_buf), msg_buf, false);
+    auto str = static_cast<ss::StringObject*>(s.as_ptr());
+    EXPECT_EQ(str->count(), 2);
+    EXPECT_STREQ(str->bytes(), "hi");
+    EXPECT_EQ(reinterpret_cast<char*>(str->bytes()), reinterpret_cast<char*>(str + 1));
+
+    // items sit right after the header, and a full vector is copied into a larger one:
+    ss::OBJECT v = ss::OBJECT::make_vector(&gc_tfe, 0, 2);
+    ss::OBJECT first = v;
+    for (ssize_t i = 0; i < 100; i++) {
+        v = ss::vector_push(&gc_tfe, v, ss::OBJECT::make_integer(i));
+    }
+    EXPECT_EQ(v.is_vector(), 1);
+    EXPECT_NE(v.as_ptr(), first.as_ptr());
+    EXPECT_EQ(first.as_vector_p()->count(), 2);
+    EXPECT_EQ(v.as_vector_p()->count(), 100);
+    EXPECT_GE(v.as_vector_p()->capacity(), 100);
+    EXPECT_EQ(v.as_vector_p()->array(), reinterpret_cast<ss::OBJECT*>(v.as_vector_p() + 1));
+    for (ssize_t i = 0; i < 100; i++) {
+        EXPECT_EQ(ss::vector_ref(v, ss::OBJECT::make_integer(i)).as_integer(), i);
+    }
+}
+TEST_F(ObjectHeapTests, Float64RoundTripTests) {
+    // doubles of moderate magnitude are immediate where enabled; the rest are boxed:
+    double const immediates[] = {0.0, -0.0, 1.0, -2.5, 3.141592653589793, 1e-70, -1e70};
+    double const boxed[] = {1e300, -1e-300, 5e-324, std::numeric_limits<double>::infinity()};
+    for (double d: immediates) {
+        ss::OBJECT o = ss::OBJECT::make_float64(&gc_tfe, d);
+        EXPECT_EQ(o.is_float64(), 1);
+        EXPECT_EQ(o.is_integer(), 0);
+        EXPECT_EQ(o.kind(), ss::ObjectKind::Float64);
+        EXPECT_EQ(o.is_ptr(), !CONFIG_IMMEDIATE_FLOAT64);
+        EXPECT_EQ(std::bit_cast<uint64_t>(o.as_float64()), std::bit_cast<uint64_t>(d));
+    }
+    for (double d: boxed) {
+        ss::OBJECT o = ss::OBJECT::make_float64(&gc_tfe, d);
+        EXPECT_EQ(o.is_float64(), 1);
+        EXPECT_EQ(o.is_ptr(), 1);
+        EXPECT_EQ(std::bit_cast<uint64_t>(o.as_float64()), std::bit_cast<uint64_t>(d));
+    }
+    EXPECT_EQ(ss::OBJECT::make_float64(&gc_tfe, std::nan("")).is_float64(), 1);
+
+    // fixnums keep their sign, and immediate doubles cost them a bit:
+    EXPECT_EQ(ss::OBJECT::make_integer(-42).as_integer(), -42);
+    EXPECT_EQ(ss::OBJECT::FIXNUM_TAG_BITS, 1 + CONFIG_IMMEDIATE_FLOAT64);
+    ssize_t const fixnum_max = (ssize_t{1} << (63 - ss::OBJECT::FIXNUM_TAG_BITS)) - 1;
+    EXPECT_EQ(ss::OBJECT::make_integer(fixnum_max).as_integer(), fixnum_max);
+    EXPECT_EQ(ss::OBJECT::make_integer(-fixnum_max - 1).as_integer(), -fixnum_max - 1);
+}
+TEST_F(ObjectHeapTests, HashTableEquivalenceTests) {
+    char msg_buf[] = {'h', 'i'};
+    ss::OBJECT s1 = ss::OBJECT::make_string(&gc_tfe, sizeof(msg_buf), msg_buf, false);
+    ss::OBJECT s2 = ss::OBJECT::make_string(&gc_tfe, sizeof(msg_buf), msg_buf, false);
+    ss::OBJECT l1 = ss::list(&gc_tfe, ss::OBJECT::make_integer(1), s1);
+    ss::OBJECT l2 = ss::list(&gc_tfe, ss::OBJECT::make_integer(1), s2);
+
+    // 'equal?' tables find structurally equal keys; 'eq?' tables only the same object:
+    ss::OBJECT equal_table = ss::OBJECT::make_hash_table(&gc_tfe, ss::HashTableEquivalence::Equal);
+    ss::OBJECT eq_table = ss::OBJECT::make_hash_table(&gc_tfe, ss::HashTableEquivalence::Eq);
+    for (ss::OBJECT t: {equal_table, eq_table}) {
+        t.as_hash_table_p()->set(l1, ss::OBJECT::make_integer(7));
+    }
+    EXPECT_EQ(ss::hash_equal(l1), ss::hash_equal(l2));
+    ASSERT_NE(equal_table.as_hash_table_p()->find(l2), nullptr);
+    EXPECT_EQ(equal_table.as_hash_table_p()->find(l2)->as_integer(), 7);
+    EXPECT_EQ(eq_table.as_hash_table_p()->find(l2), nullptr);
+    EXPECT_NE(eq_table.as_hash_table_p()->find(l1), nullptr);
+
+    // 'eqv?' compares floats by value, so both zeroes are one key:
+    ss::OBJECT eqv_table = ss::OBJECT::make_hash_table(&gc_tfe, ss::HashTableEquivalence::Eqv);
+    eqv_table.as_hash_table_p()->set(ss::OBJECT::make_float64(&gc_tfe, 0.0), ss::OBJECT::make_integer(1));
+    eqv_table.as_hash_table_p()->set(ss::OBJECT::make_float64(&gc_tfe, -0.0), ss::OBJECT::make_integer(2));
+    EXPECT_EQ(eqv_table.as_hash_table_p()->count(), 1u);
+    EXPECT_TRUE(eqv_table.as_hash_table_p()->remove(ss::OBJECT::make_float64(&gc_tfe, 0.0)));
+    EXPECT_EQ(eqv_table.as_hash_table_p()->count(), 0u);
+
+    // 'eqv?' compares pairs by identity, so a key is still found after it is mutated:
+    ss::OBJECT key = ss::cons(&gc_tfe, ss::OBJECT::make_integer(1), ss::OBJECT::make_integer(2));
+    ss::OBJECT twin = ss::cons(&gc_tfe, ss::OBJECT::make_integer(1), ss::OBJECT::make_integer(2));
+    eqv_table.as_hash_table_p()->set(key, ss::OBJECT::make_integer(3));
+    EXPECT_EQ(eqv_table.as_hash_table_p()->find(twin), nullptr);
+    ss::set_car(key, ss::OBJECT::make_integer(4));
+    ss::set_cdr(key, ss::OBJECT::make_integer(5));
+    ASSERT_NE(eqv_table.as_hash_table_p()->find(key), nullptr);
+    EXPECT_EQ(eqv_table.as_hash_table_p()->find(key)->as_integer(), 3);
+}
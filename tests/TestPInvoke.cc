@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+
+#include "ss-core/pinvoke.hh"
+#include "ss-core/intern.hh"
+
+///
+/// PLATFORM PROCEDURE TESTS
+/// - arguments are pushed last-to-first, as 'p/invoke' does.
+///
+
+static ss::OBJECT sub2(void* ctx, ss::OBJECT a0, ss::OBJECT a1) {
+    *static_cast<int*>(ctx) += 1;
+    return ss::OBJECT::make_integer(a0.as_integer() - a1.as_integer());
+}
+static ss::OBJECT count_args(void*, ss::ArgSpan args) {
+    return ss::OBJECT::make_integer(args.size() * 100 + args[0].as_integer());
+}
+
+TEST(PInvokeTests, CallsFixedArityFnWithCtx) {
+    ss::PlatformProcTable tab;
+    int call_count = 0;
+    auto id = tab.define(ss::intern("pinvoke-test-sub2"), {ss::intern("a"), ss::intern("b")}, {sub2, &call_count}, "");
+    EXPECT_EQ(tab.metadata(id).arity, 2);
+
+    ss::VmStack stack{8};
+    ssize_t s = 0;
+    s = stack.push(ss::OBJECT::make_integer(3), s);
+    s = stack.push(ss::OBJECT::make_integer(10), s);
+    EXPECT_EQ(tab.call(id, stack, s, 2).as_integer(), 7);
+    EXPECT_EQ(tab.cb(id)(ss::ArgView{stack, s, 2}).as_integer(), 7);
+    EXPECT_EQ(call_count, 2);
+}
+TEST(PInvokeTests, CallsVariadicFnWithSpan) {
+    ss::PlatformProcTable tab;
+    auto id = tab.define(ss::intern("pinvoke-test-count"), {}, {count_args, nullptr}, "");
+    EXPECT_EQ(tab.metadata(id).arity, -1);
+
+    ss::VmStack stack{8};
+    ssize_t s = 0;
+    s = stack.push(ss::OBJECT::make_integer(2), s);
+    s = stack.push(ss::OBJECT::make_integer(1), s);
+    s = stack.push(ss::OBJECT::make_integer(5), s);
+    EXPECT_EQ(tab.call(id, stack, s, 3).as_integer(), 305);
+    EXPECT_EQ(tab.cb(id)(ss::ArgView{stack, s, 3}).as_integer(), 305);
+}
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ss-core/parser.hh"
+#include "ss-core/printing.hh"
+#include "ss-core/gc.hh"
+
+///
+/// PARALLEL PARSING TESTS
+///
+
+static std::string line_text(ss::OBJECT line) {
+    std::stringstream ss;
+    ss::FLoc loc = line.as_syntax_p()->loc();
+    ss << line << " @ " << loc.as_text();
+    return ss.str();
+}
+
+TEST(ParserTests, ParallelParseMatchesSerialParse) {
+    // parens in comments and strings must not end a top-level form:
+    std::stringstream source_ss;
+    for (size_t i = 0; i < 5000; i++) {
+        source_ss
+            << "; comment ) (" << std::endl
+            << "(define s" << i << " \"str ) \\\" (\")" << std::endl
+            << "'(a (b)) (define v" << i << "\r\n  (p/invoke + v" << i << " 1))" << std::endl;
+    }
+    std::string source = source_ss.str();
+
+    std::vector<ss::SourceChunk> chunks = ss::split_top_level_forms(source, 4096);
+    ASSERT_GT(chunks.size(), 1);
+    size_t expected_offset = 0;
+    for (ss::SourceChunk const& chunk: chunks) {
+        EXPECT_EQ(chunk.offset, expected_offset);
+        expected_offset += chunk.size;
+    }
+    EXPECT_EQ(expected_offset, source.size());
+
+    ss::Gc parser_gc{ss::GIBIBYTES(1)};
+    ss::GcThreadFrontEnd gc_tfe{&parser_gc};
+    std::vector<std::string> serial_lines;
+    std::vector<std::string> parallel_lines;
+    size_t parallel_chunk_count = 0;
+    ss::parse_all_lines_in_parallel(source, "test", &gc_tfe, 1, [&] (std::vector<ss::OBJECT> lines) {
+        for (ss::OBJECT line: lines) {
+            serial_lines.push_back(line_text(line));
+        }
+    });
+    ss::parse_all_lines_in_parallel(source, "test", &gc_tfe, 4, [&] (std::vector<ss::OBJECT> lines) {
+        parallel_chunk_count++;
+        for (ss::OBJECT line: lines) {
+            parallel_lines.push_back(line_text(line));
+        }
+    });
+    EXPECT_GT(parallel_chunk_count, 1);
+    EXPECT_EQ(serial_lines.size(), 5000 * 3);
+    EXPECT_EQ(serial_lines, parallel_lines);
+}
+
+///
+/// LEXER TESTS
+/// - tokens are longer than the lexer's 16-byte blocks, so that runs are scanned across blocks.
+///
+
+TEST(ParserTests, ScansTokensAcrossBlocks) {
+    std::string source = (
+        "; a comment that is long enough to span more than one 16-byte block ( \"\r\n"
+        "(define a-very-long-identifier-name-that-spans-several-blocks\n"
+        "  \"a string literal that spans more than one block\")\n"
+        "\"escape after a long run of plain characters: \\\" \\\\ \\n\"\n"
+        "\"CRLF\r\ninside\" \"LF\ninside\"   \t  x\r\n"
+    );
+    std::vector<std::string> expected_lines = {
+        "(syntax ((syntax define) (syntax a-very-long-identifier-name-that-spans-several-blocks) "
+        "(syntax \"a string literal that spans more than one block\"))) @ test:2:1-3:53",
+        "(syntax \"escape after a long run of plain characters: \\\" \\ \\n\") @ test:4:1-56",
+        "(syntax \"CRLF\\rinside\") @ test:5:1-6:8",
+        "(syntax \"LF\\ninside\") @ test:6:9-7:8",
+        "(syntax x) @ test:7:14-15",
+    };
+
+    ss::Gc parser_gc{ss::GIBIBYTES(1)};
+    ss::GcThreadFrontEnd gc_tfe{&parser_gc};
+    ss::Parser* p = ss::create_parser(std::string_view{source}, "test", &gc_tfe);
+    std::vector<std::string> lines;
+    for (ss::OBJECT line: ss::parse_all_subsequent_lines(p)) {
+        lines.push_back(line_text(line));
+    }
+    ss::dispose_parser(p);
+    EXPECT_EQ(lines, expected_lines);
+}
+
+///
+/// STREAMING PARSING TESTS
+/// - each top-level form is delivered as soon as it is read, with the positions a whole-source parse gives.
+///
+
+TEST(ParserTests, StreamParseMatchesSerialParse) {
+    std::string source = (
+        "; comment ) (\n"
+        "(define s \"str ) \\\" (\")  'sym #t\r\n"
+        "'(a (b) \"c\r\nd\") (define v\r\n  (p/invoke + 1 2))\n"
+        "  3.5 ; trailing comment\n"
+        "x"
+    );
+
+    ss::Gc parser_gc{ss::GIBIBYTES(1)};
+    ss::GcThreadFrontEnd gc_tfe{&parser_gc};
+    std::vector<std::string> serial_lines;
+    ss::Parser* p = ss::create_parser(std::string_view{source}, "test", &gc_tfe);
+    for (ss::OBJECT line: ss::parse_all_subsequent_lines(p)) {
+        serial_lines.push_back(line_text(line));
+    }
+    ss::dispose_parser(p);
+
+    std::istringstream source_stream{source};
+    std::vector<std::string> stream_lines;
+    size_t batch_count = 0;
+    ss::parse_each_line_from_stream(source_stream, "test", &gc_tfe, [&] (std::vector<ss::OBJECT> lines) {
+        batch_count++;
+        for (ss::OBJECT line: lines) {
+            stream_lines.push_back(line_text(line));
+        }
+    });
+    EXPECT_EQ(serial_lines.size(), 7);
+    EXPECT_EQ(batch_count, serial_lines.size());
+    EXPECT_EQ(stream_lines, serial_lines);
+}
+
+///
+/// LOCATION TESTS
+/// - locations are kept in tables aside from syntax objects, and quoted data are not wrapped node by node.
+///
+
+TEST(ParserTests, KeepsLocationsInSideTables) {
+    std::string source = (
+        "'(a (b . c) \"d\")\n"
+        "(define (f x)\n"
+        "  (g x 12))"
+    );
+
+    ss::Gc parser_gc{ss::GIBIBYTES(1)};
+    ss::GcThreadFrontEnd gc_tfe{&parser_gc};
+    ss::Parser* p = ss::create_parser(std::string_view{source}, "test", &gc_tfe);
+    std::vector<ss::OBJECT> lines = ss::parse_all_subsequent_lines(p);
+    ss::dispose_parser(p);
+    ASSERT_EQ(lines.size(), 2);
+
+    // (quote datum): the datum is wrapped once, as a whole.
+    ss::SyntaxObject* quote_stx = lines[0].as_syntax_p();
+    EXPECT_EQ(quote_stx->loc().as_text(), "test:1:1-17");
+    ss::SyntaxObject* quoted_stx = ss::cadr(quote_stx->data()).as_syntax_p();
+    EXPECT_TRUE(quoted_stx->is_datum());
+    EXPECT_EQ(quoted_stx->loc().as_text(), "test:1:2-17");
+    std::stringstream quoted_ss;
+    quoted_ss << quoted_stx->data();
+    EXPECT_EQ(quoted_ss.str(), "(a (b . c) \"d\")");
+    EXPECT_EQ(ss::cadr(quote_stx->to_datum(&gc_tfe)).as_raw(), quoted_stx->data().as_raw());
+
+    // code is wrapped node by node, each with its own span:
+    ss::SyntaxObject* define_stx = lines[1].as_syntax_p();
+    EXPECT_FALSE(define_stx->is_datum());
+    EXPECT_EQ(define_stx->loc().as_text(), "test:2:1-3:12");
+    ss::SyntaxObject* body_stx = ss::car(ss::cdr(ss::cdr(define_stx->data()))).as_syntax_p();
+    EXPECT_EQ(body_stx->loc().as_text(), "test:3:3-11");
+    EXPECT_EQ(ss::car(ss::cdr(ss::cdr(body_stx->data()))).as_syntax_p()->loc().as_text(), "test:3:8-10");
+
+    // a dropped table's locations are unknown:
+    ss::FLocTable::drop(define_stx->loc_id());
+    EXPECT_EQ(body_stx->loc().source, ss::intern("<unknown>"));
+    EXPECT_EQ(quote_stx->loc().as_text(), "test:1:1-17");
+    ss::FLocTable::drop(quote_stx->loc_id());
+}
+
+TEST(ParserTests, DecodesDeltaEncodedSpans) {
+    ss::FLocTable* table = ss::FLocTable::create(ss::intern("test"));
+    std::vector<std::pair<ss::FLocID, ss::FLocSpan>> spans;
+    for (long i = 0; i < 100; i++) {
+        // spans move back and forth, e.g. a list's after its elements', and across lines:
+        long line = (i % 7 == 0) ? 3*i : 3*i - 5;
+        ss::FLocSpan span{{line, (i * 37) % 90}, {line + i % 3, (i * 11) % 120}};
+        if (i % 3 == 0 && span.last_pos.column_index < span.first_pos.column_index) {
+            span.last_pos.column_index = span.first_pos.column_index + 1;
+        }
+        spans.push_back({table->add(span), span});
+    }
+    EXPECT_LT(table->size_in_bytes(), spans.size() * 8);
+    for (auto const& [id, span]: spans) {
+        ss::FLoc loc = ss::FLocTable::loc(id);
+        EXPECT_EQ(loc.source, ss::intern("test"));
+        EXPECT_EQ(loc.span.first_pos.line_index, span.first_pos.line_index);
+        EXPECT_EQ(loc.span.first_pos.column_index, span.first_pos.column_index);
+        EXPECT_EQ(loc.span.last_pos.line_index, span.last_pos.line_index);
+        EXPECT_EQ(loc.span.last_pos.column_index, span.last_pos.column_index);
+    }
+
+    // a table's slot is reused once it is dropped, but its IDs are not:
+    size_t live_count = ss::FLocTable::count_live_tables();
+    ss::FLocTable::drop(spans[0].first);
+    EXPECT_EQ(ss::FLocTable::count_live_tables(), live_count - 1);
+    ss::FLocTable* next_table = ss::FLocTable::create(ss::intern("next"));
+    ss::FLocID next_id = next_table->add({{0, 0}, {0, 1}});
+    EXPECT_EQ(ss::FLocTable::loc(spans[0].first).source, ss::intern("<unknown>"));
+    EXPECT_EQ(ss::FLocTable::loc(next_id).source, ss::intern("next"));
+    ss::FLocTable::drop(next_id);
+}
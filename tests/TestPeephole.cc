@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include "ss-core/vcode.hh"
+#include "ss-core/peephole.hh"
+
+///
+/// SUPERINSTRUCTION TESTS
+/// - VCode is built by hand, mirroring what the compiler emits for calls.
+///
+
+TEST(PeepholeTests, FusesArgumentPushes) {
+    ss::VCode code;
+    auto halt = code.new_vmx_halt();
+    auto pinvoke = code.new_vmx_pinvoke(2, 0, halt);
+    auto refer = code.new_vmx_refer_local(0, code.new_vmx_argument(pinvoke));
+    auto constant = code.new_vmx_constant(ss::OBJECT::make_integer(1), code.new_vmx_argument(refer));
+
+    EXPECT_EQ(ss::fuse_superinstructions(code), 2);
+    EXPECT_EQ(code[refer].kind, ss::VmExpKind::ReferLocalPush);
+    EXPECT_EQ(code[refer].args.i_refer.x, pinvoke);
+    EXPECT_EQ(code[constant].kind, ss::VmExpKind::ConstantPush);
+    EXPECT_EQ(code[constant].args.i_constant.x, refer);
+}
+TEST(PeepholeTests, FusesGlobalTailCall) {
+    ss::VCode code;
+    auto shift = code.new_vmx_shift(1, 2, code.new_vmx_apply());
+    auto refer = code.new_vmx_refer_global(7, shift);
+
+    EXPECT_EQ(ss::fuse_superinstructions(code), 2);
+    EXPECT_EQ(code[shift].kind, ss::VmExpKind::ShiftApply);
+    EXPECT_EQ(code[refer].kind, ss::VmExpKind::ReferGlobalShiftApply);
+    EXPECT_EQ(code[refer].args.i_refer_global_shift.gn, 7);
+    EXPECT_EQ(code[refer].args.i_refer_global_shift.n, 1);
+    EXPECT_EQ(code[refer].args.i_refer_global_shift.m, 2);
+}
+TEST(PeepholeTests, LeavesUnmatchedChains) {
+    ss::VCode code;
+    auto refer = code.new_vmx_refer_free(0, code.new_vmx_halt());
+
+    EXPECT_EQ(ss::fuse_superinstructions(code), 0);
+    EXPECT_EQ(code[refer].kind, ss::VmExpKind::ReferFree);
+}
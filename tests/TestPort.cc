@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "ss-core/port.hh"
+#include "ss-core/object.hh"
+#include "ss-core/intern.hh"
+#include "ss-core/vm.hh"
+#include "ss-core/parser.hh"
+
+#include "TestHeap.hh"
+
+///
+/// PORT TESTS
+/// - each port writes to a temporary file, which is read back to see what the port has written out so far.
+///
+
+static std::string written_text(std::FILE* file) {
+    std::string text;
+    std::rewind(file);
+    for (int c = std::fgetc(file); c != EOF; c = std::fgetc(file)) {
+        text.push_back(static_cast<char>(c));
+    }
+    std::fseek(file, 0, SEEK_END);
+    return text;
+}
+
+TEST(PortTests, BufferModesPickWhenToFlush) {
+    std::FILE* file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    {
+        ss::OutputPort port{file, ss::PortBufferMode::Block, 64};
+        {
+            ss::OutputPortWriter writer{port};
+            port.write("count: ");
+            port.write_integer(-42);
+            port.put('\n');
+        }
+        EXPECT_EQ(written_text(file), "");
+        port.flush();
+        EXPECT_EQ(written_text(file), "count: -42\n");
+
+        port.set_mode(ss::PortBufferMode::Line);
+        {
+            ss::OutputPortWriter writer{port};
+            port.write_float64(2.5);
+        }
+        EXPECT_EQ(written_text(file), "count: -42\n");
+        {
+            ss::OutputPortWriter writer{port};
+            port.put('\n');
+        }
+        EXPECT_EQ(written_text(file), "count: -42\n2.5\n");
+
+        // writes longer than the buffer go straight through:
+        std::string long_text(100, 'x');
+        {
+            ss::OutputPortWriter writer{port};
+            port.write(long_text);
+        }
+        EXPECT_EQ(written_text(file), "count: -42\n2.5\n" + long_text);
+
+        port.set_mode(ss::PortBufferMode::Block);
+        {
+            ss::OutputPortWriter writer{port};
+            port.write_float32(0.1f);
+        }
+    }
+    // ports are flushed when destroyed:
+    EXPECT_EQ(written_text(file), "count: -42\n2.5\n" + std::string(100, 'x') + "0.1");
+    std::fclose(file);
+}
+
+///
+/// INPUT PORT TESTS
+/// - files are written to the temporary directory, then read back: regular files are mapped, while a pipe is read
+///   in chunks, whose boundaries fall wherever the pipe runs dry.
+///
+
+// room for a few chunks, cf `CONFIG_INPUT_PORT_CHUNK_BYTES`:
+class InputPortTests: public HeapTest<(16 << 20)> {};
+
+// write_temp_file writes `text` to a file named `name` in the temporary directory, returning its path.
+static std::string write_temp_file(std::string const& name, std::string const& text) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    out << text;
+    return path.string();
+}
+static std::string string_text(ss::OBJECT str) {
+    return std::string{str.as_string_p()->bytes(), str.as_string_p()->count()};
+}
+// read_lines reads each line left in `port`.
+static std::vector<std::string> read_lines(ss::GcThreadFrontEnd* gc_tfe, ss::InputPortObject* port) {
+    std::vector<std::string> res;
+    for (ss::OBJECT line = ss::read_line(gc_tfe, port); !line.is_eof(); line = ss::read_line(gc_tfe, port)) {
+        res.push_back(string_text(line));
+    }
+    return res;
+}
+
+TEST_F(InputPortTests, ReadLineStripsLfAndCrLf) {
+    std::string path = write_temp_file("ss-port-lines.txt", "one\ntwo\r\n\r\nthree\rfour\nlast");
+    ss::OBJECT port = ss::open_input_file(&gc_tfe, path);
+    ASSERT_TRUE(port.is_input_port());
+
+    // a lone CR is not a line ending, and the last line needs none:
+    std::vector<std::string> expected{"one", "two", "", "three\rfour", "last"};
+    EXPECT_EQ(read_lines(&gc_tfe, port.as_input_port_p()), expected);
+    EXPECT_TRUE(ss::read_line(&gc_tfe, port.as_input_port_p()).is_eof());
+    EXPECT_TRUE(ss::read_char(&gc_tfe, port.as_input_port_p()).is_eof());
+}
+
+#ifndef _WIN32
+TEST_F(InputPortTests, ReadsCrossChunkBoundaries) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    ss::OBJECT port = ss::OBJECT::make_input_port(&gc_tfe, ss::intern("<pipe>"), fds[0]);
+    ss::InputPortObject* port_p = port.as_input_port_p();
+    auto write_pipe = [&] (std::string_view text) {
+        ASSERT_EQ(write(fds[1], text.data(), text.size()), static_cast<ssize_t>(text.size()));
+    };
+
+    // each fill reads only what the pipe holds, so each write is a chunk of its own:
+    write_pipe("abc");
+    EXPECT_EQ(ss::read_char(&gc_tfe, port_p).as_integer(), 'a');
+    ss::OBJECT first_chunk = port_p->bytes_owner();
+    write_pipe("def");
+    ss::OBJECT crossing = ss::read_string(&gc_tfe, port_p, 4);
+    EXPECT_EQ(string_text(crossing), "bcde");
+    EXPECT_NE(port_p->bytes_owner().as_raw(), first_chunk.as_raw());
+    EXPECT_EQ(crossing.as_string_p()->base().as_raw(), port_p->bytes_owner().as_raw());
+    EXPECT_EQ(ss::peek_char(&gc_tfe, port_p).as_integer(), 'f');
+    EXPECT_EQ(ss::read_char(&gc_tfe, port_p).as_integer(), 'f');
+    write_pipe("g");
+    EXPECT_EQ(ss::read_char(&gc_tfe, port_p).as_integer(), 'g');
+
+    // a CRLF split across chunks is still one line ending:
+    write_pipe("line one\r");
+    EXPECT_EQ(ss::peek_char(&gc_tfe, port_p).as_integer(), 'l');
+    write_pipe("\nline two\n");
+    ss::OBJECT line = ss::read_line(&gc_tfe, port_p);
+    EXPECT_EQ(string_text(line), "line one");
+    EXPECT_EQ(string_text(ss::read_line(&gc_tfe, port_p)), "line two");
+
+    // reads stop short at EOF:
+    write_pipe("xy");
+    close(fds[1]);
+    EXPECT_EQ(string_text(ss::read_string(&gc_tfe, port_p, 10)), "xy");
+    EXPECT_TRUE(ss::read_string(&gc_tfe, port_p, 1).is_eof());
+    EXPECT_TRUE(ss::read_char(&gc_tfe, port_p).is_eof());
+
+    // slices keep their chunk, and not the port, alive:
+    EXPECT_TRUE(crossing.as_string_p()->base().is_string());
+    EXPECT_EQ(string_text(crossing), "bcde");
+}
+
+TEST_F(InputPortTests, MappedAndChunkedPortsReadAlike) {
+    std::string text = "(define x 1)\nsecond line\r\n\nthird\n";
+    ss::OBJECT mapped = ss::open_input_file(&gc_tfe, write_temp_file("ss-port-mapped.txt", text));
+    ASSERT_TRUE(mapped.is_input_port());
+
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    ASSERT_EQ(write(fds[1], text.data(), text.size()), static_cast<ssize_t>(text.size()));
+    close(fds[1]);
+    ss::OBJECT chunked = ss::OBJECT::make_input_port(&gc_tfe, ss::intern("<pipe>"), fds[0]);
+
+    // slices of a mapped file refer to the port, which owns the mapping; those of a pipe, to its chunk:
+    ss::OBJECT mapped_head = ss::read_string(&gc_tfe, mapped.as_input_port_p(), 7);
+    ss::OBJECT chunked_head = ss::read_string(&gc_tfe, chunked.as_input_port_p(), 7);
+    EXPECT_EQ(string_text(mapped_head), "(define");
+    EXPECT_EQ(string_text(chunked_head), "(define");
+    EXPECT_TRUE(mapped_head.as_string_p()->is_slice());
+    EXPECT_TRUE(chunked_head.as_string_p()->is_slice());
+    EXPECT_EQ(mapped_head.as_string_p()->base().as_raw(), mapped.as_raw());
+    EXPECT_TRUE(chunked_head.as_string_p()->base().is_string());
+
+    std::vector<std::string> expected{" x 1)", "second line", "", "third"};
+    EXPECT_EQ(read_lines(&gc_tfe, mapped.as_input_port_p()), expected);
+    EXPECT_EQ(read_lines(&gc_tfe, chunked.as_input_port_p()), expected);
+}
+#endif
+
+// eval_lines runs each line of `source` on `vm`, returning the last one's value as written.
+static std::string eval_lines(ss::VirtualMachine* vm, std::string const& source) {
+    ss::Parser* p = ss::create_parser(std::string_view{source}, "<test>", ss::vm_gc_tfe(vm));
+    std::vector<ss::OBJECT> lines = ss::parse_all_subsequent_lines(p);
+    ss::dispose_parser(p);
+    std::stringstream out;
+    out << ss::vm_stream_lines(vm, std::move(lines), false);
+    return out.str();
+}
+
+TEST(InputPortEvalTests, StringSetCopiesReadStringSlices) {
+    std::string path = write_temp_file("ss-port-cow.txt", "hello world\n");
+    ss::Gc gc{size_t{64} << 20};
+    ss::VirtualMachine* vm = ss::create_vm(&gc);
+    ss::vm_begin_streaming(vm);
+
+    // 'substring' shares the slice's mapping, so mutating one slice must not show through the other, nor the file:
+    std::string source =
+        "(define port (p/invoke open-input-file \"" + path + "\"))\n"
+        "(define s (p/invoke read-string 5 port))\n"
+        "(define t (p/invoke substring s 0 5))\n"
+        "(p/invoke string-set! s 0 106)\n";
+    eval_lines(vm, source);
+    EXPECT_EQ(eval_lines(vm, "(p/invoke string-ref s 0)"), "106");
+    EXPECT_EQ(eval_lines(vm, "(p/invoke string-ref s 1)"), "101");
+    EXPECT_EQ(eval_lines(vm, "(p/invoke string-ref t 0)"), "104");
+    EXPECT_EQ(eval_lines(vm, "(p/invoke string-length (p/invoke read-line port))"), "6");
+    EXPECT_EQ(eval_lines(vm, "(p/invoke string-ref (p/invoke read-line (p/invoke open-input-file \"" + path + "\")) 0)"), "104");
+    ss::destroy_vm(vm);
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "ss-core/smt.hh"
+
+///
+/// SMT TESTS
+///
+
+TEST(SmtTests, WorkDequeOwnerIsLifoThiefIsFifo) {
+    ss::SmtWorkDeque<int> deque;
+    for (int i = 0; i < 4; i++) {
+        deque.push(i);
+    }
+    EXPECT_EQ(deque.try_pop().value(), 3);
+    EXPECT_EQ(deque.try_steal().value(), 0);
+    EXPECT_EQ(deque.try_pop().value(), 2);
+    EXPECT_EQ(deque.try_steal().value(), 1);
+    EXPECT_FALSE(deque.try_pop().has_value());
+    EXPECT_FALSE(deque.try_steal().has_value());
+    EXPECT_TRUE(deque.empty());
+}
+TEST(SmtTests, FifoHandsOffAcrossThreads) {
+    ss::SmtFifo<int> fifo;
+    int const count = 1000;
+    std::thread producer{[&] () {
+        for (int i = 0; i < count; i++) {
+            fifo.enqueue(i);
+        }
+    }};
+    for (int i = 0; i < count; i++) {
+        EXPECT_EQ(fifo.wait_and_dequeue(), i);
+    }
+    producer.join();
+    EXPECT_TRUE(fifo.empty());
+}
+TEST(SmtTests, SpscRingPushesAndPopsInBatches) {
+    ss::SmtSpscRing<int> ring{3};
+    EXPECT_EQ(ring.capacity(), 4);
+    int in[] = {1, 2, 3, 4, 5};
+    EXPECT_EQ(ring.try_push_batch(in, 5), 4);
+    EXPECT_FALSE(ring.try_push(6));
+    int out[8];
+    EXPECT_EQ(ring.try_pop_batch(out, 3), 3);
+    EXPECT_EQ(out[0], 1);
+    EXPECT_EQ(out[2], 3);
+    EXPECT_TRUE(ring.try_push(6));
+    EXPECT_EQ(ring.try_pop_batch(out, 8), 2);
+    EXPECT_EQ(out[0], 4);
+    EXPECT_EQ(out[1], 6);
+    EXPECT_FALSE(ring.try_pop().has_value());
+}
+TEST(SmtTests, MpscRingHandsOffFromManyProducers) {
+    ss::SmtMpscRing<int> ring{16};
+    int const producer_count = 4;
+    int const count = 1000;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < producer_count; p++) {
+        producers.emplace_back([&ring, p] () {
+            for (int i = 0; i < count; i += 2) {
+                int batch[] = {p * count + i, p * count + i + 1};
+                size_t sent = 0;
+                while (sent < 2) {
+                    sent += ring.try_push_batch(batch + sent, 2 - sent);
+                }
+            }
+        });
+    }
+    // each producer's items arrive in the order it sent them:
+    std::vector<int> next(producer_count, 0);
+    int received = 0;
+    while (received < producer_count * count) {
+        int out[8];
+        size_t n = ring.try_pop_batch(out, 8);
+        for (size_t i = 0; i < n; i++) {
+            int p = out[i] / count;
+            EXPECT_EQ(out[i] % count, next[p]);
+            next[p]++;
+        }
+        received += static_cast<int>(n);
+    }
+    for (std::thread& producer: producers) {
+        producer.join();
+    }
+    EXPECT_FALSE(ring.try_pop().has_value());
+}
@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "ss-core/trace.hh"
+
+TEST(TraceTests, RecordsNestedSpansOnlyWhileEnabled) {
+    { ss::TraceSpan span{"before-enabled"}; }
+    ss::enable_tracing();
+    {
+        ss::TraceSpan outer{"outer", "a \"quoted\"\npath"};
+        ss::TraceSpan inner{"inner"};
+    }
+    std::thread{[] () { ss::TraceSpan span{"on-worker"}; }}.join();
+    ss::enable_tracing(false);
+    { ss::TraceSpan span{"after-disabled"}; }
+
+    std::stringstream ss;
+    ss::write_trace(ss);
+    std::string trace = ss.str();
+    EXPECT_NE(trace.find("\"traceEvents\":["), std::string::npos);
+    EXPECT_NE(trace.find("\"name\":\"outer\",\"cat\":\"ss\",\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(trace.find("\"name\":\"inner\""), std::string::npos);
+    EXPECT_NE(trace.find("\"args\":{\"detail\":\"a \\\"quoted\\\"\\npath\"}"), std::string::npos);
+    EXPECT_EQ(trace.find("before-enabled"), std::string::npos);
+    EXPECT_EQ(trace.find("after-disabled"), std::string::npos);
+
+    // the worker's span is on a thread of its own:
+    size_t worker_at = trace.find("\"name\":\"on-worker\"");
+    ASSERT_NE(worker_at, std::string::npos);
+    EXPECT_EQ(trace.find("\"tid\":1,", worker_at), std::string::npos);
+}
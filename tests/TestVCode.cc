@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+
+#include <bit>
+
+#include "ss-core/vcode.hh"
+#include "ss-core/bytecode.hh"
+#include "ss-core/peephole.hh"
+#include "ss-core/intern.hh"
+
+///
+/// VCODE UNIT TESTS
+/// - units are made and freed by hand, as the compiler and collector would.
+///
+
+TEST(VCodeTests, NumbersExpressionsByUnit) {
+    ss::VCode code;
+    auto shared = code.new_vmx_halt();
+    EXPECT_EQ(ss::vmx_unit(shared), 0);
+
+    ss::VCodeUnitID unit = code.new_unit();
+    EXPECT_EQ(unit, 1);
+    EXPECT_EQ(code.current_unit(), unit);
+    auto first = code.new_vmx_halt();
+    auto second = code.new_vmx_return(1);
+    EXPECT_EQ(first, ss::vmx_id(unit, 0));
+    EXPECT_EQ(second, first + 1);
+    EXPECT_EQ(code.end_exp_id(unit), second + 1);
+    EXPECT_EQ(code[second].kind, ss::VmExpKind::Return);
+    EXPECT_EQ(code.count_exps(), 3);
+
+    code.select_unit(0);
+    EXPECT_EQ(code.new_vmx_halt(), shared + 1);
+}
+TEST(VCodeTests, FreesUnmarkedUnits) {
+    ss::VCode code;
+    ss::FLoc loc{ss::intern("vcode-test"), {{1, 2}, {3, 4}}};
+
+    ss::VCodeUnitID marked = code.new_unit();
+    code.new_vmx_halt();
+    ss::VCodeUnitID known = code.new_unit();
+    auto known_body = code.new_vmx_return(1);
+    code.set_known_proc(0, {known_body, 1});
+    ss::VCodeUnitID unmarked = code.new_unit();
+    auto body = code.new_vmx_return(0);
+    code.set_closure_loc(body, loc);
+    code.new_vmx_close(0, body, code.new_vmx_halt());
+    EXPECT_EQ(code.count_units(), 4);
+
+    code.clear_unit_marks();
+    code.mark_unit(marked);
+    std::vector<ss::VCodeUnitID> freed = code.free_unmarked_units();
+    ASSERT_EQ(freed.size(), 1);
+    EXPECT_EQ(freed[0], unmarked);
+    EXPECT_TRUE(code.has_unit(marked));
+    EXPECT_TRUE(code.has_unit(known));
+    EXPECT_FALSE(code.has_unit(unmarked));
+    EXPECT_EQ(code.closure_loc(body), nullptr);
+    EXPECT_EQ(code.count_units(), 3);
+    EXPECT_EQ(code.count_exps(), 2);
+
+    // the freed unit's ID is reused:
+    EXPECT_EQ(code.new_unit(), unmarked);
+}
+TEST(VCodeTests, LowersUnitsIntoChunksOfTheirOwn) {
+    ss::VCode code;
+    ss::VBytecode bytecode{&code};
+
+    // long enough to span several chunks:
+    ss::VCodeUnitID unit = code.new_unit();
+    auto start = code.new_vmx_halt();
+    for (size_t i = 0; i < 200; i++) {
+        start = code.new_vmx_refer_local(i, start);
+    }
+    ss::VmCodePtr pc = bytecode.entry(start);
+    ASSERT_NE(pc, nullptr);
+    EXPECT_EQ(bytecode.entry(start), pc);
+    EXPECT_GE(bytecode.count_instructions(), 201);
+    EXPECT_TRUE(bytecode.has_unthreaded_ops());
+
+    // following the chain, across chunks:
+    size_t refer_count = 0;
+    while (static_cast<ss::VmExpKind>(*pc) != ss::VmExpKind::Halt) {
+        if (static_cast<ss::VmExpKind>(*pc) == ss::VmExpKind::Jump) {
+            pc = reinterpret_cast<ss::VmCodePtr>(pc[1]);
+        } else {
+            ASSERT_EQ(static_cast<ss::VmExpKind>(*pc), ss::VmExpKind::ReferLocal);
+            EXPECT_EQ(pc[1], 199 - refer_count);
+            refer_count++;
+            pc += 2;
+        }
+    }
+    EXPECT_EQ(refer_count, 200);
+
+    bytecode.free_unit(unit);
+    code.free_unit(unit);
+    EXPECT_EQ(bytecode.size(), 0);
+    EXPECT_EQ(bytecode.count_instructions(), 0);
+    EXPECT_FALSE(bytecode.has_unthreaded_ops());
+}
+TEST(VCodeTests, LowersBranchesIntoFallThroughsAndJumps) {
+    ss::VCode code;
+    ss::VBytecode bytecode{&code};
+    code.new_unit();
+
+    // `(if x 1 2)`, where both arms end in the same 'halt':
+    auto halt = code.new_vmx_halt();
+    auto else_x = code.new_vmx_constant(ss::OBJECT::make_integer(2), halt);
+    auto then_x = code.new_vmx_constant(ss::OBJECT::make_integer(1), halt);
+    auto test = code.new_vmx_refer_local(0, code.new_vmx_test(then_x, else_x));
+    ss::VmCodePtr pc = bytecode.entry(test);
+    ASSERT_EQ(static_cast<ss::VmExpKind>(pc[0]), ss::VmExpKind::ReferLocal);
+    pc += ss::VBytecode::width(ss::VmExpKind::ReferLocal);
+    ASSERT_EQ(static_cast<ss::VmExpKind>(pc[0]), ss::VmExpKind::Test);
+    ss::VmCodePtr else_pc = reinterpret_cast<ss::VmCodePtr>(pc[1]);
+
+    // the 'then' arm falls through, into the 'halt':
+    pc += ss::VBytecode::width(ss::VmExpKind::Test);
+    EXPECT_EQ(pc, bytecode.entry(then_x));
+    ASSERT_EQ(static_cast<ss::VmExpKind>(pc[0]), ss::VmExpKind::Constant);
+    EXPECT_EQ(std::bit_cast<ss::OBJECT>(pc[1]).as_integer(), 1);
+    pc += ss::VBytecode::width(ss::VmExpKind::Constant);
+    EXPECT_EQ(pc, bytecode.entry(halt));
+    EXPECT_EQ(static_cast<ss::VmExpKind>(pc[0]), ss::VmExpKind::Halt);
+
+    // the 'else' arm is patched in, then jumps to the 'halt' already placed:
+    EXPECT_EQ(else_pc, bytecode.entry(else_x));
+    ASSERT_EQ(static_cast<ss::VmExpKind>(else_pc[0]), ss::VmExpKind::Constant);
+    EXPECT_EQ(std::bit_cast<ss::OBJECT>(else_pc[1]).as_integer(), 2);
+    else_pc += ss::VBytecode::width(ss::VmExpKind::Constant);
+    ASSERT_EQ(static_cast<ss::VmExpKind>(else_pc[0]), ss::VmExpKind::Jump);
+    EXPECT_EQ(reinterpret_cast<ss::VmCodePtr>(else_pc[1]), bytecode.entry(halt));
+}
+TEST(VCodeTests, LowersPrimitivesOfLocalsIntoRegisterInstructions) {
+    ss::VCode code;
+    ss::VBytecode bytecode{&code, true};
+    ss::VCodeUnitID unit = code.new_unit();
+
+    // `(- n 1)`, then `(- 1 n)`, which does not commute: 
+    auto halt = code.new_vmx_halt();
+    auto rev_sub = code.new_vmx_refer_local(0, code.new_vmx_argument(
+        code.new_vmx_constant(ss::OBJECT::make_integer(1), code.new_vmx_prim(ss::VmExpKind::PrimSub, 7, halt))
+    ));
+    auto sub = code.new_vmx_constant(ss::OBJECT::make_integer(1), code.new_vmx_argument(
+        code.new_vmx_refer_local(0, code.new_vmx_prim(ss::VmExpKind::PrimSub, 7, rev_sub))
+    ));
+    ss::fuse_superinstructions(code, ss::vmx_id(unit, 0));
+    ss::VmCodePtr pc = bytecode.entry(sub);
+    ASSERT_EQ(static_cast<ss::VmExpKind>(pc[0]), ss::VmExpKind::PrimSubRK);
+    EXPECT_EQ(pc[1], 7);
+    EXPECT_EQ(pc[2], 0);
+    EXPECT_EQ(std::bit_cast<ss::OBJECT>(pc[3]).as_integer(), 1);
+    pc += ss::VBytecode::width(ss::VmExpKind::PrimSubRK);
+    EXPECT_EQ(static_cast<ss::VmExpKind>(pc[0]), ss::VmExpKind::ReferLocalPush);
+    pc += ss::VBytecode::width(ss::VmExpKind::ReferLocalPush);
+    EXPECT_EQ(static_cast<ss::VmExpKind>(pc[0]), ss::VmExpKind::Constant);
+
+    // without registers, the same VmExps are lowered one by one:
+    ss::VBytecode stack_bytecode{&code};
+    EXPECT_EQ(static_cast<ss::VmExpKind>(*stack_bytecode.entry(sub)), ss::VmExpKind::ConstantPush);
+}
+TEST(VCodeTests, QuickensAndDeoptimizesInstructionsInPlace) {
+    ss::VCode code;
+    ss::VBytecode bytecode{&code};
+    code.new_unit();
+
+    // `(g)` where `g` is global 3:
+    auto apply = code.new_vmx_apply();
+    auto refer = code.new_vmx_refer_global(3, code.new_vmx_argument(apply));
+    ss::VmCodePtr pc = bytecode.entry(refer);
+    ss::VmCodePtr apply_pc = bytecode.entry(apply);
+
+    bytecode.quicken_global(pc, ss::OBJECT::make_integer(5));
+    ASSERT_EQ(static_cast<ss::VmExpKind>(pc[0]), ss::VmExpKind::Constant);
+    EXPECT_EQ(std::bit_cast<ss::OBJECT>(pc[1]).as_integer(), 5);
+    EXPECT_TRUE(bytecode.has_quickened_global(3));
+    bytecode.deoptimize_global(3);
+    EXPECT_EQ(static_cast<ss::VmExpKind>(pc[0]), ss::VmExpKind::ReferGlobal);
+    EXPECT_EQ(pc[1], 3);
+    EXPECT_FALSE(bytecode.has_quickened_global(3));
+
+    // a call is cached once, then left polymorphic once it misses:
+    ss::OBJECT closure = ss::OBJECT::make_integer(9);
+    bytecode.quicken_call(apply_pc, closure, pc);
+    ASSERT_EQ(static_cast<ss::VmExpKind>(apply_pc[0]), ss::VmExpKind::ApplyCached);
+    EXPECT_EQ(ss::VBytecode::call_cache(apply_pc)[0], closure.as_raw());
+    EXPECT_EQ(ss::VBytecode::call_cache(apply_pc)[1], reinterpret_cast<ss::VmWord>(pc));
+    bytecode.uncache_call(apply_pc);
+    EXPECT_EQ(static_cast<ss::VmExpKind>(apply_pc[0]), ss::VmExpKind::Apply);
+    EXPECT_EQ(ss::VBytecode::call_cache(apply_pc)[0], ss::VBytecode::POLYMORPHIC_CALL);
+    bytecode.quicken_call(apply_pc, closure, pc);
+    EXPECT_EQ(static_cast<ss::VmExpKind>(apply_pc[0]), ss::VmExpKind::Apply);
+    EXPECT_EQ(bytecode.count_quickenings(), 0);
+}
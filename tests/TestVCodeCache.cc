@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <filesystem>
+
+#include "ss-core/vcode-cache.hh"
+#include "ss-core/intern.hh"
+#include "ss-core/printing.hh"
+
+///
+/// VCODE CACHE TESTS
+/// - the cache is loaded into VCode whose expressions, globals, and platform procedures are numbered
+///   differently from the VCode it was saved from, so that relinking is checked.
+///
+
+static ss::OBJECT cache_test_sub2(void*, ss::OBJECT a0, ss::OBJECT a1) {
+    return ss::OBJECT::make_integer(a0.as_integer() - a1.as_integer());
+}
+static ss::OBJECT cache_test_neg(void*, ss::OBJECT a0) {
+    return ss::OBJECT::make_integer(-a0.as_integer());
+}
+static std::string obj_text(ss::OBJECT obj) {
+    std::stringstream ss;
+    ss << obj;
+    return ss.str();
+}
+
+TEST(VCodeCacheTests, RelinksOnLoad) {
+    ss::Gc gc{ss::GIBIBYTES(1)};
+    ss::GcThreadFrontEnd gc_tfe{&gc};
+    std::string ssc_path = (std::filesystem::temp_directory_path() / "ss-test-vcode-cache.ssc").string();
+    ss::FLoc loc{ss::intern("vcode-cache-test"), {{1, 2}, {3, 4}}};
+    uint64_t key = ss::vcode_cache_key("(source)", "vcode-cache-test");
+
+    // saving:
+    std::string constant_text;
+    {
+        ss::VCode code;
+        code.pproc_tab().define(ss::intern("cache-test-sub2"), {ss::intern("a"), ss::intern("b")}, {cache_test_sub2, nullptr}, "");
+        code.pproc_tab().define(ss::intern("cache-test-neg"), {ss::intern("a")}, {cache_test_neg, nullptr}, "");
+        ss::GDefID prelude_gdef = code.define_global(loc, ss::intern("cache-test-prelude"));
+        code.new_vmx_halt();
+
+        ss::VCodeUnitID unit = code.new_unit();
+        ss::GDefID first_gdef_id = code.count_globals();
+        ss::GDefID local_gdef = code.define_global(loc, ss::intern("cache-test-local"));
+        char text[] = "text";
+        ss::OBJECT constant = ss::list(
+            &gc_tfe,
+            ss::OBJECT::make_integer(1),
+            ss::OBJECT::make_symbol(ss::intern("sym")),
+            ss::OBJECT::make_string(&gc_tfe, 4, text, false),
+            ss::OBJECT::make_vector(&gc_tfe, {ss::OBJECT::make_float64(&gc_tfe, 2.5)})
+        );
+        constant_text = obj_text(constant);
+
+        auto halt = code.new_vmx_halt();
+        auto body = code.new_vmx_pinvoke(1, 1, code.new_vmx_return(1));
+        code.set_closure_loc(body, loc);
+        auto close = code.new_vmx_close(0, body, halt);
+        auto assign = code.new_vmx_assign_global(local_gdef, close);
+        auto refer = code.new_vmx_refer_global(prelude_gdef, assign);
+        auto start = code.new_vmx_constant(constant, refer);
+        ss::VSubr subr{"vcode-cache-test", {ss::OBJECT::null}, {{start, halt}}, unit};
+
+        ASSERT_TRUE(ss::save_vcode_cache(ssc_path, key, code, subr, first_gdef_id));
+    }
+
+    // loading, with the platform procedures defined in the opposite order, and more globals and expressions:
+    {
+        ss::VCode code;
+        code.pproc_tab().define(ss::intern("cache-test-neg"), {ss::intern("a")}, {cache_test_neg, nullptr}, "");
+        code.pproc_tab().define(ss::intern("cache-test-sub2"), {ss::intern("a"), ss::intern("b")}, {cache_test_sub2, nullptr}, "");
+        code.define_global(loc, ss::intern("cache-test-other"));
+        ss::GDefID prelude_gdef = code.define_global(loc, ss::intern("cache-test-prelude"));
+        code.new_vmx_halt();
+        code.new_vmx_halt();
+        code.new_vmx_halt();
+
+        size_t exp_count = code.count_exps();
+        EXPECT_FALSE(ss::load_vcode_cache(ssc_path, key + 1, code, &gc_tfe).has_value());
+        EXPECT_EQ(code.count_exps(), exp_count);
+
+        std::optional<ss::VSubr> subr = ss::load_vcode_cache(ssc_path, key, code, &gc_tfe);
+        ASSERT_TRUE(subr.has_value());
+        ASSERT_EQ(subr->line_programs.size(), 1);
+        ASSERT_EQ(subr->line_code_objs.size(), 1);
+        EXPECT_TRUE(subr->line_code_objs[0].is_null());
+
+        std::optional<ss::GDefID> local_gdef = code.def_tab().lookup_global_id(ss::intern("cache-test-local"));
+        ASSERT_TRUE(local_gdef.has_value());
+        EXPECT_EQ(local_gdef.value(), prelude_gdef + 1);
+
+        auto start = subr->line_programs[0].s;
+        ASSERT_EQ(code[start].kind, ss::VmExpKind::Constant);
+        EXPECT_EQ(obj_text(code[start].args.i_constant.obj), constant_text);
+        auto refer = code[start].args.i_constant.x;
+        ASSERT_EQ(code[refer].kind, ss::VmExpKind::ReferGlobal);
+        EXPECT_EQ(code[refer].args.i_refer.n, prelude_gdef);
+        auto assign = code[refer].args.i_refer.x;
+        ASSERT_EQ(code[assign].kind, ss::VmExpKind::AssignGlobal);
+        EXPECT_EQ(code[assign].args.i_assign.n, local_gdef.value());
+        auto close = code[assign].args.i_assign.x;
+        ASSERT_EQ(code[close].kind, ss::VmExpKind::Close);
+        EXPECT_EQ(code[close].args.i_close.x, subr->line_programs[0].t);
+        EXPECT_EQ(code[subr->line_programs[0].t].kind, ss::VmExpKind::Halt);
+        auto body = code[close].args.i_close.body;
+        ASSERT_EQ(code[body].kind, ss::VmExpKind::PInvoke);
+        EXPECT_EQ(code[body].args.i_pinvoke.proc_id, 0);
+        ASSERT_NE(code.closure_loc(body), nullptr);
+        ss::FLoc body_loc = *code.closure_loc(body);
+        EXPECT_EQ(body_loc.as_text(), loc.as_text());
+    }
+    std::filesystem::remove(ssc_path);
+}
+
+TEST(VCodeCacheTests, RelinksKnownCalls) {
+    ss::Gc gc{ss::GIBIBYTES(1)};
+    ss::GcThreadFrontEnd gc_tfe{&gc};
+    std::string ssc_path = (std::filesystem::temp_directory_path() / "ss-test-vcode-cache-known.ssc").string();
+    ss::FLoc loc{ss::intern("vcode-cache-known-test"), {{1, 2}, {3, 4}}};
+    uint64_t key = ss::vcode_cache_key("(source)", "vcode-cache-known-test");
+
+    // saving: a known procedure defined before the subr, and one defined by it.
+    {
+        ss::VCode code;
+        ss::GDefID prelude_gdef = code.define_global(loc, ss::intern("cache-known-prelude"));
+        ss::VmExpID prelude_body = code.new_vmx_return(1);
+        code.set_known_proc(prelude_gdef, {prelude_body, 1});
+
+        ss::VCodeUnitID unit = code.new_unit();
+        ss::GDefID first_gdef_id = code.count_globals();
+        ss::GDefID local_gdef = code.define_global(loc, ss::intern("cache-known-local"));
+        auto halt = code.new_vmx_halt();
+        auto local_body = code.new_vmx_shift_call_global(prelude_gdef, prelude_body, 1, 2);
+        code.set_known_proc(local_gdef, {local_body, 2});
+        auto call = code.new_vmx_call_global(local_gdef, local_body);
+        auto start = code.new_vmx_frame(call, halt);
+        ss::VSubr subr{"vcode-cache-known-test", {ss::OBJECT::null}, {{start, halt}}, unit};
+
+        ASSERT_TRUE(ss::save_vcode_cache(ssc_path, key, code, subr, first_gdef_id));
+    }
+
+    // loading: the prelude's procedure must be known, but its body may have moved.
+    {
+        ss::VCode code;
+        ss::GDefID prelude_gdef = code.define_global(loc, ss::intern("cache-known-prelude"));
+        code.new_vmx_halt();
+        EXPECT_FALSE(ss::load_vcode_cache(ssc_path, key, code, &gc_tfe).has_value());
+
+        ss::VmExpID prelude_body = code.new_vmx_return(1);
+        code.set_known_proc(prelude_gdef, {prelude_body, 1});
+        std::optional<ss::VSubr> subr = ss::load_vcode_cache(ssc_path, key, code, &gc_tfe);
+        ASSERT_TRUE(subr.has_value());
+
+        std::optional<ss::GDefID> local_gdef = code.def_tab().lookup_global_id(ss::intern("cache-known-local"));
+        ASSERT_TRUE(local_gdef.has_value());
+        ss::KnownProc const* local_proc = code.known_proc(local_gdef.value());
+        ASSERT_NE(local_proc, nullptr);
+        EXPECT_EQ(local_proc->arity, 2);
+
+        auto start = subr->line_programs[0].s;
+        ASSERT_EQ(code[start].kind, ss::VmExpKind::Frame);
+        auto call = code[start].args.i_frame.fn_body_x;
+        ASSERT_EQ(code[call].kind, ss::VmExpKind::CallGlobal);
+        EXPECT_EQ(code[call].args.i_call_global.gn, local_gdef.value());
+        EXPECT_EQ(code[call].args.i_call_global.body, local_proc->body);
+        ASSERT_EQ(code[local_proc->body].kind, ss::VmExpKind::ShiftCallGlobal);
+        EXPECT_EQ(code[local_proc->body].args.i_call_global.gn, prelude_gdef);
+        EXPECT_EQ(code[local_proc->body].args.i_call_global.body, prelude_body);
+        EXPECT_EQ(code[local_proc->body].args.i_call_global.n, 1);
+        EXPECT_EQ(code[local_proc->body].args.i_call_global.m, 2);
+    }
+    std::filesystem::remove(ssc_path);
+}
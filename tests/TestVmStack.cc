@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include "ss-core/vthread.hh"
+
+///
+/// VM STACK TESTS
+///
+
+TEST(VmStackTests, CommitsOnDemandAndTrims) {
+    ss::VmStack stack{1 << 20};
+    size_t initial_committed_count = stack.committed_count();
+    EXPECT_LT(initial_committed_count, stack.capacity());
+
+    ssize_t s = 0;
+    for (ssize_t i = 0; i < (1 << 18); i++) {
+        s = stack.push(ss::OBJECT::make_integer(i), s);
+    }
+    EXPECT_GE(stack.committed_count(), static_cast<size_t>(s));
+    EXPECT_EQ(stack.index(s, 0).as_integer(), (1 << 18) - 1);
+    EXPECT_EQ(stack.index(s, s - 1).as_integer(), 0);
+
+    stack.trim(16);
+    EXPECT_EQ(stack.committed_count(), initial_committed_count);
+    EXPECT_EQ(stack.index(16, 0).as_integer(), 15);
+}
+TEST(VmStackTests, RaisesOnOverflow) {
+    ss::VmStack stack{1024};
+    ssize_t s = 0;
+    for (size_t i = 0; i < stack.capacity(); i++) {
+        s = stack.push(ss::OBJECT::null, s);
+    }
+    EXPECT_THROW(stack.push(ss::OBJECT::null, s), ss::SsiError);
+}
+TEST(VmStackTests, ShiftsArgumentsDown) {
+    // a tail call pushes 3 new arguments above the caller's 2 arguments:
+    ss::VmStack stack{1024};
+    ssize_t s = 0;
+    for (ssize_t i = 0; i < 6; i++) {
+        s = stack.push(ss::OBJECT::make_integer(i), s);
+    }
+    stack.set_captured(ss::OBJECT::null, s);
+    s = stack.shift(s, 3, 2);
+    EXPECT_EQ(s, 4);
+    EXPECT_EQ(stack.index(s, 0).as_integer(), 5);
+    EXPECT_EQ(stack.index(s, 2).as_integer(), 3);
+    EXPECT_EQ(stack.index(s, 3).as_integer(), 0);
+    EXPECT_EQ(stack.captured_height(), 1);
+}